@@ -523,6 +523,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->colorRange,           COMBO_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->sdrWhiteLevel,        SCROLL_CHANGED, ADV_CHANGED);
 	HookWidget(ui->hdrNominalPeakLevel,  SCROLL_CHANGED, ADV_CHANGED);
+	HookWidget(ui->threadedVideoInputs,  CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->disableOSXVSync,      CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->resetOSXVSync,        CHECK_CHANGED,  ADV_CHANGED);
 	if (obs_audio_monitoring_available())
@@ -628,8 +629,10 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 #endif
 	delete ui->processPriorityLabel;
 	delete ui->processPriority;
+#ifndef __linux__
 	delete ui->enableNewSocketLoop;
 	delete ui->enableLowLatencyMode;
+#endif
 	delete ui->hideOBSFromCapture;
 #if !defined(__APPLE__) && !defined(__linux__)
 	delete ui->browserHWAccel;
@@ -639,8 +642,10 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 
 	ui->processPriorityLabel = nullptr;
 	ui->processPriority = nullptr;
+#ifndef __linux__
 	ui->enableNewSocketLoop = nullptr;
 	ui->enableLowLatencyMode = nullptr;
+#endif
 	ui->hideOBSFromCapture = nullptr;
 #if !defined(__APPLE__) && !defined(__linux__)
 	ui->browserHWAccel = nullptr;
@@ -2539,6 +2544,7 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	int rbTime = config_get_int(main->Config(), "AdvOut", "RecRBTime");
 	int rbSize = config_get_int(main->Config(), "AdvOut", "RecRBSize");
 	bool autoRemux = config_get_bool(main->Config(), "Video", "AutoRemux");
+	bool threadedVideoInputs = config_get_bool(main->Config(), "Video", "ThreadedVideoInputs");
 	const char *hotkeyFocusType = config_get_string(App()->GetUserConfig(), "General", "HotkeyFocusType");
 	bool dynBitrate = config_get_bool(main->Config(), "Output", "DynamicBitrate");
 	const char *ipFamily = config_get_string(main->Config(), "Output", "IPFamily");
@@ -2577,6 +2583,7 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	SetComboByValue(ui->colorRange, videoColorRange);
 	ui->sdrWhiteLevel->setValue(sdrWhiteLevel);
 	ui->hdrNominalPeakLevel->setValue(hdrNominalPeakLevel);
+	ui->threadedVideoInputs->setChecked(threadedVideoInputs);
 
 	SetComboByValue(ui->ipFamily, ipFamily);
 	if (!SetComboByValue(ui->bindToIP, bindIP))
@@ -2597,13 +2604,15 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	ui->disableAudioDucking->setChecked(disableAudioDucking);
 
 	const char *processPriority = config_get_string(App()->GetAppConfig(), "General", "ProcessPriority");
-	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output", "NewSocketLoopEnable");
-	bool enableLowLatencyMode = config_get_bool(main->Config(), "Output", "LowLatencyEnable");
 
 	int idx = ui->processPriority->findData(processPriority);
 	if (idx == -1)
 		idx = ui->processPriority->findData("Normal");
 	ui->processPriority->setCurrentIndex(idx);
+#endif
+#if defined(_WIN32) || defined(__linux__)
+	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output", "NewSocketLoopEnable");
+	bool enableLowLatencyMode = config_get_bool(main->Config(), "Output", "LowLatencyEnable");
 
 	ui->enableNewSocketLoop->setChecked(enableNewSocketLoop);
 	ui->enableLowLatencyMode->setChecked(enableLowLatencyMode);
@@ -3156,7 +3165,8 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	config_set_string(App()->GetAppConfig(), "General", "ProcessPriority", priority.c_str());
 	if (main->Active())
 		SetProcessPriority(priority.c_str());
-
+#endif
+#if defined(_WIN32) || defined(__linux__)
 	SaveCheckBox(ui->enableNewSocketLoop, "Output", "NewSocketLoopEnable");
 	SaveCheckBox(ui->enableLowLatencyMode, "Output", "LowLatencyEnable");
 #endif
@@ -3185,6 +3195,11 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	SaveComboData(ui->colorRange, "Video", "ColorRange");
 	SaveSpinBox(ui->sdrWhiteLevel, "Video", "SdrWhiteLevel");
 	SaveSpinBox(ui->hdrNominalPeakLevel, "Video", "HdrNominalPeakLevel");
+	if (WidgetChanged(ui->threadedVideoInputs)) {
+		bool threaded = ui->threadedVideoInputs->isChecked();
+		config_set_bool(main->Config(), "Video", "ThreadedVideoInputs", threaded);
+		obs_set_threaded_video_inputs(threaded);
+	}
 	if (obs_audio_monitoring_available()) {
 		SaveCombo(ui->monitoringDevice, "Audio", "MonitoringDeviceName");
 		SaveComboData(ui->monitoringDevice, "Audio", "MonitoringDeviceId");
@@ -5585,7 +5600,7 @@ void OBSBasicSettings::UpdateAdvNetworkGroup()
 	ui->dynBitrate->setVisible(enabled);
 	ui->ipFamilyLabel->setVisible(enabled);
 	ui->ipFamily->setVisible(enabled);
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	ui->enableNewSocketLoop->setVisible(enabled);
 	ui->enableLowLatencyMode->setVisible(enabled);
 #endif
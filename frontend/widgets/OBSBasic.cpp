@@ -1598,6 +1598,7 @@ int OBSBasic::ResetVideo()
 		const float hdr_nominal_peak_level =
 			(float)config_get_uint(activeConfiguration, "Video", "HdrNominalPeakLevel");
 		obs_set_video_levels(sdr_white_level, hdr_nominal_peak_level);
+		obs_set_threaded_video_inputs(config_get_bool(activeConfiguration, "Video", "ThreadedVideoInputs"));
 		OBSBasicStats::InitializeValues();
 		OBSProjector::UpdateMultiviewProjectors();
 
@@ -0,0 +1,223 @@
+#include <util/bmem.h>
+#include <util/platform.h>
+#include "null-subsystem.h"
+
+/* ------------------------------------------------------------------------- */
+/* vertex buffers                                                            */
+
+gs_vertbuffer_t *device_vertexbuffer_create(gs_device_t *device, struct gs_vb_data *data, uint32_t flags)
+{
+	struct gs_vertex_buffer *vb = bzalloc(sizeof(struct gs_vertex_buffer));
+	vb->device = device;
+	vb->data = data;
+	vb->dynamic = (flags & GS_DYNAMIC) != 0;
+	return vb;
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer)
+{
+	if (!vertbuffer)
+		return;
+
+	if (vertbuffer->device->cur_vertex_buffer == vertbuffer)
+		vertbuffer->device->cur_vertex_buffer = NULL;
+
+	gs_vbdata_destroy(vertbuffer->data);
+	bfree(vertbuffer);
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer)
+{
+	/* vertices are read straight from the gs_vb_data at draw time */
+	UNUSED_PARAMETER(vertbuffer);
+}
+
+void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vertbuffer, const struct gs_vb_data *data)
+{
+	struct gs_vb_data *dst = vertbuffer->data;
+	size_t num;
+
+	if (!vertbuffer->dynamic) {
+		blog(LOG_ERROR, "vertex buffer is not dynamic");
+		return;
+	}
+
+	if (!dst || dst == data)
+		return;
+
+	num = dst->num < data->num ? dst->num : data->num;
+
+#define COPY_VAL(val)                                                  \
+	do {                                                           \
+		if (dst->val && data->val)                             \
+			memcpy(dst->val, data->val, sizeof(*dst->val) * num); \
+	} while (false)
+
+	COPY_VAL(points);
+	COPY_VAL(normals);
+	COPY_VAL(tangents);
+	COPY_VAL(colors);
+#undef COPY_VAL
+
+	for (size_t i = 0; i < dst->num_tex && i < data->num_tex; i++) {
+		struct gs_tvertarray *tv = &dst->tvarray[i];
+		if (tv->width == data->tvarray[i].width)
+			memcpy(tv->array, data->tvarray[i].array, tv->width * sizeof(float) * num);
+	}
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
+{
+	return vertbuffer->data;
+}
+
+/* ------------------------------------------------------------------------- */
+/* index buffers                                                             */
+
+gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device, enum gs_index_type type, void *indices, size_t num,
+					    uint32_t flags)
+{
+	struct gs_index_buffer *ib = bzalloc(sizeof(struct gs_index_buffer));
+	size_t width = type == GS_UNSIGNED_LONG ? sizeof(uint32_t) : sizeof(uint16_t);
+
+	ib->device = device;
+	ib->type = type;
+	ib->data = indices;
+	ib->num = num;
+	ib->width = width;
+	ib->dynamic = (flags & GS_DYNAMIC) != 0;
+	return ib;
+}
+
+void gs_indexbuffer_destroy(gs_indexbuffer_t *indexbuffer)
+{
+	if (!indexbuffer)
+		return;
+
+	if (indexbuffer->device->cur_index_buffer == indexbuffer)
+		indexbuffer->device->cur_index_buffer = NULL;
+
+	bfree(indexbuffer->data);
+	bfree(indexbuffer);
+}
+
+void gs_indexbuffer_flush(gs_indexbuffer_t *indexbuffer)
+{
+	UNUSED_PARAMETER(indexbuffer);
+}
+
+void gs_indexbuffer_flush_direct(gs_indexbuffer_t *indexbuffer, const void *data)
+{
+	if (!indexbuffer->dynamic) {
+		blog(LOG_ERROR, "index buffer is not dynamic");
+		return;
+	}
+
+	if (indexbuffer->data != data)
+		memcpy(indexbuffer->data, data, indexbuffer->num * indexbuffer->width);
+}
+
+void *gs_indexbuffer_get_data(const gs_indexbuffer_t *indexbuffer)
+{
+	return indexbuffer->data;
+}
+
+size_t gs_indexbuffer_get_num_indices(const gs_indexbuffer_t *indexbuffer)
+{
+	return indexbuffer->num;
+}
+
+enum gs_index_type gs_indexbuffer_get_type(const gs_indexbuffer_t *indexbuffer)
+{
+	return indexbuffer->type;
+}
+
+/* ------------------------------------------------------------------------- */
+/* sampler states                                                            */
+
+gs_samplerstate_t *device_samplerstate_create(gs_device_t *device, const struct gs_sampler_info *info)
+{
+	struct gs_sampler_state *sampler = bzalloc(sizeof(struct gs_sampler_state));
+	sampler->device = device;
+	sampler->info = *info;
+	return sampler;
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	if (!samplerstate)
+		return;
+
+	if (samplerstate->device) {
+		for (int i = 0; i < GS_MAX_TEXTURES; i++)
+			if (samplerstate->device->cur_samplers[i] == samplerstate)
+				samplerstate->device->cur_samplers[i] = NULL;
+	}
+
+	bfree(samplerstate);
+}
+
+/* ------------------------------------------------------------------------- */
+/* timers: draws execute synchronously, so CPU time is the GPU time          */
+
+gs_timer_t *device_timer_create(gs_device_t *device)
+{
+	struct gs_timer *timer = bzalloc(sizeof(struct gs_timer));
+	timer->device = device;
+	return timer;
+}
+
+gs_timer_range_t *device_timer_range_create(gs_device_t *device)
+{
+	struct gs_timer_range *range = bzalloc(sizeof(struct gs_timer_range));
+	range->device = device;
+	return range;
+}
+
+void gs_timer_destroy(gs_timer_t *timer)
+{
+	bfree(timer);
+}
+
+void gs_timer_begin(gs_timer_t *timer)
+{
+	timer->begin_time = os_gettime_ns();
+}
+
+void gs_timer_end(gs_timer_t *timer)
+{
+	timer->end_time = os_gettime_ns();
+}
+
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+{
+	if (timer->end_time < timer->begin_time)
+		return false;
+
+	*ticks = timer->end_time - timer->begin_time;
+	return true;
+}
+
+void gs_timer_range_destroy(gs_timer_range_t *range)
+{
+	bfree(range);
+}
+
+void gs_timer_range_begin(gs_timer_range_t *range)
+{
+	UNUSED_PARAMETER(range);
+}
+
+void gs_timer_range_end(gs_timer_range_t *range)
+{
+	UNUSED_PARAMETER(range);
+}
+
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint, uint64_t *frequency)
+{
+	UNUSED_PARAMETER(range);
+
+	*disjoint = false;
+	*frequency = 1000000000;
+	return true;
+}
@@ -0,0 +1,544 @@
+#include "null-subsystem.h"
+
+/*
+ * Native equivalents of the built-in effect functions.  Each kernel is keyed
+ * by the effect file it comes from and the entry function name, so that
+ * identically named functions in other effects are never misinterpreted.
+ *
+ * The vertex kernels follow Direct3D conventions (texture origin at the top
+ * left, obs_glsl_compile == false).
+ */
+
+static inline void transform(struct vec4 *dst, const struct vec4 *v, const struct matrix4 *m)
+{
+	dst->x = v->x * m->x.x + v->y * m->y.x + v->z * m->z.x + v->w * m->t.x;
+	dst->y = v->x * m->x.y + v->y * m->y.y + v->z * m->z.y + v->w * m->t.y;
+	dst->z = v->x * m->x.z + v->y * m->y.z + v->z * m->z.z + v->w * m->t.z;
+	dst->w = v->x * m->x.w + v->y * m->y.w + v->z * m->z.w + v->w * m->t.w;
+}
+
+static inline void sample_image(const struct null_uniforms *uni, float u, float v, struct vec4 *out)
+{
+	null_texture_sample(uni->image, uni->image_sampler, u, v, uni->image_srgb, out);
+}
+
+static inline void load_image(const struct null_uniforms *uni, const struct vec4 *pos, struct vec4 *out)
+{
+	null_texture_load(uni->image, (int)pos->x, (int)pos->y, uni->image_srgb, out);
+}
+
+static inline float dot_color(const struct vec4 *cv, const struct vec4 *rgb)
+{
+	return cv->x * rgb->x + cv->y * rgb->y + cv->z * rgb->z + cv->w;
+}
+
+static inline void srgb_to_linear(struct vec4 *rgba)
+{
+	rgba->x = gs_srgb_nonlinear_to_linear(rgba->x);
+	rgba->y = gs_srgb_nonlinear_to_linear(rgba->y);
+	rgba->z = gs_srgb_nonlinear_to_linear(rgba->z);
+}
+
+static inline void linear_to_srgb(struct vec4 *rgba)
+{
+	rgba->x = gs_srgb_linear_to_nonlinear(rgba->x);
+	rgba->y = gs_srgb_linear_to_nonlinear(rgba->y);
+	rgba->z = gs_srgb_linear_to_nonlinear(rgba->z);
+}
+
+static inline void mul_rgb(struct vec4 *rgba, float f)
+{
+	rgba->x *= f;
+	rgba->y *= f;
+	rgba->z *= f;
+}
+
+/* ------------------------------------------------------------------------- */
+/* vertex kernels                                                            */
+
+static void vs_default(const struct null_uniforms *uni, const struct null_vs_input *in, struct null_varyings *out)
+{
+	struct vec4 pos;
+	vec4_set(&pos, in->pos.x, in->pos.y, in->pos.z, 1.0f);
+	transform(&out->pos, &pos, &uni->viewproj);
+	out->v[0] = in->uv.x;
+	out->v[1] = in->uv.y;
+}
+
+static void vs_solid(const struct null_uniforms *uni, const struct null_vs_input *in, struct null_varyings *out)
+{
+	struct vec4 pos;
+	vec4_set(&pos, in->pos.x, in->pos.y, in->pos.z, 1.0f);
+	transform(&out->pos, &pos, &uni->viewproj);
+}
+
+static void vs_solid_colored(const struct null_uniforms *uni, const struct null_vs_input *in,
+			     struct null_varyings *out)
+{
+	vs_solid(uni, in, out);
+	out->v[0] = in->color.x;
+	out->v[1] = in->color.y;
+	out->v[2] = in->color.z;
+	out->v[3] = in->color.w;
+}
+
+static void vs_pos(const struct null_uniforms *uni, const struct null_vs_input *in, struct null_varyings *out)
+{
+	float id_high = (float)(in->id >> 1);
+	float id_low = (float)(in->id & 1);
+
+	UNUSED_PARAMETER(uni);
+	vec4_set(&out->pos, id_high * 4.0f - 1.0f, id_low * 4.0f - 1.0f, 0.0f, 1.0f);
+}
+
+static void vs_tex_pos_left(const struct null_uniforms *uni, const struct null_vs_input *in,
+			    struct null_varyings *out)
+{
+	float id_high = (float)(in->id >> 1);
+	float id_low = (float)(in->id & 1);
+	float u_right = id_high * 2.0f;
+
+	vs_pos(uni, in, out);
+	out->v[0] = u_right - uni->width_i;
+	out->v[1] = u_right;
+	out->v[2] = 1.0f - id_low * 2.0f;
+}
+
+static void vs_packed422_left_reverse(const struct null_uniforms *uni, const struct null_vs_input *in,
+				      struct null_varyings *out)
+{
+	float u = (float)(in->id >> 1) * 2.0f;
+	float v = 1.0f - (float)(in->id & 1) * 2.0f;
+
+	vs_pos(uni, in, out);
+	out->v[0] = uni->width_d2 * u;
+	out->v[1] = uni->height * v;
+	out->v[2] = u + uni->width_x2_i;
+	out->v[3] = v;
+}
+
+/* VS420Left_Reverse and VS422Left_Reverse are identical without GLSL */
+static void vs_chroma_left_reverse(const struct null_uniforms *uni, const struct null_vs_input *in,
+				   struct null_varyings *out)
+{
+	vs_pos(uni, in, out);
+	out->v[0] = (float)(in->id >> 1) * 2.0f + uni->width_x2_i;
+	out->v[1] = 1.0f - (float)(in->id & 1) * 2.0f;
+}
+
+/* ------------------------------------------------------------------------- */
+/* pixel kernels: default.effect / opaque.effect                             */
+
+static void ps_draw_bare(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	sample_image(uni, in->v[0], in->v[1], out);
+}
+
+static void ps_draw_alpha_divide(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	sample_image(uni, in->v[0], in->v[1], out);
+	mul_rgb(out, out->w > 0.0f ? (1.0f / out->w) : 0.0f);
+}
+
+static void ps_draw_multiply(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	sample_image(uni, in->v[0], in->v[1], out);
+	mul_rgb(out, uni->multiplier);
+}
+
+static void ps_draw_srgb_decompress(const struct null_uniforms *uni, const struct null_varyings *in,
+				    struct vec4 *out)
+{
+	sample_image(uni, in->v[0], in->v[1], out);
+	srgb_to_linear(out);
+}
+
+static void ps_draw_srgb_decompress_multiply(const struct null_uniforms *uni, const struct null_varyings *in,
+					     struct vec4 *out)
+{
+	ps_draw_srgb_decompress(uni, in, out);
+	mul_rgb(out, uni->multiplier);
+}
+
+static void ps_draw_nonlinear_alpha(const struct null_uniforms *uni, const struct null_varyings *in,
+				    struct vec4 *out)
+{
+	sample_image(uni, in->v[0], in->v[1], out);
+	linear_to_srgb(out);
+	mul_rgb(out, out->w);
+	srgb_to_linear(out);
+}
+
+static void ps_draw_nonlinear_alpha_multiply(const struct null_uniforms *uni, const struct null_varyings *in,
+					     struct vec4 *out)
+{
+	ps_draw_nonlinear_alpha(uni, in, out);
+	mul_rgb(out, uni->multiplier);
+}
+
+static void ps_draw_opaque(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	ps_draw_bare(uni, in, out);
+	out->w = 1.0f;
+}
+
+static void ps_draw_opaque_multiply(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	ps_draw_multiply(uni, in, out);
+	out->w = 1.0f;
+}
+
+static void ps_draw_opaque_srgb_decompress(const struct null_uniforms *uni, const struct null_varyings *in,
+					   struct vec4 *out)
+{
+	ps_draw_srgb_decompress(uni, in, out);
+	out->w = 1.0f;
+}
+
+static void ps_draw_opaque_srgb_decompress_multiply(const struct null_uniforms *uni, const struct null_varyings *in,
+						    struct vec4 *out)
+{
+	ps_draw_srgb_decompress_multiply(uni, in, out);
+	out->w = 1.0f;
+}
+
+/* ------------------------------------------------------------------------- */
+/* pixel kernels: solid.effect                                               */
+
+static void ps_solid(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	UNUSED_PARAMETER(in);
+	vec4_copy(out, &uni->color);
+}
+
+static void ps_solid_colored(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	vec4_set(out, in->v[0], in->v[1], in->v[2], in->v[3]);
+	vec4_mul(out, out, &uni->color);
+}
+
+/* ------------------------------------------------------------------------- */
+/* pixel kernels: format_conversion.effect                                   */
+
+static void ps_y(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 rgb;
+	load_image(uni, &in->pos, &rgb);
+	vec4_set(out, dot_color(&uni->color_vec[0], &rgb), 0.0f, 0.0f, 1.0f);
+}
+
+static void ps_u(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 rgb;
+	load_image(uni, &in->pos, &rgb);
+	vec4_set(out, dot_color(&uni->color_vec[1], &rgb), 0.0f, 0.0f, 1.0f);
+}
+
+static void ps_v(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 rgb;
+	load_image(uni, &in->pos, &rgb);
+	vec4_set(out, dot_color(&uni->color_vec[2], &rgb), 0.0f, 0.0f, 1.0f);
+}
+
+static inline void sample_wide(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *rgb)
+{
+	struct vec4 right;
+
+	sample_image(uni, in->v[0], in->v[2], rgb);
+	sample_image(uni, in->v[1], in->v[2], &right);
+	vec4_add(rgb, rgb, &right);
+	vec4_mulf(rgb, rgb, 0.5f);
+}
+
+static void ps_uv_wide(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 rgb;
+	sample_wide(uni, in, &rgb);
+	vec4_set(out, dot_color(&uni->color_vec[1], &rgb), dot_color(&uni->color_vec[2], &rgb), 0.0f, 1.0f);
+}
+
+static void ps_u_wide(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 rgb;
+	sample_wide(uni, in, &rgb);
+	vec4_set(out, dot_color(&uni->color_vec[1], &rgb), 0.0f, 0.0f, 1.0f);
+}
+
+static void ps_v_wide(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 rgb;
+	sample_wide(uni, in, &rgb);
+	vec4_set(out, dot_color(&uni->color_vec[2], &rgb), 0.0f, 0.0f, 1.0f);
+}
+
+/* ------------------------------------------------------------------------- */
+/* pixel kernels: format_conversion.effect, 8-bit SDR *_Reverse techniques   */
+
+static inline void load_plane(const struct null_uniforms *uni, size_t plane, const struct vec4 *pos, struct vec4 *out)
+{
+	null_texture_load(uni->planes[plane], (int)pos->x, (int)pos->y, uni->planes_srgb[plane], out);
+}
+
+static inline void sample_plane(const struct null_uniforms *uni, size_t plane, float u, float v, struct vec4 *out)
+{
+	null_texture_sample(uni->planes[plane], uni->plane_samplers[plane], u, v, uni->planes_srgb[plane], out);
+}
+
+static inline void yuv_to_rgb(const struct null_uniforms *uni, float y, float cb, float cr, float alpha,
+			      struct vec4 *out)
+{
+	struct vec4 yuv;
+
+	vec4_set(&yuv, y, cb, cr, 0.0f);
+	yuv.x = fminf(fmaxf(yuv.x, uni->color_range_min.x), uni->color_range_max.x);
+	yuv.y = fminf(fmaxf(yuv.y, uni->color_range_min.y), uni->color_range_max.y);
+	yuv.z = fminf(fmaxf(yuv.z, uni->color_range_min.z), uni->color_range_max.z);
+
+	vec4_set(out, dot_color(&uni->color_vec[0], &yuv), dot_color(&uni->color_vec[1], &yuv),
+		 dot_color(&uni->color_vec[2], &yuv), alpha);
+}
+
+/* packed 4:2:2 is uploaded as a half width BGRA texture, the indices select
+ * the channels holding the two luma samples and the chroma pair */
+static inline void packed422_reverse(const struct null_uniforms *uni, const struct null_varyings *in, int y0, int y1,
+				     int cb, int cr, struct vec4 *out)
+{
+	struct vec4 y01, cbcr;
+	float leftover = in->v[0] - floorf(in->v[0]);
+
+	null_texture_load(uni->image, (int)in->v[0], (int)in->v[1], uni->image_srgb, &y01);
+	sample_image(uni, in->v[2], in->v[3], &cbcr);
+
+	yuv_to_rgb(uni, leftover < 0.5f ? y01.ptr[y0] : y01.ptr[y1], cbcr.ptr[cb], cbcr.ptr[cr], 1.0f, out);
+}
+
+static void ps_uyvy_reverse(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	packed422_reverse(uni, in, 1, 3, 2, 0, out);
+}
+
+static void ps_yuy2_reverse(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	packed422_reverse(uni, in, 2, 0, 1, 3, out);
+}
+
+static void ps_yvyu_reverse(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	packed422_reverse(uni, in, 2, 0, 3, 1, out);
+}
+
+static void ps_planar_subsampled_reverse(const struct null_uniforms *uni, const struct null_varyings *in,
+					 struct vec4 *out)
+{
+	struct vec4 y, cb, cr;
+
+	load_image(uni, &in->pos, &y);
+	sample_plane(uni, 0, in->v[0], in->v[1], &cb);
+	sample_plane(uni, 1, in->v[0], in->v[1], &cr);
+	yuv_to_rgb(uni, y.x, cb.x, cr.x, 1.0f, out);
+}
+
+static void ps_planar_subsampled_alpha_reverse(const struct null_uniforms *uni, const struct null_varyings *in,
+					       struct vec4 *out)
+{
+	struct vec4 alpha;
+
+	ps_planar_subsampled_reverse(uni, in, out);
+	load_plane(uni, 2, &in->pos, &alpha);
+	out->w = alpha.x;
+}
+
+static void ps_planar444_reverse(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 y, cb, cr;
+
+	load_image(uni, &in->pos, &y);
+	load_plane(uni, 0, &in->pos, &cb);
+	load_plane(uni, 1, &in->pos, &cr);
+	yuv_to_rgb(uni, y.x, cb.x, cr.x, 1.0f, out);
+}
+
+static void ps_planar444a_reverse(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 alpha;
+
+	ps_planar444_reverse(uni, in, out);
+	load_plane(uni, 2, &in->pos, &alpha);
+	out->w = alpha.x;
+}
+
+static void ps_ayuv_reverse(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 yuva;
+
+	load_image(uni, &in->pos, &yuva);
+	yuv_to_rgb(uni, yuva.x, yuva.y, yuva.z, yuva.w, out);
+}
+
+static void ps_nv12_reverse(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 y, cbcr;
+
+	load_image(uni, &in->pos, &y);
+	sample_plane(uni, 0, in->v[0], in->v[1], &cbcr);
+	yuv_to_rgb(uni, y.x, cbcr.x, cbcr.y, 1.0f, out);
+}
+
+static inline float expand_limited(float limited)
+{
+	return (255.0f / 219.0f) * limited - (16.0f / 219.0f);
+}
+
+static void ps_y800_limited(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 y;
+	float full;
+
+	load_image(uni, &in->pos, &y);
+	full = expand_limited(y.x);
+	vec4_set(out, full, full, full, 1.0f);
+}
+
+static void ps_y800_full(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 y;
+
+	load_image(uni, &in->pos, &y);
+	vec4_set(out, y.x, y.x, y.x, 1.0f);
+}
+
+static void ps_rgb_limited(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	load_image(uni, &in->pos, out);
+	out->x = expand_limited(out->x);
+	out->y = expand_limited(out->y);
+	out->z = expand_limited(out->z);
+}
+
+/* BGR3 is uploaded as an R8 texture three times as wide as the frame */
+static inline void load_bgr3(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	struct vec4 b, g, r;
+	float x = in->pos.x * 3.0f;
+	int y = (int)in->pos.y;
+
+	null_texture_load(uni->image, (int)(x - 1.0f), y, uni->image_srgb, &b);
+	null_texture_load(uni->image, (int)x, y, uni->image_srgb, &g);
+	null_texture_load(uni->image, (int)(x + 1.0f), y, uni->image_srgb, &r);
+	vec4_set(out, r.x, g.x, b.x, 1.0f);
+}
+
+static void ps_bgr3_limited(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	load_bgr3(uni, in, out);
+	out->x = expand_limited(out->x);
+	out->y = expand_limited(out->y);
+	out->z = expand_limited(out->z);
+}
+
+static void ps_bgr3_full(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out)
+{
+	load_bgr3(uni, in, out);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct vs_kernel_info {
+	const char *effect;
+	const char *name;
+	null_vs_kernel_t kernel;
+	size_t num_varyings;
+};
+
+struct ps_kernel_info {
+	const char *effect;
+	const char *name;
+	null_ps_kernel_t kernel;
+};
+
+static const struct vs_kernel_info vs_kernels[] = {
+	{"default.effect", "VSDefault", vs_default, 2},
+	{"opaque.effect", "VSDefault", vs_default, 2},
+	{"solid.effect", "VSSolid", vs_solid, 0},
+	{"solid.effect", "VSSolidColored", vs_solid_colored, 4},
+	{"format_conversion.effect", "VSPos", vs_pos, 0},
+	{"format_conversion.effect", "VSTexPos_Left", vs_tex_pos_left, 3},
+	{"format_conversion.effect", "VSPacked422Left_Reverse", vs_packed422_left_reverse, 4},
+	{"format_conversion.effect", "VS420Left_Reverse", vs_chroma_left_reverse, 2},
+	{"format_conversion.effect", "VS422Left_Reverse", vs_chroma_left_reverse, 2},
+};
+
+static const struct ps_kernel_info ps_kernels[] = {
+	{"default.effect", "PSDrawBare", ps_draw_bare},
+	{"default.effect", "PSDrawAlphaDivide", ps_draw_alpha_divide},
+	{"default.effect", "PSDrawMultiply", ps_draw_multiply},
+	{"default.effect", "PSDrawSrgbDecompress", ps_draw_srgb_decompress},
+	{"default.effect", "PSDrawSrgbDecompressMultiply", ps_draw_srgb_decompress_multiply},
+	{"default.effect", "PSDrawNonlinearAlpha", ps_draw_nonlinear_alpha},
+	{"default.effect", "PSDrawNonlinearAlphaMultiply", ps_draw_nonlinear_alpha_multiply},
+	{"opaque.effect", "PSDraw", ps_draw_opaque},
+	{"opaque.effect", "PSDrawMultiply", ps_draw_opaque_multiply},
+	{"opaque.effect", "PSDrawSrgbDecompress", ps_draw_opaque_srgb_decompress},
+	{"opaque.effect", "PSDrawSrgbDecompressMultiply", ps_draw_opaque_srgb_decompress_multiply},
+	{"solid.effect", "PSSolid", ps_solid},
+	{"solid.effect", "PSSolidColored", ps_solid_colored},
+	{"format_conversion.effect", "PS_Y", ps_y},
+	{"format_conversion.effect", "PS_U", ps_u},
+	{"format_conversion.effect", "PS_V", ps_v},
+	{"format_conversion.effect", "PS_UV_Wide", ps_uv_wide},
+	{"format_conversion.effect", "PS_U_Wide", ps_u_wide},
+	{"format_conversion.effect", "PS_V_Wide", ps_v_wide},
+	{"format_conversion.effect", "PSUYVY_Reverse", ps_uyvy_reverse},
+	{"format_conversion.effect", "PSYUY2_Reverse", ps_yuy2_reverse},
+	{"format_conversion.effect", "PSYVYU_Reverse", ps_yvyu_reverse},
+	{"format_conversion.effect", "PSPlanar420_Reverse", ps_planar_subsampled_reverse},
+	{"format_conversion.effect", "PSPlanar420A_Reverse", ps_planar_subsampled_alpha_reverse},
+	{"format_conversion.effect", "PSPlanar422_Reverse", ps_planar_subsampled_reverse},
+	{"format_conversion.effect", "PSPlanar422A_Reverse", ps_planar_subsampled_alpha_reverse},
+	{"format_conversion.effect", "PSPlanar444_Reverse", ps_planar444_reverse},
+	{"format_conversion.effect", "PSPlanar444A_Reverse", ps_planar444a_reverse},
+	{"format_conversion.effect", "PSAYUV_Reverse", ps_ayuv_reverse},
+	{"format_conversion.effect", "PSNV12_Reverse", ps_nv12_reverse},
+	{"format_conversion.effect", "PSY800_Limited", ps_y800_limited},
+	{"format_conversion.effect", "PSY800_Full", ps_y800_full},
+	{"format_conversion.effect", "PSRGB_Limited", ps_rgb_limited},
+	{"format_conversion.effect", "PSBGR3_Limited", ps_bgr3_limited},
+	{"format_conversion.effect", "PSBGR3_Full", ps_bgr3_full},
+};
+
+/* the effect location is "<path>/<file>.effect (... shader, technique ...)" */
+static bool effect_matches(const char *file, const char *effect)
+{
+	const char *found = strstr(file, effect);
+	if (!found)
+		return false;
+
+	return found == file || found[-1] == '/' || found[-1] == '\\';
+}
+
+null_vs_kernel_t null_find_vs_kernel(const char *file, const char *name, size_t *num_varyings)
+{
+	for (size_t i = 0; i < sizeof(vs_kernels) / sizeof(vs_kernels[0]); i++) {
+		const struct vs_kernel_info *info = &vs_kernels[i];
+
+		if (strcmp(info->name, name) == 0 && effect_matches(file, info->effect)) {
+			*num_varyings = info->num_varyings;
+			return info->kernel;
+		}
+	}
+
+	return NULL;
+}
+
+null_ps_kernel_t null_find_ps_kernel(const char *file, const char *name)
+{
+	for (size_t i = 0; i < sizeof(ps_kernels) / sizeof(ps_kernels[0]); i++) {
+		const struct ps_kernel_info *info = &ps_kernels[i];
+
+		if (strcmp(info->name, name) == 0 && effect_matches(file, info->effect))
+			return info->kernel;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,407 @@
+#include <math.h>
+#include <util/bmem.h>
+#include <util/task.h>
+#include "null-subsystem.h"
+
+/* rows handed to each pool work item, and the smallest triangle (in bounding
+ * box pixels) worth splitting across the pool */
+#define BAND_ROWS 32
+#define MIN_PARALLEL_PIXELS (256 * 256)
+
+struct raster_vertex {
+	float x, y, z;
+	float inv_w;
+	float v[NULL_MAX_VARYINGS];
+};
+
+struct raster_target {
+	uint8_t *data;
+	uint32_t linesize;
+	uint32_t bytes_per_pixel;
+	enum gs_color_format format;
+	bool srgb;
+};
+
+struct raster_job {
+	const struct null_uniforms *uni;
+	const struct null_blend_state *blend;
+	const struct raster_target *target;
+	null_ps_kernel_t ps;
+	size_t num_varyings;
+
+	const struct raster_vertex *v[3];
+	float area;
+	bool top_left[3];
+
+	int min_x, max_x;
+	int min_y, max_y;
+};
+
+/* ------------------------------------------------------------------------- */
+/* blending                                                                  */
+
+static inline float blend_factor(enum gs_blend_type type, const struct vec4 *src, const struct vec4 *dst, int c)
+{
+	switch (type) {
+	case GS_BLEND_ZERO:
+		return 0.0f;
+	case GS_BLEND_ONE:
+		return 1.0f;
+	case GS_BLEND_SRCCOLOR:
+		return src->ptr[c];
+	case GS_BLEND_INVSRCCOLOR:
+		return 1.0f - src->ptr[c];
+	case GS_BLEND_SRCALPHA:
+		return src->w;
+	case GS_BLEND_INVSRCALPHA:
+		return 1.0f - src->w;
+	case GS_BLEND_DSTCOLOR:
+		return dst->ptr[c];
+	case GS_BLEND_INVDSTCOLOR:
+		return 1.0f - dst->ptr[c];
+	case GS_BLEND_DSTALPHA:
+		return dst->w;
+	case GS_BLEND_INVDSTALPHA:
+		return 1.0f - dst->w;
+	case GS_BLEND_SRCALPHASAT:
+		if (c == 3)
+			return 1.0f;
+		return fminf(src->w, 1.0f - dst->w);
+	}
+
+	return 1.0f;
+}
+
+static inline float blend_op(enum gs_blend_op_type op, float s, float d)
+{
+	switch (op) {
+	case GS_BLEND_OP_ADD:
+		return s + d;
+	case GS_BLEND_OP_SUBTRACT:
+		return s - d;
+	case GS_BLEND_OP_REVERSE_SUBTRACT:
+		return d - s;
+	case GS_BLEND_OP_MIN:
+		return fminf(s, d);
+	case GS_BLEND_OP_MAX:
+		return fmaxf(s, d);
+	}
+
+	return s + d;
+}
+
+static void write_pixel(const struct raster_job *job, uint8_t *ptr, struct vec4 *src)
+{
+	const struct null_blend_state *blend = job->blend;
+	const struct raster_target *target = job->target;
+	bool write_all = blend->write_mask[0] && blend->write_mask[1] && blend->write_mask[2] && blend->write_mask[3];
+	struct vec4 dst;
+
+	if (!blend->enabled && write_all) {
+		null_write_texel(target->format, ptr, target->srgb, src);
+		return;
+	}
+
+	null_read_texel(target->format, ptr, target->srgb, &dst);
+
+	if (blend->enabled) {
+		struct vec4 out;
+
+		for (int c = 0; c < 4; c++) {
+			enum gs_blend_type sf = c == 3 ? blend->src_a : blend->src_c;
+			enum gs_blend_type df = c == 3 ? blend->dest_a : blend->dest_c;
+			float s = src->ptr[c] * blend_factor(sf, src, &dst, c);
+			float d = dst.ptr[c] * blend_factor(df, src, &dst, c);
+
+			/* min/max ignore the blend factors */
+			if (blend->op == GS_BLEND_OP_MIN || blend->op == GS_BLEND_OP_MAX)
+				out.ptr[c] = blend_op(blend->op, src->ptr[c], dst.ptr[c]);
+			else
+				out.ptr[c] = blend_op(blend->op, s, d);
+		}
+
+		*src = out;
+	}
+
+	for (int c = 0; c < 4; c++) {
+		if (!blend->write_mask[c])
+			src->ptr[c] = dst.ptr[c];
+	}
+
+	null_write_texel(target->format, ptr, target->srgb, src);
+}
+
+/* ------------------------------------------------------------------------- */
+/* triangle setup / scan                                                     */
+
+static inline float edge(const struct raster_vertex *a, const struct raster_vertex *b, float x, float y)
+{
+	return (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+}
+
+/* top-left fill rule, oriented so that the inside of the triangle is
+ * positive for every edge */
+static inline bool is_top_left(const struct raster_vertex *a, const struct raster_vertex *b, float sign)
+{
+	float dx = (b->x - a->x) * sign;
+	float dy = (b->y - a->y) * sign;
+	return (dy == 0.0f && dx > 0.0f) || dy < 0.0f;
+}
+
+static inline bool inside(float w, bool top_left)
+{
+	return w > 0.0f || (w == 0.0f && top_left);
+}
+
+static void scan_rows(const struct raster_job *job, int y_start, int y_end)
+{
+	const struct raster_vertex *v0 = job->v[0];
+	const struct raster_vertex *v1 = job->v[1];
+	const struct raster_vertex *v2 = job->v[2];
+	const struct raster_target *target = job->target;
+	float inv_area = 1.0f / job->area;
+
+	/* per-pixel steps of the (area normalized) edge functions */
+	float a0 = -(v2->y - v1->y) * inv_area;
+	float a1 = -(v0->y - v2->y) * inv_area;
+	float a2 = -(v1->y - v0->y) * inv_area;
+
+	for (int y = y_start; y < y_end; y++) {
+		float py = (float)y + 0.5f;
+		float px = (float)job->min_x + 0.5f;
+		float b0 = edge(v1, v2, px, py) * inv_area;
+		float b1 = edge(v2, v0, px, py) * inv_area;
+		float b2 = edge(v0, v1, px, py) * inv_area;
+		uint8_t *row = target->data + (size_t)y * target->linesize;
+
+		for (int x = job->min_x; x <= job->max_x; x++, b0 += a0, b1 += a1, b2 += a2) {
+			struct null_varyings in;
+			struct vec4 color;
+			float p0, p1, p2, inv_w, w;
+
+			if (!inside(b0, job->top_left[0]) || !inside(b1, job->top_left[1]) ||
+			    !inside(b2, job->top_left[2]))
+				continue;
+
+			/* perspective correct interpolation */
+			p0 = b0 * v0->inv_w;
+			p1 = b1 * v1->inv_w;
+			p2 = b2 * v2->inv_w;
+			inv_w = p0 + p1 + p2;
+			w = inv_w != 0.0f ? 1.0f / inv_w : 0.0f;
+
+			for (size_t i = 0; i < job->num_varyings; i++)
+				in.v[i] = (p0 * v0->v[i] + p1 * v1->v[i] + p2 * v2->v[i]) * w;
+
+			vec4_set(&in.pos, (float)x + 0.5f, py, b0 * v0->z + b1 * v1->z + b2 * v2->z, w);
+
+			job->ps(job->uni, &in, &color);
+			write_pixel(job, row + (size_t)x * target->bytes_per_pixel, &color);
+		}
+	}
+}
+
+static void scan_band(void *param, size_t idx)
+{
+	const struct raster_job *job = param;
+	int y_start = job->min_y + (int)idx * BAND_ROWS;
+	int y_end = y_start + BAND_ROWS;
+
+	if (y_end > job->max_y + 1)
+		y_end = job->max_y + 1;
+
+	scan_rows(job, y_start, y_end);
+}
+
+static void draw_triangle(gs_device_t *device, struct raster_job *job, const struct gs_rect *clip,
+			  const struct raster_vertex *v0, const struct raster_vertex *v1, const struct raster_vertex *v2)
+{
+	float area = edge(v0, v1, v2->x, v2->y);
+	float sign;
+
+	if (area == 0.0f || !isfinite(area))
+		return;
+
+	/* screen space is y-down, so a positive area is clockwise (front) */
+	if (device->cur_cull_mode == GS_BACK && area < 0.0f)
+		return;
+	if (device->cur_cull_mode == GS_FRONT && area > 0.0f)
+		return;
+
+	sign = area > 0.0f ? 1.0f : -1.0f;
+
+	job->v[0] = v0;
+	job->v[1] = v1;
+	job->v[2] = v2;
+	job->area = area;
+	job->top_left[0] = is_top_left(v1, v2, sign);
+	job->top_left[1] = is_top_left(v2, v0, sign);
+	job->top_left[2] = is_top_left(v0, v1, sign);
+
+	job->min_x = (int)floorf(fminf(v0->x, fminf(v1->x, v2->x)));
+	job->max_x = (int)ceilf(fmaxf(v0->x, fmaxf(v1->x, v2->x)));
+	job->min_y = (int)floorf(fminf(v0->y, fminf(v1->y, v2->y)));
+	job->max_y = (int)ceilf(fmaxf(v0->y, fmaxf(v1->y, v2->y)));
+
+	if (job->min_x < clip->x)
+		job->min_x = clip->x;
+	if (job->min_y < clip->y)
+		job->min_y = clip->y;
+	if (job->max_x > clip->x + clip->cx - 1)
+		job->max_x = clip->x + clip->cx - 1;
+	if (job->max_y > clip->y + clip->cy - 1)
+		job->max_y = clip->y + clip->cy - 1;
+
+	if (job->min_x > job->max_x || job->min_y > job->max_y)
+		return;
+
+	int64_t pixels = (int64_t)(job->max_x - job->min_x + 1) * (job->max_y - job->min_y + 1);
+	if (device->raster_pool && pixels >= MIN_PARALLEL_PIXELS) {
+		size_t bands = (size_t)(job->max_y - job->min_y + BAND_ROWS) / BAND_ROWS;
+		os_work_pool_run(device->raster_pool, scan_band, job, bands);
+	} else {
+		scan_rows(job, job->min_y, job->max_y + 1);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void intersect_rect(struct gs_rect *dst, const struct gs_rect *rect)
+{
+	int x0 = dst->x > rect->x ? dst->x : rect->x;
+	int y0 = dst->y > rect->y ? dst->y : rect->y;
+	int x1 = dst->x + dst->cx < rect->x + rect->cx ? dst->x + dst->cx : rect->x + rect->cx;
+	int y1 = dst->y + dst->cy < rect->y + rect->cy ? dst->y + dst->cy : rect->y + rect->cy;
+
+	dst->x = x0;
+	dst->y = y0;
+	dst->cx = x1 > x0 ? x1 - x0 : 0;
+	dst->cy = y1 > y0 ? y1 - y0 : 0;
+}
+
+static void load_vertex(gs_device_t *device, uint32_t idx, struct null_vs_input *in)
+{
+	struct gs_vb_data *data = device->cur_vertex_buffer ? device->cur_vertex_buffer->data : NULL;
+
+	memset(in, 0, sizeof(*in));
+	in->id = idx;
+	vec4_set(&in->color, 1.0f, 1.0f, 1.0f, 1.0f);
+	in->pos.w = 1.0f;
+
+	if (!data || idx >= data->num)
+		return;
+
+	if (data->points)
+		vec4_set(&in->pos, data->points[idx].x, data->points[idx].y, data->points[idx].z, 1.0f);
+	if (data->colors)
+		vec4_from_rgba(&in->color, data->colors[idx]);
+	if (data->num_tex && data->tvarray[0].width >= 2) {
+		const float *uv = (const float *)data->tvarray[0].array + data->tvarray[0].width * idx;
+		vec2_set(&in->uv, uv[0], uv[1]);
+	}
+}
+
+static inline uint32_t get_index(const gs_indexbuffer_t *ib, uint32_t i)
+{
+	if (!ib)
+		return i;
+
+	return ib->type == GS_UNSIGNED_LONG ? ((const uint32_t *)ib->data)[i] : ((const uint16_t *)ib->data)[i];
+}
+
+void null_rasterize(gs_device_t *device, enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts)
+{
+	gs_shader_t *vs = device->cur_vertex_shader;
+	gs_shader_t *ps = device->cur_pixel_shader;
+	gs_indexbuffer_t *ib = device->cur_index_buffer;
+	gs_texture_t *tex = device->cur_render_target;
+	struct raster_vertex stack_verts[16];
+	struct raster_vertex *verts = stack_verts;
+	struct null_uniforms uni;
+	struct raster_target target;
+	struct raster_job job;
+	struct gs_rect clip;
+
+	if (draw_mode != GS_TRIS && draw_mode != GS_TRISTRIP)
+		return;
+
+	if (!vs->vs_kernel || !ps->ps_kernel) {
+		if (!device->warned_no_kernel) {
+			blog(LOG_WARNING, "null: skipping draws with unsupported shaders (first: %s/%s)",
+			     vs->entry ? vs->entry : "?", ps->entry ? ps->entry : "?");
+			device->warned_no_kernel = true;
+		}
+		return;
+	}
+
+	if (!tex && device->cur_swap)
+		tex = device->cur_swap->target;
+	if (!tex)
+		return;
+
+	if (num_verts == 0)
+		num_verts = ib ? (uint32_t)ib->num : (uint32_t)device->cur_vertex_buffer->data->num;
+	if (num_verts < 3)
+		return;
+
+	target.data = null_texture_get_plane(tex, device->cur_render_side);
+	target.linesize = tex->linesize;
+	target.bytes_per_pixel = tex->bytes_per_pixel;
+	target.format = tex->format;
+	target.srgb = device->framebuffer_srgb && gs_is_srgb_format(tex->format);
+
+	clip.x = 0;
+	clip.y = 0;
+	clip.cx = (int)tex->width;
+	clip.cy = (int)tex->height;
+	intersect_rect(&clip, &device->cur_viewport);
+	if (device->scissor_enabled)
+		intersect_rect(&clip, &device->cur_scissor);
+	if (!clip.cx || !clip.cy)
+		return;
+
+	null_shader_get_uniforms(device, &uni);
+
+	if (num_verts > sizeof(stack_verts) / sizeof(stack_verts[0]))
+		verts = bmalloc(sizeof(struct raster_vertex) * num_verts);
+
+	/* vertex stage + viewport transform */
+	const struct gs_rect *vp = &device->cur_viewport;
+	for (uint32_t i = 0; i < num_verts; i++) {
+		struct null_vs_input in;
+		struct null_varyings out = {0};
+		struct raster_vertex *rv = &verts[i];
+		float inv_w;
+
+		load_vertex(device, get_index(ib, start_vert + i), &in);
+		vs->vs_kernel(&uni, &in, &out);
+
+		inv_w = out.pos.w != 0.0f ? 1.0f / out.pos.w : 0.0f;
+		rv->x = (float)vp->x + (out.pos.x * inv_w * 0.5f + 0.5f) * (float)vp->cx;
+		rv->y = (float)vp->y + (0.5f - out.pos.y * inv_w * 0.5f) * (float)vp->cy;
+		rv->z = out.pos.z * inv_w;
+		rv->inv_w = inv_w;
+		memcpy(rv->v, out.v, sizeof(rv->v));
+	}
+
+	job.uni = &uni;
+	job.blend = &device->blend;
+	job.target = &target;
+	job.ps = ps->ps_kernel;
+	job.num_varyings = vs->num_varyings;
+
+	if (draw_mode == GS_TRIS) {
+		for (uint32_t i = 0; i + 2 < num_verts; i += 3)
+			draw_triangle(device, &job, &clip, &verts[i], &verts[i + 1], &verts[i + 2]);
+	} else {
+		for (uint32_t i = 0; i + 2 < num_verts; i++) {
+			if (i & 1)
+				draw_triangle(device, &job, &clip, &verts[i + 1], &verts[i], &verts[i + 2]);
+			else
+				draw_triangle(device, &job, &clip, &verts[i], &verts[i + 1], &verts[i + 2]);
+		}
+	}
+
+	if (verts != stack_verts)
+		bfree(verts);
+}
@@ -0,0 +1,405 @@
+#include <assert.h>
+
+#include <util/bmem.h>
+#include <graphics/shader-parser.h>
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+#include <graphics/vec4.h>
+#include <graphics/matrix3.h>
+#include <graphics/matrix4.h>
+#include "null-subsystem.h"
+
+static inline void shader_param_free(struct gs_shader_param *param)
+{
+	bfree(param->name);
+	da_free(param->cur_value);
+	da_free(param->def_value);
+}
+
+static void null_add_param(struct gs_shader *shader, struct shader_var *var)
+{
+	struct gs_shader_param param = {0};
+
+	param.array_count = var->array_count;
+	param.name = bstrdup(var->name);
+	param.shader = shader;
+	param.type = get_shader_param_type(var->type);
+
+	da_move(param.def_value, var->default_val);
+	da_copy(param.cur_value, param.def_value);
+
+	da_push_back(shader->params, &param);
+}
+
+static inline void null_add_params(struct gs_shader *shader, struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->params.num; i++)
+		null_add_param(shader, parser->params.array + i);
+
+	shader->viewproj = gs_shader_get_param_by_name(shader, "ViewProj");
+	shader->world = gs_shader_get_param_by_name(shader, "World");
+}
+
+static inline void null_add_samplers(struct gs_shader *shader, struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->samplers.num; i++) {
+		struct shader_sampler *sampler = parser->samplers.array + i;
+		gs_samplerstate_t *new_sampler;
+		struct gs_sampler_info info;
+
+		shader_sampler_convert(sampler, &info);
+		new_sampler = device_samplerstate_create(shader->device, &info);
+
+		da_push_back(shader->samplers, &new_sampler);
+	}
+}
+
+/* The effect parser always generates "main" as a single call to the
+ * technique's entry function: "return FUNC(args);" */
+static char *null_find_entry(struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->funcs.num; i++) {
+		struct shader_func *func = parser->funcs.array + i;
+		bool after_return = false;
+
+		if (strcmp(func->name, "main") != 0)
+			continue;
+
+		for (struct cf_token *token = func->start; token && token != func->end && token->type != CFTOKEN_NONE;
+		     token++) {
+			if (token->type != CFTOKEN_NAME)
+				continue;
+
+			if (after_return)
+				return bstrdup_n(token->str.array, token->str.len);
+			if (strref_cmp(&token->str, "return") == 0)
+				after_return = true;
+		}
+	}
+
+	return NULL;
+}
+
+static struct gs_shader *shader_create(gs_device_t *device, enum gs_shader_type type, const char *shader_str,
+				       const char *file, char **error_string)
+{
+	struct gs_shader *shader = bzalloc(sizeof(struct gs_shader));
+	struct shader_parser parser;
+	bool success;
+	char *errors;
+
+	shader->device = device;
+	shader->type = type;
+
+	shader_parser_init(&parser);
+	success = shader_parse(&parser, shader_str, file);
+
+	errors = shader_parser_geterrors(&parser);
+	if (errors) {
+		blog(LOG_WARNING, "Shader parser errors/warnings:\n%s\n", errors);
+		if (!success && error_string)
+			*error_string = errors;
+		else
+			bfree(errors);
+	}
+
+	if (success) {
+		null_add_params(shader, &parser);
+		null_add_samplers(shader, &parser);
+
+		shader->entry = null_find_entry(&parser);
+		if (shader->entry && file && type == GS_SHADER_VERTEX)
+			shader->vs_kernel = null_find_vs_kernel(file, shader->entry, &shader->num_varyings);
+		else if (shader->entry && file)
+			shader->ps_kernel = null_find_ps_kernel(file, shader->entry);
+
+		if (!shader->vs_kernel && !shader->ps_kernel)
+			blog(LOG_DEBUG, "null: no software kernel for '%s' in %s, draws using it will be skipped",
+			     shader->entry ? shader->entry : "(unknown)", file ? file : "(unknown)");
+	}
+
+	shader_parser_free(&parser);
+
+	if (!success) {
+		gs_shader_destroy(shader);
+		shader = NULL;
+	}
+
+	return shader;
+}
+
+gs_shader_t *device_vertexshader_create(gs_device_t *device, const char *shader, const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_VERTEX, shader, file, error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_vertexshader_create (null) failed");
+	return ptr;
+}
+
+gs_shader_t *device_pixelshader_create(gs_device_t *device, const char *shader, const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_PIXEL, shader, file, error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_pixelshader_create (null) failed");
+	return ptr;
+}
+
+void gs_shader_destroy(gs_shader_t *shader)
+{
+	size_t i;
+
+	if (!shader)
+		return;
+
+	if (shader->device->cur_vertex_shader == shader)
+		shader->device->cur_vertex_shader = NULL;
+	if (shader->device->cur_pixel_shader == shader)
+		shader->device->cur_pixel_shader = NULL;
+
+	for (i = 0; i < shader->samplers.num; i++)
+		gs_samplerstate_destroy(shader->samplers.array[i]);
+
+	for (i = 0; i < shader->params.num; i++)
+		shader_param_free(shader->params.array + i);
+
+	da_free(shader->samplers);
+	da_free(shader->params);
+	bfree(shader->entry);
+	bfree(shader);
+}
+
+int gs_shader_get_num_params(const gs_shader_t *shader)
+{
+	return (int)shader->params.num;
+}
+
+gs_sparam_t *gs_shader_get_param_by_idx(gs_shader_t *shader, uint32_t param)
+{
+	assert(param < shader->params.num);
+	return shader->params.array + param;
+}
+
+gs_sparam_t *gs_shader_get_param_by_name(gs_shader_t *shader, const char *name)
+{
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+
+		if (strcmp(param->name, name) == 0)
+			return param;
+	}
+
+	return NULL;
+}
+
+gs_sparam_t *gs_shader_get_viewproj_matrix(const gs_shader_t *shader)
+{
+	return shader->viewproj;
+}
+
+gs_sparam_t *gs_shader_get_world_matrix(const gs_shader_t *shader)
+{
+	return shader->world;
+}
+
+void gs_shader_get_param_info(const gs_sparam_t *param, struct gs_shader_param_info *info)
+{
+	info->type = param->type;
+	info->name = param->name;
+}
+
+void gs_shader_set_bool(gs_sparam_t *param, bool val)
+{
+	int int_val = val;
+	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+}
+
+void gs_shader_set_float(gs_sparam_t *param, float val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_int(gs_sparam_t *param, int val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
+{
+	struct matrix4 mat;
+	matrix4_from_matrix3(&mat, val);
+
+	da_copy_array(param->cur_value, &mat, sizeof(mat));
+}
+
+void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
+{
+	da_copy_array(param->cur_value, val, sizeof(*val));
+}
+
+void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(float) * 3);
+}
+
+void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
+{
+	param->texture = val;
+}
+
+void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
+{
+	int count = param->array_count;
+	size_t expected_size = 0;
+	if (!count)
+		count = 1;
+
+	switch (param->type) {
+	case GS_SHADER_PARAM_FLOAT:
+		expected_size = sizeof(float);
+		break;
+	case GS_SHADER_PARAM_BOOL:
+	case GS_SHADER_PARAM_INT:
+		expected_size = sizeof(int);
+		break;
+	case GS_SHADER_PARAM_INT2:
+		expected_size = sizeof(int) * 2;
+		break;
+	case GS_SHADER_PARAM_INT3:
+		expected_size = sizeof(int) * 3;
+		break;
+	case GS_SHADER_PARAM_INT4:
+		expected_size = sizeof(int) * 4;
+		break;
+	case GS_SHADER_PARAM_VEC2:
+		expected_size = sizeof(float) * 2;
+		break;
+	case GS_SHADER_PARAM_VEC3:
+		expected_size = sizeof(float) * 3;
+		break;
+	case GS_SHADER_PARAM_VEC4:
+		expected_size = sizeof(float) * 4;
+		break;
+	case GS_SHADER_PARAM_MATRIX4X4:
+		expected_size = sizeof(float) * 4 * 4;
+		break;
+	case GS_SHADER_PARAM_TEXTURE:
+		expected_size = sizeof(struct gs_shader_texture);
+		break;
+	default:
+		expected_size = 0;
+	}
+
+	expected_size *= count;
+	if (!expected_size)
+		return;
+
+	if (expected_size != size) {
+		blog(LOG_ERROR, "gs_shader_set_val (null): Size of shader "
+				"param does not match the size of the input");
+		return;
+	}
+
+	if (param->type == GS_SHADER_PARAM_TEXTURE) {
+		struct gs_shader_texture shader_tex;
+		memcpy(&shader_tex, val, sizeof(shader_tex));
+		gs_shader_set_texture(param, shader_tex.tex);
+		param->srgb = shader_tex.srgb;
+	} else {
+		da_copy_array(param->cur_value, val, size);
+	}
+}
+
+void gs_shader_set_default(gs_sparam_t *param)
+{
+	gs_shader_set_val(param, param->def_value.array, param->def_value.num);
+}
+
+void gs_shader_set_next_sampler(gs_sparam_t *param, gs_samplerstate_t *sampler)
+{
+	param->next_sampler = sampler;
+}
+
+/* ------------------------------------------------------------------------- */
+/* uniform gathering                                                         */
+
+static struct gs_shader_param *find_param(const gs_device_t *device, const char *name)
+{
+	struct gs_shader_param *param = NULL;
+
+	if (device->cur_pixel_shader)
+		param = gs_shader_get_param_by_name(device->cur_pixel_shader, name);
+	if (!param && device->cur_vertex_shader)
+		param = gs_shader_get_param_by_name(device->cur_vertex_shader, name);
+
+	return param;
+}
+
+static void get_value(const gs_device_t *device, const char *name, void *out, size_t size)
+{
+	struct gs_shader_param *param = find_param(device, name);
+
+	if (param && param->cur_value.num >= size)
+		memcpy(out, param->cur_value.array, size);
+}
+
+static void get_texture(const gs_device_t *device, const char *name, gs_texture_t **tex,
+			const struct gs_sampler_info **sampler, bool *srgb)
+{
+	struct gs_shader_param *param = find_param(device, name);
+
+	if (param) {
+		gs_shader_t *shader = param->shader;
+
+		*tex = param->texture;
+		*srgb = param->srgb;
+
+		if (param->next_sampler)
+			*sampler = &param->next_sampler->info;
+		else if (shader->samplers.num)
+			*sampler = &shader->samplers.array[0]->info;
+		else if (device->cur_samplers[0])
+			*sampler = &device->cur_samplers[0]->info;
+	}
+
+	if (!*sampler)
+		*sampler = &device->default_sampler;
+}
+
+void null_shader_get_uniforms(const gs_device_t *device, struct null_uniforms *uni)
+{
+	static const char *plane_names[] = {"image1", "image2", "image3"};
+
+	memset(uni, 0, sizeof(*uni));
+	matrix4_copy(&uni->viewproj, &device->cur_viewproj);
+	vec4_set(&uni->color, 1.0f, 1.0f, 1.0f, 1.0f);
+	vec3_set(&uni->color_range_max, 1.0f, 1.0f, 1.0f);
+	uni->multiplier = 1.0f;
+
+	get_value(device, "color", &uni->color, sizeof(uni->color));
+	get_value(device, "color_vec0", &uni->color_vec[0], sizeof(uni->color_vec[0]));
+	get_value(device, "color_vec1", &uni->color_vec[1], sizeof(uni->color_vec[1]));
+	get_value(device, "color_vec2", &uni->color_vec[2], sizeof(uni->color_vec[2]));
+	get_value(device, "multiplier", &uni->multiplier, sizeof(uni->multiplier));
+	get_value(device, "width_i", &uni->width_i, sizeof(uni->width_i));
+	get_value(device, "width_d2", &uni->width_d2, sizeof(uni->width_d2));
+	get_value(device, "height", &uni->height, sizeof(uni->height));
+	get_value(device, "width_x2_i", &uni->width_x2_i, sizeof(uni->width_x2_i));
+	get_value(device, "color_range_min", uni->color_range_min.ptr, sizeof(float) * 3);
+	get_value(device, "color_range_max", uni->color_range_max.ptr, sizeof(float) * 3);
+
+	get_texture(device, "image", &uni->image, &uni->image_sampler, &uni->image_srgb);
+	for (size_t i = 0; i < 3; i++)
+		get_texture(device, plane_names[i], &uni->planes[i], &uni->plane_samplers[i], &uni->planes_srgb[i]);
+}
@@ -0,0 +1,743 @@
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <graphics/matrix3.h>
+#include "null-subsystem.h"
+
+const char *device_get_name(void)
+{
+	return "Null";
+}
+
+int device_get_type(void)
+{
+	return GS_DEVICE_NULL;
+}
+
+const char *device_preprocessor_name(void)
+{
+	return "_NULL";
+}
+
+const char *gpu_get_renderer(void)
+{
+	return "libobs software rasterizer";
+}
+
+static inline void init_raster_pool(struct gs_device *device)
+{
+	int cores = os_get_logical_cores();
+	size_t num_threads = cores > 1 ? (size_t)cores - 1 : 0;
+
+	if (num_threads > 8)
+		num_threads = 8;
+
+	if (num_threads)
+		device->raster_pool = os_work_pool_create(num_threads);
+}
+
+int device_create(gs_device_t **p_device, uint32_t adapter)
+{
+	struct gs_device *device = bzalloc(sizeof(struct gs_device));
+
+	UNUSED_PARAMETER(adapter);
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Initializing null (software) graphics...");
+
+	init_raster_pool(device);
+
+	device->default_sampler.filter = GS_FILTER_LINEAR;
+	device->default_sampler.address_u = GS_ADDRESS_CLAMP;
+	device->default_sampler.address_v = GS_ADDRESS_CLAMP;
+	device->default_sampler.address_w = GS_ADDRESS_CLAMP;
+	device->default_sampler.max_anisotropy = 1;
+
+	device->cur_cull_mode = GS_NEITHER;
+	device->blend.enabled = true;
+	device->blend.src_c = GS_BLEND_SRCALPHA;
+	device->blend.dest_c = GS_BLEND_INVSRCALPHA;
+	device->blend.src_a = GS_BLEND_ONE;
+	device->blend.dest_a = GS_BLEND_INVSRCALPHA;
+	device->blend.op = GS_BLEND_OP_ADD;
+	for (int i = 0; i < 4; i++)
+		device->blend.write_mask[i] = true;
+
+	matrix4_identity(&device->cur_proj);
+	matrix4_identity(&device->cur_view);
+	matrix4_identity(&device->cur_viewproj);
+
+	blog(LOG_INFO, "Null graphics loaded successfully, %zu raster threads",
+	     device->raster_pool ? os_work_pool_num_threads(device->raster_pool) + 1 : 1);
+
+	*p_device = device;
+	return GS_SUCCESS;
+}
+
+void device_destroy(gs_device_t *device)
+{
+	if (device) {
+		os_work_pool_destroy(device->raster_pool);
+		da_free(device->proj_stack);
+		bfree(device);
+	}
+}
+
+void device_enter_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_leave_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void *device_get_device_obj(gs_device_t *device)
+{
+	return device;
+}
+
+/* ------------------------------------------------------------------------- */
+/* swap chains: offscreen targets, nothing is ever presented                 */
+
+gs_swapchain_t *device_swapchain_create(gs_device_t *device, const struct gs_init_data *info)
+{
+	struct gs_swap_chain *swap = bzalloc(sizeof(struct gs_swap_chain));
+	enum gs_color_format format = info->format != GS_UNKNOWN ? info->format : GS_BGRA;
+
+	swap->device = device;
+	swap->info = *info;
+	swap->target = device_texture_create(device, info->cx, info->cy, format, 1, NULL, GS_RENDER_TARGET);
+	return swap;
+}
+
+void gs_swapchain_destroy(gs_swapchain_t *swapchain)
+{
+	if (!swapchain)
+		return;
+
+	if (swapchain->device->cur_swap == swapchain)
+		swapchain->device->cur_swap = NULL;
+
+	gs_texture_destroy(swapchain->target);
+	bfree(swapchain);
+}
+
+void device_resize(gs_device_t *device, uint32_t cx, uint32_t cy)
+{
+	struct gs_swap_chain *swap = device->cur_swap;
+
+	if (!swap) {
+		blog(LOG_WARNING, "device_resize (null): No active swap");
+		return;
+	}
+
+	if (swap->info.cx == cx && swap->info.cy == cy)
+		return;
+
+	gs_texture_destroy(swap->target);
+	swap->info.cx = cx;
+	swap->info.cy = cy;
+	swap->target =
+		device_texture_create(device, cx, cy, swap->info.format != GS_UNKNOWN ? swap->info.format : GS_BGRA, 1,
+				      NULL, GS_RENDER_TARGET);
+}
+
+enum gs_color_space device_get_color_space(gs_device_t *device)
+{
+	return device->cur_color_space;
+}
+
+void device_update_color_space(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_get_size(const gs_device_t *device, uint32_t *cx, uint32_t *cy)
+{
+	if (device->cur_swap) {
+		*cx = device->cur_swap->info.cx;
+		*cy = device->cur_swap->info.cy;
+	} else {
+		blog(LOG_ERROR, "device_get_size (null): No active swap");
+		*cx = 0;
+		*cy = 0;
+	}
+}
+
+uint32_t device_get_width(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cx;
+	} else {
+		blog(LOG_ERROR, "device_get_width (null): No active swap");
+		return 0;
+	}
+}
+
+uint32_t device_get_height(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cy;
+	} else {
+		blog(LOG_ERROR, "device_get_height (null): No active swap");
+		return 0;
+	}
+}
+
+void device_load_swapchain(gs_device_t *device, gs_swapchain_t *swapchain)
+{
+	device->cur_swap = swapchain;
+}
+
+bool device_is_present_ready(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return true;
+}
+
+void device_present(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_flush(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+/* ------------------------------------------------------------------------- */
+/* pipeline state                                                            */
+
+void device_load_vertexbuffer(gs_device_t *device, gs_vertbuffer_t *vertbuffer)
+{
+	device->cur_vertex_buffer = vertbuffer;
+}
+
+void device_load_indexbuffer(gs_device_t *device, gs_indexbuffer_t *indexbuffer)
+{
+	device->cur_index_buffer = indexbuffer;
+}
+
+void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	if (unit >= 0 && unit < GS_MAX_TEXTURES)
+		device->cur_textures[unit] = tex;
+}
+
+void device_load_samplerstate(gs_device_t *device, gs_samplerstate_t *samplerstate, int unit)
+{
+	if (unit >= 0 && unit < GS_MAX_TEXTURES)
+		device->cur_samplers[unit] = samplerstate;
+}
+
+void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
+{
+	if (vertshader && vertshader->type != GS_SHADER_VERTEX) {
+		blog(LOG_ERROR, "Specified shader is not a vertex shader");
+		blog(LOG_ERROR, "device_load_vertexshader (null) failed");
+		return;
+	}
+
+	device->cur_vertex_shader = vertshader;
+}
+
+void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
+{
+	if (pixelshader && pixelshader->type != GS_SHADER_PIXEL) {
+		blog(LOG_ERROR, "Specified shader is not a pixel shader");
+		blog(LOG_ERROR, "device_load_pixelshader (null) failed");
+		return;
+	}
+
+	device->cur_pixel_shader = pixelshader;
+}
+
+void device_load_default_samplerstate(gs_device_t *device, bool b_3d, int unit)
+{
+	UNUSED_PARAMETER(b_3d);
+
+	/* an unset unit samples with device->default_sampler */
+	if (unit >= 0 && unit < GS_MAX_TEXTURES)
+		device->cur_samplers[unit] = NULL;
+}
+
+gs_shader_t *device_get_vertex_shader(const gs_device_t *device)
+{
+	return device->cur_vertex_shader;
+}
+
+gs_shader_t *device_get_pixel_shader(const gs_device_t *device)
+{
+	return device->cur_pixel_shader;
+}
+
+gs_texture_t *device_get_render_target(const gs_device_t *device)
+{
+	return device->cur_render_target;
+}
+
+gs_zstencil_t *device_get_zstencil_target(const gs_device_t *device)
+{
+	return device->cur_zstencil_buffer;
+}
+
+void device_set_render_target_with_color_space(gs_device_t *device, gs_texture_t *tex, gs_zstencil_t *zstencil,
+					       enum gs_color_space space)
+{
+	if (tex && tex->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_set_render_target (null): texture is not a 2D texture");
+		return;
+	}
+
+	if (tex && !tex->is_render_target) {
+		blog(LOG_ERROR, "device_set_render_target (null): texture is not a render target");
+		return;
+	}
+
+	device->cur_render_target = tex;
+	device->cur_render_side = 0;
+	device->cur_zstencil_buffer = zstencil;
+	device->cur_color_space = space;
+}
+
+void device_set_render_target(gs_device_t *device, gs_texture_t *tex, gs_zstencil_t *zstencil)
+{
+	device_set_render_target_with_color_space(device, tex, zstencil, GS_CS_SRGB);
+}
+
+void device_set_cube_render_target(gs_device_t *device, gs_texture_t *cubetex, int side, gs_zstencil_t *zstencil)
+{
+	if (cubetex && cubetex->type != GS_TEXTURE_CUBE) {
+		blog(LOG_ERROR, "device_set_cube_render_target (null): texture is not a cube texture");
+		return;
+	}
+
+	if (cubetex && !cubetex->is_render_target) {
+		blog(LOG_ERROR, "device_set_cube_render_target (null): texture is not a render target");
+		return;
+	}
+
+	device->cur_render_target = cubetex;
+	device->cur_render_side = side;
+	device->cur_zstencil_buffer = zstencil;
+	device->cur_color_space = GS_CS_SRGB;
+}
+
+void device_enable_framebuffer_srgb(gs_device_t *device, bool enable)
+{
+	device->framebuffer_srgb = enable;
+}
+
+bool device_framebuffer_srgb_enabled(gs_device_t *device)
+{
+	return device->framebuffer_srgb;
+}
+
+void device_begin_frame(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_begin_scene(gs_device_t *device)
+{
+	for (int i = 0; i < GS_MAX_TEXTURES; i++)
+		device->cur_textures[i] = NULL;
+}
+
+void device_end_scene(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+static inline void update_viewproj_matrix(struct gs_device *device)
+{
+	struct gs_shader *vs = device->cur_vertex_shader;
+
+	gs_matrix_get(&device->cur_view);
+	matrix4_mul(&device->cur_viewproj, &device->cur_view, &device->cur_proj);
+
+	if (vs->viewproj)
+		gs_shader_set_matrix4(vs->viewproj, &device->cur_viewproj);
+}
+
+void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts)
+{
+	gs_effect_t *effect = gs_get_effect();
+
+	if (!device->cur_vertex_shader) {
+		blog(LOG_ERROR, "No vertex shader specified");
+		goto fail;
+	}
+
+	if (!device->cur_pixel_shader) {
+		blog(LOG_ERROR, "No pixel shader specified");
+		goto fail;
+	}
+
+	if (!device->cur_vertex_buffer && !device->cur_index_buffer && num_verts == 0) {
+		blog(LOG_ERROR, "No vertex buffer specified");
+		goto fail;
+	}
+
+	if (!device->cur_render_target && !device->cur_swap) {
+		blog(LOG_ERROR, "No active swap chain or render target");
+		goto fail;
+	}
+
+	if (effect)
+		gs_effect_update_params(effect);
+
+	update_viewproj_matrix(device);
+	null_rasterize(device, draw_mode, start_vert, num_verts);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_draw (null) failed");
+}
+
+void device_clear(gs_device_t *device, uint32_t clear_flags, const struct vec4 *color, float depth, uint8_t stencil)
+{
+	gs_texture_t *tex = device->cur_render_target;
+	uint8_t *plane;
+	uint8_t texel[16];
+	size_t row_size;
+	bool srgb;
+
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+
+	if ((clear_flags & GS_CLEAR_COLOR) == 0)
+		return;
+
+	if (!tex && device->cur_swap)
+		tex = device->cur_swap->target;
+	if (!tex)
+		return;
+
+	srgb = device->framebuffer_srgb && gs_is_srgb_format(tex->format);
+	plane = null_texture_get_plane(tex, device->cur_render_side);
+	row_size = (size_t)tex->width * tex->bytes_per_pixel;
+
+	null_write_texel(tex->format, texel, srgb, color);
+	for (uint32_t x = 0; x < tex->width; x++)
+		memcpy(plane + (size_t)x * tex->bytes_per_pixel, texel, tex->bytes_per_pixel);
+	for (uint32_t y = 1; y < tex->height; y++)
+		memcpy(plane + (size_t)y * tex->linesize, plane, row_size);
+}
+
+void device_set_cull_mode(gs_device_t *device, enum gs_cull_mode mode)
+{
+	device->cur_cull_mode = mode;
+}
+
+enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
+{
+	return device->cur_cull_mode;
+}
+
+void device_enable_blending(gs_device_t *device, bool enable)
+{
+	device->blend.enabled = enable;
+}
+
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_write(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_color(gs_device_t *device, bool red, bool green, bool blue, bool alpha)
+{
+	device->blend.write_mask[0] = red;
+	device->blend.write_mask[1] = green;
+	device->blend.write_mask[2] = blue;
+	device->blend.write_mask[3] = alpha;
+}
+
+void device_blend_function(gs_device_t *device, enum gs_blend_type src, enum gs_blend_type dest)
+{
+	device_blend_function_separate(device, src, dest, src, dest);
+}
+
+void device_blend_function_separate(gs_device_t *device, enum gs_blend_type src_c, enum gs_blend_type dest_c,
+				    enum gs_blend_type src_a, enum gs_blend_type dest_a)
+{
+	device->blend.src_c = src_c;
+	device->blend.dest_c = dest_c;
+	device->blend.src_a = src_a;
+	device->blend.dest_a = dest_a;
+}
+
+void device_blend_op(gs_device_t *device, enum gs_blend_op_type op)
+{
+	device->blend.op = op;
+}
+
+void device_depth_function(gs_device_t *device, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_function(gs_device_t *device, enum gs_stencil_side side, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_op(gs_device_t *device, enum gs_stencil_side side, enum gs_stencil_op_type fail,
+		       enum gs_stencil_op_type zfail, enum gs_stencil_op_type zpass)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(fail);
+	UNUSED_PARAMETER(zfail);
+	UNUSED_PARAMETER(zpass);
+}
+
+void device_set_viewport(gs_device_t *device, int x, int y, int width, int height)
+{
+	device->cur_viewport.x = x;
+	device->cur_viewport.y = y;
+	device->cur_viewport.cx = width;
+	device->cur_viewport.cy = height;
+}
+
+void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
+{
+	*rect = device->cur_viewport;
+}
+
+void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
+{
+	device->scissor_enabled = rect != NULL;
+	if (rect)
+		device->cur_scissor = *rect;
+}
+
+void device_ortho(gs_device_t *device, float left, float right, float top, float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = far - near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = 2.0f / rml;
+	dst->t.x = (left + right) / -rml;
+
+	dst->y.y = 2.0f / -bmt;
+	dst->t.y = (bottom + top) / bmt;
+
+	dst->z.z = 1.0f / fmn;
+	dst->t.z = near / -fmn;
+
+	dst->t.w = 1.0f;
+}
+
+void device_frustum(gs_device_t *device, float left, float right, float top, float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = far - near;
+	float nearx2 = 2.0f * near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = nearx2 / rml;
+	dst->z.x = (left + right) / -rml;
+
+	dst->y.y = nearx2 / -bmt;
+	dst->z.y = (bottom + top) / bmt;
+
+	dst->z.z = far / fmn;
+	dst->t.z = (near * far) / -fmn;
+
+	dst->z.w = 1.0f;
+}
+
+void device_projection_push(gs_device_t *device)
+{
+	da_push_back(device->proj_stack, &device->cur_proj);
+}
+
+void device_projection_pop(gs_device_t *device)
+{
+	struct matrix4 *end;
+	if (!device->proj_stack.num)
+		return;
+
+	end = da_end(device->proj_stack);
+	device->cur_proj = *end;
+	da_pop_back(device->proj_stack);
+}
+
+/* ------------------------------------------------------------------------- */
+/* misc                                                                      */
+
+bool device_nv12_available(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return false;
+}
+
+bool device_p010_available(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return false;
+}
+
+bool device_is_monitor_hdr(gs_device_t *device, void *monitor)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(monitor);
+	return false;
+}
+
+void device_debug_marker_begin(gs_device_t *device, const char *markername, const float color[4])
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(markername);
+	UNUSED_PARAMETER(color);
+}
+
+void device_debug_marker_end(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+uint32_t gs_get_adapter_count(void)
+{
+	return 1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* platform interop: nothing to import from or export to without a GPU      */
+
+gs_texture_t *device_texture_create_from_dmabuf(gs_device_t *device, unsigned int width, unsigned int height,
+						uint32_t drm_format, enum gs_color_format color_format,
+						uint32_t n_planes, const int *fds, const uint32_t *strides,
+						const uint32_t *offsets, const uint64_t *modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(drm_format);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(n_planes);
+	UNUSED_PARAMETER(fds);
+	UNUSED_PARAMETER(strides);
+	UNUSED_PARAMETER(offsets);
+	UNUSED_PARAMETER(modifiers);
+	return NULL;
+}
+
+bool device_query_dmabuf_capabilities(gs_device_t *device, enum gs_dmabuf_flags *dmabuf_flags, uint32_t **drm_formats,
+				      size_t *n_formats)
+{
+	UNUSED_PARAMETER(device);
+
+	*dmabuf_flags = GS_DMABUF_FLAG_NONE;
+	*drm_formats = NULL;
+	*n_formats = 0;
+	return false;
+}
+
+bool device_query_dmabuf_modifiers_for_format(gs_device_t *device, uint32_t drm_format, uint64_t **modifiers,
+					      size_t *n_modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(drm_format);
+
+	*modifiers = NULL;
+	*n_modifiers = 0;
+	return false;
+}
+
+gs_texture_t *device_texture_create_from_pixmap(gs_device_t *device, uint32_t width, uint32_t height,
+						enum gs_color_format color_format, uint32_t target, void *pixmap)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(target);
+	UNUSED_PARAMETER(pixmap);
+	return NULL;
+}
+
+bool device_query_sync_capabilities(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return false;
+}
+
+gs_sync_t *device_sync_create(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return NULL;
+}
+
+gs_sync_t *device_sync_create_from_syncobj_timeline_point(gs_device_t *device, int syncobj_fd,
+							  uint64_t timeline_point)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(syncobj_fd);
+	UNUSED_PARAMETER(timeline_point);
+	return NULL;
+}
+
+void device_sync_destroy(gs_device_t *device, gs_sync_t *sync)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(sync);
+}
+
+bool device_sync_export_syncobj_timeline_point(gs_device_t *device, gs_sync_t *sync, int syncobj_fd,
+					       uint64_t timeline_point)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(sync);
+	UNUSED_PARAMETER(syncobj_fd);
+	UNUSED_PARAMETER(timeline_point);
+	return false;
+}
+
+bool device_sync_signal_syncobj_timeline_point(gs_device_t *device, int syncobj_fd, uint64_t timeline_point)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(syncobj_fd);
+	UNUSED_PARAMETER(timeline_point);
+	return false;
+}
+
+bool device_sync_wait(gs_device_t *device, gs_sync_t *sync)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(sync);
+	return true;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <util/darray.h>
+#include <util/threading.h>
+#include <util/task.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/matrix4.h>
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+#include <graphics/vec4.h>
+
+/*
+ * Null (software) graphics subsystem
+ *
+ *   Implements the graphics module interface entirely in system memory so
+ * that libobs can composite, convert and encode on machines without a GPU
+ * (CI, render farm nodes, benchmarking).  Textures are plain pixel buffers,
+ * draws are rasterized on the CPU, and shaders are not compiled: the entry
+ * point of each generated shader is looked up in a table of native kernels
+ * that mirror the built-in default/solid/format_conversion effects.  Shaders
+ * without a kernel are accepted (so that every effect still loads) but draw
+ * nothing.
+ */
+
+/* ------------------------------------------------------------------------- */
+
+struct gs_texture {
+	gs_device_t *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t levels;
+	uint32_t bytes_per_pixel;
+	uint32_t linesize;
+	bool is_render_target;
+	bool is_dynamic;
+
+	/* level 0 only, 6 faces for cube textures, depth slices for volume */
+	uint8_t *data;
+};
+
+struct gs_stage_surface {
+	gs_device_t *device;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t *device;
+	enum gs_zstencil_format format;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct gs_sampler_state {
+	gs_device_t *device;
+	struct gs_sampler_info info;
+};
+
+struct gs_vertex_buffer {
+	gs_device_t *device;
+	struct gs_vb_data *data;
+	bool dynamic;
+};
+
+struct gs_index_buffer {
+	gs_device_t *device;
+	enum gs_index_type type;
+	void *data;
+	size_t num;
+	size_t width;
+	bool dynamic;
+};
+
+struct gs_timer {
+	gs_device_t *device;
+	uint64_t begin_time;
+	uint64_t end_time;
+};
+
+struct gs_timer_range {
+	gs_device_t *device;
+};
+
+struct gs_swap_chain {
+	gs_device_t *device;
+	struct gs_init_data info;
+	gs_texture_t *target;
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct gs_shader_param {
+	enum gs_shader_param_type type;
+
+	char *name;
+	gs_shader_t *shader;
+	gs_samplerstate_t *next_sampler;
+	int array_count;
+
+	struct gs_texture *texture;
+	bool srgb;
+
+	DARRAY(uint8_t) cur_value;
+	DARRAY(uint8_t) def_value;
+};
+
+/* Resolved per draw from the currently loaded vertex and pixel shaders */
+struct null_uniforms {
+	struct matrix4 viewproj;
+
+	struct vec4 color;
+	struct vec4 color_vec[3];
+	float multiplier;
+	float width_i;
+
+	/* format_conversion.effect *_Reverse techniques */
+	float width_d2;
+	float height;
+	float width_x2_i;
+	struct vec3 color_range_min;
+	struct vec3 color_range_max;
+
+	gs_texture_t *image;
+	const struct gs_sampler_info *image_sampler;
+	bool image_srgb;
+
+	/* image1, image2 and image3 */
+	gs_texture_t *planes[3];
+	const struct gs_sampler_info *plane_samplers[3];
+	bool planes_srgb[3];
+};
+
+struct null_vs_input {
+	uint32_t id;
+	struct vec4 pos;
+	struct vec4 color;
+	struct vec2 uv;
+};
+
+#define NULL_MAX_VARYINGS 8
+
+struct null_varyings {
+	struct vec4 pos;
+	float v[NULL_MAX_VARYINGS];
+};
+
+typedef void (*null_vs_kernel_t)(const struct null_uniforms *uni, const struct null_vs_input *in,
+				 struct null_varyings *out);
+typedef void (*null_ps_kernel_t)(const struct null_uniforms *uni, const struct null_varyings *in, struct vec4 *out);
+
+struct gs_shader {
+	gs_device_t *device;
+	enum gs_shader_type type;
+	char *entry;
+
+	null_vs_kernel_t vs_kernel;
+	null_ps_kernel_t ps_kernel;
+	size_t num_varyings;
+
+	struct gs_shader_param *viewproj;
+	struct gs_shader_param *world;
+
+	DARRAY(struct gs_shader_param) params;
+	DARRAY(gs_samplerstate_t *) samplers;
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct null_blend_state {
+	bool enabled;
+	enum gs_blend_type src_c;
+	enum gs_blend_type dest_c;
+	enum gs_blend_type src_a;
+	enum gs_blend_type dest_a;
+	enum gs_blend_op_type op;
+	bool write_mask[4];
+};
+
+struct gs_device {
+	gs_texture_t *cur_render_target;
+	gs_zstencil_t *cur_zstencil_buffer;
+	int cur_render_side;
+	gs_texture_t *cur_textures[GS_MAX_TEXTURES];
+	gs_samplerstate_t *cur_samplers[GS_MAX_TEXTURES];
+	gs_vertbuffer_t *cur_vertex_buffer;
+	gs_indexbuffer_t *cur_index_buffer;
+	gs_shader_t *cur_vertex_shader;
+	gs_shader_t *cur_pixel_shader;
+	gs_swapchain_t *cur_swap;
+	enum gs_color_space cur_color_space;
+	bool framebuffer_srgb;
+
+	enum gs_cull_mode cur_cull_mode;
+	struct gs_rect cur_viewport;
+	struct gs_rect cur_scissor;
+	bool scissor_enabled;
+	struct null_blend_state blend;
+
+	struct gs_sampler_info default_sampler;
+
+	struct matrix4 cur_proj;
+	struct matrix4 cur_view;
+	struct matrix4 cur_viewproj;
+
+	DARRAY(struct matrix4) proj_stack;
+
+	/* splits large triangles into row bands, NULL when single core */
+	os_work_pool_t *raster_pool;
+
+	bool warned_no_kernel;
+};
+
+/* ------------------------------------------------------------------------- */
+
+extern uint32_t null_format_bytes_per_pixel(enum gs_color_format format);
+extern void null_read_texel(enum gs_color_format format, const uint8_t *ptr, bool srgb, struct vec4 *out);
+extern void null_write_texel(enum gs_color_format format, uint8_t *ptr, bool srgb, const struct vec4 *in);
+
+extern uint8_t *null_texture_get_plane(gs_texture_t *tex, int side);
+extern void null_texture_load(const gs_texture_t *tex, int x, int y, bool srgb, struct vec4 *out);
+extern void null_texture_sample(const gs_texture_t *tex, const struct gs_sampler_info *sampler, float u, float v,
+				bool srgb, struct vec4 *out);
+
+extern null_vs_kernel_t null_find_vs_kernel(const char *file, const char *name, size_t *num_varyings);
+extern null_ps_kernel_t null_find_ps_kernel(const char *file, const char *name);
+
+extern void null_shader_get_uniforms(const gs_device_t *device, struct null_uniforms *uni);
+
+extern void null_rasterize(gs_device_t *device, enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts);
@@ -0,0 +1,673 @@
+#include <math.h>
+#include <util/bmem.h>
+#include <graphics/half.h>
+#include "null-subsystem.h"
+
+/* ------------------------------------------------------------------------- */
+/* texel formats                                                             */
+
+#define SRGB_ENCODE_STEPS 16384
+
+static float srgb_decode_table[256];
+static uint8_t srgb_encode_table[SRGB_ENCODE_STEPS];
+static pthread_once_t srgb_tables_once = PTHREAD_ONCE_INIT;
+
+static void init_srgb_tables(void)
+{
+	for (size_t i = 0; i < 256; i++)
+		srgb_decode_table[i] = gs_srgb_nonlinear_to_linear(gs_u8_to_float((uint8_t)i));
+
+	for (size_t i = 0; i < SRGB_ENCODE_STEPS; i++) {
+		float linear = (float)i / (float)(SRGB_ENCODE_STEPS - 1);
+		srgb_encode_table[i] = gs_float_to_u8(gs_srgb_linear_to_nonlinear(linear));
+	}
+}
+
+static inline float saturate(float f)
+{
+	return f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+}
+
+static inline uint8_t unorm8(float f)
+{
+	return (uint8_t)(saturate(f) * 255.0f + 0.5f);
+}
+
+static inline uint16_t unorm16(float f)
+{
+	return (uint16_t)(saturate(f) * 65535.0f + 0.5f);
+}
+
+static inline uint8_t unorm8_srgb(float f)
+{
+	return srgb_encode_table[(size_t)(saturate(f) * (float)(SRGB_ENCODE_STEPS - 1) + 0.5f)];
+}
+
+static inline float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1F;
+	uint32_t mant = h & 0x3FF;
+	uint32_t bits;
+	float f;
+
+	if (exp == 0) {
+		if (mant == 0) {
+			bits = sign;
+		} else {
+			/* denormal: renormalize */
+			exp = 127 - 15 + 1;
+			while ((mant & 0x400) == 0) {
+				mant <<= 1;
+				exp--;
+			}
+			mant &= 0x3FF;
+			bits = sign | (exp << 23) | (mant << 13);
+		}
+	} else if (exp == 0x1F) {
+		bits = sign | 0x7F800000 | (mant << 13);
+	} else {
+		bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+	}
+
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+uint32_t null_format_bytes_per_pixel(enum gs_color_format format)
+{
+	return gs_get_format_bpp(format) / 8;
+}
+
+void null_read_texel(enum gs_color_format format, const uint8_t *ptr, bool srgb, struct vec4 *out)
+{
+	const uint16_t *p16 = (const uint16_t *)ptr;
+	const float *p32 = (const float *)ptr;
+	uint32_t packed;
+
+	switch (format) {
+	case GS_A8:
+		vec4_set(out, 0.0f, 0.0f, 0.0f, gs_u8_to_float(ptr[0]));
+		return;
+	case GS_R8:
+		vec4_set(out, gs_u8_to_float(ptr[0]), 0.0f, 0.0f, 1.0f);
+		return;
+	case GS_R8G8:
+		vec4_set(out, gs_u8_to_float(ptr[0]), gs_u8_to_float(ptr[1]), 0.0f, 1.0f);
+		return;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		vec4_set(out, gs_u8_to_float(ptr[0]), gs_u8_to_float(ptr[1]), gs_u8_to_float(ptr[2]),
+			 gs_u8_to_float(ptr[3]));
+		break;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+		vec4_set(out, gs_u8_to_float(ptr[2]), gs_u8_to_float(ptr[1]), gs_u8_to_float(ptr[0]),
+			 gs_u8_to_float(ptr[3]));
+		break;
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		vec4_set(out, gs_u8_to_float(ptr[2]), gs_u8_to_float(ptr[1]), gs_u8_to_float(ptr[0]), 1.0f);
+		break;
+	case GS_R10G10B10A2:
+		memcpy(&packed, ptr, sizeof(packed));
+		vec4_set(out, (float)(packed & 0x3FF) / 1023.0f, (float)((packed >> 10) & 0x3FF) / 1023.0f,
+			 (float)((packed >> 20) & 0x3FF) / 1023.0f, (float)(packed >> 30) / 3.0f);
+		return;
+	case GS_RGBA16:
+		vec4_set(out, (float)p16[0] / 65535.0f, (float)p16[1] / 65535.0f, (float)p16[2] / 65535.0f,
+			 (float)p16[3] / 65535.0f);
+		return;
+	case GS_R16:
+		vec4_set(out, (float)p16[0] / 65535.0f, 0.0f, 0.0f, 1.0f);
+		return;
+	case GS_RG16:
+		vec4_set(out, (float)p16[0] / 65535.0f, (float)p16[1] / 65535.0f, 0.0f, 1.0f);
+		return;
+	case GS_RGBA16F:
+		vec4_set(out, half_to_float(p16[0]), half_to_float(p16[1]), half_to_float(p16[2]),
+			 half_to_float(p16[3]));
+		return;
+	case GS_RG16F:
+		vec4_set(out, half_to_float(p16[0]), half_to_float(p16[1]), 0.0f, 1.0f);
+		return;
+	case GS_R16F:
+		vec4_set(out, half_to_float(p16[0]), 0.0f, 0.0f, 1.0f);
+		return;
+	case GS_RGBA32F:
+		vec4_set(out, p32[0], p32[1], p32[2], p32[3]);
+		return;
+	case GS_RG32F:
+		vec4_set(out, p32[0], p32[1], 0.0f, 1.0f);
+		return;
+	case GS_R32F:
+		vec4_set(out, p32[0], 0.0f, 0.0f, 1.0f);
+		return;
+	case GS_DXT1:
+	case GS_DXT3:
+	case GS_DXT5:
+	case GS_UNKNOWN:
+		vec4_zero(out);
+		return;
+	}
+
+	/* only the 8-bit RGB formats reach this point */
+	if (srgb) {
+		out->x = srgb_decode_table[ptr[format == GS_RGBA || format == GS_RGBA_UNORM ? 0 : 2]];
+		out->y = srgb_decode_table[ptr[1]];
+		out->z = srgb_decode_table[ptr[format == GS_RGBA || format == GS_RGBA_UNORM ? 2 : 0]];
+	}
+}
+
+void null_write_texel(enum gs_color_format format, uint8_t *ptr, bool srgb, const struct vec4 *in)
+{
+	uint16_t *p16 = (uint16_t *)ptr;
+	float *p32 = (float *)ptr;
+	uint8_t (*to_u8)(float) = srgb ? unorm8_srgb : unorm8;
+	uint32_t packed;
+
+	switch (format) {
+	case GS_A8:
+		ptr[0] = unorm8(in->w);
+		break;
+	case GS_R8:
+		ptr[0] = unorm8(in->x);
+		break;
+	case GS_R8G8:
+		ptr[0] = unorm8(in->x);
+		ptr[1] = unorm8(in->y);
+		break;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		ptr[0] = to_u8(in->x);
+		ptr[1] = to_u8(in->y);
+		ptr[2] = to_u8(in->z);
+		ptr[3] = unorm8(in->w);
+		break;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		ptr[0] = to_u8(in->z);
+		ptr[1] = to_u8(in->y);
+		ptr[2] = to_u8(in->x);
+		ptr[3] = (format == GS_BGRX || format == GS_BGRX_UNORM) ? 255 : unorm8(in->w);
+		break;
+	case GS_R10G10B10A2:
+		packed = (uint32_t)(saturate(in->x) * 1023.0f + 0.5f);
+		packed |= (uint32_t)(saturate(in->y) * 1023.0f + 0.5f) << 10;
+		packed |= (uint32_t)(saturate(in->z) * 1023.0f + 0.5f) << 20;
+		packed |= (uint32_t)(saturate(in->w) * 3.0f + 0.5f) << 30;
+		memcpy(ptr, &packed, sizeof(packed));
+		break;
+	case GS_RGBA16:
+		p16[0] = unorm16(in->x);
+		p16[1] = unorm16(in->y);
+		p16[2] = unorm16(in->z);
+		p16[3] = unorm16(in->w);
+		break;
+	case GS_R16:
+		p16[0] = unorm16(in->x);
+		break;
+	case GS_RG16:
+		p16[0] = unorm16(in->x);
+		p16[1] = unorm16(in->y);
+		break;
+	case GS_RGBA16F:
+		p16[0] = half_from_float(in->x).u;
+		p16[1] = half_from_float(in->y).u;
+		p16[2] = half_from_float(in->z).u;
+		p16[3] = half_from_float(in->w).u;
+		break;
+	case GS_RG16F:
+		p16[0] = half_from_float(in->x).u;
+		p16[1] = half_from_float(in->y).u;
+		break;
+	case GS_R16F:
+		p16[0] = half_from_float(in->x).u;
+		break;
+	case GS_RGBA32F:
+		p32[0] = in->x;
+		p32[1] = in->y;
+		p32[2] = in->z;
+		p32[3] = in->w;
+		break;
+	case GS_RG32F:
+		p32[0] = in->x;
+		p32[1] = in->y;
+		break;
+	case GS_R32F:
+		p32[0] = in->x;
+		break;
+	case GS_DXT1:
+	case GS_DXT3:
+	case GS_DXT5:
+	case GS_UNKNOWN:
+		break;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* sampling                                                                  */
+
+uint8_t *null_texture_get_plane(gs_texture_t *tex, int side)
+{
+	if (tex->type != GS_TEXTURE_CUBE || side <= 0)
+		return tex->data;
+
+	return tex->data + (size_t)tex->linesize * tex->height * (size_t)side;
+}
+
+static inline int address(enum gs_address_mode mode, int i, int size)
+{
+	if (i >= 0 && i < size)
+		return i;
+
+	switch (mode) {
+	case GS_ADDRESS_WRAP:
+		i %= size;
+		return i < 0 ? i + size : i;
+	case GS_ADDRESS_MIRROR:
+	case GS_ADDRESS_MIRRORONCE: {
+		int period = size * 2;
+		i %= period;
+		if (i < 0)
+			i += period;
+		return i < size ? i : period - 1 - i;
+	}
+	case GS_ADDRESS_BORDER:
+		return -1;
+	case GS_ADDRESS_CLAMP:
+		break;
+	}
+
+	return i < 0 ? 0 : size - 1;
+}
+
+static inline void fetch(const gs_texture_t *tex, const struct gs_sampler_info *sampler, int x, int y, bool srgb,
+			 struct vec4 *out)
+{
+	x = address(sampler->address_u, x, (int)tex->width);
+	y = address(sampler->address_v, y, (int)tex->height);
+
+	if (x < 0 || y < 0) {
+		vec4_from_rgba(out, sampler->border_color);
+		return;
+	}
+
+	null_read_texel(tex->format, tex->data + (size_t)y * tex->linesize + (size_t)x * tex->bytes_per_pixel, srgb,
+			out);
+}
+
+static inline bool filter_is_point(enum gs_sample_filter filter)
+{
+	/* only magnification matters without mipmaps */
+	switch (filter) {
+	case GS_FILTER_POINT:
+	case GS_FILTER_MIN_MAG_POINT_MIP_LINEAR:
+	case GS_FILTER_MIN_LINEAR_MAG_MIP_POINT:
+	case GS_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void null_texture_load(const gs_texture_t *tex, int x, int y, bool srgb, struct vec4 *out)
+{
+	if (!tex || x < 0 || y < 0 || x >= (int)tex->width || y >= (int)tex->height) {
+		vec4_zero(out);
+		return;
+	}
+
+	null_read_texel(tex->format, tex->data + (size_t)y * tex->linesize + (size_t)x * tex->bytes_per_pixel, srgb,
+			out);
+}
+
+void null_texture_sample(const gs_texture_t *tex, const struct gs_sampler_info *sampler, float u, float v, bool srgb,
+			 struct vec4 *out)
+{
+	struct vec4 t00, t10, t01, t11;
+	float x, y, fx, fy;
+	int x0, y0;
+
+	if (!tex || !tex->data) {
+		vec4_zero(out);
+		return;
+	}
+
+	x = u * (float)tex->width - 0.5f;
+	y = v * (float)tex->height - 0.5f;
+
+	if (filter_is_point(sampler->filter)) {
+		fetch(tex, sampler, (int)floorf(x + 0.5f), (int)floorf(y + 0.5f), srgb, out);
+		return;
+	}
+
+	x0 = (int)floorf(x);
+	y0 = (int)floorf(y);
+	fx = x - (float)x0;
+	fy = y - (float)y0;
+
+	fetch(tex, sampler, x0, y0, srgb, &t00);
+	fetch(tex, sampler, x0 + 1, y0, srgb, &t10);
+	fetch(tex, sampler, x0, y0 + 1, srgb, &t01);
+	fetch(tex, sampler, x0 + 1, y0 + 1, srgb, &t11);
+
+	vec4_mulf(&t00, &t00, (1.0f - fx) * (1.0f - fy));
+	vec4_mulf(&t10, &t10, fx * (1.0f - fy));
+	vec4_mulf(&t01, &t01, (1.0f - fx) * fy);
+	vec4_mulf(&t11, &t11, fx * fy);
+
+	vec4_add(out, &t00, &t10);
+	vec4_add(out, out, &t01);
+	vec4_add(out, out, &t11);
+}
+
+/* ------------------------------------------------------------------------- */
+/* textures                                                                  */
+
+static gs_texture_t *texture_create(gs_device_t *device, enum gs_texture_type type, uint32_t width, uint32_t height,
+				    uint32_t depth, enum gs_color_format color_format, uint32_t levels, uint32_t flags)
+{
+	struct gs_texture *tex;
+	size_t planes = type == GS_TEXTURE_CUBE ? 6 : depth;
+
+	if (gs_is_compressed_format(color_format)) {
+		blog(LOG_ERROR, "device_texture_create (null): compressed "
+				"formats are not supported");
+		return NULL;
+	}
+
+	pthread_once(&srgb_tables_once, init_srgb_tables);
+
+	tex = bzalloc(sizeof(struct gs_texture));
+	tex->device = device;
+	tex->type = type;
+	tex->format = color_format;
+	tex->width = width;
+	tex->height = height;
+	tex->depth = depth;
+	tex->levels = levels ? levels : 1;
+	tex->bytes_per_pixel = null_format_bytes_per_pixel(color_format);
+	tex->linesize = width * tex->bytes_per_pixel;
+	tex->is_render_target = (flags & GS_RENDER_TARGET) != 0;
+	tex->is_dynamic = (flags & GS_DYNAMIC) != 0;
+	tex->data = bzalloc((size_t)tex->linesize * height * planes);
+
+	return tex;
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width, uint32_t height,
+				    enum gs_color_format color_format, uint32_t levels, const uint8_t **data,
+				    uint32_t flags)
+{
+	struct gs_texture *tex;
+
+	tex = texture_create(device, GS_TEXTURE_2D, width, height, 1, color_format, levels, flags);
+	if (tex && data && data[0])
+		memcpy(tex->data, data[0], (size_t)tex->linesize * height);
+
+	return tex;
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size, enum gs_color_format color_format,
+					uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	struct gs_texture *tex;
+
+	tex = texture_create(device, GS_TEXTURE_CUBE, size, size, 1, color_format, levels, flags);
+	if (!tex || !data)
+		return tex;
+
+	for (int i = 0; i < 6; i++) {
+		const uint8_t *face = data[i * tex->levels];
+		if (face)
+			memcpy(null_texture_get_plane(tex, i), face, (size_t)tex->linesize * size);
+	}
+
+	return tex;
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width, uint32_t height, uint32_t depth,
+				       enum gs_color_format color_format, uint32_t levels, const uint8_t *const *data,
+				       uint32_t flags)
+{
+	struct gs_texture *tex;
+
+	tex = texture_create(device, GS_TEXTURE_3D, width, height, depth, color_format, levels, flags);
+	if (tex && data && data[0])
+		memcpy(tex->data, data[0], (size_t)tex->linesize * height * depth);
+
+	return tex;
+}
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	if (!tex)
+		return;
+
+	bfree(tex->data);
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	*ptr = tex->data;
+	*linesize = tex->linesize;
+	return true;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+}
+
+bool gs_texture_is_rect(const gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return false;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	return tex->data;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	gs_texture_destroy(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	return cubetex->width;
+}
+
+enum gs_color_format gs_cubetexture_get_color_format(const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	gs_texture_destroy(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	return voltex->width;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	return voltex->height;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	return voltex->depth;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	return voltex->format;
+}
+
+/* ------------------------------------------------------------------------- */
+/* copies                                                                    */
+
+void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
+				gs_texture_t *src, uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Source or destination texture is NULL");
+		return;
+	}
+
+	if (gs_generalize_format(src->format) != gs_generalize_format(dst->format)) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Source and destination formats do not match");
+		return;
+	}
+
+	uint32_t nw = src_w ? src_w : src->width - src_x;
+	uint32_t nh = src_h ? src_h : src->height - src_y;
+
+	if (dst_x + nw > dst->width || dst_y + nh > dst->height || src_x + nw > src->width ||
+	    src_y + nh > src->height) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Copy region is out of bounds");
+		return;
+	}
+
+	size_t row = (size_t)nw * src->bytes_per_pixel;
+	for (uint32_t y = 0; y < nh; y++) {
+		uint8_t *d = dst->data + (size_t)(dst_y + y) * dst->linesize + (size_t)dst_x * dst->bytes_per_pixel;
+		const uint8_t *s = src->data + (size_t)(src_y + y) * src->linesize +
+				   (size_t)src_x * src->bytes_per_pixel;
+		memmove(d, s, row);
+	}
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst, gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst, gs_texture_t *src)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_stage_texture (null): "
+				"Source or destination is NULL");
+		return;
+	}
+
+	if (gs_generalize_format(src->format) != gs_generalize_format(dst->format) || src->width != dst->width ||
+	    src->height != dst->height) {
+		blog(LOG_ERROR, "device_stage_texture (null): "
+				"Source and destination sizes/formats do not match");
+		return;
+	}
+
+	if (src->linesize == dst->linesize) {
+		memcpy(dst->data, src->data, (size_t)dst->linesize * dst->height);
+	} else {
+		size_t row = src->linesize < dst->linesize ? src->linesize : dst->linesize;
+		for (uint32_t y = 0; y < dst->height; y++)
+			memcpy(dst->data + (size_t)y * dst->linesize, src->data + (size_t)y * src->linesize, row);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* stage surfaces / zstencil                                                 */
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width, uint32_t height,
+					   enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device = device;
+	surf->format = color_format;
+	surf->width = width;
+	surf->height = height;
+	surf->linesize = width * null_format_bytes_per_pixel(color_format);
+	surf->data = bzalloc((size_t)surf->linesize * height);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf)
+		return;
+
+	bfree(stagesurf->data);
+	bfree(stagesurf);
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format gs_stagesurface_get_color_format(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data, uint32_t *linesize)
+{
+	*data = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width, uint32_t height,
+				      enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs = bzalloc(sizeof(struct gs_zstencil_buffer));
+	zs->device = device;
+	zs->format = format;
+	zs->width = width;
+	zs->height = height;
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zstencil)
+{
+	bfree(zstencil);
+}
@@ -15,6 +15,8 @@ target_sources(
     util/platform-nix.c
     util/threading-posix.c
     util/threading-posix.h
+    util/uring-writer.c
+    util/uring-writer.h
 )
 
 target_compile_definitions(
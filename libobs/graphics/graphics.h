@@ -501,6 +501,7 @@ struct gs_init_data {
 #define GS_DEVICE_OPENGL 1
 #define GS_DEVICE_DIRECT3D_11 2
 #define GS_DEVICE_METAL 3
+#define GS_DEVICE_NULL 4
 
 EXPORT const char *gs_get_device_name(void);
 EXPORT const char *gs_get_driver_version(void);
@@ -0,0 +1,105 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-simd-kernels.h"
+
+#ifdef AUDIO_SIMD_HAS_AVX2
+
+#include <immintrin.h>
+
+/* these are only ever called after checking for AVX2 at runtime, so the rest
+ * of libobs doesn't have to be built with AVX2 enabled */
+#ifdef _MSC_VER
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+
+AVX2_FUNC void audio_mix_add_avx2(float *dst, const float *src, size_t count)
+{
+	size_t count_vec = count & ~(size_t)15;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 16) {
+		__m256 a = _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i));
+		__m256 b = _mm256_add_ps(_mm256_loadu_ps(dst + i + 8), _mm256_loadu_ps(src + i + 8));
+
+		_mm256_storeu_ps(dst + i, a);
+		_mm256_storeu_ps(dst + i + 8, b);
+	}
+
+	mix_add_tail(dst, src, i, count);
+}
+
+AVX2_FUNC void audio_apply_gain_avx2(float *data, float gain, size_t count)
+{
+	const __m256 gain_vec = _mm256_set1_ps(gain);
+	size_t count_vec = count & ~(size_t)15;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 16) {
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), gain_vec));
+		_mm256_storeu_ps(data + i + 8, _mm256_mul_ps(_mm256_loadu_ps(data + i + 8), gain_vec));
+	}
+
+	apply_gain_tail(data, gain, i, count);
+}
+
+AVX2_FUNC void audio_downmix_to_mono_avx2(float *const *data, size_t channels, size_t count)
+{
+	const __m256 channels_i = _mm256_set1_ps(1.0f / (float)channels);
+	size_t count_vec = count & ~(size_t)7;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 8) {
+		__m256 sum = _mm256_loadu_ps(data[0] + i);
+
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = _mm256_add_ps(sum, _mm256_loadu_ps(data[ch] + i));
+
+		sum = _mm256_mul_ps(sum, channels_i);
+
+		for (size_t ch = 0; ch < channels; ch++)
+			_mm256_storeu_ps(data[ch] + i, sum);
+	}
+
+	downmix_to_mono_tail(data, channels, i, count);
+}
+
+AVX2_FUNC void audio_clamp_avx2(float *data, float *unclamped, size_t count)
+{
+	const __m256 min_val = _mm256_set1_ps(-1.0f);
+	const __m256 max_val = _mm256_set1_ps(1.0f);
+	size_t count_vec = count & ~(size_t)7;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+
+		if (unclamped)
+			_mm256_storeu_ps(unclamped + i, val);
+
+		/* NaNs to zero, after that min/max behave like the compares */
+		val = _mm256_and_ps(val, _mm256_cmp_ps(val, val, _CMP_ORD_Q));
+		val = _mm256_min_ps(_mm256_max_ps(val, min_val), max_val);
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	clamp_tail(data, unclamped, i, count);
+}
+
+#endif
@@ -0,0 +1,98 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Internal: per-instruction-set variants of the audio kernels.  The public
+ * functions in audio-simd.h dispatch to one of these.
+ */
+
+#include "audio-simd.h"
+#include "../util/cpu-features.h"
+
+#ifdef OS_CPU_X86
+#define AUDIO_SIMD_HAS_AVX2 1
+#endif
+
+#ifdef OS_CPU_ARM64
+#define AUDIO_SIMD_HAS_NEON 1
+#endif
+
+#define DECLARE_AUDIO_KERNELS(suffix)                                                              \
+	void audio_mix_add_##suffix(float *dst, const float *src, size_t count);                   \
+	void audio_apply_gain_##suffix(float *data, float gain, size_t count);                     \
+	void audio_downmix_to_mono_##suffix(float *const *data, size_t channels, size_t count);    \
+	void audio_clamp_##suffix(float *data, float *unclamped, size_t count)
+
+DECLARE_AUDIO_KERNELS(sse2);
+#ifdef AUDIO_SIMD_HAS_AVX2
+DECLARE_AUDIO_KERNELS(avx2);
+#endif
+#ifdef AUDIO_SIMD_HAS_NEON
+DECLARE_AUDIO_KERNELS(neon);
+#endif
+
+#undef DECLARE_AUDIO_KERNELS
+
+/* ------------------------------------------------------------------------- */
+/* Scalar versions of the kernel loops.  The vector kernels use these for    */
+/* whatever is left after the vector loop, starting at i.                    */
+
+static inline void mix_add_tail(float *dst, const float *src, size_t i, size_t count)
+{
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+static inline void apply_gain_tail(float *data, float gain, size_t i, size_t count)
+{
+	for (; i < count; i++)
+		data[i] *= gain;
+}
+
+static inline void downmix_to_mono_tail(float *const *data, size_t channels, size_t i, size_t count)
+{
+	const float channels_i = 1.0f / (float)channels;
+
+	for (; i < count; i++) {
+		float sum = data[0][i];
+
+		for (size_t ch = 1; ch < channels; ch++)
+			sum += data[ch][i];
+
+		sum *= channels_i;
+
+		for (size_t ch = 0; ch < channels; ch++)
+			data[ch][i] = sum;
+	}
+}
+
+static inline void clamp_tail(float *data, float *unclamped, size_t i, size_t count)
+{
+	for (; i < count; i++) {
+		float val = data[i];
+
+		if (unclamped)
+			unclamped[i] = val;
+
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
@@ -0,0 +1,97 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-simd-kernels.h"
+
+#ifdef AUDIO_SIMD_HAS_NEON
+
+#include <arm_neon.h>
+
+void audio_mix_add_neon(float *dst, const float *src, size_t count)
+{
+	size_t count_vec = count & ~(size_t)7;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 8) {
+		float32x4_t a = vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i));
+		float32x4_t b = vaddq_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4));
+
+		vst1q_f32(dst + i, a);
+		vst1q_f32(dst + i + 4, b);
+	}
+
+	mix_add_tail(dst, src, i, count);
+}
+
+void audio_apply_gain_neon(float *data, float gain, size_t count)
+{
+	size_t count_vec = count & ~(size_t)7;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 8) {
+		vst1q_f32(data + i, vmulq_n_f32(vld1q_f32(data + i), gain));
+		vst1q_f32(data + i + 4, vmulq_n_f32(vld1q_f32(data + i + 4), gain));
+	}
+
+	apply_gain_tail(data, gain, i, count);
+}
+
+void audio_downmix_to_mono_neon(float *const *data, size_t channels, size_t count)
+{
+	const float channels_i = 1.0f / (float)channels;
+	size_t count_vec = count & ~(size_t)3;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 4) {
+		float32x4_t sum = vld1q_f32(data[0] + i);
+
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = vaddq_f32(sum, vld1q_f32(data[ch] + i));
+
+		sum = vmulq_n_f32(sum, channels_i);
+
+		for (size_t ch = 0; ch < channels; ch++)
+			vst1q_f32(data[ch] + i, sum);
+	}
+
+	downmix_to_mono_tail(data, channels, i, count);
+}
+
+void audio_clamp_neon(float *data, float *unclamped, size_t count)
+{
+	const float32x4_t min_val = vdupq_n_f32(-1.0f);
+	const float32x4_t max_val = vdupq_n_f32(1.0f);
+	size_t count_vec = count & ~(size_t)3;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 4) {
+		float32x4_t val = vld1q_f32(data + i);
+		uint32x4_t ordered = vceqq_f32(val, val);
+
+		if (unclamped)
+			vst1q_f32(unclamped + i, val);
+
+		/* vmin/vmax propagate NaNs, so zero them first */
+		val = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(val), ordered));
+		val = vminq_f32(vmaxq_f32(val, min_val), max_val);
+		vst1q_f32(data + i, val);
+	}
+
+	clamp_tail(data, unclamped, i, count);
+}
+
+#endif
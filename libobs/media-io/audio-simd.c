@@ -0,0 +1,202 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-simd-kernels.h"
+
+#include "../util/sse-intrin.h"
+#include "../util/threading.h"
+
+void audio_mix_add_sse2(float *dst, const float *src, size_t count)
+{
+	size_t count_vec = count & ~(size_t)7;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 8) {
+		__m128 a = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i));
+		__m128 b = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_loadu_ps(src + i + 4));
+
+		_mm_storeu_ps(dst + i, a);
+		_mm_storeu_ps(dst + i + 4, b);
+	}
+
+	mix_add_tail(dst, src, i, count);
+}
+
+void audio_apply_gain_sse2(float *data, float gain, size_t count)
+{
+	const __m128 gain_vec = _mm_set1_ps(gain);
+	size_t count_vec = count & ~(size_t)7;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 8) {
+		_mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), gain_vec));
+		_mm_storeu_ps(data + i + 4, _mm_mul_ps(_mm_loadu_ps(data + i + 4), gain_vec));
+	}
+
+	apply_gain_tail(data, gain, i, count);
+}
+
+void audio_downmix_to_mono_sse2(float *const *data, size_t channels, size_t count)
+{
+	const __m128 channels_i = _mm_set1_ps(1.0f / (float)channels);
+	size_t count_vec = count & ~(size_t)3;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 4) {
+		__m128 sum = _mm_loadu_ps(data[0] + i);
+
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = _mm_add_ps(sum, _mm_loadu_ps(data[ch] + i));
+
+		sum = _mm_mul_ps(sum, channels_i);
+
+		for (size_t ch = 0; ch < channels; ch++)
+			_mm_storeu_ps(data[ch] + i, sum);
+	}
+
+	downmix_to_mono_tail(data, channels, i, count);
+}
+
+void audio_clamp_sse2(float *data, float *unclamped, size_t count)
+{
+	const __m128 min_val = _mm_set1_ps(-1.0f);
+	const __m128 max_val = _mm_set1_ps(1.0f);
+	size_t count_vec = count & ~(size_t)3;
+	size_t i;
+
+	for (i = 0; i < count_vec; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+
+		if (unclamped)
+			_mm_storeu_ps(unclamped + i, val);
+
+		/* NaNs to zero, after that min/max behave like the compares */
+		val = _mm_and_ps(val, _mm_cmpord_ps(val, val));
+		val = _mm_min_ps(_mm_max_ps(val, min_val), max_val);
+		_mm_storeu_ps(data + i, val);
+	}
+
+	clamp_tail(data, unclamped, i, count);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct audio_simd_funcs {
+	void (*mix_add)(float *dst, const float *src, size_t count);
+	void (*apply_gain)(float *data, float gain, size_t count);
+	void (*downmix_to_mono)(float *const *data, size_t channels, size_t count);
+	void (*clamp)(float *data, float *unclamped, size_t count);
+};
+
+#define AUDIO_KERNEL_FUNCS(suffix)                                                                   \
+	{                                                                                            \
+		audio_mix_add_##suffix, audio_apply_gain_##suffix, audio_downmix_to_mono_##suffix, \
+			audio_clamp_##suffix                                                         \
+	}
+
+static const struct audio_simd_funcs kernel_funcs[] = {
+	[AUDIO_SIMD_SSE2] = AUDIO_KERNEL_FUNCS(sse2),
+#ifdef AUDIO_SIMD_HAS_AVX2
+	[AUDIO_SIMD_AVX2] = AUDIO_KERNEL_FUNCS(avx2),
+#endif
+#ifdef AUDIO_SIMD_HAS_NEON
+	[AUDIO_SIMD_NEON] = AUDIO_KERNEL_FUNCS(neon),
+#endif
+};
+
+#undef AUDIO_KERNEL_FUNCS
+
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+static volatile long cur_simd = AUDIO_SIMD_SSE2;
+
+bool audio_simd_supported(enum audio_simd simd)
+{
+	switch (simd) {
+	case AUDIO_SIMD_SSE2:
+		return true;
+	case AUDIO_SIMD_AVX2:
+#ifdef AUDIO_SIMD_HAS_AVX2
+		return os_cpu_has_avx2();
+#else
+		return false;
+#endif
+	case AUDIO_SIMD_NEON:
+#ifdef AUDIO_SIMD_HAS_NEON
+		/* always available on aarch64 */
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	return false;
+}
+
+static void init_simd(void)
+{
+	enum audio_simd simd = AUDIO_SIMD_SSE2;
+
+	if (audio_simd_supported(AUDIO_SIMD_AVX2))
+		simd = AUDIO_SIMD_AVX2;
+	else if (audio_simd_supported(AUDIO_SIMD_NEON))
+		simd = AUDIO_SIMD_NEON;
+
+	os_atomic_set_long(&cur_simd, (long)simd);
+}
+
+static inline const struct audio_simd_funcs *get_funcs(void)
+{
+	pthread_once(&simd_once, init_simd);
+	return &kernel_funcs[os_atomic_load_long(&cur_simd)];
+}
+
+enum audio_simd audio_get_simd(void)
+{
+	pthread_once(&simd_once, init_simd);
+	return (enum audio_simd)os_atomic_load_long(&cur_simd);
+}
+
+bool audio_set_simd(enum audio_simd simd)
+{
+	if (!audio_simd_supported(simd))
+		return false;
+
+	pthread_once(&simd_once, init_simd);
+	os_atomic_set_long(&cur_simd, (long)simd);
+	return true;
+}
+
+void audio_mix_add(float *dst, const float *src, size_t count)
+{
+	get_funcs()->mix_add(dst, src, count);
+}
+
+void audio_apply_gain(float *data, float gain, size_t count)
+{
+	get_funcs()->apply_gain(data, gain, count);
+}
+
+void audio_downmix_to_mono(float *const *data, size_t channels, size_t count)
+{
+	if (channels)
+		get_funcs()->downmix_to_mono(data, channels, count);
+}
+
+void audio_clamp(float *data, float *unclamped, size_t count)
+{
+	get_funcs()->clamp(data, unclamped, count);
+}
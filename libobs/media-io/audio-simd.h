@@ -0,0 +1,69 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Vectorized kernels for the audio sample loops of libobs, also usable by
+ * filters.  All of them work on planar 32-bit float samples, don't require any
+ * alignment, and produce results identical to the equivalent scalar loops.
+ */
+
+/** Adds count samples of src to dst */
+EXPORT void audio_mix_add(float *dst, const float *src, size_t count);
+
+/** Multiplies count samples of data by gain */
+EXPORT void audio_apply_gain(float *data, float gain, size_t count);
+
+/**
+ * Replaces every channel with the average of all channels, summed in channel
+ * order
+ */
+EXPORT void audio_downmix_to_mono(float *const *data, size_t channels, size_t count);
+
+/**
+ * Clamps count samples of data to -1.0..1.0 in place, replacing NaNs with
+ * 0.0.  If unclamped is not NULL, the original samples are copied to it in
+ * the same pass.
+ */
+EXPORT void audio_clamp(float *data, float *unclamped, size_t count);
+
+/*
+ * Instruction set used by the kernels.  The fastest one the CPU supports is
+ * selected on first use; overriding it is mainly useful for testing and
+ * benchmarking.
+ */
+
+enum audio_simd {
+	AUDIO_SIMD_SSE2, /* SSE2, emulated through SIMDe on non-x86 */
+	AUDIO_SIMD_AVX2,
+	AUDIO_SIMD_NEON,
+};
+
+EXPORT bool audio_simd_supported(enum audio_simd simd);
+EXPORT enum audio_simd audio_get_simd(void);
+EXPORT bool audio_set_simd(enum audio_simd simd);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,267 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "format-conversion-simd.h"
+
+#ifdef FORMAT_CONVERSION_HAS_AVX2
+
+#include <immintrin.h>
+
+/* these are only ever called after checking for AVX2 at runtime, so the rest
+ * of libobs doesn't have to be built with AVX2 enabled */
+#ifdef _MSC_VER
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+
+/*
+ * Packed UYVX pixels are 32 bits: U in byte 0, Y in byte 1, V in byte 2.
+ * The planar outputs are gathered 16 pixels (two 256-bit loads) at a time.
+ */
+
+/* gathers byte <offset> of each of the 16 pixels in a and b */
+static AVX2_FUNC inline __m128i gather_bytes(__m256i a, __m256i b, int offset)
+{
+	const __m256i shuf_a =
+		_mm256_setr_epi8(offset, offset + 4, offset + 8, offset + 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+				 -1, -1, offset, offset + 4, offset + 8, offset + 12, -1, -1, -1, -1, -1, -1, -1, -1,
+				 -1, -1, -1, -1);
+	const __m256i shuf_b =
+		_mm256_setr_epi8(-1, -1, -1, -1, offset, offset + 4, offset + 8, offset + 12, -1, -1, -1, -1, -1, -1,
+				 -1, -1, -1, -1, -1, -1, offset, offset + 4, offset + 8, offset + 12, -1, -1, -1, -1,
+				 -1, -1, -1, -1);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m256i val = _mm256_or_si256(_mm256_shuffle_epi8(a, shuf_a), _mm256_shuffle_epi8(b, shuf_b));
+	val = _mm256_permutevar8x32_epi32(val, order);
+	return _mm256_castsi256_si128(val);
+}
+
+/* averages the U/V values of each 2x2 block of the 16x2 pixels, returned as
+ * 8 interleaved U/V byte pairs */
+static AVX2_FUNC inline __m128i average_chroma(__m256i line1_a, __m256i line1_b, __m256i line2_a, __m256i line2_b)
+{
+	const __m256i uv_mask = _mm256_set1_epi16(0x00FF);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	/* per pixel: two 16-bit sums (U, V) of the vertically adjacent pixels */
+	__m256i sum_a = _mm256_add_epi16(_mm256_and_si256(line1_a, uv_mask), _mm256_and_si256(line2_a, uv_mask));
+	__m256i sum_b = _mm256_add_epi16(_mm256_and_si256(line1_b, uv_mask), _mm256_and_si256(line2_b, uv_mask));
+
+	/* split even and odd pixels, then add horizontally adjacent pixels */
+	sum_a = _mm256_shuffle_epi32(sum_a, _MM_SHUFFLE(3, 1, 2, 0));
+	sum_b = _mm256_shuffle_epi32(sum_b, _MM_SHUFFLE(3, 1, 2, 0));
+
+	__m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(sum_a, sum_b), _mm256_unpackhi_epi64(sum_a, sum_b));
+	sum = _mm256_srli_epi16(sum, 2);
+	sum = _mm256_packus_epi16(sum, sum);
+	sum = _mm256_permutevar8x32_epi32(sum, order);
+	return _mm256_castsi256_si128(sum);
+}
+
+AVX2_FUNC void compress_uyvx_to_i420_avx2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+					  uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	const __m128i split_uv = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u = output[1] + (y >> 1) * out_linesize[1];
+		uint8_t *v = output[2] + (y >> 1) * out_linesize[2];
+		uint32_t x;
+
+		for (x = 0; x < width_vec; x += 16) {
+			__m256i l1a = _mm256_loadu_si256((const __m256i *)(line1 + x * 4));
+			__m256i l1b = _mm256_loadu_si256((const __m256i *)(line1 + x * 4 + 32));
+			__m256i l2a = _mm256_loadu_si256((const __m256i *)(line2 + x * 4));
+			__m256i l2b = _mm256_loadu_si256((const __m256i *)(line2 + x * 4 + 32));
+
+			_mm_storeu_si128((__m128i *)(lum0 + x), gather_bytes(l1a, l1b, 1));
+			_mm_storeu_si128((__m128i *)(lum1 + x), gather_bytes(l2a, l2b, 1));
+
+			__m128i uv = _mm_shuffle_epi8(average_chroma(l1a, l1b, l2a, l2b), split_uv);
+			_mm_storel_epi64((__m128i *)(u + x / 2), uv);
+			_mm_storel_epi64((__m128i *)(v + x / 2), _mm_srli_si128(uv, 8));
+		}
+
+		uyvx_to_i420_tail(line1, line2, x, width, lum0, lum1, u, v);
+	}
+}
+
+AVX2_FUNC void compress_uyvx_to_nv12_avx2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+					  uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *uv = output[1] + (y >> 1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < width_vec; x += 16) {
+			__m256i l1a = _mm256_loadu_si256((const __m256i *)(line1 + x * 4));
+			__m256i l1b = _mm256_loadu_si256((const __m256i *)(line1 + x * 4 + 32));
+			__m256i l2a = _mm256_loadu_si256((const __m256i *)(line2 + x * 4));
+			__m256i l2b = _mm256_loadu_si256((const __m256i *)(line2 + x * 4 + 32));
+
+			_mm_storeu_si128((__m128i *)(lum0 + x), gather_bytes(l1a, l1b, 1));
+			_mm_storeu_si128((__m128i *)(lum1 + x), gather_bytes(l2a, l2b, 1));
+			_mm_storeu_si128((__m128i *)(uv + x), average_chroma(l1a, l1b, l2a, l2b));
+		}
+
+		uyvx_to_nv12_tail(line1, line2, x, width, lum0, lum1, uv);
+	}
+}
+
+AVX2_FUNC void convert_uyvx_to_i444_avx2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+					 uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	/* like the SSE2 version, all three planes use the luma linesize */
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint8_t *line = input + y * in_linesize;
+		uint32_t pos = y * out_linesize[0];
+		uint8_t *lum = output[0] + pos;
+		uint8_t *u = output[1] + pos;
+		uint8_t *v = output[2] + pos;
+		uint32_t x;
+
+		for (x = 0; x < width_vec; x += 16) {
+			__m256i a = _mm256_loadu_si256((const __m256i *)(line + x * 4));
+			__m256i b = _mm256_loadu_si256((const __m256i *)(line + x * 4 + 32));
+
+			_mm_storeu_si128((__m128i *)(u + x), gather_bytes(a, b, 0));
+			_mm_storeu_si128((__m128i *)(lum + x), gather_bytes(a, b, 1));
+			_mm_storeu_si128((__m128i *)(v + x), gather_bytes(a, b, 2));
+		}
+
+		uyvx_to_i444_tail(line, x, width, lum, u, v);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* planar to packed: 8 output pixels (one 256-bit store) at a time           */
+
+/* expands 4 16-bit chroma pairs into 8 32-bit values, each pair used twice */
+static AVX2_FUNC inline __m256i expand_chroma(__m128i pairs)
+{
+	return _mm256_cvtepu16_epi32(_mm_unpacklo_epi16(pairs, pairs));
+}
+
+AVX2_FUNC void decompress_nv12_avx2(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,
+				    uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
+	uint32_t width_d2_vec = width_d2 & ~3;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint32_t *output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		uint32_t *output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_d2_vec; x += 4) {
+			__m128i uv = _mm_loadl_epi64((const __m128i *)(chroma + x * 2));
+			__m256i out = _mm256_slli_epi32(expand_chroma(uv), 8);
+			__m256i y0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(lum0 + x * 2)));
+			__m256i y1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(lum1 + x * 2)));
+
+			_mm256_storeu_si256((__m256i *)(output0 + x * 2), _mm256_or_si256(y0, out));
+			_mm256_storeu_si256((__m256i *)(output1 + x * 2), _mm256_or_si256(y1, out));
+		}
+
+		nv12_to_packed_tail(lum0, lum1, chroma, x, width_d2, output0, output1);
+	}
+}
+
+AVX2_FUNC void decompress_420_avx2(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,
+				   uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2 = in_linesize[0] / 2;
+	uint32_t width_d2_vec = width_d2 & ~3;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint32_t *output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		uint32_t *output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_d2_vec; x += 4) {
+			__m128i u = _mm_cvtsi32_si128(*(const int *)(chroma0 + x));
+			__m128i v = _mm_cvtsi32_si128(*(const int *)(chroma1 + x));
+			__m256i out = expand_chroma(_mm_unpacklo_epi8(v, u));
+			__m256i y0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(lum0 + x * 2)));
+			__m256i y1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(lum1 + x * 2)));
+
+			y0 = _mm256_or_si256(_mm256_slli_epi32(y0, 16), out);
+			y1 = _mm256_or_si256(_mm256_slli_epi32(y1, 16), out);
+			_mm256_storeu_si256((__m256i *)(output0 + x * 2), y0);
+			_mm256_storeu_si256((__m256i *)(output1 + x * 2), y1);
+		}
+
+		i420_to_packed_tail(lum0, lum1, chroma0, chroma1, x, width_d2, output0, output1);
+	}
+}
+
+AVX2_FUNC void decompress_422_avx2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				   uint8_t *output, uint32_t out_linesize, bool leading_lum)
+{
+	/* the second pixel of each pair: YUYV -> Y1 U Y1 V, UYVY -> U Y1 V Y1 */
+	const __m256i second = leading_lum ? _mm256_setr_epi8(2, 1, 2, 3, 6, 5, 6, 7, 10, 9, 10, 11, 14, 13, 14, 15, 2,
+							      1, 2, 3, 6, 5, 6, 7, 10, 9, 10, 11, 14, 13, 14, 15)
+					   : _mm256_setr_epi8(0, 3, 2, 3, 4, 7, 6, 7, 8, 11, 10, 11, 12, 15, 14, 15, 0,
+							      3, 2, 3, 4, 7, 6, 7, 8, 11, 10, 11, 12, 15, 14, 15);
+	uint32_t width_d2 = min_uint32(in_linesize / 4, out_linesize / 8);
+	uint32_t width_d2_vec = width_d2 & ~7;
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint32_t *input32 = (const uint32_t *)(input + y * in_linesize);
+		uint32_t *output32 = (uint32_t *)(output + y * out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_d2_vec; x += 8) {
+			__m256i first = _mm256_loadu_si256((const __m256i *)(input32 + x));
+			__m256i dup = _mm256_shuffle_epi8(first, second);
+			__m256i lo = _mm256_unpacklo_epi32(first, dup);
+			__m256i hi = _mm256_unpackhi_epi32(first, dup);
+
+			_mm256_storeu_si256((__m256i *)(output32 + x * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256((__m256i *)(output32 + x * 2 + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+
+		packed_422_tail(input32, x, width_d2, output32, leading_lum);
+	}
+}
+
+#endif
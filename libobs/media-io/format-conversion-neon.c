@@ -0,0 +1,233 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "format-conversion-simd.h"
+
+#ifdef FORMAT_CONVERSION_HAS_NEON
+
+#include <arm_neon.h>
+
+/*
+ * The structured loads/stores (vld4/vst4) do the (de)interleaving of the
+ * packed formats, so everything here works 16 pixels at a time.  Packed UYVX
+ * pixels are U in byte 0, Y in byte 1, V in byte 2.
+ */
+
+static inline uint8x16_t zip_u8(uint8x8_t a, uint8x8_t b)
+{
+	uint8x8x2_t zip = vzip_u8(a, b);
+	return vcombine_u8(zip.val[0], zip.val[1]);
+}
+
+/* 2x2 average of a 16x2 block of one channel, truncated like the SSE2 code */
+static inline uint8x8_t average_2x2(uint8x16_t line1, uint8x16_t line2)
+{
+	return vshrn_n_u16(vaddq_u16(vpaddlq_u8(line1), vpaddlq_u8(line2)), 2);
+}
+
+void compress_uyvx_to_i420_neon(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u = output[1] + (y >> 1) * out_linesize[1];
+		uint8_t *v = output[2] + (y >> 1) * out_linesize[2];
+		uint32_t x;
+
+		for (x = 0; x < width_vec; x += 16) {
+			uint8x16x4_t l1 = vld4q_u8(line1 + x * 4);
+			uint8x16x4_t l2 = vld4q_u8(line2 + x * 4);
+
+			vst1q_u8(lum0 + x, l1.val[1]);
+			vst1q_u8(lum1 + x, l2.val[1]);
+			vst1_u8(u + x / 2, average_2x2(l1.val[0], l2.val[0]));
+			vst1_u8(v + x / 2, average_2x2(l1.val[2], l2.val[2]));
+		}
+
+		uyvx_to_i420_tail(line1, line2, x, width, lum0, lum1, u, v);
+	}
+}
+
+void compress_uyvx_to_nv12_neon(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *uv = output[1] + (y >> 1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < width_vec; x += 16) {
+			uint8x16x4_t l1 = vld4q_u8(line1 + x * 4);
+			uint8x16x4_t l2 = vld4q_u8(line2 + x * 4);
+			uint8x8x2_t chroma;
+
+			vst1q_u8(lum0 + x, l1.val[1]);
+			vst1q_u8(lum1 + x, l2.val[1]);
+
+			chroma.val[0] = average_2x2(l1.val[0], l2.val[0]);
+			chroma.val[1] = average_2x2(l1.val[2], l2.val[2]);
+			vst2_u8(uv + x, chroma);
+		}
+
+		uyvx_to_nv12_tail(line1, line2, x, width, lum0, lum1, uv);
+	}
+}
+
+void convert_uyvx_to_i444_neon(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			       uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	/* like the SSE2 version, all three planes use the luma linesize */
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint8_t *line = input + y * in_linesize;
+		uint32_t pos = y * out_linesize[0];
+		uint8_t *lum = output[0] + pos;
+		uint8_t *u = output[1] + pos;
+		uint8_t *v = output[2] + pos;
+		uint32_t x;
+
+		for (x = 0; x < width_vec; x += 16) {
+			uint8x16x4_t pixels = vld4q_u8(line + x * 4);
+
+			vst1q_u8(u + x, pixels.val[0]);
+			vst1q_u8(lum + x, pixels.val[1]);
+			vst1q_u8(v + x, pixels.val[2]);
+		}
+
+		uyvx_to_i444_tail(line, x, width, lum, u, v);
+	}
+}
+
+void decompress_nv12_neon(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,
+			  uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
+	uint32_t width_d2_vec = width_d2 & ~7;
+	uint8x16_t zero = vdupq_n_u8(0);
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint32_t *output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		uint32_t *output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_d2_vec; x += 8) {
+			uint8x8x2_t uv = vld2_u8(chroma + x * 2);
+			uint8x16x4_t out;
+
+			/* output bytes: Y U V 0 */
+			out.val[1] = zip_u8(uv.val[0], uv.val[0]);
+			out.val[2] = zip_u8(uv.val[1], uv.val[1]);
+			out.val[3] = zero;
+
+			out.val[0] = vld1q_u8(lum0 + x * 2);
+			vst4q_u8((uint8_t *)(output0 + x * 2), out);
+			out.val[0] = vld1q_u8(lum1 + x * 2);
+			vst4q_u8((uint8_t *)(output1 + x * 2), out);
+		}
+
+		nv12_to_packed_tail(lum0, lum1, chroma, x, width_d2, output0, output1);
+	}
+}
+
+void decompress_420_neon(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,
+			 uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2 = in_linesize[0] / 2;
+	uint32_t width_d2_vec = width_d2 & ~7;
+	uint8x16_t zero = vdupq_n_u8(0);
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint32_t *output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		uint32_t *output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_d2_vec; x += 8) {
+			uint8x8_t u = vld1_u8(chroma0 + x);
+			uint8x8_t v = vld1_u8(chroma1 + x);
+			uint8x16x4_t out;
+
+			/* output bytes: V U Y 0 */
+			out.val[0] = zip_u8(v, v);
+			out.val[1] = zip_u8(u, u);
+			out.val[3] = zero;
+
+			out.val[2] = vld1q_u8(lum0 + x * 2);
+			vst4q_u8((uint8_t *)(output0 + x * 2), out);
+			out.val[2] = vld1q_u8(lum1 + x * 2);
+			vst4q_u8((uint8_t *)(output1 + x * 2), out);
+		}
+
+		i420_to_packed_tail(lum0, lum1, chroma0, chroma1, x, width_d2, output0, output1);
+	}
+}
+
+void decompress_422_neon(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			 uint8_t *output, uint32_t out_linesize, bool leading_lum)
+{
+	uint32_t width_d2 = min_uint32(in_linesize / 4, out_linesize / 8);
+	uint32_t width_d2_vec = width_d2 & ~7;
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint32_t *input32 = (const uint32_t *)(input + y * in_linesize);
+		uint32_t *output32 = (uint32_t *)(output + y * out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_d2_vec; x += 8) {
+			uint8x8x4_t in = vld4_u8((const uint8_t *)(input32 + x));
+			uint8x16x4_t out;
+
+			/* the second pixel of each pair: YUYV -> Y1 U Y1 V,
+			 * UYVY -> U Y1 V Y1 */
+			if (leading_lum) {
+				out.val[0] = zip_u8(in.val[0], in.val[2]);
+				out.val[1] = zip_u8(in.val[1], in.val[1]);
+			} else {
+				out.val[0] = zip_u8(in.val[0], in.val[0]);
+				out.val[1] = zip_u8(in.val[1], in.val[3]);
+			}
+			out.val[2] = zip_u8(in.val[2], in.val[2]);
+			out.val[3] = zip_u8(in.val[3], in.val[3]);
+
+			vst4q_u8((uint8_t *)(output32 + x * 2), out);
+		}
+
+		packed_422_tail(input32, x, width_d2, output32, leading_lum);
+	}
+}
+
+#endif
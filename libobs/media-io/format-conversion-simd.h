@@ -0,0 +1,164 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Internal: per-instruction-set variants of the format conversion kernels.
+ * The public functions in format-conversion.h dispatch to one of these.
+ */
+
+#include "format-conversion.h"
+#include "../util/cpu-features.h"
+
+#ifdef OS_CPU_X86
+#define FORMAT_CONVERSION_HAS_AVX2 1
+#endif
+
+#ifdef OS_CPU_ARM64
+#define FORMAT_CONVERSION_HAS_NEON 1
+#endif
+
+#define DECLARE_KERNELS(suffix)                                                                                       \
+	void compress_uyvx_to_i420_##suffix(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,            \
+					    uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[]);        \
+	void compress_uyvx_to_nv12_##suffix(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,            \
+					    uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[]);        \
+	void convert_uyvx_to_i444_##suffix(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,             \
+					   uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[]);         \
+	void decompress_nv12_##suffix(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,   \
+				      uint32_t end_y, uint8_t *output, uint32_t out_linesize);                        \
+	void decompress_420_##suffix(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,    \
+				     uint32_t end_y, uint8_t *output, uint32_t out_linesize);                         \
+	void decompress_422_##suffix(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,    \
+				     uint8_t *output, uint32_t out_linesize, bool leading_lum)
+
+DECLARE_KERNELS(sse2);
+#ifdef FORMAT_CONVERSION_HAS_AVX2
+DECLARE_KERNELS(avx2);
+#endif
+#ifdef FORMAT_CONVERSION_HAS_NEON
+DECLARE_KERNELS(neon);
+#endif
+
+#undef DECLARE_KERNELS
+
+/* ------------------------------------------------------------------------- */
+/* Scalar versions of the kernel inner loops.  The vector kernels use these  */
+/* for whatever is left of a row after the vector loop, starting at x.       */
+
+static inline uint32_t min_uint32(uint32_t a, uint32_t b)
+{
+	return a < b ? a : b;
+}
+
+/* x and width are in pixels; like the SSE2 kernels this works in groups of 4 */
+static inline void uyvx_to_420_lum_tail(const uint8_t *line1, const uint8_t *line2, uint32_t x, uint32_t width,
+					uint8_t *lum0, uint8_t *lum1)
+{
+	for (; x < width; x++) {
+		lum0[x] = line1[x * 4 + 1];
+		lum1[x] = line2[x * 4 + 1];
+	}
+}
+
+static inline uint8_t avg_2x2(const uint8_t *line1, const uint8_t *line2, uint32_t offset)
+{
+	return (uint8_t)((line1[offset] + line1[offset + 4] + line2[offset] + line2[offset + 4]) >> 2);
+}
+
+static inline void uyvx_to_i420_tail(const uint8_t *line1, const uint8_t *line2, uint32_t x, uint32_t width,
+				     uint8_t *lum0, uint8_t *lum1, uint8_t *u, uint8_t *v)
+{
+	width = (width + 3) & ~3;
+	uyvx_to_420_lum_tail(line1, line2, x, width, lum0, lum1);
+
+	for (; x < width; x += 2) {
+		u[x / 2] = avg_2x2(line1, line2, x * 4);
+		v[x / 2] = avg_2x2(line1, line2, x * 4 + 2);
+	}
+}
+
+static inline void uyvx_to_nv12_tail(const uint8_t *line1, const uint8_t *line2, uint32_t x, uint32_t width,
+				     uint8_t *lum0, uint8_t *lum1, uint8_t *uv)
+{
+	width = (width + 3) & ~3;
+	uyvx_to_420_lum_tail(line1, line2, x, width, lum0, lum1);
+
+	for (; x < width; x += 2) {
+		uv[x] = avg_2x2(line1, line2, x * 4);
+		uv[x + 1] = avg_2x2(line1, line2, x * 4 + 2);
+	}
+}
+
+static inline void uyvx_to_i444_tail(const uint8_t *line, uint32_t x, uint32_t width, uint8_t *lum, uint8_t *u,
+				     uint8_t *v)
+{
+	width = (width + 3) & ~3;
+
+	for (; x < width; x++) {
+		u[x] = line[x * 4];
+		lum[x] = line[x * 4 + 1];
+		v[x] = line[x * 4 + 2];
+	}
+}
+
+/* x and width_d2 are in pixel pairs */
+static inline void nv12_to_packed_tail(const uint8_t *lum0, const uint8_t *lum1, const uint8_t *chroma, uint32_t x,
+				       uint32_t width_d2, uint32_t *output0, uint32_t *output1)
+{
+	for (; x < width_d2; x++) {
+		uint32_t out = ((uint32_t)chroma[x * 2] | ((uint32_t)chroma[x * 2 + 1] << 8)) << 8;
+
+		output0[x * 2] = lum0[x * 2] | out;
+		output0[x * 2 + 1] = lum0[x * 2 + 1] | out;
+		output1[x * 2] = lum1[x * 2] | out;
+		output1[x * 2 + 1] = lum1[x * 2 + 1] | out;
+	}
+}
+
+static inline void i420_to_packed_tail(const uint8_t *lum0, const uint8_t *lum1, const uint8_t *chroma0,
+				       const uint8_t *chroma1, uint32_t x, uint32_t width_d2, uint32_t *output0,
+				       uint32_t *output1)
+{
+	for (; x < width_d2; x++) {
+		uint32_t out = ((uint32_t)chroma0[x] << 8) | chroma1[x];
+
+		output0[x * 2] = ((uint32_t)lum0[x * 2] << 16) | out;
+		output0[x * 2 + 1] = ((uint32_t)lum0[x * 2 + 1] << 16) | out;
+		output1[x * 2] = ((uint32_t)lum1[x * 2] << 16) | out;
+		output1[x * 2 + 1] = ((uint32_t)lum1[x * 2 + 1] << 16) | out;
+	}
+}
+
+static inline void packed_422_tail(const uint32_t *input32, uint32_t x, uint32_t width_d2, uint32_t *output32,
+				   bool leading_lum)
+{
+	for (; x < width_d2; x++) {
+		uint32_t dw = input32[x];
+
+		output32[x * 2] = dw;
+		if (leading_lum) {
+			dw &= 0xFFFFFF00;
+			dw |= (uint8_t)(dw >> 16);
+		} else {
+			dw &= 0xFFFF00FF;
+			dw |= (dw >> 16) & 0xFF00;
+		}
+		output32[x * 2 + 1] = dw;
+	}
+}
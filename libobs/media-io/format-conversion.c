@@ -15,9 +15,12 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
-#include "format-conversion.h"
+#include "format-conversion-simd.h"
 
 #include "../util/sse-intrin.h"
+#include "../util/threading.h"
+#include "../util/task.h"
+#include "../util/cpu-features.h"
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
  * CPU usage to boost by a tremendous amount in debug builds. */
@@ -72,13 +75,8 @@
 		*(uint16_t *)(v_plane + chroma_pos) = (uint16_t)(packed_vals >> 16);                           \
 	} while (false)
 
-static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
-{
-	return a < b ? a : b;
-}
-
-void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
-			   uint8_t *output[], const uint32_t out_linesize[])
+void compress_uyvx_to_i420_sse2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				uint8_t *output[], const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -109,8 +107,8 @@ void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t
 	}
 }
 
-void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
-			   uint8_t *output[], const uint32_t out_linesize[])
+void compress_uyvx_to_nv12_sse2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				uint8_t *output[], const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *chroma_plane = output[1];
@@ -140,8 +138,8 @@ void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t
 	}
 }
 
-void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
-			  uint8_t *output[], const uint32_t out_linesize[])
+void convert_uyvx_to_i444_sse2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			       uint8_t *output[], const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -173,8 +171,8 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t s
 	}
 }
 
-void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
-		    uint8_t *output, uint32_t out_linesize)
+void decompress_420_sse2(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
+			 uint8_t *output, uint32_t out_linesize)
 {
 	uint32_t start_y_d2 = start_y / 2;
 	uint32_t width_d2 = in_linesize[0] / 2;
@@ -206,8 +204,8 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	}
 }
 
-void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
-		     uint8_t *output, uint32_t out_linesize)
+void decompress_nv12_sse2(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
+			  uint8_t *output, uint32_t out_linesize)
 {
 	uint32_t start_y_d2 = start_y / 2;
 	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
@@ -238,10 +236,11 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 	}
 }
 
-void decompress_422(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y, uint8_t *output,
-		    uint32_t out_linesize, bool leading_lum)
+void decompress_422_sse2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y, uint8_t *output,
+			 uint32_t out_linesize, bool leading_lum)
 {
-	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
+	/* one input dword is two pixels, which become two output dwords */
+	uint32_t width_d2 = min_uint32(in_linesize / 4, out_linesize / 8);
 	uint32_t y;
 
 	register const uint32_t *input32;
@@ -286,3 +285,318 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize, uint32_t start_y
 		}
 	}
 }
+
+/* ------------------------------------------------------------------------- */
+/* runtime dispatch                                                          */
+
+struct format_conversion_funcs {
+	void (*compress_uyvx_to_i420)(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				      uint8_t *output[], const uint32_t out_linesize[]);
+	void (*compress_uyvx_to_nv12)(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				      uint8_t *output[], const uint32_t out_linesize[]);
+	void (*convert_uyvx_to_i444)(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				     uint8_t *output[], const uint32_t out_linesize[]);
+	void (*decompress_nv12)(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,
+				uint32_t end_y, uint8_t *output, uint32_t out_linesize);
+	void (*decompress_420)(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y,
+			       uint32_t end_y, uint8_t *output, uint32_t out_linesize);
+	void (*decompress_422)(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			       uint8_t *output, uint32_t out_linesize, bool leading_lum);
+};
+
+#define KERNEL_FUNCS(suffix)                                                                             \
+	{                                                                                                \
+		compress_uyvx_to_i420_##suffix, compress_uyvx_to_nv12_##suffix,                          \
+			convert_uyvx_to_i444_##suffix, decompress_nv12_##suffix, decompress_420_##suffix, \
+			decompress_422_##suffix                                                          \
+	}
+
+static const struct format_conversion_funcs kernel_funcs[] = {
+	[FORMAT_CONVERSION_SIMD_SSE2] = KERNEL_FUNCS(sse2),
+#ifdef FORMAT_CONVERSION_HAS_AVX2
+	[FORMAT_CONVERSION_SIMD_AVX2] = KERNEL_FUNCS(avx2),
+#endif
+#ifdef FORMAT_CONVERSION_HAS_NEON
+	[FORMAT_CONVERSION_SIMD_NEON] = KERNEL_FUNCS(neon),
+#endif
+};
+
+#undef KERNEL_FUNCS
+
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+static volatile long cur_simd = FORMAT_CONVERSION_SIMD_SSE2;
+
+bool format_conversion_simd_supported(enum format_conversion_simd simd)
+{
+	switch (simd) {
+	case FORMAT_CONVERSION_SIMD_SSE2:
+		return true;
+	case FORMAT_CONVERSION_SIMD_AVX2:
+#ifdef FORMAT_CONVERSION_HAS_AVX2
+		return os_cpu_has_avx2();
+#else
+		return false;
+#endif
+	case FORMAT_CONVERSION_SIMD_NEON:
+#ifdef FORMAT_CONVERSION_HAS_NEON
+		/* always available on aarch64 */
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	return false;
+}
+
+static void init_simd(void)
+{
+	enum format_conversion_simd simd = FORMAT_CONVERSION_SIMD_SSE2;
+
+	if (format_conversion_simd_supported(FORMAT_CONVERSION_SIMD_AVX2))
+		simd = FORMAT_CONVERSION_SIMD_AVX2;
+	else if (format_conversion_simd_supported(FORMAT_CONVERSION_SIMD_NEON))
+		simd = FORMAT_CONVERSION_SIMD_NEON;
+
+	os_atomic_set_long(&cur_simd, (long)simd);
+}
+
+static inline const struct format_conversion_funcs *get_funcs(void)
+{
+	pthread_once(&simd_once, init_simd);
+	return &kernel_funcs[os_atomic_load_long(&cur_simd)];
+}
+
+enum format_conversion_simd format_conversion_get_simd(void)
+{
+	pthread_once(&simd_once, init_simd);
+	return (enum format_conversion_simd)os_atomic_load_long(&cur_simd);
+}
+
+bool format_conversion_set_simd(enum format_conversion_simd simd)
+{
+	if (!format_conversion_simd_supported(simd))
+		return false;
+
+	pthread_once(&simd_once, init_simd);
+	os_atomic_set_long(&cur_simd, (long)simd);
+	return true;
+}
+
+void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			   uint8_t *output[], const uint32_t out_linesize[])
+{
+	get_funcs()->compress_uyvx_to_i420(input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			   uint8_t *output[], const uint32_t out_linesize[])
+{
+	get_funcs()->compress_uyvx_to_nv12(input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			  uint8_t *output[], const uint32_t out_linesize[])
+{
+	get_funcs()->convert_uyvx_to_i444(input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
+		     uint8_t *output, uint32_t out_linesize)
+{
+	get_funcs()->decompress_nv12(input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
+		    uint8_t *output, uint32_t out_linesize)
+{
+	get_funcs()->decompress_420(input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void decompress_422(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y, uint8_t *output,
+		    uint32_t out_linesize, bool leading_lum)
+{
+	get_funcs()->decompress_422(input, in_linesize, start_y, end_y, output, out_linesize, leading_lum);
+}
+
+/* ------------------------------------------------------------------------- */
+/* slice-parallel driver                                                     */
+
+/* slices smaller than this aren't worth waking up a thread for */
+#define MIN_SLICE_ROWS 16
+
+/* more slices than threads, so that threads that get preempted or finish
+ * early don't hold up the rest */
+#define SLICES_PER_THREAD 4
+
+enum slice_kernel {
+	SLICE_UYVX_TO_I420,
+	SLICE_UYVX_TO_NV12,
+	SLICE_UYVX_TO_I444,
+	SLICE_NV12_TO_PACKED,
+	SLICE_420_TO_PACKED,
+	SLICE_422_TO_PACKED,
+};
+
+struct slice_job {
+	enum slice_kernel kernel;
+	const struct format_conversion_funcs *funcs;
+	uint32_t start_y;
+	uint32_t end_y;
+	uint32_t slice_height;
+
+	const uint8_t *packed_in;
+	uint32_t packed_in_linesize;
+	uint8_t **planar_out;
+	const uint32_t *planar_out_linesize;
+
+	const uint8_t *const *planar_in;
+	const uint32_t *planar_in_linesize;
+	uint8_t *packed_out;
+	uint32_t packed_out_linesize;
+	bool leading_lum;
+};
+
+static void convert_slice(struct slice_job *job, uint32_t start_y, uint32_t end_y)
+{
+	const struct format_conversion_funcs *funcs = job->funcs;
+
+	switch (job->kernel) {
+	case SLICE_UYVX_TO_I420:
+		funcs->compress_uyvx_to_i420(job->packed_in, job->packed_in_linesize, start_y, end_y, job->planar_out,
+					     job->planar_out_linesize);
+		break;
+	case SLICE_UYVX_TO_NV12:
+		funcs->compress_uyvx_to_nv12(job->packed_in, job->packed_in_linesize, start_y, end_y, job->planar_out,
+					     job->planar_out_linesize);
+		break;
+	case SLICE_UYVX_TO_I444:
+		funcs->convert_uyvx_to_i444(job->packed_in, job->packed_in_linesize, start_y, end_y, job->planar_out,
+					    job->planar_out_linesize);
+		break;
+	case SLICE_NV12_TO_PACKED:
+		funcs->decompress_nv12(job->planar_in, job->planar_in_linesize, start_y, end_y, job->packed_out,
+				       job->packed_out_linesize);
+		break;
+	case SLICE_420_TO_PACKED:
+		funcs->decompress_420(job->planar_in, job->planar_in_linesize, start_y, end_y, job->packed_out,
+				      job->packed_out_linesize);
+		break;
+	case SLICE_422_TO_PACKED:
+		funcs->decompress_422(job->packed_in, job->packed_in_linesize, start_y, end_y, job->packed_out,
+				      job->packed_out_linesize, job->leading_lum);
+		break;
+	}
+}
+
+static void convert_slice_work(void *param, size_t idx)
+{
+	struct slice_job *job = param;
+	uint32_t start_y = job->start_y + (uint32_t)idx * job->slice_height;
+	uint32_t end_y = min_uint32(start_y + job->slice_height, job->end_y);
+
+	convert_slice(job, start_y, end_y);
+}
+
+static void run_slices(os_work_pool_t *pool, struct slice_job *job)
+{
+	uint32_t rows = job->end_y - job->start_y;
+	size_t num_slices;
+
+	job->funcs = get_funcs();
+
+	if (!pool || rows < MIN_SLICE_ROWS * 2) {
+		convert_slice(job, job->start_y, job->end_y);
+		return;
+	}
+
+	num_slices = (os_work_pool_num_threads(pool) + 1) * SLICES_PER_THREAD;
+	job->slice_height = (uint32_t)((rows + num_slices - 1) / num_slices);
+	if (job->slice_height < MIN_SLICE_ROWS)
+		job->slice_height = MIN_SLICE_ROWS;
+
+	/* the 4:2:0 kernels work on pairs of rows */
+	job->slice_height = (job->slice_height + 1) & ~1;
+
+	num_slices = (rows + job->slice_height - 1) / job->slice_height;
+	os_work_pool_run(pool, convert_slice_work, job, num_slices);
+}
+
+void compress_uyvx_to_i420_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+				  uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	struct slice_job job = {.kernel = SLICE_UYVX_TO_I420,
+				.start_y = start_y,
+				.end_y = end_y,
+				.packed_in = input,
+				.packed_in_linesize = in_linesize,
+				.planar_out = output,
+				.planar_out_linesize = out_linesize};
+	run_slices(pool, &job);
+}
+
+void compress_uyvx_to_nv12_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+				  uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	struct slice_job job = {.kernel = SLICE_UYVX_TO_NV12,
+				.start_y = start_y,
+				.end_y = end_y,
+				.packed_in = input,
+				.packed_in_linesize = in_linesize,
+				.planar_out = output,
+				.planar_out_linesize = out_linesize};
+	run_slices(pool, &job);
+}
+
+void convert_uyvx_to_i444_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+				 uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	struct slice_job job = {.kernel = SLICE_UYVX_TO_I444,
+				.start_y = start_y,
+				.end_y = end_y,
+				.packed_in = input,
+				.packed_in_linesize = in_linesize,
+				.planar_out = output,
+				.planar_out_linesize = out_linesize};
+	run_slices(pool, &job);
+}
+
+void decompress_nv12_sliced(os_work_pool_t *pool, const uint8_t *const input[], const uint32_t in_linesize[],
+			    uint32_t start_y, uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	struct slice_job job = {.kernel = SLICE_NV12_TO_PACKED,
+				.start_y = start_y,
+				.end_y = end_y,
+				.planar_in = input,
+				.planar_in_linesize = in_linesize,
+				.packed_out = output,
+				.packed_out_linesize = out_linesize};
+	run_slices(pool, &job);
+}
+
+void decompress_420_sliced(os_work_pool_t *pool, const uint8_t *const input[], const uint32_t in_linesize[],
+			   uint32_t start_y, uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	struct slice_job job = {.kernel = SLICE_420_TO_PACKED,
+				.start_y = start_y,
+				.end_y = end_y,
+				.planar_in = input,
+				.planar_in_linesize = in_linesize,
+				.packed_out = output,
+				.packed_out_linesize = out_linesize};
+	run_slices(pool, &job);
+}
+
+void decompress_422_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+			   uint32_t end_y, uint8_t *output, uint32_t out_linesize, bool leading_lum)
+{
+	struct slice_job job = {.kernel = SLICE_422_TO_PACKED,
+				.start_y = start_y,
+				.end_y = end_y,
+				.packed_in = input,
+				.packed_in_linesize = in_linesize,
+				.packed_out = output,
+				.packed_out_linesize = out_linesize,
+				.leading_lum = leading_lum};
+	run_slices(pool, &job);
+}
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "../util/c99defs.h"
+#include "../util/task.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +46,50 @@ EXPORT void decompress_420(const uint8_t *const input[], const uint32_t in_lines
 EXPORT void decompress_422(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
 			   uint8_t *output, uint32_t out_linesize, bool leading_lum);
 
+/*
+ * Slice-parallel versions of the functions above.  The rows in
+ * [start_y, end_y) are split into slices which are converted on the given
+ * work pool; with a NULL pool the conversion runs on the calling thread.
+ * Must not be called from a work item running on the same pool.
+ */
+
+EXPORT void compress_uyvx_to_i420_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize,
+					 uint32_t start_y, uint32_t end_y, uint8_t *output[],
+					 const uint32_t out_linesize[]);
+
+EXPORT void compress_uyvx_to_nv12_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize,
+					 uint32_t start_y, uint32_t end_y, uint8_t *output[],
+					 const uint32_t out_linesize[]);
+
+EXPORT void convert_uyvx_to_i444_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize,
+					uint32_t start_y, uint32_t end_y, uint8_t *output[],
+					const uint32_t out_linesize[]);
+
+EXPORT void decompress_nv12_sliced(os_work_pool_t *pool, const uint8_t *const input[], const uint32_t in_linesize[],
+				   uint32_t start_y, uint32_t end_y, uint8_t *output, uint32_t out_linesize);
+
+EXPORT void decompress_420_sliced(os_work_pool_t *pool, const uint8_t *const input[], const uint32_t in_linesize[],
+				  uint32_t start_y, uint32_t end_y, uint8_t *output, uint32_t out_linesize);
+
+EXPORT void decompress_422_sliced(os_work_pool_t *pool, const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+				  uint32_t end_y, uint8_t *output, uint32_t out_linesize, bool leading_lum);
+
+/*
+ * Instruction set used by the conversion functions.  The fastest one the CPU
+ * supports is selected on first use; overriding it is mainly useful for
+ * testing and benchmarking.
+ */
+
+enum format_conversion_simd {
+	FORMAT_CONVERSION_SIMD_SSE2, /* SSE2, emulated through SIMDe on non-x86 */
+	FORMAT_CONVERSION_SIMD_AVX2,
+	FORMAT_CONVERSION_SIMD_NEON,
+};
+
+EXPORT bool format_conversion_simd_supported(enum format_conversion_simd simd);
+EXPORT enum format_conversion_simd format_conversion_get_simd(void);
+EXPORT bool format_conversion_set_simd(enum format_conversion_simd simd);
+
 #ifdef __cplusplus
 }
 #endif
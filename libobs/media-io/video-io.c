@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/deque.h"
 #include "../util/util_uint64.h"
 
 #include "format-conversion.h"
@@ -33,18 +34,53 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
+#define MAX_INPUT_QUEUE_SIZE 4
 
 struct cached_frame_info {
 	struct video_data frame;
 	int skipped;
 	int count;
+
+	/* number of queued references held by threaded inputs, the frame
+	 * cannot be reused until all of them have been released */
+	long refs;
+	bool in_use;
+	bool done;
+
+	/* identifies the frame's contents, repeated frames keep it */
+	uint64_t seq;
+};
+
+struct queued_frame {
+	struct video_data frame;
+	size_t cache_idx;
+	uint64_t seq;
+	int count;
+};
+
+struct scaled_frame {
+	struct video_frame frame;
+	uint64_t seq;
+	long refs;
+};
+
+/* a CPU conversion shared by all inputs that request the same format, size,
+ * color space and frame rate divisor.  each frame is only converted once, the
+ * first input that needs it converts it and the other inputs get the same
+ * scaled frame.  scaled frames aren't reused while an input still uses them. */
+struct video_conversion {
+	struct video_scale_info info;
+	uint32_t frame_rate_divisor;
+	video_scaler_t *scaler;
+	long inputs;
+
+	pthread_mutex_t mutex;
+	DARRAY(struct scaled_frame *) frames;
 };
 
 struct video_input {
 	struct video_scale_info conversion;
-	video_scaler_t *scaler;
-	struct video_frame frame[MAX_CONVERT_BUFFERS];
-	int cur_frame;
+	struct video_conversion *convert;
 
 	// allow outputting at fractions of main composition FPS,
 	// e.g. 60 FPS with frame_rate_divisor = 1 turns into 30 FPS
@@ -58,14 +94,23 @@ struct video_input {
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
-};
 
-static inline void video_input_free(struct video_input *input)
-{
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
-}
+	// threaded inputs get their own thread and a bounded frame queue so
+	// that a slow input (e.g. an encoder) doesn't delay all other inputs
+	bool threaded;
+	pthread_t thread;
+	os_sem_t *queue_sem;
+	pthread_mutex_t queue_mutex;
+	struct deque queue;
+	size_t queue_limit;
+	uint64_t frame_interval;
+	struct video_output *video;
+	volatile bool stop;
+
+	volatile long queue_depth;
+	volatile long max_queue_depth;
+	volatile long dropped_frames;
+};
 
 struct video_output {
 	struct video_output_info info;
@@ -80,52 +125,190 @@ struct video_output {
 	volatile long total_frames;
 
 	pthread_mutex_t input_mutex;
-	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_input *) inputs;
+	DARRAY(struct video_conversion *) conversions;
 
+	/* threaded inputs that disconnected themselves from their own thread,
+	 * joined on the next connect or disconnect */
+	DARRAY(struct video_input *) stopped_inputs;
+	volatile long scaled_frames;
+	volatile long shared_frames;
+
+	/* frames are sent out in the order they were added, but go back to
+	 * the cache in any order, as threaded inputs release them */
 	size_t available_frames;
-	size_t first_added;
 	size_t last_added;
+	size_t pending[MAX_CACHE_SIZE];
+	size_t first_pending;
+	size_t num_pending;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
+	uint64_t frame_seq;
 
 	struct video_output *parent;
 
 	volatile bool raw_active;
 	volatile long gpu_refs;
+	volatile bool threaded_inputs;
+	volatile long scaler_threads;
 };
 
 /* ------------------------------------------------------------------------- */
 
-static inline bool scale_video_output(struct video_input *input, struct video_data *data)
+static struct scaled_frame *get_scaled_frame(struct video_output *video, struct video_conversion *conv,
+					     const struct video_data *data, uint64_t seq)
 {
-	bool success = true;
+	struct scaled_frame *frame = NULL;
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	pthread_mutex_lock(&conv->mutex);
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	for (size_t i = 0; i < conv->frames.num; i++) {
+		if (conv->frames.array[i]->seq == seq) {
+			frame = conv->frames.array[i];
+			frame->refs++;
+			os_atomic_inc_long(&video->shared_frames);
+			pthread_mutex_unlock(&conv->mutex);
+			return frame;
+		}
+	}
 
-		frame = &input->frame[input->cur_frame];
+	/* overwrite the oldest frame that isn't in use */
+	for (size_t i = 0; i < conv->frames.num; i++) {
+		struct scaled_frame *cur = conv->frames.array[i];
+		if (!cur->refs && (!frame || cur->seq < frame->seq))
+			frame = cur;
+	}
 
-		success = video_scaler_scale(input->scaler, frame->data, frame->linesize,
-					     (const uint8_t *const *)data->data, data->linesize);
+	if (!frame) {
+		frame = bzalloc(sizeof(*frame));
+		video_frame_init(&frame->frame, conv->info.format, conv->info.width, conv->info.height);
+		da_push_back(conv->frames, &frame);
+	}
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
+	/* the scaler is only used with the mutex locked, inputs that need the
+	 * same frame wait for it here */
+	if (!video_scaler_scale(conv->scaler, frame->frame.data, frame->frame.linesize,
+				(const uint8_t *const *)data->data, data->linesize)) {
+		frame->seq = 0;
+		frame = NULL;
+	} else {
+		frame->seq = seq;
+		frame->refs = 1;
+		os_atomic_inc_long(&video->scaled_frames);
+	}
+
+	pthread_mutex_unlock(&conv->mutex);
+	return frame;
+}
+
+static inline void release_scaled_frame(struct video_conversion *conv, struct scaled_frame *frame)
+{
+	pthread_mutex_lock(&conv->mutex);
+	frame->refs--;
+	pthread_mutex_unlock(&conv->mutex);
+}
+
+static void send_input_frame(struct video_input *input, struct video_data *data, uint64_t seq)
+{
+	struct scaled_frame *scaled = NULL;
+
+	if (input->convert) {
+		scaled = get_scaled_frame(input->video, input->convert, data, seq);
+		if (!scaled) {
 			blog(LOG_WARNING, "video-io: Could not scale frame!");
+			return;
+		}
+
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			data->data[i] = scaled->frame.data[i];
+			data->linesize[i] = scaled->frame.linesize[i];
 		}
 	}
 
-	return success;
+	input->callback(input->param, data);
+
+	if (scaled)
+		release_scaled_frame(input->convert, scaled);
+}
+
+/* data_mutex must be locked.  each frame goes back to the cache on its own
+ * once it has been sent out and released by all threaded inputs, so a frame
+ * held by a slow input doesn't hold back any newer frames */
+static inline void release_cached_frame(struct video_output *video, size_t cache_idx)
+{
+	struct cached_frame_info *frame_info = &video->cache[cache_idx];
+
+	if (!frame_info->in_use || !frame_info->done || frame_info->refs)
+		return;
+
+	frame_info->done = false;
+	frame_info->in_use = false;
+	video->available_frames++;
+}
+
+static inline void push_pending_frame(struct video_output *video, size_t cache_idx)
+{
+	size_t idx = (video->first_pending + video->num_pending++) % video->info.cache_size;
+	video->pending[idx] = cache_idx;
+}
+
+static inline void pop_pending_frame(struct video_output *video)
+{
+	if (++video->first_pending == video->info.cache_size)
+		video->first_pending = 0;
+	video->num_pending--;
+}
+
+static void release_queued_frame(struct video_output *video, size_t cache_idx)
+{
+	pthread_mutex_lock(&video->data_mutex);
+	video->cache[cache_idx].refs--;
+	release_cached_frame(video, cache_idx);
+	pthread_mutex_unlock(&video->data_mutex);
+}
+
+static void queue_input_frame(struct video_output *video, struct video_input *input, const struct video_data *frame,
+			      size_t cache_idx, uint64_t seq)
+{
+	struct queued_frame qf = {.frame = *frame, .cache_idx = cache_idx, .seq = seq, .count = 1};
+	long depth;
+
+	pthread_mutex_lock(&input->queue_mutex);
+
+	depth = (long)(input->queue.size / sizeof(qf));
+
+	/* if the input can't keep up, repeat the newest queued frame rather
+	 * than holding on to more cached frames.  this keeps the number of
+	 * frames delivered to the input (and thus its timing) intact. */
+	if (depth >= (long)input->queue_limit) {
+		struct queued_frame *last = deque_data(&input->queue, input->queue.size - sizeof(qf));
+		last->count++;
+
+		os_atomic_inc_long(&input->dropped_frames);
+		os_atomic_inc_long(&video->skipped_frames);
+		pthread_mutex_unlock(&input->queue_mutex);
+		return;
+	}
+
+	pthread_mutex_lock(&video->data_mutex);
+	video->cache[cache_idx].refs++;
+	pthread_mutex_unlock(&video->data_mutex);
+
+	deque_push_back(&input->queue, &qf, sizeof(qf));
+
+	os_atomic_set_long(&input->queue_depth, ++depth);
+	if (depth > os_atomic_load_long(&input->max_queue_depth))
+		os_atomic_set_long(&input->max_queue_depth, depth);
+
+	pthread_mutex_unlock(&input->queue_mutex);
+
+	os_sem_post(input->queue_sem);
 }
 
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
+	size_t cache_idx;
+	uint64_t seq;
 	bool complete;
 	bool skipped;
 
@@ -133,7 +316,9 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	pthread_mutex_lock(&video->data_mutex);
 
-	frame_info = &video->cache[video->first_added];
+	cache_idx = video->pending[video->first_pending];
+	frame_info = &video->cache[cache_idx];
+	seq = frame_info->seq;
 
 	pthread_mutex_unlock(&video->data_mutex);
 
@@ -142,7 +327,7 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		struct video_data frame = frame_info->frame;
 
 		// an explicit counter is used instead of remainder calculation
@@ -155,8 +340,10 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		if (skip)
 			continue;
 
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
+		if (input->threaded)
+			queue_input_frame(video, input, &frame, cache_idx, seq);
+		else
+			send_input_frame(input, &frame, seq);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -169,17 +356,19 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	complete = --frame_info->count == 0;
 	skipped = frame_info->skipped > 0;
 
-	if (complete) {
-		if (++video->first_added == video->info.cache_size)
-			video->first_added = 0;
-
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
-	} else if (skipped) {
+	/* every send but the first one of a frame is a repeat, this includes
+	 * the last send of a frame that is sent out again */
+	if (skipped) {
 		--frame_info->skipped;
 		os_atomic_inc_long(&video->skipped_frames);
 	}
 
+	if (complete) {
+		frame_info->done = true;
+		pop_pending_frame(video);
+		release_cached_frame(video, cache_idx);
+	}
+
 	pthread_mutex_unlock(&video->data_mutex);
 
 	/* -------------------------------- */
@@ -214,6 +403,171 @@ static void *video_thread(void *param)
 	return NULL;
 }
 
+static void video_input_free(struct video_input *input);
+
+static void *video_input_thread(void *param)
+{
+	struct video_input *input = param;
+	struct video_output *video = input->video;
+
+	os_set_thread_name("video-io: input thread");
+
+	while (os_sem_wait(input->queue_sem) == 0) {
+		struct queued_frame qf;
+
+		if (os_atomic_load_bool(&input->stop))
+			break;
+
+		pthread_mutex_lock(&input->queue_mutex);
+		deque_pop_front(&input->queue, &qf, sizeof(qf));
+		os_atomic_set_long(&input->queue_depth, (long)(input->queue.size / sizeof(qf)));
+		pthread_mutex_unlock(&input->queue_mutex);
+
+		for (int i = 0; i < qf.count; i++) {
+			struct video_data frame = qf.frame;
+			frame.timestamp += input->frame_interval * i;
+
+			if (os_atomic_load_bool(&input->stop))
+				break;
+			send_input_frame(input, &frame, qf.seq);
+		}
+
+		release_queued_frame(video, qf.cache_idx);
+	}
+
+	return NULL;
+}
+
+static void video_conversion_release(struct video_output *video, struct video_conversion *conv)
+{
+	if (!conv)
+		return;
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	if (--conv->inputs) {
+		pthread_mutex_unlock(&video->input_mutex);
+		return;
+	}
+
+	da_erase_item(video->conversions, &conv);
+	pthread_mutex_unlock(&video->input_mutex);
+
+	for (size_t i = 0; i < conv->frames.num; i++) {
+		video_frame_free(&conv->frames.array[i]->frame);
+		bfree(conv->frames.array[i]);
+	}
+
+	da_free(conv->frames);
+	video_scaler_destroy(conv->scaler);
+	pthread_mutex_destroy(&conv->mutex);
+	bfree(conv);
+}
+
+static void video_input_free(struct video_input *input)
+{
+	video_conversion_release(input->video, input->convert);
+
+	if (input->threaded) {
+		os_sem_destroy(input->queue_sem);
+		pthread_mutex_destroy(&input->queue_mutex);
+		deque_free(&input->queue);
+	}
+
+	bfree(input);
+}
+
+static bool video_input_start_thread(struct video_input *input, struct video_output *video)
+{
+	input->frame_interval = video->frame_time * input->frame_rate_divisor;
+	input->queue_limit = video->info.cache_size / 2;
+	if (input->queue_limit > MAX_INPUT_QUEUE_SIZE)
+		input->queue_limit = MAX_INPUT_QUEUE_SIZE;
+	if (!input->queue_limit)
+		input->queue_limit = 1;
+
+	if (pthread_mutex_init(&input->queue_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&input->queue_sem, 0) != 0)
+		goto fail1;
+	if (pthread_create(&input->thread, NULL, video_input_thread, input) != 0)
+		goto fail2;
+
+	input->threaded = true;
+	return true;
+
+fail2:
+	os_sem_destroy(input->queue_sem);
+fail1:
+	pthread_mutex_destroy(&input->queue_mutex);
+	return false;
+}
+
+/* releases any frames still queued, input_mutex must be locked */
+static void video_input_drain(struct video_input *input)
+{
+	struct queued_frame qf;
+
+	pthread_mutex_lock(&input->queue_mutex);
+	while (input->queue.size) {
+		deque_pop_front(&input->queue, &qf, sizeof(qf));
+		release_queued_frame(input->video, qf.cache_idx);
+	}
+	os_atomic_set_long(&input->queue_depth, 0);
+	pthread_mutex_unlock(&input->queue_mutex);
+}
+
+static void video_input_destroy(struct video_input *input)
+{
+	if (input->threaded) {
+		os_atomic_set_bool(&input->stop, true);
+		os_sem_post(input->queue_sem);
+
+		/* an input can disconnect itself from its own callback (for
+		 * example when an encoder fails), in which case the thread
+		 * can't be joined.  let the thread finish the frame it's on,
+		 * it's joined and freed on the next connect or disconnect, or
+		 * when the output is closed. */
+		if (pthread_equal(pthread_self(), input->thread)) {
+			video_input_drain(input);
+			da_push_back(input->video->stopped_inputs, &input);
+			return;
+		}
+
+		pthread_join(input->thread, NULL);
+		video_input_drain(input);
+	}
+
+	video_input_free(input);
+}
+
+/* joined without input_mutex locked, as the threads may still be in their
+ * callback */
+static void join_stopped_inputs(struct video_output *video)
+{
+	DARRAY(struct video_input *) inputs;
+
+	da_init(inputs);
+
+	pthread_mutex_lock(&video->input_mutex);
+	for (size_t i = video->stopped_inputs.num; i > 0; i--) {
+		struct video_input *input = video->stopped_inputs.array[i - 1];
+
+		if (!pthread_equal(pthread_self(), input->thread)) {
+			da_push_back(inputs, &input);
+			da_erase(video->stopped_inputs, i - 1);
+		}
+	}
+	pthread_mutex_unlock(&video->input_mutex);
+
+	for (size_t i = 0; i < inputs.num; i++) {
+		pthread_join(inputs.array[i]->thread, NULL);
+		video_input_free(inputs.array[i]);
+	}
+
+	da_free(inputs);
+}
+
 /* ------------------------------------------------------------------------- */
 
 static inline bool valid_video_params(const struct video_output_info *info)
@@ -285,13 +639,18 @@ void video_output_close(video_t *video)
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_destroy(video->inputs.array[i]);
 	da_free(video->inputs);
 
+	pthread_mutex_unlock(&video->input_mutex);
+
+	join_stopped_inputs(video);
+	da_free(video->stopped_inputs);
+	da_free(video->conversions);
+
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame *)&video->cache[i]);
 
-	pthread_mutex_unlock(&video->input_mutex);
 	os_sem_destroy(video->update_semaphore);
 	pthread_mutex_destroy(&video->data_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
@@ -303,7 +662,7 @@ static size_t video_get_input_idx(const video_t *video, void (*callback)(void *p
 				  void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -337,33 +696,94 @@ static bool match_space(enum video_colorspace a, enum video_colorspace b)
 	return (a == VIDEO_CS_DEFAULT) || (b == VIDEO_CS_DEFAULT) || (collapse_space(a) == collapse_space(b));
 }
 
+static inline bool same_conversion(const struct video_conversion *conv, const struct video_scale_info *info,
+				   uint32_t frame_rate_divisor)
+{
+	return conv->frame_rate_divisor == frame_rate_divisor && conv->info.format == info->format &&
+	       conv->info.width == info->width && conv->info.height == info->height &&
+	       conv->info.range == info->range && conv->info.colorspace == info->colorspace;
+}
+
+static struct video_conversion *video_conversion_create(struct video_output *video,
+							const struct video_scale_info *info,
+							uint32_t frame_rate_divisor)
+{
+	struct video_conversion *conv = bzalloc(sizeof(*conv));
+	struct video_scale_info from = {.format = video->info.format,
+					.width = video->info.width,
+					.height = video->info.height,
+					.range = video->info.range,
+					.colorspace = video->info.colorspace};
+
+	uint32_t threads = (uint32_t)os_atomic_load_long(&video->scaler_threads);
+	int ret = video_scaler_create2(&conv->scaler, info, &from, VIDEO_SCALE_FAST_BILINEAR, threads,
+				       VIDEO_SCALER_FAST_PATH);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+					"scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+					"create scaler");
+
+		bfree(conv);
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&conv->mutex, NULL) != 0) {
+		video_scaler_destroy(conv->scaler);
+		bfree(conv);
+		return NULL;
+	}
+
+	conv->info = *info;
+	conv->frame_rate_divisor = frame_rate_divisor;
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++) {
+		struct scaled_frame *frame = bzalloc(sizeof(*frame));
+		video_frame_init(&frame->frame, info->format, info->width, info->height);
+		da_push_back(conv->frames, &frame);
+	}
+
+	da_push_back(video->conversions, &conv);
+	return conv;
+}
+
+/* input_mutex must be locked */
 static inline bool video_input_init(struct video_input *input, struct video_output *video)
 {
 	if (input->conversion.width != video->info.width || input->conversion.height != video->info.height ||
 	    input->conversion.format != video->info.format ||
 	    !match_range(input->conversion.range, video->info.range) ||
 	    !match_space(input->conversion.colorspace, video->info.colorspace)) {
-		struct video_scale_info from = {.format = video->info.format,
-						.width = video->info.width,
-						.height = video->info.height,
-						.range = video->info.range,
-						.colorspace = video->info.colorspace};
-
-		int ret = video_scaler_create(&input->scaler, &input->conversion, &from, VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-						"scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-						"create scaler");
-
-			return false;
+
+		for (size_t i = 0; i < video->conversions.num; i++) {
+			struct video_conversion *conv = video->conversions.array[i];
+
+			if (same_conversion(conv, &input->conversion, input->frame_rate_divisor)) {
+				input->convert = conv;
+				break;
+			}
 		}
 
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i], input->conversion.format, input->conversion.width,
-					 input->conversion.height);
+		if (input->convert) {
+			/* skip the same frames as the other inputs, so every
+			 * frame is only converted once */
+			for (size_t i = 0; i < video->inputs.num; i++) {
+				struct video_input *other = video->inputs.array[i];
+
+				if (other->convert == input->convert) {
+					input->frame_rate_divisor_counter = other->frame_rate_divisor_counter;
+					break;
+				}
+			}
+		} else {
+			input->convert = video_conversion_create(video, &input->conversion, input->frame_rate_divisor);
+			if (!input->convert)
+				return false;
+		}
+
+		input->convert->inputs++;
 	}
 
 	return true;
@@ -405,33 +825,42 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 	if (!video || !callback || frame_rate_divisor == 0)
 		return false;
 
+	join_stopped_inputs(video);
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(*input));
 
-		input.callback = callback;
-		input.param = param;
+		input->video = video;
+		input->callback = callback;
+		input->param = param;
 
-		input.frame_rate_divisor = frame_rate_divisor;
+		input->frame_rate_divisor = frame_rate_divisor;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format = video->info.format;
-			input.conversion.width = video->info.width;
-			input.conversion.height = video->info.height;
-			input.conversion.range = video->info.range;
-			input.conversion.colorspace = video->info.colorspace;
+			input->conversion.format = video->info.format;
+			input->conversion.width = video->info.width;
+			input->conversion.height = video->info.height;
+			input->conversion.range = video->info.range;
+			input->conversion.colorspace = video->info.colorspace;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
+
+		success = video_input_init(input, video);
+		if (success && os_atomic_load_bool(&video->threaded_inputs)) {
+			if (!video_input_start_thread(input, video))
+				blog(LOG_WARNING, "video_output_connect: Failed to "
+						  "create input thread, falling "
+						  "back to the video thread");
+		}
 
-		success = video_input_init(&input, video);
 		if (success) {
 			if (video->inputs.num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
@@ -440,6 +869,8 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 				os_atomic_set_bool(&video->raw_active, true);
 			}
 			da_push_back(video->inputs, &input);
+		} else {
+			video_input_free(input);
 		}
 	}
 
@@ -474,12 +905,15 @@ bool video_output_disconnect2(video_t *video, void (*callback)(void *param, stru
 
 	video = get_root(video);
 
+	join_stopped_inputs(video);
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
+		struct video_input *input = video->inputs.array[idx];
 		da_erase(video->inputs, idx);
+		video_input_destroy(input);
 
 		if (video->inputs.num == 0) {
 			os_atomic_set_bool(&video->raw_active, false);
@@ -519,20 +953,40 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame, int coun
 	pthread_mutex_lock(&video->data_mutex);
 
 	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
+		cfi = &video->cache[video->last_added];
+
+		/* the newest frame may have already been sent out and only be
+		 * held by threaded inputs, in which case it has to be sent
+		 * out again */
+		if (cfi->done) {
+			cfi->done = false;
+			cfi->count = 0;
+			cfi->skipped = 0;
+			push_pending_frame(video, video->last_added);
+			os_sem_post(video->update_semaphore);
+		}
+
+		cfi->count += count;
+		cfi->skipped += count;
 		locked = false;
 
 	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
+		/* take the next free frame after the newest one, which is the
+		 * oldest one unless threaded inputs still hold some */
+		size_t idx = video->last_added;
+		while (video->cache[idx].in_use) {
+			if (++idx == video->info.cache_size)
+				idx = 0;
 		}
 
-		cfi = &video->cache[video->last_added];
+		video->last_added = idx;
+
+		cfi = &video->cache[idx];
+		cfi->in_use = true;
 		cfi->frame.timestamp = timestamp;
 		cfi->count = count;
 		cfi->skipped = 0;
+		cfi->seq = ++video->frame_seq;
 
 		memcpy(frame, &cfi->frame, sizeof(*frame));
 
@@ -554,6 +1008,7 @@ void video_output_unlock_frame(video_t *video)
 	pthread_mutex_lock(&video->data_mutex);
 
 	video->available_frames--;
+	push_pending_frame(video, video->last_added);
 	os_sem_post(video->update_semaphore);
 
 	pthread_mutex_unlock(&video->data_mutex);
@@ -623,6 +1078,80 @@ uint32_t video_output_get_total_frames(const video_t *video)
 	return (uint32_t)os_atomic_load_long(&get_const_root(video)->total_frames);
 }
 
+void video_output_set_threaded_inputs(video_t *video, bool threaded)
+{
+	if (!video)
+		return;
+
+	os_atomic_set_bool(&get_root(video)->threaded_inputs, threaded);
+}
+
+bool video_output_threaded_inputs(const video_t *video)
+{
+	return video ? os_atomic_load_bool(&get_const_root(video)->threaded_inputs) : false;
+}
+
+void video_output_set_scaler_threads(video_t *video, uint32_t threads)
+{
+	if (!video)
+		return;
+
+	os_atomic_set_long(&get_root(video)->scaler_threads, (long)threads);
+}
+
+uint32_t video_output_get_scaler_threads(const video_t *video)
+{
+	return video ? (uint32_t)os_atomic_load_long(&get_const_root(video)->scaler_threads) : 0;
+}
+
+bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame), void *param,
+				  struct video_input_stats *stats)
+{
+	bool found = false;
+
+	if (!video || !callback || !stats)
+		return false;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct video_input *input = video->inputs.array[idx];
+
+		stats->threaded = input->threaded;
+		stats->queue_depth = (uint32_t)os_atomic_load_long(&input->queue_depth);
+		stats->max_queue_depth = (uint32_t)os_atomic_load_long(&input->max_queue_depth);
+		stats->dropped_frames = (uint32_t)os_atomic_load_long(&input->dropped_frames);
+		found = true;
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return found;
+}
+
+void video_output_get_conversion_stats(video_t *video, struct video_conversion_stats *stats)
+{
+	if (!video || !stats)
+		return;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	stats->conversions = (uint32_t)video->conversions.num;
+	stats->converted_inputs = 0;
+	for (size_t i = 0; i < video->conversions.num; i++)
+		stats->converted_inputs += (uint32_t)video->conversions.array[i]->inputs;
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	stats->scaled_frames = (uint32_t)os_atomic_load_long(&video->scaled_frames);
+	stats->shared_frames = (uint32_t)os_atomic_load_long(&video->shared_frames);
+}
+
 /* Note: These four functions below are a very slight bit of a hack.  If the
  * texture encoder thread is active while the raw encoder thread is active, the
  * total frame count will just be doubled while they're both active.  Which is
@@ -283,6 +283,20 @@ struct video_scale_info {
 	enum video_colorspace colorspace;
 };
 
+struct video_input_stats {
+	bool threaded;
+	uint32_t queue_depth;
+	uint32_t max_queue_depth;
+	uint32_t dropped_frames;
+};
+
+struct video_conversion_stats {
+	uint32_t conversions;
+	uint32_t converted_inputs;
+	uint32_t scaled_frames;
+	uint32_t shared_frames;
+};
+
 EXPORT enum video_format video_format_from_fourcc(uint32_t fourcc);
 
 EXPORT bool video_format_get_parameters(enum video_colorspace color_space, enum video_range_type range,
@@ -325,6 +339,14 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+EXPORT void video_output_set_threaded_inputs(video_t *video, bool threaded);
+EXPORT bool video_output_threaded_inputs(const video_t *video);
+EXPORT void video_output_set_scaler_threads(video_t *video, uint32_t threads);
+EXPORT uint32_t video_output_get_scaler_threads(const video_t *video);
+EXPORT bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame),
+					 void *param, struct video_input_stats *stats);
+EXPORT void video_output_get_conversion_stats(video_t *video, struct video_conversion_stats *stats);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
@@ -0,0 +1,198 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "video-scaler-fast.h"
+
+#ifdef VIDEO_SCALER_HAS_AVX2
+
+#include <immintrin.h>
+
+/* these are only ever called after checking for AVX2 at runtime, so the rest
+ * of libobs doesn't have to be built with AVX2 enabled */
+#ifdef _MSC_VER
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+
+/*
+ * Same operations as the SSE2 kernels, on twice as many pixels.  Most AVX2
+ * instructions work on the two 128 bit lanes separately, so results that are
+ * packed across lanes get put back in order with a permute.
+ */
+
+static AVX2_FUNC inline __m256i sum_pairs(__m256i val)
+{
+	const __m256i mask = _mm256_set1_epi16(0x00FF);
+	return _mm256_add_epi16(_mm256_and_si256(val, mask), _mm256_srli_epi16(val, 8));
+}
+
+static AVX2_FUNC inline __m256i sum_uv_pairs(__m256i val)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	__m256i lo = _mm256_unpacklo_epi8(val, zero);
+	__m256i hi = _mm256_unpackhi_epi8(val, zero);
+	lo = _mm256_shuffle_epi32(_mm256_add_epi16(lo, _mm256_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+	hi = _mm256_shuffle_epi32(_mm256_add_epi16(hi, _mm256_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+	return _mm256_unpacklo_epi64(lo, hi);
+}
+
+static AVX2_FUNC inline __m256i average_sums(__m256i sum1, __m256i sum2)
+{
+	const __m256i round = _mm256_set1_epi16(2);
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(sum1, sum2), round), 2);
+}
+
+/* packs two sets of 16 words into 32 bytes, in order */
+static AVX2_FUNC inline __m256i pack_words(__m256i a, __m256i b)
+{
+	return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+AVX2_FUNC void halve_row_avx2(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width)
+{
+	uint32_t width_vec = width & ~31;
+	uint32_t x;
+
+	for (x = 0; x < width_vec; x += 32) {
+		__m256i l1a = _mm256_loadu_si256((const __m256i *)(line1 + x * 2));
+		__m256i l1b = _mm256_loadu_si256((const __m256i *)(line1 + x * 2 + 32));
+		__m256i l2a = _mm256_loadu_si256((const __m256i *)(line2 + x * 2));
+		__m256i l2b = _mm256_loadu_si256((const __m256i *)(line2 + x * 2 + 32));
+
+		__m256i a = average_sums(sum_pairs(l1a), sum_pairs(l2a));
+		__m256i b = average_sums(sum_pairs(l1b), sum_pairs(l2b));
+		_mm256_storeu_si256((__m256i *)(output + x), pack_words(a, b));
+	}
+
+	halve_row_tail(line1, line2, x, width, output);
+}
+
+AVX2_FUNC void halve_row_uv_avx2(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width)
+{
+	uint32_t width_vec = width & ~15;
+	uint32_t x;
+
+	for (x = 0; x < width_vec; x += 16) {
+		__m256i l1a = _mm256_loadu_si256((const __m256i *)(line1 + x * 4));
+		__m256i l1b = _mm256_loadu_si256((const __m256i *)(line1 + x * 4 + 32));
+		__m256i l2a = _mm256_loadu_si256((const __m256i *)(line2 + x * 4));
+		__m256i l2b = _mm256_loadu_si256((const __m256i *)(line2 + x * 4 + 32));
+
+		__m256i a = average_sums(sum_uv_pairs(l1a), sum_uv_pairs(l2a));
+		__m256i b = average_sums(sum_uv_pairs(l1b), sum_uv_pairs(l2b));
+		_mm256_storeu_si256((__m256i *)(output + x * 2), pack_words(a, b));
+	}
+
+	halve_row_uv_tail(line1, line2, x, width, output);
+}
+
+/* per lane: [a0 + a1, a2 + a3, b0 + b1, b2 + b3] */
+static AVX2_FUNC inline __m256i add_adjacent(__m256i a, __m256i b)
+{
+	__m256 fa = _mm256_castsi256_ps(a);
+	__m256 fb = _mm256_castsi256_ps(b);
+	__m256i even = _mm256_castps_si256(_mm256_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0)));
+	__m256i odd = _mm256_castps_si256(_mm256_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1)));
+	return _mm256_add_epi32(even, odd);
+}
+
+/* luma of 8 packed pixels, in order */
+static AVX2_FUNC inline __m256i luma_8(__m256i px, __m256i coeffs, __m256i offset)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), coeffs);
+	__m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), coeffs);
+	return _mm256_srai_epi32(_mm256_add_epi32(add_adjacent(lo, hi), offset), RGB_TO_YUV_LUMA_SHIFT);
+}
+
+/* luma of 16 packed pixels as bytes */
+static AVX2_FUNC inline __m128i luma_16(__m256i px_a, __m256i px_b, __m256i coeffs, __m256i offset)
+{
+	__m256i words = _mm256_packs_epi32(luma_8(px_a, coeffs, offset), luma_8(px_b, coeffs, offset));
+	words = _mm256_permute4x64_epi64(words, _MM_SHUFFLE(3, 1, 2, 0));
+	__m256i bytes = _mm256_packus_epi16(words, words);
+	return _mm256_castsi256_si128(_mm256_permute4x64_epi64(bytes, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+/* sums of the 2x2 blocks of 8x2 packed pixels: blocks 0 1 in the low lane
+ * and 2 3 in the high lane */
+static AVX2_FUNC inline __m256i block_sums_4(__m256i px1, __m256i px2)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(px1, zero), _mm256_unpacklo_epi8(px2, zero));
+	__m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(px1, zero), _mm256_unpackhi_epi8(px2, zero));
+	lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+	hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+	return _mm256_unpacklo_epi64(lo, hi);
+}
+
+/* chroma of 8 2x2 blocks, in order */
+static AVX2_FUNC inline __m256i chroma_8(__m256i blocks_a, __m256i blocks_b, __m256i coeffs, __m256i offset)
+{
+	const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+	__m256i a = _mm256_madd_epi16(blocks_a, coeffs);
+	__m256i b = _mm256_madd_epi16(blocks_b, coeffs);
+	__m256i val = _mm256_permutevar8x32_epi32(add_adjacent(a, b), order);
+	return _mm256_srai_epi32(_mm256_add_epi32(val, offset), RGB_TO_YUV_CHROMA_SHIFT);
+}
+
+AVX2_FUNC void rgb_to_420_rows_avx2(const struct rgb_to_yuv_matrix *matrix, const uint8_t *line1,
+				    const uint8_t *line2, uint8_t *lum0, uint8_t *lum1, uint8_t *u, uint8_t *v,
+				    uint32_t width)
+{
+	const __m256i y_mul = _mm256_broadcastq_epi64(_mm_loadl_epi64((const __m128i *)matrix->y));
+	const __m256i u_mul = _mm256_broadcastq_epi64(_mm_loadl_epi64((const __m128i *)matrix->u));
+	const __m256i v_mul = _mm256_broadcastq_epi64(_mm_loadl_epi64((const __m128i *)matrix->v));
+	const __m256i y_offset = _mm256_set1_epi32(matrix->y_offset);
+	const __m256i uv_offset = _mm256_set1_epi32(matrix->uv_offset);
+	uint32_t width_vec = width & ~15;
+	uint32_t x;
+
+	for (x = 0; x < width_vec; x += 16) {
+		__m256i l1a = _mm256_loadu_si256((const __m256i *)(line1 + x * 4));
+		__m256i l1b = _mm256_loadu_si256((const __m256i *)(line1 + x * 4 + 32));
+		__m256i l2a = _mm256_loadu_si256((const __m256i *)(line2 + x * 4));
+		__m256i l2b = _mm256_loadu_si256((const __m256i *)(line2 + x * 4 + 32));
+
+		_mm_storeu_si128((__m128i *)(lum0 + x), luma_16(l1a, l1b, y_mul, y_offset));
+		_mm_storeu_si128((__m128i *)(lum1 + x), luma_16(l2a, l2b, y_mul, y_offset));
+
+		__m256i blocks_a = block_sums_4(l1a, l2a);
+		__m256i blocks_b = block_sums_4(l1b, l2b);
+		__m256i uv = _mm256_packs_epi32(chroma_8(blocks_a, blocks_b, u_mul, uv_offset),
+						chroma_8(blocks_a, blocks_b, v_mul, uv_offset));
+		uv = _mm256_permute4x64_epi64(uv, _MM_SHUFFLE(3, 1, 2, 0));
+		uv = _mm256_packus_epi16(uv, uv);
+
+		/* low lane: U0-U7 twice, high lane: V0-V7 twice */
+		__m128i u_val = _mm256_castsi256_si128(uv);
+		__m128i v_val = _mm256_extracti128_si256(uv, 1);
+
+		if (v) {
+			_mm_storel_epi64((__m128i *)(u + x / 2), u_val);
+			_mm_storel_epi64((__m128i *)(v + x / 2), v_val);
+		} else {
+			_mm_storeu_si128((__m128i *)(u + x), _mm_unpacklo_epi8(u_val, v_val));
+		}
+	}
+
+	rgb_to_420_tail(matrix, line1, line2, x, width, lum0, lum1, u, v);
+}
+
+#endif
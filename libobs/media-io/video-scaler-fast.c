@@ -0,0 +1,458 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "video-scaler-fast.h"
+#include "format-conversion.h"
+
+#include "../util/sse-intrin.h"
+
+/* ------------------------------------------------------------------------- */
+/* SSE2 kernels, which also serve ARM through SIMDe                          */
+
+/* sums of the horizontally adjacent bytes of a row, as 8 words */
+static inline __m128i sum_pairs(__m128i val)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	return _mm_add_epi16(_mm_and_si128(val, mask), _mm_srli_epi16(val, 8));
+}
+
+/* sums of the horizontally adjacent U/V pairs of a row, as 4 interleaved U/V
+ * word pairs */
+static inline __m128i sum_uv_pairs(__m128i val)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	/* words: U0 V0 U1 V1 ..., adding U1 V1 onto U0 V0 */
+	__m128i lo = _mm_unpacklo_epi8(val, zero);
+	__m128i hi = _mm_unpackhi_epi8(val, zero);
+	lo = _mm_shuffle_epi32(_mm_add_epi16(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+	hi = _mm_shuffle_epi32(_mm_add_epi16(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+	return _mm_unpacklo_epi64(lo, hi);
+}
+
+static inline __m128i average_sums(__m128i sum1, __m128i sum2)
+{
+	const __m128i round = _mm_set1_epi16(2);
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sum1, sum2), round), 2);
+}
+
+void halve_row_sse2(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width)
+{
+	uint32_t width_vec = width & ~15;
+	uint32_t x;
+
+	for (x = 0; x < width_vec; x += 16) {
+		__m128i l1a = _mm_loadu_si128((const __m128i *)(line1 + x * 2));
+		__m128i l1b = _mm_loadu_si128((const __m128i *)(line1 + x * 2 + 16));
+		__m128i l2a = _mm_loadu_si128((const __m128i *)(line2 + x * 2));
+		__m128i l2b = _mm_loadu_si128((const __m128i *)(line2 + x * 2 + 16));
+
+		__m128i a = average_sums(sum_pairs(l1a), sum_pairs(l2a));
+		__m128i b = average_sums(sum_pairs(l1b), sum_pairs(l2b));
+		_mm_storeu_si128((__m128i *)(output + x), _mm_packus_epi16(a, b));
+	}
+
+	halve_row_tail(line1, line2, x, width, output);
+}
+
+void halve_row_uv_sse2(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width)
+{
+	uint32_t width_vec = width & ~7;
+	uint32_t x;
+
+	for (x = 0; x < width_vec; x += 8) {
+		__m128i l1a = _mm_loadu_si128((const __m128i *)(line1 + x * 4));
+		__m128i l1b = _mm_loadu_si128((const __m128i *)(line1 + x * 4 + 16));
+		__m128i l2a = _mm_loadu_si128((const __m128i *)(line2 + x * 4));
+		__m128i l2b = _mm_loadu_si128((const __m128i *)(line2 + x * 4 + 16));
+
+		__m128i a = average_sums(sum_uv_pairs(l1a), sum_uv_pairs(l2a));
+		__m128i b = average_sums(sum_uv_pairs(l1b), sum_uv_pairs(l2b));
+		_mm_storeu_si128((__m128i *)(output + x * 2), _mm_packus_epi16(a, b));
+	}
+
+	halve_row_uv_tail(line1, line2, x, width, output);
+}
+
+/* [a0 + a1, a2 + a3, b0 + b1, b2 + b3] */
+static inline __m128i add_adjacent(__m128i a, __m128i b)
+{
+	__m128 fa = _mm_castsi128_ps(a);
+	__m128 fb = _mm_castsi128_ps(b);
+	__m128i even = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0)));
+	__m128i odd = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1)));
+	return _mm_add_epi32(even, odd);
+}
+
+/* luma of 4 packed pixels, as 32 bit values */
+static inline __m128i luma_4(__m128i px, __m128i coeffs, __m128i offset)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coeffs);
+	__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coeffs);
+	return _mm_srai_epi32(_mm_add_epi32(add_adjacent(lo, hi), offset), RGB_TO_YUV_LUMA_SHIFT);
+}
+
+/* sums of the two 2x2 blocks of 4x2 packed pixels, as two sets of 4 words */
+static inline __m128i block_sums_2(__m128i px1, __m128i px2)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(px1, zero), _mm_unpacklo_epi8(px2, zero));
+	__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(px1, zero), _mm_unpackhi_epi8(px2, zero));
+	lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+	hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+	return _mm_unpacklo_epi64(lo, hi);
+}
+
+/* chroma of 4 2x2 blocks, as 32 bit values */
+static inline __m128i chroma_4(__m128i blocks_a, __m128i blocks_b, __m128i coeffs, __m128i offset)
+{
+	__m128i a = _mm_madd_epi16(blocks_a, coeffs);
+	__m128i b = _mm_madd_epi16(blocks_b, coeffs);
+	return _mm_srai_epi32(_mm_add_epi32(add_adjacent(a, b), offset), RGB_TO_YUV_CHROMA_SHIFT);
+}
+
+void rgb_to_420_rows_sse2(const struct rgb_to_yuv_matrix *matrix, const uint8_t *line1, const uint8_t *line2,
+			  uint8_t *lum0, uint8_t *lum1, uint8_t *u, uint8_t *v, uint32_t width)
+{
+	const __m128i y_coeffs = _mm_loadl_epi64((const __m128i *)matrix->y);
+	const __m128i u_coeffs = _mm_loadl_epi64((const __m128i *)matrix->u);
+	const __m128i v_coeffs = _mm_loadl_epi64((const __m128i *)matrix->v);
+	const __m128i y_mul = _mm_unpacklo_epi64(y_coeffs, y_coeffs);
+	const __m128i u_mul = _mm_unpacklo_epi64(u_coeffs, u_coeffs);
+	const __m128i v_mul = _mm_unpacklo_epi64(v_coeffs, v_coeffs);
+	const __m128i y_offset = _mm_set1_epi32(matrix->y_offset);
+	const __m128i uv_offset = _mm_set1_epi32(matrix->uv_offset);
+	uint32_t width_vec = width & ~7;
+	uint32_t x;
+
+	for (x = 0; x < width_vec; x += 8) {
+		__m128i l1a = _mm_loadu_si128((const __m128i *)(line1 + x * 4));
+		__m128i l1b = _mm_loadu_si128((const __m128i *)(line1 + x * 4 + 16));
+		__m128i l2a = _mm_loadu_si128((const __m128i *)(line2 + x * 4));
+		__m128i l2b = _mm_loadu_si128((const __m128i *)(line2 + x * 4 + 16));
+
+		__m128i y1 = _mm_packs_epi32(luma_4(l1a, y_mul, y_offset), luma_4(l1b, y_mul, y_offset));
+		__m128i y2 = _mm_packs_epi32(luma_4(l2a, y_mul, y_offset), luma_4(l2b, y_mul, y_offset));
+		_mm_storel_epi64((__m128i *)(lum0 + x), _mm_packus_epi16(y1, y1));
+		_mm_storel_epi64((__m128i *)(lum1 + x), _mm_packus_epi16(y2, y2));
+
+		__m128i blocks_a = block_sums_2(l1a, l2a);
+		__m128i blocks_b = block_sums_2(l1b, l2b);
+		__m128i uv = _mm_packs_epi32(chroma_4(blocks_a, blocks_b, u_mul, uv_offset),
+					     chroma_4(blocks_a, blocks_b, v_mul, uv_offset));
+		uv = _mm_packus_epi16(uv, uv);
+
+		/* bytes: U0 U1 U2 U3 V0 V1 V2 V3 */
+		if (v) {
+			int32_t u_val = _mm_cvtsi128_si32(uv);
+			int32_t v_val = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+			memcpy(u + x / 2, &u_val, sizeof(u_val));
+			memcpy(v + x / 2, &v_val, sizeof(v_val));
+		} else {
+			_mm_storel_epi64((__m128i *)(u + x), _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 4)));
+		}
+	}
+
+	rgb_to_420_tail(matrix, line1, line2, x, width, lum0, lum1, u, v);
+}
+
+/* ------------------------------------------------------------------------- */
+/* setup                                                                     */
+
+static inline enum video_range_type collapse_range(enum video_range_type range)
+{
+	return range == VIDEO_RANGE_FULL ? VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL;
+}
+
+static inline enum video_colorspace collapse_space(enum video_colorspace cs)
+{
+	switch (cs) {
+	case VIDEO_CS_DEFAULT:
+	case VIDEO_CS_SRGB:
+		return VIDEO_CS_709;
+	default:
+		return cs;
+	}
+}
+
+static inline bool is_420(enum video_format format)
+{
+	return format == VIDEO_FORMAT_NV12 || format == VIDEO_FORMAT_I420;
+}
+
+static inline bool is_packed_rgb(enum video_format format)
+{
+	return format == VIDEO_FORMAT_BGRA || format == VIDEO_FORMAT_BGRX || format == VIDEO_FORMAT_RGBA;
+}
+
+static inline int16_t to_fixed(double val, int shift)
+{
+	return (int16_t)lround(val * (double)(1 << shift));
+}
+
+/* same conversion as swscale: RGB is full range, the output uses the range
+ * and color space of the destination */
+static bool init_rgb_matrix(struct rgb_to_yuv_matrix *matrix, enum video_format format, enum video_colorspace cs,
+			    enum video_range_type range)
+{
+	const int shift = RGB_TO_YUV_LUMA_SHIFT;
+	double kr, kb;
+	double y_scale, c_scale;
+	int y_base;
+	size_t r, g, b;
+
+	switch (collapse_space(cs)) {
+	case VIDEO_CS_601:
+		kr = 0.299;
+		kb = 0.114;
+		break;
+	case VIDEO_CS_709:
+		kr = 0.2126;
+		kb = 0.0722;
+		break;
+	default:
+		return false;
+	}
+
+	if (collapse_range(range) == VIDEO_RANGE_FULL) {
+		y_scale = 1.0;
+		c_scale = 1.0;
+		y_base = 0;
+	} else {
+		y_scale = 219.0 / 255.0;
+		c_scale = 224.0 / 255.0;
+		y_base = 16;
+	}
+
+	if (format == VIDEO_FORMAT_RGBA) {
+		r = 0;
+		b = 2;
+	} else {
+		r = 2;
+		b = 0;
+	}
+	g = 1;
+
+	memset(matrix, 0, sizeof(*matrix));
+
+	/* green takes the rounding error, so gray stays gray */
+	matrix->y[r] = to_fixed(y_scale * kr, shift);
+	matrix->y[b] = to_fixed(y_scale * kb, shift);
+	matrix->y[g] = to_fixed(y_scale, shift) - matrix->y[r] - matrix->y[b];
+
+	matrix->u[r] = to_fixed(-c_scale * kr / (2.0 * (1.0 - kb)), shift);
+	matrix->u[b] = to_fixed(c_scale * 0.5, shift);
+	matrix->u[g] = -matrix->u[r] - matrix->u[b];
+
+	matrix->v[r] = to_fixed(c_scale * 0.5, shift);
+	matrix->v[b] = to_fixed(-c_scale * kb / (2.0 * (1.0 - kr)), shift);
+	matrix->v[g] = -matrix->v[r] - matrix->v[b];
+
+	matrix->y_offset = (y_base << RGB_TO_YUV_LUMA_SHIFT) + (1 << (RGB_TO_YUV_LUMA_SHIFT - 1));
+	matrix->uv_offset = (128 << RGB_TO_YUV_CHROMA_SHIFT) + (1 << (RGB_TO_YUV_CHROMA_SHIFT - 1));
+	return true;
+}
+
+bool video_scaler_fast_init(struct video_scaler_fast *fast, const struct video_scale_info *dst,
+			    const struct video_scale_info *src, enum video_scale_type type)
+{
+	memset(fast, 0, sizeof(*fast));
+
+	/* both kinds work on whole 2x2 chroma blocks */
+	if (!is_420(dst->format) || (dst->width & 1) || (dst->height & 1))
+		return false;
+
+	if (src->format == dst->format && src->width == dst->width * 2 && src->height == dst->height * 2) {
+		/* a 2x2 box is what bilinear filtering comes down to at
+		 * exactly half the size, but not point or bicubic */
+		if (type != VIDEO_SCALE_DEFAULT && type != VIDEO_SCALE_FAST_BILINEAR && type != VIDEO_SCALE_BILINEAR)
+			return false;
+		if (collapse_range(src->range) != collapse_range(dst->range) ||
+		    collapse_space(src->colorspace) != collapse_space(dst->colorspace))
+			return false;
+
+		fast->kind = VIDEO_SCALER_FAST_HALVE;
+
+	} else if (is_packed_rgb(src->format) && src->width == dst->width && src->height == dst->height) {
+		if (!init_rgb_matrix(&fast->matrix, src->format, dst->colorspace, dst->range))
+			return false;
+
+		fast->kind = VIDEO_SCALER_FAST_RGB_TO_420;
+
+	} else {
+		return false;
+	}
+
+	fast->format = dst->format;
+	fast->width = dst->width;
+	fast->height = dst->height;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* band driver                                                               */
+
+struct scaler_kernels {
+	void (*halve_row)(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width);
+	void (*halve_row_uv)(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width);
+	void (*rgb_to_420_rows)(const struct rgb_to_yuv_matrix *matrix, const uint8_t *line1, const uint8_t *line2,
+				uint8_t *lum0, uint8_t *lum1, uint8_t *u, uint8_t *v, uint32_t width);
+};
+
+#define SCALER_KERNELS(suffix)                                                      \
+	{                                                                           \
+		halve_row_##suffix, halve_row_uv_##suffix, rgb_to_420_rows_##suffix \
+	}
+
+static const struct scaler_kernels sse2_kernels = SCALER_KERNELS(sse2);
+#ifdef VIDEO_SCALER_HAS_AVX2
+static const struct scaler_kernels avx2_kernels = SCALER_KERNELS(avx2);
+#endif
+
+#undef SCALER_KERNELS
+
+/* follows the instruction set of the format conversion functions, so
+ * format_conversion_set_simd() selects these as well */
+static inline const struct scaler_kernels *get_kernels(void)
+{
+#ifdef VIDEO_SCALER_HAS_AVX2
+	if (format_conversion_get_simd() == FORMAT_CONVERSION_SIMD_AVX2)
+		return &avx2_kernels;
+#endif
+	return &sse2_kernels;
+}
+
+/* bands smaller than this aren't worth waking up a thread for */
+#define MIN_BAND_ROWS 16
+
+/* more bands than threads, so that threads that get preempted or finish
+ * early don't hold up the rest */
+#define BANDS_PER_THREAD 4
+
+struct scale_job {
+	const struct video_scaler_fast *fast;
+	const struct scaler_kernels *kernels;
+	uint8_t *const *output;
+	const uint32_t *out_linesize;
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
+	uint32_t band_height;
+};
+
+static inline const uint8_t *in_line(const struct scale_job *job, size_t plane, uint32_t y)
+{
+	return job->input[plane] + (size_t)y * job->in_linesize[plane];
+}
+
+static inline uint8_t *out_line(const struct scale_job *job, size_t plane, uint32_t y)
+{
+	return job->output[plane] + (size_t)y * job->out_linesize[plane];
+}
+
+/* start_y and end_y are even output rows */
+static void halve_band(const struct scale_job *job, uint32_t start_y, uint32_t end_y)
+{
+	const struct scaler_kernels *k = job->kernels;
+	uint32_t width = job->fast->width;
+
+	for (uint32_t y = start_y; y < end_y; y++)
+		k->halve_row(in_line(job, 0, y * 2), in_line(job, 0, y * 2 + 1), out_line(job, 0, y), width);
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		if (job->fast->format == VIDEO_FORMAT_NV12) {
+			k->halve_row_uv(in_line(job, 1, y * 2), in_line(job, 1, y * 2 + 1), out_line(job, 1, y),
+					width / 2);
+		} else {
+			for (size_t plane = 1; plane < 3; plane++)
+				k->halve_row(in_line(job, plane, y * 2), in_line(job, plane, y * 2 + 1),
+					     out_line(job, plane, y), width / 2);
+		}
+	}
+}
+
+static void rgb_to_420_band(const struct scale_job *job, uint32_t start_y, uint32_t end_y)
+{
+	const struct scaler_kernels *k = job->kernels;
+	bool planar = job->fast->format == VIDEO_FORMAT_I420;
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		k->rgb_to_420_rows(&job->fast->matrix, in_line(job, 0, y), in_line(job, 0, y + 1), out_line(job, 0, y),
+				   out_line(job, 0, y + 1), out_line(job, 1, y / 2),
+				   planar ? out_line(job, 2, y / 2) : NULL, job->fast->width);
+	}
+}
+
+static void scale_band(const struct scale_job *job, uint32_t start_y, uint32_t end_y)
+{
+	switch (job->fast->kind) {
+	case VIDEO_SCALER_FAST_HALVE:
+		halve_band(job, start_y, end_y);
+		break;
+	case VIDEO_SCALER_FAST_RGB_TO_420:
+		rgb_to_420_band(job, start_y, end_y);
+		break;
+	case VIDEO_SCALER_FAST_NONE:
+		break;
+	}
+}
+
+static void scale_band_work(void *param, size_t idx)
+{
+	const struct scale_job *job = param;
+	uint32_t start_y = (uint32_t)idx * job->band_height;
+	uint32_t end_y = start_y + job->band_height;
+
+	if (end_y > job->fast->height)
+		end_y = job->fast->height;
+
+	scale_band(job, start_y, end_y);
+}
+
+void video_scaler_fast_scale(const struct video_scaler_fast *fast, os_work_pool_t *pool, uint8_t *output[],
+			     const uint32_t out_linesize[], const uint8_t *const input[], const uint32_t in_linesize[])
+{
+	struct scale_job job = {
+		.fast = fast,
+		.kernels = get_kernels(),
+		.output = output,
+		.out_linesize = out_linesize,
+		.input = input,
+		.in_linesize = in_linesize,
+	};
+	uint32_t rows = fast->height;
+	size_t num_bands;
+
+	if (!pool || rows < MIN_BAND_ROWS * 2) {
+		scale_band(&job, 0, rows);
+		return;
+	}
+
+	num_bands = (os_work_pool_num_threads(pool) + 1) * BANDS_PER_THREAD;
+	job.band_height = (uint32_t)((rows + num_bands - 1) / num_bands);
+	if (job.band_height < MIN_BAND_ROWS)
+		job.band_height = MIN_BAND_ROWS;
+
+	/* chroma rows cover two output rows */
+	job.band_height = (job.band_height + 1) & ~1;
+
+	num_bands = (rows + job.band_height - 1) / job.band_height;
+	os_work_pool_run(pool, scale_band_work, &job, num_bands);
+}
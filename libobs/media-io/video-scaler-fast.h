@@ -0,0 +1,161 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Internal: native implementations of the conversions video-io scalers do
+ * most, which video_scaler uses instead of swscale when they apply:
+ *
+ * - NV12 and I420 downscaled by exactly 2:1, with a 2x2 box filter
+ * - BGRA/BGRX/RGBA to NV12 or I420 at the same size
+ */
+
+#include "video-io.h"
+#include "../util/cpu-features.h"
+#include "../util/task.h"
+
+#ifdef OS_CPU_X86
+#define VIDEO_SCALER_HAS_AVX2 1
+#endif
+
+enum video_scaler_fast_kind {
+	VIDEO_SCALER_FAST_NONE,
+	VIDEO_SCALER_FAST_HALVE,
+	VIDEO_SCALER_FAST_RGB_TO_420,
+};
+
+/* RGB to YUV matrix in fixed point, with the coefficients in the byte order
+ * of the packed input pixels.  luma is 14 bit fixed point, chroma is applied
+ * to the sum of a 2x2 block so it's shifted by 2 more bits. */
+#define RGB_TO_YUV_LUMA_SHIFT 14
+#define RGB_TO_YUV_CHROMA_SHIFT 16
+
+struct rgb_to_yuv_matrix {
+	int16_t y[4];
+	int16_t u[4];
+	int16_t v[4];
+	int32_t y_offset;
+	int32_t uv_offset;
+};
+
+struct video_scaler_fast {
+	enum video_scaler_fast_kind kind;
+	enum video_format format; /* of the output */
+	uint32_t width;
+	uint32_t height;
+	struct rgb_to_yuv_matrix matrix;
+};
+
+/* returns false if the conversion has no native implementation */
+extern bool video_scaler_fast_init(struct video_scaler_fast *fast, const struct video_scale_info *dst,
+				   const struct video_scale_info *src, enum video_scale_type type);
+
+/* splits the output rows into bands which are converted on the pool, or on
+ * the calling thread if pool is NULL */
+extern void video_scaler_fast_scale(const struct video_scaler_fast *fast, os_work_pool_t *pool, uint8_t *output[],
+				    const uint32_t out_linesize[], const uint8_t *const input[],
+				    const uint32_t in_linesize[]);
+
+/* ------------------------------------------------------------------------- */
+/* per-instruction-set row kernels, width is in output pixels                */
+
+#define DECLARE_SCALER_KERNELS(suffix)                                                                               \
+	void halve_row_##suffix(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width);       \
+	void halve_row_uv_##suffix(const uint8_t *line1, const uint8_t *line2, uint8_t *output, uint32_t width);    \
+	void rgb_to_420_rows_##suffix(const struct rgb_to_yuv_matrix *matrix, const uint8_t *line1,                 \
+				      const uint8_t *line2, uint8_t *lum0, uint8_t *lum1, uint8_t *u, uint8_t *v, \
+				      uint32_t width)
+
+DECLARE_SCALER_KERNELS(sse2);
+#ifdef VIDEO_SCALER_HAS_AVX2
+DECLARE_SCALER_KERNELS(avx2);
+#endif
+
+#undef DECLARE_SCALER_KERNELS
+
+/* ------------------------------------------------------------------------- */
+/* scalar versions of the kernel inner loops.  the vector kernels use these   */
+/* for whatever is left of a row after the vector loop, starting at x.        */
+
+static inline uint8_t avg_4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	return (uint8_t)((a + b + c + d + 2) >> 2);
+}
+
+static inline void halve_row_tail(const uint8_t *line1, const uint8_t *line2, uint32_t x, uint32_t width,
+				  uint8_t *output)
+{
+	for (; x < width; x++)
+		output[x] = avg_4(line1[x * 2], line1[x * 2 + 1], line2[x * 2], line2[x * 2 + 1]);
+}
+
+/* x and width are in U/V pairs */
+static inline void halve_row_uv_tail(const uint8_t *line1, const uint8_t *line2, uint32_t x, uint32_t width,
+				     uint8_t *output)
+{
+	for (; x < width; x++) {
+		output[x * 2] = avg_4(line1[x * 4], line1[x * 4 + 2], line2[x * 4], line2[x * 4 + 2]);
+		output[x * 2 + 1] = avg_4(line1[x * 4 + 1], line1[x * 4 + 3], line2[x * 4 + 1], line2[x * 4 + 3]);
+	}
+}
+
+static inline uint8_t clamp_uint8(int32_t val)
+{
+	return (uint8_t)(val < 0 ? 0 : (val > 255 ? 255 : val));
+}
+
+static inline uint8_t rgb_to_luma(const struct rgb_to_yuv_matrix *matrix, const uint8_t *px)
+{
+	int32_t val = matrix->y[0] * px[0] + matrix->y[1] * px[1] + matrix->y[2] * px[2] + matrix->y_offset;
+	return clamp_uint8(val >> RGB_TO_YUV_LUMA_SHIFT);
+}
+
+static inline uint8_t rgb_to_chroma(const int16_t *coeffs, int32_t offset, const int32_t *sum)
+{
+	int32_t val = coeffs[0] * sum[0] + coeffs[1] * sum[1] + coeffs[2] * sum[2] + offset;
+	return clamp_uint8(val >> RGB_TO_YUV_CHROMA_SHIFT);
+}
+
+/* x and width are in pixels, both even.  with a NULL v plane, u is an
+ * interleaved U/V plane */
+static inline void rgb_to_420_tail(const struct rgb_to_yuv_matrix *matrix, const uint8_t *line1,
+				   const uint8_t *line2, uint32_t x, uint32_t width, uint8_t *lum0, uint8_t *lum1,
+				   uint8_t *u, uint8_t *v)
+{
+	for (; x < width; x += 2) {
+		const uint8_t *p1 = line1 + x * 4;
+		const uint8_t *p2 = line2 + x * 4;
+		int32_t sum[3];
+
+		lum0[x] = rgb_to_luma(matrix, p1);
+		lum0[x + 1] = rgb_to_luma(matrix, p1 + 4);
+		lum1[x] = rgb_to_luma(matrix, p2);
+		lum1[x + 1] = rgb_to_luma(matrix, p2 + 4);
+
+		for (size_t c = 0; c < 3; c++)
+			sum[c] = p1[c] + p1[c + 4] + p2[c] + p2[c + 4];
+
+		if (v) {
+			u[x / 2] = rgb_to_chroma(matrix->u, matrix->uv_offset, sum);
+			v[x / 2] = rgb_to_chroma(matrix->v, matrix->uv_offset, sum);
+		} else {
+			u[x] = rgb_to_chroma(matrix->u, matrix->uv_offset, sum);
+			u[x + 1] = rgb_to_chroma(matrix->v, matrix->uv_offset, sum);
+		}
+	}
+}
@@ -16,18 +16,33 @@
 ******************************************************************************/
 
 #include "../util/bmem.h"
+#include "../util/task.h"
 #include "video-scaler.h"
+#include "video-scaler-fast.h"
 
+#include <libavutil/frame.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libswscale/swscale.h>
 
+/* swscale only runs slices in parallel through the frame API */
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+#define SWSCALE_SLICE_THREADS 1
+#endif
+
 struct video_scaler {
 	struct SwsContext *swscale;
 	int src_height;
 	int dst_heights[4];
 	uint8_t *dst_pointers[4];
 	int dst_linesizes[4];
+
+	bool use_fast;
+	struct video_scaler_fast fast;
+	os_work_pool_t *pool;
+
+	AVFrame *src_frame;
+	AVFrame *dst_frame;
 };
 
 static inline enum AVPixelFormat get_ffmpeg_video_format(enum video_format format)
@@ -140,8 +155,96 @@ static inline int get_ffmpeg_range_type(enum video_range_type type)
 
 #define FIXED_1_0 (1 << 16)
 
+#ifdef SWSCALE_SLICE_THREADS
+static void free_nothing(void *opaque, uint8_t *data)
+{
+	UNUSED_PARAMETER(opaque);
+	UNUSED_PARAMETER(data);
+}
+
+/* the frame API references its frames, which copies frames that don't have
+ * buffers, so they get buffers that don't own anything */
+static AVFrame *wrap_frame(enum AVPixelFormat format, int width, int height, uint8_t *data, size_t size)
+{
+	AVFrame *frame = av_frame_alloc();
+	if (!frame)
+		return NULL;
+
+	frame->format = format;
+	frame->width = width;
+	frame->height = height;
+	frame->buf[0] = av_buffer_create(data, size, free_nothing, NULL, 0);
+	if (!frame->buf[0])
+		av_frame_free(&frame);
+
+	return frame;
+}
+
+static bool init_swscale_threads(struct video_scaler *scaler, const struct video_scale_info *dst,
+				 const struct video_scale_info *src, uint32_t num_threads)
+{
+	static uint8_t nothing;
+
+	av_opt_set_int(scaler->swscale, "threads", num_threads, 0);
+
+	scaler->src_frame =
+		wrap_frame(get_ffmpeg_video_format(src->format), src->width, src->height, &nothing, sizeof(nothing));
+	scaler->dst_frame = wrap_frame(get_ffmpeg_video_format(dst->format), dst->width, dst->height,
+				       scaler->dst_pointers[0], (size_t)scaler->dst_linesizes[0] * dst->height);
+	return scaler->src_frame && scaler->dst_frame;
+}
+
+static bool scale_frame_threaded(struct video_scaler *scaler, const uint8_t *const input[],
+				 const uint32_t in_linesize[])
+{
+	AVFrame *src = scaler->src_frame;
+	AVFrame *dst = scaler->dst_frame;
+
+	for (size_t i = 0; i < 4; i++) {
+		src->data[i] = (uint8_t *)input[i];
+		src->linesize[i] = (int)in_linesize[i];
+		dst->data[i] = scaler->dst_pointers[i];
+		dst->linesize[i] = scaler->dst_linesizes[i];
+	}
+
+	int ret = sws_scale_frame(scaler->swscale, dst, src);
+	if (ret < 0) {
+		blog(LOG_ERROR, "video_scaler_scale: sws_scale_frame failed: %d", ret);
+		return false;
+	}
+
+	return true;
+}
+#else
+static bool init_swscale_threads(struct video_scaler *scaler, const struct video_scale_info *dst,
+				 const struct video_scale_info *src, uint32_t num_threads)
+{
+	UNUSED_PARAMETER(scaler);
+	UNUSED_PARAMETER(dst);
+	UNUSED_PARAMETER(src);
+	blog(LOG_DEBUG, "video_scaler_create: swscale is too old to use %u threads", num_threads);
+	return true;
+}
+
+static bool scale_frame_threaded(struct video_scaler *scaler, const uint8_t *const input[],
+				 const uint32_t in_linesize[])
+{
+	UNUSED_PARAMETER(scaler);
+	UNUSED_PARAMETER(input);
+	UNUSED_PARAMETER(in_linesize);
+	return false;
+}
+#endif
+
 int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_info *dst,
 			const struct video_scale_info *src, enum video_scale_type type)
+{
+	return video_scaler_create2(scaler_out, dst, src, type, 1, 0);
+}
+
+int video_scaler_create2(video_scaler_t **scaler_out, const struct video_scale_info *dst,
+			 const struct video_scale_info *src, enum video_scale_type type, uint32_t num_threads,
+			 uint32_t flags)
 {
 	enum AVPixelFormat format_src = get_ffmpeg_video_format(src->format);
 	enum AVPixelFormat format_dst = get_ffmpeg_video_format(dst->format);
@@ -162,6 +265,16 @@ int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_in
 	scaler = bzalloc(sizeof(struct video_scaler));
 	scaler->src_height = src->height;
 
+	if ((flags & VIDEO_SCALER_FAST_PATH) != 0 && video_scaler_fast_init(&scaler->fast, dst, src, type)) {
+		/* the calling thread takes part in the work as well */
+		if (num_threads > 1)
+			scaler->pool = os_work_pool_create(num_threads - 1);
+
+		scaler->use_fast = true;
+		*scaler_out = scaler;
+		return VIDEO_SCALER_SUCCESS;
+	}
+
 	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format_dst);
 	bool has_plane[4] = {0};
 	for (size_t i = 0; i < 4; i++)
@@ -197,6 +310,12 @@ int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_in
 	av_opt_set_int(scaler->swscale, "dst_format", format_dst, 0);
 	av_opt_set_int(scaler->swscale, "src_range", range_src, 0);
 	av_opt_set_int(scaler->swscale, "dst_range", range_dst, 0);
+
+	if (num_threads > 1 && !init_swscale_threads(scaler, dst, src, num_threads)) {
+		blog(LOG_ERROR, "video_scaler_create: Could not create frames");
+		goto fail;
+	}
+
 	if (sws_init_context(scaler->swscale, NULL, NULL) < 0) {
 		blog(LOG_ERROR, "video_scaler_create: sws_init_context failed");
 		goto fail;
@@ -220,6 +339,9 @@ fail:
 void video_scaler_destroy(video_scaler_t *scaler)
 {
 	if (scaler) {
+		os_work_pool_destroy(scaler->pool);
+		av_frame_free(&scaler->src_frame);
+		av_frame_free(&scaler->dst_frame);
 		sws_freeContext(scaler->swscale);
 
 		if (scaler->dst_pointers[0])
@@ -229,17 +351,33 @@ void video_scaler_destroy(video_scaler_t *scaler)
 	}
 }
 
+bool video_scaler_uses_fast_path(const video_scaler_t *scaler)
+{
+	return scaler && scaler->use_fast;
+}
+
 bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[], const uint32_t out_linesize[],
 			const uint8_t *const input[], const uint32_t in_linesize[])
 {
 	if (!scaler)
 		return false;
 
-	int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0, scaler->src_height,
-			    scaler->dst_pointers, scaler->dst_linesizes);
-	if (ret <= 0) {
-		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d", ret);
-		return false;
+	/* the native paths write straight to the output */
+	if (scaler->use_fast) {
+		video_scaler_fast_scale(&scaler->fast, scaler->pool, output, out_linesize, input, in_linesize);
+		return true;
+	}
+
+	if (scaler->dst_frame) {
+		if (!scale_frame_threaded(scaler, input, in_linesize))
+			return false;
+	} else {
+		int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0, scaler->src_height,
+				    scaler->dst_pointers, scaler->dst_linesizes);
+		if (ret <= 0) {
+			blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d", ret);
+			return false;
+		}
 	}
 
 	for (size_t plane = 0; plane < 4; ++plane) {
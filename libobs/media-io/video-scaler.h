@@ -31,10 +31,25 @@ typedef struct video_scaler video_scaler_t;
 #define VIDEO_SCALER_BAD_CONVERSION -1
 #define VIDEO_SCALER_FAILED -2
 
+/* use native SIMD code instead of swscale where it exists */
+#define VIDEO_SCALER_FAST_PATH (1 << 0)
+
 EXPORT int video_scaler_create(video_scaler_t **scaler, const struct video_scale_info *dst,
 			       const struct video_scale_info *src, enum video_scale_type type);
+
+/* Like video_scaler_create, but splits each frame into row bands that are
+ * scaled on up to num_threads threads, including the calling thread.  With
+ * VIDEO_SCALER_FAST_PATH, NV12 and I420 downscaled by exactly 2:1, and
+ * BGRA/BGRX/RGBA to NV12 or I420 at the same size use native SIMD code
+ * instead of swscale.  Its results are within a few code values of
+ * swscale's, not identical. */
+EXPORT int video_scaler_create2(video_scaler_t **scaler, const struct video_scale_info *dst,
+				const struct video_scale_info *src, enum video_scale_type type, uint32_t num_threads,
+				uint32_t flags);
 EXPORT void video_scaler_destroy(video_scaler_t *scaler);
 
+EXPORT bool video_scaler_uses_fast_path(const video_scaler_t *scaler);
+
 EXPORT bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[], const uint32_t out_linesize[],
 			       const uint8_t *const input[], const uint32_t in_linesize[]);
 
@@ -0,0 +1,305 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "util/bmem.h"
+#include "util/platform.h"
+#include "obs-encoder-queue.h"
+
+bool encoder_frame_queue_init(struct encoder_frame_queue *queue, size_t limit, enum obs_encoder_overflow overflow)
+{
+	memset(queue, 0, sizeof(*queue));
+
+	if (limit < 1)
+		limit = 1;
+	else if (limit > ENCODER_QUEUE_MAX_SIZE)
+		limit = ENCODER_QUEUE_MAX_SIZE;
+
+	queue->limit = limit;
+	queue->overflow = overflow;
+	queue->stats.async = true;
+	queue->stats.queue_size = (uint32_t)limit;
+
+	if (pthread_mutex_init(&queue->mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&queue->frames_sem, 0) != 0)
+		goto fail1;
+	if (os_event_init(&queue->space_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail2;
+
+	return true;
+
+fail2:
+	os_sem_destroy(queue->frames_sem);
+fail1:
+	pthread_mutex_destroy(&queue->mutex);
+	return false;
+}
+
+static inline void free_frame(struct encoder_queued_frame *frame)
+{
+	bfree(frame->data);
+	bfree(frame);
+}
+
+void encoder_frame_queue_free(struct encoder_frame_queue *queue)
+{
+	encoder_frame_queue_reset(queue);
+
+	for (size_t i = 0; i < queue->free_frames.num; i++)
+		free_frame(queue->free_frames.array[i]);
+	da_free(queue->free_frames);
+	deque_free(&queue->frames);
+
+	os_event_destroy(queue->space_event);
+	os_sem_destroy(queue->frames_sem);
+	pthread_mutex_destroy(&queue->mutex);
+}
+
+struct encoder_queued_frame *encoder_frame_queue_get_frame(struct encoder_frame_queue *queue, size_t size)
+{
+	struct encoder_queued_frame *frame = NULL;
+
+	pthread_mutex_lock(&queue->mutex);
+	if (queue->free_frames.num) {
+		frame = queue->free_frames.array[queue->free_frames.num - 1];
+		da_pop_back(queue->free_frames);
+	}
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (!frame) {
+		frame = bzalloc(sizeof(*frame));
+		frame->queue = queue;
+	}
+
+	if (frame->capacity < size) {
+		bfree(frame->data);
+		frame->data = bmalloc(size);
+		frame->capacity = size;
+	}
+
+	memset(&frame->frame, 0, sizeof(frame->frame));
+	frame->cts = 0;
+	frame->has_cts = false;
+	frame->keep = false;
+	frame->queued_ts = 0;
+	frame->refs = 1;
+	return frame;
+}
+
+void encoder_queued_frame_addref(struct encoder_queued_frame *frame)
+{
+	os_atomic_inc_long(&frame->refs);
+}
+
+void encoder_queued_frame_release(struct encoder_queued_frame *frame)
+{
+	struct encoder_frame_queue *queue;
+
+	if (!frame || os_atomic_dec_long(&frame->refs) != 0)
+		return;
+
+	queue = frame->queue;
+
+	/* keep as many frames around as the queue can hold, plus the ones
+	 * being filled and encoded */
+	pthread_mutex_lock(&queue->mutex);
+	if (queue->free_frames.num < queue->limit + 2) {
+		da_push_back(queue->free_frames, &frame);
+		frame = NULL;
+	}
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (frame)
+		free_frame(frame);
+}
+
+static inline size_t queue_depth(const struct encoder_frame_queue *queue)
+{
+	return queue->frames.size / sizeof(struct encoder_queued_frame *);
+}
+
+/* mutex must be locked.  removes the oldest frame that isn't marked keep and
+ * returns it, the frames in front of it are put back in the same order */
+static struct encoder_queued_frame *drop_oldest(struct encoder_frame_queue *queue)
+{
+	struct encoder_queued_frame *kept[ENCODER_QUEUE_MAX_SIZE];
+	struct encoder_queued_frame *frame = NULL;
+	size_t num_kept = 0;
+
+	while (queue_depth(queue)) {
+		deque_pop_front(&queue->frames, &frame, sizeof(frame));
+		if (!frame->keep)
+			break;
+
+		kept[num_kept++] = frame;
+		frame = NULL;
+	}
+
+	while (num_kept)
+		deque_push_front(&queue->frames, &kept[--num_kept], sizeof(frame));
+
+	if (frame)
+		queue->stats.dropped_frames++;
+	return frame;
+}
+
+bool encoder_frame_queue_push(struct encoder_frame_queue *queue, struct encoder_queued_frame *frame)
+{
+	struct encoder_queued_frame *dropped = NULL;
+	uint64_t block_start = 0;
+	size_t depth;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while (!os_atomic_load_bool(&queue->stop) && queue_depth(queue) >= queue->limit) {
+		if (queue->overflow == OBS_ENCODER_OVERFLOW_BLOCK) {
+			if (!block_start) {
+				block_start = os_gettime_ns();
+				queue->stats.blocked_frames++;
+			}
+
+			pthread_mutex_unlock(&queue->mutex);
+			os_event_wait(queue->space_event);
+			pthread_mutex_lock(&queue->mutex);
+
+		} else if (queue->overflow == OBS_ENCODER_OVERFLOW_DROP_OLDEST && !dropped &&
+			   (dropped = drop_oldest(queue)) != NULL) {
+			/* the new frame takes its place */
+
+		} else {
+			queue->stats.skipped_frames++;
+			goto skip;
+		}
+	}
+
+	if (block_start)
+		queue->stats.blocked_ns += os_gettime_ns() - block_start;
+	if (os_atomic_load_bool(&queue->stop))
+		goto skip;
+
+	frame->queued_ts = os_gettime_ns();
+	deque_push_back(&queue->frames, &frame, sizeof(frame));
+
+	depth = queue_depth(queue);
+	queue->stats.queue_depth = (uint32_t)depth;
+	if (depth > queue->stats.max_queue_depth)
+		queue->stats.max_queue_depth = (uint32_t)depth;
+	queue->stats.queued_frames++;
+
+	pthread_mutex_unlock(&queue->mutex);
+
+	/* a dropped frame was replaced, so the number of queued frames the
+	 * semaphore counts stays the same */
+	if (dropped)
+		encoder_queued_frame_release(dropped);
+	else
+		os_sem_post(queue->frames_sem);
+	return true;
+
+skip:
+	pthread_mutex_unlock(&queue->mutex);
+	encoder_queued_frame_release(dropped);
+	encoder_queued_frame_release(frame);
+	return false;
+}
+
+struct encoder_queued_frame *encoder_frame_queue_pop(struct encoder_frame_queue *queue)
+{
+	struct encoder_queued_frame *frame = NULL;
+
+	if (os_sem_wait(queue->frames_sem) != 0)
+		return NULL;
+
+	pthread_mutex_lock(&queue->mutex);
+	if (!os_atomic_load_bool(&queue->stop) && queue_depth(queue)) {
+		deque_pop_front(&queue->frames, &frame, sizeof(frame));
+		queue->stats.queue_depth = (uint32_t)queue_depth(queue);
+		queue->stats.encoded_frames++;
+	}
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (frame)
+		os_event_signal(queue->space_event);
+	return frame;
+}
+
+void encoder_frame_queue_stop(struct encoder_frame_queue *queue)
+{
+	os_atomic_set_bool(&queue->stop, true);
+	os_sem_post(queue->frames_sem);
+	os_event_signal(queue->space_event);
+}
+
+void encoder_frame_queue_reset(struct encoder_frame_queue *queue)
+{
+	struct encoder_queued_frame *frame;
+
+	pthread_mutex_lock(&queue->mutex);
+	while (queue_depth(queue)) {
+		deque_pop_front(&queue->frames, &frame, sizeof(frame));
+
+		pthread_mutex_unlock(&queue->mutex);
+		encoder_queued_frame_release(frame);
+		pthread_mutex_lock(&queue->mutex);
+	}
+	queue->stats.queue_depth = 0;
+	pthread_mutex_unlock(&queue->mutex);
+
+	/* nothing waits on the queue at this point, so the semaphore can
+	 * simply be replaced instead of taking every count back */
+	os_sem_destroy(queue->frames_sem);
+	os_sem_init(&queue->frames_sem, 0);
+	os_event_reset(queue->space_event);
+	os_atomic_set_bool(&queue->stop, false);
+}
+
+void encoder_frame_queue_add_timing(struct encoder_frame_queue *queue, const struct encoder_queued_frame *frame,
+				    uint64_t fer, uint64_t ferc)
+{
+	struct obs_encoder_async_stats *stats = &queue->stats;
+	uint64_t queue_ns = fer > frame->queued_ts ? fer - frame->queued_ts : 0;
+	uint64_t encode_ns = ferc > fer ? ferc - fer : 0;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	queue->total_queue_ns += queue_ns;
+	queue->total_encode_ns += encode_ns;
+	queue->timed_frames++;
+
+	stats->last_queue_ns = queue_ns;
+	if (queue_ns > stats->max_queue_ns)
+		stats->max_queue_ns = queue_ns;
+
+	stats->last_encode_ns = encode_ns;
+	if (encode_ns > stats->max_encode_ns)
+		stats->max_encode_ns = encode_ns;
+
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+void encoder_frame_queue_get_stats(struct encoder_frame_queue *queue, struct obs_encoder_async_stats *stats)
+{
+	pthread_mutex_lock(&queue->mutex);
+
+	*stats = queue->stats;
+	if (queue->timed_frames) {
+		stats->avg_queue_ns = queue->total_queue_ns / queue->timed_frames;
+		stats->avg_encode_ns = queue->total_encode_ns / queue->timed_frames;
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+}
@@ -0,0 +1,122 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Internal: the bounded frame queue between the thread that produces raw
+ * frames for an asynchronous encoder and the encoder's own thread.
+ *
+ * Raw frames from video-io and audio-io are only valid during the callback,
+ * so each is copied once into a queued frame.  Queued frames are reference
+ * counted and come from a free list kept by the queue, so once the queue has
+ * filled up no more memory is allocated.
+ *
+ * When the queue is full, a new frame is handled by the queue's overflow
+ * policy, see enum obs_encoder_overflow.  Frames marked keep (the first frame
+ * after starting) are never dropped.
+ *
+ * The functions are exported for the unit tests only, they are not part of
+ * the public API.
+ */
+
+#include "util/c99defs.h"
+#include "util/darray.h"
+#include "util/deque.h"
+#include "util/threading.h"
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENCODER_QUEUE_MAX_SIZE 64
+
+struct encoder_frame_queue;
+
+struct encoder_queued_frame {
+	volatile long refs;
+	struct encoder_frame_queue *queue;
+
+	/* planes point into data */
+	struct encoder_frame frame;
+	uint8_t *data;
+	size_t capacity;
+
+	/* composition time of video frames, for encoder_packet_time */
+	uint64_t cts;
+	bool has_cts;
+	bool keep;
+
+	uint64_t queued_ts;
+};
+
+struct encoder_frame_queue {
+	size_t limit;
+	enum obs_encoder_overflow overflow;
+
+	pthread_mutex_t mutex;
+	os_sem_t *frames_sem;
+	os_event_t *space_event;
+	volatile bool stop;
+
+	struct deque frames;
+	DARRAY(struct encoder_queued_frame *) free_frames;
+
+	struct obs_encoder_async_stats stats;
+	uint64_t total_queue_ns;
+	uint64_t total_encode_ns;
+	uint64_t timed_frames;
+};
+
+EXPORT bool encoder_frame_queue_init(struct encoder_frame_queue *queue, size_t limit,
+				     enum obs_encoder_overflow overflow);
+EXPORT void encoder_frame_queue_free(struct encoder_frame_queue *queue);
+
+/** Returns a frame with room for size bytes of data and one reference */
+EXPORT struct encoder_queued_frame *encoder_frame_queue_get_frame(struct encoder_frame_queue *queue, size_t size);
+EXPORT void encoder_queued_frame_addref(struct encoder_queued_frame *frame);
+EXPORT void encoder_queued_frame_release(struct encoder_queued_frame *frame);
+
+/**
+ * Queues a frame, taking over the caller's reference.  Returns false if the
+ * frame was not queued because the queue is full (OBS_ENCODER_OVERFLOW_SKIP)
+ * or stopped.
+ */
+EXPORT bool encoder_frame_queue_push(struct encoder_frame_queue *queue, struct encoder_queued_frame *frame);
+
+/** Waits for the next frame and passes its reference on to the caller.
+ * Returns NULL once the queue has been stopped. */
+EXPORT struct encoder_queued_frame *encoder_frame_queue_pop(struct encoder_frame_queue *queue);
+
+/** Wakes up all waiting threads, after which pop returns NULL and push
+ * fails until the queue is reset */
+EXPORT void encoder_frame_queue_stop(struct encoder_frame_queue *queue);
+
+/** Releases all queued frames and allows the queue to be used again */
+EXPORT void encoder_frame_queue_reset(struct encoder_frame_queue *queue);
+
+/** Records the timing of a frame taken from the queue, fer and ferc being
+ * its encode request and encode request complete times */
+EXPORT void encoder_frame_queue_add_timing(struct encoder_frame_queue *queue,
+					   const struct encoder_queued_frame *frame, uint64_t fer, uint64_t ferc);
+
+EXPORT void encoder_frame_queue_get_stats(struct encoder_frame_queue *queue, struct obs_encoder_async_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,6 +18,7 @@
 #include "obs.h"
 #include "obs-internal.h"
 #include "util/util_uint64.h"
+#include "media-io/video-frame.h"
 
 #define encoder_active(encoder) os_atomic_load_bool(&encoder->active)
 #define set_encoder_active(encoder, val) os_atomic_set_bool(&encoder->active, val)
@@ -85,6 +86,7 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name, obs_data
 	pthread_mutex_init_value(&encoder->outputs_mutex);
 	pthread_mutex_init_value(&encoder->pause.mutex);
 	pthread_mutex_init_value(&encoder->roi_mutex);
+	pthread_mutex_init_value(&encoder->stats_mutex);
 
 	if (!obs_context_data_init(&encoder->context, OBS_OBJ_TYPE_ENCODER, settings, name, NULL, hotkey_data, false))
 		return false;
@@ -98,6 +100,10 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name, obs_data
 		return false;
 	if (pthread_mutex_init(&encoder->roi_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->stats_mutex, NULL) != 0)
+		return false;
+
+	encoder->stats_start_ts = os_gettime_ns();
 
 	if (encoder->orig_info.get_defaults) {
 		encoder->orig_info.get_defaults(encoder->context.settings);
@@ -342,12 +348,19 @@ static void maybe_set_up_gpu_rescale(struct obs_encoder *encoder)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
+static void start_async_encode(struct obs_encoder *encoder, const struct video_scale_info *info);
+static void stop_async_encode(struct obs_encoder *encoder);
+static void join_async_thread(struct obs_encoder *encoder);
+
 static void add_connection(struct obs_encoder *encoder)
 {
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		struct audio_convert_info audio_info = {0};
 		get_audio_info(encoder, &audio_info);
 
+		if (encoder->async_queue)
+			start_async_encode(encoder, NULL);
+
 		audio_output_connect(encoder->media, encoder->mixer_idx, &audio_info, receive_audio, encoder);
 	} else {
 		struct video_scale_info info = {0};
@@ -356,6 +369,9 @@ static void add_connection(struct obs_encoder *encoder)
 		if (gpu_encode_available(encoder)) {
 			start_gpu_encode(encoder);
 		} else {
+			if (encoder->async_queue)
+				start_async_encode(encoder, &info);
+
 			start_raw_video(encoder->media, &info, encoder->frame_rate_divisor, receive_video, encoder);
 		}
 	}
@@ -375,6 +391,11 @@ static void add_connection(struct obs_encoder *encoder)
 void obs_encoder_group_actually_destroy(obs_encoder_group_t *group);
 static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 {
+	/* wake up the encode thread, and a producer that may be waiting for
+	 * space in its queue while holding the media output's input mutex */
+	if (encoder->async_thread_active)
+		encoder_frame_queue_stop(encoder->async_queue);
+
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		audio_output_disconnect(encoder->media, encoder->mixer_idx, receive_audio, encoder);
 	} else {
@@ -385,6 +406,9 @@ static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 		}
 	}
 
+	/* frames still queued at this point are dropped */
+	stop_async_encode(encoder);
+
 	if (encoder->encoder_group) {
 		pthread_mutex_lock(&encoder->encoder_group->mutex);
 		if (--encoder->encoder_group->num_encoders_started == 0)
@@ -432,6 +456,12 @@ void obs_encoder_destroy(obs_encoder_t *encoder)
 
 		free_audio_buffers(encoder);
 
+		if (encoder->async_queue) {
+			join_async_thread(encoder);
+			encoder_frame_queue_free(encoder->async_queue);
+			bfree(encoder->async_queue);
+		}
+
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
 		da_free(encoder->callbacks);
@@ -442,6 +472,11 @@ void obs_encoder_destroy(obs_encoder_t *encoder)
 		pthread_mutex_destroy(&encoder->outputs_mutex);
 		pthread_mutex_destroy(&encoder->pause.mutex);
 		pthread_mutex_destroy(&encoder->roi_mutex);
+		pthread_mutex_destroy(&encoder->stats_mutex);
+		histogram_free(&encoder->encode_hist);
+		histogram_free(&encoder->queue_hist);
+		histogram_free(&encoder->keyframe_size_hist);
+		histogram_free(&encoder->frame_size_hist);
 		obs_context_data_free(&encoder->context);
 		if (encoder->owns_info_id)
 			bfree((void *)encoder->info.id);
@@ -1261,6 +1296,7 @@ static void send_first_video_packet(struct obs_encoder *encoder, struct encoder_
 				    struct encoder_packet *packet, struct encoder_packet_time *packet_time)
 {
 	struct encoder_packet first_packet;
+	struct encoder_packet sei_packet;
 	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
@@ -1280,14 +1316,18 @@ static void send_first_video_packet(struct obs_encoder *encoder, struct encoder_
 	da_push_back_array(data, sei, size);
 	da_push_back_array(data, packet->data, packet->size);
 
-	first_packet = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	sei_packet = *packet;
+	sei_packet.data = data.array;
+	sei_packet.size = data.num;
+
+	/* callbacks may keep references to the packets they receive */
+	obs_encoder_packet_create_instance(&first_packet, &sei_packet);
+	da_free(data);
 
 	cb->new_packet(cb->param, &first_packet, packet_time);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static const char *send_packet_name = "send_packet";
@@ -1334,6 +1374,13 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 	}
 
 	if (received) {
+		pthread_mutex_lock(&encoder->stats_mutex);
+		if (pkt->type == OBS_ENCODER_VIDEO && pkt->keyframe)
+			histogram_record(&encoder->keyframe_size_hist, pkt->size);
+		else
+			histogram_record(&encoder->frame_size_hist, pkt->size);
+		pthread_mutex_unlock(&encoder->stats_mutex);
+
 		if (!encoder->first_received) {
 			encoder->offset_usec = packet_dts_usec(pkt);
 			encoder->first_received = true;
@@ -1372,12 +1419,23 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
+		/* the data is copied once and shared by all callbacks, which
+		 * take their own references instead of copying it again */
+		struct encoder_packet shared = {0};
+		if (encoder->callbacks.num)
+			obs_encoder_packet_create_instance(&shared, pkt);
+
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
+			struct encoder_packet cb_pkt = shared;
+
 			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt, found_ept ? &ept_local : NULL);
+			send_packet(encoder, cb, &cb_pkt, found_ept ? &ept_local : NULL);
 		}
 
+		if (encoder->callbacks.num)
+			obs_encoder_packet_release(&shared);
+
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 
 		// Count number of video frames successfully encoded
@@ -1386,8 +1444,18 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 	}
 }
 
+void encoder_record_frame_timing(obs_encoder_t *encoder, const uint64_t *frame_cts, uint64_t fer, uint64_t ferc)
+{
+	pthread_mutex_lock(&encoder->stats_mutex);
+	histogram_record(&encoder->encode_hist, ferc - fer);
+	if (frame_cts && *frame_cts && fer > *frame_cts)
+		histogram_record(&encoder->queue_hist, fer - *frame_cts);
+	pthread_mutex_unlock(&encoder->stats_mutex);
+}
+
 static const char *do_encode_name = "do_encode";
-bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const uint64_t *frame_cts)
+static bool encode_frame(struct obs_encoder *encoder, struct encoder_frame *frame, const uint64_t *frame_cts,
+			 uint64_t *fer, uint64_t *ferc)
 {
 	profile_start(do_encode_name);
 	if (!encoder->profile_encoder_encode_name)
@@ -1398,6 +1466,7 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const u
 	bool received = false;
 	bool success;
 	uint64_t fer_ts = 0;
+	uint64_t ferc_ts = 0;
 
 	if (encoder->reconfigure_requested) {
 		encoder->reconfigure_requested = false;
@@ -1417,15 +1486,17 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const u
 	success = encoder->info.encode(encoder->context.data, frame, &pkt, &received);
 	profile_end(encoder->profile_encoder_encode_name);
 
+	// Get the frame encode request complete timestamp
+	ferc_ts = os_gettime_ns();
+
 	/* Generate and enqueue the frame timing metrics, namely
 	 * the CTS (composition time), FER (frame encode request), FERC
 	 * (frame encode request complete) and current PTS. PTS is used to
 	 * associate the frame timing data with the encode packet. */
 	if (frame_cts) {
 		struct encoder_packet_time *ept = da_push_back_new(encoder->encoder_packet_times);
-		// Get the frame encode request complete timestamp
 		if (success) {
-			ept->ferc = os_gettime_ns();
+			ept->ferc = ferc_ts;
 		} else {
 			// Encode had error, set ferc to 0
 			ept->ferc = 0;
@@ -1434,13 +1505,274 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const u
 		ept->cts = *frame_cts;
 		ept->fer = fer_ts;
 	}
+	if (success)
+		encoder_record_frame_timing(encoder, frame_cts, fer_ts, ferc_ts);
 	send_off_encoder_packet(encoder, success, received, &pkt);
 
 	profile_end(do_encode_name);
 
+	if (fer)
+		*fer = fer_ts;
+	if (ferc)
+		*ferc = ferc_ts;
 	return success;
 }
 
+bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const uint64_t *frame_cts)
+{
+	return encode_frame(encoder, frame, frame_cts, NULL, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+/* asynchronous encoding                                                     */
+
+static void *async_encode_thread(void *data)
+{
+	struct obs_encoder *encoder = data;
+	struct encoder_frame_queue *queue = encoder->async_queue;
+	struct encoder_queued_frame *frame;
+
+	os_set_thread_name("obs encoder thread");
+
+	while ((frame = encoder_frame_queue_pop(queue)) != NULL) {
+		uint64_t fer, ferc;
+		bool success;
+
+		success = encode_frame(encoder, &frame->frame, frame->has_cts ? &frame->cts : NULL, &fer, &ferc);
+		encoder_frame_queue_add_timing(queue, frame, fer, ferc);
+		encoder_queued_frame_release(frame);
+
+		/* encode errors stop the encoder via full_stop */
+		if (!success)
+			break;
+
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static void join_async_thread(struct obs_encoder *encoder)
+{
+	if (!encoder->async_thread_active)
+		return;
+
+	encoder_frame_queue_stop(encoder->async_queue);
+	pthread_join(encoder->async_thread, NULL);
+	encoder_frame_queue_reset(encoder->async_queue);
+	encoder->async_thread_active = false;
+}
+
+static void start_async_encode(struct obs_encoder *encoder, const struct video_scale_info *info)
+{
+	/* the thread may still be around if it stopped the encoder itself */
+	join_async_thread(encoder);
+
+	if (info) {
+		encoder->async_format = info->format;
+		encoder->async_height = info->height;
+	}
+
+	if (pthread_create(&encoder->async_thread, NULL, async_encode_thread, encoder) != 0) {
+		blog(LOG_WARNING, "encoder '%s': Failed to create encode thread, encoding synchronously",
+		     encoder->context.name);
+		return;
+	}
+
+	encoder->async_thread_active = true;
+}
+
+static void stop_async_encode(struct obs_encoder *encoder)
+{
+	if (!encoder->async_thread_active)
+		return;
+
+	/* on encode errors the encoder is stopped from its own thread, which
+	 * can't join itself.  it exits once it returns to its loop and is
+	 * joined when the encoder is started again or destroyed. */
+	if (pthread_equal(pthread_self(), encoder->async_thread))
+		return;
+
+	join_async_thread(encoder);
+}
+
+static void queue_video_frame(struct obs_encoder *encoder, const struct encoder_frame *in, uint64_t cts)
+{
+	uint32_t heights[MAX_AV_PLANES] = {0};
+	struct encoder_queued_frame *frame;
+	size_t size = 0;
+	uint8_t *data;
+
+	video_frame_get_plane_heights(heights, encoder->async_format, encoder->async_height);
+
+	for (size_t i = 0; i < MAX_AV_PLANES && in->data[i]; i++)
+		size += (size_t)in->linesize[i] * heights[i];
+
+	frame = encoder_frame_queue_get_frame(encoder->async_queue, size);
+	data = frame->data;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && in->data[i]; i++) {
+		size_t plane_size = (size_t)in->linesize[i] * heights[i];
+
+		memcpy(data, in->data[i], plane_size);
+		frame->frame.data[i] = data;
+		frame->frame.linesize[i] = in->linesize[i];
+		data += plane_size;
+	}
+
+	frame->frame.frames = in->frames;
+	frame->frame.pts = in->pts;
+	frame->cts = cts;
+	frame->has_cts = true;
+
+	/* the first frame starts the encoder's timeline, so it's never
+	 * dropped to make room for newer frames */
+	frame->keep = in->pts == 0;
+
+	encoder_frame_queue_push(encoder->async_queue, frame);
+}
+
+static void queue_audio_frame(struct obs_encoder *encoder)
+{
+	struct encoder_queued_frame *frame;
+	uint8_t *data;
+
+	frame = encoder_frame_queue_get_frame(encoder->async_queue, encoder->planes * encoder->framesize_bytes);
+	data = frame->data;
+
+	for (size_t i = 0; i < encoder->planes; i++) {
+		deque_pop_front(&encoder->audio_input_buffer[i], data, encoder->framesize_bytes);
+
+		frame->frame.data[i] = data;
+		frame->frame.linesize[i] = (uint32_t)encoder->framesize_bytes;
+		data += encoder->framesize_bytes;
+	}
+
+	frame->frame.frames = (uint32_t)encoder->framesize;
+	frame->frame.pts = encoder->cur_pts;
+
+	encoder_frame_queue_push(encoder->async_queue, frame);
+}
+
+bool obs_encoder_set_async(obs_encoder_t *encoder, bool async, size_t queue_size, enum obs_encoder_overflow overflow)
+{
+	struct encoder_frame_queue *queue = NULL;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_async"))
+		return false;
+	if (encoder_active(encoder)) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot change asynchronous "
+		     "encoding while the encoder is active",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	if (async) {
+		/* dropping audio would leave gaps in it */
+		if (encoder->info.type == OBS_ENCODER_AUDIO)
+			overflow = OBS_ENCODER_OVERFLOW_BLOCK;
+
+		queue = bmalloc(sizeof(*queue));
+		if (!encoder_frame_queue_init(queue, queue_size, overflow)) {
+			bfree(queue);
+			return false;
+		}
+	}
+
+	join_async_thread(encoder);
+
+	if (encoder->async_queue) {
+		encoder_frame_queue_free(encoder->async_queue);
+		bfree(encoder->async_queue);
+	}
+
+	encoder->async_queue = queue;
+	return true;
+}
+
+bool obs_encoder_async(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_async") ? encoder->async_queue != NULL : false;
+}
+
+bool obs_encoder_get_async_stats(const obs_encoder_t *encoder, struct obs_encoder_async_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_async_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_encoder_get_async_stats"))
+		return false;
+
+	if (!encoder->async_queue) {
+		memset(stats, 0, sizeof(*stats));
+		return true;
+	}
+
+	encoder_frame_queue_get_stats(encoder->async_queue, stats);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* statistics                                                                */
+
+static void get_distribution(const struct histogram *hist, struct obs_encoder_distribution *dist)
+{
+	dist->count = hist->count;
+	dist->min = hist->min;
+	dist->max = hist->max;
+	dist->mean = histogram_mean(hist);
+	dist->p50 = histogram_percentile(hist, 50.0);
+	dist->p90 = histogram_percentile(hist, 90.0);
+	dist->p99 = histogram_percentile(hist, 99.0);
+	dist->p999 = histogram_percentile(hist, 99.9);
+}
+
+/* stats_mutex must be locked */
+static void get_stats(const struct obs_encoder *encoder, struct obs_encoder_stats *stats, uint64_t now)
+{
+	stats->duration_ns = now - encoder->stats_start_ts;
+	get_distribution(&encoder->encode_hist, &stats->encode_ns);
+	get_distribution(&encoder->queue_hist, &stats->queue_ns);
+	get_distribution(&encoder->keyframe_size_hist, &stats->keyframe_bytes);
+	get_distribution(&encoder->frame_size_hist, &stats->frame_bytes);
+}
+
+bool obs_encoder_get_stats(obs_encoder_t *encoder, struct obs_encoder_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_encoder_get_stats"))
+		return false;
+
+	pthread_mutex_lock(&encoder->stats_mutex);
+	get_stats(encoder, stats, os_gettime_ns());
+	pthread_mutex_unlock(&encoder->stats_mutex);
+	return true;
+}
+
+bool obs_encoder_snapshot_stats(obs_encoder_t *encoder, struct obs_encoder_stats *stats)
+{
+	uint64_t now;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_snapshot_stats"))
+		return false;
+
+	pthread_mutex_lock(&encoder->stats_mutex);
+
+	now = os_gettime_ns();
+	if (stats)
+		get_stats(encoder, stats, now);
+
+	histogram_reset(&encoder->encode_hist);
+	histogram_reset(&encoder->queue_hist);
+	histogram_reset(&encoder->keyframe_size_hist);
+	histogram_reset(&encoder->frame_size_hist);
+	encoder->stats_start_ts = now;
+
+	pthread_mutex_unlock(&encoder->stats_mutex);
+	return true;
+}
+
 static inline bool video_pause_check_internal(struct pause_data *pause, uint64_t ts)
 {
 	pause->last_video_ts = ts;
@@ -1519,8 +1851,15 @@ static void receive_video(void *param, struct video_data *frame)
 	enc_frame.frames = 1;
 	enc_frame.pts = encoder->cur_pts;
 
-	if (do_encode(encoder, &enc_frame, &frame->timestamp))
+	/* frames dropped from the queue leave a gap in the timestamps rather
+	 * than shifting every following frame */
+	if (encoder->async_thread_active) {
+		queue_video_frame(encoder, &enc_frame, frame->timestamp);
+		encoder->cur_pts += encoder->timebase_num * encoder->frame_rate_divisor;
+
+	} else if (do_encode(encoder, &enc_frame, &frame->timestamp)) {
 		encoder->cur_pts += encoder->timebase_num * encoder->frame_rate_divisor;
+	}
 
 wait_for_audio:
 	profile_end(receive_video_name);
@@ -1634,6 +1973,12 @@ static bool send_audio_data(struct obs_encoder *encoder)
 {
 	struct encoder_frame enc_frame;
 
+	if (encoder->async_thread_active) {
+		queue_audio_frame(encoder);
+		encoder->cur_pts += encoder->framesize;
+		return true;
+	}
+
 	memset(&enc_frame, 0, sizeof(struct encoder_frame));
 
 	for (size_t i = 0; i < encoder->planes; i++) {
@@ -1776,9 +2121,8 @@ void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct
 	long *p_refs;
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
+	p_refs = packet_pool_alloc(src->size);
 	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1802,13 +2146,25 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 
 	if (pkt->data) {
 		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
+		long refs = os_atomic_dec_long(p_refs);
+
+		if (refs == 0)
 			bfree(p_refs);
+		else if (refs == PACKET_POOL_REFS)
+			packet_pool_free(p_refs);
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
 }
 
+void obs_encoder_packet_pool_get_stats(struct obs_encoder_packet_pool_stats *stats)
+{
+	if (!obs_ptr_valid(stats, "obs_encoder_packet_pool_get_stats"))
+		return;
+
+	packet_pool_get_stats(stats);
+}
+
 void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder, enum video_format format)
 {
 	if (!encoder || encoder->info.type != OBS_ENCODER_VIDEO)
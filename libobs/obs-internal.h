@@ -21,6 +21,7 @@
 #include "util/darray.h"
 #include "util/deque.h"
 #include "util/dstr.h"
+#include "util/histogram.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
@@ -38,6 +39,9 @@
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-encoder-queue.h"
+#include "obs-output-interleave.h"
+#include "obs-packet-pool.h"
 
 #include <obsversion.h>
 #include <caption/caption.h>
@@ -322,8 +326,20 @@ struct obs_tex_frame {
 	uint64_t lock_key;
 	int count;
 	bool released;
+	size_t id;
 };
 
+/* with threaded GPU encoding, a texture stays out of the avail queue until
+ * the GPU encode thread and every encoder it was handed to let go of it */
+struct obs_tex_frame_hold {
+	struct obs_tex_frame frame;
+	long refs;
+	uint64_t first_release;
+	uint64_t last_release;
+};
+
+struct gpu_encode_worker;
+
 struct obs_task_info {
 	obs_task_t task;
 	void *param;
@@ -366,6 +382,14 @@ struct obs_core_video_mix {
 	bool gpu_encode_thread_initialized;
 	volatile bool gpu_encode_stop;
 
+	/* see obs_set_threaded_gpu_encode, the holds and stats are protected
+	 * by gpu_encoder_mutex */
+	bool gpu_encode_threaded;
+	struct obs_tex_frame_hold gpu_encoder_holds[NUM_ENCODE_TEXTURES];
+	size_t gpu_encoder_frames_held;
+	os_event_t *gpu_encoder_frame_released;
+	struct obs_gpu_encode_stats gpu_encode_stats;
+
 	video_t *video;
 	struct obs_video_info ovi;
 
@@ -433,6 +457,13 @@ struct obs_core_video {
 
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
+
+	volatile bool parallel_tick;
+	os_work_pool_t *tick_pool;
+	bool tick_pool_failed;
+
+	volatile bool threaded_gpu_encode;
+	volatile bool threaded_video_inputs;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
@@ -465,6 +496,12 @@ struct obs_core_audio {
 	bool monitoring_duplication_prevented_on_prev_tick;
 };
 
+struct source_tick_job {
+	obs_source_t *source;
+	uint64_t start;
+	uint64_t end;
+};
+
 /* user sources, output channels, and displays */
 struct obs_core_data {
 	/* Hash tables (uthash) */
@@ -489,6 +526,7 @@ struct obs_core_data {
 	pthread_mutex_t audio_sources_mutex;
 	pthread_mutex_t draw_callbacks_mutex;
 	pthread_mutex_t canvases_mutex;
+	pthread_mutex_t packet_buses_mutex;
 	DARRAY(struct draw_callback) draw_callbacks;
 	DARRAY(struct rendered_callback) rendered_callbacks;
 	DARRAY(struct tick_callback) tick_callbacks;
@@ -504,6 +542,10 @@ struct obs_core_data {
 
 	DARRAY(char *) protocols;
 	DARRAY(obs_source_t *) sources_to_tick;
+	DARRAY(struct source_tick_job) parallel_ticks;
+
+	/* interleaving shared by outputs that use the same encoders */
+	DARRAY(struct obs_packet_bus *) packet_buses;
 };
 
 /* user hotkeys */
@@ -756,6 +798,14 @@ struct async_frame {
 	bool used;
 };
 
+/* frame from obs_source_output_video3: the data belongs to the producer and
+ * is handed back through the release callback when the last ref goes away */
+struct obs_source_ext_frame {
+	struct obs_source_frame frame;
+	obs_source_frame_release_t release;
+	void *release_param;
+};
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -912,6 +962,7 @@ struct obs_source {
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
 	DARRAY(struct obs_source_frame *) async_frames;
+	DARRAY(struct obs_source_frame *) async_release_frames;
 	pthread_mutex_t async_mutex;
 	uint32_t async_width;
 	uint32_t async_height;
@@ -1122,6 +1173,8 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source, bool centere
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+extern void obs_source_video_tick_prepare(obs_source_t *source, float seconds);
+extern void obs_source_video_tick_finish(obs_source_t *source, float seconds);
 extern float obs_source_get_target_volume(obs_source_t *source, obs_source_t *target);
 extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
 
@@ -1137,6 +1190,7 @@ extern bool update_async_textures(struct obs_source *source, const struct obs_so
 				  gs_texture_t *tex[MAX_AV_PLANES], gs_texrender_t *texrender);
 extern bool set_async_texture_size(struct obs_source *source, const struct obs_source_frame *frame);
 extern void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame);
+extern void release_external_frames(obs_source_t *source);
 
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source, uint64_t sys_time);
@@ -1150,6 +1204,8 @@ enum delay_msg {
 	DELAY_MSG_PACKET,
 	DELAY_MSG_START,
 	DELAY_MSG_STOP,
+	/* a spilled packet couldn't be read back */
+	DELAY_MSG_SPILL_ERROR,
 };
 
 struct delay_data {
@@ -1158,8 +1214,13 @@ struct delay_data {
 	struct encoder_packet packet;
 	bool packet_time_valid;
 	struct encoder_packet_time packet_time;
+
+	/* packet data is in the spill store instead of in memory */
+	bool spilled;
 };
 
+struct delay_spill;
+
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet, struct encoder_packet_time *frame_time);
 
 struct obs_weak_output {
@@ -1209,27 +1270,58 @@ struct keyframe_group_data {
 	enum keyframe_group_track_status seen_on_track[MAX_OUTPUT_VIDEO_ENCODERS];
 };
 
-struct obs_output {
-	struct obs_context_data context;
-	struct obs_output_info info;
+struct packet_bus_subscriber {
+	struct obs_output *output;
 
-	/* indicates ownership of the info.id buffer */
-	bool owns_info_id;
+	/* outputs added to a running bus start at the next keyframe, with
+	 * their own offsets on top of the bus offsets */
+	bool joined;
+	bool video_started[MAX_OUTPUT_VIDEO_ENCODERS];
+	int64_t join_dts_usec;
+	int64_t join_pts_usec;
+	int64_t video_offsets[MAX_OUTPUT_VIDEO_ENCODERS];
+	int64_t audio_offsets[MAX_OUTPUT_AUDIO_ENCODERS];
+};
+
+struct obs_packet_bus {
+	pthread_mutex_t mutex;
+	long refs; /* protected by obs->data.packet_buses_mutex */
+	bool shared;
+
+	struct obs_encoder *video_encoders[MAX_OUTPUT_VIDEO_ENCODERS];
+	struct obs_encoder *audio_encoders[MAX_OUTPUT_AUDIO_ENCODERS];
+	size_t first_video_idx;
+	size_t first_audio_idx;
 
 	bool received_video[MAX_OUTPUT_VIDEO_ENCODERS];
 	DARRAY(struct keyframe_group_data) keyframe_group_tracking;
 	bool received_audio;
-	volatile bool data_active;
-	volatile bool end_data_capture_thread_active;
 	int64_t video_offsets[MAX_OUTPUT_VIDEO_ENCODERS];
 	int64_t audio_offsets[MAX_OUTPUT_AUDIO_ENCODERS];
 	int64_t highest_audio_ts;
 	int64_t highest_video_ts[MAX_OUTPUT_VIDEO_ENCODERS];
+	struct packet_interleaver interleaver;
+	size_t max_batch_size;
+
+	DARRAY(struct encoder_packet_time)
+	encoder_packet_times[MAX_OUTPUT_VIDEO_ENCODERS];
+
+	DARRAY(struct packet_bus_subscriber) subscribers;
+};
+
+struct obs_output {
+	struct obs_context_data context;
+	struct obs_output_info info;
+
+	/* indicates ownership of the info.id buffer */
+	bool owns_info_id;
+
+	volatile bool data_active;
+	volatile bool end_data_capture_thread_active;
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
-	size_t interleaver_max_batch_size;
+	struct obs_packet_bus *bus;
 	int stop_code;
 
 	int reconnect_retry_sec;
@@ -1277,9 +1369,6 @@ struct obs_output {
 	// captions are output per track
 	struct caption_track_data *caption_tracks[MAX_OUTPUT_VIDEO_ENCODERS];
 
-	DARRAY(struct encoder_packet_time)
-	encoder_packet_times[MAX_OUTPUT_VIDEO_ENCODERS];
-
 	/* Packet callbacks */
 	pthread_mutex_t pkt_callbacks_mutex;
 	DARRAY(struct packet_callback) pkt_callbacks;
@@ -1299,6 +1388,14 @@ struct obs_output {
 	volatile bool delay_active;
 	volatile bool delay_capturing;
 
+	/* memory budget for delayed packet data, the rest goes to disk */
+	uint64_t delay_memory_limit;
+	struct dstr delay_spill_dir;
+	struct delay_spill *delay_spill;
+	size_t delay_spill_first; /* index of the first spilled entry */
+	bool delay_spill_failed;
+	struct obs_output_delay_stats delay_stats;
+
 	char *last_error_message;
 
 	float audio_data[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
@@ -1312,6 +1409,14 @@ static inline void do_output_signal(struct obs_output *output, const char *signa
 	calldata_free(&params);
 }
 
+extern void packet_bus_add_output(struct obs_output *output, bool shared);
+extern void packet_bus_remove_output(struct obs_output *output);
+extern void packet_bus_reset(struct obs_packet_bus *bus);
+extern void packet_bus_push(struct obs_packet_bus *bus, struct encoder_packet *packet,
+			    struct encoder_packet_time *packet_time, bool owned);
+extern void obs_output_send_interleaved(struct obs_output *output, struct encoder_packet *out,
+					struct encoder_packet_time *packet_time);
+
 extern void process_delay(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time);
 extern void obs_output_cleanup_delay(obs_output_t *output);
 extern bool obs_output_delay_start(obs_output_t *output);
@@ -1442,6 +1547,27 @@ struct obs_encoder {
 
 	/* reconfigure encoder at next possible opportunity */
 	bool reconfigure_requested;
+
+	/* encode timing and packet size distributions, see
+	 * obs_encoder_get_stats */
+	pthread_mutex_t stats_mutex;
+	struct histogram encode_hist;
+	struct histogram queue_hist;
+	struct histogram keyframe_size_hist;
+	struct histogram frame_size_hist;
+	uint64_t stats_start_ts;
+
+	/* optional encode thread fed by a frame queue, see
+	 * obs_encoder_set_async */
+	struct encoder_frame_queue *async_queue;
+	pthread_t async_thread;
+	bool async_thread_active;
+	enum video_format async_format;
+	uint32_t async_height;
+
+	/* submission thread of texture encoders, see
+	 * obs_set_threaded_gpu_encode */
+	struct gpu_encode_worker *gpu_worker;
 };
 
 extern struct obs_encoder_info *find_encoder(const char *id);
@@ -1459,6 +1585,8 @@ extern bool start_gpu_encode(obs_encoder_t *encoder);
 extern void stop_gpu_encode(obs_encoder_t *encoder);
 
 extern bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const uint64_t *frame_cts);
+extern void encoder_record_frame_timing(obs_encoder_t *encoder, const uint64_t *frame_cts, uint64_t fer,
+					uint64_t ferc);
 extern void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received, struct encoder_packet *pkt);
 
 void obs_encoder_destroy(obs_encoder_t *encoder);
@@ -1514,6 +1642,8 @@ extern void source_profiler_async_frame_received(obs_source_t *source);
 extern uint64_t source_profiler_source_tick_start(void);
 /* Submit start timestamp for source */
 extern void source_profiler_source_tick_end(obs_source_t *source, uint64_t start);
+/* Submit start and end timestamps for a tick measured on another thread */
+extern void source_profiler_source_tick_add(obs_source_t *source, uint64_t start, uint64_t end);
 
 /* Obtain GPU timer and start timestamp for render start of a source. */
 extern uint64_t source_profiler_source_render_begin(gs_timer_t **timer);
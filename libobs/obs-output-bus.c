@@ -0,0 +1,1004 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include "util/util_uint64.h"
+#include "obs-internal.h"
+
+/*
+ * Packet bus: interleaves the packets of a set of audio and video encoders
+ * and sends them to every output that uses exactly those encoders.  Outputs
+ * without delay share one bus per encoder set, so the interleaving, the
+ * start synchronization and the keyframe alignment checks only run once no
+ * matter how many outputs are active.  Delayed outputs get a bus of their
+ * own that is fed by the delay queue.
+ */
+
+static inline bool data_active(const struct obs_output *output)
+{
+	return os_atomic_load_bool(&output->data_active);
+}
+
+/* names of the outputs on the bus other than the given one, for logging */
+static void get_bus_names(const struct obs_packet_bus *bus, const struct obs_output *exclude, struct dstr *names)
+{
+	dstr_free(names);
+
+	for (size_t i = 0; i < bus->subscribers.num; i++) {
+		const struct obs_output *output = bus->subscribers.array[i].output;
+
+		if (output == exclude)
+			continue;
+		if (!dstr_is_empty(names))
+			dstr_cat(names, "', '");
+		dstr_cat(names, obs_output_get_name(output));
+	}
+
+	if (dstr_is_empty(names))
+		dstr_copy(names, "(none)");
+}
+
+static size_t get_encoder_index(const struct obs_packet_bus *bus, struct encoder_packet *pkt)
+{
+	if (pkt->type == OBS_ENCODER_VIDEO) {
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+			struct obs_encoder *encoder = bus->video_encoders[i];
+
+			if (encoder && pkt->encoder == encoder)
+				return i;
+		}
+	} else if (pkt->type == OBS_ENCODER_AUDIO) {
+		for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+			struct obs_encoder *encoder = bus->audio_encoders[i];
+
+			if (encoder && pkt->encoder == encoder)
+				return i;
+		}
+	}
+
+	assert(false);
+	return 0;
+}
+
+static inline void check_received(struct obs_packet_bus *bus, struct encoder_packet *out)
+{
+	if (out->type == OBS_ENCODER_VIDEO) {
+		if (!bus->received_video[out->track_idx])
+			bus->received_video[out->track_idx] = true;
+	} else {
+		if (!bus->received_audio)
+			bus->received_audio = true;
+	}
+}
+
+static inline void apply_packet_offset(struct encoder_packet *out, struct encoder_packet_time *packet_time,
+				       int64_t offset)
+{
+	out->dts -= offset;
+	out->pts -= offset;
+	if (packet_time)
+		packet_time->pts -= offset;
+
+	out->dts_usec = packet_dts_usec(out);
+}
+
+static inline void apply_interleaved_packet_offset(struct obs_packet_bus *bus, struct encoder_packet *out,
+						   struct encoder_packet_time *packet_time)
+{
+	int64_t offset;
+
+	/* audio and video need to start at timestamp 0, and the encoders
+	 * may not currently be at 0 when we get data.  so, we store the
+	 * current dts as offset and subtract that value from the dts/pts
+	 * of the output packet. */
+	offset = (out->type == OBS_ENCODER_VIDEO) ? bus->video_offsets[out->track_idx]
+						  : bus->audio_offsets[out->track_idx];
+
+	/* converting the newly adjusted dts to relative dts time ensures
+	 * proper interleaving.  if we're using an audio encoder that's already
+	 * been started on another output, then the first audio packet may not
+	 * be quite perfectly synced up in terms of system time (and there's
+	 * nothing we can really do about that), but it will always at least be
+	 * within a 23ish millisecond threshold (at least for AAC) */
+	apply_packet_offset(out, packet_time, offset);
+}
+
+static bool has_higher_opposing_ts(void *param, struct encoder_packet *packet)
+{
+	struct obs_packet_bus *bus = param;
+	bool has_higher = true;
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (!bus->video_encoders[i] || (packet->type == OBS_ENCODER_VIDEO && i == packet->track_idx))
+			continue;
+		has_higher = has_higher && bus->highest_video_ts[i] > packet->dts_usec;
+	}
+
+	return packet->type == OBS_ENCODER_AUDIO ? has_higher
+						 : (has_higher && bus->highest_audio_ts > packet->dts_usec);
+}
+
+/* ------------------------------------------------------------------------- */
+/* subscribers */
+
+static inline int64_t usec_to_ts(int64_t usec, const struct obs_encoder *encoder)
+{
+	return usec * encoder->timebase_den / MICROSECOND_DEN;
+}
+
+/* outputs that are added to a bus that is already sending packets start at
+ * the next video keyframe.  all of their tracks are shifted by the same
+ * amount of time, so the packets stay in the order of the bus. */
+static void subscriber_join(struct obs_packet_bus *bus, struct packet_bus_subscriber *sub,
+			    const struct encoder_packet *keyframe)
+{
+	int64_t pts_usec = keyframe->pts * MICROSECOND_DEN / keyframe->timebase_den;
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (bus->video_encoders[i])
+			sub->video_offsets[i] = usec_to_ts(pts_usec, bus->video_encoders[i]);
+	}
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (bus->audio_encoders[i])
+			sub->audio_offsets[i] = usec_to_ts(pts_usec, bus->audio_encoders[i]);
+	}
+
+	sub->video_offsets[keyframe->track_idx] = keyframe->pts;
+	sub->join_dts_usec = keyframe->dts_usec;
+	sub->join_pts_usec = pts_usec;
+	sub->joined = true;
+
+	struct dstr names = {0};
+	get_bus_names(bus, sub->output, &names);
+	blog(LOG_INFO, "Output '%s': Joined packets shared with output '%s' at %" PRId64 " ms",
+	     obs_output_get_name(sub->output), names.array, pts_usec / 1000);
+	dstr_free(&names);
+}
+
+static bool subscriber_accept(struct obs_packet_bus *bus, struct packet_bus_subscriber *sub,
+			      const struct encoder_packet *packet)
+{
+	if (!sub->joined) {
+		if (packet->type != OBS_ENCODER_VIDEO || packet->track_idx != bus->first_video_idx ||
+		    !packet->keyframe)
+			return false;
+
+		subscriber_join(bus, sub, packet);
+	}
+
+	if (packet->type == OBS_ENCODER_AUDIO)
+		return packet->dts_usec >= sub->join_pts_usec;
+
+	/* other video tracks start at their own next keyframe */
+	if (!sub->video_started[packet->track_idx]) {
+		if (!packet->keyframe || packet->dts_usec < sub->join_dts_usec)
+			return false;
+		sub->video_started[packet->track_idx] = true;
+	}
+
+	return true;
+}
+
+static void send_to_subscribers(struct obs_packet_bus *bus, struct encoder_packet *out,
+				struct encoder_packet_time *packet_time)
+{
+	for (size_t i = 0; i < bus->subscribers.num; i++) {
+		struct packet_bus_subscriber *sub = &bus->subscribers.array[i];
+		struct encoder_packet_time sub_time;
+		struct encoder_packet sub_out;
+		int64_t offset;
+
+		if (!data_active(sub->output) || !subscriber_accept(bus, sub, out))
+			continue;
+
+		obs_encoder_packet_ref(&sub_out, out);
+		if (packet_time)
+			sub_time = *packet_time;
+
+		offset = (out->type == OBS_ENCODER_VIDEO) ? sub->video_offsets[out->track_idx]
+							  : sub->audio_offsets[out->track_idx];
+		if (offset)
+			apply_packet_offset(&sub_out, packet_time ? &sub_time : NULL, offset);
+
+		obs_output_send_interleaved(sub->output, &sub_out, packet_time ? &sub_time : NULL);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* interleaving */
+
+static inline void send_interleaved(struct obs_packet_bus *bus)
+{
+	struct encoder_packet out;
+	struct encoder_packet_time ept_local = {0};
+	bool found_ept = false;
+
+	interleaver_pop(&bus->interleaver, &out);
+
+	if (out.type == OBS_ENCODER_VIDEO) {
+		/* Iterate the array of encoder packet times to
+		 * find a matching PTS entry, and drain the array.
+		 * Packet timing currently applies to video only.
+		 */
+		struct encoder_packet_time *ept = NULL;
+		size_t num_ept = bus->encoder_packet_times[out.track_idx].num;
+		if (num_ept) {
+			for (size_t i = 0; i < num_ept; i++) {
+				ept = &bus->encoder_packet_times[out.track_idx].array[i];
+				if (ept->pts == out.pts) {
+					ept_local = *ept;
+					da_erase(bus->encoder_packet_times[out.track_idx], i);
+					found_ept = true;
+					break;
+				}
+			}
+			if (found_ept == false) {
+				blog(LOG_DEBUG, "%s: Track %lu encoder packet timing for PTS%" PRId64 " not found.",
+				     __FUNCTION__, out.track_idx, out.pts);
+			}
+		} else {
+			// encoder_packet_times should not be empty; log if so.
+			blog(LOG_DEBUG, "%s: Track %lu encoder packet timing array empty.", __FUNCTION__,
+			     out.track_idx);
+		}
+	}
+
+	send_to_subscribers(bus, &out, found_ept ? &ept_local : NULL);
+	obs_encoder_packet_release(&out);
+}
+
+static inline void set_higher_ts(struct obs_packet_bus *bus, struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (bus->highest_video_ts[packet->track_idx] < packet->dts_usec)
+			bus->highest_video_ts[packet->track_idx] = packet->dts_usec;
+	} else {
+		if (bus->highest_audio_ts < packet->dts_usec)
+			bus->highest_audio_ts = packet->dts_usec;
+	}
+}
+
+/* gets the packet where audio and video are closest together, everything
+ * interleaved before it can be discarded */
+static struct encoder_packet *get_interleaved_start(struct obs_packet_bus *bus)
+{
+	struct packet_interleaver *il = &bus->interleaver;
+	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
+	struct encoder_packet *first_video = interleaver_first(il, OBS_ENCODER_VIDEO, 0);
+	struct encoder_packet *first_audio = NULL;
+	struct encoder_packet *start = NULL;
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		size_t num = interleaver_track_size(il, OBS_ENCODER_AUDIO, i);
+
+		for (size_t j = 0; j < num; j++) {
+			struct encoder_packet *packet = interleaver_track_packet(il, OBS_ENCODER_AUDIO, i, j);
+			int64_t diff = llabs(packet->dts_usec - first_video->dts_usec);
+
+			if (!start || diff < closest_diff ||
+			    (diff == closest_diff && interleaver_compare(packet, start) < 0)) {
+				closest_diff = diff;
+				start = packet;
+			}
+		}
+	}
+
+	if (!start || interleaver_compare(first_video, start) < 0)
+		start = first_video;
+
+	/* Early AAC/Opus audio packets will be for "priming" the encoder and contain silence, but they should not be
+	 * discarded. Start at the first audio packet if closest PTS was <= 0. */
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		size_t num = interleaver_track_size(il, OBS_ENCODER_AUDIO, i);
+
+		for (size_t j = 0; j < num; j++) {
+			struct encoder_packet *packet = interleaver_track_packet(il, OBS_ENCODER_AUDIO, i, j);
+
+			if (interleaver_compare(packet, start) >= 0) {
+				if (!first_audio || interleaver_compare(packet, first_audio) < 0)
+					first_audio = packet;
+				break;
+			}
+		}
+	}
+
+	if (first_audio && first_audio->pts <= 0) {
+		for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+			struct encoder_packet *audio = interleaver_first(il, OBS_ENCODER_AUDIO, i);
+			if (audio && interleaver_compare(audio, start) < 0)
+				start = audio;
+		}
+	}
+
+	return start;
+}
+
+static int64_t get_encoder_duration(struct obs_encoder *encoder)
+{
+	return (encoder->timebase_num * 1000000LL / encoder->timebase_den) * encoder->framesize;
+}
+
+/* returns -1 if packets are missing, 1 if everything up to and including
+ * *last should be pruned, 0 otherwise */
+static int prune_premature_packets(struct obs_packet_bus *bus, struct encoder_packet *last)
+{
+	struct packet_interleaver *il = &bus->interleaver;
+	struct encoder_packet *video;
+	struct encoder_packet *max_packet;
+	int64_t duration_usec, max_audio_duration_usec = 0;
+	int64_t max_diff = 0;
+	int64_t diff = 0;
+	int audio_encoders = 0;
+
+	video = interleaver_first(il, OBS_ENCODER_VIDEO, 0);
+	if (!video)
+		return -1;
+
+	max_packet = video;
+	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		struct encoder_packet *audio;
+		int64_t audio_duration_usec = 0;
+
+		if (!bus->audio_encoders[i])
+			continue;
+		audio_encoders++;
+
+		audio = interleaver_first(il, OBS_ENCODER_AUDIO, i);
+		if (!audio) {
+			bus->received_audio = false;
+			return -1;
+		}
+
+		if (interleaver_compare(audio, max_packet) > 0)
+			max_packet = audio;
+
+		diff = audio->dts_usec - video->dts_usec;
+		if (diff > max_diff)
+			max_diff = diff;
+
+		audio_duration_usec = get_encoder_duration(bus->audio_encoders[i]);
+		if (audio_duration_usec > max_audio_duration_usec)
+			max_audio_duration_usec = audio_duration_usec;
+	}
+
+	/* Once multiple audio encoders are running they are almost always out
+	 * of phase by ~Xms. If users change their video to > 100fps then it
+	 * becomes probable that this phase difference will be larger than the
+	 * video duration preventing us from ever finding a synchronization
+	 * point due to their larger frame duration. Instead give up on a tight
+	 * video sync. */
+	if (audio_encoders > 1 && duration_usec < max_audio_duration_usec) {
+		duration_usec = max_audio_duration_usec;
+	}
+
+	if (diff > duration_usec) {
+		*last = *max_packet;
+		return 1;
+	}
+
+	return 0;
+}
+
+#define DEBUG_STARTING_PACKETS 0
+
+static void discard_next_packet(struct obs_packet_bus *bus)
+{
+	struct encoder_packet packet;
+
+	if (!interleaver_pop(&bus->interleaver, &packet))
+		return;
+
+#if DEBUG_STARTING_PACKETS == 1
+	blog(LOG_DEBUG, "discarding %s packet, dts: %lld, pts: %lld",
+	     packet.type == OBS_ENCODER_VIDEO ? "video" : "audio", packet.dts, packet.pts);
+#endif
+	if (packet.type == OBS_ENCODER_VIDEO) {
+		da_pop_front(bus->encoder_packet_times[packet.track_idx]);
+	}
+	obs_encoder_packet_release(&packet);
+}
+
+/* discards the interleaved packets before end (and end itself if inclusive) */
+static void discard_packets(struct obs_packet_bus *bus, const struct encoder_packet *end, bool inclusive)
+{
+	struct encoder_packet *next;
+
+	while ((next = interleaver_peek(&bus->interleaver)) != NULL) {
+		int cmp = interleaver_compare(next, end);
+		if (cmp > 0 || (cmp == 0 && !inclusive))
+			break;
+
+		discard_next_packet(bus);
+	}
+}
+
+static bool prune_interleaved_packets(struct obs_packet_bus *bus)
+{
+	struct encoder_packet end;
+	int prune = prune_premature_packets(bus, &end);
+
+#if DEBUG_STARTING_PACKETS == 1
+	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune);
+	for (size_t i = 0; i < INTERLEAVER_MAX_QUEUES; i++) {
+		struct interleave_queue *queue = &bus->interleaver.queues[i];
+
+		for (size_t j = queue->start; j < queue->packets.num; j++) {
+			struct encoder_packet *packet = &queue->packets.array[j];
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
+			     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video", (int)packet->track_idx,
+			     packet->dts_usec,
+			     prune == 1 && interleaver_compare(packet, &end) <= 0 ? "true" : "false");
+		}
+	}
+#endif
+
+	/* prunes the first video packet if it's too far away from audio */
+	if (prune == -1)
+		return false;
+
+	if (prune == 1) {
+		discard_packets(bus, &end, true);
+	} else {
+		/* the start packet may move while discarding */
+		end = *get_interleaved_start(bus);
+		discard_packets(bus, &end, false);
+	}
+
+	return true;
+}
+
+static bool get_audio_and_video_packets(struct obs_packet_bus *bus, struct encoder_packet **video,
+					struct encoder_packet **audio)
+{
+	bool found_video = false;
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (bus->video_encoders[i]) {
+			video[i] = interleaver_first(&bus->interleaver, OBS_ENCODER_VIDEO, i);
+			if (!video[i]) {
+				bus->received_video[i] = false;
+				return false;
+			} else {
+				found_video = true;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (bus->audio_encoders[i]) {
+			audio[i] = interleaver_first(&bus->interleaver, OBS_ENCODER_AUDIO, i);
+			if (!audio[i]) {
+				bus->received_audio = false;
+				return false;
+			}
+		}
+	}
+
+	return found_video;
+}
+
+static bool initialize_interleaved_packets(struct obs_packet_bus *bus)
+{
+	struct encoder_packet *video[MAX_OUTPUT_VIDEO_ENCODERS] = {0};
+	struct encoder_packet *audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
+	struct encoder_packet *last_audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
+	struct encoder_packet start;
+	size_t first_audio_idx = bus->first_audio_idx;
+	size_t first_video_idx = bus->first_video_idx;
+
+	if (!get_audio_and_video_packets(bus, video, audio))
+		return false;
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (bus->audio_encoders[i]) {
+			last_audio[i] = interleaver_last(&bus->interleaver, OBS_ENCODER_AUDIO, i);
+		}
+	}
+
+	/* ensure that there is audio past the first video packet */
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (bus->audio_encoders[i]) {
+			if (last_audio[i]->dts_usec < video[first_video_idx]->dts_usec) {
+				bus->received_audio = false;
+				return false;
+			}
+		}
+	}
+
+	/* clear out excess starting audio if it hasn't been already */
+	start = *get_interleaved_start(bus);
+	if (interleaver_compare(interleaver_peek(&bus->interleaver), &start) < 0) {
+		discard_packets(bus, &start, false);
+		if (!get_audio_and_video_packets(bus, video, audio))
+			return false;
+	}
+
+	/* get new offsets */
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (bus->video_encoders[i]) {
+			bus->video_offsets[i] = video[i]->pts;
+		}
+	}
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (bus->audio_encoders[i] && audio[i]->dts > 0) {
+			bus->audio_offsets[i] = audio[i]->dts;
+		}
+	}
+#if DEBUG_STARTING_PACKETS == 1
+	int64_t v = video[first_video_idx]->dts_usec;
+	int64_t a = audio[first_audio_idx]->dts_usec;
+	int64_t diff = v - a;
+	struct dstr names = {0};
+
+	get_bus_names(bus, NULL, &names);
+	blog(LOG_DEBUG,
+	     "output '%s' offset for video: %lld, audio: %lld, "
+	     "diff: %lldms",
+	     names.array, v, a, diff / 1000LL);
+	dstr_free(&names);
+#endif
+
+	/* subtract offsets from highest TS offset variables */
+	bus->highest_audio_ts -= audio[first_audio_idx]->dts_usec;
+
+	/* apply new offsets to all existing packet DTS/PTS values */
+	for (size_t i = 0; i < INTERLEAVER_MAX_QUEUES; i++) {
+		struct interleave_queue *queue = &bus->interleaver.queues[i];
+
+		for (size_t j = queue->start; j < queue->packets.num; j++)
+			apply_interleaved_packet_offset(bus, &queue->packets.array[j], NULL);
+	}
+
+	return true;
+}
+
+static void resort_interleaved_packets(struct obs_packet_bus *bus)
+{
+	for (size_t i = 0; i < INTERLEAVER_MAX_QUEUES; i++) {
+		struct interleave_queue *queue = &bus->interleaver.queues[i];
+
+		for (size_t j = queue->start; j < queue->packets.num; j++)
+			set_higher_ts(bus, &queue->packets.array[j]);
+	}
+
+	interleaver_resort(&bus->interleaver);
+}
+
+static void discard_unused_audio_packets(struct obs_packet_bus *bus, int64_t dts_usec)
+{
+	struct encoder_packet *next;
+
+	while ((next = interleaver_peek(&bus->interleaver)) != NULL && next->dts_usec < dts_usec)
+		discard_next_packet(bus);
+}
+
+static bool purge_encoder_group_keyframe_data(struct obs_packet_bus *bus, size_t idx)
+{
+	struct keyframe_group_data *data = &bus->keyframe_group_tracking.array[idx];
+	uint32_t modified_count = 0;
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (data->seen_on_track[i] != KEYFRAME_TRACK_STATUS_NOT_SEEN)
+			modified_count += 1;
+	}
+
+	if (modified_count == data->required_tracks) {
+		da_erase(bus->keyframe_group_tracking, idx);
+		return true;
+	}
+	return false;
+}
+
+/* Check whether keyframes are emitted from all grouped encoders, and log
+ * if keyframes haven't been emitted from all grouped encoders. */
+static void check_encoder_group_keyframe_alignment(struct obs_packet_bus *bus, struct encoder_packet *packet)
+{
+	size_t idx = 0;
+	struct keyframe_group_data insert_data = {0};
+
+	if (!packet->keyframe || packet->type != OBS_ENCODER_VIDEO || !packet->encoder->encoder_group)
+		return;
+
+	for (; idx < bus->keyframe_group_tracking.num;) {
+		struct keyframe_group_data *data = &bus->keyframe_group_tracking.array[idx];
+		if (data->pts > packet->pts)
+			break;
+		if (data->group_id != (uintptr_t)packet->encoder->encoder_group) {
+			idx += 1;
+			continue;
+		}
+
+		if (data->pts < packet->pts) {
+			if (data->seen_on_track[packet->track_idx] == KEYFRAME_TRACK_STATUS_NOT_SEEN) {
+				struct dstr names = {0};
+
+				get_bus_names(bus, NULL, &names);
+				blog(LOG_WARNING,
+				     "obs-output '%s': Missing keyframe with pts %" PRIi64
+				     " for encoder '%s' (track: %zu)",
+				     names.array, data->pts, obs_encoder_get_name(packet->encoder),
+				     packet->track_idx);
+				dstr_free(&names);
+			}
+
+			data->seen_on_track[packet->track_idx] = KEYFRAME_TRACK_STATUS_SKIPPED;
+
+			if (!purge_encoder_group_keyframe_data(bus, idx))
+				idx += 1;
+			continue;
+		}
+
+		data->seen_on_track[packet->track_idx] = KEYFRAME_TRACK_STATUS_SEEN;
+		purge_encoder_group_keyframe_data(bus, idx);
+		return;
+	}
+
+	insert_data.group_id = (uintptr_t)packet->encoder->encoder_group;
+	insert_data.pts = packet->pts;
+	insert_data.seen_on_track[packet->track_idx] = KEYFRAME_TRACK_STATUS_SEEN;
+
+	pthread_mutex_lock(&packet->encoder->encoder_group->mutex);
+	insert_data.required_tracks = packet->encoder->encoder_group->num_encoders_started;
+	pthread_mutex_unlock(&packet->encoder->encoder_group->mutex);
+
+	da_insert(bus->keyframe_group_tracking, idx, &insert_data);
+}
+
+static void apply_ept_offsets(struct obs_packet_bus *bus)
+{
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		for (size_t j = 0; j < bus->encoder_packet_times[i].num; j++) {
+			bus->encoder_packet_times[i].array[j].pts -= bus->video_offsets[i];
+		}
+	}
+}
+
+static inline size_t count_streamable_frames(struct obs_packet_bus *bus, size_t max)
+{
+	/* Only count an interleaved packet as streamable if there are packets of the opposing type and of a
+	 * higher timestamp in the interleave buffer. This ensures that the timestamps are monotonic. */
+	return interleaver_count_while(&bus->interleaver, has_higher_opposing_ts, bus, max);
+}
+
+static inline bool received_all_video(struct obs_packet_bus *bus)
+{
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (bus->video_encoders[i] && !bus->received_video[i])
+			return false;
+	}
+
+	return true;
+}
+
+/* takes ownership of the packet if owned is set, otherwise a reference */
+static void bus_push_packet(struct obs_packet_bus *bus, struct encoder_packet *packet,
+			    struct encoder_packet_time *packet_time, bool owned)
+{
+	struct encoder_packet out;
+	bool was_started;
+	struct encoder_packet_time *output_packet_time = NULL;
+
+	packet->track_idx = get_encoder_index(bus, packet);
+
+	/* if first video frame is not a keyframe, discard until received */
+	if (packet->type == OBS_ENCODER_VIDEO && !bus->received_video[packet->track_idx] && !packet->keyframe) {
+		discard_unused_audio_packets(bus, packet->dts_usec);
+
+		if (owned)
+			obs_encoder_packet_release(packet);
+		return;
+	}
+
+	check_encoder_group_keyframe_alignment(bus, packet);
+
+	was_started = bus->received_audio && received_all_video(bus);
+
+	if (owned)
+		out = *packet;
+	else
+		obs_encoder_packet_ref(&out, packet);
+
+	if (packet_time) {
+		output_packet_time = da_push_back_new(bus->encoder_packet_times[packet->track_idx]);
+		*output_packet_time = *packet_time;
+	}
+
+	if (was_started)
+		apply_interleaved_packet_offset(bus, &out, output_packet_time);
+	else
+		check_received(bus, packet);
+
+	interleaver_push(&bus->interleaver, &out);
+
+	/* when both video and audio have been received, we're ready
+	 * to start sending out packets (one at a time) */
+	if (bus->received_audio && received_all_video(bus)) {
+		if (!was_started) {
+			if (prune_interleaved_packets(bus)) {
+				if (initialize_interleaved_packets(bus)) {
+					resort_interleaved_packets(bus);
+					apply_ept_offsets(bus);
+					send_interleaved(bus);
+				}
+			}
+		} else {
+			set_higher_ts(bus, &out);
+
+			/* no need to count further than one past the batch size */
+			size_t streamable = count_streamable_frames(bus, bus->max_batch_size + 2);
+			if (streamable) {
+				send_interleaved(bus);
+
+				/* If we have more eligible packets queued than we normally should have,
+				 * send one additional packet until we're back below the limit. */
+				if (--streamable > bus->max_batch_size)
+					send_interleaved(bus);
+			}
+		}
+	}
+}
+
+void packet_bus_push(struct obs_packet_bus *bus, struct encoder_packet *packet,
+		     struct encoder_packet_time *packet_time, bool owned)
+{
+	pthread_mutex_lock(&bus->mutex);
+	bus_push_packet(bus, packet, packet_time, owned);
+	pthread_mutex_unlock(&bus->mutex);
+}
+
+/* encoder callback of shared buses */
+static void bus_encoded_packet(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time)
+{
+	packet_bus_push(data, packet, packet_time, false);
+}
+
+/* ------------------------------------------------------------------------- */
+/* creation and sharing */
+
+static void calculate_batch_size(struct obs_packet_bus *bus, const char *name)
+{
+	struct obs_video_info ovi;
+	obs_get_video_info(&ovi);
+	DARRAY(uint64_t) intervals;
+	da_init(intervals);
+
+	uint64_t largest_interval = 0;
+
+	/* Step 1: Calculate the largest interval between packets of any encoder. */
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (!bus->video_encoders[i])
+			continue;
+
+		uint32_t den = ovi.fps_den * obs_encoder_get_frame_rate_divisor(bus->video_encoders[i]);
+		uint64_t encoder_interval = util_mul_div64(1000000000ULL, den, ovi.fps_num);
+		da_push_back(intervals, &encoder_interval);
+
+		largest_interval = encoder_interval > largest_interval ? encoder_interval : largest_interval;
+	}
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (!bus->audio_encoders[i])
+			continue;
+
+		uint32_t sample_rate = obs_encoder_get_sample_rate(bus->audio_encoders[i]);
+		size_t frame_size = obs_encoder_get_frame_size(bus->audio_encoders[i]);
+		uint64_t encoder_interval = util_mul_div64(1000000000ULL, frame_size, sample_rate);
+		da_push_back(intervals, &encoder_interval);
+
+		largest_interval = encoder_interval > largest_interval ? encoder_interval : largest_interval;
+	}
+
+	/* Step 2: Calculate how many packets would fit into double that interval given each encoder's packet rate.
+	 * The doubling is done to provide some amount of wiggle room as the largest interval may not be evenly
+	 * divisible by all smaller ones. For example, 33.3... ms video (30 FPS) and 21.3... ms audio (48 kHz AAC). */
+	for (size_t i = 0; i < intervals.num; i++) {
+		uint64_t num = (largest_interval * 2) / intervals.array[i];
+		bus->max_batch_size += num;
+	}
+
+	blog(LOG_DEBUG, "Maximum interleaver batch size for '%s' calculated to be %zu packets", name,
+	     bus->max_batch_size);
+
+	da_free(intervals);
+}
+
+static void bus_reset(struct obs_packet_bus *bus)
+{
+	bus->received_audio = false;
+	bus->highest_audio_ts = 0;
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		bus->encoder_packet_times[i].num = 0;
+	}
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		bus->received_video[i] = false;
+		bus->video_offsets[i] = 0;
+		bus->highest_video_ts[i] = INT64_MIN;
+	}
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++)
+		bus->audio_offsets[i] = 0;
+
+	interleaver_free(&bus->interleaver);
+	da_clear(bus->keyframe_group_tracking);
+}
+
+static struct obs_packet_bus *bus_create(struct obs_output *output, bool shared)
+{
+	struct obs_packet_bus *bus = bzalloc(sizeof(struct obs_packet_bus));
+
+	pthread_mutex_init(&bus->mutex, NULL);
+	bus->shared = shared;
+	bus->refs = 1;
+
+	memcpy(bus->video_encoders, output->video_encoders, sizeof(bus->video_encoders));
+	memcpy(bus->audio_encoders, output->audio_encoders, sizeof(bus->audio_encoders));
+
+	for (size_t i = MAX_OUTPUT_VIDEO_ENCODERS; i > 0; i--) {
+		if (bus->video_encoders[i - 1])
+			bus->first_video_idx = i - 1;
+	}
+	for (size_t i = MAX_OUTPUT_AUDIO_ENCODERS; i > 0; i--) {
+		if (bus->audio_encoders[i - 1])
+			bus->first_audio_idx = i - 1;
+	}
+
+	bus_reset(bus);
+	calculate_batch_size(bus, obs_output_get_name(output));
+	return bus;
+}
+
+static void bus_destroy(struct obs_packet_bus *bus)
+{
+	interleaver_free(&bus->interleaver);
+	da_free(bus->keyframe_group_tracking);
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+		da_free(bus->encoder_packet_times[i]);
+	da_free(bus->subscribers);
+	pthread_mutex_destroy(&bus->mutex);
+	bfree(bus);
+}
+
+static inline bool same_encoders(const struct obs_packet_bus *bus, const struct obs_output *output)
+{
+	return memcmp(bus->video_encoders, output->video_encoders, sizeof(bus->video_encoders)) == 0 &&
+	       memcmp(bus->audio_encoders, output->audio_encoders, sizeof(bus->audio_encoders)) == 0;
+}
+
+static void add_subscriber(struct obs_packet_bus *bus, struct obs_output *output)
+{
+	struct packet_bus_subscriber *sub;
+	bool started;
+
+	pthread_mutex_lock(&bus->mutex);
+
+	/* before the bus has started sending, new outputs start with it */
+	started = bus->received_audio && received_all_video(bus);
+
+	sub = da_push_back_new(bus->subscribers);
+	sub->output = output;
+	sub->joined = !started;
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+		sub->video_started[i] = !started;
+
+	pthread_mutex_unlock(&bus->mutex);
+}
+
+void packet_bus_add_output(struct obs_output *output, bool shared)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_packet_bus *bus = NULL;
+
+	if (shared) {
+		pthread_mutex_lock(&data->packet_buses_mutex);
+
+		for (size_t i = 0; i < data->packet_buses.num; i++) {
+			if (same_encoders(data->packet_buses.array[i], output)) {
+				bus = data->packet_buses.array[i];
+				bus->refs++;
+				break;
+			}
+		}
+
+		if (!bus) {
+			bus = bus_create(output, true);
+			da_push_back(data->packet_buses, &bus);
+		}
+
+		add_subscriber(bus, output);
+
+		/* a shared bus starts the encoders once, the outputs of a
+		 * private bus start the encoders themselves */
+		if (bus->refs == 1) {
+			for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+				if (bus->audio_encoders[i])
+					obs_encoder_start(bus->audio_encoders[i], bus_encoded_packet, bus);
+			}
+			for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+				if (bus->video_encoders[i])
+					obs_encoder_start(bus->video_encoders[i], bus_encoded_packet, bus);
+			}
+		}
+
+		pthread_mutex_unlock(&data->packet_buses_mutex);
+
+	} else {
+		bus = bus_create(output, false);
+		add_subscriber(bus, output);
+	}
+
+	output->bus = bus;
+}
+
+void packet_bus_remove_output(struct obs_output *output)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_packet_bus *bus = output->bus;
+	bool last = true;
+
+	if (!bus)
+		return;
+
+	if (bus->shared)
+		pthread_mutex_lock(&data->packet_buses_mutex);
+
+	pthread_mutex_lock(&bus->mutex);
+	for (size_t i = 0; i < bus->subscribers.num; i++) {
+		if (bus->subscribers.array[i].output == output) {
+			da_erase(bus->subscribers, i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&bus->mutex);
+
+	if (bus->shared) {
+		last = --bus->refs == 0;
+		if (last)
+			da_erase_item(data->packet_buses, &bus);
+		pthread_mutex_unlock(&data->packet_buses_mutex);
+	}
+
+	output->bus = NULL;
+
+	if (!last)
+		return;
+
+	/* the encoder callbacks hold the encoder's callback mutex while they
+	 * lock the bus, so the encoders are stopped without any bus lock */
+	if (bus->shared) {
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+			if (bus->video_encoders[i])
+				obs_encoder_stop(bus->video_encoders[i], bus_encoded_packet, bus);
+		}
+		for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+			if (bus->audio_encoders[i])
+				obs_encoder_stop(bus->audio_encoders[i], bus_encoded_packet, bus);
+		}
+	}
+
+	bus_destroy(bus);
+}
+
+void packet_bus_reset(struct obs_packet_bus *bus)
+{
+	if (!bus)
+		return;
+
+	pthread_mutex_lock(&bus->mutex);
+	bus_reset(bus);
+	pthread_mutex_unlock(&bus->mutex);
+}
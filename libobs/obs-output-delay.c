@@ -15,8 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
-#include <inttypes.h>
 #include "obs-internal.h"
+#include "obs-output-spill.h"
 
 static inline bool delay_active(const struct obs_output *output)
 {
@@ -43,19 +43,130 @@ static inline bool log_flag_encoded(const struct obs_output *output, const char
 	return ret;
 }
 
+static inline bool spill_enabled(const struct obs_output *output)
+{
+	return output->delay_memory_limit && !dstr_is_empty(&output->delay_spill_dir);
+}
+
+static inline void add_resident(struct obs_output *output, size_t size)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+
+	stats->resident_bytes += size;
+	stats->resident_packets++;
+	if (stats->resident_bytes > stats->peak_resident_bytes)
+		stats->peak_resident_bytes = stats->resident_bytes;
+}
+
+static inline void add_spilled(struct obs_output *output, size_t size)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+
+	stats->spilled_bytes += size;
+	stats->total_spilled_bytes += size;
+	stats->spilled_packets++;
+	if (stats->spilled_bytes > stats->peak_spilled_bytes)
+		stats->peak_spilled_bytes = stats->spilled_bytes;
+}
+
+static inline struct delay_data *delay_entry(struct obs_output *output, size_t idx)
+{
+	return deque_data(&output->delay_data, idx * sizeof(struct delay_data));
+}
+
+/* takes back the oldest spilled packet, the spill store has them in queue
+ * order, returns false if it isn't read back yet */
+static bool reload_first_spilled(struct obs_output *output)
+{
+	size_t count = output->delay_data.size / sizeof(struct delay_data);
+	struct delay_data *dd = delay_entry(output, output->delay_spill_first);
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+
+	switch (delay_spill_pop(output->delay_spill, &dd->packet)) {
+	case DELAY_SPILL_WAIT:
+		return false;
+	case DELAY_SPILL_READY:
+		add_resident(output, dd->packet.size);
+		break;
+	case DELAY_SPILL_ERROR:
+		/* stops the output once it's due instead of sending it */
+		dd->msg = DELAY_MSG_SPILL_ERROR;
+		break;
+	}
+
+	dd->spilled = false;
+	stats->spilled_bytes -= dd->packet.size;
+	stats->spilled_packets--;
+
+	if (stats->spilled_packets) {
+		while (++output->delay_spill_first < count) {
+			dd = delay_entry(output, output->delay_spill_first);
+			if (dd->spilled)
+				break;
+		}
+	}
+
+	return true;
+}
+
+static void reload_spilled(struct obs_output *output)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+
+	while (stats->spilled_packets) {
+		struct delay_data *dd = delay_entry(output, output->delay_spill_first);
+		if (stats->resident_bytes + dd->packet.size > output->delay_memory_limit)
+			break;
+		if (!reload_first_spilled(output))
+			break;
+	}
+}
+
 static inline void push_packet(struct obs_output *output, struct encoder_packet *packet,
 			       struct encoder_packet_time *packet_time, uint64_t t)
 {
+	struct obs_output_delay_stats *stats = &output->delay_stats;
 	struct delay_data dd;
+	bool spill;
 
 	dd.msg = DELAY_MSG_PACKET;
 	dd.ts = t;
 	dd.packet_time_valid = packet_time != NULL;
 	if (packet_time != NULL)
 		dd.packet_time = *packet_time;
-	obs_encoder_packet_create_instance(&dd.packet, packet);
+	dd.spilled = false;
+	obs_encoder_packet_ref(&dd.packet, packet);
 
 	pthread_mutex_lock(&output->delay_mutex);
+
+	/* once something is spilled, newer packets have to follow it to keep
+	 * the order of the spill store */
+	spill = spill_enabled(output) &&
+		(stats->spilled_packets || stats->resident_bytes + packet->size > output->delay_memory_limit);
+
+	if (spill && !output->delay_spill && !output->delay_spill_failed)
+		output->delay_spill = delay_spill_create(output->delay_spill_dir.array, output->context.name);
+
+	if (spill && output->delay_spill && delay_spill_push(output->delay_spill, &dd.packet)) {
+		if (!stats->spilled_packets)
+			output->delay_spill_first = output->delay_data.size / sizeof(dd);
+
+		add_spilled(output, dd.packet.size);
+		obs_encoder_packet_release(&dd.packet);
+		dd.packet.data = NULL;
+		dd.spilled = true;
+
+	} else {
+		/* either writing failed or the disk can't keep up */
+		if (spill && !output->delay_spill_failed) {
+			blog(LOG_WARNING, "Output '%s': Failed to spill delayed packets to '%s', keeping them in memory",
+			     output->context.name, output->delay_spill_dir.array);
+			output->delay_spill_failed = true;
+		}
+
+		add_resident(output, dd.packet.size);
+	}
+
 	deque_push_back(&output->delay_data, &dd, sizeof(dd));
 	pthread_mutex_unlock(&output->delay_mutex);
 }
@@ -75,6 +186,10 @@ static inline void process_delay_data(struct obs_output *output, struct delay_da
 	case DELAY_MSG_STOP:
 		obs_output_actual_stop(output, false, dd->ts);
 		break;
+	case DELAY_MSG_SPILL_ERROR:
+		if (delay_active(output) && delay_capturing(output))
+			obs_output_signal_stop(output, OBS_OUTPUT_ERROR);
+		break;
 	}
 }
 
@@ -84,11 +199,20 @@ void obs_output_cleanup_delay(obs_output_t *output)
 
 	while (output->delay_data.size) {
 		deque_pop_front(&output->delay_data, &dd, sizeof(dd));
-		if (dd.msg == DELAY_MSG_PACKET) {
+		if (dd.msg == DELAY_MSG_PACKET && !dd.spilled) {
 			obs_encoder_packet_release(&dd.packet);
 		}
 	}
 
+	delay_spill_destroy(output->delay_spill);
+	output->delay_spill = NULL;
+	output->delay_spill_first = 0;
+	output->delay_spill_failed = false;
+	output->delay_stats.resident_bytes = 0;
+	output->delay_stats.resident_packets = 0;
+	output->delay_stats.spilled_bytes = 0;
+	output->delay_stats.spilled_packets = 0;
+
 	output->active_delay_ns = 0;
 	os_atomic_set_long(&output->delay_restart_refs, 0);
 }
@@ -114,11 +238,31 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 			output->active_delay_ns = elapsed_time;
 
 		} else if (elapsed_time > output->active_delay_ns) {
+			/* the limit may be smaller than a single packet, and if
+			 * the spill thread hasn't read it back yet, it's sent
+			 * with a later packet */
+			if (dd.spilled) {
+				if (!reload_first_spilled(output))
+					goto unlock;
+				deque_peek_front(&output->delay_data, &dd, sizeof(dd));
+			}
+
 			deque_pop_front(&output->delay_data, NULL, sizeof(dd));
 			popped = true;
+
+			if (dd.msg == DELAY_MSG_PACKET) {
+				output->delay_stats.resident_bytes -= dd.packet.size;
+				output->delay_stats.resident_packets--;
+			}
+
+			if (output->delay_stats.spilled_packets) {
+				output->delay_spill_first--;
+				reload_spilled(output);
+			}
 		}
 	}
 
+unlock:
 	pthread_mutex_unlock(&output->delay_mutex);
 
 	/* ------------------------------------------------ */
@@ -207,3 +351,26 @@ uint32_t obs_output_get_active_delay(const obs_output_t *output)
 	return obs_output_valid(output, "obs_output_set_delay") ? (uint32_t)(output->active_delay_ns / 1000000000ULL)
 								: 0;
 }
+
+void obs_output_set_delay_memory_limit(obs_output_t *output, uint64_t limit_bytes, const char *spill_dir)
+{
+	if (!obs_output_valid(output, "obs_output_set_delay_memory_limit"))
+		return;
+	if (!log_flag_encoded(output, __FUNCTION__, false))
+		return;
+
+	pthread_mutex_lock(&output->delay_mutex);
+	output->delay_memory_limit = limit_bytes;
+	dstr_copy(&output->delay_spill_dir, spill_dir);
+	pthread_mutex_unlock(&output->delay_mutex);
+}
+
+void obs_output_get_delay_stats(obs_output_t *output, struct obs_output_delay_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_delay_stats"))
+		return;
+
+	pthread_mutex_lock(&output->delay_mutex);
+	*stats = output->delay_stats;
+	pthread_mutex_unlock(&output->delay_mutex);
+}
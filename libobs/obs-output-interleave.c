@@ -0,0 +1,239 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs.h"
+#include "obs-output-interleave.h"
+
+/* sent packets are only erased from the front of a queue in batches */
+#define MIN_COMPACT_SIZE 32
+
+int interleaver_compare(const struct encoder_packet *a, const struct encoder_packet *b)
+{
+	if (a->dts_usec != b->dts_usec)
+		return a->dts_usec < b->dts_usec ? -1 : 1;
+
+	/* video before audio with the same timestamp */
+	if (a->type != b->type)
+		return a->type == OBS_ENCODER_VIDEO ? -1 : 1;
+
+	/* sort packets with the same timestamp by track index, to prevent
+	 * the pruning logic from removing additional video tracks */
+	if (a->track_idx != b->track_idx)
+		return a->track_idx < b->track_idx ? -1 : 1;
+
+	return 0;
+}
+
+static inline size_t queue_index(enum obs_encoder_type type, size_t track_idx)
+{
+	return type == OBS_ENCODER_VIDEO ? track_idx : MAX_OUTPUT_VIDEO_ENCODERS + track_idx;
+}
+
+static inline size_t queue_size(const struct interleave_queue *queue)
+{
+	return queue->packets.num - queue->start;
+}
+
+static inline struct encoder_packet *cursor_packet(struct packet_interleaver *il,
+						   const struct interleave_cursor *cursor)
+{
+	struct interleave_queue *queue = &il->queues[cursor->queue];
+	return &queue->packets.array[queue->start + cursor->pos];
+}
+
+static inline bool cursor_less(struct packet_interleaver *il, const struct interleave_cursor *a,
+			       const struct interleave_cursor *b)
+{
+	return interleaver_compare(cursor_packet(il, a), cursor_packet(il, b)) < 0;
+}
+
+static void heap_sift_up(struct packet_interleaver *il, struct interleave_cursor *heap, size_t idx)
+{
+	struct interleave_cursor cursor = heap[idx];
+
+	while (idx) {
+		size_t parent = (idx - 1) / 2;
+
+		if (!cursor_less(il, &cursor, &heap[parent]))
+			break;
+
+		heap[idx] = heap[parent];
+		idx = parent;
+	}
+
+	heap[idx] = cursor;
+}
+
+static void heap_sift_down(struct packet_interleaver *il, struct interleave_cursor *heap, size_t size, size_t idx)
+{
+	struct interleave_cursor cursor = heap[idx];
+
+	for (;;) {
+		size_t child = idx * 2 + 1;
+
+		if (child >= size)
+			break;
+		if (child + 1 < size && cursor_less(il, &heap[child + 1], &heap[child]))
+			child++;
+		if (!cursor_less(il, &heap[child], &cursor))
+			break;
+
+		heap[idx] = heap[child];
+		idx = child;
+	}
+
+	heap[idx] = cursor;
+}
+
+/* moves the cursor at the top of the heap to the next packet of its queue */
+static void heap_advance_top(struct packet_interleaver *il, struct interleave_cursor *heap, size_t *size)
+{
+	struct interleave_cursor *top = &heap[0];
+
+	if (++top->pos >= queue_size(&il->queues[top->queue])) {
+		if (--*size == 0)
+			return;
+		heap[0] = heap[*size];
+	}
+
+	heap_sift_down(il, heap, *size, 0);
+}
+
+static size_t heap_find(struct packet_interleaver *il, size_t queue)
+{
+	for (size_t i = 0; i < il->heap_size; i++) {
+		if (il->heap[i].queue == queue)
+			return i;
+	}
+
+	return DARRAY_INVALID;
+}
+
+void interleaver_free(struct packet_interleaver *il)
+{
+	for (size_t i = 0; i < INTERLEAVER_MAX_QUEUES; i++) {
+		struct interleave_queue *queue = &il->queues[i];
+
+		for (size_t j = queue->start; j < queue->packets.num; j++)
+			obs_encoder_packet_release(&queue->packets.array[j]);
+
+		da_free(queue->packets);
+		queue->start = 0;
+	}
+
+	il->heap_size = 0;
+	il->num = 0;
+}
+
+void interleaver_push(struct packet_interleaver *il, const struct encoder_packet *packet)
+{
+	size_t idx = queue_index(packet->type, packet->track_idx);
+	struct interleave_queue *queue = &il->queues[idx];
+	size_t pos = queue->packets.num;
+
+	/* packets of an encoder should already be in DTS order, but don't rely
+	 * on it */
+	while (pos > queue->start && interleaver_compare(packet, &queue->packets.array[pos - 1]) < 0)
+		pos--;
+
+	da_insert(queue->packets, pos, packet);
+	il->num++;
+
+	if (queue_size(queue) == 1) {
+		struct interleave_cursor cursor = {idx, 0};
+
+		il->heap[il->heap_size] = cursor;
+		heap_sift_up(il, il->heap, il->heap_size++);
+
+	} else if (pos == queue->start) {
+		heap_sift_up(il, il->heap, heap_find(il, idx));
+	}
+}
+
+struct encoder_packet *interleaver_peek(struct packet_interleaver *il)
+{
+	return il->heap_size ? cursor_packet(il, &il->heap[0]) : NULL;
+}
+
+bool interleaver_pop(struct packet_interleaver *il, struct encoder_packet *packet)
+{
+	struct interleave_queue *queue;
+
+	if (!il->heap_size)
+		return false;
+
+	queue = &il->queues[il->heap[0].queue];
+
+	*packet = queue->packets.array[queue->start++];
+	il->num--;
+
+	if (queue->start == queue->packets.num) {
+		da_resize(queue->packets, 0);
+		queue->start = 0;
+
+	} else if (queue->start >= MIN_COMPACT_SIZE && queue->start * 2 >= queue->packets.num) {
+		da_erase_range(queue->packets, 0, queue->start);
+		queue->start = 0;
+	}
+
+	/* the queue's new first packet is at pos 0 again */
+	if (!queue_size(queue)) {
+		if (--il->heap_size == 0)
+			return true;
+		il->heap[0] = il->heap[il->heap_size];
+	}
+
+	heap_sift_down(il, il->heap, il->heap_size, 0);
+	return true;
+}
+
+void interleaver_resort(struct packet_interleaver *il)
+{
+	for (size_t i = il->heap_size / 2; i > 0; i--)
+		heap_sift_down(il, il->heap, il->heap_size, i - 1);
+}
+
+size_t interleaver_count_while(struct packet_interleaver *il, interleaver_packet_cb cb, void *param, size_t max)
+{
+	struct interleave_cursor heap[INTERLEAVER_MAX_QUEUES];
+	size_t size = il->heap_size;
+	size_t count = 0;
+
+	memcpy(heap, il->heap, sizeof(heap[0]) * size);
+
+	while (size && count < max) {
+		if (!cb(param, cursor_packet(il, &heap[0])))
+			break;
+
+		count++;
+		heap_advance_top(il, heap, &size);
+	}
+
+	return count;
+}
+
+size_t interleaver_track_size(struct packet_interleaver *il, enum obs_encoder_type type, size_t track_idx)
+{
+	return queue_size(&il->queues[queue_index(type, track_idx)]);
+}
+
+struct encoder_packet *interleaver_track_packet(struct packet_interleaver *il, enum obs_encoder_type type,
+						size_t track_idx, size_t idx)
+{
+	struct interleave_cursor cursor = {queue_index(type, track_idx), idx};
+	return cursor_packet(il, &cursor);
+}
@@ -0,0 +1,121 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Internal: the packet interleaver used by outputs.
+ *
+ * Encoders produce packets in DTS order, so every encoder track gets its own
+ * FIFO queue, and the queues are merged with a min-heap on their first
+ * packets.  Queueing and sending a packet are O(log tracks) instead of a
+ * linear insertion into one sorted array.
+ *
+ * Interleaved order is by DTS, then video before audio, then by track index
+ * (see interleaver_compare).
+ *
+ * The functions are exported for the unit tests only, they are not part of
+ * the public API.
+ */
+
+#include "util/darray.h"
+#include "obs-encoder.h"
+#include "obs-output.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INTERLEAVER_MAX_QUEUES (MAX_OUTPUT_VIDEO_ENCODERS + MAX_OUTPUT_AUDIO_ENCODERS)
+
+struct interleave_queue {
+	DARRAY(struct encoder_packet) packets;
+	/* index of the first queued packet in packets */
+	size_t start;
+};
+
+struct interleave_cursor {
+	size_t queue;
+	size_t pos;
+};
+
+struct packet_interleaver {
+	struct interleave_queue queues[INTERLEAVER_MAX_QUEUES];
+
+	/* min-heap of the non-empty queues (with pos always 0) */
+	struct interleave_cursor heap[INTERLEAVER_MAX_QUEUES];
+	size_t heap_size;
+
+	size_t num;
+};
+
+typedef bool (*interleaver_packet_cb)(void *param, struct encoder_packet *packet);
+
+/** Returns <0, 0 or >0 if a is sent before, together with or after b */
+EXPORT int interleaver_compare(const struct encoder_packet *a, const struct encoder_packet *b);
+
+/** Releases all queued packets and frees the queues */
+EXPORT void interleaver_free(struct packet_interleaver *il);
+
+/** Queues a packet, the interleaver takes over the packet's reference */
+EXPORT void interleaver_push(struct packet_interleaver *il, const struct encoder_packet *packet);
+
+/** Returns the next packet in interleaved order, or NULL if empty */
+EXPORT struct encoder_packet *interleaver_peek(struct packet_interleaver *il);
+
+/** Removes the next packet, passing its reference on to the caller */
+EXPORT bool interleaver_pop(struct packet_interleaver *il, struct encoder_packet *packet);
+
+/** Restores interleaved order after the timestamps of queued packets changed */
+EXPORT void interleaver_resort(struct packet_interleaver *il);
+
+/**
+ * Counts the packets at the start of the interleaved order for which cb
+ * returns true, stopping at the first one that it returns false for or once
+ * max packets have been counted.
+ */
+EXPORT size_t interleaver_count_while(struct packet_interleaver *il, interleaver_packet_cb cb, void *param,
+				      size_t max);
+
+/** Number of queued packets of one encoder track */
+EXPORT size_t interleaver_track_size(struct packet_interleaver *il, enum obs_encoder_type type, size_t track_idx);
+
+/** Queued packet idx of one encoder track, in DTS order */
+EXPORT struct encoder_packet *interleaver_track_packet(struct packet_interleaver *il, enum obs_encoder_type type,
+						       size_t track_idx, size_t idx);
+
+static inline size_t interleaver_num_packets(const struct packet_interleaver *il)
+{
+	return il->num;
+}
+
+static inline struct encoder_packet *interleaver_first(struct packet_interleaver *il, enum obs_encoder_type type,
+						       size_t track_idx)
+{
+	return interleaver_track_size(il, type, track_idx) ? interleaver_track_packet(il, type, track_idx, 0) : NULL;
+}
+
+static inline struct encoder_packet *interleaver_last(struct packet_interleaver *il, enum obs_encoder_type type,
+						      size_t track_idx)
+{
+	size_t size = interleaver_track_size(il, type, track_idx);
+	return size ? interleaver_track_packet(il, type, track_idx, size - 1) : NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
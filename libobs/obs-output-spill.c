@@ -0,0 +1,366 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#include "util/darray.h"
+#include "util/deque.h"
+#include "util/dstr.h"
+#include "util/platform.h"
+#include "util/threading.h"
+#include "obs.h"
+#include "obs-output-spill.h"
+#include "obs-packet-pool.h"
+
+#define SPILL_SEGMENT_SIZE (64ULL * 1024 * 1024)
+
+struct spill_segment {
+	FILE *file;
+	char *path;
+	uint64_t write_size;
+	uint64_t read_pos;
+};
+
+/* data read back from the disk, NULL if reading failed */
+struct spill_data {
+	uint8_t *data;
+	size_t size;
+};
+
+struct delay_spill {
+	struct dstr dir;
+	struct dstr name;
+	uint32_t next_id;
+
+	/* only used by the spill thread */
+	DARRAY(struct spill_segment) segments;
+
+	pthread_mutex_t mutex;
+	os_event_t *event;
+	pthread_t thread;
+	bool stop;
+
+	/* packets waiting to be written, behind the ones on disk */
+	struct deque pending; /* struct encoder_packet */
+	size_t pending_bytes;
+
+	/* sizes of the packets on disk that haven't been read back yet */
+	struct deque disk_sizes; /* size_t */
+
+	/* packets taken back from the disk or straight from pending */
+	struct deque ready; /* struct spill_data */
+	size_t ready_bytes;
+
+	/* the packet the thread is writing or reading right now, whose data
+	 * is in neither of the queues */
+	bool busy;
+	bool write_failed;
+};
+
+static inline void release_data(uint8_t *data)
+{
+	struct encoder_packet packet = {.data = data};
+	obs_encoder_packet_release(&packet);
+}
+
+static void spill_segment_free(struct spill_segment *seg)
+{
+	fclose(seg->file);
+	os_unlink(seg->path);
+	bfree(seg->path);
+}
+
+static struct spill_segment *new_segment(struct delay_spill *spill)
+{
+	struct spill_segment *seg;
+	struct dstr path = {0};
+	FILE *file;
+
+	dstr_printf(&path, "%s/obs-delay-%p-%" PRIu32 ".bin", spill->dir.array, (void *)spill, spill->next_id++);
+
+	file = os_fopen(path.array, "w+b");
+	if (!file) {
+		blog(LOG_WARNING, "Output '%s': Failed to create '%s'", spill->name.array, path.array);
+		dstr_free(&path);
+		return NULL;
+	}
+
+	seg = da_push_back_new(spill->segments);
+	seg->file = file;
+	seg->path = path.array;
+	return seg;
+}
+
+static bool write_data(struct delay_spill *spill, const uint8_t *data, size_t size)
+{
+	struct spill_segment *seg = NULL;
+
+	if (spill->segments.num)
+		seg = da_end(spill->segments);
+	if (!seg || seg->write_size >= SPILL_SEGMENT_SIZE)
+		seg = new_segment(spill);
+	if (!seg)
+		return false;
+
+	if (os_fseeki64(seg->file, (int64_t)seg->write_size, SEEK_SET) != 0 ||
+	    fwrite(data, 1, size, seg->file) != size) {
+		blog(LOG_WARNING, "Output '%s': Failed to write delayed packet to '%s'", spill->name.array, seg->path);
+		return false;
+	}
+
+	seg->write_size += size;
+	return true;
+}
+
+static uint8_t *read_data(struct delay_spill *spill, size_t size)
+{
+	struct spill_segment *seg;
+	uint8_t *data;
+
+	/* packets never span segments, so a fully read segment is done */
+	while (spill->segments.num > 1 &&
+	       spill->segments.array[0].read_pos >= spill->segments.array[0].write_size) {
+		spill_segment_free(&spill->segments.array[0]);
+		da_erase(spill->segments, 0);
+	}
+
+	seg = &spill->segments.array[0];
+	data = (uint8_t *)(packet_pool_alloc(size) + 1);
+
+	if (os_fseeki64(seg->file, (int64_t)seg->read_pos, SEEK_SET) != 0 ||
+	    fread(data, 1, size, seg->file) != size) {
+		blog(LOG_ERROR, "Output '%s': Failed to read delayed packet from '%s'", spill->name.array, seg->path);
+		release_data(data);
+		data = NULL;
+	}
+
+	seg->read_pos += size;
+	return data;
+}
+
+/* reads back the oldest packet if there's room for it, called and returns
+ * with the mutex locked */
+static bool read_next(struct delay_spill *spill)
+{
+	struct spill_data sd;
+
+	if (spill->ready.size && spill->ready_bytes >= DELAY_SPILL_QUEUE_SIZE)
+		return false;
+
+	if (spill->disk_sizes.size) {
+		deque_pop_front(&spill->disk_sizes, &sd.size, sizeof(sd.size));
+		spill->busy = true;
+
+		pthread_mutex_unlock(&spill->mutex);
+		sd.data = read_data(spill, sd.size);
+		pthread_mutex_lock(&spill->mutex);
+
+		spill->busy = false;
+
+	} else if (spill->pending.size) {
+		struct encoder_packet packet;
+
+		/* nothing older is on disk, so it doesn't have to go there */
+		deque_pop_front(&spill->pending, &packet, sizeof(packet));
+		spill->pending_bytes -= packet.size;
+		sd.data = packet.data;
+		sd.size = packet.size;
+
+	} else {
+		return false;
+	}
+
+	deque_push_back(&spill->ready, &sd, sizeof(sd));
+	spill->ready_bytes += sd.size;
+	return true;
+}
+
+/* called and returns with the mutex locked */
+static bool write_next(struct delay_spill *spill)
+{
+	struct encoder_packet packet;
+	bool success;
+
+	if (!spill->pending.size || spill->write_failed)
+		return false;
+
+	deque_pop_front(&spill->pending, &packet, sizeof(packet));
+	spill->busy = true;
+
+	pthread_mutex_unlock(&spill->mutex);
+	success = write_data(spill, packet.data, packet.size);
+	pthread_mutex_lock(&spill->mutex);
+
+	spill->busy = false;
+
+	if (!success) {
+		/* it stays in memory, and so does everything after it */
+		deque_push_front(&spill->pending, &packet, sizeof(packet));
+		spill->write_failed = true;
+		return false;
+	}
+
+	deque_push_back(&spill->disk_sizes, &packet.size, sizeof(packet.size));
+	spill->pending_bytes -= packet.size;
+	obs_encoder_packet_release(&packet);
+	return true;
+}
+
+static void *spill_thread(void *data)
+{
+	struct delay_spill *spill = data;
+
+	os_set_thread_name("obs output delay spill");
+
+	pthread_mutex_lock(&spill->mutex);
+
+	while (!spill->stop) {
+		/* reading comes first, the output waits for it if it's due */
+		if (read_next(spill) || write_next(spill))
+			continue;
+
+		pthread_mutex_unlock(&spill->mutex);
+		os_event_wait(spill->event);
+		pthread_mutex_lock(&spill->mutex);
+	}
+
+	pthread_mutex_unlock(&spill->mutex);
+	return NULL;
+}
+
+struct delay_spill *delay_spill_create(const char *dir, const char *name)
+{
+	struct delay_spill *spill = bzalloc(sizeof(*spill));
+
+	dstr_copy(&spill->dir, dir);
+	dstr_copy(&spill->name, name);
+
+	pthread_mutex_init_value(&spill->mutex);
+	if (pthread_mutex_init(&spill->mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&spill->event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (pthread_create(&spill->thread, NULL, spill_thread, spill) != 0)
+		goto fail;
+
+	return spill;
+
+fail:
+	blog(LOG_WARNING, "Output '%s': Failed to start the delay spill thread", name);
+	os_event_destroy(spill->event);
+	pthread_mutex_destroy(&spill->mutex);
+	dstr_free(&spill->dir);
+	dstr_free(&spill->name);
+	bfree(spill);
+	return NULL;
+}
+
+void delay_spill_destroy(struct delay_spill *spill)
+{
+	if (!spill)
+		return;
+
+	pthread_mutex_lock(&spill->mutex);
+	spill->stop = true;
+	pthread_mutex_unlock(&spill->mutex);
+
+	os_event_signal(spill->event);
+	pthread_join(spill->thread, NULL);
+
+	while (spill->pending.size) {
+		struct encoder_packet packet;
+		deque_pop_front(&spill->pending, &packet, sizeof(packet));
+		obs_encoder_packet_release(&packet);
+	}
+
+	while (spill->ready.size) {
+		struct spill_data sd;
+		deque_pop_front(&spill->ready, &sd, sizeof(sd));
+		if (sd.data)
+			release_data(sd.data);
+	}
+
+	for (size_t i = 0; i < spill->segments.num; i++)
+		spill_segment_free(&spill->segments.array[i]);
+	da_free(spill->segments);
+
+	deque_free(&spill->pending);
+	deque_free(&spill->disk_sizes);
+	deque_free(&spill->ready);
+	os_event_destroy(spill->event);
+	pthread_mutex_destroy(&spill->mutex);
+	dstr_free(&spill->dir);
+	dstr_free(&spill->name);
+	bfree(spill);
+}
+
+bool delay_spill_push(struct delay_spill *spill, const struct encoder_packet *packet)
+{
+	struct encoder_packet ref;
+	bool success = false;
+
+	pthread_mutex_lock(&spill->mutex);
+
+	if (!spill->write_failed &&
+	    (!spill->pending.size || spill->pending_bytes + packet->size <= DELAY_SPILL_QUEUE_SIZE)) {
+		obs_encoder_packet_ref(&ref, (struct encoder_packet *)packet);
+		deque_push_back(&spill->pending, &ref, sizeof(ref));
+		spill->pending_bytes += packet->size;
+		success = true;
+	}
+
+	pthread_mutex_unlock(&spill->mutex);
+
+	if (success)
+		os_event_signal(spill->event);
+	return success;
+}
+
+enum delay_spill_result delay_spill_pop(struct delay_spill *spill, struct encoder_packet *packet)
+{
+	enum delay_spill_result result = DELAY_SPILL_WAIT;
+	struct spill_data sd;
+
+	pthread_mutex_lock(&spill->mutex);
+
+	if (spill->ready.size) {
+		deque_pop_front(&spill->ready, &sd, sizeof(sd));
+		spill->ready_bytes -= sd.size;
+		result = sd.data ? DELAY_SPILL_READY : DELAY_SPILL_ERROR;
+
+	} else if (!spill->busy && !spill->pending.size && !spill->disk_sizes.size) {
+		blog(LOG_ERROR, "Output '%s': No delayed packet to read back", spill->name.array);
+		result = DELAY_SPILL_ERROR;
+	}
+
+	pthread_mutex_unlock(&spill->mutex);
+
+	/* there's room for more now, or the caller is waiting for it */
+	os_event_signal(spill->event);
+
+	if (result == DELAY_SPILL_READY)
+		packet->data = sd.data;
+	return result;
+}
+
+bool delay_spill_write_failed(struct delay_spill *spill)
+{
+	pthread_mutex_lock(&spill->mutex);
+	bool failed = spill->write_failed;
+	pthread_mutex_unlock(&spill->mutex);
+	return failed;
+}
@@ -0,0 +1,78 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Internal: the disk store for delayed packet data that doesn't fit into an
+ * output's delay memory limit.
+ *
+ * Packet data is handed over to a thread of its own, which appends it to
+ * segment files and reads it back in the same order, so the encoder callback
+ * never waits for the disk.  Between the two sides are a queue of packets
+ * waiting to be written and a queue of packets read back ahead of time, each
+ * holding up to DELAY_SPILL_QUEUE_SIZE bytes.
+ *
+ * The functions are exported for the unit tests only, they are not part of
+ * the public API.
+ */
+
+#include "util/c99defs.h"
+#include "obs-encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DELAY_SPILL_QUEUE_SIZE (4 * 1024 * 1024)
+
+struct delay_spill;
+
+enum delay_spill_result {
+	DELAY_SPILL_READY,
+	/* the packet hasn't been read back yet */
+	DELAY_SPILL_WAIT,
+	/* the packet couldn't be read back, it's gone */
+	DELAY_SPILL_ERROR,
+};
+
+/** Starts the spill thread, segment files are created in dir as needed */
+EXPORT struct delay_spill *delay_spill_create(const char *dir, const char *name);
+
+/** Stops the spill thread, releases all packets and deletes the files */
+EXPORT void delay_spill_destroy(struct delay_spill *spill);
+
+/**
+ * Takes a reference of the packet's data for the spill thread.  Fails without
+ * waiting if the thread is too far behind or writing failed before.
+ */
+EXPORT bool delay_spill_push(struct delay_spill *spill, const struct encoder_packet *packet);
+
+/**
+ * Takes back the data of the oldest packet, in the order they were pushed.
+ * Only the data is stored, the rest of the packet has to be kept by the
+ * caller, and on DELAY_SPILL_READY packet->data is set to a new reference.
+ */
+EXPORT enum delay_spill_result delay_spill_pop(struct delay_spill *spill, struct encoder_packet *packet);
+
+/** Returns whether writing to the disk failed, the store only takes no more
+ * packets then, the ones it has are still returned */
+EXPORT bool delay_spill_write_failed(struct delay_spill *spill);
+
+#ifdef __cplusplus
+}
+#endif
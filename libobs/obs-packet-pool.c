@@ -0,0 +1,352 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stddef.h>
+#include "util/bmem.h"
+#include "util/threading.h"
+#include "obs-packet-pool.h"
+
+/* block sizes go up in quarter steps between powers of two, from 256 bytes
+ * to 4 MiB.  larger packets are allocated and freed directly. */
+#define MIN_SHIFT 8
+#define MAX_SHIFT 22
+#define NUM_CLASSES ((MAX_SHIFT - MIN_SHIFT) * 4 + 1)
+#define MAX_BLOCK_SIZE ((size_t)1 << MAX_SHIFT)
+
+/* memory kept for reuse in the shared lists and in each thread's cache */
+#define MAX_SHARED_BYTES (64 * 1024 * 1024)
+#define MAX_CACHE_BYTES (4 * 1024 * 1024)
+#define MAX_CACHE_BLOCKS 16
+
+struct pool_block {
+	struct pool_block *next;
+	uint32_t size_class;
+
+	/* the packet reference count, directly followed by the data */
+	long refs;
+};
+
+#define BLOCK_HEADER_SIZE (offsetof(struct pool_block, refs) + sizeof(long))
+
+struct size_class_list {
+	pthread_mutex_t mutex;
+	struct pool_block *first;
+};
+
+struct thread_cache {
+	struct pool_block *blocks[NUM_CLASSES];
+	uint32_t counts[NUM_CLASSES];
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t bytes_allocated;
+	uint64_t bytes_freed;
+	uint64_t bytes_held;
+
+	struct thread_cache *next;
+	struct thread_cache **prev_next;
+};
+
+static struct {
+	pthread_key_t cache_key;
+
+	/* protects the cache list and the totals of exited threads */
+	pthread_mutex_t mutex;
+	struct thread_cache *caches;
+	struct thread_cache exited;
+
+	struct size_class_list classes[NUM_CLASSES];
+	volatile long shared_bytes;
+} pool;
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static THREAD_LOCAL struct thread_cache *thread_cache = NULL;
+
+static inline size_t class_index(size_t total)
+{
+	size_t shift = MIN_SHIFT;
+	size_t base;
+
+	if (total <= ((size_t)1 << MIN_SHIFT))
+		return 0;
+
+	while ((total - 1) >> (shift + 1))
+		shift++;
+
+	base = (size_t)1 << shift;
+	return (shift - MIN_SHIFT) * 4 + ((total - 1 - base) >> (shift - 2)) + 1;
+}
+
+static inline size_t class_size(size_t idx)
+{
+	size_t shift;
+
+	if (idx == 0)
+		return (size_t)1 << MIN_SHIFT;
+
+	shift = (idx - 1) / 4 + MIN_SHIFT;
+	return ((size_t)1 << shift) + ((idx - 1) % 4 + 1) * ((size_t)1 << (shift - 2));
+}
+
+static inline uint32_t cache_limit(size_t idx)
+{
+	size_t limit = MAX_CACHE_BYTES / class_size(idx);
+	return (uint32_t)(limit > MAX_CACHE_BLOCKS ? MAX_CACHE_BLOCKS : limit);
+}
+
+static inline void add_shared_bytes(long bytes)
+{
+	long val = os_atomic_load_long(&pool.shared_bytes);
+	while (!os_atomic_compare_exchange_long(&pool.shared_bytes, &val, val + bytes))
+		;
+}
+
+static void free_blocks(struct pool_block *block)
+{
+	while (block) {
+		struct pool_block *next = block->next;
+		bfree(block);
+		block = next;
+	}
+}
+
+/* moves up to count blocks of the cache to the shared list, or frees them if
+ * the shared lists already hold enough memory */
+static void cache_flush(struct thread_cache *cache, size_t idx, uint32_t count)
+{
+	struct size_class_list *list = &pool.classes[idx];
+	struct pool_block *unused = NULL;
+	size_t size = class_size(idx);
+
+	pthread_mutex_lock(&list->mutex);
+
+	while (count-- && cache->blocks[idx]) {
+		struct pool_block *block = cache->blocks[idx];
+
+		cache->blocks[idx] = block->next;
+		cache->counts[idx]--;
+		cache->bytes_held -= size;
+
+		if (os_atomic_load_long(&pool.shared_bytes) + (long)size > MAX_SHARED_BYTES) {
+			block->next = unused;
+			unused = block;
+		} else {
+			block->next = list->first;
+			list->first = block;
+			add_shared_bytes((long)size);
+		}
+	}
+
+	pthread_mutex_unlock(&list->mutex);
+
+	free_blocks(unused);
+}
+
+static void cache_refill(struct thread_cache *cache, size_t idx)
+{
+	struct size_class_list *list = &pool.classes[idx];
+	uint32_t count = (cache_limit(idx) + 1) / 2;
+	size_t size = class_size(idx);
+
+	pthread_mutex_lock(&list->mutex);
+
+	while (count-- && list->first) {
+		struct pool_block *block = list->first;
+
+		list->first = block->next;
+		add_shared_bytes(-(long)size);
+
+		block->next = cache->blocks[idx];
+		cache->blocks[idx] = block;
+		cache->counts[idx]++;
+		cache->bytes_held += size;
+	}
+
+	pthread_mutex_unlock(&list->mutex);
+}
+
+static void cache_destroy(void *data)
+{
+	struct thread_cache *cache = data;
+
+	if (!cache)
+		return;
+
+	for (size_t i = 0; i < NUM_CLASSES; i++)
+		cache_flush(cache, i, UINT32_MAX);
+
+	pthread_mutex_lock(&pool.mutex);
+
+	*cache->prev_next = cache->next;
+	if (cache->next)
+		cache->next->prev_next = cache->prev_next;
+
+	pool.exited.hits += cache->hits;
+	pool.exited.misses += cache->misses;
+	pool.exited.bytes_allocated += cache->bytes_allocated;
+	pool.exited.bytes_freed += cache->bytes_freed;
+
+	pthread_mutex_unlock(&pool.mutex);
+
+	if (thread_cache == cache)
+		thread_cache = NULL;
+	bfree(cache);
+}
+
+static void pool_init(void)
+{
+	pthread_key_create(&pool.cache_key, cache_destroy);
+	pthread_mutex_init(&pool.mutex, NULL);
+
+	for (size_t i = 0; i < NUM_CLASSES; i++)
+		pthread_mutex_init(&pool.classes[i].mutex, NULL);
+}
+
+static struct thread_cache *get_thread_cache(void)
+{
+	struct thread_cache *cache = thread_cache;
+
+	if (cache)
+		return cache;
+
+	pthread_once(&pool_once, pool_init);
+
+	cache = bzalloc(sizeof(struct thread_cache));
+
+	pthread_mutex_lock(&pool.mutex);
+	cache->prev_next = &pool.caches;
+	cache->next = pool.caches;
+	if (pool.caches)
+		pool.caches->prev_next = &cache->next;
+	pool.caches = cache;
+	pthread_mutex_unlock(&pool.mutex);
+
+	/* the key's destructor hands the cache back when the thread exits */
+	pthread_setspecific(pool.cache_key, cache);
+	thread_cache = cache;
+	return cache;
+}
+
+long *packet_pool_alloc(size_t size)
+{
+	struct thread_cache *cache = get_thread_cache();
+	size_t total = BLOCK_HEADER_SIZE + size;
+	struct pool_block *block;
+	size_t idx;
+
+	if (total > MAX_BLOCK_SIZE) {
+		long *p_refs = bmalloc(size + sizeof(long));
+		*p_refs = 1;
+		cache->misses++;
+		return p_refs;
+	}
+
+	idx = class_index(total);
+
+	if (!cache->blocks[idx])
+		cache_refill(cache, idx);
+
+	block = cache->blocks[idx];
+	if (block) {
+		cache->blocks[idx] = block->next;
+		cache->counts[idx]--;
+		cache->bytes_held -= class_size(idx);
+		cache->hits++;
+	} else {
+		block = bmalloc(class_size(idx));
+		block->size_class = (uint32_t)idx;
+		cache->misses++;
+	}
+
+	cache->bytes_allocated += class_size(idx);
+
+	block->refs = PACKET_POOL_REFS + 1;
+	return &block->refs;
+}
+
+void packet_pool_free(long *p_refs)
+{
+	struct pool_block *block = (struct pool_block *)((uint8_t *)p_refs - offsetof(struct pool_block, refs));
+	struct thread_cache *cache = get_thread_cache();
+	size_t idx = block->size_class;
+	uint32_t limit = cache_limit(idx);
+
+	cache->bytes_freed += class_size(idx);
+
+	if (cache->counts[idx] >= limit)
+		cache_flush(cache, idx, (limit + 1) / 2);
+
+	block->next = cache->blocks[idx];
+	cache->blocks[idx] = block;
+	cache->counts[idx]++;
+	cache->bytes_held += class_size(idx);
+}
+
+void packet_pool_trim(void)
+{
+	pthread_once(&pool_once, pool_init);
+
+	if (thread_cache) {
+		pthread_setspecific(pool.cache_key, NULL);
+		cache_destroy(thread_cache);
+	}
+
+	for (size_t i = 0; i < NUM_CLASSES; i++) {
+		struct size_class_list *list = &pool.classes[i];
+		struct pool_block *blocks;
+		long count = 0;
+
+		pthread_mutex_lock(&list->mutex);
+		blocks = list->first;
+		list->first = NULL;
+		pthread_mutex_unlock(&list->mutex);
+
+		for (struct pool_block *block = blocks; block; block = block->next)
+			count++;
+
+		add_shared_bytes(-count * (long)class_size(i));
+		free_blocks(blocks);
+	}
+}
+
+void packet_pool_get_stats(struct obs_encoder_packet_pool_stats *stats)
+{
+	struct thread_cache total;
+
+	pthread_once(&pool_once, pool_init);
+
+	pthread_mutex_lock(&pool.mutex);
+
+	total = pool.exited;
+
+	/* the counters of other threads are read without synchronization,
+	 * they're only statistics */
+	for (struct thread_cache *cache = pool.caches; cache; cache = cache->next) {
+		total.hits += cache->hits;
+		total.misses += cache->misses;
+		total.bytes_allocated += cache->bytes_allocated;
+		total.bytes_freed += cache->bytes_freed;
+		total.bytes_held += cache->bytes_held;
+	}
+
+	pthread_mutex_unlock(&pool.mutex);
+
+	stats->hits = total.hits;
+	stats->misses = total.misses;
+	stats->bytes_held = total.bytes_held + (uint64_t)os_atomic_load_long(&pool.shared_bytes);
+	stats->bytes_in_use = total.bytes_allocated - total.bytes_freed;
+}
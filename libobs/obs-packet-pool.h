@@ -0,0 +1,58 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Internal: size-classed pool for encoder packet data.
+ *
+ * Packet data is preceded by a long reference count (see
+ * obs_encoder_packet_ref/release).  Blocks that belong to the pool have
+ * PACKET_POOL_REFS set in that count, so releasing the last reference leaves
+ * PACKET_POOL_REFS instead of 0, and the block goes back to the pool instead
+ * of to bfree.  Packets allocated elsewhere keep working as before.
+ *
+ * Freed blocks are first kept in a small per-thread cache and exchanged with
+ * the shared per-size-class lists in batches.
+ *
+ * The functions are exported for the unit tests only, they are not part of
+ * the public API.
+ */
+
+#include "util/c99defs.h"
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PACKET_POOL_REFS (1L << (sizeof(long) * 8 - 2))
+
+/** Returns the reference count of a new block, the data follows it */
+EXPORT long *packet_pool_alloc(size_t size);
+
+/** Returns a block to the pool once its reference count is PACKET_POOL_REFS */
+EXPORT void packet_pool_free(long *p_refs);
+
+/** Frees the blocks held by the pool and by the calling thread's cache */
+EXPORT void packet_pool_trim(void);
+
+EXPORT void packet_pool_get_stats(struct obs_encoder_packet_pool_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
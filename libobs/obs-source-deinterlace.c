@@ -421,6 +421,8 @@ static void enable_deinterlacing(obs_source_t *source, enum obs_deinterlace_mode
 	pthread_mutex_unlock(&source->async_mutex);
 
 	obs_leave_graphics();
+
+	release_external_frames(source);
 }
 
 static void disable_deinterlacing(obs_source_t *source)
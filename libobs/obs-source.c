@@ -21,6 +21,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-simd.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/util_uint64.h"
@@ -632,10 +633,21 @@ void obs_source_frame_init(struct obs_source_frame *frame, enum video_format for
 	}
 }
 
+static void async_frame_destroy(struct obs_source_frame *frame)
+{
+	if (frame->external) {
+		struct obs_source_ext_frame *ext = (struct obs_source_ext_frame *)frame;
+		ext->release(ext->release_param);
+		bfree(ext);
+	} else {
+		obs_source_frame_destroy(frame);
+	}
+}
+
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source, obs_source_t *filter);
@@ -722,6 +734,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
+	for (i = 0; i < source->async_release_frames.num; i++)
+		obs_source_frame_decref(source->async_release_frames.array[i]);
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
@@ -756,6 +770,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
+	da_free(source->async_release_frames);
 	da_free(source->filters);
 	da_free(source->media_actions);
 	pthread_mutex_destroy(&source->filter_mutex);
@@ -1287,15 +1302,14 @@ static void async_tick(obs_source_t *source)
 		source->async_update_texture = set_async_texture_size(source, source->cur_async_frame);
 
 	pthread_mutex_unlock(&source->async_mutex);
+
+	release_external_frames(source);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+void obs_source_video_tick_prepare(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
-		return;
-
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
 
@@ -1357,7 +1371,10 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 
 		source->active = now_active;
 	}
+}
 
+void obs_source_video_tick_finish(obs_source_t *source, float seconds)
+{
 	if (source->context.data && source->info.video_tick)
 		source->info.video_tick(source->context.data, seconds);
 
@@ -1365,6 +1382,15 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 	source->deinterlace_rendered = false;
 }
 
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	obs_source_video_tick_prepare(source, seconds);
+	obs_source_video_tick_finish(source, seconds);
+}
+
 /* unless the value is 3+ hours worth of frames, this won't overflow */
 static inline uint64_t conv_frames_to_time(const size_t sample_rate, const size_t frames)
 {
@@ -3407,10 +3433,17 @@ static inline bool async_texture_changed(struct obs_source *source, const struct
 	return source->async_cache_width != frame->width || source->async_cache_height != frame->height || prev != cur;
 }
 
+/* must be followed by release_external_frames() once async_mutex is unlocked */
 static inline void free_async_cache(struct obs_source *source)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct obs_source_frame *frame = source->async_cache.array[i].frame;
+
+		if (frame->external)
+			da_push_back(source->async_release_frames, &frame);
+		else
+			obs_source_frame_decref(frame);
+	}
 
 	da_resize(source->async_cache, 0);
 	da_resize(source->async_frames, 0);
@@ -3506,6 +3539,7 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 		source->last_frame_ts = 0;
 		free_async_cache(source);
 		pthread_mutex_unlock(&source->async_mutex);
+		release_external_frames(source);
 		return;
 	}
 
@@ -3525,6 +3559,8 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 		}
 	}
 	pthread_mutex_unlock(&source->async_mutex);
+
+	release_external_frames(source);
 }
 
 void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame)
@@ -3576,6 +3612,90 @@ void obs_source_output_video2(obs_source_t *source, const struct obs_source_fram
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+static struct obs_source_frame *create_external_frame(const struct obs_source_frame2 *frame,
+						      obs_source_frame_release_t release, void *param)
+{
+	struct obs_source_ext_frame *ext = bzalloc(sizeof(*ext));
+	struct obs_source_frame *new_frame = &ext->frame;
+	enum video_range_type range = resolve_video_range(frame->format, frame->range);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		new_frame->data[i] = frame->data[i];
+		new_frame->linesize[i] = frame->linesize[i];
+	}
+
+	new_frame->width = frame->width;
+	new_frame->height = frame->height;
+	new_frame->timestamp = frame->timestamp;
+	new_frame->format = frame->format;
+	new_frame->full_range = range == VIDEO_RANGE_FULL;
+	new_frame->max_luminance = 0;
+	new_frame->flip = frame->flip;
+	new_frame->flags = frame->flags;
+	new_frame->trc = frame->trc;
+
+	memcpy(&new_frame->color_matrix, &frame->color_matrix, sizeof(frame->color_matrix));
+	memcpy(&new_frame->color_range_min, &frame->color_range_min, sizeof(frame->color_range_min));
+	memcpy(&new_frame->color_range_max, &frame->color_range_max, sizeof(frame->color_range_max));
+
+	new_frame->refs = 1;
+	new_frame->external = true;
+	ext->release = release;
+	ext->release_param = param;
+	return new_frame;
+}
+
+void obs_source_output_video3(obs_source_t *source, const struct obs_source_frame2 *frame,
+			      obs_source_frame_release_t release, void *param)
+{
+	struct obs_source_frame *new_frame;
+	bool dropped = false;
+
+	if (!obs_ptr_valid(release, "obs_source_output_video3"))
+		return;
+	if (!obs_source_valid(source, "obs_source_output_video3") || destroying(source) || !frame) {
+		release(param);
+		return;
+	}
+
+	source_profiler_async_frame_received(source);
+
+	new_frame = create_external_frame(frame, release, param);
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		free_async_cache(source);
+		source->last_frame_ts = 0;
+		dropped = true;
+
+	} else {
+		struct async_frame af = {.frame = new_frame, .used = true};
+
+		if (async_texture_changed(source, new_frame)) {
+			free_async_cache(source);
+			source->async_cache_width = new_frame->width;
+			source->async_cache_height = new_frame->height;
+		}
+
+		source->async_cache_format = new_frame->format;
+		source->async_cache_full_range = new_frame->full_range;
+		source->async_cache_trc = new_frame->trc;
+
+		/* the cache entry holds the frame's only reference, like with
+		 * frames copied by cache_video */
+		da_push_back(source->async_cache, &af);
+		da_push_back(source->async_frames, &new_frame);
+		source->async_active = true;
+	}
+
+	pthread_mutex_unlock(&source->async_mutex);
+
+	release_external_frames(source);
+	if (dropped)
+		async_frame_destroy(new_frame);
+}
+
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 {
 	if (source)
@@ -3878,50 +3998,36 @@ static void copy_audio_data(obs_source_t *source, const uint8_t *const data[], u
 static void downmix_to_mono_planar(struct obs_source *source, uint32_t frames)
 {
 	size_t channels = audio_output_get_channels(obs->audio.audio);
-	const float channels_i = 1.0f / (float)channels;
 	float **data = (float **)source->audio_data.data;
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[0][frame] += data[channel][frame];
-	}
-
-	for (uint32_t frame = 0; frame < frames; frame++)
-		data[0][frame] *= channels_i;
-
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[channel][frame] = data[0][frame];
-	}
+	audio_downmix_to_mono(data, channels, frames);
 }
 
 static void process_audio_balancing(struct obs_source *source, uint32_t frames, float balance,
 				    enum obs_balance_type type)
 {
 	float **data = (float **)source->audio_data.data;
+	float gain_l, gain_r;
 
 	switch (type) {
 	case OBS_BALANCE_TYPE_SINE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sinf((1.0f - balance) * (M_PI / 2.0f));
-			data[1][frame] = data[1][frame] * sinf(balance * (M_PI / 2.0f));
-		}
+		gain_l = sinf((1.0f - balance) * (M_PI / 2.0f));
+		gain_r = sinf(balance * (M_PI / 2.0f));
 		break;
 	case OBS_BALANCE_TYPE_SQUARE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sqrtf(1.0f - balance);
-			data[1][frame] = data[1][frame] * sqrtf(balance);
-		}
+		gain_l = sqrtf(1.0f - balance);
+		gain_r = sqrtf(balance);
 		break;
 	case OBS_BALANCE_TYPE_LINEAR:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * (1.0f - balance);
-			data[1][frame] = data[1][frame] * balance;
-		}
+		gain_l = 1.0f - balance;
+		gain_r = balance;
 		break;
 	default:
-		break;
+		return;
 	}
+
+	audio_apply_gain(data[0], gain_l, frames);
+	audio_apply_gain(data[1], gain_r, frames);
 }
 
 /* resamples/remixes new audio to the designated main audio output format */
@@ -4011,12 +4117,40 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			/* external frames can't be reused, so hand them back to
+			 * their producer instead.  that has to wait until
+			 * async_mutex is unlocked, which also keeps the frame
+			 * valid for the rest of the caller's locked section. */
+			if (frame->external) {
+				da_push_back(source->async_release_frames, &frame);
+				da_erase(source->async_cache, i);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
 }
 
+/* drops the cache references of external frames that are no longer used */
+void release_external_frames(obs_source_t *source)
+{
+	DARRAY(struct obs_source_frame *) frames;
+
+	pthread_mutex_lock(&source->async_mutex);
+	if (!source->async_release_frames.num) {
+		pthread_mutex_unlock(&source->async_mutex);
+		return;
+	}
+	da_move(frames, source->async_release_frames);
+	pthread_mutex_unlock(&source->async_mutex);
+
+	for (size_t i = 0; i < frames.num; i++)
+		obs_source_frame_decref(frames.array[i]);
+
+	da_free(frames);
+}
+
 /* #define DEBUG_ASYNC_FRAMES 1 */
 
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
@@ -4158,16 +4292,24 @@ void obs_source_release_frame(obs_source_t *source, struct obs_source_frame *fra
 		return;
 
 	if (!source) {
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 	} else {
+		bool destroy = false;
+
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			destroy = true;
 		else
 			remove_async_frame(source, frame);
 
 		pthread_mutex_unlock(&source->async_mutex);
+
+		/* outside of the lock, the release callback of external
+		 * frames may call back into libobs */
+		if (destroy)
+			async_frame_destroy(frame);
+		release_external_frames(source);
 	}
 }
 
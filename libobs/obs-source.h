@@ -208,6 +208,13 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_REQUIRES_CANVAS (1 << 17)
 
+/**
+ * Source's video_tick callback does not use the graphics subsystem and is
+ * safe to call from threads other than the graphics thread, concurrently
+ * with other sources' video_tick callbacks
+ */
+#define OBS_SOURCE_THREADSAFE_TICK (1 << 18)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
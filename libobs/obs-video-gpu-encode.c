@@ -19,6 +19,413 @@
 
 #define NBSP "\xC2\xA0"
 static const char *gpu_encode_frame_name = "gpu_encode_frame";
+
+/* ------------------------------------------------------------------------- */
+/* threaded submission, see obs_set_threaded_gpu_encode                      */
+
+struct gpu_encode_job {
+	obs_encoder_t *encoder;
+	struct obs_tex_frame frame;
+	int64_t pts;
+};
+
+struct gpu_encode_worker {
+	struct obs_core_video_mix *video;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	os_sem_t *jobs_sem;
+	struct deque jobs;
+	bool stop;
+	bool detached;
+};
+
+/* the encode thread's own hold, kept while a repeated frame is queued again */
+static void hold_frame_locked(struct obs_core_video_mix *video, const struct obs_tex_frame *tf)
+{
+	struct obs_tex_frame_hold *hold = &video->gpu_encoder_holds[tf->id];
+
+	if (!hold->refs) {
+		hold->refs = 1;
+		video->gpu_encoder_frames_held++;
+	}
+}
+
+static void release_frame_locked(struct obs_core_video_mix *video, size_t id)
+{
+	struct obs_tex_frame_hold *hold = &video->gpu_encoder_holds[id];
+	struct obs_gpu_encode_stats *stats = &video->gpu_encode_stats;
+
+	if (--hold->refs)
+		return;
+
+	if (hold->first_release) {
+		uint64_t wait = hold->last_release - hold->first_release;
+
+		stats->frames++;
+		stats->encoder_wait_ns += wait;
+		if (wait > stats->max_encoder_wait_ns)
+			stats->max_encoder_wait_ns = wait;
+
+		hold->first_release = 0;
+		hold->last_release = 0;
+	}
+
+	deque_push_back(&video->gpu_encoder_avail_queue, &hold->frame, sizeof(hold->frame));
+	video->gpu_encoder_frames_held--;
+	os_event_signal(video->gpu_encoder_frame_released);
+}
+
+static void release_job_frame(struct obs_core_video_mix *video, size_t id)
+{
+	uint64_t ts = os_gettime_ns();
+	struct obs_tex_frame_hold *hold;
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	hold = &video->gpu_encoder_holds[id];
+	if (!hold->first_release)
+		hold->first_release = ts;
+	hold->last_release = ts;
+	release_frame_locked(video, id);
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+}
+
+/* the graphics thread can only queue a frame if either the avail queue or the
+ * encode queue has a texture, so one texture is always left for it */
+static bool wait_for_free_texture(struct obs_core_video_mix *video)
+{
+	uint64_t start = 0;
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+
+	for (;;) {
+		struct obs_tex_frame *tf = deque_data(&video->gpu_encoder_queue, 0);
+
+		/* repeated frames are still held from their last round */
+		if (!tf || video->gpu_encoder_holds[tf->id].refs ||
+		    video->gpu_encoder_frames_held < NUM_ENCODE_TEXTURES - 1)
+			break;
+
+		if (!start)
+			start = os_gettime_ns();
+
+		pthread_mutex_unlock(&video->gpu_encoder_mutex);
+		os_event_wait(video->gpu_encoder_frame_released);
+
+		if (os_atomic_load_bool(&video->gpu_encode_stop))
+			return false;
+
+		pthread_mutex_lock(&video->gpu_encoder_mutex);
+	}
+
+	if (start) {
+		video->gpu_encode_stats.texture_waits++;
+		video->gpu_encode_stats.texture_wait_ns += os_gettime_ns() - start;
+	}
+
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* returns whether the encoder takes the frame with this timestamp */
+static bool gpu_encoder_ready(obs_encoder_t *encoder, uint64_t timestamp)
+{
+	obs_weak_encoder_t **paired = encoder->paired_encoders.array;
+	size_t num_paired = encoder->paired_encoders.num;
+	uint32_t skip = 0;
+
+	if (encoder->encoder_group && !encoder->start_ts) {
+		struct obs_encoder_group *group = encoder->encoder_group;
+		bool ready = false;
+		pthread_mutex_lock(&group->mutex);
+		ready = group->start_timestamp == timestamp;
+		pthread_mutex_unlock(&group->mutex);
+		if (!ready)
+			return false;
+	}
+
+	if (!encoder->first_received && num_paired) {
+		bool wait_for_audio = false;
+
+		for (size_t idx = 0; !wait_for_audio && idx < num_paired; idx++) {
+			obs_encoder_t *enc = obs_weak_encoder_get_encoder(paired[idx]);
+			if (!enc)
+				continue;
+
+			if (!enc->first_received || enc->first_raw_ts > timestamp) {
+				wait_for_audio = true;
+			}
+
+			obs_encoder_release(enc);
+		}
+
+		if (wait_for_audio)
+			return false;
+	}
+
+	if (video_pause_check(&encoder->pause, timestamp))
+		return false;
+
+	// an explicit counter is used instead of remainder calculation
+	// to allow multiple encoders started at the same time to start on
+	// the same frame
+	skip = encoder->frame_rate_divisor_counter++;
+	if (encoder->frame_rate_divisor_counter == encoder->frame_rate_divisor)
+		encoder->frame_rate_divisor_counter = 0;
+	if (skip)
+		return false;
+
+	if (!encoder->start_ts)
+		encoder->start_ts = timestamp;
+
+	return true;
+}
+
+static bool encode_gpu_texture(obs_encoder_t *encoder, const struct obs_tex_frame *tf, int64_t pts, uint64_t lock_key,
+			       uint64_t *next_key, struct encoder_packet *pkt, bool *received, uint64_t *fer_ts,
+			       uint64_t *ferc_ts)
+{
+	bool success;
+
+	/* done here rather than when checking the frame, so that it never
+	 * overlaps an encode on the encoder's own thread */
+	if (encoder->reconfigure_requested) {
+		encoder->reconfigure_requested = false;
+		encoder->info.update(encoder->context.data, encoder->context.settings);
+	}
+
+	pkt->timebase_num = encoder->timebase_num * encoder->frame_rate_divisor;
+	pkt->timebase_den = encoder->timebase_den;
+	pkt->encoder = encoder;
+
+	/* Get the frame encode request timestamp. This
+	 * needs to be read just before the encode request.
+	 */
+	*fer_ts = os_gettime_ns();
+
+	profile_start(gpu_encode_frame_name);
+	if (encoder->info.encode_texture2) {
+		struct encoder_texture tex = {0};
+
+		tex.handle = tf->handle;
+		tex.tex[0] = tf->tex;
+		tex.tex[1] = tf->tex_uv;
+		tex.tex[2] = NULL;
+		success = encoder->info.encode_texture2(encoder->context.data, &tex, pts, lock_key, next_key, pkt,
+							received);
+	} else {
+		success = encoder->info.encode_texture(encoder->context.data, tf->handle, pts, lock_key, next_key, pkt,
+						       received);
+	}
+	profile_end(gpu_encode_frame_name);
+
+	// Get the frame encode request complete timestamp
+	*ferc_ts = os_gettime_ns();
+	return success;
+}
+
+static void send_off_gpu_packet(obs_encoder_t *encoder, uint64_t timestamp, int64_t pts, bool success, bool received,
+				struct encoder_packet *pkt, uint64_t fer_ts, uint64_t ferc_ts)
+{
+	/* Generate and enqueue the frame timing metrics, namely
+	 * the CTS (composition time), FER (frame encode request), FERC
+	 * (frame encode request complete) and current PTS. PTS is used to
+	 * associate the frame timing data with the encode packet. */
+	if (timestamp) {
+		struct encoder_packet_time *ept = da_push_back_new(encoder->encoder_packet_times);
+		if (success) {
+			ept->ferc = ferc_ts;
+		} else {
+			// Encode had error, set ferc to 0
+			ept->ferc = 0;
+		}
+
+		ept->pts = pts;
+		ept->cts = timestamp;
+		ept->fer = fer_ts;
+	}
+
+	if (success)
+		encoder_record_frame_timing(encoder, &timestamp, fer_ts, ferc_ts);
+
+	send_off_encoder_packet(encoder, success, received, pkt);
+}
+
+static void encode_gpu_frame(obs_encoder_t *encoder, const struct obs_tex_frame *tf, int64_t pts, uint64_t lock_key,
+			     uint64_t *next_key)
+{
+	struct encoder_packet pkt = {0};
+	bool received = false;
+	uint64_t fer_ts = 0;
+	uint64_t ferc_ts = 0;
+	bool success;
+
+	success = encode_gpu_texture(encoder, tf, pts, lock_key, next_key, &pkt, &received, &fer_ts, &ferc_ts);
+	send_off_gpu_packet(encoder, tf->timestamp, pts, success, received, &pkt, fer_ts, ferc_ts);
+}
+
+static void queue_gpu_encode_job(struct obs_core_video_mix *video, obs_encoder_t *encoder,
+				 const struct obs_tex_frame *tf, int64_t pts)
+{
+	struct gpu_encode_worker *worker = encoder->gpu_worker;
+	struct gpu_encode_job job = {
+		.encoder = obs_encoder_get_ref(encoder),
+		.frame = *tf,
+		.pts = pts,
+	};
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	video->gpu_encoder_holds[tf->id].refs++;
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
+	pthread_mutex_lock(&worker->mutex);
+	deque_push_back(&worker->jobs, &job, sizeof(job));
+	pthread_mutex_unlock(&worker->mutex);
+
+	os_sem_post(worker->jobs_sem);
+}
+
+static void free_gpu_encode_worker(struct gpu_encode_worker *worker)
+{
+	os_sem_destroy(worker->jobs_sem);
+	pthread_mutex_destroy(&worker->mutex);
+	deque_free(&worker->jobs);
+	bfree(worker);
+}
+
+static void *gpu_encode_worker_thread(void *data)
+{
+	struct gpu_encode_worker *worker = data;
+	struct obs_core_video_mix *video = worker->video;
+	uint64_t interval = video_output_get_frame_time(video->video);
+
+	os_set_thread_name("obs gpu encode worker");
+	const char *worker_name = profile_store_name(obs_get_profiler_name_store(),
+						     "obs_gpu_encode_worker(%g" NBSP "ms)", interval / 1000000.);
+	profile_register_root(worker_name, interval);
+
+	while (os_sem_wait(worker->jobs_sem) == 0) {
+		struct gpu_encode_job job;
+		struct encoder_packet pkt = {0};
+		bool received = false;
+		uint64_t fer_ts = 0;
+		uint64_t ferc_ts = 0;
+		uint64_t next_key;
+		bool success;
+		bool stop;
+
+		pthread_mutex_lock(&worker->mutex);
+		stop = worker->stop;
+		if (!stop)
+			deque_pop_front(&worker->jobs, &job, sizeof(job));
+		pthread_mutex_unlock(&worker->mutex);
+
+		if (stop)
+			break;
+
+		profile_start(worker_name);
+
+		next_key = job.frame.lock_key;
+		success = encode_gpu_texture(job.encoder, &job.frame, job.pts, job.frame.lock_key, &next_key, &pkt,
+					     &received, &fer_ts, &ferc_ts);
+
+		/* the texture isn't needed anymore, so it can go back to the
+		 * graphics thread while the packet is sent off */
+		release_job_frame(video, job.frame.id);
+
+		send_off_gpu_packet(job.encoder, job.frame.timestamp, job.pts, success, received, &pkt, fer_ts,
+				    ferc_ts);
+		obs_encoder_release(job.encoder);
+
+		profile_end(worker_name);
+		profile_reenable_thread();
+	}
+
+	/* stopped from this thread by an encode error, see
+	 * stop_gpu_encode_worker */
+	if (worker->detached)
+		free_gpu_encode_worker(worker);
+	return NULL;
+}
+
+void start_gpu_encode_worker(struct obs_core_video_mix *video, obs_encoder_t *encoder)
+{
+	struct gpu_encode_worker *worker;
+
+	if (!video->gpu_encode_threaded)
+		return;
+
+	worker = bzalloc(sizeof(*worker));
+	worker->video = video;
+	pthread_mutex_init_value(&worker->mutex);
+
+	if (pthread_mutex_init(&worker->mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&worker->jobs_sem, 0) != 0)
+		goto fail;
+	if (pthread_create(&worker->thread, NULL, gpu_encode_worker_thread, worker) != 0)
+		goto fail;
+
+	encoder->gpu_worker = worker;
+	return;
+
+fail:
+	blog(LOG_WARNING, "encoder '%s': Failed to create GPU encode worker, encoding on the GPU encode thread",
+	     encoder->context.name);
+	free_gpu_encode_worker(worker);
+}
+
+/* called once the GPU encode thread no longer hands the encoder frames */
+void stop_gpu_encode_worker(obs_encoder_t *encoder)
+{
+	struct gpu_encode_worker *worker = encoder->gpu_worker;
+	struct obs_core_video_mix *video;
+	struct gpu_encode_job job;
+	struct deque jobs;
+	bool self;
+
+	if (!worker)
+		return;
+
+	video = worker->video;
+	self = pthread_equal(pthread_self(), worker->thread);
+	encoder->gpu_worker = NULL;
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->stop = true;
+	worker->detached = self;
+	jobs = worker->jobs;
+	memset(&worker->jobs, 0, sizeof(worker->jobs));
+	pthread_mutex_unlock(&worker->mutex);
+
+	os_sem_post(worker->jobs_sem);
+
+	/* frames that weren't encoded yet go straight back to the ring, this
+	 * also has to happen when stopped by an encode error on the worker,
+	 * as the ring is freed right after the last encoder stops */
+	while (jobs.size) {
+		deque_pop_front(&jobs, &job, sizeof(job));
+
+		pthread_mutex_lock(&video->gpu_encoder_mutex);
+		release_frame_locked(video, job.frame.id);
+		pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
+		obs_encoder_release(job.encoder);
+	}
+	deque_free(&jobs);
+
+	if (self) {
+		pthread_detach(worker->thread);
+		return;
+	}
+
+	pthread_join(worker->thread, NULL);
+	free_gpu_encode_worker(worker);
+}
+
+/* ------------------------------------------------------------------------- */
+
 static void *gpu_encode_thread(void *data)
 {
 	struct obs_core_video_mix *video = data;
@@ -39,7 +446,6 @@ static void *gpu_encode_thread(void *data)
 		uint64_t lock_key;
 		uint64_t next_key;
 		size_t lock_count = 0;
-		uint64_t fer_ts = 0;
 
 		if (os_atomic_load_bool(&video->gpu_encode_stop))
 			break;
@@ -49,6 +455,11 @@ static void *gpu_encode_thread(void *data)
 			continue;
 		}
 
+		/* waits before marking the thread as busy, as stopping an
+		 * encoder from its worker waits for that */
+		if (video->gpu_encode_threaded && !wait_for_free_texture(video))
+			break;
+
 		profile_start(gpu_encode_thread_name);
 
 		os_event_reset(video->gpu_encode_inactive);
@@ -62,6 +473,9 @@ static void *gpu_encode_thread(void *data)
 		lock_key = tf.lock_key;
 		next_key = tf.lock_key;
 
+		if (video->gpu_encode_threaded)
+			hold_frame_locked(video, &tf);
+
 		video_output_inc_texture_frames(video->video);
 
 		for (size_t i = 0; i < video->gpu_encoders.num; i++) {
@@ -75,119 +489,26 @@ static void *gpu_encode_thread(void *data)
 		/* -------------- */
 
 		for (size_t i = 0; i < encoders.num; i++) {
-			struct encoder_packet pkt = {0};
-			bool received = false;
-			bool success = false;
-			uint32_t skip = 0;
-
 			obs_encoder_t *encoder = encoders.array[i];
-			obs_weak_encoder_t **paired = encoder->paired_encoders.array;
-			size_t num_paired = encoder->paired_encoders.num;
-
-			pkt.timebase_num = encoder->timebase_num * encoder->frame_rate_divisor;
-			pkt.timebase_den = encoder->timebase_den;
-			pkt.encoder = encoder;
-
-			if (encoder->encoder_group && !encoder->start_ts) {
-				struct obs_encoder_group *group = encoder->encoder_group;
-				bool ready = false;
-				pthread_mutex_lock(&group->mutex);
-				ready = group->start_timestamp == timestamp;
-				pthread_mutex_unlock(&group->mutex);
-				if (!ready)
-					continue;
-			}
-
-			if (!encoder->first_received && num_paired) {
-				bool wait_for_audio = false;
-
-				for (size_t idx = 0; !wait_for_audio && idx < num_paired; idx++) {
-					obs_encoder_t *enc = obs_weak_encoder_get_encoder(paired[idx]);
-					if (!enc)
-						continue;
-
-					if (!enc->first_received || enc->first_raw_ts > timestamp) {
-						wait_for_audio = true;
-					}
+			int64_t pts;
 
-					obs_encoder_release(enc);
-				}
-
-				if (wait_for_audio)
-					continue;
-			}
-
-			if (video_pause_check(&encoder->pause, timestamp))
-				continue;
-
-			if (encoder->reconfigure_requested) {
-				encoder->reconfigure_requested = false;
-				encoder->info.update(encoder->context.data, encoder->context.settings);
-			}
-
-			// an explicit counter is used instead of remainder calculation
-			// to allow multiple encoders started at the same time to start on
-			// the same frame
-			skip = encoder->frame_rate_divisor_counter++;
-			if (encoder->frame_rate_divisor_counter == encoder->frame_rate_divisor)
-				encoder->frame_rate_divisor_counter = 0;
-			if (skip)
+			if (!gpu_encoder_ready(encoder, timestamp))
 				continue;
 
-			if (!encoder->start_ts)
-				encoder->start_ts = timestamp;
-
 			if (++lock_count == encoders.num)
 				next_key = 0;
 			else
 				next_key++;
 
-			/* Get the frame encode request timestamp. This
-			 * needs to be read just before the encode request.
-			 */
-			fer_ts = os_gettime_ns();
-
-			profile_start(gpu_encode_frame_name);
-			if (encoder->info.encode_texture2) {
-				struct encoder_texture tex = {0};
-
-				tex.handle = tf.handle;
-				tex.tex[0] = tf.tex;
-				tex.tex[1] = tf.tex_uv;
-				tex.tex[2] = NULL;
-				success = encoder->info.encode_texture2(encoder->context.data, &tex, encoder->cur_pts,
-									lock_key, &next_key, &pkt, &received);
-			} else {
-				success = encoder->info.encode_texture(encoder->context.data, tf.handle,
-								       encoder->cur_pts, lock_key, &next_key, &pkt,
-								       &received);
-			}
-			profile_end(gpu_encode_frame_name);
-
-			/* Generate and enqueue the frame timing metrics, namely
-			 * the CTS (composition time), FER (frame encode request), FERC
-			 * (frame encode request complete) and current PTS. PTS is used to
-			 * associate the frame timing data with the encode packet. */
-			if (tf.timestamp) {
-				struct encoder_packet_time *ept = da_push_back_new(encoder->encoder_packet_times);
-				// Get the frame encode request complete timestamp
-				if (success) {
-					ept->ferc = os_gettime_ns();
-				} else {
-					// Encode had error, set ferc to 0
-					ept->ferc = 0;
-				}
-
-				ept->pts = encoder->cur_pts;
-				ept->cts = tf.timestamp;
-				ept->fer = fer_ts;
-			}
+			pts = encoder->cur_pts;
+			encoder->cur_pts += encoder->timebase_num * encoder->frame_rate_divisor;
 
-			send_off_encoder_packet(encoder, success, received, &pkt);
+			if (encoder->gpu_worker)
+				queue_gpu_encode_job(video, encoder, &tf, pts);
+			else
+				encode_gpu_frame(encoder, &tf, pts, lock_key, &next_key);
 
 			lock_key = next_key;
-
-			encoder->cur_pts += encoder->timebase_num * encoder->frame_rate_divisor;
 		}
 
 		/* -------------- */
@@ -201,6 +522,9 @@ static void *gpu_encode_thread(void *data)
 			deque_push_front(&video->gpu_encoder_queue, &tf, sizeof(tf));
 
 			video_output_inc_texture_skipped_frames(video->video);
+		} else if (video->gpu_encode_threaded) {
+			video->gpu_encoder_holds[tf.id].frame = tf;
+			release_frame_locked(video, tf.id);
 		} else {
 			deque_push_back(&video->gpu_encoder_avail_queue, &tf, sizeof(tf));
 		}
@@ -229,6 +553,14 @@ bool init_gpu_encoding(struct obs_core_video_mix *video)
 	const struct video_output_info *info = video_output_get_info(video->video);
 
 	video->gpu_encode_stop = false;
+#ifdef _WIN32
+	video->gpu_encode_threaded = false;
+#else
+	video->gpu_encode_threaded = os_atomic_load_bool(&obs->video.threaded_gpu_encode);
+#endif
+	video->gpu_encoder_frames_held = 0;
+	memset(video->gpu_encoder_holds, 0, sizeof(video->gpu_encoder_holds));
+	memset(&video->gpu_encode_stats, 0, sizeof(video->gpu_encode_stats));
 
 	deque_reserve(&video->gpu_encoder_avail_queue, NUM_ENCODE_TEXTURES);
 	for (size_t i = 0; i < NUM_ENCODE_TEXTURES; i++) {
@@ -252,7 +584,7 @@ bool init_gpu_encoding(struct obs_core_video_mix *video)
 		uint32_t handle = (uint32_t)-1;
 #endif
 
-		struct obs_tex_frame frame = {.tex = tex, .tex_uv = tex_uv, .handle = handle};
+		struct obs_tex_frame frame = {.tex = tex, .tex_uv = tex_uv, .handle = handle, .id = i};
 
 		deque_push_back(&video->gpu_encoder_avail_queue, &frame, sizeof(frame));
 	}
@@ -261,6 +593,8 @@ bool init_gpu_encoding(struct obs_core_video_mix *video)
 		return false;
 	if (os_event_init(&video->gpu_encode_inactive, OS_EVENT_TYPE_MANUAL) != 0)
 		return false;
+	if (os_event_init(&video->gpu_encoder_frame_released, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
 	if (pthread_create(&video->gpu_encode_thread, NULL, gpu_encode_thread, video) != 0)
 		return false;
 
@@ -275,6 +609,7 @@ void stop_gpu_encoding_thread(struct obs_core_video_mix *video)
 	if (video->gpu_encode_thread_initialized) {
 		os_atomic_set_bool(&video->gpu_encode_stop, true);
 		os_sem_post(video->gpu_encode_semaphore);
+		os_event_signal(video->gpu_encoder_frame_released);
 		pthread_join(video->gpu_encode_thread, NULL);
 		video->gpu_encode_thread_initialized = false;
 	}
@@ -290,6 +625,10 @@ void free_gpu_encoding(struct obs_core_video_mix *video)
 		os_event_destroy(video->gpu_encode_inactive);
 		video->gpu_encode_inactive = NULL;
 	}
+	if (video->gpu_encoder_frame_released) {
+		os_event_destroy(video->gpu_encoder_frame_released);
+		video->gpu_encoder_frame_released = NULL;
+	}
 
 #define free_deque(x)                                               \
 	do {                                                        \
@@ -29,6 +29,85 @@
 #include <windows.h>
 #endif
 
+static inline bool source_tick_threadsafe(const struct obs_source *source)
+{
+	return (source->info.output_flags & OBS_SOURCE_THREADSAFE_TICK) != 0;
+}
+
+static void tick_source_job(void *param, size_t idx)
+{
+	struct source_tick_job *job = obs->data.parallel_ticks.array + idx;
+	const float *seconds = param;
+
+	job->start = source_profiler_source_tick_start();
+	obs_source_video_tick_finish(job->source, *seconds);
+	job->end = source_profiler_source_tick_start();
+}
+
+static inline void init_tick_pool(struct obs_core_video *video)
+{
+	int cores = os_get_logical_cores();
+	size_t num_threads = cores > 1 ? (size_t)cores - 1 : 0;
+
+	/* ticks are usually short, so more threads than this mostly adds
+	 * wakeup overhead */
+	if (num_threads > 8)
+		num_threads = 8;
+
+	video->tick_pool = os_work_pool_create(num_threads);
+	if (!video->tick_pool) {
+		/* don't retry every frame, the flagged sources just get
+		 * ticked on this thread instead */
+		video->tick_pool_failed = true;
+		blog(LOG_WARNING, "Failed to create source tick pool, ticking sources serially");
+		return;
+	}
+
+	blog(LOG_INFO, "Parallel source tick enabled with %zu worker threads",
+	     os_work_pool_num_threads(video->tick_pool));
+}
+
+/* ticks all sources flagged with OBS_SOURCE_THREADSAFE_TICK on the tick pool.
+ * everything else (including the show/activate state handling of flagged
+ * sources) still happens on the graphics thread, in the usual order. */
+static void tick_sources_parallel(float seconds)
+{
+	struct obs_core_data *data = &obs->data;
+
+	if (!obs->video.tick_pool && !obs->video.tick_pool_failed)
+		init_tick_pool(&obs->video);
+
+	da_clear(data->parallel_ticks);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+		obs_source_t *s = data->sources_to_tick.array[i];
+
+		if (!obs_source_valid(s, "tick_sources_parallel"))
+			continue;
+
+		if (source_tick_threadsafe(s)) {
+			struct source_tick_job job = {.source = s};
+			obs_source_video_tick_prepare(s, seconds);
+			da_push_back(data->parallel_ticks, &job);
+			continue;
+		}
+
+		const uint64_t start = source_profiler_source_tick_start();
+		obs_source_video_tick(s, seconds);
+		source_profiler_source_tick_end(s, start);
+	}
+
+	os_work_pool_run(obs->video.tick_pool, tick_source_job, &seconds, data->parallel_ticks.num);
+
+	for (size_t i = 0; i < data->parallel_ticks.num; i++) {
+		struct source_tick_job *job = data->parallel_ticks.array + i;
+		source_profiler_source_tick_add(job->source, job->start, job->end);
+	}
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_source_release(data->sources_to_tick.array[i]);
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
@@ -75,6 +154,11 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
+	if (os_atomic_load_bool(&obs->video.parallel_tick)) {
+		tick_sources_parallel(seconds);
+		return cur_time;
+	}
+
 	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
 		obs_source_t *s = data->sources_to_tick.array[i];
 		const uint64_t start = source_profiler_source_tick_start();
@@ -640,6 +640,8 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 		return OBS_VIDEO_FAIL;
 	}
 
+	video_output_set_threaded_inputs(video->video, os_atomic_load_bool(&obs->video.threaded_video_inputs));
+
 	if (pthread_mutex_init(&video->gpu_encoder_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
 
@@ -848,6 +850,10 @@ static void obs_free_video(void)
 	pthread_mutex_destroy(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	deque_free(&obs->video.tasks);
+
+	os_work_pool_destroy(obs->video.tick_pool);
+	obs->video.tick_pool = NULL;
+	obs->video.tick_pool_failed = false;
 }
 
 static void obs_free_graphics(void)
@@ -967,6 +973,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init_recursive(&obs->data.canvases_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init(&obs->data.packet_buses_mutex, NULL) != 0)
+		goto fail;
 
 	data->sources = NULL;
 	data->public_sources = NULL;
@@ -1045,6 +1053,7 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
 	pthread_mutex_destroy(&data->canvases_mutex);
+	pthread_mutex_destroy(&data->packet_buses_mutex);
 	da_free(data->draw_callbacks);
 	da_free(data->rendered_callbacks);
 	da_free(data->tick_callbacks);
@@ -1054,6 +1063,8 @@ static void obs_free_data(void)
 		bfree(data->protocols.array[i]);
 	da_free(data->protocols);
 	da_free(data->sources_to_tick);
+	da_free(data->parallel_ticks);
+	da_free(data->packet_buses);
 }
 
 static const char *obs_signals[] = {
@@ -1450,6 +1461,8 @@ void obs_shutdown(void)
 	obs = NULL;
 	bfree(cmdline_args.argv);
 
+	packet_pool_trim();
+
 #ifdef _WIN32
 	if (com_initialized)
 		uninitialize_com();
@@ -2863,6 +2876,50 @@ uint64_t obs_get_video_frame_time(void)
 	return obs->video.video_time;
 }
 
+void obs_set_parallel_source_tick(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->video.parallel_tick, enable);
+}
+
+bool obs_parallel_source_tick_enabled(void)
+{
+	return obs ? os_atomic_load_bool(&obs->video.parallel_tick) : false;
+}
+
+void obs_set_threaded_video_inputs(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->video.threaded_video_inputs, enable);
+
+	pthread_mutex_lock(&obs->video.mixes_mutex);
+	for (size_t i = 0; i < obs->video.mixes.num; i++)
+		video_output_set_threaded_inputs(obs->video.mixes.array[i]->video, enable);
+	pthread_mutex_unlock(&obs->video.mixes_mutex);
+}
+
+bool obs_threaded_video_inputs_enabled(void)
+{
+	return obs ? os_atomic_load_bool(&obs->video.threaded_video_inputs) : false;
+}
+
+void obs_set_threaded_gpu_encode(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->video.threaded_gpu_encode, enable);
+}
+
+bool obs_threaded_gpu_encode_enabled(void)
+{
+	return obs ? os_atomic_load_bool(&obs->video.threaded_gpu_encode) : false;
+}
+
 double obs_get_active_fps(void)
 {
 	return obs->video.video_fps;
@@ -3144,6 +3201,8 @@ obs_data_t *obs_get_private_data(void)
 extern bool init_gpu_encoding(struct obs_core_video_mix *video);
 extern void stop_gpu_encoding_thread(struct obs_core_video_mix *video);
 extern void free_gpu_encoding(struct obs_core_video_mix *video);
+extern void start_gpu_encode_worker(struct obs_core_video_mix *video, obs_encoder_t *encoder);
+extern void stop_gpu_encode_worker(obs_encoder_t *encoder);
 
 bool start_gpu_encode(obs_encoder_t *encoder)
 {
@@ -3155,10 +3214,12 @@ bool start_gpu_encode(obs_encoder_t *encoder)
 
 	if (!video->gpu_encoders.num)
 		success = init_gpu_encoding(video);
-	if (success)
+	if (success) {
+		start_gpu_encode_worker(video, encoder);
 		da_push_back(video->gpu_encoders, &encoder);
-	else
+	} else {
 		free_gpu_encoding(video);
+	}
 
 	pthread_mutex_unlock(&video->gpu_encoder_mutex);
 	obs_leave_graphics();
@@ -3186,6 +3247,7 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&video->gpu_encoder_mutex);
 
 	os_event_wait(video->gpu_encode_inactive);
+	stop_gpu_encode_worker(encoder);
 
 	if (call_free) {
 		stop_gpu_encoding_thread(video);
@@ -3198,6 +3260,23 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 	}
 }
 
+bool obs_get_gpu_encode_stats(video_t *v, struct obs_gpu_encode_stats *stats)
+{
+	struct obs_core_video_mix *video;
+
+	if (!obs_ptr_valid(stats, "obs_get_gpu_encode_stats"))
+		return false;
+
+	video = get_mix_for_video(v);
+	if (!video)
+		return false;
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	*stats = video->gpu_encode_stats;
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+	return true;
+}
+
 bool obs_video_active(void)
 {
 	bool result = false;
@@ -192,6 +192,7 @@ struct obs_video_info {
 #ifndef SWIG
 	/**
 	 * Graphics module to use (usually "libobs-opengl" or "libobs-d3d11")
+	 * or "libobs-null" to render on the CPU when running headless
 	 */
 	const char *graphics_module;
 #endif
@@ -300,6 +301,7 @@ struct obs_source_frame {
 	/* used internally by libobs */
 	volatile long refs;
 	bool prev_frame;
+	bool external;
 };
 
 struct obs_source_frame2 {
@@ -906,6 +908,54 @@ EXPORT void obs_remove_raw_audio_callback(size_t mix_idx, audio_output_callback_
 
 EXPORT uint64_t obs_get_video_frame_time(void);
 
+/**
+ * Enables calling the video_tick callbacks of sources flagged with
+ * OBS_SOURCE_THREADSAFE_TICK from a pool of threads instead of only from the
+ * graphics thread.  Disabled by default.
+ */
+EXPORT void obs_set_parallel_source_tick(bool enable);
+EXPORT bool obs_parallel_source_tick_enabled(void);
+
+/**
+ * Gives every raw video callback and CPU encoder connected to the video
+ * outputs of the core its own thread and a small frame queue, so that one slow
+ * consumer doesn't delay the others.  Applies to consumers connected after
+ * the call.  Disabled by default.
+ */
+EXPORT void obs_set_threaded_video_inputs(bool enable);
+EXPORT bool obs_threaded_video_inputs_enabled(void);
+
+/**
+ * Gives every texture-based encoder its own thread to submit frames on,
+ * instead of encoding a frame with each encoder one after another on the GPU
+ * encode thread of its mix.  Takes effect the next time texture encoding of a
+ * mix starts.  Has no effect on Windows, where encoders hand the keyed mutex
+ * of the shared texture on to each other in order.  Disabled by default.
+ */
+EXPORT void obs_set_threaded_gpu_encode(bool enable);
+EXPORT bool obs_threaded_gpu_encode_enabled(void);
+
+struct obs_gpu_encode_stats {
+	/* textures encoded by at least one encoder thread */
+	uint64_t frames;
+
+	/* time from the first to the last encoder being done with a texture,
+	 * i.e. how long textures were held by the slowest encoder */
+	uint64_t encoder_wait_ns;
+	uint64_t max_encoder_wait_ns;
+
+	/* how often and for how long frames waited for a free texture */
+	uint64_t texture_waits;
+	uint64_t texture_wait_ns;
+};
+
+/**
+ * Gets the threaded GPU encoding counters of the mix that outputs to video
+ * since texture encoding of it last started.  Returns false if there is no
+ * such mix.
+ */
+EXPORT bool obs_get_gpu_encode_stats(video_t *video, struct obs_gpu_encode_stats *stats);
+
 EXPORT double obs_get_active_fps(void);
 EXPORT uint64_t obs_get_average_frame_time_ns(void);
 EXPORT uint64_t obs_get_frame_interval_ns(void);
@@ -1409,6 +1459,26 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y, uint32_t cx, uint
 EXPORT void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame);
 EXPORT void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame);
 
+/**
+ * Called once libobs no longer references a frame passed to
+ * obs_source_output_video3, after which its data may be reused.  Can be
+ * called from any thread, including from within obs_source_output_video3
+ * for previously output frames, but never with libobs locks held.
+ */
+typedef void (*obs_source_frame_release_t)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  The plane pointers
+ * must stay valid until release is called, which happens once the frame has
+ * been uploaded to a texture or dropped.  release is always called exactly
+ * once, even if the frame is rejected.
+ *
+ * Async filters that hold on to frames (e.g. a video delay) keep the
+ * producer's buffers referenced for as long as they do.
+ */
+EXPORT void obs_source_output_video3(obs_source_t *source, const struct obs_source_frame2 *frame,
+				     obs_source_frame_release_t release, void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source, const struct obs_source_cea_708 *captions);
@@ -1932,6 +2002,29 @@ EXPORT uint32_t obs_output_get_delay(const obs_output_t *output);
 /** If delay is active, gets the currently active delay value, in seconds. */
 EXPORT uint32_t obs_output_get_active_delay(const obs_output_t *output);
 
+/**
+ * Limits the memory used by delayed packet data.  Packets that don't fit into
+ * the limit are written to files in spill_dir and read back before they're
+ * sent.  A limit of 0 or an empty spill_dir keeps all packets in memory.
+ */
+EXPORT void obs_output_set_delay_memory_limit(obs_output_t *output, uint64_t limit_bytes, const char *spill_dir);
+
+/** Memory and disk usage of the output delay */
+struct obs_output_delay_stats {
+	/** Packet data currently held in memory, in bytes */
+	uint64_t resident_bytes;
+	/** Packet data currently handed to the spill thread, in bytes */
+	uint64_t spilled_bytes;
+	uint64_t peak_resident_bytes;
+	uint64_t peak_spilled_bytes;
+	/** All packet data ever handed to the spill thread, in bytes */
+	uint64_t total_spilled_bytes;
+	uint32_t resident_packets;
+	uint32_t spilled_packets;
+};
+
+EXPORT void obs_output_get_delay_stats(obs_output_t *output, struct obs_output_delay_stats *stats);
+
 /** Forces the output to stop.  Usually only used with delay. */
 EXPORT void obs_output_force_stop(obs_output_t *output);
 
@@ -2438,6 +2531,120 @@ EXPORT uint32_t obs_encoder_get_caps(const obs_encoder_t *encoder);
 EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst, struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+/** Statistics of the pool that encoder packet data is allocated from */
+struct obs_encoder_packet_pool_stats {
+	/** Packets whose data reused memory from the pool */
+	uint64_t hits;
+	/** Packets whose data needed newly allocated memory */
+	uint64_t misses;
+	/** Memory held by the pool for reuse, in bytes */
+	uint64_t bytes_held;
+	/** Memory of pooled packet data that is still referenced, in bytes */
+	uint64_t bytes_in_use;
+};
+
+EXPORT void obs_encoder_packet_pool_get_stats(struct obs_encoder_packet_pool_stats *stats);
+
+/** What an asynchronous encoder does with a new frame when its queue is full */
+enum obs_encoder_overflow {
+	/** Drop the oldest queued frame, unless it has to be encoded */
+	OBS_ENCODER_OVERFLOW_DROP_OLDEST,
+	/** Wait for the encoder to take a frame off the queue */
+	OBS_ENCODER_OVERFLOW_BLOCK,
+	/** Drop the new frame */
+	OBS_ENCODER_OVERFLOW_SKIP,
+};
+
+/** Statistics of an asynchronous encoder's frame queue */
+struct obs_encoder_async_stats {
+	/** Whether the encoder runs on its own thread */
+	bool async;
+	/** Frames the queue holds before the overflow policy applies */
+	uint32_t queue_size;
+	/** Frames currently queued, and the most that have been queued */
+	uint32_t queue_depth;
+	uint32_t max_queue_depth;
+
+	/** Frames queued for encoding, and frames the encoder has taken */
+	uint64_t queued_frames;
+	uint64_t encoded_frames;
+	/** Queued frames dropped for newer ones (DROP_OLDEST) */
+	uint64_t dropped_frames;
+	/** New frames dropped because the queue was full (SKIP) */
+	uint64_t skipped_frames;
+	/** New frames that had to wait for space in the queue (BLOCK), and
+	 * the total time spent waiting in nanoseconds */
+	uint64_t blocked_frames;
+	uint64_t blocked_ns;
+
+	/** Time from queueing a frame to its encode request (FER) in
+	 * nanoseconds: of the last frame, average and maximum */
+	uint64_t last_queue_ns;
+	uint64_t avg_queue_ns;
+	uint64_t max_queue_ns;
+	/** Time from encode request to encode request complete (FERC) in
+	 * nanoseconds: of the last frame, average and maximum */
+	uint64_t last_encode_ns;
+	uint64_t avg_encode_ns;
+	uint64_t max_encode_ns;
+};
+
+/**
+ * Runs the encoder's encode calls on a thread of its own, fed by a queue of
+ * up to queue_size raw frames, instead of on the video/audio output thread
+ * that produces the frames.  overflow decides what happens to new frames when
+ * the queue is full.  Audio encoders always use OBS_ENCODER_OVERFLOW_BLOCK,
+ * as dropping audio would leave gaps.  Encoders that encode textures are not
+ * affected.
+ *
+ * Can only be changed while the encoder is not active.  Returns false if the
+ * encoder is active.
+ */
+EXPORT bool obs_encoder_set_async(obs_encoder_t *encoder, bool async, size_t queue_size,
+				  enum obs_encoder_overflow overflow);
+EXPORT bool obs_encoder_async(const obs_encoder_t *encoder);
+EXPORT bool obs_encoder_get_async_stats(const obs_encoder_t *encoder, struct obs_encoder_async_stats *stats);
+
+/** Distribution of a per-frame or per-packet value of an encoder */
+struct obs_encoder_distribution {
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t mean;
+	/** 50th, 90th, 99th and 99.9th percentile, within 1/64th */
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+};
+
+/** Encode timing and packet size statistics of an encoder */
+struct obs_encoder_stats {
+	/** Time covered by the statistics, since the encoder was created or
+	 * the statistics were last reset, in nanoseconds */
+	uint64_t duration_ns;
+	/** From frame encode request to encode request complete (FER to
+	 * FERC), in nanoseconds */
+	struct obs_encoder_distribution encode_ns;
+	/** From the frame's composition time to its frame encode request
+	 * (CTS to FER), in nanoseconds.  Video encoders only. */
+	struct obs_encoder_distribution queue_ns;
+	/** Sizes of keyframe packets, in bytes.  Video encoders only. */
+	struct obs_encoder_distribution keyframe_bytes;
+	/** Sizes of all other packets, in bytes */
+	struct obs_encoder_distribution frame_bytes;
+};
+
+/** Gets the encoder's statistics since it was created or last reset */
+EXPORT bool obs_encoder_get_stats(obs_encoder_t *encoder, struct obs_encoder_stats *stats);
+
+/**
+ * Gets the encoder's statistics and resets them in one step, so that
+ * consecutive snapshots cover consecutive intervals without gaps.  stats can
+ * be NULL to only reset them.
+ */
+EXPORT bool obs_encoder_snapshot_stats(obs_encoder_t *encoder, struct obs_encoder_stats *stats);
+
 EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder, const char *reroute_id);
 
 /** Returns whether encoder is paused */
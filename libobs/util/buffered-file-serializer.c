@@ -14,6 +14,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "buffered-file-serializer.h"
 
 #include <inttypes.h>
@@ -23,9 +27,28 @@
 #include "deque.h"
 #include "dstr.h"
 
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "uring-writer.h"
+#endif
+
 static const size_t DEFAULT_BUF_SIZE = 256ULL * 1048576ULL; // 256 MiB
 static const size_t DEFAULT_CHUNK_SIZE = 1048576;           // 1 MiB
 
+#ifndef _WIN32
+static inline size_t max(size_t a, size_t b)
+{
+	return a > b ? a : b;
+}
+
+static inline size_t min(size_t a, size_t b)
+{
+	return a < b ? a : b;
+}
+#endif
+
 /* ========================================================================== */
 /* Buffered writer based on ffmpeg-mux implementation                         */
 
@@ -34,6 +57,21 @@ struct io_header {
 	uint64_t data_length;
 };
 
+/* set in data_length when the header is followed by an io_ref to data
+ * written with writev instead of the data itself */
+#define IO_REF_FLAG (1ULL << 63)
+
+struct io_ref {
+	const uint8_t *data;
+	void (*release)(void *param);
+	void *param;
+};
+
+static inline size_t io_length(const struct io_header *header)
+{
+	return (size_t)(header->data_length & ~IO_REF_FLAG);
+}
+
 struct io_buffer {
 	bool active;
 	bool shutdown_requested;
@@ -46,8 +84,20 @@ struct io_buffer {
 	struct deque data;
 	uint64_t next_pos;
 
+	/* data of writev calls still queued, counts against buffer_size */
+	size_t ref_bytes;
+
 	size_t buffer_size;
 	size_t chunk_size;
+
+#ifdef __linux__
+	/* used instead of output_file when writing through io_uring, with
+	 * O_DIRECT the writes that aren't aligned go to buffered_fd */
+	struct uring_writer *uring;
+	int fd;
+	int buffered_fd;
+	bool direct;
+#endif
 };
 
 struct file_output_data {
@@ -55,6 +105,59 @@ struct file_output_data {
 	struct io_buffer io;
 };
 
+/* Copies len bytes of the write at the front of the deque, whose header was
+ * already removed, and puts the header of the rest of the write back */
+static void pop_write_data(struct io_buffer *io, struct io_header *header, uint8_t *dst, size_t len)
+{
+	struct io_ref ref;
+
+	if (!(header->data_length & IO_REF_FLAG)) {
+		deque_pop_front(&io->data, dst, len);
+		if (len < io_length(header)) {
+			header->seek_offset += len;
+			header->data_length -= len;
+			deque_push_front(&io->data, header, sizeof(*header));
+		}
+		return;
+	}
+
+	deque_pop_front(&io->data, &ref, sizeof(ref));
+	memcpy(dst, ref.data, len);
+	io->ref_bytes -= len;
+
+	if (len < io_length(header)) {
+		header->seek_offset += len;
+		header->data_length -= len;
+		ref.data += len;
+		deque_push_front(&io->data, &ref, sizeof(ref));
+		deque_push_front(&io->data, header, sizeof(*header));
+	} else if (ref.release) {
+		ref.release(ref.param);
+	}
+}
+
+/* releases writev data that was never written */
+static void release_pending(struct io_buffer *io)
+{
+	while (io->data.size) {
+		struct io_header header;
+		struct io_ref ref;
+
+		deque_pop_front(&io->data, &header, sizeof(header));
+
+		if (!(header.data_length & IO_REF_FLAG)) {
+			deque_pop_front(&io->data, NULL, io_length(&header));
+			continue;
+		}
+
+		deque_pop_front(&io->data, &ref, sizeof(ref));
+		if (ref.release)
+			ref.release(ref.param);
+	}
+
+	io->ref_bytes = 0;
+}
+
 static void *io_thread(void *opaque)
 {
 	struct file_output_data *out = opaque;
@@ -126,9 +229,11 @@ static void *io_thread(void *opaque)
 					current_seek_position = header.seek_offset;
 				}
 
+				size_t length = io_length(&header);
+
 				// Make sure there's enough room for the data, if
 				// not then force a flush
-				if (header.data_length + chunk_used > chunk_size) {
+				if (length + chunk_used > chunk_size) {
 					force_flush_chunk = true;
 					break;
 				}
@@ -137,11 +242,11 @@ static void *io_thread(void *opaque)
 				deque_pop_front(&out->io.data, NULL, sizeof(header));
 
 				// Copy from the buffer to our local chunk
-				deque_pop_front(&out->io.data, chunk + chunk_used, header.data_length);
+				pop_write_data(&out->io, &header, chunk + chunk_used, length);
 
 				// Update offsets
-				chunk_used += header.data_length;
-				current_seek_position += header.data_length;
+				chunk_used += length;
+				current_seek_position += length;
 			}
 
 			// Signal that there is more room in the buffer
@@ -196,6 +301,9 @@ static void *io_thread(void *opaque)
 	}
 
 error:
+	// Don't leave writers waiting for space
+	os_event_signal(out->io.buffer_space_available_event);
+
 	if (chunk)
 		bfree(chunk);
 
@@ -203,6 +311,318 @@ error:
 	return NULL;
 }
 
+#ifdef __linux__
+/* ========================================================================== */
+/* io_uring writer                                                            */
+
+#define URING_DEPTH 8
+#define DIRECT_IO_ALIGN 4096
+
+struct uring_chunk {
+	uint8_t *data;
+	uint64_t pos;
+	size_t used;
+	bool busy;
+};
+
+struct uring_state {
+	struct file_output_data *out;
+	struct uring_chunk chunks[URING_DEPTH];
+	struct uring_chunk *cur;
+	size_t chunk_size;
+
+	/* end of the data taken into chunks so far, a chunk that doesn't start
+	 * there follows a seek, so it may overlap writes still in flight and
+	 * has to wait for them */
+	uint64_t end_pos;
+	bool after_seek;
+};
+
+static bool pwrite_all(struct file_output_data *out, int fd, const uint8_t *data, size_t size, uint64_t pos)
+{
+	while (size) {
+		ssize_t ret = pwrite(fd, data, size, (off_t)pos);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			blog(LOG_ERROR, "Error writing to '%s': %s", out->filename.array, strerror(errno));
+			return false;
+		}
+
+		data += ret;
+		size -= (size_t)ret;
+		pos += (uint64_t)ret;
+	}
+
+	return true;
+}
+
+static inline int sync_fd(struct file_output_data *out)
+{
+	return out->io.direct ? out->io.buffered_fd : out->io.fd;
+}
+
+static bool uring_reap(struct uring_state *st)
+{
+	struct file_output_data *out = st->out;
+	struct uring_chunk *chunk;
+	void *param;
+	int64_t result;
+
+	if (!uring_writer_wait(out->io.uring, &param, &result)) {
+		blog(LOG_ERROR, "Error waiting for writes to '%s'", out->filename.array);
+		return false;
+	}
+
+	chunk = param;
+	chunk->busy = false;
+
+	if (result < 0) {
+		blog(LOG_ERROR, "Error writing to '%s': %s", out->filename.array, strerror((int)-result));
+		return false;
+	}
+
+	/* finish short writes synchronously, they're rare */
+	if ((size_t)result < chunk->used)
+		return pwrite_all(out, sync_fd(out), chunk->data + result, chunk->used - (size_t)result,
+				  chunk->pos + (uint64_t)result);
+
+	return true;
+}
+
+static bool uring_drain(struct uring_state *st)
+{
+	while (uring_writer_in_flight(st->out->io.uring)) {
+		if (!uring_reap(st))
+			return false;
+	}
+
+	return true;
+}
+
+static bool uring_submit_chunk(struct uring_state *st)
+{
+	struct file_output_data *out = st->out;
+	struct uring_chunk *chunk = st->cur;
+	bool after_seek = st->after_seek;
+
+	if (!chunk->used)
+		return true;
+
+	st->after_seek = false;
+
+	/* O_DIRECT needs aligned positions and sizes, which only the partial
+	 * chunks around seeks and at the end of the file don't have */
+	if (out->io.direct && (chunk->pos % DIRECT_IO_ALIGN || chunk->used % DIRECT_IO_ALIGN)) {
+		if (!uring_drain(st))
+			return false;
+		if (!pwrite_all(out, out->io.buffered_fd, chunk->data, chunk->used, chunk->pos))
+			return false;
+
+		chunk->used = 0;
+		return true;
+	}
+
+	if (!uring_writer_submit(out->io.uring, chunk->data, chunk->used, chunk->pos, after_seek, chunk)) {
+		if (!uring_drain(st))
+			return false;
+		if (!pwrite_all(out, sync_fd(out), chunk->data, chunk->used, chunk->pos))
+			return false;
+
+		chunk->used = 0;
+		return true;
+	}
+
+	chunk->busy = true;
+	return true;
+}
+
+static bool uring_next_chunk(struct uring_state *st)
+{
+	for (;;) {
+		for (size_t i = 0; i < URING_DEPTH; i++) {
+			struct uring_chunk *chunk = &st->chunks[i];
+
+			if (!chunk->busy) {
+				chunk->used = 0;
+				st->cur = chunk;
+				return true;
+			}
+		}
+
+		if (!uring_reap(st))
+			return false;
+	}
+}
+
+/* A chunk starting at an unaligned position after a seek ends at the next
+ * aligned one, so only that chunk has to be written synchronously with O_DIRECT
+ * and the ones after it are aligned again. */
+static inline size_t uring_chunk_capacity(const struct uring_state *st, const struct uring_chunk *chunk)
+{
+	return st->chunk_size - (size_t)(chunk->pos % DIRECT_IO_ALIGN);
+}
+
+/* Takes writes from the deque into the current chunk until it's full or the
+ * next write isn't contiguous, returns true if the chunk should be written.
+ * Seeks back into data the chunk still holds, like size fields patched by the
+ * muxer, are copied into the chunk instead. */
+static bool uring_fill_chunk(struct uring_state *st)
+{
+	struct file_output_data *out = st->out;
+	struct uring_chunk *chunk = st->cur;
+
+	while (out->io.data.size) {
+		struct io_header header;
+		size_t len;
+
+		deque_peek_front(&out->io.data, &header, sizeof(header));
+
+		if (!chunk->used) {
+			chunk->pos = header.seek_offset;
+			if (chunk->pos != st->end_pos)
+				st->after_seek = true;
+		}
+
+		if (header.seek_offset != chunk->pos + chunk->used) {
+			if (header.seek_offset >= chunk->pos &&
+			    header.seek_offset + io_length(&header) <= chunk->pos + chunk->used) {
+				deque_pop_front(&out->io.data, NULL, sizeof(header));
+				pop_write_data(&out->io, &header, chunk->data + (header.seek_offset - chunk->pos),
+					       io_length(&header));
+				continue;
+			}
+
+			return true;
+		}
+
+		/* the rest of the write goes into the next chunk */
+		len = min(uring_chunk_capacity(st, chunk) - chunk->used, io_length(&header));
+
+		deque_pop_front(&out->io.data, NULL, sizeof(header));
+		pop_write_data(&out->io, &header, chunk->data + chunk->used, len);
+		chunk->used += len;
+		st->end_pos = chunk->pos + chunk->used;
+
+		if (chunk->used == uring_chunk_capacity(st, chunk))
+			return true;
+	}
+
+	return false;
+}
+
+static void *uring_io_thread(void *opaque)
+{
+	struct file_output_data *out = opaque;
+	struct uring_state st = {.out = out};
+	bool shutting_down;
+
+	os_set_thread_name("buffered writer i/o thread");
+
+	st.chunk_size = (out->io.chunk_size + DIRECT_IO_ALIGN - 1) & ~(size_t)(DIRECT_IO_ALIGN - 1);
+
+	for (size_t i = 0; i < URING_DEPTH; i++) {
+		if (posix_memalign((void **)&st.chunks[i].data, DIRECT_IO_ALIGN, st.chunk_size) != 0) {
+			st.chunks[i].data = NULL;
+			blog(LOG_ERROR, "Error allocating memory for output");
+			goto error;
+		}
+	}
+
+	st.cur = &st.chunks[0];
+
+	for (;;) {
+		os_event_wait(out->io.new_data_available_event);
+
+		for (;;) {
+			pthread_mutex_lock(&out->io.data_mutex);
+
+			shutting_down = os_atomic_load_bool(&out->io.shutdown_requested);
+			bool write_chunk = uring_fill_chunk(&st);
+
+			os_event_signal(out->io.buffer_space_available_event);
+
+			/* unlike the stdio writer, partial chunks are kept until
+			 * they're full so writes stay large and aligned */
+			if (!write_chunk) {
+				os_event_reset(out->io.new_data_available_event);
+				pthread_mutex_unlock(&out->io.data_mutex);
+				break;
+			}
+
+			pthread_mutex_unlock(&out->io.data_mutex);
+
+			if (!uring_submit_chunk(&st) || !uring_next_chunk(&st))
+				goto error;
+		}
+
+		if (shutting_down)
+			break;
+	}
+
+	if (!uring_submit_chunk(&st) || !uring_drain(&st))
+		goto error;
+
+	if (out->io.direct)
+		fsync(out->io.fd);
+
+	goto finish;
+
+error:
+	os_atomic_set_bool(&out->io.output_error, true);
+	os_event_signal(out->io.buffer_space_available_event);
+
+finish:
+	/* waits for anything still in flight before the chunks are freed, if
+	 * that fails the kernel may still read from them, so they're leaked */
+	if (uring_writer_destroy(out->io.uring)) {
+		for (size_t i = 0; i < URING_DEPTH; i++)
+			free(st.chunks[i].data);
+	}
+	out->io.uring = NULL;
+
+	close(out->io.fd);
+	if (out->io.buffered_fd != -1)
+		close(out->io.buffered_fd);
+	return NULL;
+}
+
+static bool uring_open(struct file_output_data *out, const char *path, bool direct)
+{
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	out->io.fd = -1;
+	out->io.buffered_fd = -1;
+
+	/* not every file system supports O_DIRECT */
+	if (direct)
+		out->io.fd = open(path, flags | O_DIRECT, 0666);
+	if (out->io.fd != -1) {
+		out->io.direct = true;
+		out->io.buffered_fd = open(path, O_WRONLY | O_CLOEXEC);
+		if (out->io.buffered_fd == -1)
+			goto fail;
+	} else {
+		out->io.fd = open(path, flags, 0666);
+		if (out->io.fd == -1)
+			return false;
+	}
+
+	out->io.uring = uring_writer_create(out->io.fd, URING_DEPTH);
+	if (!out->io.uring)
+		goto fail;
+
+	return true;
+
+fail:
+	close(out->io.fd);
+	if (out->io.buffered_fd != -1)
+		close(out->io.buffered_fd);
+	out->io.direct = false;
+	return false;
+}
+#endif
+
 /* ========================================================================== */
 /* Serializer Implementation                                                  */
 
@@ -234,18 +654,6 @@ static int64_t file_output_seek(void *opaque, int64_t offset, enum serialize_see
 	return (int64_t)out->io.next_pos;
 }
 
-#ifndef _WIN32
-static inline size_t max(size_t a, size_t b)
-{
-	return a > b ? a : b;
-}
-
-static inline size_t min(size_t a, size_t b)
-{
-	return a < b ? a : b;
-}
-#endif
-
 static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 {
 	struct file_output_data *out = opaque;
@@ -267,7 +675,8 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 
 		// Avoid unbounded growth of the deque, cap to buffer_size
 		size_t cap = max(out->io.data.capacity, out->io.buffer_size);
-		size_t free_space = cap - out->io.data.size;
+		size_t used = out->io.data.size + out->io.ref_bytes;
+		size_t free_space = cap > used ? cap - used : 0;
 
 		if (free_space < next_chunk_size + sizeof(struct io_header)) {
 			blog(LOG_DEBUG, "Waiting for I/O thread...");
@@ -309,6 +718,68 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 	return buf_size - remaining;
 }
 
+static size_t file_output_writev(void *opaque, const struct serializer_iovec *vec, size_t count)
+{
+	struct file_output_data *out = opaque;
+	size_t total = 0;
+
+	pthread_mutex_lock(&out->io.data_mutex);
+
+	for (size_t i = 0; i < count; i++) {
+		const uint8_t *data = vec[i].data;
+		size_t remaining = vec[i].size;
+
+		// Wait for the I/O thread if the data referenced so far
+		// already fills the buffer
+		while (remaining && out->io.ref_bytes && out->io.ref_bytes + remaining > out->io.buffer_size &&
+		       !os_atomic_load_bool(&out->io.output_error)) {
+			os_event_reset(out->io.buffer_space_available_event);
+			os_event_signal(out->io.new_data_available_event);
+			pthread_mutex_unlock(&out->io.data_mutex);
+			os_event_wait(out->io.buffer_space_available_event);
+			pthread_mutex_lock(&out->io.data_mutex);
+		}
+
+		if (!remaining || os_atomic_load_bool(&out->io.output_error)) {
+			if (vec[i].release)
+				vec[i].release(vec[i].param);
+			continue;
+		}
+
+		// Queue references in pieces of at most chunk_size bytes,
+		// the data is released with the last one
+		while (remaining) {
+			size_t size = min(remaining, out->io.chunk_size);
+			struct io_header header = {
+				.seek_offset = out->io.next_pos,
+				.data_length = size | IO_REF_FLAG,
+			};
+			struct io_ref ref = {.data = data};
+
+			remaining -= size;
+			data += size;
+
+			if (!remaining) {
+				ref.release = vec[i].release;
+				ref.param = vec[i].param;
+			}
+
+			deque_push_back(&out->io.data, &header, sizeof(header));
+			deque_push_back(&out->io.data, &ref, sizeof(ref));
+
+			out->io.next_pos += size;
+			out->io.ref_bytes += size;
+		}
+
+		total += vec[i].size;
+	}
+
+	os_event_signal(out->io.new_data_available_event);
+	pthread_mutex_unlock(&out->io.data_mutex);
+
+	return total;
+}
+
 static int64_t file_output_get_pos(void *opaque)
 {
 	struct file_output_data *out = opaque;
@@ -325,18 +796,35 @@ bool buffered_file_serializer_init_defaults(struct serializer *s, const char *pa
 }
 
 bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize, size_t chunk_size)
+{
+	return buffered_file_serializer_init2(s, path, max_bufsize, chunk_size, 0);
+}
+
+bool buffered_file_serializer_init2(struct serializer *s, const char *path, size_t max_bufsize, size_t chunk_size,
+				    uint32_t flags)
 {
 	struct file_output_data *out;
+	void *(*thread_func)(void *) = io_thread;
 
 	out = bzalloc(sizeof(*out));
 
 	dstr_init_copy(&out->filename, path);
 
-	out->io.output_file = os_fopen(path, "wb");
-	if (!out->io.output_file) {
-		dstr_free(&out->filename);
-		bfree(out);
-		return false;
+#ifdef __linux__
+	if ((flags & BUFFERED_FILE_SERIALIZER_IO_URING) &&
+	    uring_open(out, path, (flags & BUFFERED_FILE_SERIALIZER_DIRECT_IO) != 0)) {
+		thread_func = uring_io_thread;
+		blog(LOG_DEBUG, "Writing '%s' through io_uring%s", path, out->io.direct ? " with O_DIRECT" : "");
+	}
+#endif
+
+	if (thread_func == io_thread) {
+		out->io.output_file = os_fopen(path, "wb");
+		if (!out->io.output_file) {
+			dstr_free(&out->filename);
+			bfree(out);
+			return false;
+		}
 	}
 
 	out->io.buffer_size = max_bufsize ? max_bufsize : DEFAULT_BUF_SIZE;
@@ -351,7 +839,7 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 	os_event_init(&out->io.buffer_space_available_event, OS_EVENT_TYPE_AUTO);
 	os_event_init(&out->io.new_data_available_event, OS_EVENT_TYPE_AUTO);
 
-	pthread_create(&out->io.io_thread, NULL, io_thread, out);
+	pthread_create(&out->io.io_thread, NULL, thread_func, out);
 
 	out->io.active = true;
 
@@ -360,6 +848,7 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 	s->write = file_output_write;
 	s->seek = file_output_seek;
 	s->get_pos = file_output_get_pos;
+	s->writev = file_output_writev;
 	return true;
 }
 
@@ -386,6 +875,8 @@ void buffered_file_serializer_free(struct serializer *s)
 
 		blog(LOG_DEBUG, "Final buffer capacity: %zu KiB", out->io.data.capacity / 1024);
 
+		release_pending(&out->io);
+
 		deque_free(&out->io.data);
 	}
 
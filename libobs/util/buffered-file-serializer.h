@@ -22,9 +22,17 @@
 extern "C" {
 #endif
 
+/* write through io_uring where available (Linux), otherwise flags are
+ * ignored and stdio is used */
+#define BUFFERED_FILE_SERIALIZER_IO_URING (1 << 0)
+/* with io_uring, bypass the page cache for aligned writes */
+#define BUFFERED_FILE_SERIALIZER_DIRECT_IO (1 << 1)
+
 EXPORT bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path);
 EXPORT bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize,
 					  size_t chunk_size);
+EXPORT bool buffered_file_serializer_init2(struct serializer *s, const char *path, size_t max_bufsize,
+					   size_t chunk_size, uint32_t flags);
 EXPORT void buffered_file_serializer_free(struct serializer *s);
 
 #ifdef __cplusplus
@@ -60,6 +60,7 @@ bool file_input_serializer_init(struct serializer *s, const char *path)
 	s->write = NULL;
 	s->seek = file_input_seek;
 	s->get_pos = file_input_get_pos;
+	s->writev = NULL;
 	return true;
 }
 
@@ -128,6 +129,7 @@ bool file_output_serializer_init(struct serializer *s, const char *path)
 	s->write = file_output_write;
 	s->seek = file_output_seek;
 	s->get_pos = file_output_get_pos;
+	s->writev = NULL;
 	return true;
 }
 
@@ -161,6 +163,7 @@ bool file_output_serializer_init_safe(struct serializer *s, const char *path, co
 	s->write = file_output_write;
 	s->seek = file_output_seek;
 	s->get_pos = file_output_get_pos;
+	s->writev = NULL;
 	return true;
 }
 
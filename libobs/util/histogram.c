@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+#include "bmem.h"
+#include "histogram.h"
+
+#define SUB_BUCKETS (1ULL << HISTOGRAM_SUB_BUCKET_BITS)
+#define HALF_SUB_BUCKETS (SUB_BUCKETS / 2)
+#define NUM_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS + 2) * HALF_SUB_BUCKETS)
+
+static inline int highest_bit(uint64_t value)
+{
+	int bit = 0;
+	while (value >>= 1)
+		bit++;
+	return bit;
+}
+
+/* values below SUB_BUCKETS get a bucket each.  above that, each power of two
+ * range gets HALF_SUB_BUCKETS buckets, every one twice as wide as the buckets
+ * of the range below it */
+static inline size_t bucket_index(uint64_t value)
+{
+	int shift;
+
+	if (value < SUB_BUCKETS)
+		return (size_t)value;
+
+	shift = highest_bit(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+	return (size_t)((shift + 1) * HALF_SUB_BUCKETS + (value >> shift) - HALF_SUB_BUCKETS);
+}
+
+/* the largest value counted in a bucket */
+static inline uint64_t bucket_top(size_t idx)
+{
+	uint64_t shift;
+
+	if (idx < SUB_BUCKETS)
+		return idx;
+
+	shift = idx / HALF_SUB_BUCKETS - 1;
+	return ((idx % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS + 1) << shift) - 1;
+}
+
+void histogram_free(struct histogram *hist)
+{
+	bfree(hist->counts);
+	memset(hist, 0, sizeof(*hist));
+}
+
+void histogram_reset(struct histogram *hist)
+{
+	if (hist->counts && hist->count)
+		memset(hist->counts, 0, NUM_BUCKETS * sizeof(uint64_t));
+
+	hist->count = 0;
+	hist->min = 0;
+	hist->max = 0;
+	hist->sum = 0;
+}
+
+static inline bool ensure_counts(struct histogram *hist)
+{
+	if (!hist->counts)
+		hist->counts = bzalloc(NUM_BUCKETS * sizeof(uint64_t));
+	return hist->counts != NULL;
+}
+
+void histogram_record(struct histogram *hist, uint64_t value)
+{
+	if (!ensure_counts(hist))
+		return;
+
+	if (value > HISTOGRAM_MAX_VALUE)
+		value = HISTOGRAM_MAX_VALUE;
+
+	hist->counts[bucket_index(value)]++;
+
+	if (!hist->count || value < hist->min)
+		hist->min = value;
+	if (value > hist->max)
+		hist->max = value;
+
+	hist->count++;
+	hist->sum += value;
+}
+
+void histogram_add(struct histogram *dst, const struct histogram *src)
+{
+	if (!src->count || !ensure_counts(dst))
+		return;
+
+	for (size_t i = 0; i < NUM_BUCKETS; i++)
+		dst->counts[i] += src->counts[i];
+
+	if (!dst->count || src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+}
+
+uint64_t histogram_percentile(const struct histogram *hist, double percent)
+{
+	double exact;
+	uint64_t target;
+	uint64_t seen = 0;
+
+	if (!hist->count)
+		return 0;
+
+	if (percent <= 0.0)
+		return hist->min;
+	if (percent >= 100.0)
+		return hist->max;
+
+	/* the smallest number of values that covers percent of them */
+	exact = percent / 100.0 * (double)hist->count;
+	target = (uint64_t)exact;
+	if ((double)target < exact || !target)
+		target++;
+
+	for (size_t i = 0; i < NUM_BUCKETS; i++) {
+		seen += hist->counts[i];
+		if (seen >= target) {
+			uint64_t top = bucket_top(i);
+			return top < hist->max ? top : hist->max;
+		}
+	}
+
+	return hist->max;
+}
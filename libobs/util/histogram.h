@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * Log-linear histogram in the style of HdrHistogram.  Each power of two
+ * range of values is split into the same number of buckets, so every value
+ * is counted with the same relative precision (1/64th of the value) while
+ * the memory needed stays fixed no matter how large the values get.
+ *
+ * Values up to 127 are counted exactly, values larger than
+ * HISTOGRAM_MAX_VALUE are counted as HISTOGRAM_MAX_VALUE.  The buckets are
+ * only allocated once the first value is recorded.
+ *
+ * Not thread safe, the caller has to serialize access.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_MAX_VALUE ((1ULL << HISTOGRAM_MAX_BITS) - 1)
+
+struct histogram {
+	uint64_t *counts;
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
+};
+
+EXPORT void histogram_free(struct histogram *hist);
+EXPORT void histogram_reset(struct histogram *hist);
+
+EXPORT void histogram_record(struct histogram *hist, uint64_t value);
+
+/** Adds all values recorded in src to dst */
+EXPORT void histogram_add(struct histogram *dst, const struct histogram *src);
+
+/**
+ * Returns the value that percentile percent (0-100) of the recorded values
+ * are less than or equal to, within the histogram's precision.  Values are
+ * rounded up to the top of their bucket, but never past the largest value.
+ */
+EXPORT uint64_t histogram_percentile(const struct histogram *hist, double percent);
+
+static inline uint64_t histogram_mean(const struct histogram *hist)
+{
+	return hist->count ? hist->sum / hist->count : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,6 +29,15 @@ extern "C" {
 
 enum serialize_seek_type { SERIALIZE_SEEK_START, SERIALIZE_SEEK_CURRENT, SERIALIZE_SEEK_END };
 
+/* data written by reference, release (if set) is called with param once the
+ * serializer doesn't need the data anymore */
+struct serializer_iovec {
+	const void *data;
+	size_t size;
+	void (*release)(void *param);
+	void *param;
+};
+
 struct serializer {
 	void *data;
 
@@ -36,6 +45,9 @@ struct serializer {
 	size_t (*write)(void *, const void *, size_t);
 	int64_t (*seek)(void *, int64_t, enum serialize_seek_type);
 	int64_t (*get_pos)(void *);
+
+	/* optional, takes over the data of all vectors, even on failure */
+	size_t (*writev)(void *, const struct serializer_iovec *, size_t);
 };
 
 static inline size_t s_read(struct serializer *s, void *data, size_t size)
@@ -52,6 +64,24 @@ static inline size_t s_write(struct serializer *s, const void *data, size_t size
 	return 0;
 }
 
+/* writes the vectors in order, and calls their release functions once the
+ * data was written, or right away if the serializer has no writev */
+static inline size_t s_writev(struct serializer *s, const struct serializer_iovec *vec, size_t count)
+{
+	size_t total = 0;
+
+	if (s && s->writev)
+		return s->writev(s->data, vec, count);
+
+	for (size_t i = 0; i < count; i++) {
+		total += s_write(s, vec[i].data, vec[i].size);
+		if (vec[i].release)
+			vec[i].release(vec[i].param);
+	}
+
+	return total;
+}
+
 static inline size_t serialize(struct serializer *s, void *data, size_t len)
 {
 	if (s) {
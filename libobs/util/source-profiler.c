@@ -425,7 +425,15 @@ void source_profiler_source_tick_end(obs_source_t *source, uint64_t start)
 	if (!enabled)
 		return;
 
-	const uint64_t delta = os_gettime_ns() - start;
+	source_profiler_source_tick_add(source, start, os_gettime_ns());
+}
+
+void source_profiler_source_tick_add(obs_source_t *source, uint64_t start, uint64_t end)
+{
+	if (!enabled)
+		return;
+
+	const uint64_t delta = end - start;
 
 	struct source_samples *smp = NULL;
 	HASH_FIND_PTR(hm_samples, &source, smp);
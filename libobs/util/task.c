@@ -2,6 +2,7 @@
 #include "bmem.h"
 #include "threading.h"
 #include "deque.h"
+#include "darray.h"
 
 struct os_task_queue {
 	pthread_t thread;
@@ -162,3 +163,133 @@ static void *tiny_tubular_task_thread(void *param)
 
 	return NULL;
 }
+
+/* ------------------------------------------------------------------------- */
+
+struct os_work_pool {
+	DARRAY(pthread_t) threads;
+	os_sem_t *start_sem;
+	os_sem_t *done_sem;
+	pthread_mutex_t run_mutex;
+
+	os_work_t work;
+	void *param;
+	long count;
+	volatile long next;
+	volatile bool stop;
+};
+
+/* items are claimed one at a time from a shared counter, so threads that
+ * finish their items early simply take over whatever work is left */
+static void work_pool_process(struct os_work_pool *pool)
+{
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&pool->next) - 1) < pool->count)
+		pool->work(pool->param, (size_t)idx);
+}
+
+static void *work_pool_thread(void *param)
+{
+	struct os_work_pool *pool = param;
+
+	os_set_thread_name("libobs: work pool thread");
+
+	while (os_sem_wait(pool->start_sem) == 0) {
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		work_pool_process(pool);
+		os_sem_post(pool->done_sem);
+	}
+
+	return NULL;
+}
+
+os_work_pool_t *os_work_pool_create(size_t num_threads)
+{
+	struct os_work_pool *pool = bzalloc(sizeof(*pool));
+
+	if (pthread_mutex_init(&pool->run_mutex, NULL) != 0)
+		goto fail1;
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		goto fail2;
+	if (os_sem_init(&pool->done_sem, 0) != 0)
+		goto fail3;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, work_pool_thread, pool) != 0)
+			break;
+		da_push_back(pool->threads, &thread);
+	}
+
+	return pool;
+
+fail3:
+	os_sem_destroy(pool->start_sem);
+fail2:
+	pthread_mutex_destroy(&pool->run_mutex);
+fail1:
+	bfree(pool);
+	return NULL;
+}
+
+void os_work_pool_destroy(os_work_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	os_atomic_set_bool(&pool->stop, true);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	da_free(pool->threads);
+	os_sem_destroy(pool->done_sem);
+	os_sem_destroy(pool->start_sem);
+	pthread_mutex_destroy(&pool->run_mutex);
+	bfree(pool);
+}
+
+size_t os_work_pool_num_threads(const os_work_pool_t *pool)
+{
+	return pool ? pool->threads.num : 0;
+}
+
+void os_work_pool_run(os_work_pool_t *pool, os_work_t work, void *param, size_t count)
+{
+	size_t num_threads;
+
+	if (!count)
+		return;
+
+	if (!pool) {
+		for (size_t i = 0; i < count; i++)
+			work(param, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->run_mutex);
+
+	pool->work = work;
+	pool->param = param;
+	pool->count = (long)count;
+	os_atomic_set_long(&pool->next, 0);
+
+	/* no point in waking up more threads than there are items */
+	num_threads = pool->threads.num;
+	if (num_threads > count - 1)
+		num_threads = count - 1;
+
+	for (size_t i = 0; i < num_threads; i++)
+		os_sem_post(pool->start_sem);
+
+	work_pool_process(pool);
+
+	for (size_t i = 0; i < num_threads; i++)
+		os_sem_wait(pool->done_sem);
+
+	pthread_mutex_unlock(&pool->run_mutex);
+}
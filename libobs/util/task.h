@@ -17,6 +17,22 @@ EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/* ------------------------------------------------------------------------- */
+/* work pool: runs a batch of independent work items on a set of threads     */
+
+struct os_work_pool;
+typedef struct os_work_pool os_work_pool_t;
+
+typedef void (*os_work_t)(void *param, size_t idx);
+
+EXPORT os_work_pool_t *os_work_pool_create(size_t num_threads);
+EXPORT void os_work_pool_destroy(os_work_pool_t *pool);
+EXPORT size_t os_work_pool_num_threads(const os_work_pool_t *pool);
+
+/* Calls work(param, idx) for each idx in [0, count) and returns once all
+ * items are done.  The calling thread takes part in the work as well. */
+EXPORT void os_work_pool_run(os_work_pool_t *pool, os_work_t work, void *param, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
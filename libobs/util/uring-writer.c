@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "base.h"
+#include "bmem.h"
+#include "uring-writer.h"
+
+struct uring_writer {
+	int ring_fd;
+	int fd;
+	unsigned int depth;
+	unsigned int in_flight;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+static inline int sys_io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int sys_io_uring_enter(int ring_fd, unsigned int to_submit, unsigned int min_complete,
+				     unsigned int flags)
+{
+	return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void unmap_rings(struct uring_writer *w)
+{
+	if (w->sqes)
+		munmap(w->sqes, w->sqes_size);
+	if (w->cq_ring && w->cq_ring != w->sq_ring)
+		munmap(w->cq_ring, w->cq_ring_size);
+	if (w->sq_ring)
+		munmap(w->sq_ring, w->sq_ring_size);
+}
+
+static bool map_rings(struct uring_writer *w, struct io_uring_params *p)
+{
+	uint8_t *sq, *cq;
+
+	w->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned int);
+	w->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		if (w->cq_ring_size > w->sq_ring_size)
+			w->sq_ring_size = w->cq_ring_size;
+		w->cq_ring_size = w->sq_ring_size;
+	}
+
+	w->sq_ring = mmap(NULL, w->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd,
+			  IORING_OFF_SQ_RING);
+	if (w->sq_ring == MAP_FAILED) {
+		w->sq_ring = NULL;
+		return false;
+	}
+
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		w->cq_ring = w->sq_ring;
+	} else {
+		w->cq_ring = mmap(NULL, w->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				  w->ring_fd, IORING_OFF_CQ_RING);
+		if (w->cq_ring == MAP_FAILED) {
+			w->cq_ring = NULL;
+			return false;
+		}
+	}
+
+	w->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+	w->sqes = mmap(NULL, w->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd,
+		       IORING_OFF_SQES);
+	if (w->sqes == MAP_FAILED) {
+		w->sqes = NULL;
+		return false;
+	}
+
+	sq = w->sq_ring;
+	w->sq_head = (unsigned int *)(sq + p->sq_off.head);
+	w->sq_tail = (unsigned int *)(sq + p->sq_off.tail);
+	w->sq_mask = (unsigned int *)(sq + p->sq_off.ring_mask);
+	w->sq_array = (unsigned int *)(sq + p->sq_off.array);
+
+	cq = w->cq_ring;
+	w->cq_head = (unsigned int *)(cq + p->cq_off.head);
+	w->cq_tail = (unsigned int *)(cq + p->cq_off.tail);
+	w->cq_mask = (unsigned int *)(cq + p->cq_off.ring_mask);
+	w->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+	return true;
+}
+
+struct uring_writer *uring_writer_create(int fd, unsigned int depth)
+{
+	struct io_uring_params p = {0};
+	struct uring_writer *w;
+	int ring_fd;
+
+	ring_fd = sys_io_uring_setup(depth, &p);
+	if (ring_fd < 0)
+		return NULL;
+
+	/* IORING_OP_WRITE came with the same kernel version as this flag */
+	if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+		close(ring_fd);
+		return NULL;
+	}
+
+	w = bzalloc(sizeof(*w));
+	w->ring_fd = ring_fd;
+	w->fd = fd;
+	w->depth = p.sq_entries < depth ? p.sq_entries : depth;
+
+	if (!map_rings(w, &p)) {
+		uring_writer_destroy(w);
+		return NULL;
+	}
+
+	return w;
+}
+
+bool uring_writer_destroy(struct uring_writer *w)
+{
+	if (!w)
+		return true;
+
+	/* the kernel reads from the buffers of writes in flight until they
+	 * complete, and closing the ring doesn't wait for that, so everything
+	 * is left alone if they can't be waited for */
+	while (w->in_flight) {
+		void *param;
+		int64_t result;
+
+		if (!uring_writer_wait(w, &param, &result)) {
+			blog(LOG_ERROR, "uring_writer_destroy: %u writes still in flight", w->in_flight);
+			return false;
+		}
+	}
+
+	unmap_rings(w);
+	close(w->ring_fd);
+	bfree(w);
+	return true;
+}
+
+bool uring_writer_submit(struct uring_writer *w, const void *buf, size_t size, uint64_t offset, bool after_previous,
+			 void *param)
+{
+	unsigned int tail = *w->sq_tail;
+	unsigned int idx = tail & *w->sq_mask;
+	struct io_uring_sqe *sqe = &w->sqes[idx];
+	int ret;
+
+	if (w->in_flight == w->depth)
+		return false;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = w->fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = (uint32_t)size;
+	sqe->off = offset;
+	sqe->user_data = (uint64_t)(uintptr_t)param;
+	if (after_previous)
+		sqe->flags = IOSQE_IO_DRAIN;
+
+	w->sq_array[idx] = idx;
+	__atomic_store_n(w->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	do {
+		ret = sys_io_uring_enter(w->ring_fd, 1, 0, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret != 1) {
+		/* take the entry back so the ring stays consistent */
+		__atomic_store_n(w->sq_tail, tail, __ATOMIC_RELEASE);
+		return false;
+	}
+
+	w->in_flight++;
+	return true;
+}
+
+bool uring_writer_wait(struct uring_writer *w, void **param, int64_t *result)
+{
+	unsigned int head = *w->cq_head;
+
+	if (!w->in_flight)
+		return false;
+
+	while (head == __atomic_load_n(w->cq_tail, __ATOMIC_ACQUIRE)) {
+		int ret = sys_io_uring_enter(w->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+
+		/* EAGAIN and EBUSY only mean the kernel is short on resources
+		 * or completions for a moment */
+		if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			return false;
+	}
+
+	struct io_uring_cqe *cqe = &w->cqes[head & *w->cq_mask];
+	*param = (void *)(uintptr_t)cqe->user_data;
+	*result = cqe->res;
+
+	__atomic_store_n(w->cq_head, head + 1, __ATOMIC_RELEASE);
+	w->in_flight--;
+	return true;
+}
+
+unsigned int uring_writer_in_flight(struct uring_writer *w)
+{
+	return w->in_flight;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * Internal, Linux only: asynchronous positional file writes through io_uring,
+ * set up with the raw system calls so there's no dependency on liburing.
+ *
+ * Writes may complete in any order.  A write submitted with after_previous
+ * only starts once all writes submitted before it completed, use it for writes
+ * that may overlap earlier ones.
+ *
+ * The functions are exported for the unit tests only, they are not part of
+ * the public API.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct uring_writer;
+
+/** Returns NULL if io_uring isn't available, for example in a sandbox */
+EXPORT struct uring_writer *uring_writer_create(int fd, unsigned int depth);
+
+/**
+ * Waits for the writes still in flight first.  If that fails the writer is
+ * leaked and false is returned, the buffers of those writes must not be freed
+ * either then.
+ */
+EXPORT bool uring_writer_destroy(struct uring_writer *w);
+
+/** Fails if depth writes are already in flight */
+EXPORT bool uring_writer_submit(struct uring_writer *w, const void *buf, size_t size, uint64_t offset,
+				bool after_previous, void *param);
+
+/** Waits for the next completed write, result is the write's return value */
+EXPORT bool uring_writer_wait(struct uring_writer *w, void **param, int64_t *result);
+
+EXPORT unsigned int uring_writer_in_flight(struct uring_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
@@ -63,6 +63,36 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+struct v4l2_shared_buffers;
+
+/**
+ * A mapped buffer that was handed to obs without copying it
+ */
+struct v4l2_frame_ref {
+	struct v4l2_shared_buffers *shared;
+	uint32_t index;
+	bool busy;
+};
+
+/**
+ * The mapped buffers of a device
+ *
+ * obs may still hold frames that point into the buffers when the capture is
+ * stopped, so the mapping is reference counted: the source holds one
+ * reference and every frame that is still in use by obs another one.
+ */
+struct v4l2_shared_buffers {
+	volatile long refs;
+	pthread_mutex_t mutex;
+
+	/* -1 once the device was closed */
+	int_fast32_t dev;
+	uint_fast32_t outstanding;
+
+	struct v4l2_buffer_data buffers;
+	struct v4l2_frame_ref *frames;
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -89,7 +119,7 @@ struct v4l2_data {
 	int width;
 	int height;
 	int linesize;
-	struct v4l2_buffer_data buffers;
+	struct v4l2_shared_buffers *shared;
 
 	bool auto_reset;
 	int timeout_frames;
@@ -154,6 +184,166 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data, struct obs_source_frame
 	}
 }
 
+static void v4l2_shared_buffers_release(struct v4l2_shared_buffers *shared)
+{
+	if (!shared || os_atomic_dec_long(&shared->refs) != 0)
+		return;
+
+	v4l2_destroy_mmap(&shared->buffers);
+	pthread_mutex_destroy(&shared->mutex);
+	bfree(shared->frames);
+	bfree(shared);
+}
+
+static struct v4l2_shared_buffers *v4l2_shared_buffers_create(int_fast32_t dev)
+{
+	struct v4l2_shared_buffers *shared = bzalloc(sizeof(struct v4l2_shared_buffers));
+
+	shared->refs = 1;
+	shared->dev = dev;
+	pthread_mutex_init(&shared->mutex, NULL);
+
+	if (v4l2_create_mmap(dev, &shared->buffers) < 0) {
+		v4l2_shared_buffers_release(shared);
+		return NULL;
+	}
+
+	shared->frames = bzalloc(shared->buffers.count * sizeof(struct v4l2_frame_ref));
+	for (uint_fast32_t i = 0; i < shared->buffers.count; ++i) {
+		shared->frames[i].shared = shared;
+		shared->frames[i].index = i;
+	}
+
+	return shared;
+}
+
+/*
+ * Release callback for frames output by v4l2_output_mmap_frame
+ *
+ * Gives the buffer back to the driver, unless the device was closed.
+ */
+static void v4l2_frame_released(void *param)
+{
+	struct v4l2_frame_ref *ref = param;
+	struct v4l2_shared_buffers *shared = ref->shared;
+
+	pthread_mutex_lock(&shared->mutex);
+
+	if (shared->dev != -1) {
+		struct v4l2_buffer buf;
+
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = ref->index;
+
+		if (v4l2_ioctl(shared->dev, VIDIOC_QBUF, &buf) < 0)
+			blog(LOG_ERROR, "failed to enqueue released buffer");
+	}
+
+	ref->busy = false;
+	shared->outstanding--;
+
+	pthread_mutex_unlock(&shared->mutex);
+
+	v4l2_shared_buffers_release(shared);
+}
+
+/*
+ * Output a mapped buffer without copying it
+ *
+ * The buffer is queued again once obs releases the frame.  Returns false if
+ * this would leave the driver with less than two buffers to capture into, in
+ * which case the frame has to be copied and the buffer queued right away.
+ */
+static bool v4l2_output_mmap_frame(struct v4l2_data *data, const struct obs_source_frame *out, uint32_t index)
+{
+	struct v4l2_shared_buffers *shared = data->shared;
+	struct v4l2_frame_ref *ref = &shared->frames[index];
+	struct obs_source_frame2 frame;
+
+	pthread_mutex_lock(&shared->mutex);
+
+	if (ref->busy || shared->outstanding + 2 >= shared->buffers.count) {
+		pthread_mutex_unlock(&shared->mutex);
+		return false;
+	}
+
+	ref->busy = true;
+	shared->outstanding++;
+
+	pthread_mutex_unlock(&shared->mutex);
+
+	os_atomic_inc_long(&shared->refs);
+
+	memset(&frame, 0, sizeof(frame));
+	for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i) {
+		frame.data[i] = out->data[i];
+		frame.linesize[i] = out->linesize[i];
+	}
+	frame.width = out->width;
+	frame.height = out->height;
+	frame.timestamp = out->timestamp;
+	frame.format = out->format;
+	frame.range = (out->full_range || !format_is_yuv(out->format)) ? VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL;
+	memcpy(frame.color_matrix, out->color_matrix, sizeof(frame.color_matrix));
+	memcpy(frame.color_range_min, out->color_range_min, sizeof(frame.color_range_min));
+	memcpy(frame.color_range_max, out->color_range_max, sizeof(frame.color_range_max));
+	frame.flip = out->flip;
+	frame.flags = out->flags;
+	frame.trc = out->trc;
+
+	obs_source_output_video3(data->source, &frame, v4l2_frame_released, ref);
+	return true;
+}
+
+/*
+ * Restart the capture after a timeout
+ *
+ * Only the buffers obs doesn't hold are queued again, the driver must not
+ * write into a frame that may still be uploaded.  The others are queued by
+ * v4l2_frame_released once obs is done with them.
+ */
+static int_fast32_t v4l2_reset_shared_capture(struct v4l2_data *data)
+{
+	struct v4l2_shared_buffers *shared = data->shared;
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	struct v4l2_buffer enq;
+	int_fast32_t r = -1;
+
+	blog(LOG_DEBUG, "attempting to reset capture");
+
+	pthread_mutex_lock(&shared->mutex);
+
+	if (v4l2_stop_capture(data->dev) < 0)
+		goto exit;
+
+	memset(&enq, 0, sizeof(enq));
+	enq.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	enq.memory = V4L2_MEMORY_MMAP;
+
+	for (enq.index = 0; enq.index < shared->buffers.count; ++enq.index) {
+		if (shared->frames[enq.index].busy)
+			continue;
+
+		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &enq) < 0) {
+			blog(LOG_ERROR, "unable to queue buffer");
+			goto exit;
+		}
+	}
+
+	if (v4l2_ioctl(data->dev, VIDIOC_STREAMON, &type) < 0) {
+		blog(LOG_ERROR, "unable to start stream");
+		goto exit;
+	}
+
+	r = 0;
+
+exit:
+	pthread_mutex_unlock(&shared->mutex);
+	return r;
+}
+
 /*
  * Worker thread to get video data
  */
@@ -185,7 +375,7 @@ static void *v4l2_thread(void *vptr)
 	blog(LOG_INFO, "%s: select timeout set to %" PRIu64 " (%dx frame periods)", data->device_id, timeout_usec,
 	     data->timeout_frames);
 
-	if (v4l2_start_capture(data->dev, &data->buffers) < 0)
+	if (v4l2_start_capture(data->dev, &data->shared->buffers) < 0)
 		goto exit;
 
 	blog(LOG_DEBUG, "%s: new capture started", data->device_id);
@@ -214,7 +404,7 @@ static void *v4l2_thread(void *vptr)
 			blog(LOG_ERROR, "%s: select timed out", data->device_id);
 
 #ifdef _DEBUG
-			v4l2_query_all_buffers(data->dev, &data->buffers);
+			v4l2_query_all_buffers(data->dev, &data->shared->buffers);
 #endif
 
 			if (v4l2_ioctl(data->dev, VIDIOC_LOG_STATUS) < 0) {
@@ -222,7 +412,7 @@ static void *v4l2_thread(void *vptr)
 			}
 
 			if (data->auto_reset) {
-				if (v4l2_reset_capture(data->dev, &data->buffers) == 0)
+				if (v4l2_reset_shared_capture(data) == 0)
 					blog(LOG_INFO, "%s: stream reset successful", data->device_id);
 				else
 					blog(LOG_ERROR, "%s: failed to reset", data->device_id);
@@ -256,7 +446,7 @@ static void *v4l2_thread(void *vptr)
 			first_ts = out.timestamp;
 		out.timestamp -= first_ts;
 
-		start = (uint8_t *)data->buffers.info[buf.index].start;
+		start = (uint8_t *)data->shared->buffers.info[buf.index].start;
 
 		if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
 			if (v4l2_decode_frame(&out, start, buf.bytesused, &data->decoder) < 0) {
@@ -266,6 +456,11 @@ static void *v4l2_thread(void *vptr)
 		} else {
 			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 				out.data[i] = start + plane_offsets[i];
+
+			if (v4l2_output_mmap_frame(data, &out, buf.index)) {
+				frames++;
+				continue;
+			}
 		}
 		obs_source_output_video(data->source, &out);
 
@@ -841,7 +1036,16 @@ static void v4l2_terminate(struct v4l2_data *data)
 	if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
 		v4l2_destroy_decoder(&data->decoder);
 	}
-	v4l2_destroy_mmap(&data->buffers);
+
+	if (data->shared) {
+		/* frames still held by obs keep the mapping alive */
+		pthread_mutex_lock(&data->shared->mutex);
+		data->shared->dev = -1;
+		pthread_mutex_unlock(&data->shared->mutex);
+
+		v4l2_shared_buffers_release(data->shared);
+		data->shared = NULL;
+	}
 
 	if (data->dev != -1) {
 		v4l2_close(data->dev);
@@ -953,7 +1157,8 @@ static void v4l2_init(struct v4l2_data *data)
 	blog(LOG_INFO, "Framerate: %.2f fps", (float)fps_denom / fps_num);
 
 	/* map buffers */
-	if (v4l2_create_mmap(data->dev, &data->buffers) < 0) {
+	data->shared = v4l2_shared_buffers_create(data->dev);
+	if (!data->shared) {
 		blog(LOG_ERROR, "Failed to map buffers");
 		goto fail;
 	}
@@ -12,6 +12,11 @@ if(NOT TARGET OBS::opts-parser)
   add_subdirectory("${CMAKE_SOURCE_DIR}/shared/opts-parser" "${CMAKE_BINARY_DIR}/shared/opts-parser")
 endif()
 
+# The replay buffer can save through the native MP4 muxer shared with obs-outputs
+if(NOT TARGET OBS::mp4-mux)
+  add_subdirectory("${CMAKE_SOURCE_DIR}/shared/mp4-mux" "${CMAKE_BINARY_DIR}/shared/mp4-mux")
+endif()
+
 if(OS_WINDOWS AND CMAKE_VS_PLATFORM_NAME STREQUAL x64)
   find_package(AMF 1.4.29 REQUIRED)
   add_subdirectory(obs-amf-test)
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include "ffmpeg-mux-shm.h"
+
+#define HEADER_SIZE 256
+
+struct shm_header {
+	uint64_t size;
+	uint8_t pad0[56];
+
+	/* positions only grow, and each has its own cache line */
+	volatile uint64_t write_pos;
+	uint8_t pad1[56];
+	volatile uint64_t read_pos;
+	uint8_t pad2[56];
+
+	volatile uint32_t reader_waiting;
+	volatile uint32_t writer_waiting;
+	volatile uint32_t closed;
+};
+
+struct ffm_shm {
+	struct shm_header *header;
+	uint8_t *data;
+	size_t size;
+	bool writer;
+
+	int mem_fd;
+	/* rung by the writer when there's new data, and by the reader when
+	 * there's new space */
+	int data_fd;
+	int space_fd;
+
+	/* the child holds the write end of this pipe, so the read end hangs up
+	 * when it exits */
+	int life_fds[2];
+
+	struct ffm_shm_stats *stats;
+};
+
+static inline uint64_t load_pos(volatile uint64_t *pos)
+{
+	return __atomic_load_n(pos, __ATOMIC_SEQ_CST);
+}
+
+static inline void store_val(volatile uint32_t *val, uint32_t new_val)
+{
+	__atomic_store_n(val, new_val, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t load_val(volatile uint32_t *val)
+{
+	return __atomic_load_n(val, __ATOMIC_SEQ_CST);
+}
+
+static inline void ring_doorbell(int fd)
+{
+	uint64_t val = 1;
+	while (write(fd, &val, sizeof(val)) < 0 && errno == EINTR)
+		;
+}
+
+static inline void clear_doorbell(int fd)
+{
+	uint64_t val;
+	while (read(fd, &val, sizeof(val)) < 0 && errno == EINTR)
+		;
+}
+
+static bool map_ring(struct ffm_shm *shm)
+{
+	void *mem = mmap(NULL, HEADER_SIZE + shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, shm->mem_fd, 0);
+	if (mem == MAP_FAILED)
+		return false;
+
+	shm->header = mem;
+	shm->data = (uint8_t *)mem + HEADER_SIZE;
+	return true;
+}
+
+static void free_ring(struct ffm_shm *shm)
+{
+	if (shm->header)
+		munmap(shm->header, HEADER_SIZE + shm->size);
+
+	int *fds[] = {&shm->mem_fd, &shm->data_fd, &shm->space_fd, &shm->life_fds[0], &shm->life_fds[1]};
+	for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+		if (*fds[i] != -1)
+			close(*fds[i]);
+	}
+
+	bfree(shm);
+}
+
+static struct ffm_shm *alloc_ring(size_t size)
+{
+	struct ffm_shm *shm = bzalloc(sizeof(*shm));
+	shm->size = size;
+	shm->mem_fd = -1;
+	shm->data_fd = -1;
+	shm->space_fd = -1;
+	shm->life_fds[0] = -1;
+	shm->life_fds[1] = -1;
+	return shm;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct ffm_shm *ffm_shm_create(size_t size, struct ffm_shm_stats *stats)
+{
+	struct ffm_shm *shm = alloc_ring(size);
+	shm->writer = true;
+	shm->stats = stats;
+
+	shm->mem_fd = memfd_create("obs-ffmpeg-mux", MFD_CLOEXEC);
+	if (shm->mem_fd == -1)
+		goto fail;
+	if (ftruncate(shm->mem_fd, (off_t)(HEADER_SIZE + size)) != 0)
+		goto fail;
+	if (!map_ring(shm))
+		goto fail;
+
+	shm->data_fd = eventfd(0, EFD_CLOEXEC);
+	shm->space_fd = eventfd(0, EFD_CLOEXEC);
+	if (shm->data_fd == -1 || shm->space_fd == -1)
+		goto fail;
+
+	if (pipe2(shm->life_fds, O_CLOEXEC) != 0)
+		goto fail;
+
+	shm->header->size = size;
+	return shm;
+
+fail:
+	free_ring(shm);
+	return NULL;
+}
+
+static inline void set_inheritable(struct ffm_shm *shm, bool inheritable)
+{
+	int fds[] = {shm->mem_fd, shm->data_fd, shm->space_fd, shm->life_fds[1]};
+	for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+		fcntl(fds[i], F_SETFD, inheritable ? 0 : FD_CLOEXEC);
+}
+
+/* everything but the read end of the lifeline is only inherited by the child
+ * spawned between ffm_shm_get_arg and ffm_shm_spawned */
+void ffm_shm_get_arg(struct ffm_shm *shm, char *buf, size_t buf_size)
+{
+	set_inheritable(shm, true);
+	snprintf(buf, buf_size, FFM_SHM_ARG "%d,%d,%d,%d,%zu", shm->mem_fd, shm->data_fd, shm->space_fd,
+		 shm->life_fds[1], shm->size);
+}
+
+void ffm_shm_spawned(struct ffm_shm *shm)
+{
+	set_inheritable(shm, false);
+	close(shm->life_fds[1]);
+	shm->life_fds[1] = -1;
+}
+
+static bool wait_for_space(struct ffm_shm *shm, uint64_t write_pos)
+{
+	struct shm_header *header = shm->header;
+	struct pollfd fds[2] = {{shm->space_fd, POLLIN, 0}, {shm->life_fds[0], POLLIN, 0}};
+	bool alive = true;
+
+	store_val(&header->writer_waiting, 1);
+
+	while (write_pos - load_pos(&header->read_pos) == shm->size) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			alive = false;
+			break;
+		}
+
+		/* the child exited */
+		if (fds[1].revents) {
+			alive = false;
+			break;
+		}
+
+		if (fds[0].revents & POLLIN)
+			clear_doorbell(shm->space_fd);
+	}
+
+	store_val(&header->writer_waiting, 0);
+	return alive;
+}
+
+bool ffm_shm_write(struct ffm_shm *shm, const void *data, size_t size)
+{
+	struct shm_header *header = shm->header;
+	struct ffm_shm_stats *stats = shm->stats;
+	const uint8_t *in = data;
+	uint64_t write_pos = header->write_pos;
+	uint64_t queued;
+
+	stats->writes++;
+
+	while (size) {
+		uint64_t space = shm->size - (write_pos - load_pos(&header->read_pos));
+		size_t offset = (size_t)(write_pos % shm->size);
+		size_t len = size;
+
+		if (!space) {
+			uint64_t start = os_gettime_ns();
+			uint64_t wait_ns;
+			bool alive = wait_for_space(shm, write_pos);
+
+			wait_ns = os_gettime_ns() - start;
+			stats->full_waits++;
+			stats->wait_ns += wait_ns;
+			if (wait_ns > stats->max_wait_ns)
+				stats->max_wait_ns = wait_ns;
+
+			if (!alive)
+				return false;
+			continue;
+		}
+
+		if (len > space)
+			len = (size_t)space;
+		if (len > shm->size - offset)
+			len = shm->size - offset;
+
+		memcpy(shm->data + offset, in, len);
+		write_pos += len;
+		__atomic_store_n(&header->write_pos, write_pos, __ATOMIC_SEQ_CST);
+
+		if (load_val(&header->reader_waiting)) {
+			ring_doorbell(shm->data_fd);
+			stats->doorbells++;
+		}
+
+		in += len;
+		size -= len;
+		stats->bytes += len;
+	}
+
+	queued = write_pos - load_pos(&header->read_pos);
+	if (queued > stats->max_queued)
+		stats->max_queued = queued;
+	return true;
+}
+
+void ffm_shm_close(struct ffm_shm *shm)
+{
+	store_val(&shm->header->closed, 1);
+	ring_doorbell(shm->data_fd);
+}
+
+void ffm_shm_destroy(struct ffm_shm *shm)
+{
+	if (shm)
+		free_ring(shm);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct ffm_shm *ffm_shm_open(const char *arg)
+{
+	struct ffm_shm *shm;
+	int mem_fd, data_fd, space_fd, life_fd;
+	size_t size;
+
+	if (strncmp(arg, FFM_SHM_ARG, sizeof(FFM_SHM_ARG) - 1) != 0)
+		return NULL;
+	if (sscanf(arg + sizeof(FFM_SHM_ARG) - 1, "%d,%d,%d,%d,%zu", &mem_fd, &data_fd, &space_fd, &life_fd, &size) !=
+	    5)
+		return NULL;
+
+	shm = alloc_ring(size);
+	shm->mem_fd = mem_fd;
+	shm->data_fd = data_fd;
+	shm->space_fd = space_fd;
+
+	/* never used, only held open until exiting */
+	shm->life_fds[1] = life_fd;
+
+	if (!map_ring(shm) || shm->header->size != size) {
+		free_ring(shm);
+		return NULL;
+	}
+
+	return shm;
+}
+
+/* returns false if there's nothing more to read */
+static bool wait_for_data(struct ffm_shm *shm, uint64_t read_pos)
+{
+	struct shm_header *header = shm->header;
+	/* stdin is the pipe from the parent, it only hangs up once the parent
+	 * is gone */
+	struct pollfd fds[2] = {{shm->data_fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+	bool more = true;
+
+	store_val(&header->reader_waiting, 1);
+
+	while (load_pos(&header->write_pos) == read_pos) {
+		/* data may have been written just before closing */
+		if (load_val(&header->closed)) {
+			more = load_pos(&header->write_pos) != read_pos;
+			break;
+		}
+
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			more = false;
+			break;
+		}
+
+		if (fds[1].revents & (POLLHUP | POLLERR)) {
+			more = load_pos(&header->write_pos) != read_pos;
+			break;
+		}
+
+		if (fds[0].revents & POLLIN)
+			clear_doorbell(shm->data_fd);
+	}
+
+	store_val(&header->reader_waiting, 0);
+	return more;
+}
+
+size_t ffm_shm_read(struct ffm_shm *shm, void *data, size_t size)
+{
+	struct shm_header *header = shm->header;
+	uint8_t *out = data;
+	uint64_t read_pos = header->read_pos;
+	size_t total = size;
+
+	while (size) {
+		uint64_t avail = load_pos(&header->write_pos) - read_pos;
+		size_t offset = (size_t)(read_pos % shm->size);
+		size_t len = size;
+
+		if (!avail) {
+			if (!wait_for_data(shm, read_pos))
+				return 0;
+			continue;
+		}
+
+		if (len > avail)
+			len = (size_t)avail;
+		if (len > shm->size - offset)
+			len = shm->size - offset;
+
+		memcpy(out, shm->data + offset, len);
+		read_pos += len;
+		__atomic_store_n(&header->read_pos, read_pos, __ATOMIC_SEQ_CST);
+
+		if (load_val(&header->writer_waiting))
+			ring_doorbell(shm->space_fd);
+
+		out += len;
+		size -= len;
+	}
+
+	return total;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Linux only: a single producer, single consumer byte ring in a memfd shared
+ * with the ffmpeg-mux process, used instead of its stdin pipe.  Both sides
+ * only ring the other side's eventfd when it's actually waiting, so a packet
+ * usually costs no system calls at all.  The data written is the same stream
+ * of ffm_packet_info headers and payloads that would go through the pipe.
+ *
+ * The ring is handed to the child as its last argument, FFM_SHM_ARG followed
+ * by the inherited file descriptors.
+ */
+
+#define FFM_SHM_ARG "--shm-ring="
+
+struct ffm_shm;
+
+struct ffm_shm_stats {
+	uint64_t bytes;
+	uint64_t writes;
+	/* wakeups sent to the waiting reader */
+	uint64_t doorbells;
+	/* times the ring was full, and how long writing waited for space */
+	uint64_t full_waits;
+	uint64_t wait_ns;
+	uint64_t max_wait_ns;
+	/* highest number of bytes queued for the reader */
+	uint64_t max_queued;
+};
+
+/* writer side, the counters in stats are updated while writing */
+extern struct ffm_shm *ffm_shm_create(size_t size, struct ffm_shm_stats *stats);
+extern void ffm_shm_get_arg(struct ffm_shm *shm, char *buf, size_t buf_size);
+extern void ffm_shm_spawned(struct ffm_shm *shm);
+extern bool ffm_shm_write(struct ffm_shm *shm, const void *data, size_t size);
+extern void ffm_shm_close(struct ffm_shm *shm);
+
+/* reader side, returns size, or 0 once the writer closed the ring */
+extern struct ffm_shm *ffm_shm_open(const char *arg);
+extern size_t ffm_shm_read(struct ffm_shm *shm, void *data, size_t size);
+
+extern void ffm_shm_destroy(struct ffm_shm *shm);
@@ -35,6 +35,10 @@
 #include <libavutil/channel_layout.h>
 #include <libavutil/mastering_display_metadata.h>
 
+#ifdef __linux__
+#include "ffmpeg-mux-shm.h"
+#endif
+
 #define ANSI_COLOR_RED "\x1b[0;91m"
 #define ANSI_COLOR_MAGENTA "\x1b[0;95m"
 #define ANSI_COLOR_RESET "\x1b[0m"
@@ -45,6 +49,11 @@
 
 static char *global_stream_key = "";
 
+#ifdef __linux__
+/* replaces stdin when the parent passes a shared memory ring */
+static struct ffm_shm *global_shm = NULL;
+#endif
+
 struct resize_buf {
 	uint8_t *buf;
 	size_t size;
@@ -600,6 +609,11 @@ static size_t safe_read(void *vdata, size_t size)
 	uint8_t *data = vdata;
 	size_t total = size;
 
+#ifdef __linux__
+	if (global_shm)
+		return ffm_shm_read(global_shm, vdata, size);
+#endif
+
 	while (size > 0) {
 		size_t in_size = fread(data, 1, size, stdin);
 		if (in_size == 0)
@@ -1162,6 +1176,17 @@ int main(int argc, char *argv[])
 #endif
 	setvbuf(stderr, NULL, _IONBF, 0);
 
+#ifdef __linux__
+	if (argc > 1 && strncmp(argv[argc - 1], FFM_SHM_ARG, sizeof(FFM_SHM_ARG) - 1) == 0) {
+		global_shm = ffm_shm_open(argv[argc - 1]);
+		if (!global_shm) {
+			fprintf(stderr, "Couldn't open shared memory ring\n");
+			return FFM_ERROR;
+		}
+		argc--;
+	}
+#endif
+
 	ret = ffmpeg_mux_init(&ffm, argc, argv);
 	if (ret != FFM_SUCCESS) {
 		fprintf(stderr, "Couldn't initialize muxer\n");
@@ -1187,6 +1212,10 @@ int main(int argc, char *argv[])
 	resize_buf_free(&rb);
 	resize_buf_free(&rb_filename);
 
+#ifdef __linux__
+	ffm_shm_destroy(global_shm);
+#endif
+
 #ifdef _WIN32
 	for (int i = 0; i < argc; i++)
 		free(argv[i]);
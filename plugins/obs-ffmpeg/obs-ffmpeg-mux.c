@@ -17,6 +17,10 @@
 #include "ffmpeg-mux/ffmpeg-mux.h"
 #include "obs-ffmpeg-mux.h"
 #include "obs-ffmpeg-formats.h"
+#include "obs-ffmpeg-replay-ring.h"
+
+#include <util/buffered-file-serializer.h>
+#include <inttypes.h>
 
 #ifdef _WIN32
 #include "util/windows/win-version.h"
@@ -44,15 +48,26 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 }
 #endif
 
+/* packets stored in the disk ring only reference its mapping */
+static inline void release_buffered_packet(struct ffmpeg_muxer *stream, struct encoder_packet *pkt)
+{
+	if (stream->ring)
+		replay_ring_pop(stream->ring);
+	else
+		obs_encoder_packet_release(pkt);
+}
+
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
 	while (stream->packets.size > 0) {
 		struct encoder_packet pkt;
 		deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
-		obs_encoder_packet_release(&pkt);
+		release_buffered_packet(stream, &pkt);
 	}
 
 	deque_free(&stream->packets);
+	replay_ring_release(stream->ring);
+	stream->ring = NULL;
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -73,7 +88,7 @@ static void ffmpeg_mux_destroy(void *data)
 	da_free(stream->mux_packets);
 	deque_free(&stream->packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
@@ -92,6 +107,20 @@ static void split_file_proc(void *data, calldata_t *cd)
 	os_atomic_set_bool(&stream->manual_split, true);
 }
 
+static void get_transport_stats_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+	struct ffm_shm_stats *stats = &stream->shm_stats;
+
+	calldata_set_int(cd, "bytes", (long long)stats->bytes);
+	calldata_set_int(cd, "writes", (long long)stats->writes);
+	calldata_set_int(cd, "doorbells", (long long)stats->doorbells);
+	calldata_set_int(cd, "full_waits", (long long)stats->full_waits);
+	calldata_set_int(cd, "wait_ns", (long long)stats->wait_ns);
+	calldata_set_int(cd, "max_wait_ns", (long long)stats->max_wait_ns);
+	calldata_set_int(cd, "max_queued", (long long)stats->max_queued);
+}
+
 static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
@@ -105,6 +134,10 @@ static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
 
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void split_file(out bool split_file_enabled)", split_file_proc, stream);
+	proc_handler_add(ph,
+			 "void get_transport_stats(out int bytes, out int writes, out int doorbells, "
+			 "out int full_waits, out int wait_ns, out int max_wait_ns, out int max_queued)",
+			 get_transport_stats_proc, stream);
 
 	UNUSED_PARAMETER(settings);
 	return stream;
@@ -302,12 +335,83 @@ static void build_command_line(struct ffmpeg_muxer *stream, os_process_args_t **
 	add_muxer_params(*args, stream);
 }
 
+#ifdef __linux__
+static void create_shm(struct ffmpeg_muxer *stream, os_process_args_t *args)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	bool enabled = obs_data_get_bool(settings, "shm_transport");
+	size_t size = (size_t)obs_data_get_int(settings, "shm_size_mb") * 1024 * 1024;
+	char arg[128];
+
+	obs_data_release(settings);
+
+	if (!enabled)
+		return;
+	if (!size)
+		size = 64 * 1024 * 1024;
+
+	memset(&stream->shm_stats, 0, sizeof(stream->shm_stats));
+
+	stream->shm = ffm_shm_create(size, &stream->shm_stats);
+	if (!stream->shm) {
+		warn("Failed to create the shared memory ring, using the pipe");
+		return;
+	}
+
+	ffm_shm_get_arg(stream->shm, arg, sizeof(arg));
+	os_process_args_add_arg(args, arg);
+}
+#endif
+
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	os_process_args_t *args = NULL;
 	build_command_line(stream, &args, path);
+#ifdef __linux__
+	create_shm(stream, args);
+#endif
 	stream->pipe = os_process_pipe_create2(args, "w");
 	os_process_args_destroy(args);
+
+#ifdef __linux__
+	if (stream->shm) {
+		if (stream->pipe) {
+			ffm_shm_spawned(stream->shm);
+		} else {
+			ffm_shm_destroy(stream->shm);
+			stream->shm = NULL;
+		}
+	}
+#endif
+}
+
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	int ret;
+
+#ifdef __linux__
+	/* lets the muxer read what's left in the ring before it sees the end */
+	if (stream->shm)
+		ffm_shm_close(stream->shm);
+#endif
+
+	ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+#ifdef __linux__
+	ffm_shm_destroy(stream->shm);
+	stream->shm = NULL;
+#endif
+	return ret;
+}
+
+static inline bool mux_write(struct ffmpeg_muxer *stream, const void *data, size_t size)
+{
+#ifdef __linux__
+	if (stream->shm)
+		return ffm_shm_write(stream->shm, data, size);
+#endif
+	return os_process_pipe_write(stream->pipe, data, size) == size;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream, obs_data_t *settings, const char *path)
@@ -466,8 +570,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -603,7 +706,6 @@ static void generate_filename(struct ffmpeg_muxer *stream, struct dstr *dst, boo
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
-	size_t ret;
 
 	struct ffm_packet_info info = {.pts = packet->pts,
 				       .dts = packet->dts,
@@ -622,16 +724,14 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		}
 	}
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
+	if (!mux_write(stream, &info, sizeof(info))) {
+		warn("mux_write for info structure failed");
 		signal_failure(stream);
 		return false;
 	}
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
+	if (!mux_write(stream, packet->data, packet->size)) {
+		warn("mux_write for packet data failed");
 		signal_failure(stream);
 		return false;
 	}
@@ -711,20 +811,17 @@ static inline bool should_split(struct ffmpeg_muxer *stream, struct encoder_pack
 
 static bool send_new_filename(struct ffmpeg_muxer *stream, const char *filename)
 {
-	size_t ret;
 	uint32_t size = (uint32_t)strlen(filename);
 	struct ffm_packet_info info = {.type = FFM_PACKET_CHANGE_FILE, .size = size};
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
+	if (!mux_write(stream, &info, sizeof(info))) {
+		warn("mux_write for info structure failed");
 		signal_failure(stream);
 		return false;
 	}
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)filename, size);
-	if (ret != size) {
-		warn("os_process_pipe_write for packet data failed");
+	if (!mux_write(stream, filename, size)) {
+		warn("mux_write for packet data failed");
 		signal_failure(stream);
 		return false;
 	}
@@ -961,7 +1058,7 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	proc_handler_add(ph, "void get_last_replay(out string path)", get_last_replay, stream);
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
-	signal_handler_add(sh, "void saved()");
+	signal_handler_add(sh, "void saved(int latency_ms)");
 
 	return stream;
 }
@@ -974,6 +1071,31 @@ static void replay_buffer_destroy(void *data)
 	ffmpeg_mux_destroy(data);
 }
 
+/* with "ring_dir" set, packet data goes to a file of "ring_size_mb" in that
+ * directory, by default twice the maximum size so a save can be written out
+ * while recording continues */
+static void create_replay_ring(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	const char *dir = obs_data_get_string(settings, "ring_dir");
+	int64_t size = obs_data_get_int(settings, "ring_size_mb") * (1024 * 1024);
+
+	if (!dir || !*dir)
+		return;
+
+	if (!size)
+		size = stream->max_size * 2;
+	if (size <= 0) {
+		warn("Disk ring needs a maximum size, keeping packets in memory");
+		return;
+	}
+
+	stream->ring = replay_ring_create(dir, (uint64_t)size);
+	if (stream->ring)
+		info("Storing packets in a %" PRId64 " MB disk ring in '%s'", size / (1024 * 1024), dir);
+	else
+		warn("Failed to create disk ring in '%s', keeping packets in memory", dir);
+}
+
 static bool replay_buffer_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -984,8 +1106,18 @@ static bool replay_buffer_start(void *data)
 		return false;
 
 	obs_data_t *s = obs_output_get_settings(stream->output);
+	const char *ext = obs_data_get_string(s, "extension");
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	create_replay_ring(stream, s);
+	stream->ring_dropped = 0;
+	stream->ring_dropping = false;
+	stream->ring_skip_video = false;
+
+	/* the native muxer only writes MP4 and MOV */
+	stream->mp4_flavor = astrcmpi(ext, "mov") == 0 ? FLAVOR_MOV : FLAVOR_MP4;
+	stream->native_mux = obs_data_get_bool(s, "native_mux") &&
+			     (astrcmpi(ext, "mp4") == 0 || astrcmpi(ext, "mov") == 0);
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1021,7 +1153,7 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 		stream->cur_size -= (int64_t)pkt.size;
 	}
 
-	obs_encoder_packet_release(&pkt);
+	release_buffered_packet(stream, &pkt);
 	return keyframe;
 }
 
@@ -1059,78 +1191,183 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream, struct encod
 		purge(stream);
 }
 
-static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet, int64_t video_offset,
-			  int64_t *audio_offsets, int64_t video_pts_offset, int64_t *audio_dts_offsets)
+static void add_mux_packet(mux_packets_t *packets, struct encoder_packet *packet, int64_t video_offset,
+			   int64_t *audio_offsets, int64_t video_pts_offset, int64_t *audio_dts_offsets)
 {
-	struct encoder_packet pkt;
-	size_t idx;
+	struct encoder_packet *pkt = da_push_back_new(*packets);
 
-	obs_encoder_packet_ref(&pkt, packet);
+	obs_encoder_packet_ref(pkt, packet);
 
-	if (pkt.type == OBS_ENCODER_VIDEO) {
-		pkt.dts_usec -= video_offset;
-		pkt.dts -= video_pts_offset;
-		pkt.pts -= video_pts_offset;
+	if (pkt->type == OBS_ENCODER_VIDEO) {
+		pkt->dts_usec -= video_offset;
+		pkt->dts -= video_pts_offset;
+		pkt->pts -= video_pts_offset;
 	} else {
-		pkt.dts_usec -= audio_offsets[pkt.track_idx];
-		pkt.dts -= audio_dts_offsets[pkt.track_idx];
-		pkt.pts -= audio_dts_offsets[pkt.track_idx];
+		pkt->dts_usec -= audio_offsets[pkt->track_idx];
+		pkt->dts -= audio_dts_offsets[pkt->track_idx];
+		pkt->pts -= audio_dts_offsets[pkt->track_idx];
 	}
+}
 
-	for (idx = packets->num; idx > 0; idx--) {
-		struct encoder_packet *p = packets->array + (idx - 1);
-		if (p->dts_usec < pkt.dts_usec)
-			break;
-	}
+#define MUX_MAX_TRACKS (MAX_OUTPUT_VIDEO_ENCODERS + MAX_AUDIO_MIXES)
 
-	da_insert(*packets, idx, &pkt);
+static inline size_t mux_track(const struct encoder_packet *pkt)
+{
+	return pkt->type == OBS_ENCODER_VIDEO ? pkt->track_idx : MAX_OUTPUT_VIDEO_ENCODERS + pkt->track_idx;
 }
 
-static void *replay_buffer_mux_thread(void *data)
+/* a later packet goes first on equal timestamps, like the insertion sort
+ * this replaces */
+static inline bool mux_packet_before(const mux_packets_t *packets, size_t a, size_t b)
 {
-	struct ffmpeg_muxer *stream = data;
-	bool error = false;
+	int64_t a_ts = packets->array[a].dts_usec;
+	int64_t b_ts = packets->array[b].dts_usec;
+	return a_ts < b_ts || (a_ts == b_ts && a > b);
+}
+
+/* the buffered packets of each track are already in order, and only the
+ * start offsets differ between tracks, so merging the tracks is enough to
+ * get the write order */
+static size_t *merge_mux_packets(const mux_packets_t *packets)
+{
+	size_t heads[MUX_MAX_TRACKS];
+	size_t last[MUX_MAX_TRACKS];
+	size_t *next;
+	size_t *order;
+
+	if (!packets->num)
+		return NULL;
+
+	next = bmalloc(packets->num * sizeof(size_t));
+	order = bmalloc(packets->num * sizeof(size_t));
+
+	for (size_t t = 0; t < MUX_MAX_TRACKS; t++)
+		heads[t] = last[t] = DARRAY_INVALID;
+
+	for (size_t i = 0; i < packets->num; i++) {
+		size_t t = mux_track(&packets->array[i]);
+
+		next[i] = DARRAY_INVALID;
+		if (last[t] == DARRAY_INVALID)
+			heads[t] = i;
+		else
+			next[last[t]] = i;
+		last[t] = i;
+	}
+
+	for (size_t n = 0; n < packets->num; n++) {
+		size_t best = DARRAY_INVALID;
+
+		for (size_t t = 0; t < MUX_MAX_TRACKS; t++) {
+			if (heads[t] == DARRAY_INVALID)
+				continue;
+			if (best == DARRAY_INVALID || mux_packet_before(packets, heads[t], best))
+				best = heads[t];
+		}
+
+		order[n] = best;
+		heads[mux_track(&packets->array[best])] = next[best];
+	}
+
+	bfree(next);
+	return order;
+}
 
+static bool mux_replay_pipe(struct ffmpeg_muxer *stream, const size_t *order)
+{
 	start_pipe(stream, stream->path.array);
 
 	if (!stream->pipe) {
 		warn("Failed to create process pipe");
-		error = true;
-		goto error;
+		return false;
 	}
 
 	if (!send_headers(stream)) {
 		warn("Could not write headers for file '%s'", stream->path.array);
-		error = true;
-		goto error;
+		return false;
 	}
 
 	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
+		struct encoder_packet *pkt = &stream->mux_packets.array[order[i]];
 		if (!write_packet(stream, pkt)) {
 			warn("Could not write packet for file '%s'", stream->path.array);
-			error = true;
-			goto error;
+			return false;
 		}
-		obs_encoder_packet_release(pkt);
 	}
 
-	info("Wrote replay buffer to '%s'", stream->path.array);
+	return true;
+}
 
-error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	if (error) {
-		for (size_t i = 0; i < stream->mux_packets.num; i++)
-			obs_encoder_packet_release(&stream->mux_packets.array[i]);
+static bool mux_replay_mp4(struct ffmpeg_muxer *stream, const size_t *order)
+{
+	struct serializer s;
+	struct mp4_mux *muxer;
+	bool success = true;
+
+	if (!buffered_file_serializer_init_defaults(&s, stream->path.array)) {
+		warn("Unable to open file '%s'", stream->path.array);
+		return false;
+	}
+
+	muxer = mp4_mux_create(stream->output, &s, MP4_USE_NEGATIVE_CTS, stream->mp4_flavor);
+
+	for (size_t i = 0; i < stream->mux_packets.num; i++) {
+		struct encoder_packet *pkt = &stream->mux_packets.array[order[i]];
+		if (!mp4_mux_submit_packet(muxer, pkt)) {
+			warn("Could not write packet for file '%s'", stream->path.array);
+			success = false;
+			break;
+		}
 	}
+
+	if (success && !mp4_mux_finalise(muxer)) {
+		warn("Could not finalize file '%s'", stream->path.array);
+		success = false;
+	}
+
+	buffered_file_serializer_free(&s);
+	mp4_mux_destroy(muxer);
+	return success;
+}
+
+static void *replay_buffer_mux_thread(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+	size_t *order = merge_mux_packets(&stream->mux_packets);
+	bool success;
+
+	if (stream->native_mux)
+		success = mux_replay_mp4(stream, order);
+	else
+		success = mux_replay_pipe(stream, order);
+
+	if (success)
+		info("Wrote replay buffer to '%s'", stream->path.array);
+
+	stop_pipe(stream);
+
+	for (size_t i = 0; i < stream->mux_packets.num; i++)
+		obs_encoder_packet_release(&stream->mux_packets.array[i]);
 	da_free(stream->mux_packets);
+	bfree(order);
+
+	if (stream->mux_ring) {
+		replay_ring_unpin(stream->mux_ring);
+		replay_ring_release(stream->mux_ring);
+		stream->mux_ring = NULL;
+	}
 	os_atomic_set_bool(&stream->muxing, false);
 
-	if (!error) {
+	if (success) {
+		uint64_t latency_ms = (os_gettime_ns() - stream->save_start_ns) / 1000000;
 		calldata_t cd = {0};
 		signal_handler_t *sh = obs_output_get_signal_handler(stream->output);
+
+		info("Saving took %" PRIu64 " ms", latency_ms);
+
+		calldata_set_int(&cd, "latency_ms", (long long)latency_ms);
 		signal_handler_signal(sh, "saved", &cd);
+		calldata_free(&cd);
 	}
 
 	return NULL;
@@ -1141,10 +1378,11 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 	const size_t size = sizeof(struct encoder_packet);
 	size_t num_packets = stream->packets.size / size;
 
+	stream->save_start_ns = os_gettime_ns();
 	da_reserve(stream->mux_packets, num_packets);
 
 	/* ---------------------------- */
-	/* reorder packets */
+	/* remove start offsets, the mux thread merges the tracks */
 
 	bool found_video = false;
 	bool found_audio[MAX_AUDIO_MIXES] = {0};
@@ -1171,8 +1409,16 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 			}
 		}
 
-		insert_packet(&stream->mux_packets, pkt, video_offset, audio_offsets, video_pts_offset,
-			      audio_dts_offsets);
+		add_mux_packet(&stream->mux_packets, pkt, video_offset, audio_offsets, video_pts_offset,
+			       audio_dts_offsets);
+	}
+
+	/* the packets are written straight from the ring, so keep it from
+	 * overwriting them until the file is done */
+	if (stream->ring) {
+		replay_ring_addref(stream->ring);
+		replay_ring_pin(stream->ring);
+		stream->mux_ring = stream->ring;
 	}
 
 	generate_filename(stream, &stream->path, true);
@@ -1181,10 +1427,73 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL, replay_buffer_mux_thread, stream) == 0;
 	if (!stream->mux_thread_joinable) {
 		warn("Failed to create muxer thread");
+		for (size_t i = 0; i < stream->mux_packets.num; i++)
+			obs_encoder_packet_release(&stream->mux_packets.array[i]);
+		da_free(stream->mux_packets);
+
+		if (stream->mux_ring) {
+			replay_ring_unpin(stream->mux_ring);
+			replay_ring_release(stream->mux_ring);
+			stream->mux_ring = NULL;
+		}
 		os_atomic_set_bool(&stream->muxing, false);
 	}
 }
 
+/* once a video packet is dropped, the rest of its GOP can't be decoded, so
+ * video is skipped up to the next keyframe */
+static void drop_ring_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO)
+		stream->ring_skip_video = true;
+
+	stream->ring_dropped++;
+}
+
+static bool store_ring_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet,
+			      struct encoder_packet *out)
+{
+	uint8_t *data;
+
+	if (packet->type == OBS_ENCODER_VIDEO && stream->ring_skip_video && !packet->keyframe) {
+		drop_ring_packet(stream, packet);
+		return false;
+	}
+
+	if (!replay_ring_can_store(stream->ring, packet->size)) {
+		warn("Dropping packet of %zu bytes, it is larger than the disk ring", packet->size);
+		drop_ring_packet(stream, packet);
+		return false;
+	}
+
+	while (!(data = replay_ring_push(stream->ring, packet->data, packet->size))) {
+		/* this runs with the output's packet locks held, so don't
+		 * wait for a save still writing from the ring.  the ring is
+		 * twice the maximum size by default, so this should only
+		 * happen when the disk can't keep up */
+		if (replay_ring_pinned(stream->ring)) {
+			if (!stream->ring_dropping)
+				warn("Disk ring is full while saving, dropping packets");
+			stream->ring_dropping = true;
+			drop_ring_packet(stream, packet);
+			return false;
+		}
+
+		purge(stream);
+	}
+
+	if (stream->ring_dropping) {
+		info("Disk ring has space again, %d packets dropped so far", stream->ring_dropped);
+		stream->ring_dropping = false;
+	}
+	if (packet->type == OBS_ENCODER_VIDEO)
+		stream->ring_skip_video = false;
+
+	*out = *packet;
+	out->data = data;
+	return true;
+}
+
 static void deactivate_replay_buffer(struct ffmpeg_muxer *stream, int code)
 {
 	if (code) {
@@ -1220,14 +1529,20 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
+	if (stream->ring) {
+		replay_buffer_purge(stream, packet);
+		if (!store_ring_packet(stream, packet, &pkt))
+			return;
+	} else {
+		obs_encoder_packet_ref(&pkt, packet);
+		replay_buffer_purge(stream, &pkt);
+	}
 
 	if (!stream->packets.size)
 		stream->cur_time = pkt.dts_usec;
 	stream->cur_size += pkt.size;
 
-	deque_push_back(&stream->packets, packet, sizeof(*packet));
+	deque_push_back(&stream->packets, &pkt, sizeof(pkt));
 
 	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
 		stream->keyframes++;
@@ -1250,11 +1565,20 @@ static void replay_buffer_defaults(obs_data_t *s)
 {
 	obs_data_set_default_int(s, "max_time_sec", 15);
 	obs_data_set_default_int(s, "max_size_mb", 500);
+	obs_data_set_default_string(s, "ring_dir", "");
+	obs_data_set_default_int(s, "ring_size_mb", 0);
+	obs_data_set_default_bool(s, "native_mux", false);
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
 }
 
+static int replay_buffer_dropped_frames(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+	return stream->ring_dropped;
+}
+
 struct obs_output_info replay_buffer = {
 	.id = "replay_buffer",
 	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK | OBS_OUTPUT_CAN_PAUSE,
@@ -1266,4 +1590,5 @@ struct obs_output_info replay_buffer = {
 	.encoded_packet = replay_buffer_data,
 	.get_total_bytes = ffmpeg_mux_total_bytes,
 	.get_defaults = replay_buffer_defaults,
+	.get_dropped_frames = replay_buffer_dropped_frames,
 };
@@ -8,6 +8,10 @@
 #include <util/pipe.h>
 #include <util/platform.h>
 #include <util/threading.h>
+#include "ffmpeg-mux/ffmpeg-mux-shm.h"
+#include "mp4-mux.h"
+
+struct replay_ring;
 
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
@@ -38,6 +42,19 @@ struct ffmpeg_muxer {
 	volatile bool muxing;
 	mux_packets_t mux_packets;
 
+	/* replay buffer packet data stored on disk instead of in memory, the
+	 * packets in the deque and of a save then point into the ring */
+	struct replay_ring *ring;
+	struct replay_ring *mux_ring;
+	int ring_dropped;
+	bool ring_dropping;
+	bool ring_skip_video;
+
+	/* replay buffer saved in-process with the native MP4 muxer */
+	bool native_mux;
+	enum mp4_flavor mp4_flavor;
+	uint64_t save_start_ns;
+
 	/* split file */
 	bool found_video;
 	bool found_audio[MAX_AUDIO_MIXES];
@@ -64,11 +81,16 @@ struct ffmpeg_muxer {
 	bool is_network;
 	bool split_file;
 	bool allow_overwrite;
+
+	/* packets sent through shared memory instead of the pipe, Linux only */
+	struct ffm_shm *shm;
+	struct ffm_shm_stats shm_stats;
 };
 
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
@@ -0,0 +1,256 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-module.h>
+#include <util/deque.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "obs-ffmpeg-replay-ring.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* the data of each packet is stored behind a reference count, the same way
+ * as the data of encoder packets, so saves can reference it with
+ * obs_encoder_packet_ref instead of copying it.  the count starts out far
+ * from both 0 and PACKET_POOL_REFS, so releasing it never frees anything */
+#define RING_PACKET_REFS (1L << (sizeof(long) * 8 - 3))
+#define RING_ALIGN 8
+
+static inline uint64_t stored_size(size_t size)
+{
+	return ((uint64_t)sizeof(long) + size + (RING_ALIGN - 1)) & ~(uint64_t)(RING_ALIGN - 1);
+}
+
+struct replay_ring {
+	volatile long refs;
+
+	uint8_t *data;
+	uint64_t size;
+
+	/* offsets grow forever, the file position is offset % size */
+	uint64_t tail;
+	struct deque offsets;
+
+	volatile bool pinned;
+	uint64_t pin;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+#ifdef _WIN32
+static bool map_ring_file(struct replay_ring *ring, const char *dir)
+{
+	wchar_t *wdir = NULL;
+	wchar_t path[MAX_PATH];
+	LARGE_INTEGER size;
+	bool success = false;
+
+	os_utf8_to_wcs_ptr(dir, 0, &wdir);
+	if (!wdir || !GetTempFileNameW(wdir, L"obs", 0, path))
+		goto fail;
+
+	ring->file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+				 FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (ring->file == INVALID_HANDLE_VALUE) {
+		ring->file = NULL;
+		goto fail;
+	}
+
+	size.QuadPart = (LONGLONG)ring->size;
+	if (!SetFilePointerEx(ring->file, size, NULL, FILE_BEGIN) || !SetEndOfFile(ring->file))
+		goto fail;
+
+	ring->mapping = CreateFileMappingW(ring->file, NULL, PAGE_READWRITE, 0, 0, NULL);
+	if (!ring->mapping)
+		goto fail;
+
+	ring->data = MapViewOfFile(ring->mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)ring->size);
+	success = !!ring->data;
+
+fail:
+	bfree(wdir);
+	return success;
+}
+
+static void unmap_ring_file(struct replay_ring *ring)
+{
+	if (ring->data)
+		UnmapViewOfFile(ring->data);
+	if (ring->mapping)
+		CloseHandle(ring->mapping);
+	if (ring->file)
+		CloseHandle(ring->file);
+}
+#else
+static bool map_ring_file(struct replay_ring *ring, const char *dir)
+{
+	struct dstr path = {0};
+	void *data;
+
+	dstr_printf(&path, "%s/obs-replay-XXXXXX", dir);
+	ring->fd = mkstemp(path.array);
+
+	/* nothing else needs the name, and this way the file is gone even
+	 * after a crash */
+	if (ring->fd != -1)
+		unlink(path.array);
+	dstr_free(&path);
+
+	if (ring->fd == -1)
+		return false;
+	if (ftruncate(ring->fd, (off_t)ring->size) != 0)
+		return false;
+
+#ifdef __linux__
+	/* allocate the blocks now, running out of disk space while writing to
+	 * the mapping would be fatal */
+	if (posix_fallocate(ring->fd, 0, (off_t)ring->size) != 0)
+		return false;
+#endif
+
+	data = mmap(NULL, (size_t)ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+	if (data == MAP_FAILED)
+		return false;
+
+	ring->data = data;
+	madvise(ring->data, (size_t)ring->size, MADV_SEQUENTIAL);
+	return true;
+}
+
+static void unmap_ring_file(struct replay_ring *ring)
+{
+	if (ring->data)
+		munmap(ring->data, (size_t)ring->size);
+	if (ring->fd != -1)
+		close(ring->fd);
+}
+#endif
+
+struct replay_ring *replay_ring_create(const char *dir, uint64_t size)
+{
+	struct replay_ring *ring = bzalloc(sizeof(*ring));
+	ring->refs = 1;
+	ring->size = size & ~(uint64_t)(RING_ALIGN - 1);
+#ifndef _WIN32
+	ring->fd = -1;
+#endif
+
+	if ((uint64_t)(size_t)size != size || !ring->size)
+		goto fail;
+	if (!map_ring_file(ring, dir))
+		goto fail;
+
+	return ring;
+
+fail:
+	replay_ring_release(ring);
+	return NULL;
+}
+
+void replay_ring_addref(struct replay_ring *ring)
+{
+	os_atomic_inc_long(&ring->refs);
+}
+
+void replay_ring_release(struct replay_ring *ring)
+{
+	if (!ring || os_atomic_dec_long(&ring->refs) != 0)
+		return;
+
+	unmap_ring_file(ring);
+	deque_free(&ring->offsets);
+	bfree(ring);
+}
+
+uint64_t replay_ring_size(const struct replay_ring *ring)
+{
+	return ring->size;
+}
+
+bool replay_ring_can_store(const struct replay_ring *ring, size_t size)
+{
+	return stored_size(size) <= ring->size;
+}
+
+uint8_t *replay_ring_push(struct replay_ring *ring, const uint8_t *data, size_t size)
+{
+	uint64_t total = stored_size(size);
+	uint64_t pos = ring->tail;
+	uint64_t head;
+	long *refs;
+
+	/* data of a packet is never split at the end of the file */
+	if (pos % ring->size + total > ring->size)
+		pos += ring->size - pos % ring->size;
+
+	if (os_atomic_load_bool(&ring->pinned))
+		head = ring->pin;
+	else if (ring->offsets.size)
+		deque_peek_front(&ring->offsets, &head, sizeof(head));
+	else
+		head = pos;
+
+	if (pos + total - head > ring->size)
+		return NULL;
+
+	refs = (long *)(ring->data + pos % ring->size);
+	*refs = RING_PACKET_REFS;
+	memcpy(refs + 1, data, size);
+
+	deque_push_back(&ring->offsets, &pos, sizeof(pos));
+	ring->tail = pos + total;
+	return (uint8_t *)(refs + 1);
+}
+
+void replay_ring_pop(struct replay_ring *ring)
+{
+	if (ring->offsets.size)
+		deque_pop_front(&ring->offsets, NULL, sizeof(uint64_t));
+}
+
+void replay_ring_pin(struct replay_ring *ring)
+{
+	if (ring->offsets.size)
+		deque_peek_front(&ring->offsets, &ring->pin, sizeof(ring->pin));
+	else
+		ring->pin = ring->tail;
+
+	os_atomic_set_bool(&ring->pinned, true);
+}
+
+void replay_ring_unpin(struct replay_ring *ring)
+{
+	os_atomic_set_bool(&ring->pinned, false);
+}
+
+bool replay_ring_pinned(struct replay_ring *ring)
+{
+	return os_atomic_load_bool(&ring->pinned);
+}
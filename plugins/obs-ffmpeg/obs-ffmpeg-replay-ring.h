@@ -0,0 +1,56 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+
+/*
+ * Disk-backed storage for replay buffer packet data: a preallocated,
+ * memory-mapped file used as a ring.  Packets are appended at the end and
+ * dropped from the front in the same order, so only the file offset of each
+ * packet is kept in memory.  The file is deleted when the ring is released.
+ *
+ * A save pins the stored data from the oldest packet on, so it can be written
+ * straight from the mapping while new packets keep being appended behind it.
+ */
+
+struct replay_ring;
+
+/* creates a ring file of the given size in dir, NULL on failure */
+extern struct replay_ring *replay_ring_create(const char *dir, uint64_t size);
+extern void replay_ring_addref(struct replay_ring *ring);
+extern void replay_ring_release(struct replay_ring *ring);
+
+extern uint64_t replay_ring_size(const struct replay_ring *ring);
+
+/* whether a packet of this size fits into the ring at all */
+extern bool replay_ring_can_store(const struct replay_ring *ring, size_t size);
+
+/* copies the data to the end of the ring and returns where it's stored, or
+ * NULL if the ring needs to drop packets from the front first.  the returned
+ * data can be referenced like the data of an encoder packet. */
+extern uint8_t *replay_ring_push(struct replay_ring *ring, const uint8_t *data, size_t size);
+
+/* drops the oldest packet */
+extern void replay_ring_pop(struct replay_ring *ring);
+
+/* keeps the stored data from being overwritten until unpinned, called on the
+ * thread that pushes.  replay_ring_unpin may be called from any thread. */
+extern void replay_ring_pin(struct replay_ring *ring);
+extern void replay_ring_unpin(struct replay_ring *ring);
+extern bool replay_ring_pinned(struct replay_ring *ring);
@@ -1,5 +1,6 @@
 #include <obs-module.h>
 #include <media-io/audio-math.h>
+#include <media-io/audio-simd.h>
 #include <math.h>
 
 #define do_log(level, format, ...) \
@@ -55,11 +56,8 @@ static struct obs_audio_data *gain_filter_audio(void *data, struct obs_audio_dat
 	const float multiple = gf->multiple;
 
 	for (size_t c = 0; c < channels; c++) {
-		if (audio->data[c]) {
-			for (size_t i = 0; i < audio->frames; i++) {
-				adata[c][i] *= multiple;
-			}
-		}
+		if (audio->data[c])
+			audio_apply_gain(adata[c], multiple, audio->frames);
 	}
 
 	return audio;
@@ -0,0 +1,144 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include <util/platform.h>
+#include "dbr-tcp-estimator.h"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/tcp.h>
+#endif
+
+#define SAMPLE_INTERVAL_NS (50ULL * 1000000ULL)
+
+/* time for a new bitrate to reach the connection before looking again */
+#define HOLD_NS (2ULL * 1000000000ULL)
+
+#define CONGESTED_SAMPLES 3
+
+/* RTT above the minimum, half of the send queue trigger */
+#define MAX_QUEUE_DELAY_US 100000
+
+/* data waiting in the kernel, in ms at the current bitrate, before a low
+ * throughput counts as congestion rather than a burst like a keyframe */
+#define MIN_BACKLOG_MS 100
+
+bool dbr_tcp_sample_read(int fd, struct dbr_tcp_sample *sample)
+{
+#ifdef __linux__
+	struct tcp_info info;
+	socklen_t len = sizeof(info);
+
+	memset(&info, 0, sizeof(info));
+	if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+		return false;
+
+	/* the delivery rate is the newest field used (Linux 4.10) */
+	if (len < offsetof(struct tcp_info, tcpi_delivery_rate) + sizeof(info.tcpi_delivery_rate))
+		return false;
+
+	sample->ts = os_gettime_ns();
+	sample->rtt_us = info.tcpi_rtt;
+	sample->min_rtt_us = info.tcpi_min_rtt;
+	sample->delivery_rate = info.tcpi_delivery_rate;
+	sample->app_limited = info.tcpi_delivery_rate_app_limited;
+	sample->unacked_bytes = info.tcpi_unacked * info.tcpi_snd_mss;
+	sample->notsent_bytes = info.tcpi_notsent_bytes;
+	sample->cwnd_bytes = info.tcpi_snd_cwnd * info.tcpi_snd_mss;
+	sample->bytes_acked = info.tcpi_bytes_acked;
+	return true;
+#else
+	UNUSED_PARAMETER(fd);
+	UNUSED_PARAMETER(sample);
+	return false;
+#endif
+}
+
+void dbr_tcp_estimator_reset(struct dbr_tcp_estimator *est)
+{
+	memset(est, 0, sizeof(*est));
+}
+
+static inline void update_min_rtt(struct dbr_tcp_estimator *est, uint32_t rtt_us)
+{
+	if (rtt_us && (!est->min_rtt_us || rtt_us < est->min_rtt_us))
+		est->min_rtt_us = rtt_us;
+}
+
+/* only an interval in which the connection couldn't deliver everything it
+ * already had at the start measures its capacity */
+static void update_rate(struct dbr_tcp_estimator *est, const struct dbr_tcp_sample *sample)
+{
+	uint64_t duration = sample->ts - est->prev_ts;
+	uint64_t acked = sample->bytes_acked - est->prev_bytes_acked;
+	uint64_t rate;
+
+	if (!est->prev_ts || !duration || acked >= est->prev_backlog)
+		return;
+
+	rate = acked * 1000000000ULL / duration;
+	if (!sample->app_limited && sample->delivery_rate && sample->delivery_rate < rate)
+		rate = sample->delivery_rate;
+
+	est->rate = est->rate ? (est->rate * 3 + rate) / 4 : rate;
+}
+
+long dbr_tcp_estimator_update(struct dbr_tcp_estimator *est, const struct dbr_tcp_sample *sample, long cur_kbps)
+{
+	uint64_t cur_rate = (uint64_t)cur_kbps * 1000 / 8;
+	uint64_t backlog = (uint64_t)sample->unacked_bytes + sample->notsent_bytes;
+	bool delayed, limited;
+
+	est->next_sample_ts = sample->ts + SAMPLE_INTERVAL_NS;
+
+	update_min_rtt(est, sample->min_rtt_us);
+	update_min_rtt(est, sample->rtt_us);
+	est->rtt_us = sample->rtt_us;
+
+	update_rate(est, sample);
+	est->prev_ts = sample->ts;
+	est->prev_bytes_acked = sample->bytes_acked;
+	est->prev_backlog = backlog;
+
+	if (sample->ts < est->hold_until_ts) {
+		est->congested_samples = 0;
+		return 0;
+	}
+
+	delayed = est->min_rtt_us && sample->rtt_us > est->min_rtt_us + MAX_QUEUE_DELAY_US;
+	limited = est->rate && est->rate * 10 < cur_rate * 9 && backlog * 1000 > cur_rate * MIN_BACKLOG_MS;
+
+	if (!delayed && !limited) {
+		est->congested_samples = 0;
+		return 0;
+	}
+
+	if (++est->congested_samples < CONGESTED_SAMPLES)
+		return 0;
+
+	est->congested_samples = 0;
+	est->hold_until_ts = sample->ts + HOLD_NS;
+
+	/* leave some room to drain what's already queued */
+	if (est->rate && est->rate < cur_rate)
+		return (long)(est->rate * 8 / 1000) * 9 / 10;
+
+	return cur_kbps * 3 / 4;
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+
+/*
+ * Congestion estimate for dynamic bitrate from the kernel's view of the TCP
+ * connection (TCP_INFO on Linux), instead of from the packets waiting in the
+ * send queue.  Data that backs up in the socket buffer or in the network
+ * shows up as unsent/unacked bytes and a growing RTT right away, while the
+ * send queue only grows once the socket buffer is full.  The capacity is
+ * estimated from the bytes acknowledged while the connection was backlogged,
+ * and from the kernel's delivery rate.
+ */
+
+struct dbr_tcp_sample {
+	uint64_t ts;
+	uint32_t rtt_us;
+	uint32_t min_rtt_us;
+	/* bytes per second */
+	uint64_t delivery_rate;
+	/* the sender ran out of data, so the rate says nothing about capacity */
+	bool app_limited;
+	uint32_t unacked_bytes;
+	uint32_t notsent_bytes;
+	uint32_t cwnd_bytes;
+	uint64_t bytes_acked;
+};
+
+struct dbr_tcp_estimator {
+	uint64_t next_sample_ts;
+	uint64_t hold_until_ts;
+	uint32_t min_rtt_us;
+	uint32_t rtt_us;
+	uint64_t rate;
+	uint32_t congested_samples;
+
+	uint64_t prev_ts;
+	uint64_t prev_bytes_acked;
+	uint64_t prev_backlog;
+};
+
+/* reads a sample of the connection, false if TCP_INFO isn't available */
+bool dbr_tcp_sample_read(int fd, struct dbr_tcp_sample *sample);
+
+void dbr_tcp_estimator_reset(struct dbr_tcp_estimator *est);
+
+static inline bool dbr_tcp_estimator_due(const struct dbr_tcp_estimator *est, uint64_t ts)
+{
+	return ts >= est->next_sample_ts;
+}
+
+/* returns the bitrate in kbps the connection is estimated to sustain once
+ * it's congested while sending at cur_kbps, otherwise 0 */
+long dbr_tcp_estimator_update(struct dbr_tcp_estimator *est, const struct dbr_tcp_sample *sample, long cur_kbps);
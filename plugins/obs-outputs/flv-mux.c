@@ -305,7 +305,46 @@ void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size, bool w
 static int32_t last_time = 0;
 #endif
 
-static void flv_video(struct serializer *s, int32_t dts_offset, struct encoder_packet *packet, bool is_header)
+/* ------------------------------------------------------------------------- */
+/* tag headers written to a fixed buffer, for sending the payload separately */
+
+static size_t tag_header_write(void *param, const void *data, size_t size)
+{
+	struct flv_tag *tag = param;
+
+	if (tag->header_size + size > FLV_TAG_HEADER_MAX_SIZE) {
+		assert(0 && "FLV tag header too large");
+		return 0;
+	}
+
+	memcpy(tag->header + tag->header_size, data, size);
+	tag->header_size += size;
+	return size;
+}
+
+static int64_t tag_header_get_pos(void *param)
+{
+	return (int64_t)((struct flv_tag *)param)->header_size;
+}
+
+static void tag_header_serializer_init(struct serializer *s, struct flv_tag *tag, struct encoder_packet *packet)
+{
+	memset(s, 0, sizeof(struct serializer));
+	tag->header_size = 0;
+	tag->payload = packet->data;
+	tag->payload_size = packet->size;
+
+	s->data = tag;
+	s->write = tag_header_write;
+	s->get_pos = tag_header_get_pos;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* writes the tag with the packet data, or just the part before it if payload
+ * is false */
+static void flv_video(struct serializer *s, int32_t dts_offset, struct encoder_packet *packet, bool is_header,
+		      bool payload)
 {
 	int32_t ct_offset_ms = get_ms_time(packet, packet->pts) - get_ms_time(packet, packet->dts);
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
@@ -333,12 +372,16 @@ static void flv_video(struct serializer *s, int32_t dts_offset, struct encoder_p
 	s_w8(s, packet->keyframe ? 0x17 : 0x27);
 	s_w8(s, is_header ? 0 : 1);
 	s_wb24(s, ct_offset_ms);
-	s_write(s, packet->data, packet->size);
 
+	if (!payload)
+		return;
+
+	s_write(s, packet->data, packet->size);
 	write_previous_tag_size(s);
 }
 
-static void flv_audio(struct serializer *s, int32_t dts_offset, struct encoder_packet *packet, bool is_header)
+static void flv_audio(struct serializer *s, int32_t dts_offset, struct encoder_packet *packet, bool is_header,
+		      bool payload)
 {
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
 
@@ -364,8 +407,11 @@ static void flv_audio(struct serializer *s, int32_t dts_offset, struct encoder_p
 	/* these are the two extra bytes mentioned above */
 	s_w8(s, 0xaf);
 	s_w8(s, is_header ? 0 : 1);
-	s_write(s, packet->data, packet->size);
 
+	if (!payload)
+		return;
+
+	s_write(s, packet->data, packet->size);
 	write_previous_tag_size(s);
 }
 
@@ -377,22 +423,29 @@ void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset, uint8_t *
 	array_output_serializer_init(&s, &data);
 
 	if (packet->type == OBS_ENCODER_VIDEO)
-		flv_video(&s, dts_offset, packet, is_header);
+		flv_video(&s, dts_offset, packet, is_header, true);
 	else
-		flv_audio(&s, dts_offset, packet, is_header);
+		flv_audio(&s, dts_offset, packet, is_header, true);
 
 	*output = data.bytes.array;
 	*size = data.bytes.num;
 }
 
-void flv_packet_audio_ex(struct encoder_packet *packet, enum audio_id_t codec_id, int32_t dts_offset, uint8_t **output,
-			 size_t *size, int type, size_t idx)
+void flv_tag_mux(struct flv_tag *tag, struct encoder_packet *packet, int32_t dts_offset, bool is_header)
 {
-	struct array_output_data data;
 	struct serializer s;
 
-	array_output_serializer_init(&s, &data);
+	tag_header_serializer_init(&s, tag, packet);
+
+	if (packet->type == OBS_ENCODER_VIDEO)
+		flv_video(&s, dts_offset, packet, is_header, false);
+	else
+		flv_audio(&s, dts_offset, packet, is_header, false);
+}
 
+static void flv_audio_ex(struct serializer *s, struct encoder_packet *packet, enum audio_id_t codec_id,
+			 int32_t dts_offset, int type, size_t idx, bool payload)
+{
 	assert(packet->type == OBS_ENCODER_AUDIO);
 
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
@@ -406,7 +459,7 @@ void flv_packet_audio_ex(struct encoder_packet *packet, enum audio_id_t codec_id
 	if (is_multitrack)
 		header_metadata_size += 2; // w8 + w8
 
-	s_w8(&s, RTMP_PACKET_TYPE_AUDIO);
+	s_w8(s, RTMP_PACKET_TYPE_AUDIO);
 
 #ifdef DEBUG_TIMESTAMPS
 	blog(LOG_DEBUG, "Audio: %lu", time_ms);
@@ -417,36 +470,53 @@ void flv_packet_audio_ex(struct encoder_packet *packet, enum audio_id_t codec_id
 	last_time = time_ms;
 #endif
 
-	s_wb24(&s, (uint32_t)packet->size + header_metadata_size);
-	s_wb24(&s, (uint32_t)time_ms);
-	s_w8(&s, (time_ms >> 24) & 0x7F);
-	s_wb24(&s, 0);
+	s_wb24(s, (uint32_t)packet->size + header_metadata_size);
+	s_wb24(s, (uint32_t)time_ms);
+	s_w8(s, (time_ms >> 24) & 0x7F);
+	s_wb24(s, 0);
 
-	s_w8(&s, AUDIO_HEADER_EX | (is_multitrack ? AUDIO_PACKETTYPE_MULTITRACK : type));
+	s_w8(s, AUDIO_HEADER_EX | (is_multitrack ? AUDIO_PACKETTYPE_MULTITRACK : type));
 	if (is_multitrack) {
-		s_w8(&s, MULTITRACKTYPE_ONE_TRACK | type);
-		s_wa4cc(&s, codec_id);
-		s_w8(&s, (uint8_t)idx);
+		s_w8(s, MULTITRACKTYPE_ONE_TRACK | type);
+		s_wa4cc(s, codec_id);
+		s_w8(s, (uint8_t)idx);
 	} else {
-		s_wa4cc(&s, codec_id);
+		s_wa4cc(s, codec_id);
 	}
 
-	s_write(&s, packet->data, packet->size);
+	if (!payload)
+		return;
 
-	write_previous_tag_size(&s);
+	s_write(s, packet->data, packet->size);
+	write_previous_tag_size(s);
+}
+
+void flv_packet_audio_ex(struct encoder_packet *packet, enum audio_id_t codec_id, int32_t dts_offset, uint8_t **output,
+			 size_t *size, int type, size_t idx)
+{
+	struct array_output_data data;
+	struct serializer s;
+
+	array_output_serializer_init(&s, &data);
+	flv_audio_ex(&s, packet, codec_id, dts_offset, type, idx, true);
 
 	*output = data.bytes.array;
 	*size = data.bytes.num;
 }
 
-// Y2023 spec
-void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id, int32_t dts_offset, uint8_t **output,
-		   size_t *size, int type, size_t idx)
+static void flv_tag_audio_ex(struct flv_tag *tag, struct encoder_packet *packet, enum audio_id_t codec_id,
+			     int32_t dts_offset, int type, size_t idx)
 {
-	struct array_output_data data;
 	struct serializer s;
-	array_output_serializer_init(&s, &data);
 
+	tag_header_serializer_init(&s, tag, packet);
+	flv_audio_ex(&s, packet, codec_id, dts_offset, type, idx, false);
+}
+
+// Y2023 spec
+static void flv_video_ex(struct serializer *s, struct encoder_packet *packet, enum video_id_t codec_id,
+			 int32_t dts_offset, int type, size_t idx, bool payload)
+{
 	assert(packet->type == OBS_ENCODER_VIDEO);
 
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
@@ -462,10 +532,10 @@ void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id, int3
 	if (is_multitrack)
 		header_metadata_size += 2; // w8+w8
 
-	s_w8(&s, RTMP_PACKET_TYPE_VIDEO);
-	s_wb24(&s, (uint32_t)packet->size + header_metadata_size);
-	s_wtimestamp(&s, time_ms);
-	s_wb24(&s, 0); // always 0
+	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
+	s_wb24(s, (uint32_t)packet->size + header_metadata_size);
+	s_wtimestamp(s, time_ms);
+	s_wb24(s, 0); // always 0
 
 	uint8_t frame_type = packet->keyframe ? FT_KEY : FT_INTER;
 
@@ -474,32 +544,63 @@ void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id, int3
 	 * The default trackId is 0.
 	 */
 	if (is_multitrack) {
-		s_w8(&s, FRAME_HEADER_EX | PACKETTYPE_MULTITRACK | frame_type);
-		s_w8(&s, MULTITRACKTYPE_ONE_TRACK | type);
-		s_w4cc(&s, codec_id);
+		s_w8(s, FRAME_HEADER_EX | PACKETTYPE_MULTITRACK | frame_type);
+		s_w8(s, MULTITRACKTYPE_ONE_TRACK | type);
+		s_w4cc(s, codec_id);
 		// trackId
-		s_w8(&s, (uint8_t)idx);
+		s_w8(s, (uint8_t)idx);
 	} else {
-		s_w8(&s, FRAME_HEADER_EX | type | frame_type);
-		s_w4cc(&s, codec_id);
+		s_w8(s, FRAME_HEADER_EX | type | frame_type);
+		s_w4cc(s, codec_id);
 	}
 
 	// H.264/HEVC composition time offset
 	if ((codec_id == CODEC_H264 || codec_id == CODEC_HEVC) && type == PACKETTYPE_FRAMES) {
 		int32_t ct_offset_ms = get_ms_time(packet, packet->pts) - get_ms_time(packet, packet->dts);
-		s_wb24(&s, ct_offset_ms);
+		s_wb24(s, ct_offset_ms);
 	}
 
+	if (!payload)
+		return;
+
 	// packet data
-	s_write(&s, packet->data, packet->size);
+	s_write(s, packet->data, packet->size);
 
 	// packet tail
-	write_previous_tag_size(&s);
+	write_previous_tag_size(s);
+}
+
+void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id, int32_t dts_offset, uint8_t **output,
+		   size_t *size, int type, size_t idx)
+{
+	struct array_output_data data;
+	struct serializer s;
+
+	array_output_serializer_init(&s, &data);
+	flv_video_ex(&s, packet, codec_id, dts_offset, type, idx, true);
 
 	*output = data.bytes.array;
 	*size = data.bytes.num;
 }
 
+static void flv_tag_ex(struct flv_tag *tag, struct encoder_packet *packet, enum video_id_t codec_id,
+		       int32_t dts_offset, int type, size_t idx)
+{
+	struct serializer s;
+
+	tag_header_serializer_init(&s, tag, packet);
+	flv_video_ex(&s, packet, codec_id, dts_offset, type, idx, false);
+}
+
+static inline int frames_packet_type(struct encoder_packet *packet, enum video_id_t codec)
+{
+	// PACKETTYPE_FRAMESX is an optimization to avoid sending composition
+	// time offsets of 0. See Enhanced RTMP spec.
+	if ((codec == CODEC_H264 || codec == CODEC_HEVC) && packet->dts == packet->pts)
+		return PACKETTYPE_FRAMESX;
+	return PACKETTYPE_FRAMES;
+}
+
 void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec, uint8_t **output, size_t *size, size_t idx)
 {
 	flv_packet_ex(packet, codec, 0, output, size, PACKETTYPE_SEQ_START, idx);
@@ -508,12 +609,7 @@ void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec, uint
 void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec, int32_t dts_offset, uint8_t **output,
 		       size_t *size, size_t idx)
 {
-	int packet_type = PACKETTYPE_FRAMES;
-	// PACKETTYPE_FRAMESX is an optimization to avoid sending composition
-	// time offsets of 0. See Enhanced RTMP spec.
-	if ((codec == CODEC_H264 || codec == CODEC_HEVC) && packet->dts == packet->pts)
-		packet_type = PACKETTYPE_FRAMESX;
-	flv_packet_ex(packet, codec, dts_offset, output, size, packet_type, idx);
+	flv_packet_ex(packet, codec, dts_offset, output, size, frames_packet_type(packet, codec), idx);
 }
 
 void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec, uint8_t **output, size_t *size, size_t idx)
@@ -533,6 +629,33 @@ void flv_packet_audio_frames(struct encoder_packet *packet, enum audio_id_t code
 	flv_packet_audio_ex(packet, codec, dts_offset, output, size, AUDIO_PACKETTYPE_FRAMES, idx);
 }
 
+void flv_tag_start(struct flv_tag *tag, struct encoder_packet *packet, enum video_id_t codec, size_t idx)
+{
+	flv_tag_ex(tag, packet, codec, 0, PACKETTYPE_SEQ_START, idx);
+}
+
+void flv_tag_frames(struct flv_tag *tag, struct encoder_packet *packet, enum video_id_t codec, int32_t dts_offset,
+		    size_t idx)
+{
+	flv_tag_ex(tag, packet, codec, dts_offset, frames_packet_type(packet, codec), idx);
+}
+
+void flv_tag_end(struct flv_tag *tag, struct encoder_packet *packet, enum video_id_t codec, size_t idx)
+{
+	flv_tag_ex(tag, packet, codec, 0, PACKETTYPE_SEQ_END, idx);
+}
+
+void flv_tag_audio_start(struct flv_tag *tag, struct encoder_packet *packet, enum audio_id_t codec, size_t idx)
+{
+	flv_tag_audio_ex(tag, packet, codec, 0, AUDIO_PACKETTYPE_SEQ_START, idx);
+}
+
+void flv_tag_audio_frames(struct flv_tag *tag, struct encoder_packet *packet, enum audio_id_t codec,
+			  int32_t dts_offset, size_t idx)
+{
+	flv_tag_audio_ex(tag, packet, codec, dts_offset, AUDIO_PACKETTYPE_FRAMES, idx);
+}
+
 void flv_packet_metadata(enum video_id_t codec_id, uint8_t **output, size_t *size, int bits_per_raw_sample,
 			 uint8_t color_primaries, int color_trc, int color_space, int min_luminance, int max_luminance,
 			 size_t idx)
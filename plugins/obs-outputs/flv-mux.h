@@ -60,6 +60,21 @@ static int32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 
 extern void write_file_info(FILE *file, int64_t duration_ms, int64_t size);
 
+/*
+ * An FLV tag with its payload referenced from the encoder packet instead of
+ * copied: header holds the 11 byte tag header and the codec specific bytes
+ * that precede the payload in the tag body.  There's no previous tag size.
+ * header_size is 0 if the packet has no data.
+ */
+#define FLV_TAG_HEADER_MAX_SIZE 32
+
+struct flv_tag {
+	uint8_t header[FLV_TAG_HEADER_MAX_SIZE];
+	size_t header_size;
+	const uint8_t *payload;
+	size_t payload_size;
+};
+
 extern void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size, bool write_header);
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset, uint8_t **output, size_t *size,
 			   bool is_header);
@@ -77,3 +92,14 @@ extern void flv_packet_audio_start(struct encoder_packet *packet, enum audio_id_
 				   size_t idx);
 extern void flv_packet_audio_frames(struct encoder_packet *packet, enum audio_id_t codec, int32_t dts_offset,
 				    uint8_t **output, size_t *size, size_t idx);
+
+// same as the above, without copying the packet data
+extern void flv_tag_mux(struct flv_tag *tag, struct encoder_packet *packet, int32_t dts_offset, bool is_header);
+extern void flv_tag_start(struct flv_tag *tag, struct encoder_packet *packet, enum video_id_t codec, size_t idx);
+extern void flv_tag_frames(struct flv_tag *tag, struct encoder_packet *packet, enum video_id_t codec,
+			   int32_t dts_offset, size_t idx);
+extern void flv_tag_end(struct flv_tag *tag, struct encoder_packet *packet, enum video_id_t codec, size_t idx);
+extern void flv_tag_audio_start(struct flv_tag *tag, struct encoder_packet *packet, enum audio_id_t codec,
+				size_t idx);
+extern void flv_tag_audio_frames(struct flv_tag *tag, struct encoder_packet *packet, enum audio_id_t codec,
+				 int32_t dts_offset, size_t idx);
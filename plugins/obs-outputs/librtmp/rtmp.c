@@ -173,6 +173,7 @@ static void HandleClientBW(RTMP *r, const RTMPPacket *packet);
 
 static int ReadN(RTMP *r, char *buffer, int n);
 static int WriteN(RTMP *r, const char *buffer, int n);
+static int WriteV(RTMP *r, RTMPIoVec *vec, int count);
 
 static void DecodeTEA(AVal *key, AVal *text);
 
@@ -1576,11 +1577,29 @@ ReadN(RTMP *r, char *buffer, int n)
     return nOriginalSize - n;
 }
 
+static void
+CloseAfterSendError(RTMP *r, int sockerr)
+{
+    struct linger l;
+
+    r->last_error_code = sockerr;
+
+    // Force-close the socket. Sometimes a send() error isn't fatal, so
+    // we could end up writing an unpublish message which some services
+    // treat as a clean shutdown. We need to disable lingering too so
+    // the remote side sees an abortive shutdown (RST).
+    l.l_onoff = 1;
+    l.l_linger = 0;
+    setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
+    RTMPSockBuf_Close(&r->m_sb);
+
+    RTMP_Close(r);
+}
+
 static int
 WriteN(RTMP *r, const char *buffer, int n)
 {
     const char *ptr = buffer;
-    struct linger l;
 
     while (n > 0)
     {
@@ -1592,6 +1611,7 @@ WriteN(RTMP *r, const char *buffer, int n)
             nBytes = r->m_customSendFunc(&r->m_sb, ptr, n, r->m_customSendParam);
         else
             nBytes = RTMPSockBuf_Send(&r->m_sb, ptr, n);
+        r->m_nSends++;
         /*RTMP_Log(RTMP_LOGDEBUG, "%s: %d\n", __FUNCTION__, nBytes); */
 
         if (nBytes < 0)
@@ -1603,18 +1623,7 @@ WriteN(RTMP *r, const char *buffer, int n)
             if (sockerr == EINTR && !RTMP_ctrlC)
                 continue;
 
-            r->last_error_code = sockerr;
-
-            // Force-close the socket. Sometimes a send() error isn't fatal, so
-            // we could end up writing an unpublish message which some services
-            // treat as a clean shutdown. We need to disable lingering too so
-            // the remote side sees an abortive shutdown (RST).
-            l.l_onoff = 1;
-            l.l_linger = 0;
-            setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
-            RTMPSockBuf_Close(&r->m_sb);
-
-            RTMP_Close(r);
+            CloseAfterSendError(r, sockerr);
             n = 1;
             break;
         }
@@ -1629,6 +1638,135 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+/* copies the pieces into one buffer that is kept for the next call */
+static char *
+CoalesceV(RTMP *r, const RTMPIoVec *vec, int count, int *total)
+{
+    int i, size = 0;
+    char *ptr;
+
+    for (i = 0; i < count; i++)
+        size += vec[i].len;
+
+    if (size > r->m_writeVBufSize)
+    {
+        char *buf = realloc(r->m_writeVBuf, size);
+        if (!buf)
+            return NULL;
+
+        r->m_writeVBuf = buf;
+        r->m_writeVBufSize = size;
+    }
+
+    for (i = 0, ptr = r->m_writeVBuf; i < count; i++)
+    {
+        memcpy(ptr, vec[i].data, vec[i].len);
+        ptr += vec[i].len;
+    }
+    r->m_nBytesCopied += size;
+
+    *total = size;
+    return r->m_writeVBuf;
+}
+
+/* vec is modified to skip what has been sent */
+static int
+WriteV(RTMP *r, RTMPIoVec *vec, int count)
+{
+    /* the custom send function queues all pieces with one call */
+    if (r->m_bCustomSend && r->m_customSendVFunc &&
+            !(r->Link.protocol & RTMP_FEATURE_HTTP))
+    {
+        int i, total = 0;
+
+        for (i = 0; i < count; i++)
+            total += vec[i].len;
+
+        return r->m_customSendVFunc(&r->m_sb, vec, count, r->m_customSendParam) == total;
+    }
+
+    /* the HTTP tunnel, TLS and the plain custom send function need the data
+     * in one buffer */
+    if ((r->Link.protocol & RTMP_FEATURE_HTTP)
+#if defined(CRYPTO) && !defined(NO_SSL)
+            || r->m_sb.sb_ssl
+#endif
+            || (r->m_bCustomSend && r->m_customSendFunc))
+    {
+        int total;
+        char *buf = CoalesceV(r, vec, count, &total);
+
+        if (!buf)
+            return FALSE;
+
+        return WriteN(r, buf, total);
+    }
+
+    while (count > 0)
+    {
+        int i, nBytes;
+#ifdef _WIN32
+        WSABUF bufs[RTMP_WRITEV_MAX];
+        DWORD sent = 0;
+
+        for (i = 0; i < count; i++)
+        {
+            bufs[i].buf = (char *)vec[i].data;
+            bufs[i].len = (ULONG)vec[i].len;
+        }
+
+        nBytes = WSASend(r->m_sb.sb_socket, bufs, (DWORD)count, &sent, 0, NULL, NULL) == 0 ? (int)sent : -1;
+#else
+        struct iovec iov[RTMP_WRITEV_MAX];
+        struct msghdr msg;
+
+        for (i = 0; i < count; i++)
+        {
+            iov[i].iov_base = (void *)vec[i].data;
+            iov[i].iov_len = (size_t)vec[i].len;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        nBytes = (int)sendmsg(r->m_sb.sb_socket, &msg, MSG_NOSIGNAL);
+#endif
+        r->m_nSends++;
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d buffers)", __FUNCTION__,
+                     sockerr, count);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            CloseAfterSendError(r, sockerr);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        /* a partial send can end inside of a buffer */
+        while (count > 0 && nBytes >= vec->len)
+        {
+            nBytes -= vec->len;
+            vec++;
+            count--;
+        }
+        if (count > 0)
+        {
+            vec->data += nBytes;
+            vec->len -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -4085,18 +4223,11 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* picks the smallest header type the previous packet on the channel allows */
+static int
+PrepareOutHeader(RTMP *r, RTMPPacket *packet, uint32_t *last)
 {
     const RTMPPacket *prevPacket;
-    uint32_t last = 0;
-    int nSize;
-    int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
-    uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4135,7 +4266,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         if (delta == prevPacket->m_nLastWireTimeStamp
             && packet->m_headerType == RTMP_PACKET_SIZE_SMALL)
             packet->m_headerType = RTMP_PACKET_SIZE_MINIMUM;
-        last = prevPacket->m_nTimeStamp;
+        *last = prevPacket->m_nTimeStamp;
     }
 
     if (packet->m_headerType > 3)	/* sanity */
@@ -4145,6 +4276,33 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         return FALSE;
     }
 
+    return TRUE;
+}
+
+/* the next packet on the channel is compressed against this one */
+static void
+RememberOutPacket(RTMP *r, const RTMPPacket *packet)
+{
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    uint32_t last = 0;
+    int nSize;
+    int hSize, cSize;
+    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    uint32_t t;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (!PrepareOutHeader(r, packet, &last))
+        return FALSE;
+
     nSize = packetSize[packet->m_headerType];
     hSize = nSize;
     cSize = 0;
@@ -4249,6 +4407,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         {
             memcpy(toff, header, nChunkSize + hSize);
             toff += nChunkSize + hSize;
+            r->m_nBytesCopied += nChunkSize;
         }
         else
         {
@@ -4314,9 +4473,147 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         }
     }
 
-    if (!r->m_vecChannelsOut[packet->m_nChannel])
-        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
-    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    RememberOutPacket(r, packet);
+    return TRUE;
+}
+
+int
+RTMP_SendPacketV(RTMP *r, RTMPPacket *packet, const RTMPIoVec *body, int count)
+{
+    RTMPIoVec out[RTMP_WRITEV_MAX];
+    char hbuf[RTMP_MAX_HEADER_SIZE], cbuf[8], *hptr, c;
+    uint32_t last = 0, t, remaining;
+    int nSize, hSize, cSize = 0, contSize;
+    int nChunkSize, chunkLeft;
+    int nOut = 0, idx = 0, offset = 0;
+
+    if (!PrepareOutHeader(r, packet, &last))
+        return FALSE;
+
+    nSize = packetSize[packet->m_headerType];
+    t = packet->m_nTimeStamp - last;
+    packet->m_nLastWireTimeStamp = t;
+
+    if (packet->m_nChannel > 319)
+        cSize = 2;
+    else if (packet->m_nChannel > 63)
+        cSize = 1;
+
+    c = packet->m_headerType << 6;
+    switch (cSize)
+    {
+    case 0:
+        c |= packet->m_nChannel;
+        break;
+    case 1:
+        break;
+    case 2:
+        c |= 1;
+        break;
+    }
+
+    /* same layout as the header RTMP_SendPacket writes in front of the body */
+    hptr = hbuf;
+    *hptr++ = c;
+    if (cSize)
+    {
+        int tmp = packet->m_nChannel - 64;
+        *hptr++ = tmp & 0xff;
+        if (cSize == 2)
+            *hptr++ = tmp >> 8;
+    }
+
+    if (nSize > 1)
+        hptr = AMF_EncodeInt24(hptr, hbuf + sizeof(hbuf), t > 0xffffff ? 0xffffff : t);
+
+    if (nSize > 4)
+    {
+        hptr = AMF_EncodeInt24(hptr, hbuf + sizeof(hbuf), packet->m_nBodySize);
+        *hptr++ = packet->m_packetType;
+    }
+
+    if (nSize > 8)
+        hptr += EncodeInt32LE(hptr, packet->m_nInfoField2);
+
+    if (nSize > 1 && t >= 0xffffff)
+        hptr = AMF_EncodeInt32(hptr, hbuf + sizeof(hbuf), t);
+
+    hSize = (int)(hptr - hbuf);
+
+    /* all remaining chunks of the message start with the same type 3 header */
+    hptr = cbuf;
+    *hptr++ = (0xc0 | c);
+    if (cSize)
+    {
+        int tmp = packet->m_nChannel - 64;
+        *hptr++ = tmp & 0xff;
+        if (cSize == 2)
+            *hptr++ = tmp >> 8;
+    }
+    if (t >= 0xffffff)
+        hptr = AMF_EncodeInt32(hptr, cbuf + sizeof(cbuf), t);
+
+    contSize = (int)(hptr - cbuf);
+
+    RTMP_Log(RTMP_LOGDEBUG2, "%s: fd=%d, size=%u", __FUNCTION__, (int)r->m_sb.sb_socket,
+             packet->m_nBodySize);
+
+    out[nOut].data = hbuf;
+    out[nOut++].len = hSize;
+
+    nChunkSize = r->m_outChunkSize;
+    chunkLeft = nChunkSize;
+    remaining = packet->m_nBodySize;
+
+    while (remaining > 0 && idx < count)
+    {
+        int len = body[idx].len - offset;
+
+        if (len > chunkLeft)
+            len = chunkLeft;
+        if ((uint32_t)len > remaining)
+            len = (int)remaining;
+
+        if (len > 0)
+        {
+            out[nOut].data = body[idx].data + offset;
+            out[nOut++].len = len;
+            offset += len;
+            chunkLeft -= len;
+            remaining -= len;
+        }
+
+        if (offset == body[idx].len)
+        {
+            idx++;
+            offset = 0;
+        }
+
+        if (chunkLeft == 0 && remaining > 0)
+        {
+            out[nOut].data = cbuf;
+            out[nOut++].len = contSize;
+            chunkLeft = nChunkSize;
+        }
+
+        if (nOut >= RTMP_WRITEV_MAX - 2)
+        {
+            if (!WriteV(r, out, nOut))
+                return FALSE;
+            nOut = 0;
+        }
+    }
+
+    if (remaining > 0)
+    {
+        RTMP_Log(RTMP_LOGERROR, "%s, body is %u bytes short", __FUNCTION__, remaining);
+        return FALSE;
+    }
+
+    if (nOut && !WriteV(r, out, nOut))
+        return FALSE;
+
+    RememberOutPacket(r, packet);
     return TRUE;
 }
 
@@ -4372,6 +4669,10 @@ RTMP_Close(RTMP *r)
     r->m_write.m_nBytesRead = 0;
     RTMPPacket_Free(&r->m_write);
 
+    free(r->m_writeVBuf);
+    r->m_writeVBuf = NULL;
+    r->m_writeVBufSize = 0;
+
     for (i = 0; i < r->m_channelsAllocatedIn; i++)
     {
         if (r->m_vecChannelsIn[i])
@@ -4420,6 +4721,7 @@ RTMP_Close(RTMP *r)
     memset (&r->m_bindIP, 0, sizeof(r->m_bindIP));
     r->m_bCustomSend = 0;
     r->m_customSendFunc = NULL;
+    r->m_customSendVFunc = NULL;
     r->m_customSendParam = NULL;
 
 #if defined(CRYPTO) || defined(USE_ONLY_MD5)
@@ -5375,6 +5677,7 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
         if (num > s2)
             num = s2;
         memcpy(enc, buf, num);
+        r->m_nBytesCopied += num;
         pkt->m_nBytesRead += num;
         s2 -= num;
         buf += num;
@@ -5393,3 +5696,55 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+int
+RTMP_WriteV(RTMP *r, const RTMPIoVec *vec, int count, int streamIdx)
+{
+    RTMPIoVec body[RTMP_WRITEV_MAX];
+    RTMPPacket packet;
+    const unsigned char *buf;
+    int i, size = 0;
+
+    if (count < 1 || count > RTMP_WRITEV_MAX || vec[0].len < 11)
+    {
+        /* FLV pkt too small */
+        return 0;
+    }
+
+    buf = (const unsigned char *)vec[0].data;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_packetType = buf[0];
+    packet.m_nBodySize = AMF_DecodeInt24((const char *)buf + 1);
+    packet.m_nTimeStamp = AMF_DecodeInt24((const char *)buf + 4);
+    packet.m_nTimeStamp |= (uint32_t)buf[7] << 24;
+
+    if (((packet.m_packetType == RTMP_PACKET_TYPE_AUDIO
+            || packet.m_packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !packet.m_nTimeStamp) || packet.m_packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    /* the rest of the first piece is the start of the body */
+    body[0].data = vec[0].data + 11;
+    body[0].len = vec[0].len - 11;
+
+    for (i = 0; i < count; i++)
+    {
+        size += vec[i].len;
+        if (i > 0)
+            body[i] = vec[i];
+    }
+
+    if (!RTMP_SendPacketV(r, &packet, body, count))
+        return -1;
+
+    return size;
+}
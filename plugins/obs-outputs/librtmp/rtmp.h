@@ -275,6 +275,16 @@ extern "C"
         void *sb_ssl;
     } RTMPSockBuf;
 
+    /* a piece of an FLV tag or RTMP message body for RTMP_WriteV and
+     * RTMP_SendPacketV */
+    typedef struct RTMPIoVec
+    {
+        const char *data;
+        int len;
+    } RTMPIoVec;
+
+#define RTMP_WRITEV_MAX	64	/* max number of pieces per call */
+
     void RTMPPacket_Reset(RTMPPacket *p);
     void RTMPPacket_Dump(RTMPPacket *p);
     int RTMPPacket_Alloc(RTMPPacket *p, uint32_t nSize);
@@ -396,6 +406,8 @@ extern "C"
     } RTMP_BINDINFO;
 
     typedef int (*CUSTOMSEND)(RTMPSockBuf*, const char *, int, void*);
+    /* optional, sends all pieces at once and returns the total length */
+    typedef int (*CUSTOMSENDV)(RTMPSockBuf*, const RTMPIoVec *, int, void*);
 
     typedef struct RTMP
     {
@@ -421,6 +433,7 @@ extern "C"
         uint8_t m_bCustomSend;
         void*   m_customSendParam;
         CUSTOMSEND m_customSendFunc;
+        CUSTOMSENDV m_customSendVFunc;
 
         RTMP_BINDINFO m_bindIP;
 
@@ -454,6 +467,10 @@ extern "C"
         RTMP_LNK Link;
         int connect_time_ms;
         int last_error_code;
+        uint64_t m_nBytesCopied;	/* message bytes copied before sending */
+        uint64_t m_nSends;		/* send calls made by WriteN/WriteV */
+        char *m_writeVBuf;		/* reused by WriteV to coalesce pieces */
+        int m_writeVBufSize;
 
 #ifdef CRYPTO
         TLS_CTX RTMP_TLS_ctx;
@@ -495,6 +512,8 @@ extern "C"
 
     int RTMP_ReadPacket(RTMP *r, RTMPPacket *packet);
     int RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue);
+    int RTMP_SendPacketV(RTMP *r, RTMPPacket *packet, const RTMPIoVec *body,
+                         int count);
     int RTMP_SendChunk(RTMP *r, RTMPChunk *chunk);
     int RTMP_IsConnected(RTMP *r);
     SOCKET RTMP_Socket(RTMP *r);
@@ -543,6 +562,11 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    /* Sends one complete FLV tag like RTMP_Write, without the previous tag
+     * size.  The first piece has to contain at least the 11 byte tag header.
+     * Where possible the pieces are sent with a single gathering write per
+     * batch of chunks instead of being copied into the packet first. */
+    int RTMP_WriteV(RTMP *r, const RTMPIoVec *vec, int count, int streamIdx);
 
 #ifdef USE_HASHSWF
     /* hashswf.c */
@@ -48,6 +48,7 @@ struct mp4_output {
 	/* File serializer buffer configuration */
 	size_t buffer_size;
 	size_t chunk_size;
+	int serializer_flags;
 	struct serializer serializer;
 
 	bool enable_bpm;
@@ -161,7 +162,7 @@ void mp4_pkt_callback(obs_output_t *output, struct encoder_packet *pkt, struct e
 		int hours = (int)chap_dts_sec / 3600;
 		info("Adding chapter \"%s\" at %02d:%02d:%02d.%03d", chap->name, hours, minutes, seconds, milliseconds);
 
-		mp4_mux_add_chapter(out->muxer, chap_dts_usec, chap->name);
+		mp4_mux_add_chapter(out->muxer, chap_dts_usec, chap->name, obs_module_text("MP4Output.StartChapter"));
 		/* Free name and remove chapter from queue. */
 		bfree(chap->name);
 		deque_pop_front(&out->chapters, NULL, sizeof(struct chapter));
@@ -245,6 +246,8 @@ static void parse_custom_options(struct mp4_output *out, const char *opts_str)
 
 	struct obs_options opts = obs_parse_options(opts_str);
 
+	out->serializer_flags = 0;
+
 	for (size_t i = 0; i < opts.count; i++) {
 		struct obs_option opt = opts.options[i];
 
@@ -260,6 +263,10 @@ static void parse_custom_options(struct mp4_output *out, const char *opts_str)
 			out->buffer_size = strtoull(opt.value, 0, 10) * 1048576ULL;
 		} else if (strcmp(opt.name, "chunk_size") == 0) {
 			out->chunk_size = strtoull(opt.value, 0, 10) * 1048576ULL;
+		} else if (strcmp(opt.name, "io_uring") == 0) {
+			apply_flag(&out->serializer_flags, opt.value, BUFFERED_FILE_SERIALIZER_IO_URING);
+		} else if (strcmp(opt.name, "direct_io") == 0) {
+			apply_flag(&out->serializer_flags, opt.value, BUFFERED_FILE_SERIALIZER_DIRECT_IO);
 		} else if (strcmp(opt.name, "bpm") == 0) {
 			out->enable_bpm = !!atoi(opt.value);
 		} else {
@@ -313,7 +320,8 @@ static bool mp4_output_start(void *data)
 		obs_output_add_packet_callback(out->output, bpm_inject, NULL);
 	}
 
-	if (!buffered_file_serializer_init(&out->serializer, out->path.array, out->buffer_size, out->chunk_size)) {
+	if (!buffered_file_serializer_init2(&out->serializer, out->path.array, out->buffer_size, out->chunk_size,
+					   (uint32_t)out->serializer_flags)) {
 		warn("Unable to open file '%s'", out->path.array);
 		return false;
 	}
@@ -431,7 +439,8 @@ static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
 	generate_filename(out, &out->path, out->allow_overwrite);
 	info("Changing output file to '%s'", out->path.array);
 
-	if (!buffered_file_serializer_init(&out->serializer, out->path.array, out->buffer_size, out->chunk_size)) {
+	if (!buffered_file_serializer_init2(&out->serializer, out->path.array, out->buffer_size, out->chunk_size,
+					   (uint32_t)out->serializer_flags)) {
 		warn("Unable to open file '%s'", out->path.array);
 		return false;
 	}
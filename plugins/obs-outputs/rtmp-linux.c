@@ -0,0 +1,272 @@
+#ifdef __linux__
+#include "rtmp-stream.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/sockios.h>
+
+#ifndef SO_MAX_PACING_RATE
+#define SO_MAX_PACING_RATE 47
+#endif
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+#ifndef SIOCOUTQNSD
+#define SIOCOUTQNSD 0x894B
+#endif
+
+/* the kernel only reports the socket as writable while it holds less than
+ * 1/LATENCY_FACTOR seconds of unsent data, so the backlog stays in the write
+ * buffer where congestion handling can see it */
+#define LATENCY_FACTOR 20
+#define MIN_NOTSENT_LOWAT (16 * 1024)
+
+/* while the send thread is still queueing a packet, wait for more of it
+ * before sending unless this much is already buffered, or nothing new arrives
+ * within COALESCE_WAIT_MS (for example when it waits for buffer space) */
+#define COALESCE_SIZE (64 * 1024)
+#define COALESCE_WAIT_MS 5
+
+#define POLL_TIMEOUT_MS 50
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+size_t rtmp_linux_unsent_bytes(struct rtmp_stream *stream)
+{
+	int unsent = 0;
+
+	if (ioctl(stream->rtmp.m_sb.sb_socket, SIOCOUTQNSD, &unsent) != 0 || unsent < 0)
+		return 0;
+	return (size_t)unsent;
+}
+
+static void setup_socket(struct rtmp_stream *stream)
+{
+	int fd = stream->rtmp.m_sb.sb_socket;
+	int bytes_per_sec = stream->total_bitrate * 1000 / 8;
+	int lowat = bytes_per_sec / LATENCY_FACTOR;
+
+	if (lowat < MIN_NOTSENT_LOWAT)
+		lowat = MIN_NOTSENT_LOWAT;
+
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) == 0)
+		blog(LOG_INFO, "socket_thread_linux: Unsent data limited to %d bytes", lowat);
+	else
+		blog(LOG_WARNING, "socket_thread_linux: Failed to set TCP_NOTSENT_LOWAT, errno %d", errno);
+
+	if (stream->low_latency_mode) {
+		/* leave headroom for keyframes and for catching up */
+		unsigned int rate = (unsigned int)bytes_per_sec + (unsigned int)bytes_per_sec / 2;
+
+		if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) == 0)
+			blog(LOG_INFO, "socket_thread_linux: Pacing rate set to %u bytes/sec", rate);
+		else
+			blog(LOG_WARNING, "socket_thread_linux: Failed to set SO_MAX_PACING_RATE, errno %d", errno);
+	}
+}
+
+/* pushes out data that an earlier MSG_MORE send left in a partial segment */
+static inline void flush_corked(struct rtmp_stream *stream)
+{
+	int off = 0;
+	setsockopt(stream->rtmp.m_sb.sb_socket, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+}
+
+static bool discard_input(struct rtmp_stream *stream)
+{
+	char discard[16384];
+
+	for (;;) {
+		ssize_t ret = recv(stream->rtmp.m_sb.sb_socket, discard, sizeof(discard), MSG_DONTWAIT);
+		if (ret > 0)
+			continue;
+
+		if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		if (ret == -1 && errno == EINTR)
+			continue;
+
+		int err_code = ret == 0 ? 0 : errno;
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Socket error, recv() returned "
+		     "%zd, errno %d",
+		     ret, err_code);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+}
+
+enum data_ret { RET_BREAK, RET_FATAL, RET_CONTINUE };
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *corked)
+{
+	struct rtmp_send_stats stats = {0};
+	bool more = os_atomic_load_bool(&stream->write_more);
+	uint64_t start;
+	ssize_t ret;
+	int err_code = 0;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (!stream->write_buf_len) {
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+	}
+
+	stats.max_buffered = stream->write_buf_len;
+	stats.sends = 1;
+
+	start = os_gettime_ns();
+	ret = send(stream->rtmp.m_sb.sb_socket, stream->write_buf, stream->write_buf_len,
+		   MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+	if (ret == -1)
+		err_code = errno;
+	stats.send_ns = os_gettime_ns() - start;
+
+	if (ret > 0) {
+		if (stream->write_buf_len - ret)
+			memmove(stream->write_buf, stream->write_buf + ret, stream->write_buf_len - ret);
+		stream->write_buf_len -= ret;
+		stats.bytes_sent = (uint64_t)ret;
+		*corked = more;
+
+		os_event_signal(stream->buffer_space_available_event);
+	}
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (ret > 0) {
+		stats.max_unsent = rtmp_linux_unsent_bytes(stream);
+		rtmp_send_stats_add(stream, &stats);
+		return RET_CONTINUE;
+	}
+
+	if (ret == -1 && (err_code == EAGAIN || err_code == EWOULDBLOCK || err_code == EINTR)) {
+		stats.would_block = 1;
+		rtmp_send_stats_add(stream, &stats);
+		return RET_BREAK;
+	}
+
+	/* connection closed, or connection was aborted / socket closed /
+	 * etc, that's a fatal error. */
+	blog(LOG_ERROR,
+	     "socket_thread_linux: Socket error, send() returned %zd, "
+	     "errno %d",
+	     ret, err_code);
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+	stream->rtmp.last_error_code = err_code;
+	fatal_sock_shutdown(stream);
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+	return RET_FATAL;
+}
+
+static inline size_t get_buffered(struct rtmp_stream *stream)
+{
+	size_t len;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+	len = stream->write_buf_len;
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+	return len;
+}
+
+static inline void socket_thread_linux_internal(struct rtmp_stream *stream)
+{
+	bool corked = false;
+
+	setup_socket(stream);
+
+	for (;;) {
+		size_t buffered = get_buffered(stream);
+		bool more = os_atomic_load_bool(&stream->write_more);
+
+		if (!buffered) {
+			if (corked && !more) {
+				flush_corked(stream);
+				corked = false;
+			}
+
+			if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+				os_event_reset(stream->send_thread_signaled_exit);
+				break;
+			}
+
+			os_event_timedwait(stream->buffer_has_data_event, POLL_TIMEOUT_MS);
+			continue;
+		}
+
+		/* the rest of the packet follows right away, so send it as
+		 * one batch of full segments */
+		if (more && buffered < COALESCE_SIZE &&
+		    os_event_timedwait(stream->buffer_has_data_event, COALESCE_WAIT_MS) == 0)
+			continue;
+
+		struct pollfd pfd = {.fd = stream->rtmp.m_sb.sb_socket, .events = POLLOUT | POLLIN};
+		int ret = poll(&pfd, 1, POLL_TIMEOUT_MS);
+
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due to poll failure, errno %d", errno);
+			fatal_sock_shutdown(stream);
+			return;
+		}
+
+		if (ret == 0)
+			continue;
+
+		if ((pfd.revents & POLLIN) && !discard_input(stream))
+			return;
+
+		if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+			int err_code = 0;
+			socklen_t size = sizeof(err_code);
+
+			getsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_ERROR, &err_code, &size);
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due to socket "
+			     "error %d (buffer: %zu / %zu)",
+			     err_code, buffered, stream->write_buf_size);
+			stream->rtmp.last_error_code = err_code;
+			fatal_sock_shutdown(stream);
+			return;
+		}
+
+		if (!(pfd.revents & POLLOUT))
+			continue;
+
+		for (;;) {
+			enum data_ret data_ret = write_data(stream, &corked);
+
+			if (data_ret == RET_FATAL)
+				return;
+			if (data_ret == RET_BREAK)
+				break;
+		}
+	}
+
+	blog(LOG_INFO, "socket_thread_linux: Normal exit");
+}
+
+void *socket_thread_linux(void *data)
+{
+	struct rtmp_stream *stream = data;
+
+	os_set_thread_name("rtmp-stream: socket_thread");
+	socket_thread_linux_internal(stream);
+	return NULL;
+}
+#endif
@@ -142,12 +142,112 @@ static void rtmp_stream_destroy(void *data)
 	os_event_destroy(stream->socket_available_event);
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
+	pthread_mutex_destroy(&stream->send_stats_mutex);
 
 	if (stream->write_buf)
 		bfree(stream->write_buf);
 	bfree(stream);
 }
 
+static inline uint64_t get_total_bytes_copied(struct rtmp_stream *stream)
+{
+	return stream->total_bytes_copied + stream->rtmp.m_nBytesCopied;
+}
+
+static void get_send_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_stream *stream = data;
+
+	calldata_set_int(cd, "bytes_sent", (long long)stream->total_bytes_sent);
+	calldata_set_int(cd, "bytes_copied", (long long)get_total_bytes_copied(stream));
+}
+
+static void merge_send_stats(struct rtmp_send_stats *dst, const struct rtmp_send_stats *src)
+{
+	dst->bytes_sent += src->bytes_sent;
+	dst->sends += src->sends;
+	dst->would_block += src->would_block;
+	dst->send_ns += src->send_ns;
+
+	if (src->max_buffered > dst->max_buffered)
+		dst->max_buffered = src->max_buffered;
+	if (src->max_unsent > dst->max_unsent)
+		dst->max_unsent = src->max_unsent;
+	if (src->max_queued_packets > dst->max_queued_packets)
+		dst->max_queued_packets = src->max_queued_packets;
+}
+
+/* call with send_stats_mutex held */
+static void roll_send_stats(struct rtmp_stream *stream, uint64_t now)
+{
+	uint64_t elapsed = now - stream->send_stats_start;
+
+	if (elapsed < 1000000000ULL)
+		return;
+
+	/* nothing was sent during the last full second */
+	if (elapsed >= 2000000000ULL)
+		memset(&stream->send_stats_prev, 0, sizeof(stream->send_stats_prev));
+	else
+		stream->send_stats_prev = stream->send_stats_cur;
+
+	memset(&stream->send_stats_cur, 0, sizeof(stream->send_stats_cur));
+	stream->send_stats_start = now;
+}
+
+void rtmp_send_stats_add(struct rtmp_stream *stream, const struct rtmp_send_stats *stats)
+{
+	pthread_mutex_lock(&stream->send_stats_mutex);
+	roll_send_stats(stream, os_gettime_ns());
+	merge_send_stats(&stream->send_stats_cur, stats);
+	merge_send_stats(&stream->send_stats_total, stats);
+	pthread_mutex_unlock(&stream->send_stats_mutex);
+}
+
+static inline void reset_send_stats(struct rtmp_stream *stream)
+{
+	pthread_mutex_lock(&stream->send_stats_mutex);
+	memset(&stream->send_stats_cur, 0, sizeof(stream->send_stats_cur));
+	memset(&stream->send_stats_prev, 0, sizeof(stream->send_stats_prev));
+	memset(&stream->send_stats_total, 0, sizeof(stream->send_stats_total));
+	stream->send_stats_start = os_gettime_ns();
+	pthread_mutex_unlock(&stream->send_stats_mutex);
+}
+
+static void log_send_stats(struct rtmp_stream *stream)
+{
+	struct rtmp_send_stats total;
+
+	pthread_mutex_lock(&stream->send_stats_mutex);
+	total = stream->send_stats_total;
+	pthread_mutex_unlock(&stream->send_stats_mutex);
+
+	info("Send stats: %" PRIu64 " sends (%" PRIu64 " would block), %.1f ms in send(), "
+	     "max %zu bytes buffered, max %zu bytes unsent in the kernel, max %zu packets queued",
+	     total.sends, total.would_block, (double)total.send_ns / 1000000.0, total.max_buffered,
+	     total.max_unsent, total.max_queued_packets);
+}
+
+/* statistics of the last full second */
+static void get_send_rate_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_stream *stream = data;
+	struct rtmp_send_stats stats;
+
+	pthread_mutex_lock(&stream->send_stats_mutex);
+	roll_send_stats(stream, os_gettime_ns());
+	stats = stream->send_stats_prev;
+	pthread_mutex_unlock(&stream->send_stats_mutex);
+
+	calldata_set_int(cd, "bytes_sent", (long long)stats.bytes_sent);
+	calldata_set_int(cd, "sends", (long long)stats.sends);
+	calldata_set_int(cd, "would_block", (long long)stats.would_block);
+	calldata_set_int(cd, "send_time_us", (long long)(stats.send_ns / 1000));
+	calldata_set_int(cd, "max_buffered", (long long)stats.max_buffered);
+	calldata_set_int(cd, "max_unsent", (long long)stats.max_unsent);
+	calldata_set_int(cd, "max_queued_packets", (long long)stats.max_queued_packets);
+}
+
 static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
@@ -172,6 +272,11 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
+	if (pthread_mutex_init(&stream->send_stats_mutex, NULL) != 0) {
+		warn("Failed to initialize send stats mutex");
+		goto fail;
+	}
+
 	if (os_event_init(&stream->buffer_space_available_event, OS_EVENT_TYPE_AUTO) != 0) {
 		warn("Failed to initialize write buffer event");
 		goto fail;
@@ -189,6 +294,15 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph, "void get_send_stats(out int bytes_sent, out int bytes_copied)", get_send_stats_proc,
+			 stream);
+	proc_handler_add(ph,
+			 "void get_send_rate_stats(out int bytes_sent, out int sends, "
+			 "out int would_block, out int send_time_us, out int max_buffered, "
+			 "out int max_unsent, out int max_queued_packets)",
+			 get_send_rate_stats_proc, stream);
+
 	UNUSED_PARAMETER(settings);
 	return stream;
 
@@ -228,11 +342,12 @@ static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
 	val->av_len = valid ? (int)str->len : 0;
 }
 
-static inline bool get_next_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
+static inline bool get_next_packet(struct rtmp_stream *stream, struct encoder_packet *packet, size_t *num_queued)
 {
 	bool new_packet = false;
 
 	pthread_mutex_lock(&stream->packets_mutex);
+	*num_queued = stream->packets.size / sizeof(struct encoder_packet);
 	if (stream->packets.size) {
 		deque_pop_front(&stream->packets, packet, sizeof(struct encoder_packet));
 		new_packet = true;
@@ -341,41 +456,80 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
+/* returns with write_buf_mutex locked once len bytes fit into the buffer */
+static bool lock_write_buf_space(struct rtmp_stream *stream, size_t len)
+{
+	for (;;) {
+		if (!RTMP_IsConnected(&stream->rtmp))
+			return false;
+
+		pthread_mutex_lock(&stream->write_buf_mutex);
+
+		if (stream->write_buf_len + len <= stream->write_buf_size)
+			return true;
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+
+		if (os_event_wait(stream->buffer_space_available_event))
+			return false;
+	}
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len, void *arg)
 {
 	UNUSED_PARAMETER(sb);
 
 	struct rtmp_stream *stream = arg;
 
-retry_send:
-
-	if (!RTMP_IsConnected(&stream->rtmp))
+	if (!lock_write_buf_space(stream, len))
 		return 0;
 
-	pthread_mutex_lock(&stream->write_buf_mutex);
+	memcpy(stream->write_buf + stream->write_buf_len, data, len);
+	stream->write_buf_len += len;
+	stream->total_bytes_copied += len;
 
-	if (stream->write_buf_len + len > stream->write_buf_size) {
+	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-		pthread_mutex_unlock(&stream->write_buf_mutex);
+	os_event_signal(stream->buffer_has_data_event);
 
-		if (os_event_wait(stream->buffer_space_available_event)) {
-			return 0;
-		}
+	return len;
+}
+
+/* queues the chunks of a packet with one lock and one wakeup */
+static int socket_queue_datav(RTMPSockBuf *sb, const RTMPIoVec *vec, int count, void *arg)
+{
+	struct rtmp_stream *stream = arg;
+	size_t total = 0;
+
+	for (int i = 0; i < count; i++)
+		total += vec[i].len;
 
-		goto retry_send;
+	/* would never fit at once, so let the send thread drain in between */
+	if (total > stream->write_buf_size) {
+		for (int i = 0; i < count; i++) {
+			if (socket_queue_data(sb, vec[i].data, vec[i].len, arg) != vec[i].len)
+				return 0;
+		}
+		return (int)total;
 	}
 
-	memcpy(stream->write_buf + stream->write_buf_len, data, len);
-	stream->write_buf_len += len;
+	if (!lock_write_buf_space(stream, total))
+		return 0;
+
+	for (int i = 0; i < count; i++) {
+		memcpy(stream->write_buf + stream->write_buf_len, vec[i].data, vec[i].len);
+		stream->write_buf_len += vec[i].len;
+	}
+	stream->total_bytes_copied += total;
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
 	os_event_signal(stream->buffer_has_data_event);
 
-	return len;
+	return (int)total;
 }
-#endif // _WIN32
+#endif
 
 static int handle_socket_read(struct rtmp_stream *stream)
 {
@@ -396,84 +550,92 @@ static int handle_socket_read(struct rtmp_stream *stream)
 	return 0;
 }
 
-static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header)
+/* the tag payload is sent straight from the encoder packet */
+static int send_flv_tag(struct rtmp_stream *stream, const struct flv_tag *tag)
 {
-	uint8_t *data;
+	RTMPIoVec vec[2];
 	size_t size;
-	int ret = 0;
 
-	if (handle_socket_read(stream))
-		return -1;
+	if (!tag->header_size)
+		return 0;
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data, &size, is_header);
+	/* includes the previous tag size, like the muxed FLV data */
+	size = tag->header_size + tag->payload_size + 4;
 
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	vec[0].data = (const char *)tag->header;
+	vec[0].len = (int)tag->header_size;
+	vec[1].data = (const char *)tag->payload;
+	vec[1].len = (int)tag->payload_size;
+
+	stream->total_bytes_sent += size;
+	return RTMP_WriteV(&stream->rtmp, vec, 2, 0);
+}
+
+static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header)
+{
+	struct flv_tag tag;
+	int ret = 0;
+
+	if (handle_socket_read(stream))
+		return -1;
+
+	flv_tag_mux(&tag, packet, is_header ? 0 : stream->start_dts_offset, is_header);
+	ret = send_flv_tag(stream, &tag);
 
 	if (is_header)
 		bfree(packet->data);
 	else
 		obs_encoder_packet_release(packet);
 
-	stream->total_bytes_sent += size;
 	return ret;
 }
 
 static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header, bool is_footer,
 			  size_t idx)
 {
-	uint8_t *data;
-	size_t size = 0;
+	struct flv_tag tag;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
 	if (is_header) {
-		flv_packet_start(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_tag_start(&tag, packet, stream->video_codec[idx], idx);
 	} else if (is_footer) {
-		flv_packet_end(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_tag_end(&tag, packet, stream->video_codec[idx], idx);
 	} else {
-		flv_packet_frames(packet, stream->video_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_tag_frames(&tag, packet, stream->video_codec[idx], stream->start_dts_offset, idx);
 	}
 
-#ifdef TEST_FRAMEDROPS
-	droptest_cap_data_rate(stream, size);
-#endif
-
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = send_flv_tag(stream, &tag);
 
 	if (is_header || is_footer) // manually created packets
 		bfree(packet->data);
 	else
 		obs_encoder_packet_release(packet);
 
-	stream->total_bytes_sent += size;
 	return ret;
 }
 
 static int send_audio_packet_ex(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
-	size_t size = 0;
+	struct flv_tag tag;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
 	if (is_header) {
-		flv_packet_audio_start(packet, stream->audio_codec[idx], &data, &size, idx);
+		flv_tag_audio_start(&tag, packet, stream->audio_codec[idx], idx);
 	} else {
-		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_tag_audio_frames(&tag, packet, stream->audio_codec[idx], stream->start_dts_offset, idx);
 	}
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = send_flv_tag(stream, &tag);
 
 	if (is_header)
 		bfree(packet->data);
@@ -610,6 +772,39 @@ static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
 	}
 }
 
+static void dbr_tcp_sample(struct rtmp_stream *stream)
+{
+	struct dbr_tcp_sample sample;
+	long est_bitrate;
+
+	if (!dbr_tcp_estimator_due(&stream->dbr_tcp, os_gettime_ns()))
+		return;
+
+	if (!dbr_tcp_sample_read(stream->rtmp.m_sb.sb_socket, &sample)) {
+		warn("TCP_INFO is not available, dynamic bitrate falls back to the send queue");
+		stream->dbr_tcp_info = false;
+		return;
+	}
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+
+	est_bitrate = dbr_tcp_estimator_update(&stream->dbr_tcp, &sample,
+					       stream->dbr_cur_bitrate + stream->audio_bitrate);
+	if (est_bitrate) {
+		est_bitrate -= stream->audio_bitrate;
+		if (est_bitrate < 50)
+			est_bitrate = 50;
+
+		debug("TCP_INFO congestion: rtt %u us (min %u us), delivery rate %" PRIu64 " bytes/sec, "
+		      "%u bytes unacked, %u bytes not sent",
+		      sample.rtt_us, stream->dbr_tcp.min_rtt_us, sample.delivery_rate, sample.unacked_bytes,
+		      sample.notsent_bytes);
+		stream->dbr_tcp_est_bitrate = est_bitrate;
+	}
+
+	pthread_mutex_unlock(&stream->dbr_mutex);
+}
+
 static void dbr_set_bitrate(struct rtmp_stream *stream);
 
 #ifdef _WIN32
@@ -626,6 +821,23 @@ static void log_sndbuf_size(struct rtmp_stream *stream)
 }
 #endif
 
+/* lets the socket thread hold back partial segments while a packet is being
+ * queued, and flush them once it's complete */
+static inline void set_write_more(struct rtmp_stream *stream, bool more)
+{
+#ifdef __linux__
+	if (!stream->new_socket_loop)
+		return;
+
+	os_atomic_set_bool(&stream->write_more, more);
+	if (!more)
+		os_event_signal(stream->buffer_has_data_event);
+#else
+	UNUSED_PARAMETER(stream);
+	UNUSED_PARAMETER(more);
+#endif
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
@@ -639,12 +851,16 @@ static void *send_thread(void *data)
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
 		struct dbr_frame dbr_frame;
+		struct rtmp_send_stats stats = {0};
+		uint64_t bytes_sent;
+		uint64_t sends;
+		uint64_t send_beg;
 
 		if (stopping(stream) && stream->stop_ts == 0) {
 			break;
 		}
 
-		if (!get_next_packet(stream, &packet))
+		if (!get_next_packet(stream, &packet, &stats.max_queued_packets))
 			continue;
 
 		if (stopping(stream)) {
@@ -666,6 +882,11 @@ static void *send_thread(void *data)
 			dbr_frame.size = packet.size;
 		}
 
+		bytes_sent = stream->total_bytes_sent;
+		sends = stream->rtmp.m_nSends;
+		send_beg = os_gettime_ns();
+		set_write_more(stream, true);
+
 		int sent;
 		if (packet.type == OBS_ENCODER_VIDEO &&
 		    (stream->video_codec[packet.track_idx] != CODEC_H264 ||
@@ -677,6 +898,19 @@ static void *send_thread(void *data)
 			sent = send_packet(stream, &packet, false);
 		}
 
+		set_write_more(stream, false);
+
+		/* the socket thread accounts for its own sends */
+		if (!stream->new_socket_loop) {
+			stats.bytes_sent = stream->total_bytes_sent - bytes_sent;
+			stats.sends = stream->rtmp.m_nSends - sends;
+			stats.send_ns = os_gettime_ns() - send_beg;
+#ifdef __linux__
+			stats.max_unsent = rtmp_linux_unsent_bytes(stream);
+#endif
+		}
+		rtmp_send_stats_add(stream, &stats);
+
 		if (sent < 0) {
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
@@ -688,6 +922,9 @@ static void *send_thread(void *data)
 			pthread_mutex_lock(&stream->dbr_mutex);
 			dbr_add_frame(stream, &dbr_frame);
 			pthread_mutex_unlock(&stream->dbr_mutex);
+
+			if (stream->dbr_tcp_info)
+				dbr_tcp_sample(stream);
 		}
 	}
 
@@ -707,6 +944,9 @@ static void *send_thread(void *data)
 	log_sndbuf_size(stream);
 #endif
 
+	info("Sent %" PRIu64 " bytes, %" PRIu64 " of them copied before sending", stream->total_bytes_sent,
+	     get_total_bytes_copied(stream));
+
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
 		os_event_signal(stream->buffer_has_data_event);
@@ -715,6 +955,8 @@ static void *send_thread(void *data)
 		stream->rtmp.m_bCustomSend = false;
 	}
 
+	log_send_stats(stream);
+
 	set_output_error(stream);
 
 	RTMP_Close(&stream->rtmp);
@@ -980,6 +1222,8 @@ static int init_send(struct rtmp_stream *stream)
 	obs_output_t *context = stream->output;
 
 	reset_semaphore(stream);
+	reset_send_stats(stream);
+	os_atomic_set_bool(&stream->write_more, false);
 
 	ret = pthread_create(&stream->send_thread, NULL, send_thread, stream);
 	if (ret != 0) {
@@ -1048,6 +1292,8 @@ static int init_send(struct rtmp_stream *stream)
 			}
 		}
 
+		stream->total_bitrate = total_bitrate;
+
 		// to bytes/sec
 		int ideal_buffer_size = total_bitrate * 128;
 
@@ -1057,11 +1303,12 @@ static int init_send(struct rtmp_stream *stream)
 		stream->write_buf_size = ideal_buffer_size;
 		stream->write_buf = bmalloc(ideal_buffer_size);
 
-#ifndef _WIN32
-		warn("New socket loop not supported on this platform");
-		return OBS_OUTPUT_ERROR;
-#else
+#if defined(_WIN32) || defined(__linux__)
+#ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL, socket_thread_windows, stream);
+#else
+		ret = pthread_create(&stream->socket_thread, NULL, socket_thread_linux, stream);
+#endif
 
 		if (ret != 0) {
 			RTMP_Close(&stream->rtmp);
@@ -1072,7 +1319,11 @@ static int init_send(struct rtmp_stream *stream)
 		stream->socket_thread_active = true;
 		stream->rtmp.m_bCustomSend = true;
 		stream->rtmp.m_customSendFunc = socket_queue_data;
+		stream->rtmp.m_customSendVFunc = socket_queue_datav;
 		stream->rtmp.m_customSendParam = stream;
+#else
+		warn("New socket loop not supported on this platform");
+		return OBS_OUTPUT_ERROR;
 #endif
 	}
 
@@ -1251,6 +1502,8 @@ static bool init_connect(struct rtmp_stream *stream)
 	os_atomic_set_bool(&stream->disconnected, false);
 	os_atomic_set_bool(&stream->encode_error, false);
 	stream->total_bytes_sent = 0;
+	stream->total_bytes_copied = 0;
+	stream->rtmp.m_nBytesCopied = 0;
 	stream->dropped_frames = 0;
 	stream->min_priority = 0;
 	stream->got_first_packet = false;
@@ -1296,6 +1549,9 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->dbr_inc_bitrate = stream->dbr_orig_bitrate / 10;
 	stream->dbr_inc_timeout = 0;
 	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
+	stream->dbr_tcp_info = strcmp(obs_data_get_string(settings, OPT_DBR_ESTIMATOR), "tcp_info") == 0;
+	stream->dbr_tcp_est_bitrate = 0;
+	dbr_tcp_estimator_reset(&stream->dbr_tcp);
 
 	caps = obs_encoder_get_caps(venc);
 	if ((caps & OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
@@ -1310,6 +1566,10 @@ static bool init_connect(struct rtmp_stream *stream)
 
 	if (stream->dbr_enabled) {
 		info("Dynamic bitrate enabled.  Dropped frames begone!");
+		if (stream->dbr_tcp_info)
+			info("Dynamic bitrate uses TCP_INFO congestion estimates");
+	} else {
+		stream->dbr_tcp_info = false;
 	}
 
 	obs_data_release(vsettings);
@@ -1336,7 +1596,7 @@ static bool init_connect(struct rtmp_stream *stream)
 		stream->addrlen_hint = len;
 	}
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	stream->new_socket_loop = obs_data_get_bool(settings, OPT_NEWSOCKETLOOP_ENABLED);
 	stream->low_latency_mode = obs_data_get_bool(settings, OPT_LOWLATENCY_ENABLED);
 
@@ -1538,6 +1798,32 @@ static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
 	return true;
 }
 
+/* the send queue may still be short when the kernel already reports
+ * congestion, so this doesn't wait for the queue trigger */
+static bool dbr_tcp_bitrate_lowered(struct rtmp_stream *stream)
+{
+	long est_bitrate = stream->dbr_tcp_est_bitrate;
+
+	stream->dbr_tcp_est_bitrate = 0;
+
+	if (!est_bitrate || est_bitrate >= stream->dbr_cur_bitrate)
+		return false;
+
+	/* the queue based estimate is from before the congestion */
+	stream->dbr_data_size = 0;
+	deque_pop_front(&stream->dbr_frames, NULL, stream->dbr_frames.size);
+
+	est_bitrate = est_bitrate / 100 * 100;
+	if (est_bitrate < 50)
+		est_bitrate = 50;
+
+	stream->dbr_prev_bitrate = 0;
+	stream->dbr_cur_bitrate = est_bitrate;
+	stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
+	info("bitrate decreased to: %ld (TCP_INFO)", stream->dbr_cur_bitrate);
+	return true;
+}
+
 static void dbr_set_bitrate(struct rtmp_stream *stream)
 {
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
@@ -1582,6 +1868,17 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 				dbr_set_bitrate(stream);
 			}
 		}
+
+		if (stream->dbr_tcp_info) {
+			bool bitrate_changed;
+
+			pthread_mutex_lock(&stream->dbr_mutex);
+			bitrate_changed = dbr_tcp_bitrate_lowered(stream);
+			pthread_mutex_unlock(&stream->dbr_mutex);
+
+			if (bitrate_changed)
+				dbr_set_bitrate(stream);
+		}
 	}
 
 	if (num_packets < 5) {
@@ -1720,7 +2017,8 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
-#ifdef _WIN32
+	obs_data_set_default_string(defaults, OPT_DBR_ESTIMATOR, "queue");
+#if defined(_WIN32) || defined(__linux__)
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
 #endif
@@ -1757,7 +2055,14 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	}
 	netif_saddr_data_free(&addrs);
 
-#ifdef _WIN32
+#ifdef __linux__
+	p = obs_properties_add_list(props, OPT_DBR_ESTIMATOR, obs_module_text("RTMPStream.DbrEstimator"),
+				    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p, obs_module_text("RTMPStream.DbrEstimator.Queue"), "queue");
+	obs_property_list_add_string(p, obs_module_text("RTMPStream.DbrEstimator.TcpInfo"), "tcp_info");
+#endif
+
+#if defined(_WIN32) || defined(__linux__)
 	obs_properties_add_bool(props, OPT_NEWSOCKETLOOP_ENABLED, obs_module_text("RTMPStream.NewSocketLoop"));
 	obs_properties_add_bool(props, OPT_LOWLATENCY_ENABLED, obs_module_text("RTMPStream.LowLatencyMode"));
 #endif
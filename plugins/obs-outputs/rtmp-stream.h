@@ -8,6 +8,7 @@
 #include "librtmp/log.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "dbr-tcp-estimator.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -30,6 +31,7 @@
 #define OPT_IP_FAMILY "ip_family"
 #define OPT_NEWSOCKETLOOP_ENABLED "new_socket_loop_enabled"
 #define OPT_LOWLATENCY_ENABLED "low_latency_mode_enabled"
+#define OPT_DBR_ESTIMATOR "dbr_estimator"
 #define OPT_METADATA_MULTITRACK "metadata_multitrack"
 
 //#define TEST_FRAMEDROPS
@@ -52,6 +54,16 @@ struct dbr_frame {
 	size_t size;
 };
 
+struct rtmp_send_stats {
+	uint64_t bytes_sent;
+	uint64_t sends;
+	uint64_t would_block;
+	uint64_t send_ns;
+	size_t max_buffered;
+	size_t max_unsent;
+	size_t max_queued_packets;
+};
+
 struct rtmp_stream {
 	obs_output_t *output;
 
@@ -92,6 +104,7 @@ struct rtmp_stream {
 	int64_t last_dts_usec;
 
 	uint64_t total_bytes_sent;
+	uint64_t total_bytes_copied;
 	int dropped_frames;
 
 #ifdef TEST_FRAMEDROPS
@@ -113,6 +126,11 @@ struct rtmp_stream {
 	long dbr_inc_bitrate;
 	bool dbr_enabled;
 
+	/* congestion estimates from TCP_INFO, sampled by the send thread */
+	bool dbr_tcp_info;
+	struct dbr_tcp_estimator dbr_tcp;
+	long dbr_tcp_est_bitrate;
+
 	enum audio_id_t audio_codec[MAX_OUTPUT_AUDIO_ENCODERS];
 	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
 
@@ -131,10 +149,28 @@ struct rtmp_stream {
 	os_event_t *buffer_has_data_event;
 	os_event_t *socket_available_event;
 	os_event_t *send_thread_signaled_exit;
+
+	/* kbps of all encoders, used to size the write buffer and pacing */
+	int total_bitrate;
+	/* set while the send thread is in the middle of queueing a packet */
+	volatile bool write_more;
+
+	/* send statistics of the current second, the last full second and
+	 * the whole stream */
+	pthread_mutex_t send_stats_mutex;
+	uint64_t send_stats_start;
+	struct rtmp_send_stats send_stats_cur;
+	struct rtmp_send_stats send_stats_prev;
+	struct rtmp_send_stats send_stats_total;
 };
 
+void rtmp_send_stats_add(struct rtmp_stream *stream, const struct rtmp_send_stats *stats);
+
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#elif defined(__linux__)
+void *socket_thread_linux(void *data);
+size_t rtmp_linux_unsent_bytes(struct rtmp_stream *stream);
 #endif
 
 /* Adapted from FFmpeg's libavutil/pixfmt.h
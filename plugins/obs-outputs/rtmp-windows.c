@@ -132,7 +132,9 @@ enum data_ret { RET_BREAK, RET_FATAL, RET_CONTINUE };
 static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write, uint64_t *last_send_time,
 				size_t latency_packet_size, int delay_time)
 {
+	struct rtmp_send_stats stats = {0};
 	bool exit_loop = false;
+	uint64_t start;
 
 	pthread_mutex_lock(&stream->write_buf_mutex);
 
@@ -147,7 +149,11 @@ static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write, uin
 		return RET_BREAK;
 	}
 
+	stats.max_buffered = stream->write_buf_len;
+	stats.sends = 1;
+
 	int ret;
+	start = os_gettime_ns();
 	if (stream->low_latency_mode) {
 		size_t send_len = min(latency_packet_size, stream->write_buf_len);
 
@@ -155,11 +161,13 @@ static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write, uin
 	} else {
 		ret = RTMPSockBuf_Send(&stream->rtmp.m_sb, (const char *)stream->write_buf, (int)stream->write_buf_len);
 	}
+	stats.send_ns = os_gettime_ns() - start;
 
 	if (ret > 0) {
 		if (stream->write_buf_len - ret)
 			memmove(stream->write_buf, stream->write_buf + ret, stream->write_buf_len - ret);
 		stream->write_buf_len -= ret;
+		stats.bytes_sent = (uint64_t)ret;
 
 		*last_send_time = os_gettime_ns() / 1000000;
 
@@ -174,6 +182,9 @@ static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write, uin
 			if (err_code == WSAEWOULDBLOCK) {
 				*can_write = false;
 				pthread_mutex_unlock(&stream->write_buf_mutex);
+
+				stats.would_block = 1;
+				rtmp_send_stats_add(stream, &stats);
 				return RET_BREAK;
 			}
 
@@ -205,6 +216,8 @@ static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write, uin
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
+	rtmp_send_stats_add(stream, &stats);
+
 	if (delay_time)
 		os_sleep_ms(delay_time);
 
@@ -120,6 +120,8 @@ struct mp4_track {
 	/* Temporary array with information about the samples to be included
 	 * in the next fragment. */
 	DARRAY(struct fragment_sample) fragment_samples;
+	/* Position of the trun data_offset in the fragment's moof */
+	int64_t data_offset_pos;
 };
 
 struct mp4_mux {
@@ -147,6 +149,9 @@ struct mp4_mux {
 	DARRAY(struct mp4_track) tracks;
 	/* Special tracks */
 	struct mp4_track *chapter_track;
+
+	/* Packet data of the fragment's mdat, written in one batch */
+	DARRAY(struct serializer_iovec) mdat_data;
 };
 
 /* clang-format off */
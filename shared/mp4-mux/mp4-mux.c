@@ -22,7 +22,6 @@
 
 #include <obs-avc.h>
 #include <obs-hevc.h>
-#include <obs-module.h>
 #include <util/dstr.h>
 #include <util/platform.h>
 #include <util/array-serializer.h>
@@ -2359,7 +2358,8 @@ static size_t mp4_write_trun(struct mp4_mux *mux, struct mp4_track *track, uint3
 	}
 
 	s_wb32(s, (uint32_t)sample_count); // sample_count
-	s_wb32(s, (uint32_t)data_offset);  // data_offset
+	track->data_offset_pos = serializer_get_pos(s);
+	s_wb32(s, (uint32_t)data_offset); // data_offset
 
 	/* If we have a fixed sample size (PCM audio) we only need to write
 	 * the sample count and offset. */
@@ -2582,27 +2582,38 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track, uint64
 	}
 }
 
-/* Write track data to file */
-static void write_packets(struct mp4_mux *mux, struct mp4_track *track)
+static void release_packet_data(void *param)
 {
-	struct serializer *s = mux->serializer;
+	struct encoder_packet pkt = {.data = param};
+	obs_encoder_packet_release(&pkt);
+}
 
+/* Queue track data to be written at offset, the packets are released once
+ * the serializer wrote them */
+static void write_packets(struct mp4_mux *mux, struct mp4_track *track, uint64_t *offset)
+{
 	size_t count = track->packets.size / sizeof(struct encoder_packet);
 	if (!count || !track->fragment_samples.num)
 		return;
 
 	struct chunk *chk = da_push_back_new(track->chunks);
-	chk->offset = serializer_get_pos(s);
+	chk->offset = *offset;
 	chk->samples = (uint32_t)track->fragment_samples.num;
 
 	for (size_t i = 0; i < track->fragment_samples.num; i++) {
 		struct encoder_packet pkt;
 		deque_pop_front(&track->packets, &pkt, sizeof(struct encoder_packet));
-		s_write(s, pkt.data, pkt.size);
-		obs_encoder_packet_release(&pkt);
+
+		struct serializer_iovec *vec = da_push_back_new(mux->mdat_data);
+		vec->data = pkt.data;
+		vec->size = pkt.size;
+		vec->release = release_packet_data;
+		vec->param = pkt.data;
+
+		*offset += pkt.size;
 	}
 
-	chk->size = (uint32_t)(serializer_get_pos(s) - chk->offset);
+	chk->size = (uint32_t)(*offset - chk->offset);
 
 	/* Fixup sample count for fixed-size codecs */
 	if (track->sample_size)
@@ -2658,13 +2669,25 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 		process_packets(mux, mux->chapter_track, &mdat_size);
 	}
 
-	// write moof once to get size
+	// write moof, then add its size to the data offsets
 	int64_t moof_start = serializer_get_pos(s);
 	size_t moof_size = mp4_write_moof(mux, 0, moof_start);
-	array_output_serializer_reset(&aod);
 
-	// write moof again with known size
-	mp4_write_moof(mux, (uint32_t)moof_size, moof_start);
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		struct mp4_track *track = &mux->tracks.array[i];
+		if (!track->fragment_samples.num)
+			continue;
+
+		uint8_t *field = aod.bytes.array + track->data_offset_pos;
+		uint32_t data_offset = ((uint32_t)field[0] << 24) | ((uint32_t)field[1] << 16) |
+				       ((uint32_t)field[2] << 8) | field[3];
+
+		data_offset += (uint32_t)moof_size;
+		field[0] = (uint8_t)(data_offset >> 24);
+		field[1] = (uint8_t)(data_offset >> 16);
+		field[2] = (uint8_t)(data_offset >> 8);
+		field[3] = (uint8_t)data_offset;
+	}
 
 	// Write to output and restore real serializer
 	s_write(s, aod.bytes.array, aod.bytes.num);
@@ -2684,14 +2707,19 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 		s_write(s, "mdat", 4);
 	}
 
+	uint64_t offset = (uint64_t)serializer_get_pos(s);
+
 	for (size_t i = 0; i < mux->tracks.num; i++) {
 		struct mp4_track *track = &mux->tracks.array[i];
-		write_packets(mux, track);
+		write_packets(mux, track, &offset);
 	}
 
 	/* Only write chapter packets on final flush. */
 	if (!mux->next_frag_pts && mux->chapter_track)
-		write_packets(mux, mux->chapter_track);
+		write_packets(mux, mux->chapter_track, &offset);
+
+	s_writev(s, mux->mdat_data.array, mux->mdat_data.num);
+	da_clear(mux->mdat_data);
 
 	mux->next_frag_pts = 0;
 }
@@ -2877,6 +2905,7 @@ void mp4_mux_destroy(struct mp4_mux *mux)
 	free_track(mux->chapter_track);
 	bfree(mux->chapter_track);
 	da_free(mux->tracks);
+	da_free(mux->mdat_data);
 	bfree(mux);
 }
 
@@ -2931,7 +2960,7 @@ bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt)
 	return true;
 }
 
-bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name)
+bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name, const char *start_name)
 {
 	if (dts_usec < 0)
 		return false;
@@ -2941,7 +2970,7 @@ bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name
 	/* To work correctly there needs to be a chapter at PTS 0,
 	 * create that here if necessary. */
 	if (dts_usec > 0 && mux->chapter_track->packets.size == 0) {
-		mp4_mux_add_chapter(mux, 0, obs_module_text("MP4Output.StartChapter"));
+		mp4_mux_add_chapter(mux, 0, start_name, start_name);
 	}
 
 	/* Create packets that will be muxed on final flush */
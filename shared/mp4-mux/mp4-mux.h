@@ -44,5 +44,6 @@ struct mp4_mux *mp4_mux_create(obs_output_t *output, struct serializer *serializ
 			       enum mp4_flavor flavor);
 void mp4_mux_destroy(struct mp4_mux *mux);
 bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt);
-bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name);
+/* start_name names the chapter added at 0 if the first chapter starts later */
+bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name, const char *start_name);
 bool mp4_mux_finalise(struct mp4_mux *mux);
@@ -0,0 +1,219 @@
+/*
+ * Benchmark for the mixing stage of audio_callback() in libobs/obs-audio.c.
+ *
+ * Synthetic root sources with 7.1 audio are summed into the mix buffers once
+ * per audio tick, exactly like mix_audio() does, with some sources starting
+ * partway into the tick.  The scalar loop that summed every mix is compared
+ * against the vectorized kernels that only touch the active mixes, for a few
+ * source counts and sets of active mixes.  Mix results are checked against
+ * the scalar loop before timing.
+ *
+ * usage: audio-mix-bench [seconds per test]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-io.h>
+#include <media-io/audio-simd.h>
+
+#define CHANNELS 8
+#define SAMPLE_RATE 48000
+
+static const char *simd_names[] = {"sse2", "avx2", "neon"};
+
+static const size_t source_counts[] = {8, 32, 64, 128};
+
+#define NUM_SOURCE_COUNTS (sizeof(source_counts) / sizeof(source_counts[0]))
+
+struct mix_set {
+	const char *name;
+	uint32_t mixers;
+};
+
+static const struct mix_set mix_sets[] = {
+	{"1 mix", 0x1},
+	{"2 mixes", 0x3},
+	{"all mixes", (1 << MAX_AUDIO_MIXES) - 1},
+};
+
+#define NUM_MIX_SETS (sizeof(mix_sets) / sizeof(mix_sets[0]))
+
+struct bench_source {
+	float *output_buf[MAX_AUDIO_MIXES][CHANNELS];
+	size_t start_point;
+};
+
+struct mix_buffers {
+	float buffer[MAX_AUDIO_MIXES][CHANNELS][AUDIO_OUTPUT_FRAMES];
+	struct audio_output_data data[MAX_AUDIO_MIXES];
+};
+
+static void sources_init(struct bench_source *sources, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		struct bench_source *source = &sources[i];
+
+		/* every eighth source started partway into the tick */
+		source->start_point = (i % 8 == 7) ? (size_t)rand() % AUDIO_OUTPUT_FRAMES : 0;
+
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+			for (size_t ch = 0; ch < CHANNELS; ch++) {
+				float *buf = bmalloc(AUDIO_OUTPUT_FRAMES * sizeof(float));
+
+				for (size_t j = 0; j < AUDIO_OUTPUT_FRAMES; j++)
+					buf[j] = (float)rand() / (float)RAND_MAX - 0.5f;
+				source->output_buf[mix][ch] = buf;
+			}
+		}
+	}
+}
+
+static void sources_free(struct bench_source *sources, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+			for (size_t ch = 0; ch < CHANNELS; ch++)
+				bfree(sources[i].output_buf[mix][ch]);
+}
+
+static void clear_mixes(struct mix_buffers *mixes, uint32_t mixers)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) != 0)
+			memset(mixes->buffer[mix], 0, sizeof(mixes->buffer[mix]));
+
+		for (size_t ch = 0; ch < CHANNELS; ch++)
+			mixes->data[mix].data[ch] = mixes->buffer[mix][ch];
+	}
+}
+
+/* the loop mix_audio() used before the kernels were added */
+static void mix_scalar(struct mix_buffers *mixes, const struct bench_source *sources, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		const struct bench_source *source = &sources[i];
+		size_t total_floats = AUDIO_OUTPUT_FRAMES - source->start_point;
+
+		for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+			for (size_t ch = 0; ch < CHANNELS; ch++) {
+				float *mix = mixes->data[mix_idx].data[ch] + source->start_point;
+				const float *aud = source->output_buf[mix_idx][ch];
+				const float *end = aud + total_floats;
+
+				while (aud < end)
+					*(mix++) += *(aud++);
+			}
+		}
+	}
+}
+
+static void mix_simd(struct mix_buffers *mixes, const struct bench_source *sources, size_t count, uint32_t mixers)
+{
+	for (size_t i = 0; i < count; i++) {
+		const struct bench_source *source = &sources[i];
+		size_t total_floats = AUDIO_OUTPUT_FRAMES - source->start_point;
+
+		for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+			if ((mixers & (1 << mix_idx)) == 0)
+				continue;
+
+			for (size_t ch = 0; ch < CHANNELS; ch++)
+				audio_mix_add(mixes->data[mix_idx].data[ch] + source->start_point,
+					      source->output_buf[mix_idx][ch], total_floats);
+		}
+	}
+}
+
+static void run_tick(struct mix_buffers *mixes, const struct bench_source *sources, size_t count, uint32_t mixers,
+		     bool scalar)
+{
+	if (scalar) {
+		clear_mixes(mixes, (1 << MAX_AUDIO_MIXES) - 1);
+		mix_scalar(mixes, sources, count);
+	} else {
+		clear_mixes(mixes, mixers);
+		mix_simd(mixes, sources, count, mixers);
+	}
+}
+
+static bool mixes_match(const struct mix_buffers *a, const struct mix_buffers *b, uint32_t mixers)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+		if (memcmp(a->buffer[mix], b->buffer[mix], sizeof(a->buffer[mix])) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+static void bench(const struct bench_source *sources, size_t count, const struct mix_set *set, const char *name,
+		  bool scalar, double seconds, struct mix_buffers *mixes, const struct mix_buffers *ref)
+{
+	/* time covered by one tick of the audio thread */
+	double tick_us = (double)AUDIO_OUTPUT_FRAMES * 1000000.0 / SAMPLE_RATE;
+	uint64_t limit = (uint64_t)(seconds * 1000000000.0);
+	uint64_t start, elapsed;
+	size_t ticks = 0;
+	double us;
+	bool match;
+
+	run_tick(mixes, sources, count, set->mixers, scalar);
+	match = mixes_match(mixes, ref, set->mixers);
+
+	start = os_gettime_ns();
+	do {
+		run_tick(mixes, sources, count, set->mixers, scalar);
+		ticks++;
+		elapsed = os_gettime_ns() - start;
+	} while (elapsed < limit);
+
+	us = (double)elapsed / (double)ticks / 1000.0;
+	printf("%7zu %-10s %-7s %10.2f %9.2f%%%s\n", count, set->name, name, us, us * 100.0 / tick_us,
+	       match ? "" : "  MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+	struct mix_buffers *mixes = bzalloc(sizeof(struct mix_buffers));
+	struct mix_buffers *ref = bzalloc(sizeof(struct mix_buffers));
+
+	if (seconds <= 0.0)
+		seconds = 0.5;
+
+	printf("%7s %-10s %-7s %10s %10s\n", "sources", "mixes", "kernel", "us/tick", "of tick");
+
+	for (size_t c = 0; c < NUM_SOURCE_COUNTS; c++) {
+		size_t count = source_counts[c];
+		struct bench_source *sources = bzalloc(sizeof(struct bench_source) * count);
+
+		sources_init(sources, count);
+
+		for (size_t m = 0; m < NUM_MIX_SETS; m++) {
+			const struct mix_set *set = &mix_sets[m];
+
+			run_tick(ref, sources, count, set->mixers, true);
+			bench(sources, count, set, "scalar", true, seconds, mixes, ref);
+
+			for (int s = AUDIO_SIMD_SSE2; s <= AUDIO_SIMD_NEON; s++) {
+				if (!audio_set_simd(s))
+					continue;
+
+				bench(sources, count, set, simd_names[s], false, seconds, mixes, ref);
+			}
+		}
+
+		sources_free(sources, count);
+		bfree(sources);
+	}
+
+	bfree(mixes);
+	bfree(ref);
+	return 0;
+}
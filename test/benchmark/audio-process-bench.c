@@ -0,0 +1,206 @@
+/*
+ * Benchmark for the per-source audio processing kernels: the stereo balance
+ * and forced mono downmix in process_audio() (libobs/obs-source.c), and the
+ * clamp of each output mix in libobs/media-io/audio-io.c.
+ *
+ * Each kernel is compared against the scalar loop it replaced, on one audio
+ * tick (AUDIO_OUTPUT_FRAMES samples per channel).  Results are checked
+ * against the scalar loop before timing.
+ *
+ * usage: audio-process-bench [seconds per test]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-io.h>
+#include <media-io/audio-simd.h>
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define FRAMES AUDIO_OUTPUT_FRAMES
+#define CHANNELS 8
+#define BALANCE 0.3f
+
+static const char *simd_names[] = {"sse2", "avx2", "neon"};
+
+enum kernel {
+	KERNEL_BALANCE,
+	KERNEL_DOWNMIX_STEREO,
+	KERNEL_DOWNMIX_7_1,
+	KERNEL_CLAMP,
+	KERNEL_COUNT,
+};
+
+static const char *kernel_names[KERNEL_COUNT] = {"balance", "downmix 2ch", "downmix 8ch", "clamp"};
+
+struct buffers {
+	float source[CHANNELS][FRAMES];
+	float data[CHANNELS][FRAMES];
+	float unclamped[CHANNELS][FRAMES];
+	float *planes[CHANNELS];
+};
+
+/* ------------------------------------------------------------------------- */
+/* the scalar loops the kernels replaced                                     */
+
+static void balance_scalar(float **data, size_t frames, float balance)
+{
+	for (size_t frame = 0; frame < frames; frame++) {
+		data[0][frame] = data[0][frame] * sinf((1.0f - balance) * (M_PI / 2.0f));
+		data[1][frame] = data[1][frame] * sinf(balance * (M_PI / 2.0f));
+	}
+}
+
+static void downmix_scalar(float **data, size_t channels, size_t frames)
+{
+	const float channels_i = 1.0f / (float)channels;
+
+	for (size_t channel = 1; channel < channels; channel++) {
+		for (size_t frame = 0; frame < frames; frame++)
+			data[0][frame] += data[channel][frame];
+	}
+
+	for (size_t frame = 0; frame < frames; frame++)
+		data[0][frame] *= channels_i;
+
+	for (size_t channel = 1; channel < channels; channel++) {
+		for (size_t frame = 0; frame < frames; frame++)
+			data[channel][frame] = data[0][frame];
+	}
+}
+
+static void clamp_scalar(float *mix_data, float *unclamped, size_t count)
+{
+	float *mix_end = &mix_data[count];
+
+	memcpy(unclamped, mix_data, count * sizeof(float));
+
+	while (mix_data < mix_end) {
+		float val = *mix_data;
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		*(mix_data++) = val;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* returns the number of samples processed */
+static size_t run_kernel(enum kernel kernel, bool scalar, struct buffers *b)
+{
+	switch (kernel) {
+	case KERNEL_BALANCE:
+		/* the gains would shrink the samples to denormals otherwise */
+		memcpy(b->data, b->source, sizeof(b->data[0]) * 2);
+
+		if (scalar) {
+			balance_scalar(b->planes, FRAMES, BALANCE);
+		} else {
+			audio_apply_gain(b->planes[0], sinf((1.0f - BALANCE) * (M_PI / 2.0f)), FRAMES);
+			audio_apply_gain(b->planes[1], sinf(BALANCE * (M_PI / 2.0f)), FRAMES);
+		}
+		return FRAMES * 2;
+	case KERNEL_DOWNMIX_STEREO:
+	case KERNEL_DOWNMIX_7_1: {
+		size_t channels = kernel == KERNEL_DOWNMIX_STEREO ? 2 : 8;
+
+		if (scalar)
+			downmix_scalar(b->planes, channels, FRAMES);
+		else
+			audio_downmix_to_mono(b->planes, channels, FRAMES);
+		return FRAMES * channels;
+	}
+	case KERNEL_CLAMP:
+		for (size_t ch = 0; ch < CHANNELS; ch++) {
+			if (scalar)
+				clamp_scalar(b->planes[ch], b->unclamped[ch], FRAMES);
+			else
+				audio_clamp(b->planes[ch], b->unclamped[ch], FRAMES);
+		}
+		return FRAMES * CHANNELS;
+	case KERNEL_COUNT:
+		break;
+	}
+
+	return 0;
+}
+
+static void reset(struct buffers *b)
+{
+	memcpy(b->data, b->source, sizeof(b->data));
+}
+
+static void bench(enum kernel kernel, const char *name, bool scalar, double seconds, struct buffers *b,
+		  struct buffers *ref)
+{
+	uint64_t limit = (uint64_t)(seconds * 1000000000.0);
+	uint64_t start, elapsed;
+	size_t samples = 0;
+	size_t ticks = 0;
+	bool match;
+
+	reset(ref);
+	run_kernel(kernel, true, ref);
+	reset(b);
+	run_kernel(kernel, scalar, b);
+	match = memcmp(b->data, ref->data, sizeof(b->data)) == 0;
+
+	start = os_gettime_ns();
+	do {
+		samples += run_kernel(kernel, scalar, b);
+		ticks++;
+		elapsed = os_gettime_ns() - start;
+	} while (elapsed < limit);
+
+	printf("%-12s %-7s %12.1f %10.3f%s\n", kernel_names[kernel], name, (double)samples * 1000.0 / (double)elapsed,
+	       (double)elapsed / (double)ticks / 1000.0, match ? "" : "  MISMATCH");
+}
+
+static void buffers_init(struct buffers *b)
+{
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		for (size_t i = 0; i < FRAMES; i++)
+			b->source[ch][i] = ((float)rand() / (float)RAND_MAX - 0.5f) * 2.5f;
+		b->planes[ch] = b->data[ch];
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+	struct buffers *b = bzalloc(sizeof(struct buffers));
+	struct buffers *ref = bzalloc(sizeof(struct buffers));
+
+	if (seconds <= 0.0)
+		seconds = 0.5;
+
+	buffers_init(b);
+	memcpy(ref->source, b->source, sizeof(b->source));
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		ref->planes[ch] = ref->data[ch];
+
+	printf("%-12s %-7s %12s %10s\n", "kernel", "variant", "Msamples/s", "us/tick");
+
+	for (int k = 0; k < KERNEL_COUNT; k++) {
+		bench(k, "scalar", true, seconds, b, ref);
+
+		for (int s = AUDIO_SIMD_SSE2; s <= AUDIO_SIMD_NEON; s++) {
+			if (!audio_set_simd(s))
+				continue;
+
+			bench(k, simd_names[s], false, seconds, b, ref);
+		}
+	}
+
+	bfree(b);
+	bfree(ref);
+	return 0;
+}
@@ -0,0 +1,298 @@
+/*
+ * Reaction time of the dynamic bitrate congestion estimates.
+ *
+ * A stream is sent over loopback to a sink that only reads at a limited
+ * rate, like an uplink of that capacity.  Partway through, the capacity
+ * drops below the stream bitrate.  Packets are queued by an encoder thread
+ * and sent with blocking writes by a send thread, like in the RTMP output.
+ * The report shows how long after the drop the TCP_INFO estimator reports
+ * congestion, and how long until the send queue reaches the queue based
+ * trigger.  Reports before the drop are counted as false alarms.
+ *
+ * The estimator only looks at the socket, so plain bytes are sent instead of
+ * RTMP.  The sink reads like the ingest server in rtmp-ingest.c does with a
+ * read limit, but that one only reads from a client that published over
+ * RTMP, and its rate can't change while it runs.
+ *
+ * usage: dbr-estimator-bench [stream kbps] [capacity kbps] [reduced kbps] [seconds before the drop]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <util/bmem.h>
+#include <util/deque.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "dbr-tcp-estimator.h"
+
+#define FPS 60
+#define KEYFRAME_INTERVAL (FPS * 2)
+
+/* DBR_TRIGGER_USEC in rtmp-stream.c */
+#define QUEUE_TRIGGER_USEC 200000
+
+#define SINK_TICK_NS 2000000ULL
+/* the sink's receive buffer stands in for the queue at the bottleneck, data
+ * in it is already acknowledged */
+#define SINK_RCVBUF (32 * 1024)
+#define TIMEOUT_SEC 30
+
+struct bench_packet {
+	int64_t dts_usec;
+	size_t size;
+};
+
+struct reaction {
+	const char *name;
+	uint64_t ts;
+	long kbps;
+	int false_alarms;
+};
+
+static struct {
+	int stream_kbps;
+	int capacity_kbps;
+	int reduced_kbps;
+	uint64_t drop_ts;
+	volatile bool stop;
+	int listen_fd;
+
+	pthread_mutex_t mutex;
+	struct deque packets;
+	int64_t last_dts_usec;
+	os_sem_t *send_sem;
+} bench;
+
+static void *sink_thread(void *data)
+{
+	uint8_t *buf = bmalloc(SINK_RCVBUF);
+	int fd = accept(bench.listen_fd, NULL, NULL);
+	uint64_t ts = os_gettime_ns();
+	double tokens = 0.0;
+
+	UNUSED_PARAMETER(data);
+
+	while (!os_atomic_load_bool(&bench.stop)) {
+		int kbps = ts >= bench.drop_ts ? bench.reduced_kbps : bench.capacity_kbps;
+		double max_tokens = kbps * 1000.0 / 8.0 * 0.01;
+
+		tokens += kbps * 1000.0 / 8.0 * (double)SINK_TICK_NS / 1000000000.0;
+
+		while (tokens >= 1.0) {
+			size_t len = tokens > SINK_RCVBUF ? SINK_RCVBUF : (size_t)tokens;
+			ssize_t ret = recv(fd, buf, len, MSG_DONTWAIT);
+			if (ret <= 0)
+				break;
+			tokens -= (double)ret;
+		}
+
+		/* capacity that isn't used is lost */
+		if (tokens > max_tokens)
+			tokens = max_tokens;
+
+		ts += SINK_TICK_NS;
+		os_sleepto_ns(ts);
+	}
+
+	close(fd);
+	bfree(buf);
+	return NULL;
+}
+
+static void *encoder_thread(void *data)
+{
+	size_t frame_size = (size_t)bench.stream_kbps * 1000 / 8 / FPS;
+	size_t delta_size = frame_size * (KEYFRAME_INTERVAL - 4) / (KEYFRAME_INTERVAL - 1);
+	uint64_t start = os_gettime_ns();
+
+	UNUSED_PARAMETER(data);
+
+	for (uint64_t i = 0; !os_atomic_load_bool(&bench.stop); i++) {
+		struct bench_packet packet;
+
+		os_sleepto_ns(start + i * 1000000000ULL / FPS);
+
+		packet.dts_usec = (int64_t)(i * 1000000 / FPS);
+		packet.size = (i % KEYFRAME_INTERVAL == 0) ? frame_size * 4 : delta_size;
+
+		pthread_mutex_lock(&bench.mutex);
+		deque_push_back(&bench.packets, &packet, sizeof(packet));
+		bench.last_dts_usec = packet.dts_usec;
+		pthread_mutex_unlock(&bench.mutex);
+
+		os_sem_post(bench.send_sem);
+	}
+
+	return NULL;
+}
+
+static bool send_all(int fd, const uint8_t *data, size_t size)
+{
+	while (size) {
+		ssize_t ret = send(fd, data, size, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		data += ret;
+		size -= (size_t)ret;
+	}
+
+	return true;
+}
+
+static void record(struct reaction *reaction, uint64_t ts, long kbps)
+{
+	if (ts < bench.drop_ts)
+		reaction->false_alarms++;
+	else if (!reaction->ts) {
+		reaction->ts = ts;
+		reaction->kbps = kbps;
+	}
+}
+
+static bool connect_loopback(int *fd)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t len = sizeof(addr);
+	int rcvbuf = SINK_RCVBUF;
+	int one = 1;
+
+	bench.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	*fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (bench.listen_fd < 0 || *fd < 0)
+		return false;
+
+	/* accepted sockets inherit the receive buffer, which has to be small
+	 * for the sender to notice the limited reads */
+	setsockopt(bench.listen_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(bench.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(bench.listen_fd, 1) != 0 ||
+	    getsockname(bench.listen_fd, (struct sockaddr *)&addr, &len) != 0)
+		return false;
+
+	if (connect(*fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+		return false;
+
+	setsockopt(*fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	struct reaction tcp_info = {.name = "tcp_info"};
+	struct reaction queue = {.name = "queue"};
+	struct dbr_tcp_estimator est;
+	pthread_t sink, encoder;
+	int drop_sec = 5;
+	uint8_t *data;
+	int fd;
+
+	bench.stream_kbps = argc > 1 ? atoi(argv[1]) : 6000;
+	bench.capacity_kbps = argc > 2 ? atoi(argv[2]) : 10000;
+	bench.reduced_kbps = argc > 3 ? atoi(argv[3]) : 3000;
+	drop_sec = argc > 4 ? atoi(argv[4]) : drop_sec;
+
+	if (bench.stream_kbps <= 0 || bench.capacity_kbps <= 0 || bench.reduced_kbps <= 0 || drop_sec <= 0) {
+		fprintf(stderr, "usage: %s [stream kbps] [capacity kbps] [reduced kbps] [seconds before the drop]\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (!connect_loopback(&fd)) {
+		fprintf(stderr, "failed to connect over loopback: %s\n", strerror(errno));
+		return 1;
+	}
+
+	pthread_mutex_init(&bench.mutex, NULL);
+	os_sem_init(&bench.send_sem, 0);
+	dbr_tcp_estimator_reset(&est);
+
+	data = bzalloc((size_t)bench.stream_kbps * 1000 / 8 / FPS * 4);
+	bench.drop_ts = os_gettime_ns() + (uint64_t)drop_sec * 1000000000ULL;
+
+	pthread_create(&sink, NULL, sink_thread, NULL);
+	pthread_create(&encoder, NULL, encoder_thread, NULL);
+
+	printf("stream %d kbps, capacity %d kbps, %d kbps after %d s\n", bench.stream_kbps, bench.capacity_kbps,
+	       bench.reduced_kbps, drop_sec);
+
+	while (os_sem_wait(bench.send_sem) == 0) {
+		struct bench_packet packet;
+		struct dbr_tcp_sample sample;
+		int64_t buffer_duration_usec;
+		uint64_t ts;
+
+		pthread_mutex_lock(&bench.mutex);
+		deque_pop_front(&bench.packets, &packet, sizeof(packet));
+		buffer_duration_usec = bench.last_dts_usec - packet.dts_usec;
+		pthread_mutex_unlock(&bench.mutex);
+
+		ts = os_gettime_ns();
+		if (buffer_duration_usec >= QUEUE_TRIGGER_USEC)
+			record(&queue, ts, 0);
+
+		if (!send_all(fd, data, packet.size)) {
+			fprintf(stderr, "send failed: %s\n", strerror(errno));
+			break;
+		}
+
+		ts = os_gettime_ns();
+		if (dbr_tcp_estimator_due(&est, ts)) {
+			long kbps;
+
+			if (!dbr_tcp_sample_read(fd, &sample)) {
+				fprintf(stderr, "TCP_INFO is not available\n");
+				break;
+			}
+
+			kbps = dbr_tcp_estimator_update(&est, &sample, bench.stream_kbps);
+			if (kbps)
+				record(&tcp_info, ts, kbps);
+		}
+
+		if ((tcp_info.ts && queue.ts) || ts >= bench.drop_ts + TIMEOUT_SEC * 1000000000ULL)
+			break;
+	}
+
+	os_atomic_set_bool(&bench.stop, true);
+	pthread_join(encoder, NULL);
+	pthread_join(sink, NULL);
+	close(fd);
+	close(bench.listen_fd);
+
+	printf("%-10s  %12s  %12s  %s\n", "estimate", "reaction ms", "false alarms", "estimated kbps");
+
+	struct reaction *reactions[] = {&tcp_info, &queue};
+	for (size_t i = 0; i < sizeof(reactions) / sizeof(reactions[0]); i++) {
+		struct reaction *r = reactions[i];
+
+		if (r->ts && r->kbps)
+			printf("%-10s  %12.1f  %12d  %ld\n", r->name, (double)(r->ts - bench.drop_ts) / 1000000.0,
+			       r->false_alarms, r->kbps);
+		else if (r->ts)
+			printf("%-10s  %12.1f  %12d  -\n", r->name, (double)(r->ts - bench.drop_ts) / 1000000.0,
+			       r->false_alarms);
+		else
+			printf("%-10s  %12s  %12d  -\n", r->name, "none", r->false_alarms);
+	}
+
+	deque_free(&bench.packets);
+	os_sem_destroy(bench.send_sem);
+	pthread_mutex_destroy(&bench.mutex);
+	bfree(data);
+	return 0;
+}
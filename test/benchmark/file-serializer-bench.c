@@ -0,0 +1,152 @@
+/*
+ * Benchmark for the buffered file serializer in libobs/util.
+ *
+ * Several files are written at the same time, one thread each, like
+ * simultaneous multi-track recordings through mp4-mux: large video packets,
+ * an occasional small patch of an earlier header, and a final seek back to
+ * fill in the size of the media data.  Each writer mode is run in turn and
+ * the files are checked for their expected size.  Modes that aren't
+ * available fall back to stdio, which the serializer logs.
+ *
+ * usage: file-serializer-bench [directory] [MiB per file] [files]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/serializer.h>
+#include <util/buffered-file-serializer.h>
+
+/* a high bitrate intra-only stream, with packets of 1 to 2 MiB */
+#define MIN_PACKET_SIZE (1024 * 1024)
+#define MAX_PACKET_SIZE (2 * 1024 * 1024)
+#define PATCH_INTERVAL 64
+
+struct writer_mode {
+	const char *name;
+	uint32_t flags;
+};
+
+static const struct writer_mode modes[] = {
+	{"stdio", 0},
+	{"io_uring", BUFFERED_FILE_SERIALIZER_IO_URING},
+	{"io_uring+direct", BUFFERED_FILE_SERIALIZER_IO_URING | BUFFERED_FILE_SERIALIZER_DIRECT_IO},
+};
+
+#define NUM_MODES (sizeof(modes) / sizeof(modes[0]))
+
+struct file_job {
+	pthread_t thread;
+	struct dstr path;
+	uint32_t flags;
+	uint64_t size;
+	uint8_t *packet;
+	bool success;
+};
+
+static void *write_file(void *data)
+{
+	struct file_job *job = data;
+	struct serializer s;
+	uint64_t written = 0;
+	uint32_t seed = (uint32_t)(uintptr_t)job;
+	size_t count = 0;
+
+	job->success = buffered_file_serializer_init2(&s, job->path.array, 0, 0, job->flags);
+	if (!job->success)
+		return NULL;
+
+	while (written < job->size) {
+		size_t size;
+
+		seed = seed * 1103515245 + 12345;
+		size = MIN_PACKET_SIZE + (seed >> 8) % (MAX_PACKET_SIZE - MIN_PACKET_SIZE);
+		if (size > job->size - written)
+			size = (size_t)(job->size - written);
+
+		s_write(&s, job->packet, size);
+		written += size;
+
+		/* fragment headers patched after their data was written */
+		if (++count % PATCH_INTERVAL == 0) {
+			serializer_seek(&s, (int64_t)(written - size), SERIALIZE_SEEK_START);
+			s_wb32(&s, (uint32_t)size);
+			serializer_seek(&s, (int64_t)written, SERIALIZE_SEEK_START);
+		}
+	}
+
+	serializer_seek(&s, 0, SERIALIZE_SEEK_START);
+	s_wb64(&s, written);
+	serializer_seek(&s, (int64_t)written, SERIALIZE_SEEK_START);
+
+	job->success = serializer_get_pos(&s) == (int64_t)written;
+	buffered_file_serializer_free(&s);
+	return NULL;
+}
+
+static void bench(const char *dir, const struct writer_mode *mode, uint64_t size, size_t num_files, uint8_t *packet)
+{
+	struct file_job *jobs = bzalloc(sizeof(struct file_job) * num_files);
+	bool success = true;
+	uint64_t start, end;
+	double seconds;
+
+	for (size_t i = 0; i < num_files; i++) {
+		dstr_printf(&jobs[i].path, "%s/file-serializer-bench-%zu.bin", dir, i);
+		jobs[i].flags = mode->flags;
+		jobs[i].size = size;
+		jobs[i].packet = packet;
+	}
+
+	start = os_gettime_ns();
+
+	for (size_t i = 0; i < num_files; i++)
+		pthread_create(&jobs[i].thread, NULL, write_file, &jobs[i]);
+	for (size_t i = 0; i < num_files; i++)
+		pthread_join(jobs[i].thread, NULL);
+
+	end = os_gettime_ns();
+	seconds = (double)(end - start) / 1e9;
+
+	for (size_t i = 0; i < num_files; i++) {
+		if (!jobs[i].success || os_get_file_size(jobs[i].path.array) != (int64_t)size)
+			success = false;
+
+		os_unlink(jobs[i].path.array);
+		dstr_free(&jobs[i].path);
+	}
+
+	printf("%-16s %6zu %10.2f %10.2f%s\n", mode->name, num_files, seconds,
+	       (double)(size * num_files) / seconds / 1e9, success ? "" : "  (FAILED)");
+
+	bfree(jobs);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *dir = argc > 1 ? argv[1] : ".";
+	uint64_t size = (argc > 2 ? strtoull(argv[2], NULL, 10) : 1024) * 1024 * 1024;
+	size_t num_files = argc > 3 ? strtoul(argv[3], NULL, 10) : 4;
+	uint8_t *packet = bmalloc(MAX_PACKET_SIZE);
+
+	if (!size)
+		size = 1024ULL * 1024 * 1024;
+	if (!num_files)
+		num_files = 4;
+
+	for (size_t i = 0; i < MAX_PACKET_SIZE; i++)
+		packet[i] = (uint8_t)(i * 131 + 7);
+
+	printf("%-16s %6s %10s %10s\n", "writer", "files", "seconds", "GB/s");
+
+	for (size_t m = 0; m < NUM_MODES; m++)
+		bench(dir, &modes[m], size, num_files, packet);
+
+	bfree(packet);
+	return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Throughput benchmark for the CPU format conversion kernels in
+ * libobs/media-io/format-conversion.c.
+ *
+ * Every kernel is run for each supported instruction set at a few common
+ * resolutions, both on the calling thread and slice-parallel on a work pool,
+ * and the throughput (bytes read + written per second) is reported.
+ * Outputs are compared against the SSE2 kernels before timing.
+ *
+ * usage: format-conversion-bench [seconds per test] [threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/task.h>
+#include <media-io/format-conversion.h>
+
+enum kernel {
+	KERNEL_UYVX_TO_I420,
+	KERNEL_UYVX_TO_NV12,
+	KERNEL_UYVX_TO_I444,
+	KERNEL_NV12_TO_PACKED,
+	KERNEL_420_TO_PACKED,
+	KERNEL_422_TO_PACKED,
+	KERNEL_COUNT,
+};
+
+static const char *kernel_names[KERNEL_COUNT] = {
+	"compress_uyvx_to_i420", "compress_uyvx_to_nv12", "convert_uyvx_to_i444",
+	"decompress_nv12",       "decompress_420",        "decompress_422",
+};
+
+static const char *simd_names[] = {"sse2", "avx2", "neon"};
+
+struct resolution {
+	const char *name;
+	uint32_t width;
+	uint32_t height;
+};
+
+static const struct resolution resolutions[] = {
+	{"720p", 1280, 720},
+	{"1080p", 1920, 1080},
+	{"1440p", 2560, 1440},
+	{"2160p", 3840, 2160},
+};
+
+#define NUM_RESOLUTIONS (sizeof(resolutions) / sizeof(resolutions[0]))
+
+struct frame {
+	uint32_t width;
+	uint32_t height;
+
+	/* packed 32-bit pixels (also used as 4:2:2 input) */
+	uint8_t *packed;
+	uint32_t packed_linesize;
+
+	/* up to three planes */
+	uint8_t *planes[3];
+	uint32_t linesize[3];
+	size_t plane_size[3];
+};
+
+static uint8_t *alloc_plane(uint32_t linesize, uint32_t height)
+{
+	size_t size = (size_t)linesize * height;
+	uint8_t *data = bmalloc(size);
+
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)rand();
+	return data;
+}
+
+static void frame_init(struct frame *frame, uint32_t width, uint32_t height)
+{
+	memset(frame, 0, sizeof(*frame));
+	frame->width = width;
+	frame->height = height;
+	frame->packed_linesize = width * 4;
+	frame->packed = alloc_plane(frame->packed_linesize, height);
+
+	for (size_t i = 0; i < 3; i++) {
+		frame->linesize[i] = width;
+		frame->plane_size[i] = (size_t)width * height;
+		frame->planes[i] = alloc_plane(width, height);
+	}
+}
+
+static void frame_free(struct frame *frame)
+{
+	bfree(frame->packed);
+	for (size_t i = 0; i < 3; i++)
+		bfree(frame->planes[i]);
+}
+
+/* returns the number of bytes read and written */
+static size_t run_kernel(enum kernel kernel, os_work_pool_t *pool, struct frame *in, struct frame *out)
+{
+	uint32_t w = in->width;
+	uint32_t h = in->height;
+	size_t packed_size = (size_t)w * 4 * h;
+	size_t lum_size = (size_t)w * h;
+	const uint8_t *const *planes = (const uint8_t *const *)in->planes;
+
+	switch (kernel) {
+	case KERNEL_UYVX_TO_I420: {
+		uint32_t linesize[3] = {w, w / 2, w / 2};
+		compress_uyvx_to_i420_sliced(pool, in->packed, in->packed_linesize, 0, h, out->planes, linesize);
+		return packed_size + lum_size * 3 / 2;
+	}
+	case KERNEL_UYVX_TO_NV12: {
+		uint32_t linesize[2] = {w, w};
+		compress_uyvx_to_nv12_sliced(pool, in->packed, in->packed_linesize, 0, h, out->planes, linesize);
+		return packed_size + lum_size * 3 / 2;
+	}
+	case KERNEL_UYVX_TO_I444:
+		convert_uyvx_to_i444_sliced(pool, in->packed, in->packed_linesize, 0, h, out->planes, out->linesize);
+		return packed_size + lum_size * 3;
+	case KERNEL_NV12_TO_PACKED: {
+		uint32_t linesize[2] = {w, w};
+		decompress_nv12_sliced(pool, planes, linesize, 0, h, out->packed, out->packed_linesize);
+		return lum_size * 3 / 2 + packed_size;
+	}
+	case KERNEL_420_TO_PACKED: {
+		uint32_t linesize[3] = {w, w / 2, w / 2};
+		decompress_420_sliced(pool, planes, linesize, 0, h, out->packed, out->packed_linesize);
+		return lum_size * 3 / 2 + packed_size;
+	}
+	case KERNEL_422_TO_PACKED:
+		decompress_422_sliced(pool, in->packed, w * 2, 0, h, out->packed, out->packed_linesize, true);
+		return packed_size / 2 + packed_size;
+	case KERNEL_COUNT:
+		break;
+	}
+
+	return 0;
+}
+
+static bool frames_match(const struct frame *a, const struct frame *b)
+{
+	size_t packed_size = (size_t)a->packed_linesize * a->height;
+
+	if (memcmp(a->packed, b->packed, packed_size) != 0)
+		return false;
+
+	for (size_t i = 0; i < 3; i++)
+		if (memcmp(a->planes[i], b->planes[i], a->plane_size[i]) != 0)
+			return false;
+
+	return true;
+}
+
+static void copy_frame(struct frame *dst, const struct frame *src)
+{
+	memcpy(dst->packed, src->packed, (size_t)src->packed_linesize * src->height);
+	for (size_t i = 0; i < 3; i++)
+		memcpy(dst->planes[i], src->planes[i], src->plane_size[i]);
+}
+
+static void bench(enum kernel kernel, const struct resolution *res, enum format_conversion_simd simd,
+		  os_work_pool_t *pool, double seconds, struct frame *in, struct frame *out, struct frame *ref)
+{
+	uint64_t limit = (uint64_t)(seconds * 1000000000.0);
+	uint64_t start, elapsed;
+	size_t bytes = 0;
+	size_t frames = 0;
+	bool match;
+
+	/* reference output from the SSE2 kernels, then check this variant */
+	format_conversion_set_simd(FORMAT_CONVERSION_SIMD_SSE2);
+	copy_frame(ref, out);
+	run_kernel(kernel, NULL, in, ref);
+
+	format_conversion_set_simd(simd);
+	run_kernel(kernel, pool, in, out);
+	match = frames_match(out, ref);
+
+	start = os_gettime_ns();
+	do {
+		bytes += run_kernel(kernel, pool, in, out);
+		frames++;
+		elapsed = os_gettime_ns() - start;
+	} while (elapsed < limit);
+
+	printf("%-22s %-6s %-5s %7zu %9.2f %9.3f%s\n", kernel_names[kernel], res->name, simd_names[simd],
+	       os_work_pool_num_threads(pool) + 1, (double)bytes / (double)elapsed,
+	       (double)elapsed / (double)frames / 1000000.0, match ? "" : "  MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+	int threads = argc > 2 ? atoi(argv[2]) : os_get_logical_cores();
+	os_work_pool_t *pool;
+
+	if (seconds <= 0.0)
+		seconds = 0.5;
+	if (threads < 1)
+		threads = 1;
+
+	pool = threads > 1 ? os_work_pool_create((size_t)threads - 1) : NULL;
+
+	printf("%-22s %-6s %-5s %7s %9s %9s\n", "kernel", "res", "simd", "threads", "GB/s", "ms/frame");
+
+	for (size_t r = 0; r < NUM_RESOLUTIONS; r++) {
+		const struct resolution *res = &resolutions[r];
+		struct frame in, out, ref;
+
+		frame_init(&in, res->width, res->height);
+		frame_init(&out, res->width, res->height);
+		frame_init(&ref, res->width, res->height);
+
+		for (int k = 0; k < KERNEL_COUNT; k++) {
+			for (int s = FORMAT_CONVERSION_SIMD_SSE2; s <= FORMAT_CONVERSION_SIMD_NEON; s++) {
+				if (!format_conversion_simd_supported(s))
+					continue;
+
+				bench(k, res, s, NULL, seconds, &in, &out, &ref);
+				if (pool)
+					bench(k, res, s, pool, seconds, &in, &out, &ref);
+			}
+		}
+
+		frame_free(&in);
+		frame_free(&out);
+		frame_free(&ref);
+	}
+
+	os_work_pool_destroy(pool);
+	return 0;
+}
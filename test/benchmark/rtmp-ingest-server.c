@@ -0,0 +1,73 @@
+/*
+ * Standalone RTMP ingest stand-in.  Point a stream at
+ * rtmp://<address>:<port>/live with any stream key; every second the
+ * received data is checked and summarized.  Stops with Ctrl+C.
+ *
+ * usage: rtmp-ingest-server [port] [read kbps] [address]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "rtmp-ingest.h"
+
+static volatile bool stop = false;
+
+static void on_signal(int sig)
+{
+	UNUSED_PARAMETER(sig);
+	os_atomic_set_bool(&stop, true);
+}
+
+int main(int argc, char *argv[])
+{
+	int port = argc > 1 ? atoi(argv[1]) : 1935;
+	int read_kbps = argc > 2 ? atoi(argv[2]) : 0;
+	const char *address = argc > 3 ? argv[3] : "0.0.0.0";
+	struct rtmp_ingest_stats stats, prev = {0};
+	struct rtmp_ingest *ingest;
+
+	if (port < 0 || read_kbps < 0) {
+		fprintf(stderr, "usage: %s [port] [read kbps] [address]\n", argv[0]);
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	ingest = rtmp_ingest_create(address, port, read_kbps);
+	if (!ingest) {
+		fprintf(stderr, "failed to listen on %s:%d\n", address, port);
+		return 1;
+	}
+
+	printf("listening on rtmp://%s:%d/live\n", address, rtmp_ingest_get_port(ingest));
+
+	while (!os_atomic_load_bool(&stop)) {
+		os_sleep_ms(1000);
+
+		rtmp_ingest_get_stats(ingest, &stats);
+		if (stats.bytes_received == prev.bytes_received)
+			continue;
+
+		printf("%s, %.0f kbps, %llu invalid tags", stats.publishing ? "publishing" : "connected",
+		       (double)(stats.bytes_received - prev.bytes_received) * 8.0 / 1000.0,
+		       (unsigned long long)stats.invalid_tags);
+		if (stats.latency_samples)
+			printf(", latency %.2f ms p50 / %.2f ms p95", (double)stats.latency_p50_ns / 1000000.0,
+			       (double)stats.latency_p95_ns / 1000000.0);
+		printf("\n");
+		fflush(stdout);
+		prev = stats;
+	}
+
+	rtmp_ingest_get_stats(ingest, &stats);
+	rtmp_ingest_print_stats(stdout, &stats);
+	rtmp_ingest_destroy(ingest);
+	return stats.invalid_tags ? 1 : 0;
+}
@@ -0,0 +1,1175 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/serializer.h>
+#include <util/array-serializer.h>
+#include <util/threading.h>
+
+#include "rtmp-ingest.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define HANDSHAKE_SIZE 1536
+#define DEFAULT_CHUNK_SIZE 128
+#define MAX_MESSAGE_SIZE (16 * 1024 * 1024)
+#define READ_BUF_SIZE (64 * 1024)
+#define POLL_TIMEOUT_MS 100
+#define STREAM_ID 1
+
+/* with a read limit, the receive buffer stands in for the queue at the
+ * bottleneck, so it has to be small for the sender to notice the limit */
+#define LIMITED_RCVBUF (64 * 1024)
+#define RATE_TICK_NS 2000000ULL
+#define RATE_BURST_SEC 0.01
+
+#define MAX_LATENCY_SAMPLES (1024 * 1024)
+/* the marker is written right after the NAL header of the frame */
+#define MARKER_SEARCH_SIZE 64
+
+enum message_type {
+	MSG_SET_CHUNK_SIZE = 1,
+	MSG_ABORT = 2,
+	MSG_WINDOW_ACK_SIZE = 5,
+	MSG_SET_PEER_BANDWIDTH = 6,
+	MSG_AUDIO = 8,
+	MSG_VIDEO = 9,
+	MSG_DATA_AMF0 = 18,
+	MSG_COMMAND_AMF0 = 20,
+};
+
+enum amf_type {
+	AMF_NUMBER = 0,
+	AMF_STRING = 2,
+	AMF_OBJECT = 3,
+	AMF_NULL = 5,
+	AMF_ECMA_ARRAY = 8,
+	AMF_OBJECT_END = 9,
+};
+
+/* legacy AVC/AAC packet types use the same values for the same meaning */
+enum packet_type {
+	PACKETTYPE_SEQ_START = 0,
+	PACKETTYPE_FRAMES = 1,
+	PACKETTYPE_SEQ_END = 2,
+	PACKETTYPE_FRAMESX = 3,
+	PACKETTYPE_METADATA = 4,
+	PACKETTYPE_VIDEO_MULTITRACK = 6,
+};
+
+enum audio_packet_type {
+	AUDIO_PACKETTYPE_MULTICHANNEL_CONFIG = 4,
+	AUDIO_PACKETTYPE_MULTITRACK = 5,
+};
+
+#define FLV_VIDEO_EX_HEADER 0x80
+#define FLV_CODEC_AVC 7
+#define FLV_SOUND_EX_HEADER 9
+#define FLV_SOUND_AAC 10
+#define FRAMETYPE_KEY 1
+#define FRAMETYPE_INTER 2
+#define MULTITRACKTYPE_ONE_TRACK 0
+
+struct chunk_stream {
+	uint32_t csid;
+	uint32_t timestamp;
+	uint32_t delta;
+	uint32_t length;
+	uint32_t stream_id;
+	uint8_t type;
+	bool has_header;
+	bool extended;
+
+	uint32_t received;
+	DARRAY(uint8_t) body;
+};
+
+struct connection {
+	int fd;
+	uint8_t *buf;
+	size_t pos;
+	size_t len;
+
+	double tokens;
+	uint64_t rate_ts;
+
+	uint32_t chunk_size;
+	DARRAY(struct chunk_stream) streams;
+
+	int64_t last_dts[2][RTMP_INGEST_MAX_TRACKS];
+};
+
+struct tag_info {
+	bool video;
+	size_t track;
+	bool header;
+	bool keyframe;
+	bool metadata;
+	bool frames;
+	bool has_marker;
+	uint64_t marker_ts;
+};
+
+struct rtmp_ingest {
+	int listen_fd;
+	int port;
+	int read_kbps;
+	volatile bool stop;
+	pthread_t thread;
+	bool thread_created;
+
+	pthread_mutex_t mutex;
+	struct rtmp_ingest_stats stats;
+	DARRAY(uint64_t) latencies;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static inline uint32_t rb16(const uint8_t *data)
+{
+	return ((uint32_t)data[0] << 8) | data[1];
+}
+
+static inline uint32_t rb24(const uint8_t *data)
+{
+	return ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+}
+
+static inline uint32_t rb32(const uint8_t *data)
+{
+	return ((uint32_t)data[0] << 24) | rb24(data + 1);
+}
+
+static inline uint32_t rl32(const uint8_t *data)
+{
+	return data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static inline uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void record_error(struct rtmp_ingest *ingest, const char *error)
+{
+	pthread_mutex_lock(&ingest->mutex);
+	ingest->stats.invalid_tags++;
+	if (!ingest->stats.first_error[0])
+		snprintf(ingest->stats.first_error, sizeof(ingest->stats.first_error), "%s", error);
+	pthread_mutex_unlock(&ingest->mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* socket I/O                                                                */
+
+static bool conn_fill(struct rtmp_ingest *ingest, struct connection *conn)
+{
+	while (!os_atomic_load_bool(&ingest->stop)) {
+		size_t space = READ_BUF_SIZE - conn->len;
+		struct pollfd pfd = {.fd = conn->fd, .events = POLLIN};
+		ssize_t ret;
+
+		if (ingest->read_kbps > 0) {
+			double bytes_per_sec = ingest->read_kbps * 1000.0 / 8.0;
+			uint64_t ts = os_gettime_ns();
+
+			conn->tokens += bytes_per_sec * (double)(ts - conn->rate_ts) / 1000000000.0;
+			conn->rate_ts = ts;
+
+			/* capacity that isn't used is lost */
+			if (conn->tokens > bytes_per_sec * RATE_BURST_SEC)
+				conn->tokens = bytes_per_sec * RATE_BURST_SEC;
+
+			if (conn->tokens < 1.0) {
+				os_sleepto_ns(ts + RATE_TICK_NS);
+				continue;
+			}
+
+			if ((double)space > conn->tokens)
+				space = (size_t)conn->tokens;
+		}
+
+		ret = poll(&pfd, 1, POLL_TIMEOUT_MS);
+		if (ret == 0 || (ret < 0 && errno == EINTR))
+			continue;
+		if (ret < 0)
+			return false;
+
+		ret = recv(conn->fd, conn->buf + conn->len, space, 0);
+		if (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+			continue;
+		if (ret <= 0)
+			return false;
+
+		conn->len += (size_t)ret;
+		conn->tokens -= (double)ret;
+
+		pthread_mutex_lock(&ingest->mutex);
+		ingest->stats.bytes_received += (uint64_t)ret;
+		pthread_mutex_unlock(&ingest->mutex);
+		return true;
+	}
+
+	return false;
+}
+
+/* dst can be NULL to skip data */
+static bool conn_read(struct rtmp_ingest *ingest, struct connection *conn, void *dst, size_t size)
+{
+	uint8_t *out = dst;
+
+	while (size) {
+		size_t avail = conn->len - conn->pos;
+
+		if (!avail) {
+			conn->pos = conn->len = 0;
+			if (!conn_fill(ingest, conn))
+				return false;
+			continue;
+		}
+
+		if (avail > size)
+			avail = size;
+		if (out) {
+			memcpy(out, conn->buf + conn->pos, avail);
+			out += avail;
+		}
+
+		conn->pos += avail;
+		size -= avail;
+	}
+
+	return true;
+}
+
+static bool send_all(int fd, const uint8_t *data, size_t size)
+{
+	while (size) {
+		ssize_t ret = send(fd, data, size, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		data += ret;
+		size -= (size_t)ret;
+	}
+
+	return true;
+}
+
+/* messages from the server are small, so they're sent with the default
+ * chunk size */
+static bool send_message(struct connection *conn, uint8_t csid, uint8_t type, uint32_t stream_id,
+			 const uint8_t *body, size_t size)
+{
+	struct array_output_data data;
+	struct serializer s;
+	bool success;
+
+	array_output_serializer_init(&s, &data);
+
+	s_w8(&s, csid);
+	s_wb24(&s, 0);
+	s_wb24(&s, (uint32_t)size);
+	s_w8(&s, type);
+	s_wl32(&s, stream_id);
+
+	for (size_t pos = 0; pos < size; pos += DEFAULT_CHUNK_SIZE) {
+		size_t chunk = size - pos < DEFAULT_CHUNK_SIZE ? size - pos : DEFAULT_CHUNK_SIZE;
+
+		if (pos)
+			s_w8(&s, 0xC0 | csid);
+		s_write(&s, body + pos, chunk);
+	}
+
+	success = send_all(conn->fd, data.bytes.array, data.bytes.num);
+	array_output_serializer_free(&data);
+	return success;
+}
+
+static bool send_control(struct connection *conn, uint8_t type, uint32_t value, int extra_byte)
+{
+	uint8_t body[5] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value,
+			   (uint8_t)extra_byte};
+
+	return send_message(conn, 2, type, 0, body, extra_byte >= 0 ? 5 : 4);
+}
+
+/* ------------------------------------------------------------------------- */
+/* AMF0 commands                                                             */
+
+static void amf_string(struct serializer *s, const char *str)
+{
+	size_t len = strlen(str);
+
+	s_w8(s, AMF_STRING);
+	s_wb16(s, (uint16_t)len);
+	s_write(s, str, len);
+}
+
+static void amf_number(struct serializer *s, double val)
+{
+	s_w8(s, AMF_NUMBER);
+	s_wbd(s, val);
+}
+
+static inline void amf_prop_name(struct serializer *s, const char *name)
+{
+	size_t len = strlen(name);
+
+	s_wb16(s, (uint16_t)len);
+	s_write(s, name, len);
+}
+
+static void amf_prop_string(struct serializer *s, const char *name, const char *val)
+{
+	amf_prop_name(s, name);
+	amf_string(s, val);
+}
+
+static void amf_prop_number(struct serializer *s, const char *name, double val)
+{
+	amf_prop_name(s, name);
+	amf_number(s, val);
+}
+
+static inline void amf_object_end(struct serializer *s)
+{
+	s_wb16(s, 0);
+	s_w8(s, AMF_OBJECT_END);
+}
+
+static bool amf_read_string(const uint8_t **data, const uint8_t *end, char *str, size_t size)
+{
+	size_t len;
+
+	if (end - *data < 3 || **data != AMF_STRING)
+		return false;
+
+	len = rb16(*data + 1);
+	if ((size_t)(end - *data - 3) < len)
+		return false;
+
+	if (size) {
+		size_t copy = len < size - 1 ? len : size - 1;
+		memcpy(str, *data + 3, copy);
+		str[copy] = 0;
+	}
+
+	*data += 3 + len;
+	return true;
+}
+
+static bool amf_read_number(const uint8_t **data, const uint8_t *end, double *val)
+{
+	uint64_t bits = 0;
+
+	if (end - *data < 9 || **data != AMF_NUMBER)
+		return false;
+
+	for (size_t i = 1; i < 9; i++)
+		bits = (bits << 8) | (*data)[i];
+	memcpy(val, &bits, sizeof(*val));
+
+	*data += 9;
+	return true;
+}
+
+static bool send_command(struct connection *conn, uint32_t stream_id, struct array_output_data *data)
+{
+	bool success = send_message(conn, 3, MSG_COMMAND_AMF0, stream_id, data->bytes.array, data->bytes.num);
+	array_output_serializer_free(data);
+	return success;
+}
+
+static bool send_connect_result(struct connection *conn, double txn)
+{
+	struct array_output_data data;
+	struct serializer s;
+
+	if (!send_control(conn, MSG_WINDOW_ACK_SIZE, 5000000, -1) ||
+	    !send_control(conn, MSG_SET_PEER_BANDWIDTH, 5000000, 2))
+		return false;
+
+	array_output_serializer_init(&s, &data);
+	amf_string(&s, "_result");
+	amf_number(&s, txn);
+
+	s_w8(&s, AMF_OBJECT);
+	amf_prop_string(&s, "fmsVer", "FMS/3,0,1,123");
+	amf_prop_number(&s, "capabilities", 31.0);
+	amf_object_end(&s);
+
+	s_w8(&s, AMF_OBJECT);
+	amf_prop_string(&s, "level", "status");
+	amf_prop_string(&s, "code", "NetConnection.Connect.Success");
+	amf_prop_string(&s, "description", "Connection succeeded.");
+	amf_prop_number(&s, "objectEncoding", 0.0);
+	amf_object_end(&s);
+
+	return send_command(conn, 0, &data);
+}
+
+static bool send_create_stream_result(struct connection *conn, double txn)
+{
+	struct array_output_data data;
+	struct serializer s;
+
+	array_output_serializer_init(&s, &data);
+	amf_string(&s, "_result");
+	amf_number(&s, txn);
+	s_w8(&s, AMF_NULL);
+	amf_number(&s, STREAM_ID);
+
+	return send_command(conn, 0, &data);
+}
+
+static bool send_publish_start(struct connection *conn)
+{
+	struct array_output_data data;
+	struct serializer s;
+
+	array_output_serializer_init(&s, &data);
+	amf_string(&s, "onStatus");
+	amf_number(&s, 0.0);
+	s_w8(&s, AMF_NULL);
+
+	s_w8(&s, AMF_OBJECT);
+	amf_prop_string(&s, "level", "status");
+	amf_prop_string(&s, "code", "NetStream.Publish.Start");
+	amf_prop_string(&s, "description", "Publishing.");
+	amf_object_end(&s);
+
+	return send_command(conn, STREAM_ID, &data);
+}
+
+static void set_publishing(struct rtmp_ingest *ingest, bool publishing)
+{
+	pthread_mutex_lock(&ingest->mutex);
+	ingest->stats.publishing = publishing;
+	pthread_mutex_unlock(&ingest->mutex);
+}
+
+static bool handle_command(struct rtmp_ingest *ingest, struct connection *conn, const uint8_t *data, size_t size)
+{
+	const uint8_t *end = data + size;
+	double txn = 0.0;
+	char name[64];
+
+	if (!amf_read_string(&data, end, name, sizeof(name))) {
+		record_error(ingest, "malformed command");
+		return true;
+	}
+
+	amf_read_number(&data, end, &txn);
+
+	if (strcmp(name, "connect") == 0)
+		return send_connect_result(conn, txn);
+	if (strcmp(name, "createStream") == 0)
+		return send_create_stream_result(conn, txn);
+
+	if (strcmp(name, "publish") == 0) {
+		set_publishing(ingest, true);
+		return send_publish_start(conn);
+	}
+
+	if (strcmp(name, "FCUnpublish") == 0 || strcmp(name, "deleteStream") == 0)
+		set_publishing(ingest, false);
+
+	/* releaseStream and FCPublish don't need an answer */
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* FLV tag checks                                                            */
+
+static bool parse_marker(const uint8_t *data, size_t size, uint64_t *ts)
+{
+	size_t limit = size < MARKER_SEARCH_SIZE ? size : MARKER_SEARCH_SIZE;
+
+	for (size_t i = 0; i + RTMP_INGEST_MARKER_SIZE <= size && i < limit; i++) {
+		const uint8_t *hex = data + i + RTMP_INGEST_MARKER_LEN;
+		uint64_t val = 0;
+		size_t j;
+
+		if (memcmp(data + i, RTMP_INGEST_MARKER, RTMP_INGEST_MARKER_LEN) != 0)
+			continue;
+
+		for (j = 0; j < 16; j++) {
+			uint8_t c = hex[j];
+
+			if (c >= '0' && c <= '9')
+				val = (val << 4) | (uint64_t)(c - '0');
+			else if (c >= 'a' && c <= 'f')
+				val = (val << 4) | (uint64_t)(c - 'a' + 10);
+			else
+				break;
+		}
+
+		if (j == 16) {
+			*ts = val;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* the NAL units of AVC frames are prefixed with 4 byte lengths, which have
+ * to add up to the payload exactly */
+static bool check_avcc(const uint8_t *data, size_t size)
+{
+	size_t pos = 0;
+
+	if (!size)
+		return false;
+
+	while (pos < size) {
+		uint32_t len;
+
+		if (size - pos < 4)
+			return false;
+
+		len = rb32(data + pos);
+		if (!len || size - pos - 4 < len)
+			return false;
+
+		pos += 4 + len;
+	}
+
+	return true;
+}
+
+static const char *check_video(struct tag_info *info, const uint8_t *data, size_t size)
+{
+	const uint8_t *fourcc = NULL;
+	uint8_t frame_type, packet_type;
+	bool avc, composition_time;
+	size_t offset;
+
+	info->video = true;
+
+	if (size < 5)
+		return "truncated video tag";
+
+	frame_type = (data[0] >> 4) & 0x07;
+
+	if (data[0] & FLV_VIDEO_EX_HEADER) {
+		packet_type = data[0] & 0x0F;
+		fourcc = data + 1;
+		offset = 5;
+
+		if (packet_type == PACKETTYPE_VIDEO_MULTITRACK) {
+			if (size < 7)
+				return "truncated multitrack video tag";
+			if ((data[1] & 0xF0) != MULTITRACKTYPE_ONE_TRACK)
+				return "unexpected multitrack type in video tag";
+
+			packet_type = data[1] & 0x0F;
+			fourcc = data + 2;
+			info->track = data[6];
+			offset = 7;
+		}
+
+		avc = memcmp(fourcc, "avc1", 4) == 0;
+		if (!avc && memcmp(fourcc, "hvc1", 4) != 0 && memcmp(fourcc, "av01", 4) != 0)
+			return "unknown video fourcc";
+		if (packet_type > PACKETTYPE_METADATA)
+			return "unexpected enhanced video packet type";
+
+		composition_time = packet_type == PACKETTYPE_FRAMES && memcmp(fourcc, "av01", 4) != 0;
+	} else {
+		if ((data[0] & 0x0F) != FLV_CODEC_AVC)
+			return "legacy video tag is not AVC";
+		if (data[1] > PACKETTYPE_SEQ_END)
+			return "unexpected AVC packet type";
+
+		packet_type = data[1];
+		avc = true;
+		composition_time = true;
+		offset = 2;
+	}
+
+	if (composition_time)
+		offset += 3;
+	if (info->track >= RTMP_INGEST_MAX_TRACKS)
+		return "video track out of range";
+	if (offset > size)
+		return "truncated video tag";
+
+	data += offset;
+	size -= offset;
+
+	if (packet_type == PACKETTYPE_METADATA) {
+		info->metadata = true;
+		return NULL;
+	}
+
+	if (frame_type != FRAMETYPE_KEY && frame_type != FRAMETYPE_INTER)
+		return "unexpected video frame type";
+
+	switch (packet_type) {
+	case PACKETTYPE_SEQ_START:
+		info->header = true;
+		if (avc && (size < 7 || data[0] != 1))
+			return "invalid AVC decoder configuration";
+		if (!size)
+			return "empty video sequence header";
+		break;
+
+	case PACKETTYPE_FRAMES:
+	case PACKETTYPE_FRAMESX:
+		info->frames = true;
+		info->keyframe = frame_type == FRAMETYPE_KEY;
+		if (avc && !check_avcc(data, size))
+			return "malformed AVC NAL unit lengths";
+		if (!size)
+			return "empty video frame";
+
+		info->has_marker = parse_marker(data, size, &info->marker_ts);
+		break;
+	}
+
+	return NULL;
+}
+
+static const char *check_audio(struct tag_info *info, const uint8_t *data, size_t size)
+{
+	uint8_t sound_format, packet_type;
+	size_t offset;
+
+	if (size < 2)
+		return "truncated audio tag";
+
+	sound_format = data[0] >> 4;
+
+	if (sound_format == FLV_SOUND_AAC) {
+		if (data[1] > PACKETTYPE_FRAMES)
+			return "unexpected AAC packet type";
+
+		packet_type = data[1];
+		offset = 2;
+	} else if (sound_format == FLV_SOUND_EX_HEADER) {
+		const uint8_t *fourcc = data + 1;
+
+		packet_type = data[0] & 0x0F;
+		offset = 5;
+
+		if (packet_type == AUDIO_PACKETTYPE_MULTITRACK) {
+			if (size < 7)
+				return "truncated multitrack audio tag";
+			if ((data[1] & 0xF0) != MULTITRACKTYPE_ONE_TRACK)
+				return "unexpected multitrack type in audio tag";
+
+			packet_type = data[1] & 0x0F;
+			fourcc = data + 2;
+			info->track = data[6];
+			offset = 7;
+		}
+
+		if (offset > size)
+			return "truncated audio tag";
+		if (memcmp(fourcc, "mp4a", 4) != 0 && memcmp(fourcc, "Opus", 4) != 0)
+			return "unknown audio fourcc";
+		if (packet_type > PACKETTYPE_SEQ_END && packet_type != AUDIO_PACKETTYPE_MULTICHANNEL_CONFIG)
+			return "unexpected enhanced audio packet type";
+	} else {
+		return "unexpected audio format";
+	}
+
+	if (info->track >= RTMP_INGEST_MAX_TRACKS)
+		return "audio track out of range";
+
+	size -= offset;
+
+	if (packet_type == PACKETTYPE_SEQ_START) {
+		info->header = true;
+		if (size < 2)
+			return "invalid audio specific config";
+	} else if (packet_type == PACKETTYPE_FRAMES) {
+		info->frames = true;
+		if (!size)
+			return "empty audio frame";
+	}
+
+	return NULL;
+}
+
+static const char *check_metadata(const uint8_t *data, size_t size)
+{
+	const uint8_t *end = data + size;
+	char name[32];
+
+	if (!amf_read_string(&data, end, name, sizeof(name)))
+		return "malformed data message";
+	if (strcmp(name, "@setDataFrame") == 0 && !amf_read_string(&data, end, name, sizeof(name)))
+		return "malformed @setDataFrame";
+	if (strcmp(name, "onMetaData") != 0)
+		return "unexpected data message";
+	if (data == end || (*data != AMF_ECMA_ARRAY && *data != AMF_OBJECT))
+		return "onMetaData without values";
+
+	return NULL;
+}
+
+static void record_tag(struct rtmp_ingest *ingest, struct connection *conn, const struct tag_info *info,
+		       uint32_t timestamp, size_t size)
+{
+	struct rtmp_ingest_track_stats *track = info->video ? &ingest->stats.video[info->track]
+							    : &ingest->stats.audio[info->track];
+	int64_t *last_dts = &conn->last_dts[info->video][info->track];
+	bool out_of_order = false;
+
+	if (info->frames) {
+		out_of_order = (int64_t)timestamp < *last_dts;
+		*last_dts = timestamp;
+	}
+
+	pthread_mutex_lock(&ingest->mutex);
+
+	if (info->metadata) {
+		ingest->stats.metadata_tags++;
+	} else {
+		track->tags++;
+		track->bytes += size;
+		if (info->header)
+			track->headers++;
+		if (info->keyframe)
+			track->keyframes++;
+	}
+
+	if (out_of_order)
+		ingest->stats.timestamp_errors++;
+
+	if (info->has_marker && ingest->latencies.num < MAX_LATENCY_SAMPLES) {
+		uint64_t now = os_gettime_ns();
+		uint64_t latency = now > info->marker_ts ? now - info->marker_ts : 0;
+		da_push_back(ingest->latencies, &latency);
+	}
+
+	ingest->stats.cpu_ns = thread_cpu_ns();
+	pthread_mutex_unlock(&ingest->mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* messages and chunks                                                       */
+
+static bool handle_message(struct rtmp_ingest *ingest, struct connection *conn, struct chunk_stream *cs)
+{
+	const uint8_t *data = cs->body.array;
+	size_t size = cs->length;
+	struct tag_info info = {0};
+	const char *error = NULL;
+
+	pthread_mutex_lock(&ingest->mutex);
+	ingest->stats.messages++;
+	pthread_mutex_unlock(&ingest->mutex);
+
+	switch (cs->type) {
+	case MSG_SET_CHUNK_SIZE:
+		if (size < 4)
+			return false;
+		conn->chunk_size = rb32(data) & 0x7FFFFFFF;
+		if (!conn->chunk_size || conn->chunk_size > MAX_MESSAGE_SIZE) {
+			record_error(ingest, "invalid chunk size");
+			return false;
+		}
+		return true;
+
+	case MSG_ABORT:
+		if (size < 4)
+			return false;
+		for (size_t i = 0; i < conn->streams.num; i++) {
+			if (conn->streams.array[i].csid == rb32(data))
+				conn->streams.array[i].received = 0;
+		}
+		return true;
+
+	case MSG_COMMAND_AMF0:
+		return handle_command(ingest, conn, data, size);
+
+	case MSG_DATA_AMF0:
+		error = check_metadata(data, size);
+		info.metadata = true;
+		break;
+
+	case MSG_VIDEO:
+		error = check_video(&info, data, size);
+		break;
+
+	case MSG_AUDIO:
+		error = check_audio(&info, data, size);
+		break;
+
+	default:
+		/* acknowledgements and other control messages */
+		return true;
+	}
+
+	if (error)
+		record_error(ingest, error);
+	else
+		record_tag(ingest, conn, &info, cs->timestamp, size);
+	return true;
+}
+
+static struct chunk_stream *get_chunk_stream(struct connection *conn, uint32_t csid)
+{
+	struct chunk_stream *cs;
+
+	for (size_t i = 0; i < conn->streams.num; i++) {
+		if (conn->streams.array[i].csid == csid)
+			return &conn->streams.array[i];
+	}
+
+	cs = da_push_back_new(conn->streams);
+	cs->csid = csid;
+	return cs;
+}
+
+static bool protocol_error(struct rtmp_ingest *ingest, const char *error)
+{
+	record_error(ingest, error);
+	return false;
+}
+
+static bool read_chunk(struct rtmp_ingest *ingest, struct connection *conn)
+{
+	static const size_t header_sizes[] = {11, 7, 3, 0};
+	struct chunk_stream *cs;
+	uint8_t header[11];
+	uint32_t csid, chunk;
+	int fmt;
+
+	if (!conn_read(ingest, conn, header, 1))
+		return false;
+
+	fmt = header[0] >> 6;
+	csid = header[0] & 0x3F;
+
+	if (csid == 0) {
+		if (!conn_read(ingest, conn, header, 1))
+			return false;
+		csid = 64 + header[0];
+	} else if (csid == 1) {
+		if (!conn_read(ingest, conn, header, 2))
+			return false;
+		csid = 64 + header[0] + ((uint32_t)header[1] << 8);
+	}
+
+	cs = get_chunk_stream(conn, csid);
+
+	if (fmt != 0 && !cs->has_header)
+		return protocol_error(ingest, "chunk without a message header");
+	if (fmt != 3 && cs->received)
+		return protocol_error(ingest, "message header in the middle of a message");
+
+	if (!conn_read(ingest, conn, header, header_sizes[fmt]))
+		return false;
+
+	if (fmt < 3) {
+		uint32_t ts = rb24(header);
+
+		cs->extended = ts == 0xFFFFFF;
+		if (cs->extended) {
+			uint8_t ext[4];
+			if (!conn_read(ingest, conn, ext, 4))
+				return false;
+			ts = rb32(ext);
+		}
+
+		if (fmt < 2) {
+			cs->length = rb24(header + 3);
+			cs->type = header[6];
+		}
+
+		if (fmt == 0) {
+			cs->stream_id = rl32(header + 7);
+			cs->timestamp = ts;
+		} else {
+			cs->timestamp += ts;
+		}
+
+		/* a message that only has a basic header repeats the delta,
+		 * after an absolute timestamp that is the timestamp itself */
+		cs->delta = ts;
+		cs->has_header = true;
+	} else {
+		if (cs->extended && !conn_read(ingest, conn, NULL, 4))
+			return false;
+		if (!cs->received)
+			cs->timestamp += cs->delta;
+	}
+
+	if (cs->length > MAX_MESSAGE_SIZE)
+		return protocol_error(ingest, "message too large");
+
+	if (!cs->received)
+		da_resize(cs->body, cs->length);
+
+	chunk = cs->length - cs->received;
+	if (chunk > conn->chunk_size)
+		chunk = conn->chunk_size;
+
+	if (!conn_read(ingest, conn, cs->body.array + cs->received, chunk))
+		return false;
+
+	cs->received += chunk;
+	if (cs->received < cs->length)
+		return true;
+
+	cs->received = 0;
+	return handle_message(ingest, conn, cs);
+}
+
+/* the simple handshake, the server signature echoes the client's */
+static bool handshake(struct rtmp_ingest *ingest, struct connection *conn)
+{
+	uint8_t c0c1[1 + HANDSHAKE_SIZE];
+	uint8_t s0s1s2[1 + HANDSHAKE_SIZE * 2];
+
+	if (!conn_read(ingest, conn, c0c1, sizeof(c0c1)))
+		return false;
+	if (c0c1[0] != 3)
+		return protocol_error(ingest, "unsupported RTMP version");
+
+	s0s1s2[0] = 3;
+	memset(s0s1s2 + 1, 0, 8);
+	for (size_t i = 9; i < 1 + HANDSHAKE_SIZE; i++)
+		s0s1s2[i] = (uint8_t)rand();
+	memcpy(s0s1s2 + 1 + HANDSHAKE_SIZE, c0c1 + 1, HANDSHAKE_SIZE);
+
+	if (!send_all(conn->fd, s0s1s2, sizeof(s0s1s2)))
+		return false;
+
+	return conn_read(ingest, conn, NULL, HANDSHAKE_SIZE);
+}
+
+static void serve(struct rtmp_ingest *ingest, int fd)
+{
+	struct connection conn = {.fd = fd, .chunk_size = DEFAULT_CHUNK_SIZE};
+
+	conn.buf = bmalloc(READ_BUF_SIZE);
+	conn.rate_ts = os_gettime_ns();
+
+	for (size_t i = 0; i < RTMP_INGEST_MAX_TRACKS; i++)
+		conn.last_dts[0][i] = conn.last_dts[1][i] = -1;
+
+	pthread_mutex_lock(&ingest->mutex);
+	ingest->stats.connections++;
+	pthread_mutex_unlock(&ingest->mutex);
+
+	if (handshake(ingest, &conn)) {
+		while (read_chunk(ingest, &conn))
+			;
+	}
+
+	set_publishing(ingest, false);
+
+	for (size_t i = 0; i < conn.streams.num; i++)
+		da_free(conn.streams.array[i].body);
+	da_free(conn.streams);
+	bfree(conn.buf);
+}
+
+static void *ingest_thread(void *data)
+{
+	struct rtmp_ingest *ingest = data;
+
+	os_set_thread_name("rtmp-ingest");
+
+	while (!os_atomic_load_bool(&ingest->stop)) {
+		struct pollfd pfd = {.fd = ingest->listen_fd, .events = POLLIN};
+		int fd;
+
+		if (poll(&pfd, 1, POLL_TIMEOUT_MS) <= 0)
+			continue;
+
+		fd = accept(ingest->listen_fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+
+		serve(ingest, fd);
+		close(fd);
+
+		pthread_mutex_lock(&ingest->mutex);
+		ingest->stats.cpu_ns = thread_cpu_ns();
+		pthread_mutex_unlock(&ingest->mutex);
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct rtmp_ingest *rtmp_ingest_create(const char *address, int port, int read_kbps)
+{
+	struct rtmp_ingest *ingest = bzalloc(sizeof(struct rtmp_ingest));
+	struct sockaddr_in addr = {0};
+	socklen_t len = sizeof(addr);
+	int one = 1;
+
+	pthread_mutex_init(&ingest->mutex, NULL);
+	ingest->listen_fd = -1;
+	ingest->read_kbps = read_kbps;
+
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (address && inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+		goto fail;
+
+	ingest->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (ingest->listen_fd < 0)
+		goto fail;
+
+	setsockopt(ingest->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	/* accepted sockets inherit the receive buffer */
+	if (read_kbps > 0) {
+		int rcvbuf = LIMITED_RCVBUF;
+		setsockopt(ingest->listen_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	}
+
+	if (bind(ingest->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(ingest->listen_fd, 1) != 0 ||
+	    getsockname(ingest->listen_fd, (struct sockaddr *)&addr, &len) != 0)
+		goto fail;
+
+	ingest->port = ntohs(addr.sin_port);
+
+	if (pthread_create(&ingest->thread, NULL, ingest_thread, ingest) != 0)
+		goto fail;
+
+	ingest->thread_created = true;
+	return ingest;
+
+fail:
+	rtmp_ingest_destroy(ingest);
+	return NULL;
+}
+
+void rtmp_ingest_destroy(struct rtmp_ingest *ingest)
+{
+	if (!ingest)
+		return;
+
+	if (ingest->thread_created) {
+		os_atomic_set_bool(&ingest->stop, true);
+		pthread_join(ingest->thread, NULL);
+	}
+
+	if (ingest->listen_fd >= 0)
+		close(ingest->listen_fd);
+
+	da_free(ingest->latencies);
+	pthread_mutex_destroy(&ingest->mutex);
+	bfree(ingest);
+}
+
+int rtmp_ingest_get_port(struct rtmp_ingest *ingest)
+{
+	return ingest->port;
+}
+
+static int cmp_uint64(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t *)a;
+	uint64_t val_b = *(const uint64_t *)b;
+
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+void rtmp_ingest_get_stats(struct rtmp_ingest *ingest, struct rtmp_ingest_stats *stats)
+{
+	DARRAY(uint64_t) latencies;
+
+	da_init(latencies);
+
+	pthread_mutex_lock(&ingest->mutex);
+	*stats = ingest->stats;
+	da_copy(latencies, ingest->latencies);
+	pthread_mutex_unlock(&ingest->mutex);
+
+	stats->latency_samples = latencies.num;
+
+	if (latencies.num) {
+		qsort(latencies.array, latencies.num, sizeof(uint64_t), cmp_uint64);
+		stats->latency_p50_ns = latencies.array[latencies.num / 2];
+		stats->latency_p95_ns = latencies.array[latencies.num * 95 / 100];
+		stats->latency_max_ns = latencies.array[latencies.num - 1];
+	}
+
+	da_free(latencies);
+}
+
+void rtmp_ingest_reset_latency(struct rtmp_ingest *ingest)
+{
+	pthread_mutex_lock(&ingest->mutex);
+	da_resize(ingest->latencies, 0);
+	pthread_mutex_unlock(&ingest->mutex);
+}
+
+void rtmp_ingest_write_marker(uint8_t *dst, uint64_t ts)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	memcpy(dst, RTMP_INGEST_MARKER, RTMP_INGEST_MARKER_LEN);
+	dst += RTMP_INGEST_MARKER_LEN;
+
+	for (int i = 15; i >= 0; i--) {
+		dst[i] = (uint8_t)hex[ts & 0xF];
+		ts >>= 4;
+	}
+}
+
+static void print_tracks(FILE *file, const char *type, const struct rtmp_ingest_track_stats *tracks)
+{
+	for (size_t i = 0; i < RTMP_INGEST_MAX_TRACKS; i++) {
+		const struct rtmp_ingest_track_stats *track = &tracks[i];
+
+		if (!track->tags)
+			continue;
+
+		fprintf(file, "  %s %zu: %llu tags, %.2f MB, %llu headers, %llu keyframes\n", type, i,
+			(unsigned long long)track->tags, (double)track->bytes / 1000000.0,
+			(unsigned long long)track->headers, (unsigned long long)track->keyframes);
+	}
+}
+
+void rtmp_ingest_print_stats(FILE *file, const struct rtmp_ingest_stats *stats)
+{
+	fprintf(file, "ingest: %llu connections, %.2f MB received, %llu messages, %llu metadata tags\n",
+		(unsigned long long)stats->connections, (double)stats->bytes_received / 1000000.0,
+		(unsigned long long)stats->messages, (unsigned long long)stats->metadata_tags);
+
+	print_tracks(file, "video", stats->video);
+	print_tracks(file, "audio", stats->audio);
+
+	if (stats->latency_samples)
+		fprintf(file, "  latency: %.2f ms p50, %.2f ms p95, %.2f ms max (%llu frames)\n",
+			(double)stats->latency_p50_ns / 1000000.0, (double)stats->latency_p95_ns / 1000000.0,
+			(double)stats->latency_max_ns / 1000000.0, (unsigned long long)stats->latency_samples);
+
+	fprintf(file, "  invalid tags: %llu, timestamps out of order: %llu\n", (unsigned long long)stats->invalid_tags,
+		(unsigned long long)stats->timestamp_errors);
+	if (stats->first_error[0])
+		fprintf(file, "  first error: %s\n", stats->first_error);
+}
@@ -0,0 +1,70 @@
+/*
+ * Minimal RTMP ingest server for benchmarks.
+ *
+ * Accepts one publisher at a time: handshake, connect, createStream and
+ * publish are answered like an ingest server would, chunks are reassembled
+ * into messages, and audio/video messages are checked as FLV tag bodies
+ * (legacy AVC/AAC, and enhanced RTMP with multitrack).  Nothing is stored.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define RTMP_INGEST_MAX_TRACKS 8
+
+/* frame payloads that contain the marker followed by 16 hex digits of an
+ * os_gettime_ns() timestamp are used to measure the end to end latency.
+ * hex digits can't form an Annex B start code, so the marker survives
+ * parsing in the output. */
+#define RTMP_INGEST_MARKER "OBSTS"
+#define RTMP_INGEST_MARKER_LEN 5
+#define RTMP_INGEST_MARKER_SIZE (RTMP_INGEST_MARKER_LEN + 16)
+
+struct rtmp_ingest;
+
+struct rtmp_ingest_track_stats {
+	uint64_t tags;
+	uint64_t bytes;
+	uint64_t headers;
+	uint64_t keyframes;
+};
+
+struct rtmp_ingest_stats {
+	uint64_t connections;
+	bool publishing;
+
+	uint64_t bytes_received;
+	uint64_t messages;
+	uint64_t metadata_tags;
+	uint64_t invalid_tags;
+	uint64_t timestamp_errors;
+	char first_error[128];
+
+	struct rtmp_ingest_track_stats video[RTMP_INGEST_MAX_TRACKS];
+	struct rtmp_ingest_track_stats audio[RTMP_INGEST_MAX_TRACKS];
+
+	uint64_t latency_samples;
+	uint64_t latency_p50_ns;
+	uint64_t latency_p95_ns;
+	uint64_t latency_max_ns;
+
+	/* time spent on the server thread */
+	uint64_t cpu_ns;
+};
+
+/* address is an IPv4 address to listen on, NULL for loopback, and port 0
+ * picks a free port.  read_kbps limits how fast the server reads from the
+ * socket, like an uplink of that capacity, 0 reads as fast as possible. */
+extern struct rtmp_ingest *rtmp_ingest_create(const char *address, int port, int read_kbps);
+extern void rtmp_ingest_destroy(struct rtmp_ingest *ingest);
+
+extern int rtmp_ingest_get_port(struct rtmp_ingest *ingest);
+
+extern void rtmp_ingest_get_stats(struct rtmp_ingest *ingest, struct rtmp_ingest_stats *stats);
+extern void rtmp_ingest_reset_latency(struct rtmp_ingest *ingest);
+
+extern void rtmp_ingest_write_marker(uint8_t *dst, uint64_t ts);
+extern void rtmp_ingest_print_stats(FILE *file, const struct rtmp_ingest_stats *stats);
@@ -0,0 +1,461 @@
+/*
+ * End to end benchmark of the RTMP output.
+ *
+ * Synthetic encoders feed packets through rtmp_output and librtmp to an
+ * in-process ingest server.  The video encoders produce H.264 frames of the
+ * requested bitrate with a keyframe every two seconds, the audio encoders
+ * AAC sized frames.  Every video frame carries the time it was encoded, so
+ * the server measures the latency from the encoder to the point where the
+ * whole frame was received.  The server can read slower than the stream
+ * bitrate, like a limited uplink, to exercise frame dropping.
+ *
+ * The CPU usage is that of the whole process without the server thread, the
+ * canvas is kept small so the rest of the frame pipeline adds little to it.
+ *
+ * Video runs on the null graphics backend, so no display or GPU is needed.
+ * Set OBS_GRAPHICS_MODULE to use another backend.  Needs the obs-outputs and
+ * rtmp-services modules, which are loaded from the default locations, set
+ * OBS_PLUGINS_PATH and OBS_PLUGINS_DATA_PATH to use a build directory.
+ *
+ * usage: rtmp-output-bench [seconds] [video kbps] [video tracks] [audio tracks]
+ *                          [server read kbps] [legacy|new|lowlatency]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+
+#include "rtmp-ingest.h"
+
+#define CANVAS_WIDTH 320
+#define CANVAS_HEIGHT 180
+#define FPS 60
+#define KEYFRAME_SEC 2
+#define AUDIO_KBPS 160
+#define SAMPLE_RATE 48000
+#define AAC_FRAME_SIZE 1024
+
+#define MAX_VIDEO_TRACKS 6
+#define MAX_AUDIO_TRACKS 6
+
+#define CONNECT_TIMEOUT_SEC 10
+#define STOP_TIMEOUT_SEC 10
+#define WARMUP_SEC 2
+
+/* the header and NAL unit type come first, followed by the marker */
+#define VIDEO_PREFIX_SIZE 5
+#define MIN_VIDEO_FRAME_SIZE (VIDEO_PREFIX_SIZE + RTMP_INGEST_MARKER_SIZE)
+
+static const uint8_t h264_extra_data[] = {
+	0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xC0, 0x1F, 0x8C, 0x8D, 0x40, 0x50, 0x1E, 0xD0,
+	0x0F, 0x08, 0x84, 0x6A, 0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+};
+
+/* AAC LC, 48 kHz, stereo */
+static const uint8_t aac_extra_data[] = {0x11, 0x90};
+
+struct bench_encoder {
+	obs_encoder_t *encoder;
+	bool video;
+	size_t frame_size;
+	uint64_t keyint;
+	uint64_t frames;
+	DARRAY(uint8_t) data;
+};
+
+static const char *bench_video_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Benchmark H.264";
+}
+
+static const char *bench_audio_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Benchmark AAC";
+}
+
+static void *bench_video_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct bench_encoder *enc = bzalloc(sizeof(struct bench_encoder));
+	uint64_t bytes_per_sec = (uint64_t)obs_data_get_int(settings, "bitrate") * 1000 / 8;
+
+	enc->encoder = encoder;
+	enc->video = true;
+	enc->frame_size = (size_t)(bytes_per_sec / FPS);
+	enc->keyint = FPS * KEYFRAME_SEC;
+
+	if (enc->frame_size < MIN_VIDEO_FRAME_SIZE)
+		enc->frame_size = MIN_VIDEO_FRAME_SIZE;
+	return enc;
+}
+
+static void *bench_audio_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct bench_encoder *enc = bzalloc(sizeof(struct bench_encoder));
+	uint64_t bytes_per_sec = (uint64_t)obs_data_get_int(settings, "bitrate") * 1000 / 8;
+
+	enc->encoder = encoder;
+	enc->frame_size = (size_t)(bytes_per_sec * AAC_FRAME_SIZE / SAMPLE_RATE);
+	return enc;
+}
+
+static void bench_destroy(void *data)
+{
+	struct bench_encoder *enc = data;
+
+	da_free(enc->data);
+	bfree(enc);
+}
+
+/* keyframes are four times the size of the other frames, the average stays
+ * at the bitrate */
+static bool bench_video_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet,
+			       bool *received_packet)
+{
+	struct bench_encoder *enc = data;
+	bool keyframe = enc->frames++ % enc->keyint == 0;
+	size_t size = keyframe ? enc->frame_size * 4 : enc->frame_size * (enc->keyint - 4) / (enc->keyint - 1);
+
+	if (size < MIN_VIDEO_FRAME_SIZE)
+		size = MIN_VIDEO_FRAME_SIZE;
+
+	da_resize(enc->data, size);
+
+	/* the filler can't contain a start code */
+	memset(enc->data.array, 0xAA, size);
+	memcpy(enc->data.array, "\0\0\0\x01", 4);
+	enc->data.array[4] = keyframe ? 0x65 : 0x41;
+	rtmp_ingest_write_marker(enc->data.array + VIDEO_PREFIX_SIZE, os_gettime_ns());
+
+	packet->type = OBS_ENCODER_VIDEO;
+	packet->data = enc->data.array;
+	packet->size = size;
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->keyframe = keyframe;
+	*received_packet = true;
+	return true;
+}
+
+static bool bench_audio_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet,
+			       bool *received_packet)
+{
+	struct bench_encoder *enc = data;
+
+	da_resize(enc->data, enc->frame_size);
+	memset(enc->data.array, 0x21, enc->frame_size);
+
+	packet->type = OBS_ENCODER_AUDIO;
+	packet->data = enc->data.array;
+	packet->size = enc->frame_size;
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	*received_packet = true;
+	return true;
+}
+
+static size_t bench_audio_frame_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return AAC_FRAME_SIZE;
+}
+
+static bool bench_extra_data(void *data, uint8_t **extra_data, size_t *size)
+{
+	struct bench_encoder *enc = data;
+
+	*extra_data = enc->video ? (uint8_t *)h264_extra_data : (uint8_t *)aac_extra_data;
+	*size = enc->video ? sizeof(h264_extra_data) : sizeof(aac_extra_data);
+	return true;
+}
+
+static struct obs_encoder_info bench_video_encoder = {
+	.id = "bench_h264",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.get_name = bench_video_name,
+	.create = bench_video_create,
+	.destroy = bench_destroy,
+	.encode = bench_video_encode,
+	.get_extra_data = bench_extra_data,
+};
+
+static struct obs_encoder_info bench_audio_encoder = {
+	.id = "bench_aac",
+	.type = OBS_ENCODER_AUDIO,
+	.codec = "aac",
+	.get_name = bench_audio_name,
+	.create = bench_audio_create,
+	.destroy = bench_destroy,
+	.encode = bench_audio_encode,
+	.get_frame_size = bench_audio_frame_size,
+	.get_extra_data = bench_extra_data,
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct sample {
+	uint64_t ts;
+	uint64_t cpu_ns;
+	uint64_t bytes_sent;
+	int frames;
+	int dropped;
+	struct rtmp_ingest_stats ingest;
+};
+
+static uint64_t process_cpu_ns(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ULL +
+	       ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+static void take_sample(struct sample *sample, obs_output_t *output, struct rtmp_ingest *ingest)
+{
+	sample->ts = os_gettime_ns();
+	sample->cpu_ns = process_cpu_ns();
+	sample->bytes_sent = obs_output_get_total_bytes(output);
+	sample->frames = obs_output_get_total_frames(output);
+	sample->dropped = obs_output_get_frames_dropped(output);
+	rtmp_ingest_get_stats(ingest, &sample->ingest);
+}
+
+static bool init_obs(void)
+{
+	struct obs_audio_info oai = {.samples_per_sec = SAMPLE_RATE, .speakers = SPEAKERS_STEREO};
+	const char *graphics_module = getenv("OBS_GRAPHICS_MODULE");
+	struct obs_video_info ovi = {
+		.graphics_module = graphics_module ? graphics_module : NULL_GRAPHICS_MODULE,
+		.fps_num = FPS,
+		.fps_den = 1,
+		.base_width = CANVAS_WIDTH,
+		.base_height = CANVAS_HEIGHT,
+		.output_width = CANVAS_WIDTH,
+		.output_height = CANVAS_HEIGHT,
+		.output_format = VIDEO_FORMAT_NV12,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.gpu_conversion = true,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+	const char *plugins_path = getenv("OBS_PLUGINS_PATH");
+	const char *plugins_data_path = getenv("OBS_PLUGINS_DATA_PATH");
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	PRAGMA_WARN_PUSH
+	PRAGMA_DISABLE_DEPRECATION
+	obs_add_data_path(LIBOBS_DATA_PATH);
+	PRAGMA_WARN_POP
+
+	if (!obs_reset_audio(&oai)) {
+		fprintf(stderr, "failed to initialize audio\n");
+		return false;
+	}
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "failed to initialize video with '%s'\n", ovi.graphics_module);
+		return false;
+	}
+
+	if (plugins_path && plugins_data_path)
+		obs_add_module_path(plugins_path, plugins_data_path);
+
+	/* nothing else is needed */
+	obs_add_safe_module("obs-outputs");
+	obs_add_safe_module("rtmp-services");
+	obs_load_all_modules();
+	obs_post_load_modules();
+
+	obs_register_encoder(&bench_video_encoder);
+	obs_register_encoder(&bench_audio_encoder);
+	return true;
+}
+
+static obs_output_t *create_output(int port, const char *socket_loop)
+{
+	obs_data_t *settings = obs_data_create();
+	char server[64];
+	obs_service_t *service;
+	obs_output_t *output;
+
+	snprintf(server, sizeof(server), "rtmp://127.0.0.1:%d/live", port);
+	obs_data_set_string(settings, "server", server);
+	obs_data_set_string(settings, "key", "bench");
+	service = obs_service_create("rtmp_custom", "bench service", settings, NULL);
+	obs_data_release(settings);
+
+	settings = obs_data_create();
+	obs_data_set_bool(settings, "new_socket_loop_enabled", strcmp(socket_loop, "legacy") != 0);
+	obs_data_set_bool(settings, "low_latency_mode_enabled", strcmp(socket_loop, "lowlatency") == 0);
+	output = obs_output_create("rtmp_output", "bench output", settings, NULL);
+	obs_data_release(settings);
+
+	if (service && output)
+		obs_output_set_service(output, service);
+
+	obs_service_release(service);
+	return output;
+}
+
+static void print_report(const struct sample *start, const struct sample *end, int video_kbps, int video_tracks,
+			 int audio_tracks)
+{
+	double sec = (double)(end->ts - start->ts) / 1000000000.0;
+	double received_mbps = (double)(end->ingest.bytes_received - start->ingest.bytes_received) * 8.0 / sec / 1e6;
+	double sent_mbps = (double)(end->bytes_sent - start->bytes_sent) * 8.0 / sec / 1e6;
+	double target_mbps = (video_kbps * video_tracks + AUDIO_KBPS * audio_tracks) / 1000.0;
+	uint64_t server_cpu_ns = end->ingest.cpu_ns - start->ingest.cpu_ns;
+	uint64_t cpu_ns = end->cpu_ns - start->cpu_ns;
+	double cpu_percent;
+
+	cpu_ns = cpu_ns > server_cpu_ns ? cpu_ns - server_cpu_ns : 0;
+	cpu_percent = (double)cpu_ns / 1e7 / sec;
+
+	printf("%-22s %10.2f\n", "target Mbps", target_mbps);
+	printf("%-22s %10.2f\n", "sent Mbps", sent_mbps);
+	printf("%-22s %10.2f\n", "received Mbps", received_mbps);
+	printf("%-22s %10.2f\n", "latency p50 ms", (double)end->ingest.latency_p50_ns / 1e6);
+	printf("%-22s %10.2f\n", "latency p95 ms", (double)end->ingest.latency_p95_ns / 1e6);
+	printf("%-22s %10.2f\n", "latency max ms", (double)end->ingest.latency_max_ns / 1e6);
+	printf("%-22s %10.2f\n", "CPU %", cpu_percent);
+	printf("%-22s %10.3f\n", "CPU % per Mbps", received_mbps > 0.0 ? cpu_percent / received_mbps : 0.0);
+	printf("%-22s %10.2f\n", "server CPU %", (double)server_cpu_ns / 1e7 / sec);
+	printf("%-22s %10d\n", "frames", end->frames - start->frames);
+	printf("%-22s %10d\n", "dropped frames", end->dropped - start->dropped);
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 20;
+	int video_kbps = argc > 2 ? atoi(argv[2]) : 6000;
+	int video_tracks = argc > 3 ? atoi(argv[3]) : 1;
+	int audio_tracks = argc > 4 ? atoi(argv[4]) : 1;
+	int read_kbps = argc > 5 ? atoi(argv[5]) : 0;
+	const char *socket_loop = argc > 6 ? argv[6] : "legacy";
+	obs_encoder_t *video[MAX_VIDEO_TRACKS] = {0};
+	obs_encoder_t *audio[MAX_AUDIO_TRACKS] = {0};
+	struct rtmp_ingest *ingest = NULL;
+	obs_output_t *output = NULL;
+	struct sample start, end;
+	uint64_t timeout;
+	int ret = 1;
+
+	if (seconds <= 0 || video_kbps <= 0 || video_tracks < 1 || video_tracks > MAX_VIDEO_TRACKS ||
+	    audio_tracks < 0 || audio_tracks > MAX_AUDIO_TRACKS || read_kbps < 0 ||
+	    (strcmp(socket_loop, "legacy") != 0 && strcmp(socket_loop, "new") != 0 &&
+	     strcmp(socket_loop, "lowlatency") != 0)) {
+		fprintf(stderr,
+			"usage: %s [seconds] [video kbps] [video tracks] [audio tracks] [server read kbps] "
+			"[legacy|new|lowlatency]\n",
+			argv[0]);
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	ingest = rtmp_ingest_create(NULL, 0, read_kbps);
+	if (!ingest) {
+		fprintf(stderr, "failed to start the ingest server\n");
+		return 1;
+	}
+
+	if (!init_obs())
+		goto fail;
+
+	output = create_output(rtmp_ingest_get_port(ingest), socket_loop);
+	if (!output) {
+		fprintf(stderr, "failed to create the RTMP output, is obs-outputs loaded?\n");
+		goto fail;
+	}
+
+	for (int i = 0; i < video_tracks; i++) {
+		obs_data_t *settings = obs_data_create();
+		char name[32];
+
+		snprintf(name, sizeof(name), "bench video %d", i);
+		obs_data_set_int(settings, "bitrate", video_kbps);
+		video[i] = obs_video_encoder_create("bench_h264", name, settings, NULL);
+		obs_data_release(settings);
+
+		obs_encoder_set_video(video[i], obs_get_video());
+		obs_output_set_video_encoder2(output, video[i], i);
+	}
+
+	for (int i = 0; i < audio_tracks; i++) {
+		obs_data_t *settings = obs_data_create();
+		char name[32];
+
+		snprintf(name, sizeof(name), "bench audio %d", i);
+		obs_data_set_int(settings, "bitrate", AUDIO_KBPS);
+		audio[i] = obs_audio_encoder_create("bench_aac", name, settings, i, NULL);
+		obs_data_release(settings);
+
+		obs_encoder_set_audio(audio[i], obs_get_audio());
+		obs_output_set_audio_encoder(output, audio[i], i);
+	}
+
+	printf("%d x %d kbps video, %d audio tracks, server reads %s kbps, %s socket loop\n", video_tracks,
+	       video_kbps, audio_tracks, read_kbps ? argv[5] : "unlimited", socket_loop);
+
+	if (!obs_output_start(output)) {
+		fprintf(stderr, "failed to start the output: %s\n", obs_output_get_last_error(output));
+		goto fail;
+	}
+
+	timeout = os_gettime_ns() + CONNECT_TIMEOUT_SEC * 1000000000ULL;
+	do {
+		os_sleep_ms(10);
+		rtmp_ingest_get_stats(ingest, &start.ingest);
+	} while (!start.ingest.publishing && os_gettime_ns() < timeout);
+
+	if (!start.ingest.publishing) {
+		fprintf(stderr, "the output did not start publishing\n");
+		goto stop;
+	}
+
+	os_sleep_ms(WARMUP_SEC * 1000);
+	rtmp_ingest_reset_latency(ingest);
+	take_sample(&start, output, ingest);
+
+	os_sleep_ms((uint32_t)seconds * 1000);
+	take_sample(&end, output, ingest);
+
+	print_report(&start, &end, video_kbps, video_tracks, audio_tracks);
+	ret = 0;
+
+stop:
+	obs_output_stop(output);
+
+	timeout = os_gettime_ns() + STOP_TIMEOUT_SEC * 1000000000ULL;
+	while (obs_output_active(output) && os_gettime_ns() < timeout)
+		os_sleep_ms(10);
+
+fail:
+	obs_output_release(output);
+	for (int i = 0; i < MAX_VIDEO_TRACKS; i++)
+		obs_encoder_release(video[i]);
+	for (int i = 0; i < MAX_AUDIO_TRACKS; i++)
+		obs_encoder_release(audio[i]);
+	obs_shutdown();
+
+	if (ingest) {
+		rtmp_ingest_get_stats(ingest, &end.ingest);
+		rtmp_ingest_print_stats(stdout, &end.ingest);
+		if (end.ingest.invalid_tags)
+			ret = 1;
+		rtmp_ingest_destroy(ingest);
+	}
+
+	return ret;
+}
@@ -0,0 +1,242 @@
+/*
+ * Benchmark for video_scaler, comparing swscale with the native paths in
+ * libobs/media-io/video-scaler-fast.c.
+ *
+ * Every conversion is run through swscale and, where it has one, the native
+ * path for each supported instruction set, both on one thread and split over
+ * the given number of threads.  Reported are the time per frame, the speedup
+ * over single threaded swscale, and how far the output is from swscale's
+ * (largest and mean absolute difference of all samples).
+ *
+ * usage: video-scaler-bench [seconds per test] [threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <media-io/format-conversion.h>
+#include <media-io/video-frame.h>
+#include <media-io/video-scaler.h>
+
+struct conversion {
+	const char *name;
+	enum video_format src_format;
+	uint32_t src_width;
+	uint32_t src_height;
+	enum video_format dst_format;
+	uint32_t dst_width;
+	uint32_t dst_height;
+};
+
+static const struct conversion conversions[] = {
+	{"nv12 2160p -> 1080p", VIDEO_FORMAT_NV12, 3840, 2160, VIDEO_FORMAT_NV12, 1920, 1080},
+	{"i420 2160p -> 1080p", VIDEO_FORMAT_I420, 3840, 2160, VIDEO_FORMAT_I420, 1920, 1080},
+	{"nv12 1080p -> 540p", VIDEO_FORMAT_NV12, 1920, 1080, VIDEO_FORMAT_NV12, 960, 540},
+	{"bgra 1080p -> nv12", VIDEO_FORMAT_BGRA, 1920, 1080, VIDEO_FORMAT_NV12, 1920, 1080},
+	{"bgra 2160p -> nv12", VIDEO_FORMAT_BGRA, 3840, 2160, VIDEO_FORMAT_NV12, 3840, 2160},
+	{"rgba 1080p -> i420", VIDEO_FORMAT_RGBA, 1920, 1080, VIDEO_FORMAT_I420, 1920, 1080},
+	/* no native path, only swscale threading applies */
+	{"nv12 1080p -> 720p", VIDEO_FORMAT_NV12, 1920, 1080, VIDEO_FORMAT_NV12, 1280, 720},
+};
+
+#define NUM_CONVERSIONS (sizeof(conversions) / sizeof(conversions[0]))
+
+static const char *simd_names[] = {"sse2", "avx2", "neon"};
+
+static bool is_rgb(enum video_format format)
+{
+	return format == VIDEO_FORMAT_BGRA || format == VIDEO_FORMAT_RGBA;
+}
+
+static uint32_t plane_rows(enum video_format format, size_t plane, uint32_t height)
+{
+	return plane == 0 || !format_is_yuv(format) ? height : (height + 1) / 2;
+}
+
+static size_t plane_width(enum video_format format, size_t plane, uint32_t width)
+{
+	switch (format) {
+	case VIDEO_FORMAT_NV12:
+		return plane == 0 ? width : (width + 1) / 2 * 2;
+	case VIDEO_FORMAT_I420:
+		return plane == 0 ? width : (width + 1) / 2;
+	default:
+		return (size_t)width * 4;
+	}
+}
+
+/* something smoother than noise, so filters behave like on real video */
+static void fill_frame(struct video_frame *frame, enum video_format format, uint32_t width, uint32_t height)
+{
+	for (size_t plane = 0; plane < MAX_AV_PLANES && frame->data[plane]; plane++) {
+		uint32_t rows = plane_rows(format, plane, height);
+		size_t row_bytes = plane_width(format, plane, width);
+
+		for (uint32_t y = 0; y < rows; y++) {
+			uint8_t *line = frame->data[plane] + (size_t)y * frame->linesize[plane];
+			for (size_t x = 0; x < row_bytes; x++)
+				line[x] = (uint8_t)((x * 3 + y * 2 + plane * 50) ^ (rand() & 7));
+		}
+	}
+}
+
+static void compare(const struct video_frame *a, const struct video_frame *b, const struct conversion *conv,
+		    int *max_diff, double *mean_diff)
+{
+	uint64_t total = 0;
+	uint64_t count = 0;
+
+	*max_diff = 0;
+
+	for (size_t plane = 0; plane < MAX_AV_PLANES && a->data[plane]; plane++) {
+		uint32_t rows = plane_rows(conv->dst_format, plane, conv->dst_height);
+		size_t row_bytes = plane_width(conv->dst_format, plane, conv->dst_width);
+
+		for (uint32_t y = 0; y < rows; y++) {
+			const uint8_t *la = a->data[plane] + (size_t)y * a->linesize[plane];
+			const uint8_t *lb = b->data[plane] + (size_t)y * b->linesize[plane];
+
+			for (size_t x = 0; x < row_bytes; x++) {
+				int diff = abs((int)la[x] - (int)lb[x]);
+				if (diff > *max_diff)
+					*max_diff = diff;
+				total += (uint64_t)diff;
+				count++;
+			}
+		}
+	}
+
+	*mean_diff = count ? (double)total / (double)count : 0.0;
+}
+
+static video_scaler_t *create(const struct conversion *conv, uint32_t threads, uint32_t flags)
+{
+	struct video_scale_info src = {conv->src_format, conv->src_width, conv->src_height,
+				       is_rgb(conv->src_format) ? VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL,
+				       VIDEO_CS_709};
+	struct video_scale_info dst = {conv->dst_format, conv->dst_width, conv->dst_height, VIDEO_RANGE_PARTIAL,
+				       VIDEO_CS_709};
+	video_scaler_t *scaler = NULL;
+
+	if (video_scaler_create2(&scaler, &dst, &src, VIDEO_SCALE_FAST_BILINEAR, threads, flags) !=
+	    VIDEO_SCALER_SUCCESS)
+		return NULL;
+	return scaler;
+}
+
+/* returns the time per frame in ms */
+static double run(video_scaler_t *scaler, double seconds, const struct video_frame *in, struct video_frame *out)
+{
+	uint64_t limit = (uint64_t)(seconds * 1000000000.0);
+	uint64_t start, elapsed;
+	size_t frames = 0;
+
+	start = os_gettime_ns();
+	do {
+		video_scaler_scale(scaler, out->data, out->linesize, (const uint8_t *const *)in->data, in->linesize);
+		frames++;
+		elapsed = os_gettime_ns() - start;
+	} while (elapsed < limit);
+
+	return (double)elapsed / (double)frames / 1000000.0;
+}
+
+static void bench(const struct conversion *conv, uint32_t threads, double seconds, const struct video_frame *in,
+		  struct video_frame *out, const struct video_frame *ref, double base_ms)
+{
+	enum format_conversion_simd prev = format_conversion_get_simd();
+
+	for (int s = FORMAT_CONVERSION_SIMD_SSE2; s <= FORMAT_CONVERSION_SIMD_NEON; s++) {
+		video_scaler_t *scaler;
+		double mean_diff, ms;
+		int max_diff;
+
+		if (!format_conversion_set_simd(s))
+			continue;
+
+		scaler = create(conv, threads, VIDEO_SCALER_FAST_PATH);
+		if (!scaler || !video_scaler_uses_fast_path(scaler)) {
+			video_scaler_destroy(scaler);
+			break;
+		}
+
+		video_scaler_scale(scaler, out->data, out->linesize, (const uint8_t *const *)in->data, in->linesize);
+		compare(out, ref, conv, &max_diff, &mean_diff);
+
+		ms = run(scaler, seconds, in, out);
+		printf("%-20s %-8s %7u %9.3f %8.2fx %8d %9.3f\n", conv->name, simd_names[s], threads, ms, base_ms / ms,
+		       max_diff, mean_diff);
+
+		video_scaler_destroy(scaler);
+	}
+
+	format_conversion_set_simd(prev);
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+	int threads = argc > 2 ? atoi(argv[2]) : os_get_logical_cores();
+
+	if (seconds <= 0.0)
+		seconds = 0.5;
+	if (threads < 1)
+		threads = 1;
+
+	printf("%-20s %-8s %7s %9s %9s %8s %9s\n", "conversion", "path", "threads", "ms/frame", "speedup", "max diff",
+	       "mean diff");
+
+	for (size_t i = 0; i < NUM_CONVERSIONS; i++) {
+		const struct conversion *conv = &conversions[i];
+		struct video_frame in, out, ref;
+		video_scaler_t *sws;
+		double base_ms;
+
+		video_frame_init(&in, conv->src_format, conv->src_width, conv->src_height);
+		video_frame_init(&out, conv->dst_format, conv->dst_width, conv->dst_height);
+		video_frame_init(&ref, conv->dst_format, conv->dst_width, conv->dst_height);
+		fill_frame(&in, conv->src_format, conv->src_width, conv->src_height);
+
+		/* single threaded swscale is the baseline and the reference */
+		sws = create(conv, 1, 0);
+		if (!sws) {
+			printf("%-20s could not create scaler\n", conv->name);
+			goto next;
+		}
+
+		video_scaler_scale(sws, ref.data, ref.linesize, (const uint8_t *const *)in.data, in.linesize);
+		base_ms = run(sws, seconds, &in, &out);
+		printf("%-20s %-8s %7d %9.3f %8.2fx %8s %9s\n", conv->name, "swscale", 1, base_ms, 1.0, "-", "-");
+		video_scaler_destroy(sws);
+
+		if (threads > 1) {
+			int max_diff;
+			double mean_diff, ms;
+
+			sws = create(conv, (uint32_t)threads, 0);
+			if (sws) {
+				video_scaler_scale(sws, out.data, out.linesize, (const uint8_t *const *)in.data,
+						   in.linesize);
+				compare(&out, &ref, conv, &max_diff, &mean_diff);
+
+				ms = run(sws, seconds, &in, &out);
+				printf("%-20s %-8s %7d %9.3f %8.2fx %8d %9.3f\n", conv->name, "swscale", threads, ms,
+				       base_ms / ms, max_diff, mean_diff);
+				video_scaler_destroy(sws);
+			}
+		}
+
+		bench(conv, 1, seconds, &in, &out, &ref, base_ms);
+		if (threads > 1)
+			bench(conv, (uint32_t)threads, seconds, &in, &out, &ref, base_ms);
+
+	next:
+		video_frame_free(&in);
+		video_frame_free(&out);
+		video_frame_free(&ref);
+	}
+
+	return 0;
+}
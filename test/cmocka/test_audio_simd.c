@@ -0,0 +1,264 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <media-io/audio-simd.h>
+
+/*
+ * Every kernel is compared bit for bit against the scalar loops that libobs
+ * used before (apart from NaN payloads), for each instruction set the CPU supports, with lengths and
+ * offsets that exercise both the vector loops and the scalar tails.
+ */
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define MAX_SAMPLES 1100
+#define MAX_CHANNELS 8
+
+static const size_t lengths[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 480, 1023, 1024};
+
+#define NUM_LENGTHS (sizeof(lengths) / sizeof(lengths[0]))
+
+static float random_sample(void)
+{
+	switch (rand() % 64) {
+	case 0:
+		return NAN;
+	case 1:
+		return INFINITY;
+	case 2:
+		return -INFINITY;
+	case 3:
+		return -0.0f;
+	case 4:
+		return 1.0f;
+	case 5:
+		return -1.0f;
+	default:
+		/* mostly in range, some clipping */
+		return ((float)rand() / (float)RAND_MAX - 0.5f) * 2.5f;
+	}
+}
+
+static void fill(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = random_sample();
+}
+
+/* ------------------------------------------------------------------------- */
+/* the scalar loops of mix_audio(), process_audio_balancing(),               */
+/* downmix_to_mono_planar() and clamp_audio_output()                         */
+
+static void ref_mix_add(float *mix, const float *aud, size_t count)
+{
+	const float *end = aud + count;
+
+	while (aud < end)
+		*(mix++) += *(aud++);
+}
+
+static void ref_balance_sine_law(float **data, size_t frames, float balance)
+{
+	for (size_t frame = 0; frame < frames; frame++) {
+		data[0][frame] = data[0][frame] * sinf((1.0f - balance) * (M_PI / 2.0f));
+		data[1][frame] = data[1][frame] * sinf(balance * (M_PI / 2.0f));
+	}
+}
+
+static void ref_downmix(float **data, size_t channels, size_t frames)
+{
+	const float channels_i = 1.0f / (float)channels;
+
+	for (size_t channel = 1; channel < channels; channel++) {
+		for (size_t frame = 0; frame < frames; frame++)
+			data[0][frame] += data[channel][frame];
+	}
+
+	for (size_t frame = 0; frame < frames; frame++)
+		data[0][frame] *= channels_i;
+
+	for (size_t channel = 1; channel < channels; channel++) {
+		for (size_t frame = 0; frame < frames; frame++)
+			data[channel][frame] = data[0][frame];
+	}
+}
+
+static void ref_clamp(float *mix_data, float *unclamped, size_t count)
+{
+	float *mix_end = &mix_data[count];
+
+	memcpy(unclamped, mix_data, count * sizeof(float));
+
+	while (mix_data < mix_end) {
+		float val = *mix_data;
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		*(mix_data++) = val;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct buffers {
+	float in[MAX_CHANNELS][MAX_SAMPLES];
+	float out[MAX_CHANNELS][MAX_SAMPLES];
+	float ref[MAX_CHANNELS][MAX_SAMPLES];
+};
+
+static void reset(struct buffers *b)
+{
+	for (size_t ch = 0; ch < MAX_CHANNELS; ch++) {
+		fill(b->in[ch], MAX_SAMPLES);
+		fill(b->out[ch], MAX_SAMPLES);
+		memcpy(b->ref[ch], b->out[ch], sizeof(b->out[ch]));
+	}
+}
+
+/* bit exact, except that which NaN an operation with two different NaN
+ * operands returns depends on the operand order the compiler picked */
+static void assert_samples_match(const float *a, const float *b, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (isnan(a[i]) && isnan(b[i]))
+			continue;
+
+		assert_int_equal(memcmp(&a[i], &b[i], sizeof(float)), 0);
+	}
+}
+
+static void assert_match(struct buffers *b, size_t channels)
+{
+	for (size_t ch = 0; ch < channels; ch++)
+		assert_samples_match(b->out[ch], b->ref[ch], MAX_SAMPLES);
+}
+
+/* runs test for every supported instruction set, length and a few offsets
+ * into the buffers */
+static void for_each_variant(void (*test)(struct buffers *b, size_t offset, size_t count))
+{
+	struct buffers *b = bmalloc(sizeof(struct buffers));
+	enum audio_simd prev = audio_get_simd();
+
+	srand(1);
+
+	for (int s = AUDIO_SIMD_SSE2; s <= AUDIO_SIMD_NEON; s++) {
+		if (!audio_set_simd(s))
+			continue;
+
+		for (size_t l = 0; l < NUM_LENGTHS; l++) {
+			for (size_t offset = 0; offset < 4; offset++) {
+				reset(b);
+				test(b, offset, lengths[l]);
+			}
+		}
+	}
+
+	audio_set_simd(prev);
+	bfree(b);
+}
+
+static void mix_add_variant(struct buffers *b, size_t offset, size_t count)
+{
+	ref_mix_add(b->ref[0] + offset, b->in[0], count);
+	audio_mix_add(b->out[0] + offset, b->in[0], count);
+	assert_match(b, 1);
+}
+
+static void mix_add_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_variant(mix_add_variant);
+}
+
+static void balance_variant(struct buffers *b, size_t offset, size_t count)
+{
+	static const float balances[] = {0.0f, 0.1f, 0.25f, 0.48f, 0.52f, 0.75f, 0.9f, 1.0f};
+
+	for (size_t i = 0; i < sizeof(balances) / sizeof(balances[0]); i++) {
+		float balance = balances[i];
+		float *ref[2] = {b->ref[0] + offset, b->ref[1] + offset};
+
+		ref_balance_sine_law(ref, count, balance);
+
+		/* like process_audio_balancing, with the gains computed once */
+		audio_apply_gain(b->out[0] + offset, sinf((1.0f - balance) * (M_PI / 2.0f)), count);
+		audio_apply_gain(b->out[1] + offset, sinf(balance * (M_PI / 2.0f)), count);
+		assert_match(b, 2);
+	}
+}
+
+static void balance_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_variant(balance_variant);
+}
+
+static void downmix_variant(struct buffers *b, size_t offset, size_t count)
+{
+	static const size_t channel_counts[] = {1, 2, 3, 4, 5, 6, 8};
+
+	for (size_t i = 0; i < sizeof(channel_counts) / sizeof(channel_counts[0]); i++) {
+		size_t channels = channel_counts[i];
+		float *ref[MAX_CHANNELS];
+		float *out[MAX_CHANNELS];
+
+		for (size_t ch = 0; ch < channels; ch++) {
+			ref[ch] = b->ref[ch] + offset;
+			out[ch] = b->out[ch] + offset;
+		}
+
+		ref_downmix(ref, channels, count);
+		audio_downmix_to_mono(out, channels, count);
+		assert_match(b, MAX_CHANNELS);
+	}
+}
+
+static void downmix_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_variant(downmix_variant);
+}
+
+static void clamp_variant(struct buffers *b, size_t offset, size_t count)
+{
+	/* in[] is used as the unclamped copy */
+	memcpy(b->ref[1], b->in[1], sizeof(b->in[1]));
+
+	ref_clamp(b->ref[0] + offset, b->ref[1] + offset, count);
+	audio_clamp(b->out[0] + offset, b->in[1] + offset, count);
+	assert_match(b, 1);
+	assert_samples_match(b->in[1], b->ref[1], MAX_SAMPLES);
+
+	/* without the copy */
+	memcpy(b->out[2], b->ref[2], sizeof(b->ref[2]));
+	ref_clamp(b->ref[2] + offset, b->ref[3], count);
+	audio_clamp(b->out[2] + offset, NULL, count);
+	assert_samples_match(b->out[2], b->ref[2], MAX_SAMPLES);
+}
+
+static void clamp_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_variant(clamp_variant);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(mix_add_test),
+		cmocka_unit_test(balance_test),
+		cmocka_unit_test(downmix_test),
+		cmocka_unit_test(clamp_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
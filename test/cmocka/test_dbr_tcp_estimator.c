@@ -0,0 +1,163 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "dbr-tcp-estimator.h"
+
+#define MS 1000000ULL
+#define SAMPLE_MS 50
+
+#define CUR_KBPS 6000
+#define MIN_RTT_US 20000
+
+struct connection {
+	uint64_t ts;
+	uint64_t bytes_acked;
+};
+
+/* one sample every 50 ms in which acked bytes were acknowledged while
+ * backlog bytes were waiting in the kernel */
+static struct dbr_tcp_sample next_sample(struct connection *conn, uint32_t rtt_us, uint64_t acked, uint32_t backlog)
+{
+	struct dbr_tcp_sample sample = {0};
+
+	conn->ts += SAMPLE_MS * MS;
+	conn->bytes_acked += acked;
+
+	sample.ts = conn->ts;
+	sample.rtt_us = rtt_us;
+	sample.min_rtt_us = MIN_RTT_US;
+	sample.unacked_bytes = backlog / 2;
+	sample.notsent_bytes = backlog - backlog / 2;
+	sample.bytes_acked = conn->bytes_acked;
+	return sample;
+}
+
+static long update(struct dbr_tcp_estimator *est, struct connection *conn, uint32_t rtt_us, uint64_t acked,
+		   uint32_t backlog)
+{
+	struct dbr_tcp_sample sample = next_sample(conn, rtt_us, acked, backlog);
+
+	assert_true(dbr_tcp_estimator_due(est, sample.ts));
+	return dbr_tcp_estimator_update(est, &sample, CUR_KBPS);
+}
+
+/* the RTT alone, the connection doesn't say how much it can take */
+static void delayed_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct dbr_tcp_estimator est;
+	struct connection conn = {MS, 0};
+	const uint32_t delayed = MIN_RTT_US + 150000;
+
+	dbr_tcp_estimator_reset(&est);
+
+	/* one delayed sample isn't congestion, it takes three in a row */
+	assert_int_equal(update(&est, &conn, MIN_RTT_US, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, MIN_RTT_US, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), CUR_KBPS * 3 / 4);
+
+	/* the new bitrate gets time to reach the connection */
+	for (uint64_t ms = 0; ms < 2000 - SAMPLE_MS; ms += SAMPLE_MS)
+		assert_int_equal(update(&est, &conn, delayed, 0, 0), 0);
+
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), 0);
+	assert_int_equal(update(&est, &conn, delayed, 0, 0), CUR_KBPS * 3 / 4);
+}
+
+/* 500 kB/s acknowledged while the connection is backlogged */
+static void rate_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct dbr_tcp_estimator est;
+	struct connection conn = {MS, 0};
+	const uint64_t acked = 500000 * SAMPLE_MS / 1000;
+	const uint32_t backlog = 200000;
+
+	dbr_tcp_estimator_reset(&est);
+
+	/* the first sample only starts the interval */
+	assert_int_equal(update(&est, &conn, MIN_RTT_US, acked, backlog), 0);
+	assert_int_equal(update(&est, &conn, MIN_RTT_US, acked, backlog), 0);
+	assert_int_equal(update(&est, &conn, MIN_RTT_US, acked, backlog), 0);
+
+	/* 4000 kbps measured, with room to drain the backlog */
+	assert_int_equal(update(&est, &conn, MIN_RTT_US, acked, backlog), 3600);
+}
+
+/* the measured rate never goes above the kernel's delivery rate */
+static void rate_floor_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct dbr_tcp_estimator est;
+	struct connection conn = {MS, 0};
+	const uint64_t acked = 500000 * SAMPLE_MS / 1000;
+	const uint32_t backlog = 200000;
+	struct dbr_tcp_sample sample;
+	long kbps = 0;
+
+	dbr_tcp_estimator_reset(&est);
+
+	for (int i = 0; i < 4; i++) {
+		sample = next_sample(&conn, MIN_RTT_US, acked, backlog);
+		sample.delivery_rate = 400000;
+		kbps = dbr_tcp_estimator_update(&est, &sample, CUR_KBPS);
+	}
+	assert_int_equal(kbps, 400000 * 8 / 1000 * 9 / 10);
+
+	/* unless the sender ran out of data while it was measured */
+	dbr_tcp_estimator_reset(&est);
+
+	for (int i = 0; i < 4; i++) {
+		sample = next_sample(&conn, MIN_RTT_US, acked, backlog);
+		sample.delivery_rate = 400000;
+		sample.app_limited = true;
+		kbps = dbr_tcp_estimator_update(&est, &sample, CUR_KBPS);
+	}
+	assert_int_equal(kbps, 3600);
+}
+
+static void not_backlogged_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct dbr_tcp_estimator est;
+	struct connection conn = {MS, 0};
+	const uint64_t acked = 500000 * SAMPLE_MS / 1000;
+
+	dbr_tcp_estimator_reset(&est);
+
+	/* everything that was waiting got through, so the rate is what was
+	 * sent rather than what the connection can take */
+	for (int i = 0; i < 10; i++)
+		assert_int_equal(update(&est, &conn, MIN_RTT_US, acked, 20000), 0);
+
+	/* a backlog that's gone within 100 ms is a burst like a keyframe */
+	dbr_tcp_estimator_reset(&est);
+
+	assert_int_equal(update(&est, &conn, MIN_RTT_US, acked, 200000), 0);
+	for (int i = 0; i < 10; i++)
+		assert_int_equal(update(&est, &conn, MIN_RTT_US, acked / 10, 50000), 0);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(delayed_test),
+		cmocka_unit_test(rate_test),
+		cmocka_unit_test(rate_floor_test),
+		cmocka_unit_test(not_backlogged_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
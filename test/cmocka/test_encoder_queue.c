@@ -0,0 +1,245 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <obs-encoder-queue.h>
+
+static void push_pts(struct encoder_frame_queue *queue, int64_t pts, bool expected)
+{
+	struct encoder_queued_frame *frame = encoder_frame_queue_get_frame(queue, 64);
+
+	memset(frame->data, (int)pts, 64);
+	frame->frame.data[0] = frame->data;
+	frame->frame.linesize[0] = 64;
+	frame->frame.pts = pts;
+	frame->keep = pts == 0;
+
+	assert_int_equal(encoder_frame_queue_push(queue, frame), expected);
+}
+
+static void pop_pts(struct encoder_frame_queue *queue, int64_t pts)
+{
+	struct encoder_queued_frame *frame = encoder_frame_queue_pop(queue);
+
+	assert_non_null(frame);
+	assert_int_equal(frame->frame.pts, pts);
+	assert_int_equal(frame->data[63], (uint8_t)pts);
+	encoder_queued_frame_release(frame);
+}
+
+static void drop_oldest_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_frame_queue queue;
+	struct obs_encoder_async_stats stats;
+
+	assert_true(encoder_frame_queue_init(&queue, 3, OBS_ENCODER_OVERFLOW_DROP_OLDEST));
+
+	/* the first frame is kept, the oldest frames after it make room */
+	for (int64_t pts = 0; pts < 6; pts++)
+		push_pts(&queue, pts, true);
+
+	encoder_frame_queue_get_stats(&queue, &stats);
+	assert_true(stats.async);
+	assert_int_equal(stats.queue_size, 3);
+	assert_int_equal(stats.queue_depth, 3);
+	assert_int_equal(stats.max_queue_depth, 3);
+	assert_int_equal(stats.queued_frames, 6);
+	assert_int_equal(stats.dropped_frames, 3);
+	assert_int_equal(stats.skipped_frames, 0);
+
+	pop_pts(&queue, 0);
+	pop_pts(&queue, 4);
+	pop_pts(&queue, 5);
+
+	encoder_frame_queue_get_stats(&queue, &stats);
+	assert_int_equal(stats.queue_depth, 0);
+	assert_int_equal(stats.encoded_frames, 3);
+
+	encoder_frame_queue_free(&queue);
+}
+
+static void skip_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_frame_queue queue;
+	struct obs_encoder_async_stats stats;
+
+	assert_true(encoder_frame_queue_init(&queue, 2, OBS_ENCODER_OVERFLOW_SKIP));
+
+	push_pts(&queue, 0, true);
+	push_pts(&queue, 1, true);
+	push_pts(&queue, 2, false);
+	push_pts(&queue, 3, false);
+
+	pop_pts(&queue, 0);
+	push_pts(&queue, 4, true);
+	pop_pts(&queue, 1);
+	pop_pts(&queue, 4);
+
+	encoder_frame_queue_get_stats(&queue, &stats);
+	assert_int_equal(stats.queued_frames, 3);
+	assert_int_equal(stats.skipped_frames, 2);
+	assert_int_equal(stats.dropped_frames, 0);
+
+	encoder_frame_queue_free(&queue);
+}
+
+static void *push_thread(void *data)
+{
+	push_pts(data, 1, true);
+	return NULL;
+}
+
+static void *push_stopped_thread(void *data)
+{
+	push_pts(data, 2, false);
+	return NULL;
+}
+
+static void block_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_frame_queue queue;
+	struct obs_encoder_async_stats stats;
+	pthread_t thread;
+
+	assert_true(encoder_frame_queue_init(&queue, 1, OBS_ENCODER_OVERFLOW_BLOCK));
+
+	push_pts(&queue, 0, true);
+	assert_int_equal(pthread_create(&thread, NULL, push_thread, &queue), 0);
+
+	/* the second push waits until the first frame is taken */
+	os_sleep_ms(20);
+	encoder_frame_queue_get_stats(&queue, &stats);
+	assert_int_equal(stats.queued_frames, 1);
+	assert_int_equal(stats.blocked_frames, 1);
+
+	pop_pts(&queue, 0);
+	pthread_join(thread, NULL);
+	pop_pts(&queue, 1);
+
+	encoder_frame_queue_get_stats(&queue, &stats);
+	assert_int_equal(stats.queued_frames, 2);
+	assert_int_equal(stats.blocked_frames, 1);
+	assert_true(stats.blocked_ns > 0);
+
+	encoder_frame_queue_free(&queue);
+}
+
+static void *pop_thread(void *data)
+{
+	return encoder_frame_queue_pop(data);
+}
+
+static void stop_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_frame_queue queue;
+	pthread_t thread;
+	void *ret = &ret;
+
+	assert_true(encoder_frame_queue_init(&queue, 2, OBS_ENCODER_OVERFLOW_BLOCK));
+
+	/* stopping wakes up a waiting encode thread */
+	assert_int_equal(pthread_create(&thread, NULL, pop_thread, &queue), 0);
+	os_sleep_ms(10);
+	encoder_frame_queue_stop(&queue);
+	pthread_join(thread, &ret);
+	assert_null(ret);
+
+	push_pts(&queue, 0, false);
+
+	/* and a producer waiting for space */
+	encoder_frame_queue_reset(&queue);
+	push_pts(&queue, 0, true);
+	push_pts(&queue, 1, true);
+	assert_int_equal(pthread_create(&thread, NULL, push_stopped_thread, &queue), 0);
+	os_sleep_ms(10);
+	encoder_frame_queue_stop(&queue);
+	pthread_join(thread, NULL);
+
+	/* queued frames are released on reset */
+	encoder_frame_queue_reset(&queue);
+	push_pts(&queue, 3, true);
+	pop_pts(&queue, 3);
+
+	encoder_frame_queue_free(&queue);
+}
+
+static void reuse_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_frame_queue queue;
+	struct encoder_queued_frame *first, *second;
+	long allocs = bnum_allocs();
+
+	assert_true(encoder_frame_queue_init(&queue, 2, OBS_ENCODER_OVERFLOW_SKIP));
+
+	first = encoder_frame_queue_get_frame(&queue, 1000);
+	uint8_t *data = first->data;
+	encoder_queued_frame_release(first);
+
+	/* a released frame comes back with its buffer if it's big enough */
+	second = encoder_frame_queue_get_frame(&queue, 800);
+	assert_ptr_equal(first, second);
+	assert_ptr_equal(second->data, data);
+
+	/* references keep the frame from being reused */
+	encoder_queued_frame_addref(second);
+	encoder_queued_frame_release(second);
+	first = encoder_frame_queue_get_frame(&queue, 800);
+	assert_ptr_not_equal(first, second);
+
+	encoder_queued_frame_release(second);
+	encoder_queued_frame_release(first);
+
+	encoder_frame_queue_free(&queue);
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+static void timing_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_frame_queue queue;
+	struct encoder_queued_frame frame = {0};
+	struct obs_encoder_async_stats stats;
+
+	assert_true(encoder_frame_queue_init(&queue, 2, OBS_ENCODER_OVERFLOW_BLOCK));
+
+	frame.queued_ts = 1000;
+	encoder_frame_queue_add_timing(&queue, &frame, 4000, 5000);
+	frame.queued_ts = 2000;
+	encoder_frame_queue_add_timing(&queue, &frame, 3000, 6000);
+
+	encoder_frame_queue_get_stats(&queue, &stats);
+	assert_int_equal(stats.last_queue_ns, 1000);
+	assert_int_equal(stats.avg_queue_ns, 2000);
+	assert_int_equal(stats.max_queue_ns, 3000);
+	assert_int_equal(stats.last_encode_ns, 3000);
+	assert_int_equal(stats.avg_encode_ns, 2000);
+	assert_int_equal(stats.max_encode_ns, 3000);
+
+	encoder_frame_queue_free(&queue);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(drop_oldest_test), cmocka_unit_test(skip_test),  cmocka_unit_test(block_test),
+		cmocka_unit_test(stop_test),        cmocka_unit_test(reuse_test), cmocka_unit_test(timing_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,197 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/c99defs.h>
+#include <util/threading.h>
+
+#include "ffmpeg-mux-shm.h"
+
+/* not a power of two, so reads and writes wrap at odd offsets */
+#define RING_SIZE 1000
+#define NUM_MESSAGES 2000
+#define MAX_MESSAGE 2500
+
+struct writer_data {
+	struct ffm_shm *shm;
+	uint64_t total;
+	bool success;
+};
+
+static inline uint8_t pattern(uint64_t pos)
+{
+	return (uint8_t)(pos * 31 + (pos >> 8));
+}
+
+static inline size_t message_size(size_t i)
+{
+	return 1 + i * 97 % MAX_MESSAGE;
+}
+
+/* both ends live in this process, so the reader gets its own copies of the
+ * descriptors the child would have inherited */
+static struct ffm_shm *open_reader(struct ffm_shm *writer)
+{
+	char arg[128];
+	int fds[4];
+	size_t size;
+
+	ffm_shm_get_arg(writer, arg, sizeof(arg));
+	assert_int_equal(sscanf(arg + sizeof(FFM_SHM_ARG) - 1, "%d,%d,%d,%d,%zu", &fds[0], &fds[1], &fds[2], &fds[3],
+				&size),
+			 5);
+	for (size_t i = 0; i < 4; i++)
+		fds[i] = dup(fds[i]);
+
+	snprintf(arg, sizeof(arg), FFM_SHM_ARG "%d,%d,%d,%d,%zu", fds[0], fds[1], fds[2], fds[3], size);
+	ffm_shm_spawned(writer);
+
+	struct ffm_shm *reader = ffm_shm_open(arg);
+	assert_non_null(reader);
+	return reader;
+}
+
+static void *writer_thread(void *param)
+{
+	struct writer_data *wd = param;
+	uint8_t *buf = bmalloc(MAX_MESSAGE + 1);
+	uint64_t pos = 0;
+
+	wd->success = true;
+
+	for (size_t i = 0; i < NUM_MESSAGES && wd->success; i++) {
+		size_t size = message_size(i);
+
+		for (size_t j = 0; j < size; j++)
+			buf[j] = pattern(pos + j);
+
+		wd->success = ffm_shm_write(wd->shm, buf, size);
+		pos += size;
+	}
+
+	wd->total = pos;
+	ffm_shm_close(wd->shm);
+	bfree(buf);
+	return NULL;
+}
+
+static void round_trip_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffm_shm_stats stats = {0};
+	struct writer_data wd = {0};
+	struct ffm_shm *reader;
+	pthread_t thread;
+	uint8_t buf[777];
+	uint64_t pos = 0;
+	size_t chunk = 1;
+
+	wd.shm = ffm_shm_create(RING_SIZE, &stats);
+	assert_non_null(wd.shm);
+	reader = open_reader(wd.shm);
+
+	assert_int_equal(pthread_create(&thread, NULL, writer_thread, &wd), 0);
+
+	/* read in sizes unrelated to the writes, so both sides keep waiting on
+	 * each other and pieces straddle the end of the ring */
+	for (;;) {
+		size_t size = ffm_shm_read(reader, buf, chunk);
+		if (!size)
+			break;
+
+		assert_int_equal(size, chunk);
+		for (size_t i = 0; i < size; i++)
+			assert_int_equal(buf[i], pattern(pos + i));
+
+		pos += size;
+		chunk = chunk % (sizeof(buf) - 13) + 13;
+	}
+
+	pthread_join(thread, NULL);
+	assert_true(wd.success);
+
+	/* the last read may have wanted more than what was left */
+	assert_true(pos <= wd.total && wd.total - pos < sizeof(buf));
+	assert_int_equal(stats.bytes, wd.total);
+	assert_int_equal(stats.writes, NUM_MESSAGES);
+	assert_true(stats.max_queued <= RING_SIZE);
+	assert_true(stats.full_waits > 0);
+
+	ffm_shm_destroy(reader);
+	ffm_shm_destroy(wd.shm);
+}
+
+static void close_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffm_shm_stats stats = {0};
+	struct ffm_shm *writer = ffm_shm_create(RING_SIZE, &stats);
+	struct ffm_shm *reader = open_reader(writer);
+	uint8_t in[RING_SIZE], out[RING_SIZE];
+
+	for (size_t i = 0; i < sizeof(in); i++)
+		in[i] = pattern(i);
+
+	/* data written right before closing is still read, and the read
+	 * after it reports the end */
+	assert_true(ffm_shm_write(writer, in, 100));
+	ffm_shm_close(writer);
+
+	assert_int_equal(ffm_shm_read(reader, out, 100), 100);
+	assert_memory_equal(out, in, 100);
+	assert_int_equal(ffm_shm_read(reader, out, 1), 0);
+
+	ffm_shm_destroy(reader);
+	ffm_shm_destroy(writer);
+}
+
+static void reader_exit_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffm_shm_stats stats = {0};
+	struct ffm_shm *writer = ffm_shm_create(RING_SIZE, &stats);
+	struct ffm_shm *reader = open_reader(writer);
+	uint8_t in[RING_SIZE] = {0};
+
+	/* a full ring doesn't block while the reader is around... */
+	assert_true(ffm_shm_write(writer, in, sizeof(in)));
+	assert_int_equal(stats.full_waits, 0);
+	assert_int_equal(stats.max_queued, RING_SIZE);
+
+	/* ...and the writer gives up instead of waiting forever once it's
+	 * gone */
+	ffm_shm_destroy(reader);
+	assert_false(ffm_shm_write(writer, in, 1));
+	assert_int_equal(stats.full_waits, 1);
+
+	ffm_shm_destroy(writer);
+}
+
+static void open_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	assert_null(ffm_shm_open("--not-the-ring"));
+	assert_null(ffm_shm_open(FFM_SHM_ARG "1,2,3"));
+	assert_null(ffm_shm_open(FFM_SHM_ARG "-1,-1,-1,-1,1000"));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(round_trip_test),
+		cmocka_unit_test(close_test),
+		cmocka_unit_test(reader_exit_test),
+		cmocka_unit_test(open_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,131 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/histogram.h>
+
+static void exact_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct histogram hist = {0};
+
+	assert_int_equal(histogram_percentile(&hist, 50.0), 0);
+	assert_int_equal(histogram_mean(&hist), 0);
+
+	/* small values get a bucket each */
+	for (uint64_t i = 1; i <= 100; i++)
+		histogram_record(&hist, i);
+
+	assert_int_equal(hist.count, 100);
+	assert_int_equal(hist.min, 1);
+	assert_int_equal(hist.max, 100);
+	assert_int_equal(histogram_mean(&hist), 50);
+	assert_int_equal(histogram_percentile(&hist, 0.0), 1);
+	assert_int_equal(histogram_percentile(&hist, 50.0), 50);
+	assert_int_equal(histogram_percentile(&hist, 90.0), 90);
+	assert_int_equal(histogram_percentile(&hist, 99.0), 99);
+	assert_int_equal(histogram_percentile(&hist, 99.9), 100);
+	assert_int_equal(histogram_percentile(&hist, 100.0), 100);
+
+	histogram_free(&hist);
+}
+
+static void precision_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct histogram hist = {0};
+
+	/* every value is reported within 1/64th above itself */
+	for (uint64_t value = 1; value < HISTOGRAM_MAX_VALUE; value = value * 3 + 7) {
+		uint64_t p;
+
+		histogram_reset(&hist);
+		histogram_record(&hist, value);
+		histogram_record(&hist, HISTOGRAM_MAX_VALUE);
+
+		p = histogram_percentile(&hist, 50.0);
+		assert_true(p >= value);
+		assert_true(p - value <= value / 64);
+	}
+
+	/* larger values are clamped */
+	histogram_reset(&hist);
+	histogram_record(&hist, UINT64_MAX);
+	assert_int_equal(hist.max, HISTOGRAM_MAX_VALUE);
+	assert_int_equal(histogram_percentile(&hist, 50.0), HISTOGRAM_MAX_VALUE);
+
+	histogram_free(&hist);
+}
+
+static void percentile_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct histogram hist = {0};
+
+	/* encode times in ns: mostly 2-3 ms with a few slow frames */
+	for (uint64_t i = 0; i < 10000; i++)
+		histogram_record(&hist, 2000000 + (i % 1000) * 1000);
+	for (uint64_t i = 0; i < 10; i++)
+		histogram_record(&hist, 40000000);
+
+	uint64_t p50 = histogram_percentile(&hist, 50.0);
+	uint64_t p99 = histogram_percentile(&hist, 99.0);
+	uint64_t p999 = histogram_percentile(&hist, 99.95);
+
+	assert_true(p50 >= 2499000 && p50 <= 2499000 + 2499000 / 64);
+	assert_true(p99 >= 2989000 && p99 <= 2989000 + 2989000 / 64);
+	assert_int_equal(p999, 40000000);
+
+	histogram_free(&hist);
+}
+
+static void add_reset_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct histogram a = {0};
+	struct histogram b = {0};
+	long allocs = bnum_allocs();
+
+	histogram_record(&a, 10);
+	histogram_record(&a, 20);
+	histogram_record(&b, 5);
+	histogram_record(&b, 1000);
+
+	histogram_add(&a, &b);
+	assert_int_equal(a.count, 4);
+	assert_int_equal(a.min, 5);
+	assert_int_equal(a.max, 1000);
+	assert_int_equal(a.sum, 1035);
+	assert_int_equal(histogram_percentile(&a, 50.0), 10);
+	assert_int_equal(histogram_percentile(&a, 75.0), 20);
+
+	histogram_reset(&a);
+	assert_int_equal(a.count, 0);
+	assert_int_equal(histogram_percentile(&a, 50.0), 0);
+
+	histogram_record(&a, 7);
+	assert_int_equal(a.min, 7);
+	assert_int_equal(histogram_percentile(&a, 100.0), 7);
+
+	histogram_free(&a);
+	histogram_free(&b);
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(exact_test),
+		cmocka_unit_test(precision_test),
+		cmocka_unit_test(percentile_test),
+		cmocka_unit_test(add_reset_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,301 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <obs.h>
+#include <obs-output-interleave.h>
+
+/*
+ * Recorded packet timelines are replayed in arrival order through the
+ * interleaver and compared against the sorted-array insertion that outputs
+ * used before the interleaver had per-track queues.
+ */
+
+#define V OBS_ENCODER_VIDEO
+#define A OBS_ENCODER_AUDIO
+
+struct timeline_entry {
+	enum obs_encoder_type type;
+	size_t track_idx;
+	int64_t dts_usec;
+};
+
+static struct encoder_packet make_packet(const struct timeline_entry *entry)
+{
+	struct encoder_packet packet = {0};
+
+	packet.type = entry->type;
+	packet.track_idx = entry->track_idx;
+	packet.dts_usec = entry->dts_usec;
+	packet.dts = entry->dts_usec;
+	packet.pts = entry->dts_usec;
+	packet.timebase_num = 1;
+	packet.timebase_den = 1000000;
+	return packet;
+}
+
+/* the linear insertion the interleaver replaces */
+static void reference_insert(struct darray *da, const struct encoder_packet *out)
+{
+	DARRAY(struct encoder_packet) packets;
+	size_t idx;
+
+	packets.da = *da;
+
+	for (idx = 0; idx < packets.num; idx++) {
+		struct encoder_packet *cur_packet = packets.array + idx;
+
+		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO &&
+		    cur_packet->type == OBS_ENCODER_VIDEO && out->track_idx > cur_packet->track_idx)
+			continue;
+
+		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO) {
+			break;
+		} else if (out->dts_usec < cur_packet->dts_usec) {
+			break;
+		}
+	}
+
+	da_insert(packets, idx, out);
+	*da = packets.da;
+}
+
+static void replay_timeline(const struct timeline_entry *timeline, size_t count)
+{
+	struct packet_interleaver il = {0};
+	DARRAY(struct encoder_packet) expected;
+	struct encoder_packet packet;
+
+	da_init(expected);
+
+	for (size_t i = 0; i < count; i++) {
+		packet = make_packet(&timeline[i]);
+		interleaver_push(&il, &packet);
+		reference_insert(&expected.da, &packet);
+	}
+
+	assert_int_equal(interleaver_num_packets(&il), count);
+
+	for (size_t i = 0; i < count; i++) {
+		struct encoder_packet *next = interleaver_peek(&il);
+
+		assert_non_null(next);
+		assert_true(interleaver_pop(&il, &packet));
+
+		assert_int_equal(packet.type, expected.array[i].type);
+		assert_int_equal(packet.track_idx, expected.array[i].track_idx);
+		assert_int_equal(packet.dts_usec, expected.array[i].dts_usec);
+	}
+
+	assert_null(interleaver_peek(&il));
+	assert_false(interleaver_pop(&il, &packet));
+	assert_int_equal(interleaver_num_packets(&il), 0);
+
+	interleaver_free(&il);
+	da_free(expected);
+}
+
+/* single video track with AAC priming packets, recorded at output start */
+static const struct timeline_entry startup_timeline[] = {
+	{A, 0, -42666}, {A, 0, -21333}, {A, 0, 0},      {V, 0, -33333}, {A, 0, 21333}, {V, 0, 0},
+	{A, 0, 42666},  {V, 0, 16666},  {A, 0, 64000},  {V, 0, 33333},  {V, 0, 50000}, {A, 0, 85333},
+	{V, 0, 66666},  {A, 0, 106666}, {V, 0, 83333},  {V, 0, 100000}, {A, 0, 128000},
+};
+
+/* video and audio packets sharing timestamps */
+static const struct timeline_entry equal_ts_timeline[] = {
+	{A, 0, 0},     {V, 0, 0},     {A, 1, 0},     {V, 1, 0},     {A, 0, 20000}, {A, 1, 20000},
+	{V, 1, 20000}, {V, 0, 20000}, {V, 2, 20000}, {V, 2, 0},     {A, 0, 40000}, {A, 1, 40000},
+	{V, 0, 40000}, {V, 2, 40000}, {V, 1, 40000}, {A, 0, 60000}, {A, 1, 60000},
+};
+
+static void startup_timeline_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	replay_timeline(startup_timeline, sizeof(startup_timeline) / sizeof(startup_timeline[0]));
+}
+
+static void equal_ts_timeline_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	replay_timeline(equal_ts_timeline, sizeof(equal_ts_timeline) / sizeof(equal_ts_timeline[0]));
+}
+
+/* three video encoders with different frame rates and all six audio tracks,
+ * delivered in bursts like encoders running on their own threads */
+static void multitrack_timeline_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const int64_t video_interval[] = {16667, 33333, 16667};
+	DARRAY(struct timeline_entry) timeline;
+	int64_t video_ts[3] = {0};
+	int64_t audio_ts = -42667;
+	uint32_t seed = 1;
+
+	da_init(timeline);
+
+	for (size_t step = 0; step < 1000; step++) {
+		size_t burst;
+
+		seed = seed * 1103515245 + 12345;
+		burst = (seed >> 16) % 4;
+
+		for (size_t track = 0; track < 3; track++) {
+			for (size_t i = 0; i < burst; i++) {
+				struct timeline_entry entry = {V, track, video_ts[track]};
+				da_push_back(timeline, &entry);
+				video_ts[track] += video_interval[track];
+			}
+		}
+
+		/* audio encoders for all mixes are run one after another */
+		for (size_t i = 0; i < (seed >> 20) % 3; i++) {
+			for (size_t track = 0; track < 6; track++) {
+				struct timeline_entry entry = {A, track, audio_ts};
+				da_push_back(timeline, &entry);
+			}
+			audio_ts += 21333;
+		}
+	}
+
+	replay_timeline(timeline.array, timeline.num);
+	da_free(timeline);
+}
+
+/* encoders should output packets in DTS order, but the queues cope if not */
+static void out_of_order_track_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const struct timeline_entry timeline[] = {
+		{V, 0, 0}, {V, 0, 33333}, {V, 0, 16666}, {A, 0, 10000}, {A, 0, 5000}, {V, 0, 50000}, {A, 0, 40000},
+	};
+
+	replay_timeline(timeline, sizeof(timeline) / sizeof(timeline[0]));
+}
+
+static bool before_ts(void *param, struct encoder_packet *packet)
+{
+	return packet->dts_usec < *(int64_t *)param;
+}
+
+static void count_while_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_interleaver il = {0};
+	int64_t ts;
+
+	for (size_t i = 0; i < 10; i++) {
+		struct timeline_entry video = {V, 0, (int64_t)i * 100};
+		struct timeline_entry audio = {A, 0, (int64_t)i * 100 + 50};
+		struct encoder_packet packet;
+
+		packet = make_packet(&video);
+		interleaver_push(&il, &packet);
+		packet = make_packet(&audio);
+		interleaver_push(&il, &packet);
+	}
+
+	ts = 475;
+	assert_int_equal(interleaver_count_while(&il, before_ts, &ts, SIZE_MAX), 10);
+	assert_int_equal(interleaver_count_while(&il, before_ts, &ts, 3), 3);
+
+	ts = 0;
+	assert_int_equal(interleaver_count_while(&il, before_ts, &ts, SIZE_MAX), 0);
+
+	/* counting doesn't remove anything */
+	assert_int_equal(interleaver_num_packets(&il), 20);
+	assert_int_equal(interleaver_peek(&il)->dts_usec, 0);
+
+	interleaver_free(&il);
+}
+
+/* like applying the stream start offsets, which differ per track */
+static void resort_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_interleaver il = {0};
+	struct encoder_packet packet;
+	int64_t last_ts = INT64_MIN;
+
+	for (size_t i = 0; i < 8; i++) {
+		struct timeline_entry video = {V, 0, 1000000 + (int64_t)i * 100};
+		struct timeline_entry audio = {A, 0, (int64_t)i * 100};
+
+		packet = make_packet(&video);
+		interleaver_push(&il, &packet);
+		packet = make_packet(&audio);
+		interleaver_push(&il, &packet);
+	}
+
+	for (size_t i = 0; i < interleaver_track_size(&il, V, 0); i++)
+		interleaver_track_packet(&il, V, 0, i)->dts_usec -= 1000000;
+
+	interleaver_resort(&il);
+
+	assert_int_equal(interleaver_first(&il, V, 0)->dts_usec, 0);
+	assert_int_equal(interleaver_last(&il, A, 0)->dts_usec, 700);
+
+	for (size_t i = 0; i < 16; i++) {
+		assert_true(interleaver_pop(&il, &packet));
+		assert_true(packet.dts_usec >= last_ts);
+
+		/* video first on equal timestamps */
+		assert_int_equal(packet.type, (i % 2) ? A : V);
+		last_ts = packet.dts_usec;
+	}
+
+	interleaver_free(&il);
+}
+
+static void free_releases_packets_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_interleaver il = {0};
+	long allocs = bnum_allocs();
+
+	for (size_t i = 0; i < 100; i++) {
+		struct timeline_entry entry = {(i % 3) ? A : V, i % 2, (int64_t)i * 1000};
+		struct encoder_packet packet = make_packet(&entry);
+		long *refs = bmalloc(sizeof(long) + 16);
+
+		*refs = 1;
+		packet.data = (uint8_t *)(refs + 1);
+		packet.size = 16;
+		interleaver_push(&il, &packet);
+	}
+
+	/* send some of them first */
+	for (size_t i = 0; i < 60; i++) {
+		struct encoder_packet packet;
+
+		assert_true(interleaver_pop(&il, &packet));
+		obs_encoder_packet_release(&packet);
+	}
+
+	assert_int_equal(interleaver_num_packets(&il), 40);
+
+	interleaver_free(&il);
+	assert_int_equal(interleaver_num_packets(&il), 0);
+	assert_null(interleaver_peek(&il));
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(startup_timeline_test),    cmocka_unit_test(equal_ts_timeline_test),
+		cmocka_unit_test(multitrack_timeline_test), cmocka_unit_test(out_of_order_track_test),
+		cmocka_unit_test(count_while_test),         cmocka_unit_test(resort_test),
+		cmocka_unit_test(free_releases_packets_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,217 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+/* solid I420 color, (200, 100, 50) in full range 709 */
+#define TEST_Y 118
+#define TEST_U 92
+#define TEST_V 180
+#define TOLERANCE 4
+
+#define CX 32
+#define CY 16
+
+struct frame_check {
+	os_event_t *matched;
+	volatile long frames;
+};
+
+static const char *async_get_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "null graphics test source";
+}
+
+static void *async_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void async_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static struct obs_source_info async_source = {
+	.id = "null_graphics_test_async",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_ASYNC_VIDEO,
+	.get_name = async_get_name,
+	.create = async_create,
+	.destroy = async_destroy,
+};
+
+static bool near(uint8_t val, int expected)
+{
+	return abs((int)val - expected) <= TOLERANCE;
+}
+
+static bool plane_matches(const uint8_t *data, uint32_t linesize, uint32_t width, uint32_t height, size_t step,
+			  int expected)
+{
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t *line = data + (size_t)y * linesize;
+
+		for (uint32_t x = 0; x < width; x++) {
+			if (!near(line[x * step], expected))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static void receive_video(void *param, struct video_data *frame)
+{
+	struct frame_check *check = param;
+
+	os_atomic_inc_long(&check->frames);
+
+	/* the first frames may go out before the async frame is uploaded */
+	if (!plane_matches(frame->data[0], frame->linesize[0], CX, CY, 1, TEST_Y))
+		return;
+	if (!plane_matches(frame->data[1], frame->linesize[1], CX / 2, CY / 2, 2, TEST_U))
+		return;
+	if (!plane_matches(frame->data[1] + 1, frame->linesize[1], CX / 2, CY / 2, 2, TEST_V))
+		return;
+
+	os_event_signal(check->matched);
+}
+
+static int reset_video(uint32_t cx, uint32_t cy)
+{
+	struct obs_video_info ovi = {
+		.graphics_module = NULL_GRAPHICS_MODULE,
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = cx,
+		.base_height = cy,
+		.output_width = cx,
+		.output_height = cy,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_FULL,
+		.scale_type = OBS_SCALE_POINT,
+	};
+
+	return obs_reset_video(&ovi);
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	/* the effects are loaded straight from the source tree */
+	PRAGMA_WARN_PUSH
+	PRAGMA_DISABLE_DEPRECATION
+	obs_add_data_path(LIBOBS_DATA_PATH);
+	PRAGMA_WARN_POP
+	obs_register_source(&async_source);
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_shutdown();
+	return 0;
+}
+
+static void reset_video_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_video_info ovi;
+
+	assert_int_equal(reset_video(64, 32), OBS_VIDEO_SUCCESS);
+	assert_true(obs_get_video_info(&ovi));
+	assert_int_equal(ovi.base_width, 64);
+	assert_int_equal(ovi.base_height, 32);
+
+	/* resetting again with nothing active reinitializes the mix */
+	assert_int_equal(reset_video(CX, CY), OBS_VIDEO_SUCCESS);
+	assert_true(obs_get_video_info(&ovi));
+	assert_int_equal(ovi.base_width, CX);
+	assert_int_equal(ovi.output_height, CY);
+}
+
+static void frame_round_trip_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct frame_check check = {0};
+	struct obs_source_frame frame = {0};
+	uint8_t y_plane[CX * CY];
+	uint8_t u_plane[CX / 2 * CY / 2];
+	uint8_t v_plane[CX / 2 * CY / 2];
+	obs_source_t *source;
+
+	assert_int_equal(reset_video(CX, CY), OBS_VIDEO_SUCCESS);
+	assert_int_equal(os_event_init(&check.matched, OS_EVENT_TYPE_MANUAL), 0);
+
+	memset(y_plane, TEST_Y, sizeof(y_plane));
+	memset(u_plane, TEST_U, sizeof(u_plane));
+	memset(v_plane, TEST_V, sizeof(v_plane));
+
+	frame.data[0] = y_plane;
+	frame.data[1] = u_plane;
+	frame.data[2] = v_plane;
+	frame.linesize[0] = CX;
+	frame.linesize[1] = CX / 2;
+	frame.linesize[2] = CX / 2;
+	frame.width = CX;
+	frame.height = CY;
+	frame.format = VIDEO_FORMAT_I420;
+	frame.full_range = true;
+	video_format_get_parameters_for_format(VIDEO_CS_709, VIDEO_RANGE_FULL, VIDEO_FORMAT_I420, frame.color_matrix,
+					       frame.color_range_min, frame.color_range_max);
+
+	source = obs_source_create_private(async_source.id, "async", NULL);
+	assert_non_null(source);
+	obs_source_set_async_unbuffered(source, true);
+	obs_set_output_source(0, source);
+
+	obs_add_raw_video_callback(NULL, receive_video, &check);
+
+	/* the I420 frame goes through I420_Reverse on upload, gets drawn
+	 * into the composite with default.effect, and comes back out of the
+	 * NV12_Y/NV12_UV output conversion */
+	for (int i = 0; i < 100 && os_event_try(check.matched) == EAGAIN; i++) {
+		frame.timestamp = os_gettime_ns();
+		obs_source_output_video(source, &frame);
+		os_sleep_ms(20);
+	}
+
+	obs_remove_raw_video_callback(receive_video, &check);
+
+	assert_true(os_atomic_load_long(&check.frames) > 0);
+	assert_int_equal(os_event_try(check.matched), 0);
+
+	obs_set_output_source(0, NULL);
+	obs_source_release(source);
+	os_event_destroy(check.matched);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(reset_video_test),
+		cmocka_unit_test(frame_round_trip_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,411 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define FPS 30
+#define SAMPLE_RATE 48000
+#define AUDIO_FRAME_SIZE 1024
+#define AUDIO_FRAME_USEC (AUDIO_FRAME_SIZE * 1000000LL / SAMPLE_RATE)
+
+/* the tracks have keyframes at different times, so the second video track of
+ * a joining output has to wait for one of its own */
+#define KEYINT_0 10
+#define KEYINT_1 7
+
+#define WAIT_MS 10000
+
+struct received_packet {
+	enum obs_encoder_type type;
+	size_t track_idx;
+	int64_t pts;
+	int64_t dts_usec;
+	bool keyframe;
+};
+
+struct test_output {
+	obs_output_t *output;
+	pthread_mutex_t mutex;
+	DARRAY(struct received_packet) packets;
+};
+
+struct test_encoder {
+	uint8_t data[16];
+	int64_t keyint;
+};
+
+/* ------------------------------------------------------------------------- */
+/* encoders: one small packet per frame, video keyframes every keyint frames */
+
+static const char *test_encoder_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "packet bus test encoder";
+}
+
+static void *test_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct test_encoder *te = bzalloc(sizeof(*te));
+	UNUSED_PARAMETER(encoder);
+
+	te->keyint = obs_data_get_int(settings, "keyint");
+	return te;
+}
+
+static void test_encoder_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool video_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet,
+			 bool *received_packet)
+{
+	struct test_encoder *te = data;
+
+	packet->data = te->data;
+	packet->size = sizeof(te->data);
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->type = OBS_ENCODER_VIDEO;
+	packet->keyframe = frame->pts % te->keyint == 0;
+	*received_packet = true;
+	return true;
+}
+
+static bool audio_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet,
+			 bool *received_packet)
+{
+	struct test_encoder *te = data;
+
+	packet->data = te->data;
+	packet->size = sizeof(te->data);
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->type = OBS_ENCODER_AUDIO;
+	packet->keyframe = true;
+	*received_packet = true;
+	return true;
+}
+
+static size_t audio_frame_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return AUDIO_FRAME_SIZE;
+}
+
+static struct obs_encoder_info video_encoder = {
+	.id = "packet_bus_test_video",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.get_name = test_encoder_name,
+	.create = test_encoder_create,
+	.destroy = test_encoder_destroy,
+	.encode = video_encode,
+};
+
+static struct obs_encoder_info audio_encoder = {
+	.id = "packet_bus_test_audio",
+	.type = OBS_ENCODER_AUDIO,
+	.codec = "aac",
+	.get_name = test_encoder_name,
+	.create = test_encoder_create,
+	.destroy = test_encoder_destroy,
+	.encode = audio_encode,
+	.get_frame_size = audio_frame_size,
+};
+
+/* ------------------------------------------------------------------------- */
+/* output: records the packets it receives */
+
+static const char *test_output_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "packet bus test output";
+}
+
+static void *test_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct test_output *to = bzalloc(sizeof(*to));
+	UNUSED_PARAMETER(settings);
+
+	to->output = output;
+	pthread_mutex_init(&to->mutex, NULL);
+	return to;
+}
+
+static void test_output_destroy(void *data)
+{
+	struct test_output *to = data;
+
+	da_free(to->packets);
+	pthread_mutex_destroy(&to->mutex);
+	bfree(to);
+}
+
+static bool test_output_start(void *data)
+{
+	struct test_output *to = data;
+	return obs_output_begin_data_capture(to->output, 0);
+}
+
+static void test_output_stop(void *data, uint64_t ts)
+{
+	struct test_output *to = data;
+	UNUSED_PARAMETER(ts);
+
+	obs_output_end_data_capture(to->output);
+}
+
+static void test_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct test_output *to = data;
+
+	if (!packet)
+		return;
+
+	struct received_packet rp = {
+		.type = packet->type,
+		.track_idx = packet->track_idx,
+		.pts = packet->pts,
+		.dts_usec = packet->dts_usec,
+		.keyframe = packet->keyframe,
+	};
+
+	pthread_mutex_lock(&to->mutex);
+	da_push_back(to->packets, &rp);
+	pthread_mutex_unlock(&to->mutex);
+}
+
+static struct obs_output_info test_output_info = {
+	.id = "packet_bus_test_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK_AV,
+	.get_name = test_output_name,
+	.create = test_output_create,
+	.destroy = test_output_destroy,
+	.start = test_output_start,
+	.stop = test_output_stop,
+	.encoded_packet = test_output_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static size_t count_packets(struct test_output *to, enum obs_encoder_type type, size_t track_idx)
+{
+	size_t count = 0;
+
+	pthread_mutex_lock(&to->mutex);
+	for (size_t i = 0; i < to->packets.num; i++) {
+		struct received_packet *rp = &to->packets.array[i];
+		if (rp->type == type && rp->track_idx == track_idx)
+			count++;
+	}
+	pthread_mutex_unlock(&to->mutex);
+
+	return count;
+}
+
+static bool wait_for_packets(struct test_output *to, size_t video, size_t audio)
+{
+	for (int i = 0; i < WAIT_MS / 10; i++) {
+		if (count_packets(to, OBS_ENCODER_VIDEO, 0) >= video && count_packets(to, OBS_ENCODER_VIDEO, 1) >= video &&
+		    count_packets(to, OBS_ENCODER_AUDIO, 0) >= audio)
+			return true;
+		os_sleep_ms(10);
+	}
+
+	return false;
+}
+
+static bool wait_for_stop(obs_output_t *output)
+{
+	for (int i = 0; i < WAIT_MS / 10; i++) {
+		if (!obs_output_active(output))
+			return true;
+		os_sleep_ms(10);
+	}
+
+	return false;
+}
+
+static const struct received_packet *first_packet(struct test_output *to, enum obs_encoder_type type,
+						   size_t track_idx)
+{
+	for (size_t i = 0; i < to->packets.num; i++) {
+		struct received_packet *rp = &to->packets.array[i];
+		if (rp->type == type && rp->track_idx == track_idx)
+			return rp;
+	}
+
+	return NULL;
+}
+
+static void check_interleaved(struct test_output *to)
+{
+	for (size_t i = 1; i < to->packets.num; i++)
+		assert_true(to->packets.array[i].dts_usec >= to->packets.array[i - 1].dts_usec);
+}
+
+static obs_encoder_t *create_encoder(bool video, const char *name, int64_t keyint)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_encoder_t *encoder;
+
+	obs_data_set_int(settings, "keyint", keyint);
+
+	if (video) {
+		encoder = obs_video_encoder_create(video_encoder.id, name, settings, NULL);
+		obs_encoder_set_video(encoder, obs_get_video());
+	} else {
+		encoder = obs_audio_encoder_create(audio_encoder.id, name, settings, 0, NULL);
+		obs_encoder_set_audio(encoder, obs_get_audio());
+	}
+
+	obs_data_release(settings);
+	assert_non_null(encoder);
+	return encoder;
+}
+
+static obs_output_t *create_output(const char *name, obs_encoder_t *video0, obs_encoder_t *video1,
+				   obs_encoder_t *audio)
+{
+	obs_output_t *output = obs_output_create(test_output_info.id, name, NULL, NULL);
+
+	assert_non_null(output);
+	obs_output_set_video_encoder2(output, video0, 0);
+	obs_output_set_video_encoder2(output, video1, 1);
+	obs_output_set_audio_encoder(output, audio, 0);
+	return output;
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_video_info ovi = {
+		.graphics_module = NULL_GRAPHICS_MODULE,
+		.fps_num = FPS,
+		.fps_den = 1,
+		.base_width = 32,
+		.base_height = 16,
+		.output_width = 32,
+		.output_height = 16,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_POINT,
+	};
+	struct obs_audio_info oai = {
+		.samples_per_sec = SAMPLE_RATE,
+		.speakers = SPEAKERS_STEREO,
+	};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	PRAGMA_WARN_PUSH
+	PRAGMA_DISABLE_DEPRECATION
+	obs_add_data_path(LIBOBS_DATA_PATH);
+	PRAGMA_WARN_POP
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS || !obs_reset_audio(&oai))
+		return -1;
+
+	obs_register_encoder(&video_encoder);
+	obs_register_encoder(&audio_encoder);
+	obs_register_output(&test_output_info);
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_shutdown();
+	return 0;
+}
+
+static void join_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_encoder_t *video0 = create_encoder(true, "video 0", KEYINT_0);
+	obs_encoder_t *video1 = create_encoder(true, "video 1", KEYINT_1);
+	obs_encoder_t *audio = create_encoder(false, "audio", 0);
+	obs_output_t *first = create_output("first", video0, video1, audio);
+	obs_output_t *second = create_output("second", video0, video1, audio);
+	struct test_output *a = obs_obj_get_data(first);
+	struct test_output *b = obs_obj_get_data(second);
+
+	/* the second output joins while the shared encoders are running */
+	assert_true(obs_output_start(first));
+	assert_true(wait_for_packets(a, 3 * KEYINT_0, 10));
+
+	assert_true(obs_output_start(second));
+	assert_true(wait_for_packets(b, 3 * KEYINT_0, 10));
+
+	obs_output_stop(second);
+	obs_output_stop(first);
+	assert_true(wait_for_stop(second));
+	assert_true(wait_for_stop(first));
+
+	pthread_mutex_lock(&a->mutex);
+	pthread_mutex_lock(&b->mutex);
+
+	/* the first output doesn't notice: it keeps getting every frame */
+	int64_t last_pts = -1;
+	for (size_t i = 0; i < a->packets.num; i++) {
+		struct received_packet *rp = &a->packets.array[i];
+		if (rp->type != OBS_ENCODER_VIDEO || rp->track_idx != 0)
+			continue;
+		if (last_pts != -1)
+			assert_int_equal(rp->pts, last_pts + 1);
+		last_pts = rp->pts;
+	}
+	check_interleaved(a);
+
+	/* the second output starts at a keyframe of the first video track,
+	 * which becomes its time 0 */
+	const struct received_packet *v0 = first_packet(b, OBS_ENCODER_VIDEO, 0);
+	assert_non_null(v0);
+	assert_true(v0->keyframe);
+	assert_int_equal(v0->pts, 0);
+	assert_int_equal(v0->dts_usec, 0);
+
+	/* the second video track waits for a keyframe of its own */
+	const struct received_packet *v1 = first_packet(b, OBS_ENCODER_VIDEO, 1);
+	assert_non_null(v1);
+	assert_true(v1->keyframe);
+	assert_true(v1->dts_usec >= 0);
+
+	/* audio from before the join point is cut, and nothing after it */
+	const struct received_packet *a0 = first_packet(b, OBS_ENCODER_AUDIO, 0);
+	assert_non_null(a0);
+	assert_true(a0->dts_usec >= 0);
+	assert_true(a0->dts_usec < AUDIO_FRAME_USEC);
+	check_interleaved(b);
+
+	pthread_mutex_unlock(&b->mutex);
+	pthread_mutex_unlock(&a->mutex);
+
+	obs_output_release(second);
+	obs_output_release(first);
+	obs_encoder_release(audio);
+	obs_encoder_release(video1);
+	obs_encoder_release(video0);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(join_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
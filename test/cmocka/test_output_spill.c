@@ -0,0 +1,258 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+
+#include <obs-output-spill.h>
+
+#define SPILL_FILES TEST_DIR "/obs-delay-*.bin"
+#define PACKET_SIZE (64 * 1024)
+
+/* more than both queues hold, so most of it has to go to disk */
+#define NUM_PACKETS (3 * 2 * DELAY_SPILL_QUEUE_SIZE / PACKET_SIZE)
+
+/* packets taken straight into the read queue before anything is written */
+#define NUM_READY (DELAY_SPILL_QUEUE_SIZE / PACKET_SIZE)
+
+static inline uint8_t pattern(size_t pos, size_t seed)
+{
+	return (uint8_t)(pos * 31 + (pos >> 8) + seed * 7);
+}
+
+static inline size_t packet_size(size_t i)
+{
+	return PACKET_SIZE / 2 + i * 4099 % PACKET_SIZE;
+}
+
+static void make_packet(struct encoder_packet *packet, size_t size, size_t seed)
+{
+	long *p_refs = bmalloc(sizeof(long) + size);
+
+	*p_refs = 1;
+	memset(packet, 0, sizeof(*packet));
+	packet->data = (uint8_t *)(p_refs + 1);
+	packet->size = size;
+
+	for (size_t i = 0; i < size; i++)
+		packet->data[i] = pattern(i, seed);
+}
+
+static bool check_packet(const struct encoder_packet *packet, size_t seed)
+{
+	for (size_t i = 0; i < packet->size; i++) {
+		if (packet->data[i] != pattern(i, seed))
+			return false;
+	}
+	return true;
+}
+
+/* the spill thread may be behind for a moment */
+static bool push_wait(struct delay_spill *spill, size_t size, size_t seed)
+{
+	struct encoder_packet packet;
+	bool success = false;
+
+	make_packet(&packet, size, seed);
+
+	for (int i = 0; i < 5000 && !success; i++) {
+		success = delay_spill_push(spill, &packet);
+		if (!success)
+			os_sleep_ms(1);
+	}
+
+	obs_encoder_packet_release(&packet);
+	return success;
+}
+
+static enum delay_spill_result pop_wait(struct delay_spill *spill, struct encoder_packet *packet, size_t size)
+{
+	enum delay_spill_result result = DELAY_SPILL_WAIT;
+
+	memset(packet, 0, sizeof(*packet));
+	packet->size = size;
+
+	for (int i = 0; i < 5000 && result == DELAY_SPILL_WAIT; i++) {
+		result = delay_spill_pop(spill, packet);
+		if (result == DELAY_SPILL_WAIT)
+			os_sleep_ms(1);
+	}
+
+	return result;
+}
+
+static void pop_check(struct delay_spill *spill, size_t size, size_t seed)
+{
+	struct encoder_packet packet;
+
+	assert_int_equal(pop_wait(spill, &packet, size), DELAY_SPILL_READY);
+	assert_true(check_packet(&packet, seed));
+	obs_encoder_packet_release(&packet);
+}
+
+static size_t count_spill_files(uint64_t *total_size)
+{
+	os_glob_t *glob;
+	size_t count = 0;
+
+	if (total_size)
+		*total_size = 0;
+
+	if (os_glob(SPILL_FILES, 0, &glob) != 0)
+		return 0;
+
+	for (size_t i = 0; i < glob->gl_pathc; i++) {
+		if (total_size)
+			*total_size += (uint64_t)os_get_file_size(glob->gl_pathv[i].path);
+		count++;
+	}
+
+	os_globfree(glob);
+	return count;
+}
+
+/* waits until the thread wrote everything that doesn't go to the read queue */
+static void wait_for_writes(uint64_t expected)
+{
+	uint64_t size = 0;
+
+	for (int i = 0; i < 5000; i++) {
+		count_spill_files(&size);
+		if (size == expected)
+			break;
+		os_sleep_ms(1);
+	}
+
+	assert_int_equal(size, expected);
+}
+
+static void round_trip_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct delay_spill *spill = delay_spill_create(TEST_DIR, "round trip");
+	assert_non_null(spill);
+
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+		assert_true(push_wait(spill, packet_size(i), i));
+
+	/* nothing is lost or reordered on the way through the disk */
+	assert_true(count_spill_files(NULL) > 0);
+
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+		pop_check(spill, packet_size(i), i);
+
+	assert_false(delay_spill_write_failed(spill));
+	delay_spill_destroy(spill);
+	assert_int_equal(count_spill_files(NULL), 0);
+}
+
+static void delay_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct delay_spill *spill = delay_spill_create(TEST_DIR, "delay");
+	const size_t lag = NUM_PACKETS / 2;
+
+	assert_non_null(spill);
+
+	/* packets come back out a fixed number of packets later, like with an
+	 * output delay, while new ones keep going in */
+	for (size_t i = 0; i < NUM_PACKETS * 2; i++) {
+		assert_true(push_wait(spill, packet_size(i), i));
+		if (i >= lag)
+			pop_check(spill, packet_size(i - lag), i - lag);
+	}
+
+	/* packets still in the store are released with it */
+	delay_spill_destroy(spill);
+	assert_int_equal(count_spill_files(NULL), 0);
+}
+
+static void write_failure_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct delay_spill *spill = delay_spill_create(TEST_DIR "/does-not-exist", "write failure");
+	struct encoder_packet packet;
+	size_t pushed = 0;
+
+	assert_non_null(spill);
+
+	/* once the read queue is full, the thread tries to write and fails,
+	 * and pushing fails from then on instead of blocking */
+	make_packet(&packet, PACKET_SIZE, 0);
+	for (int i = 0; i < 5000 && !delay_spill_write_failed(spill); i++) {
+		if (delay_spill_push(spill, &packet))
+			pushed++;
+		else
+			os_sleep_ms(1);
+	}
+	obs_encoder_packet_release(&packet);
+
+	assert_true(delay_spill_write_failed(spill));
+	assert_true(pushed > NUM_READY);
+
+	make_packet(&packet, PACKET_SIZE, 0);
+	assert_false(delay_spill_push(spill, &packet));
+	obs_encoder_packet_release(&packet);
+
+	/* what it took is still returned from memory */
+	for (size_t i = 0; i < pushed; i++)
+		pop_check(spill, PACKET_SIZE, 0);
+
+	assert_int_equal(delay_spill_pop(spill, &packet), DELAY_SPILL_ERROR);
+	delay_spill_destroy(spill);
+}
+
+static void read_failure_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct delay_spill *spill = delay_spill_create(TEST_DIR, "read failure");
+	struct encoder_packet packet;
+	os_glob_t *glob;
+
+	assert_non_null(spill);
+
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+		assert_true(push_wait(spill, PACKET_SIZE, i));
+
+	wait_for_writes((uint64_t)(NUM_PACKETS - NUM_READY) * PACKET_SIZE);
+
+	assert_int_equal(os_glob(SPILL_FILES, 0, &glob), 0);
+	for (size_t i = 0; i < glob->gl_pathc; i++) {
+		FILE *file = os_fopen(glob->gl_pathv[i].path, "wb");
+		assert_non_null(file);
+		fclose(file);
+	}
+	os_globfree(glob);
+
+	/* the packets read ahead are fine, the rest are reported as lost one
+	 * by one instead of coming back with made up data */
+	for (size_t i = 0; i < NUM_READY; i++)
+		pop_check(spill, PACKET_SIZE, i);
+
+	for (size_t i = NUM_READY; i < NUM_PACKETS; i++) {
+		assert_int_equal(pop_wait(spill, &packet, PACKET_SIZE), DELAY_SPILL_ERROR);
+		assert_null(packet.data);
+	}
+
+	delay_spill_destroy(spill);
+	assert_int_equal(count_spill_files(NULL), 0);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(round_trip_test),
+		cmocka_unit_test(delay_test),
+		cmocka_unit_test(write_failure_test),
+		cmocka_unit_test(read_failure_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,155 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/threading.h>
+#include <obs.h>
+#include <obs-packet-pool.h>
+
+#define NUM_THREAD_PACKETS 256
+
+/* the way encoders allocate packet data */
+static struct encoder_packet pool_packet(size_t size)
+{
+	struct encoder_packet packet = {0};
+	long *p_refs = packet_pool_alloc(size);
+
+	packet.data = (uint8_t *)(p_refs + 1);
+	packet.size = size;
+	return packet;
+}
+
+static long packet_refs(const struct encoder_packet *packet)
+{
+	return ((long *)packet->data)[-1];
+}
+
+static void reuse_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_encoder_packet_pool_stats before, after;
+	struct encoder_packet first, second, extra;
+	uint8_t *first_data;
+
+	obs_encoder_packet_pool_get_stats(&before);
+
+	first = pool_packet(3000);
+	first_data = first.data;
+	memset(first.data, 0xAB, first.size);
+	obs_encoder_packet_release(&first);
+
+	/* a slightly smaller packet fits into the same block */
+	second = pool_packet(2900);
+	assert_ptr_equal(second.data, first_data);
+
+	/* extra references keep the block alive */
+	obs_encoder_packet_ref(&extra, &second);
+	obs_encoder_packet_release(&second);
+	memset(extra.data, 0xCD, extra.size);
+	obs_encoder_packet_release(&extra);
+
+	obs_encoder_packet_pool_get_stats(&after);
+	assert_int_equal(after.misses - before.misses, 1);
+	assert_int_equal(after.hits - before.hits, 1);
+	assert_int_equal(after.bytes_in_use, 0);
+	assert_true(after.bytes_held >= 3000);
+
+	packet_pool_trim();
+}
+
+static void size_classes_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const size_t sizes[] = {0, 1, 200, 231, 232, 233, 1000, 65536, 1000000, 4194000, 4194304, 9000000};
+	struct encoder_packet packets[sizeof(sizes) / sizeof(sizes[0])];
+	struct obs_encoder_packet_pool_stats stats;
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		packets[i] = pool_packet(sizes[i]);
+		memset(packets[i].data, (int)i, sizes[i]);
+	}
+
+	/* too large for the pool, so released with bfree */
+	assert_int_equal(packet_refs(&packets[11]), 1);
+	assert_int_equal(packet_refs(&packets[0]), PACKET_POOL_REFS + 1);
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		obs_encoder_packet_release(&packets[i]);
+
+	obs_encoder_packet_pool_get_stats(&stats);
+	assert_int_equal(stats.bytes_in_use, 0);
+
+	packet_pool_trim();
+	obs_encoder_packet_pool_get_stats(&stats);
+	assert_int_equal(stats.bytes_held, 0);
+}
+
+static void *alloc_thread(void *data)
+{
+	struct encoder_packet *packets = data;
+
+	for (size_t i = 0; i < NUM_THREAD_PACKETS; i++)
+		packets[i] = pool_packet(10000 + i * 100);
+
+	return NULL;
+}
+
+static void *release_thread(void *data)
+{
+	struct encoder_packet *packets = data;
+
+	for (size_t i = 0; i < NUM_THREAD_PACKETS; i++)
+		obs_encoder_packet_release(&packets[i]);
+
+	return NULL;
+}
+
+/* packets are usually allocated on encoder threads and released on output
+ * threads */
+static void cross_thread_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_packet packets[NUM_THREAD_PACKETS];
+	struct obs_encoder_packet_pool_stats before, after;
+	long allocs = bnum_allocs();
+	pthread_t thread;
+
+	obs_encoder_packet_pool_get_stats(&before);
+
+	assert_int_equal(pthread_create(&thread, NULL, alloc_thread, packets), 0);
+	pthread_join(thread, NULL);
+	assert_int_equal(pthread_create(&thread, NULL, release_thread, packets), 0);
+	pthread_join(thread, NULL);
+
+	/* both threads exited, so their caches went back to the shared lists */
+	alloc_thread(packets);
+
+	obs_encoder_packet_pool_get_stats(&after);
+	assert_int_equal(after.misses - before.misses, NUM_THREAD_PACKETS);
+	assert_int_equal(after.hits - before.hits, NUM_THREAD_PACKETS);
+
+	release_thread(packets);
+
+	obs_encoder_packet_pool_get_stats(&after);
+	assert_int_equal(after.bytes_in_use, 0);
+
+	packet_pool_trim();
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(reuse_test),
+		cmocka_unit_test(size_classes_test),
+		cmocka_unit_test(cross_thread_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,278 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+
+#include "obs-ffmpeg-replay-ring.h"
+
+#define RING_SIZE 4096
+
+/* each packet is stored behind a reference count, aligned to 8 bytes */
+#define STORED(size) ((sizeof(long) + (size) + 7) & ~(size_t)7)
+#define PKT_SIZE (1024 - sizeof(long))
+
+static void fill(uint8_t *data, size_t size, uint8_t seed)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)(i + seed);
+}
+
+static bool check(const uint8_t *data, size_t size, uint8_t seed)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] != (uint8_t)(i + seed))
+			return false;
+	}
+	return true;
+}
+
+static void create_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct replay_ring *ring = replay_ring_create(RING_DIR, RING_SIZE);
+	assert_non_null(ring);
+	assert_int_equal(replay_ring_size(ring), RING_SIZE);
+
+	/* an extra reference keeps the file mapped */
+	replay_ring_addref(ring);
+	replay_ring_release(ring);
+	assert_int_equal(replay_ring_size(ring), RING_SIZE);
+	replay_ring_release(ring);
+
+	assert_null(replay_ring_create(RING_DIR "/does-not-exist", RING_SIZE));
+	replay_ring_release(NULL);
+}
+
+static void push_pop_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct replay_ring *ring = replay_ring_create(RING_DIR, RING_SIZE);
+	uint8_t buf[PKT_SIZE];
+	uint8_t *stored[4];
+
+	assert_non_null(ring);
+
+	/* four packets fill the ring exactly */
+	for (int i = 0; i < 4; i++) {
+		fill(buf, sizeof(buf), (uint8_t)i);
+		stored[i] = replay_ring_push(ring, buf, sizeof(buf));
+		assert_non_null(stored[i]);
+	}
+	assert_null(replay_ring_push(ring, buf, 1));
+
+	for (int i = 0; i < 4; i++)
+		assert_true(check(stored[i], sizeof(buf), (uint8_t)i));
+
+	/* dropping the oldest packet makes room for exactly as much, and the
+	 * next packet goes where it was */
+	replay_ring_pop(ring);
+	assert_null(replay_ring_push(ring, buf, sizeof(buf) + 1));
+
+	fill(buf, sizeof(buf), 4);
+	assert_ptr_equal(replay_ring_push(ring, buf, sizeof(buf)), stored[0]);
+	assert_true(check(stored[0], sizeof(buf), 4));
+	assert_true(check(stored[1], sizeof(buf), 1));
+
+	/* popping an empty ring is harmless, and a packet as large as the
+	 * whole ring fits once everything is gone */
+	for (int i = 0; i < 6; i++)
+		replay_ring_pop(ring);
+
+	const size_t big_size = RING_SIZE - sizeof(long);
+	assert_true(replay_ring_can_store(ring, big_size));
+	assert_false(replay_ring_can_store(ring, big_size + 1));
+
+	uint8_t *big = bmalloc(big_size);
+	fill(big, big_size, 9);
+	uint8_t *data = replay_ring_push(ring, big, big_size);
+	assert_non_null(data);
+	assert_true(check(data, big_size, 9));
+	bfree(big);
+
+	replay_ring_release(ring);
+}
+
+static void wraparound_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct replay_ring *ring = replay_ring_create(RING_DIR, RING_SIZE);
+	uint8_t buf[1500];
+	uint8_t *first, *second, *third;
+
+	assert_non_null(ring);
+
+	fill(buf, sizeof(buf), 1);
+	first = replay_ring_push(ring, buf, sizeof(buf));
+	fill(buf, sizeof(buf), 2);
+	second = replay_ring_push(ring, buf, sizeof(buf));
+	assert_non_null(first);
+	assert_ptr_equal(second, first + STORED(sizeof(buf)));
+
+	/* only about 1 kB is left before the end of the file, and packets are
+	 * never split, so the third one has to wait for the first to go */
+	fill(buf, sizeof(buf), 3);
+	assert_null(replay_ring_push(ring, buf, sizeof(buf)));
+
+	replay_ring_pop(ring);
+	third = replay_ring_push(ring, buf, sizeof(buf));
+	assert_ptr_equal(third, first);
+	assert_true(check(second, sizeof(buf), 2));
+	assert_true(check(third, sizeof(buf), 3));
+
+	/* the skipped space at the end counts as used until the packet after
+	 * it is dropped */
+	replay_ring_pop(ring);
+	fill(buf, sizeof(buf), 4);
+	uint8_t *fourth = replay_ring_push(ring, buf, sizeof(buf));
+	assert_ptr_equal(fourth, third + STORED(sizeof(buf)));
+	assert_null(replay_ring_push(ring, buf, sizeof(buf)));
+
+	/* keep going around a few times with sizes that don't divide the
+	 * ring, checking that nothing stored gets overwritten */
+	replay_ring_pop(ring);
+	replay_ring_pop(ring);
+
+	uint8_t *live[64] = {0};
+	size_t sizes[64] = {0};
+	size_t head = 0, tail = 0;
+
+	for (size_t i = 0; i < 500; i++) {
+		size_t size = 100 + i * 37 % 900;
+		uint8_t *data;
+
+		fill(buf, size, (uint8_t)i);
+		while (!(data = replay_ring_push(ring, buf, size))) {
+			assert_true(head < tail);
+			replay_ring_pop(ring);
+			head++;
+		}
+
+		assert_true(tail - head < 64);
+		assert_true(data >= first && data + size <= first - sizeof(long) + RING_SIZE);
+
+		live[tail % 64] = data;
+		sizes[tail % 64] = size;
+		tail++;
+
+		for (size_t j = head; j < tail; j++)
+			assert_true(check(live[j % 64], sizes[j % 64], (uint8_t)j));
+	}
+
+	replay_ring_release(ring);
+}
+
+static void pin_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct replay_ring *ring = replay_ring_create(RING_DIR, RING_SIZE);
+	uint8_t buf[PKT_SIZE];
+	uint8_t *stored[4];
+
+	assert_non_null(ring);
+
+	for (int i = 0; i < 3; i++) {
+		fill(buf, sizeof(buf), (uint8_t)i);
+		stored[i] = replay_ring_push(ring, buf, sizeof(buf));
+	}
+
+	/* a save pins everything from the oldest packet on */
+	replay_ring_pin(ring);
+	assert_true(replay_ring_pinned(ring));
+
+	/* popping the saved packets doesn't free their data while pinned */
+	replay_ring_pop(ring);
+	replay_ring_pop(ring);
+
+	fill(buf, sizeof(buf), 3);
+	stored[3] = replay_ring_push(ring, buf, sizeof(buf));
+	assert_non_null(stored[3]);
+	assert_null(replay_ring_push(ring, buf, sizeof(buf)));
+
+	for (int i = 0; i < 4; i++)
+		assert_true(check(stored[i], sizeof(buf), (uint8_t)i));
+
+	/* once the save is done, only the packets still queued are kept */
+	replay_ring_unpin(ring);
+	assert_false(replay_ring_pinned(ring));
+
+	fill(buf, sizeof(buf), 4);
+	assert_ptr_equal(replay_ring_push(ring, buf, sizeof(buf)), stored[0]);
+	fill(buf, sizeof(buf), 5);
+	assert_ptr_equal(replay_ring_push(ring, buf, sizeof(buf)), stored[1]);
+	assert_null(replay_ring_push(ring, buf, sizeof(buf)));
+	assert_true(check(stored[2], sizeof(buf), 2));
+	assert_true(check(stored[3], sizeof(buf), 3));
+
+	/* pinning an empty ring pins nothing */
+	for (int i = 0; i < 4; i++)
+		replay_ring_pop(ring);
+
+	replay_ring_pin(ring);
+	fill(buf, sizeof(buf), 6);
+	for (int i = 0; i < 4; i++)
+		assert_non_null(replay_ring_push(ring, buf, sizeof(buf)));
+	assert_null(replay_ring_push(ring, buf, 1));
+	replay_ring_unpin(ring);
+
+	replay_ring_release(ring);
+}
+
+static void packet_ref_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct replay_ring *ring = replay_ring_create(RING_DIR, RING_SIZE);
+	uint8_t buf[PKT_SIZE];
+
+	assert_non_null(ring);
+
+	/* a save references the stored data like any encoder packet, and
+	 * releasing the last reference leaves it where it is */
+	fill(buf, sizeof(buf), 7);
+	struct encoder_packet stored = {.data = replay_ring_push(ring, buf, sizeof(buf)), .size = sizeof(buf)};
+	struct encoder_packet refs[3];
+
+	replay_ring_pin(ring);
+	for (int i = 0; i < 3; i++)
+		obs_encoder_packet_ref(&refs[i], &stored);
+	for (int i = 0; i < 3; i++)
+		obs_encoder_packet_release(&refs[i]);
+	replay_ring_unpin(ring);
+
+	assert_true(check(stored.data, sizeof(buf), 7));
+
+	/* and the count is reset when the space is reused */
+	for (int i = 0; i < 3; i++) {
+		replay_ring_pop(ring);
+		fill(buf, sizeof(buf), (uint8_t)i);
+		stored.data = replay_ring_push(ring, buf, sizeof(buf));
+		assert_non_null(stored.data);
+
+		obs_encoder_packet_ref(&refs[0], &stored);
+		obs_encoder_packet_release(&refs[0]);
+		assert_true(check(stored.data, sizeof(buf), (uint8_t)i));
+	}
+
+	replay_ring_release(ring);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(create_test),
+		cmocka_unit_test(push_pop_test),
+		cmocka_unit_test(wraparound_test),
+		cmocka_unit_test(pin_test),
+		cmocka_unit_test(packet_ref_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,265 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/darray.h>
+
+#include "librtmp/rtmp.h"
+
+struct capture {
+	DARRAY(char) bytes;
+	int calls;
+};
+
+struct test_packet {
+	int channel;
+	uint8_t type;
+	uint32_t timestamp;
+	uint32_t size;
+};
+
+/* covers every header type, two and three byte chunk basic headers,
+ * extended timestamps and bodies spanning several chunks */
+static const struct test_packet packets[] = {
+	{0x04, RTMP_PACKET_TYPE_VIDEO, 0, 300},
+	{0x04, RTMP_PACKET_TYPE_VIDEO, 33, 300},
+	{0x04, RTMP_PACKET_TYPE_VIDEO, 66, 300},
+	{0x04, RTMP_PACKET_TYPE_AUDIO, 70, 50},
+	{0x04, RTMP_PACKET_TYPE_VIDEO, 99, 1},
+	{100, RTMP_PACKET_TYPE_VIDEO, 100, 200},
+	{100, RTMP_PACKET_TYPE_VIDEO, 133, 128},
+	{400, RTMP_PACKET_TYPE_VIDEO, 0x1000000, 400},
+	{400, RTMP_PACKET_TYPE_VIDEO, 0x1000021, 400},
+	{400, RTMP_PACKET_TYPE_VIDEO, 0x1000042, 400},
+	{0x04, RTMP_PACKET_TYPE_VIDEO, 0x2000000, 5000},
+	{0x04, RTMP_PACKET_TYPE_AUDIO, 0x2000010, 256},
+};
+
+#define NUM_PACKETS (sizeof(packets) / sizeof(packets[0]))
+
+/* splits of the body, the last piece takes whatever is left */
+static const int splits[] = {0, 1, 7, 130, 0, 64};
+
+#define NUM_SPLITS (sizeof(splits) / sizeof(splits[0]))
+
+static int capture_send(RTMPSockBuf *sb, const char *buf, int len, void *param)
+{
+	struct capture *cap = param;
+	UNUSED_PARAMETER(sb);
+
+	da_push_back_array(cap->bytes, buf, len);
+	cap->calls++;
+	return len;
+}
+
+static int capture_sendv(RTMPSockBuf *sb, const RTMPIoVec *vec, int count, void *param)
+{
+	struct capture *cap = param;
+	int total = 0;
+	UNUSED_PARAMETER(sb);
+
+	for (int i = 0; i < count; i++) {
+		da_push_back_array(cap->bytes, vec[i].data, vec[i].len);
+		total += vec[i].len;
+	}
+
+	cap->calls++;
+	return total;
+}
+
+static void init_rtmp(RTMP *r, struct capture *cap, bool vectored, int chunk_size)
+{
+	RTMP_Init(r);
+	r->m_outChunkSize = chunk_size;
+	r->Link.nStreams = 1;
+	r->Link.streams[0].id = 1;
+	r->m_bCustomSend = 1;
+	r->m_customSendParam = cap;
+	r->m_customSendFunc = capture_send;
+	if (vectored)
+		r->m_customSendVFunc = capture_sendv;
+}
+
+static void fill_body(char *body, uint32_t size, size_t seed)
+{
+	for (uint32_t i = 0; i < size; i++)
+		body[i] = (char)(i * 7 + seed * 13);
+}
+
+static int split_body(RTMPIoVec *vec, const char *body, uint32_t size)
+{
+	uint32_t offset = 0;
+	int count = 0;
+
+	for (size_t i = 0; i < NUM_SPLITS && offset < size; i++) {
+		uint32_t len = (uint32_t)splits[i];
+		if (len > size - offset)
+			len = size - offset;
+
+		vec[count].data = body + offset;
+		vec[count++].len = (int)len;
+		offset += len;
+	}
+
+	vec[count].data = body + offset;
+	vec[count++].len = (int)(size - offset);
+	return count;
+}
+
+static void check_same_bytes(struct capture *expected, struct capture *actual)
+{
+	assert_int_equal(actual->bytes.num, expected->bytes.num);
+	assert_memory_equal(actual->bytes.array, expected->bytes.array, expected->bytes.num);
+}
+
+static void free_capture(struct capture *cap)
+{
+	da_free(cap->bytes);
+}
+
+static void send_packets(int chunk_size, bool vectored)
+{
+	struct capture expected = {0};
+	struct capture actual = {0};
+	RTMP ref, vec;
+
+	init_rtmp(&ref, &expected, false, chunk_size);
+	init_rtmp(&vec, &actual, vectored, chunk_size);
+
+	for (size_t i = 0; i < NUM_PACKETS; i++) {
+		const struct test_packet *tp = &packets[i];
+		RTMPIoVec body[NUM_SPLITS + 1];
+		RTMPPacket p1 = {0}, p2 = {0};
+		int count;
+
+		assert_true(RTMPPacket_Alloc(&p1, tp->size));
+		fill_body(p1.m_body, tp->size, i);
+
+		p1.m_nChannel = tp->channel;
+		p1.m_packetType = tp->type;
+		p1.m_nTimeStamp = tp->timestamp;
+		p1.m_nBodySize = tp->size;
+		p1.m_nInfoField2 = 1;
+		p1.m_headerType = (i == 0 || tp->channel != packets[i - 1].channel) ? RTMP_PACKET_SIZE_LARGE
+										     : RTMP_PACKET_SIZE_MEDIUM;
+
+		p2 = p1;
+		p2.m_body = NULL;
+		count = split_body(body, p1.m_body, tp->size);
+
+		/* the reference send writes chunk headers into the body in
+		 * place, so the vectored send goes first */
+		assert_true(RTMP_SendPacketV(&vec, &p2, body, count));
+		assert_true(RTMP_SendPacket(&ref, &p1, false));
+		assert_int_equal(p2.m_headerType, p1.m_headerType);
+
+		RTMPPacket_Free(&p1);
+	}
+
+	check_same_bytes(&expected, &actual);
+
+	/* one queue call per message unless it has more pieces than a single
+	 * WriteV takes */
+	if (vectored)
+		assert_true(actual.calls >= (int)NUM_PACKETS && actual.calls < expected.calls);
+
+	RTMP_Close(&ref);
+	RTMP_Close(&vec);
+	free_capture(&expected);
+	free_capture(&actual);
+}
+
+static void send_packet_v_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	send_packets(RTMP_DEFAULT_CHUNKSIZE, false);
+	send_packets(4096, false);
+}
+
+static void send_packet_v_custom_sendv_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	send_packets(RTMP_DEFAULT_CHUNKSIZE, true);
+	send_packets(4096, true);
+}
+
+static size_t make_flv_tag(char *tag, const struct test_packet *tp, size_t seed)
+{
+	uint32_t tag_size = 11 + tp->size;
+
+	tag[0] = (char)tp->type;
+	tag[1] = (char)(tp->size >> 16);
+	tag[2] = (char)(tp->size >> 8);
+	tag[3] = (char)tp->size;
+	tag[4] = (char)(tp->timestamp >> 16);
+	tag[5] = (char)(tp->timestamp >> 8);
+	tag[6] = (char)tp->timestamp;
+	tag[7] = (char)(tp->timestamp >> 24);
+	tag[8] = tag[9] = tag[10] = 0;
+	fill_body(tag + 11, tp->size, seed);
+
+	tag[tag_size + 0] = (char)(tag_size >> 24);
+	tag[tag_size + 1] = (char)(tag_size >> 16);
+	tag[tag_size + 2] = (char)(tag_size >> 8);
+	tag[tag_size + 3] = (char)tag_size;
+	return tag_size + 4;
+}
+
+static void write_tags(bool vectored)
+{
+	struct capture expected = {0};
+	struct capture actual = {0};
+	RTMP ref, vec;
+
+	init_rtmp(&ref, &expected, false, RTMP_DEFAULT_CHUNKSIZE);
+	init_rtmp(&vec, &actual, vectored, RTMP_DEFAULT_CHUNKSIZE);
+
+	for (size_t i = 0; i < NUM_PACKETS; i++) {
+		const struct test_packet *tp = &packets[i];
+		char *tag = bmalloc(tp->size + 15);
+		size_t size = make_flv_tag(tag, tp, i);
+		RTMPIoVec pieces[NUM_SPLITS + 2];
+		int count;
+
+		/* the first piece has to hold the whole tag header, the
+		 * previous tag size trails the last piece */
+		pieces[0].data = tag;
+		pieces[0].len = 11;
+		count = 1 + split_body(pieces + 1, tag + 11, tp->size + 4);
+
+		assert_int_equal(RTMP_WriteV(&vec, pieces, count, 0), (int)size);
+		assert_int_equal(RTMP_Write(&ref, tag, (int)size, 0), (int)size);
+
+		bfree(tag);
+	}
+
+	check_same_bytes(&expected, &actual);
+
+	RTMP_Close(&ref);
+	RTMP_Close(&vec);
+	free_capture(&expected);
+	free_capture(&actual);
+}
+
+static void write_v_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	write_tags(false);
+	write_tags(true);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(send_packet_v_test),
+		cmocka_unit_test(send_packet_v_custom_sendv_test),
+		cmocka_unit_test(write_v_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
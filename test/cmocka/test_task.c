@@ -0,0 +1,160 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/task.h>
+
+#define NUM_ITEMS 1000
+
+struct work_data {
+	volatile long hits[NUM_ITEMS];
+	volatile long total;
+	volatile long in_flight;
+	volatile long max_in_flight;
+	uint32_t sleep_ms;
+};
+
+static void count_work(void *param, size_t idx)
+{
+	struct work_data *data = param;
+	long cur = os_atomic_inc_long(&data->in_flight);
+	long max;
+
+	while ((max = os_atomic_load_long(&data->max_in_flight)) < cur) {
+		if (os_atomic_compare_swap_long(&data->max_in_flight, max, cur))
+			break;
+	}
+
+	if (data->sleep_ms)
+		os_sleep_ms(data->sleep_ms);
+
+	os_atomic_inc_long(&data->hits[idx]);
+	os_atomic_inc_long(&data->total);
+	os_atomic_dec_long(&data->in_flight);
+}
+
+static void check_all_hit_once(struct work_data *data, size_t count)
+{
+	assert_int_equal(os_atomic_load_long(&data->total), count);
+	for (size_t i = 0; i < count; i++)
+		assert_int_equal(os_atomic_load_long(&data->hits[i]), 1);
+	for (size_t i = count; i < NUM_ITEMS; i++)
+		assert_int_equal(os_atomic_load_long(&data->hits[i]), 0);
+}
+
+static void fork_join_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_work_pool_t *pool = os_work_pool_create(4);
+	assert_non_null(pool);
+	assert_int_equal(os_work_pool_num_threads(pool), 4);
+
+	/* every item runs exactly once, and all of them have finished by the
+	 * time os_work_pool_run returns, for batches both smaller and larger
+	 * than the pool */
+	const size_t counts[] = {1, 2, 3, 5, 64, NUM_ITEMS};
+	for (size_t run = 0; run < 50; run++) {
+		for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+			struct work_data *data = bzalloc(sizeof(*data));
+
+			os_work_pool_run(pool, count_work, data, counts[i]);
+			check_all_hit_once(data, counts[i]);
+			assert_int_equal(os_atomic_load_long(&data->in_flight), 0);
+			bfree(data);
+		}
+	}
+
+	os_work_pool_destroy(pool);
+}
+
+static void join_waits_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_work_pool_t *pool = os_work_pool_create(3);
+	struct work_data *data = bzalloc(sizeof(*data));
+
+	/* slow items make sure the caller actually waits on the workers
+	 * instead of returning once its own share is done, and that the
+	 * items are spread out over the worker threads */
+	data->sleep_ms = 20;
+	os_work_pool_run(pool, count_work, data, 8);
+	check_all_hit_once(data, 8);
+	assert_int_equal(os_atomic_load_long(&data->in_flight), 0);
+	assert_true(os_atomic_load_long(&data->max_in_flight) > 1);
+	assert_true(os_atomic_load_long(&data->max_in_flight) <= 4);
+
+	/* empty batches return without calling anything */
+	os_work_pool_run(pool, count_work, data, 0);
+	assert_int_equal(os_atomic_load_long(&data->total), 8);
+
+	bfree(data);
+	os_work_pool_destroy(pool);
+}
+
+static void serial_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct work_data *data = bzalloc(sizeof(*data));
+
+	/* without a pool the items run on the calling thread */
+	os_work_pool_run(NULL, count_work, data, 100);
+	check_all_hit_once(data, 100);
+	assert_int_equal(os_atomic_load_long(&data->max_in_flight), 1);
+	assert_int_equal(os_work_pool_num_threads(NULL), 0);
+
+	/* same for a pool without any worker threads */
+	os_work_pool_t *pool = os_work_pool_create(0);
+	assert_non_null(pool);
+	assert_int_equal(os_work_pool_num_threads(pool), 0);
+
+	memset(data, 0, sizeof(*data));
+	os_work_pool_run(pool, count_work, data, 100);
+	check_all_hit_once(data, 100);
+	assert_int_equal(os_atomic_load_long(&data->max_in_flight), 1);
+
+	os_work_pool_destroy(pool);
+	bfree(data);
+}
+
+static void shutdown_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* destroying a pool that never ran anything joins the idle workers */
+	for (size_t i = 0; i < 20; i++)
+		os_work_pool_destroy(os_work_pool_create(8));
+
+	/* destroying right after a batch, while workers may still be on their
+	 * way back to waiting for the next one */
+	for (size_t i = 0; i < 20; i++) {
+		os_work_pool_t *pool = os_work_pool_create(4);
+		struct work_data *data = bzalloc(sizeof(*data));
+
+		os_work_pool_run(pool, count_work, data, 4);
+		os_work_pool_destroy(pool);
+		check_all_hit_once(data, 4);
+		bfree(data);
+	}
+
+	os_work_pool_destroy(NULL);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(fork_join_test),
+		cmocka_unit_test(join_waits_test),
+		cmocka_unit_test(serial_test),
+		cmocka_unit_test(shutdown_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,241 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/buffered-file-serializer.h>
+#include <util/uring-writer.h>
+
+#define TEST_FILE TEST_DIR "/test_uring_writer.bin"
+#define DEPTH 4
+#define BLOCK 4096
+
+/* large enough that the serializer writes several chunks */
+#define FILE_SIZE (256 * 1024)
+
+static inline uint8_t pattern(uint64_t pos, uint8_t seed)
+{
+	return (uint8_t)(pos * 31 + (pos >> 8) + seed);
+}
+
+static int open_test_file(void)
+{
+	int fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	assert_true(fd != -1);
+	return fd;
+}
+
+static void check_file(int fd, const uint8_t *expected, size_t size)
+{
+	uint8_t *data = bmalloc(size + 1);
+
+	assert_int_equal(pread(fd, data, size + 1, 0), size);
+	assert_memory_equal(data, expected, size);
+	bfree(data);
+}
+
+static void write_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const uint64_t blocks[DEPTH] = {3, 0, 2, 1};
+	uint8_t *expected = bmalloc(DEPTH * BLOCK);
+	bool done[DEPTH] = {0};
+	int fd = open_test_file();
+
+	struct uring_writer *w = uring_writer_create(fd, DEPTH);
+	if (!w) {
+		close(fd);
+		bfree(expected);
+		skip();
+	}
+
+	for (size_t i = 0; i < DEPTH * BLOCK; i++)
+		expected[i] = pattern(i, 1);
+
+	/* blocks submitted out of order, each completion names its write */
+	for (size_t i = 0; i < DEPTH; i++) {
+		uint64_t pos = blocks[i] * BLOCK;
+		assert_true(uring_writer_submit(w, expected + pos, BLOCK, pos, false, &done[i]));
+	}
+
+	assert_int_equal(uring_writer_in_flight(w), DEPTH);
+	assert_false(uring_writer_submit(w, expected, BLOCK, 0, false, NULL));
+
+	for (size_t i = 0; i < DEPTH; i++) {
+		void *param;
+		int64_t result;
+
+		assert_true(uring_writer_wait(w, &param, &result));
+		assert_int_equal(result, BLOCK);
+		assert_false(*(bool *)param);
+		*(bool *)param = true;
+	}
+
+	for (size_t i = 0; i < DEPTH; i++)
+		assert_true(done[i]);
+
+	/* nothing left to wait for */
+	void *param;
+	int64_t result;
+	assert_int_equal(uring_writer_in_flight(w), 0);
+	assert_false(uring_writer_wait(w, &param, &result));
+
+	check_file(fd, expected, DEPTH * BLOCK);
+
+	assert_true(uring_writer_destroy(w));
+	close(fd);
+	bfree(expected);
+}
+
+static void after_previous_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t first[2 * BLOCK], patch[10];
+	int fd = open_test_file();
+
+	struct uring_writer *w = uring_writer_create(fd, DEPTH);
+	if (!w) {
+		close(fd);
+		skip();
+	}
+
+	memset(first, 'a', sizeof(first));
+	memset(patch, 'b', sizeof(patch));
+
+	/* the overlapping write lands on top of the one before it */
+	assert_true(uring_writer_submit(w, first, sizeof(first), 0, false, NULL));
+	assert_true(uring_writer_submit(w, patch, sizeof(patch), 100, true, NULL));
+
+	for (size_t i = 0; i < 2; i++) {
+		void *param;
+		int64_t result;
+		assert_true(uring_writer_wait(w, &param, &result));
+	}
+
+	memcpy(first + 100, patch, sizeof(patch));
+	check_file(fd, first, sizeof(first));
+
+	assert_true(uring_writer_destroy(w));
+	close(fd);
+}
+
+static void destroy_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t *expected = bmalloc(DEPTH * BLOCK);
+	int fd = open_test_file();
+
+	struct uring_writer *w = uring_writer_create(fd, DEPTH);
+	if (!w) {
+		close(fd);
+		bfree(expected);
+		skip();
+	}
+
+	for (size_t i = 0; i < DEPTH * BLOCK; i++)
+		expected[i] = pattern(i, 2);
+
+	for (size_t i = 0; i < DEPTH; i++)
+		assert_true(uring_writer_submit(w, expected + i * BLOCK, BLOCK, i * BLOCK, false, NULL));
+
+	/* destroying waits for the writes instead of pulling the ring out from
+	 * under them */
+	assert_true(uring_writer_destroy(w));
+	check_file(fd, expected, DEPTH * BLOCK);
+
+	close(fd);
+	bfree(expected);
+	assert_true(uring_writer_destroy(NULL));
+}
+
+static void write_at(struct serializer *s, uint8_t *expected, uint64_t pos, size_t size, uint8_t seed)
+{
+	uint8_t *data = bmalloc(size);
+
+	for (size_t i = 0; i < size; i++)
+		data[i] = expected[pos + i] = pattern(pos + i, seed);
+
+	assert_int_equal(serializer_seek(s, (int64_t)pos, SERIALIZE_SEEK_START), (int64_t)pos);
+
+	/* in pieces of odd sizes, so chunks get filled from several writes */
+	for (size_t offset = 0, piece = 1; offset < size; piece = piece * 3 % 5000 + 1) {
+		size_t len = piece < size - offset ? piece : size - offset;
+		assert_int_equal(s_write(s, data + offset, len), len);
+		offset += len;
+	}
+
+	bfree(data);
+}
+
+static void serializer_test(uint32_t flags)
+{
+	uint8_t *expected = bzalloc(FILE_SIZE);
+	struct serializer s;
+
+	assert_true(buffered_file_serializer_init2(&s, TEST_FILE, 0, BLOCK, flags));
+
+	/* a header patched after the fact, like the muxer does with sizes */
+	write_at(&s, expected, 0, 10000, 3);
+	write_at(&s, expected, 4, 4, 4);
+
+	/* seeks to unaligned positions, both over data that's already been
+	 * written and past it, with plenty of aligned chunks following */
+	write_at(&s, expected, 10000, 50000, 5);
+	write_at(&s, expected, 12345, 100000, 6);
+	write_at(&s, expected, 112345, FILE_SIZE - 112345 - 777, 7);
+	write_at(&s, expected, 8, 8, 8);
+	write_at(&s, expected, FILE_SIZE - 777, 777, 9);
+
+	buffered_file_serializer_free(&s);
+
+	int fd = open(TEST_FILE, O_RDONLY | O_CLOEXEC);
+	assert_true(fd != -1);
+	check_file(fd, expected, FILE_SIZE);
+	close(fd);
+
+	bfree(expected);
+}
+
+static void serializer_uring_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	serializer_test(0);
+	serializer_test(BUFFERED_FILE_SERIALIZER_IO_URING);
+}
+
+static void serializer_direct_io_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* falls back to buffered writes where O_DIRECT isn't supported */
+	serializer_test(BUFFERED_FILE_SERIALIZER_IO_URING | BUFFERED_FILE_SERIALIZER_DIRECT_IO);
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	unlink(TEST_FILE);
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(write_test),
+		cmocka_unit_test(after_previous_test),
+		cmocka_unit_test(destroy_test),
+		cmocka_unit_test(serializer_uring_test),
+		cmocka_unit_test(serializer_direct_io_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, teardown);
+}
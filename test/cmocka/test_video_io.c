@@ -0,0 +1,294 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <media-io/video-io.h>
+#include <media-io/video-frame.h>
+
+#define WIDTH 64
+#define HEIGHT 36
+#define NUM_FRAMES 12
+#define TIMEOUT_MS 5000
+
+struct receiver {
+	volatile long frames;
+	const uint8_t *data[NUM_FRAMES];
+	uint8_t values[NUM_FRAMES];
+};
+
+static void receive(void *param, struct video_data *frame)
+{
+	struct receiver *receiver = param;
+	long idx = os_atomic_load_long(&receiver->frames);
+
+	if (idx < NUM_FRAMES) {
+		receiver->data[idx] = frame->data[0];
+		receiver->values[idx] = frame->data[0][0];
+	}
+
+	os_atomic_inc_long(&receiver->frames);
+}
+
+static video_t *open_video(void)
+{
+	struct video_output_info info = {
+		.name = "test",
+		.format = VIDEO_FORMAT_I420,
+		.fps_num = 60,
+		.fps_den = 1,
+		.width = WIDTH,
+		.height = HEIGHT,
+		.cache_size = 4,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	video_t *video = NULL;
+
+	assert_int_equal(video_output_open(&video, &info), VIDEO_OUTPUT_SUCCESS);
+	return video;
+}
+
+static inline uint8_t frame_value(int i)
+{
+	return (uint8_t)(32 + i * 8);
+}
+
+/* sends a flat frame, and waits until the receivers got it */
+static void send_frame(video_t *video, int i, struct receiver **receivers, const long *expected, size_t count)
+{
+	struct video_frame frame;
+
+	assert_true(video_output_lock_frame(video, &frame, 1, (uint64_t)i * 16666667ULL));
+	memset(frame.data[0], frame_value(i), frame.linesize[0] * HEIGHT);
+	memset(frame.data[1], 128, frame.linesize[1] * HEIGHT / 2);
+	memset(frame.data[2], 128, frame.linesize[2] * HEIGHT / 2);
+	video_output_unlock_frame(video);
+
+	for (size_t j = 0; j < count; j++) {
+		int waited = 0;
+
+		while (os_atomic_load_long(&receivers[j]->frames) < expected[j] && waited++ < TIMEOUT_MS)
+			os_sleep_ms(1);
+		assert_int_equal(os_atomic_load_long(&receivers[j]->frames), expected[j]);
+	}
+}
+
+static void check_values(const struct receiver *receiver, const uint8_t *expected, long count)
+{
+	for (long i = 0; i < count; i++)
+		assert_true(abs((int)receiver->values[i] - (int)expected[i]) <= 1);
+}
+
+static void shared_conversion(bool threaded)
+{
+	struct video_scale_info half = {VIDEO_FORMAT_NV12, WIDTH / 2, HEIGHT / 2, VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct video_scale_info quarter = {VIDEO_FORMAT_NV12, WIDTH / 4, HEIGHT / 4, VIDEO_RANGE_PARTIAL,
+					   VIDEO_CS_709};
+	struct receiver r[4] = {0};
+	struct receiver *receivers[4] = {&r[0], &r[1], &r[2], &r[3]};
+	struct video_conversion_stats stats;
+	uint8_t values[NUM_FRAMES];
+	video_t *video = open_video();
+
+	video_output_set_threaded_inputs(video, threaded);
+
+	assert_true(video_output_connect(video, &half, receive, &r[0]));
+	assert_true(video_output_connect(video, &half, receive, &r[1]));
+	assert_true(video_output_connect(video, &half, receive, &r[2]));
+	assert_true(video_output_connect(video, &quarter, receive, &r[3]));
+
+	video_output_get_conversion_stats(video, &stats);
+	assert_int_equal(stats.conversions, 2);
+	assert_int_equal(stats.converted_inputs, 4);
+
+	for (int i = 0; i < NUM_FRAMES; i++) {
+		const long expected[4] = {i + 1, i + 1, i + 1, i + 1};
+
+		values[i] = frame_value(i);
+		send_frame(video, i, receivers, expected, 4);
+	}
+
+	/* each frame is scaled once per conversion, and the matching inputs
+	 * get the same scaled frame */
+	video_output_get_conversion_stats(video, &stats);
+	assert_int_equal(stats.scaled_frames, NUM_FRAMES * 2);
+	assert_int_equal(stats.shared_frames, NUM_FRAMES * 2);
+
+	for (int i = 0; i < NUM_FRAMES; i++) {
+		assert_ptr_equal(r[0].data[i], r[1].data[i]);
+		assert_ptr_equal(r[0].data[i], r[2].data[i]);
+	}
+
+	for (int i = 0; i < 4; i++)
+		check_values(&r[i], values, NUM_FRAMES);
+
+	video_output_disconnect(video, receive, &r[0]);
+	video_output_disconnect(video, receive, &r[3]);
+
+	video_output_get_conversion_stats(video, &stats);
+	assert_int_equal(stats.conversions, 1);
+	assert_int_equal(stats.converted_inputs, 2);
+
+	video_output_disconnect(video, receive, &r[1]);
+	video_output_disconnect(video, receive, &r[2]);
+
+	video_output_get_conversion_stats(video, &stats);
+	assert_int_equal(stats.conversions, 0);
+
+	video_output_close(video);
+}
+
+static void shared_conversion_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	shared_conversion(false);
+}
+
+static void threaded_shared_conversion_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	shared_conversion(true);
+}
+
+/* inputs with a frame rate divisor only share with inputs of the same
+ * divisor, and skip the same frames even when connected later */
+static void frame_rate_divisor_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct video_scale_info half = {VIDEO_FORMAT_NV12, WIDTH / 2, HEIGHT / 2, VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct receiver r[3] = {0};
+	struct receiver *receivers[3] = {&r[0], &r[1], &r[2]};
+	struct video_conversion_stats stats;
+	uint8_t values[NUM_FRAMES];
+	video_t *video = open_video();
+
+	assert_true(video_output_connect2(video, &half, 2, receive, &r[0]));
+	assert_true(video_output_connect2(video, &half, 1, receive, &r[2]));
+
+	for (int i = 0; i < NUM_FRAMES; i++) {
+		const long expected[3] = {(i + 2) / 2, i / 2, i + 1};
+
+		/* connected on an odd frame, which the other input skips */
+		if (i == 1)
+			assert_true(video_output_connect2(video, &half, 2, receive, &r[1]));
+
+		send_frame(video, i, receivers, expected, 3);
+
+		if (i % 2 == 0)
+			values[i / 2] = frame_value(i);
+	}
+
+	video_output_get_conversion_stats(video, &stats);
+	assert_int_equal(stats.conversions, 2);
+	assert_int_equal(stats.converted_inputs, 3);
+	assert_int_equal(stats.scaled_frames, NUM_FRAMES + NUM_FRAMES / 2);
+	assert_int_equal(stats.shared_frames, NUM_FRAMES / 2 - 1);
+
+	check_values(&r[0], values, NUM_FRAMES / 2);
+	check_values(&r[1], values + 1, NUM_FRAMES / 2 - 1);
+
+	video_output_close(video);
+}
+
+struct blocking_receiver {
+	struct receiver receiver;
+	os_event_t *release;
+};
+
+static void receive_blocking(void *param, struct video_data *frame)
+{
+	struct blocking_receiver *blocking = param;
+
+	receive(&blocking->receiver, frame);
+	os_event_wait(blocking->release);
+}
+
+/* a threaded input that stops taking frames holds on to a few cached frames,
+ * which mustn't hold back the newer frames that the other inputs are done
+ * with */
+static void slow_threaded_input_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct blocking_receiver slow = {0};
+	struct receiver fast = {0};
+	struct receiver *receivers[1] = {&fast};
+	struct video_input_stats stats;
+	uint8_t values[NUM_FRAMES];
+	video_t *video = open_video();
+
+	assert_int_equal(os_event_init(&slow.release, OS_EVENT_TYPE_MANUAL), 0);
+
+	video_output_set_threaded_inputs(video, true);
+	assert_true(video_output_connect(video, NULL, receive_blocking, &slow));
+	video_output_set_threaded_inputs(video, false);
+	assert_true(video_output_connect(video, NULL, receive, &fast));
+
+	for (int i = 0; i < NUM_FRAMES; i++) {
+		const long expected[1] = {i + 1};
+		int waited = 0;
+
+		values[i] = frame_value(i);
+		send_frame(video, i, receivers, expected, 1);
+
+		/* the slow input is stuck on the first frame from here on */
+		while (i == 0 && os_atomic_load_long(&slow.receiver.frames) < 1 && waited++ < TIMEOUT_MS)
+			os_sleep_ms(1);
+		waited = 0;
+
+		/* the frame is back in the cache once the video thread is
+		 * done with it */
+		while (video_output_get_total_frames(video) < (uint32_t)i + 1 && waited++ < TIMEOUT_MS)
+			os_sleep_ms(1);
+	}
+
+	check_values(&fast, values, NUM_FRAMES);
+	assert_int_equal(video_output_get_skipped_frames(video), NUM_FRAMES - 3);
+
+	/* one frame in the callback, the rest are repeats of the last queued
+	 * frame */
+	assert_true(video_output_get_input_stats(video, receive_blocking, &slow, &stats));
+	assert_int_equal(stats.max_queue_depth, 2);
+	assert_int_equal(stats.dropped_frames, NUM_FRAMES - 3);
+
+	os_event_signal(slow.release);
+	video_output_disconnect(video, receive_blocking, &slow);
+	video_output_disconnect(video, receive, &fast);
+	video_output_close(video);
+
+	os_event_destroy(slow.release);
+}
+
+/* the video thread uses the core's profiler name store */
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+	return obs_startup("en-US", NULL, NULL) ? 0 : -1;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+	obs_shutdown();
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(shared_conversion_test),
+		cmocka_unit_test(threaded_shared_conversion_test),
+		cmocka_unit_test(frame_rate_divisor_test),
+		cmocka_unit_test(slow_threaded_input_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
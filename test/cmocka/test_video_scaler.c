@@ -0,0 +1,386 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <media-io/format-conversion.h>
+#include <media-io/video-frame.h>
+#include <media-io/video-scaler.h>
+
+/* not a multiple of the vector width, so the scalar tails run as well */
+#define WIDTH 212
+#define HEIGHT 120
+
+/* a size swscale has to do the work for */
+#define OTHER_WIDTH 150
+#define OTHER_HEIGHT 84
+
+static void fill_random(struct video_frame *frame, enum video_format format, uint32_t height)
+{
+	for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
+		if (!frame->data[plane])
+			continue;
+
+		uint32_t rows = plane == 0 || format == VIDEO_FORMAT_BGRA || format == VIDEO_FORMAT_RGBA ? height
+													  : height / 2;
+		for (size_t i = 0; i < (size_t)frame->linesize[plane] * rows; i++)
+			frame->data[plane][i] = (uint8_t)rand();
+	}
+}
+
+static void fill_color(struct video_frame *frame, uint32_t width, uint32_t height, const uint8_t *px)
+{
+	for (uint32_t y = 0; y < height; y++) {
+		uint8_t *line = frame->data[0] + y * frame->linesize[0];
+		for (uint32_t x = 0; x < width; x++)
+			memcpy(line + x * 4, px, 4);
+	}
+}
+
+static video_scaler_t *create_scaler(enum video_format src_format, uint32_t src_width, uint32_t src_height,
+				     enum video_format dst_format, uint32_t dst_width, uint32_t dst_height,
+				     enum video_range_type range, enum video_colorspace cs, uint32_t threads,
+				     uint32_t flags)
+{
+	struct video_scale_info src = {src_format, src_width, src_height, range, cs};
+	struct video_scale_info dst = {dst_format, dst_width, dst_height, range, cs};
+	video_scaler_t *scaler = NULL;
+
+	if (src_format == VIDEO_FORMAT_BGRA || src_format == VIDEO_FORMAT_RGBA)
+		src.range = VIDEO_RANGE_FULL;
+
+	assert_int_equal(video_scaler_create2(&scaler, &dst, &src, VIDEO_SCALE_FAST_BILINEAR, threads, flags),
+			 VIDEO_SCALER_SUCCESS);
+	return scaler;
+}
+
+static void scale(video_scaler_t *scaler, struct video_frame *out, const struct video_frame *in)
+{
+	assert_true(video_scaler_scale(scaler, out->data, out->linesize, (const uint8_t *const *)in->data,
+				       in->linesize));
+}
+
+static inline int box(const uint8_t *line1, const uint8_t *line2, size_t x, size_t step)
+{
+	return (line1[x] + line1[x + step] + line2[x] + line2[x + step] + 2) >> 2;
+}
+
+static void check_halved_plane(const struct video_frame *out, const struct video_frame *in, size_t plane,
+			       uint32_t width, uint32_t height, size_t step)
+{
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t *line1 = in->data[plane] + y * 2 * in->linesize[plane];
+		const uint8_t *line2 = line1 + in->linesize[plane];
+		const uint8_t *line = out->data[plane] + y * out->linesize[plane];
+
+		/* U and V are interleaved in NV12, so each step covers both */
+		for (uint32_t x = 0; x < width; x++) {
+			size_t src_x = (x / step) * step * 2 + x % step;
+			assert_int_equal(line[x], box(line1, line2, src_x, step));
+		}
+	}
+}
+
+static void halve(enum video_format format, uint32_t threads)
+{
+	struct video_frame in, out;
+	video_scaler_t *scaler;
+
+	video_frame_init(&in, format, WIDTH * 2, HEIGHT * 2);
+	video_frame_init(&out, format, WIDTH, HEIGHT);
+	fill_random(&in, format, HEIGHT * 2);
+
+	scaler = create_scaler(format, WIDTH * 2, HEIGHT * 2, format, WIDTH, HEIGHT, VIDEO_RANGE_PARTIAL,
+			       VIDEO_CS_709, threads, VIDEO_SCALER_FAST_PATH);
+	assert_true(video_scaler_uses_fast_path(scaler));
+	scale(scaler, &out, &in);
+
+	check_halved_plane(&out, &in, 0, WIDTH, HEIGHT, 1);
+	if (format == VIDEO_FORMAT_NV12) {
+		check_halved_plane(&out, &in, 1, WIDTH, HEIGHT / 2, 2);
+	} else {
+		check_halved_plane(&out, &in, 1, WIDTH / 2, HEIGHT / 2, 1);
+		check_halved_plane(&out, &in, 2, WIDTH / 2, HEIGHT / 2, 1);
+	}
+
+	video_scaler_destroy(scaler);
+	video_frame_free(&in);
+	video_frame_free(&out);
+}
+
+/* every instruction set the CPU has must give the same result */
+static void for_each_simd(void (*test)(enum video_format format, uint32_t threads), enum video_format format)
+{
+	enum format_conversion_simd prev = format_conversion_get_simd();
+	enum format_conversion_simd simds[] = {FORMAT_CONVERSION_SIMD_SSE2, FORMAT_CONVERSION_SIMD_AVX2,
+					       FORMAT_CONVERSION_SIMD_NEON};
+
+	for (size_t i = 0; i < sizeof(simds) / sizeof(simds[0]); i++) {
+		if (!format_conversion_set_simd(simds[i]))
+			continue;
+
+		test(format, 1);
+		test(format, 4);
+	}
+
+	format_conversion_set_simd(prev);
+}
+
+static void halve_nv12_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_simd(halve, VIDEO_FORMAT_NV12);
+}
+
+static void halve_i420_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_simd(halve, VIDEO_FORMAT_I420);
+}
+
+struct yuv_coeffs {
+	double kr, kb;
+	double y_scale, c_scale, y_base;
+};
+
+static inline double clamp_val(double val)
+{
+	return val < 0.0 ? 0.0 : (val > 255.0 ? 255.0 : val);
+}
+
+static void check_rgb_to_420(const struct video_frame *out, const struct video_frame *in, bool rgba, bool planar,
+			     const struct yuv_coeffs *c)
+{
+	const size_t r = rgba ? 0 : 2;
+	const size_t b = rgba ? 2 : 0;
+	const double kg = 1.0 - c->kr - c->kb;
+
+	for (uint32_t y = 0; y < HEIGHT; y++) {
+		for (uint32_t x = 0; x < WIDTH; x++) {
+			const uint8_t *px = in->data[0] + y * in->linesize[0] + x * 4;
+			double lum = c->y_base + c->y_scale * (c->kr * px[r] + kg * px[1] + c->kb * px[b]);
+			assert_true(fabs(out->data[0][y * out->linesize[0] + x] - lum) <= 1.0);
+		}
+	}
+
+	for (uint32_t y = 0; y < HEIGHT / 2; y++) {
+		for (uint32_t x = 0; x < WIDTH / 2; x++) {
+			double sum[3] = {0};
+			uint8_t u, v;
+
+			for (uint32_t i = 0; i < 4; i++) {
+				const uint8_t *px =
+					in->data[0] + (y * 2 + i / 2) * in->linesize[0] + (x * 2 + i % 2) * 4;
+				for (size_t ch = 0; ch < 3; ch++)
+					sum[ch] += px[ch] / 4.0;
+			}
+
+			double lum = c->kr * sum[r] + kg * sum[1] + c->kb * sum[b];
+			double exp_u = clamp_val(128.0 + c->c_scale * (sum[b] - lum) / (2.0 * (1.0 - c->kb)));
+			double exp_v = clamp_val(128.0 + c->c_scale * (sum[r] - lum) / (2.0 * (1.0 - c->kr)));
+
+			if (planar) {
+				u = out->data[1][y * out->linesize[1] + x];
+				v = out->data[2][y * out->linesize[2] + x];
+			} else {
+				u = out->data[1][y * out->linesize[1] + x * 2];
+				v = out->data[1][y * out->linesize[1] + x * 2 + 1];
+			}
+
+			assert_true(fabs(u - exp_u) <= 1.0);
+			assert_true(fabs(v - exp_v) <= 1.0);
+		}
+	}
+}
+
+static void rgb_to_420(enum video_format format, uint32_t threads)
+{
+	static const struct {
+		enum video_colorspace cs;
+		enum video_range_type range;
+		struct yuv_coeffs coeffs;
+	} matrices[] = {
+		{VIDEO_CS_709, VIDEO_RANGE_PARTIAL, {0.2126, 0.0722, 219.0 / 255.0, 224.0 / 255.0, 16.0}},
+		{VIDEO_CS_601, VIDEO_RANGE_PARTIAL, {0.299, 0.114, 219.0 / 255.0, 224.0 / 255.0, 16.0}},
+		{VIDEO_CS_709, VIDEO_RANGE_FULL, {0.2126, 0.0722, 1.0, 1.0, 0.0}},
+	};
+
+	for (size_t i = 0; i < sizeof(matrices) / sizeof(matrices[0]); i++) {
+		for (int rgba = 0; rgba < 2; rgba++) {
+			enum video_format src_format = rgba ? VIDEO_FORMAT_RGBA : VIDEO_FORMAT_BGRA;
+			struct video_frame in, out;
+			video_scaler_t *scaler;
+
+			video_frame_init(&in, src_format, WIDTH, HEIGHT);
+			video_frame_init(&out, format, WIDTH, HEIGHT);
+			fill_random(&in, src_format, HEIGHT);
+
+			scaler = create_scaler(src_format, WIDTH, HEIGHT, format, WIDTH, HEIGHT, matrices[i].range,
+					       matrices[i].cs, threads, VIDEO_SCALER_FAST_PATH);
+			assert_true(video_scaler_uses_fast_path(scaler));
+			scale(scaler, &out, &in);
+
+			check_rgb_to_420(&out, &in, rgba, format == VIDEO_FORMAT_I420, &matrices[i].coeffs);
+
+			video_scaler_destroy(scaler);
+			video_frame_free(&in);
+			video_frame_free(&out);
+		}
+	}
+}
+
+static void rgb_to_nv12_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_simd(rgb_to_420, VIDEO_FORMAT_NV12);
+}
+
+static void rgb_to_i420_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	for_each_simd(rgb_to_420, VIDEO_FORMAT_I420);
+}
+
+/* flat colors come out the same as with swscale, which catches mixed up
+ * channels or matrices */
+static void rgb_matches_swscale_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const uint8_t colors[][4] = {
+		{0, 0, 0, 255}, {255, 255, 255, 255}, {255, 0, 0, 255}, {0, 255, 0, 255}, {0, 0, 255, 255},
+		{40, 90, 200, 255},
+	};
+
+	for (size_t i = 0; i < sizeof(colors) / sizeof(colors[0]); i++) {
+		struct video_frame in, fast_out, sws_out;
+		video_scaler_t *fast, *sws;
+
+		video_frame_init(&in, VIDEO_FORMAT_BGRA, WIDTH, HEIGHT);
+		video_frame_init(&fast_out, VIDEO_FORMAT_NV12, WIDTH, HEIGHT);
+		video_frame_init(&sws_out, VIDEO_FORMAT_NV12, WIDTH, HEIGHT);
+		fill_color(&in, WIDTH, HEIGHT, colors[i]);
+
+		fast = create_scaler(VIDEO_FORMAT_BGRA, WIDTH, HEIGHT, VIDEO_FORMAT_NV12, WIDTH, HEIGHT,
+				     VIDEO_RANGE_PARTIAL, VIDEO_CS_709, 1, VIDEO_SCALER_FAST_PATH);
+		sws = create_scaler(VIDEO_FORMAT_BGRA, WIDTH, HEIGHT, VIDEO_FORMAT_NV12, WIDTH, HEIGHT,
+				    VIDEO_RANGE_PARTIAL, VIDEO_CS_709, 1, 0);
+		assert_false(video_scaler_uses_fast_path(sws));
+
+		scale(fast, &fast_out, &in);
+		scale(sws, &sws_out, &in);
+
+		/* away from the edges, where swscale's chroma filter runs out
+		 * of pixels */
+		assert_true(abs((int)fast_out.data[0][10 * fast_out.linesize[0] + 10] -
+				(int)sws_out.data[0][10 * sws_out.linesize[0] + 10]) <= 2);
+		assert_true(abs((int)fast_out.data[1][10 * fast_out.linesize[1] + 20] -
+				(int)sws_out.data[1][10 * sws_out.linesize[1] + 20]) <= 2);
+		assert_true(abs((int)fast_out.data[1][10 * fast_out.linesize[1] + 21] -
+				(int)sws_out.data[1][10 * sws_out.linesize[1] + 21]) <= 2);
+
+		video_scaler_destroy(fast);
+		video_scaler_destroy(sws);
+		video_frame_free(&in);
+		video_frame_free(&fast_out);
+		video_frame_free(&sws_out);
+	}
+}
+
+static void fast_path_selection_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct video_scale_info src = {VIDEO_FORMAT_NV12, WIDTH * 2, HEIGHT * 2, VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct video_scale_info dst = {VIDEO_FORMAT_NV12, WIDTH, HEIGHT, VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	const uint32_t fast = VIDEO_SCALER_FAST_PATH;
+	video_scaler_t *scaler = NULL;
+
+	/* the native code has to be asked for */
+	assert_int_equal(video_scaler_create(&scaler, &dst, &src, VIDEO_SCALE_FAST_BILINEAR), VIDEO_SCALER_SUCCESS);
+	assert_false(video_scaler_uses_fast_path(scaler));
+	video_scaler_destroy(scaler);
+
+	assert_int_equal(video_scaler_create2(&scaler, &dst, &src, VIDEO_SCALE_FAST_BILINEAR, 1, 0),
+			 VIDEO_SCALER_SUCCESS);
+	assert_false(video_scaler_uses_fast_path(scaler));
+	video_scaler_destroy(scaler);
+
+	/* point sampling isn't a box filter */
+	assert_int_equal(video_scaler_create2(&scaler, &dst, &src, VIDEO_SCALE_POINT, 1, fast), VIDEO_SCALER_SUCCESS);
+	assert_false(video_scaler_uses_fast_path(scaler));
+	video_scaler_destroy(scaler);
+
+	/* neither is any other ratio */
+	dst.width = OTHER_WIDTH;
+	dst.height = OTHER_HEIGHT;
+	assert_int_equal(video_scaler_create2(&scaler, &dst, &src, VIDEO_SCALE_FAST_BILINEAR, 1, fast),
+			 VIDEO_SCALER_SUCCESS);
+	assert_false(video_scaler_uses_fast_path(scaler));
+	video_scaler_destroy(scaler);
+
+	/* range conversions are left to swscale */
+	dst.width = WIDTH;
+	dst.height = HEIGHT;
+	dst.range = VIDEO_RANGE_FULL;
+	assert_int_equal(video_scaler_create2(&scaler, &dst, &src, VIDEO_SCALE_FAST_BILINEAR, 1, fast),
+			 VIDEO_SCALER_SUCCESS);
+	assert_false(video_scaler_uses_fast_path(scaler));
+	video_scaler_destroy(scaler);
+}
+
+/* swscale's slice threads give the same result as a single thread */
+static void swscale_threads_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct video_frame in, out1, out4;
+	video_scaler_t *scaler1, *scaler4;
+	uint32_t dst_width = OTHER_WIDTH;
+	uint32_t dst_height = OTHER_HEIGHT;
+
+	video_frame_init(&in, VIDEO_FORMAT_I420, WIDTH, HEIGHT);
+	video_frame_init(&out1, VIDEO_FORMAT_NV12, dst_width, dst_height);
+	video_frame_init(&out4, VIDEO_FORMAT_NV12, dst_width, dst_height);
+	fill_random(&in, VIDEO_FORMAT_I420, HEIGHT);
+
+	scaler1 = create_scaler(VIDEO_FORMAT_I420, WIDTH, HEIGHT, VIDEO_FORMAT_NV12, dst_width, dst_height,
+				VIDEO_RANGE_PARTIAL, VIDEO_CS_709, 1, 0);
+	scaler4 = create_scaler(VIDEO_FORMAT_I420, WIDTH, HEIGHT, VIDEO_FORMAT_NV12, dst_width, dst_height,
+				VIDEO_RANGE_PARTIAL, VIDEO_CS_709, 4, 0);
+
+	scale(scaler1, &out1, &in);
+	scale(scaler4, &out4, &in);
+
+	for (uint32_t y = 0; y < dst_height; y++)
+		assert_memory_equal(out1.data[0] + y * out1.linesize[0], out4.data[0] + y * out4.linesize[0],
+				    dst_width);
+	for (uint32_t y = 0; y < dst_height / 2; y++)
+		assert_memory_equal(out1.data[1] + y * out1.linesize[1], out4.data[1] + y * out4.linesize[1],
+				    dst_width);
+
+	video_scaler_destroy(scaler1);
+	video_scaler_destroy(scaler4);
+	video_frame_free(&in);
+	video_frame_free(&out1);
+	video_frame_free(&out4);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(halve_nv12_test),
+		cmocka_unit_test(halve_i420_test),
+		cmocka_unit_test(rgb_to_nv12_test),
+		cmocka_unit_test(rgb_to_i420_test),
+		cmocka_unit_test(rgb_matches_swscale_test),
+		cmocka_unit_test(fast_path_selection_test),
+		cmocka_unit_test(swscale_threads_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}